@@ -0,0 +1,72 @@
+/**************************************************************************//**
+ * @file     nu_crc.h
+ * @brief    CRC32, CRC32C, CRC16 and CRC-CCITT for buffers of any size
+ *
+ *           CRC32 and CRC32C use the CRC32 instructions of the A35. Buffers
+ *           of more than a few hundred bytes are split into three blocks
+ *           whose CRCs are computed in parallel, which hides the latency of
+ *           the instruction, and are then combined with tables for shifting
+ *           a CRC over a run of zero bytes. The CRC16 variants and, when the
+ *           instructions are missing or disabled, CRC32 and CRC32C use
+ *           slice-by-8 tables, which process eight bytes per step.
+ *
+ *           All tables are built on first use, about 40 KB in total. A CRC
+ *           can be continued over several calls by passing the result of
+ *           one call to the next.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __NU_CRC_H__
+#define __NU_CRC_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @addtogroup CRC_Library CRC Library
+  @{
+*/
+
+/** @addtogroup CRC_EXPORTED_CONSTANTS CRC Library Exported Constants
+  @{
+*/
+
+#define CRC16_MODBUS_INIT       0xFFFFU /*!< Initial value of nu_crc16() for Modbus RTU */
+#define CRC16_CCITT_INIT        0xFFFFU /*!< Initial value of nu_crc16_ccitt() for CRC-16/CCITT-FALSE, 0 for XMODEM */
+
+/*! @}*/ /* end of group CRC_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup CRC_EXPORTED_FUNCTIONS CRC Library Exported Functions
+  @{
+*/
+
+/* Implementation selection */
+void nu_crc_set_hw(int enable);
+int  nu_crc_hw_enabled(void);
+
+/* CRC-32 (IEEE 802.3, as zlib) and CRC-32C (Castagnoli, as iSCSI). Start
+   with 0; the pre- and post-inversion is done inside. */
+uint32_t nu_crc32(uint32_t crc, const void *data, size_t len);
+uint32_t nu_crc32c(uint32_t crc, const void *data, size_t len);
+
+/* CRC-16 with polynomial 0x8005 bit reflected (Modbus, ARC) and CRC-16 with
+   polynomial 0x1021 (CCITT, XMODEM). Start with the initial value of the
+   protocol; no inversion is done. */
+uint16_t nu_crc16(uint16_t crc, const void *data, size_t len);
+uint16_t nu_crc16_ccitt(uint16_t crc, const void *data, size_t len);
+
+/*! @}*/ /* end of group CRC_EXPORTED_FUNCTIONS */
+
+/*! @}*/ /* end of group CRC_Library */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NU_CRC_H__ */
@@ -0,0 +1,485 @@
+/**************************************************************************//**
+ * @file     nu_crc.c
+ * @brief    CRC32, CRC32C, CRC16 and CRC-CCITT for buffers of any size
+ *
+ *           Slice-by-8: table k gives the CRC of a byte followed by k zero
+ *           bytes, so the CRC of eight bytes is the XOR of eight lookups,
+ *           one per byte, that do not depend on each other.
+ *
+ *           Three-way CRC32 instructions: a run of 3 * n bytes is split
+ *           into blocks A, B and C whose CRCs run in three independent
+ *           chains, B and C starting from 0. As the CRC is linear,
+ *           crc(ABC) = shift(shift(crc(A)) ^ crc(B)) ^ crc(C), where shift
+ *           appends n zero bytes. shift is a 32 x 32 matrix over GF(2),
+ *           applied with four tables of 256 entries (Mark Adler's method).
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <string.h>
+#include "nu_crc.h"
+
+/** @cond HIDDEN_SYMBOLS */
+
+#define CRC32_POLY          0xEDB88320U     /* 0x04C11DB7 bit reflected */
+#define CRC32C_POLY         0x82F63B78U     /* 0x1EDC6F41 bit reflected */
+#define CRC16_POLY          0xA001U         /* 0x8005 bit reflected */
+#define CRC16_CCITT_POLY    0x1021U
+
+#define CRC_LONG            8192U           /* Block of the three-way loop for large buffers */
+#define CRC_SHORT           256U            /* Block of the three-way loop for the rest */
+
+/* Tables, each built on first use */
+#define CRC_TAB_CRC32       0x01U
+#define CRC_TAB_CRC32C      0x02U
+#define CRC_TAB_CRC16       0x04U
+#define CRC_TAB_CCITT       0x08U
+#define CRC_TAB_SHIFT32     0x10U
+#define CRC_TAB_SHIFT32C    0x20U
+
+static uint32_t s_au32Crc32[8][256], s_au32Crc32c[8][256];
+static uint16_t s_au16Crc16[8][256], s_au16Ccitt[8][256];
+static uint32_t s_au32Long32[4][256], s_au32Short32[4][256];
+static uint32_t s_au32Long32c[4][256], s_au32Short32c[4][256];
+static uint32_t s_u32Ready;
+
+#if defined(__aarch64__) && defined(__GNUC__)
+#define NU_CRC_HW           1
+/* The instructions are emitted whatever -mcpu says; their presence is checked at run time */
+#define CRC_TARGET          __attribute__((target("+crc")))
+#else
+#define NU_CRC_HW           0
+#endif
+
+static int s_i32Hw = -1;                    /* -1 until checked */
+
+static uint64_t crc_load64(const uint8_t *p)
+{
+    uint64_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;                               /* Little endian */
+}
+
+static void crc32_slice_init(uint32_t T[8][256], uint32_t poly)
+{
+    uint32_t n, k, c;
+
+    for (n = 0; n < 256; n++)
+    {
+        c = n;
+        for (k = 0; k < 8; k++)
+            c = (c >> 1) ^ ((c & 1U) ? poly : 0U);
+        T[0][n] = c;
+    }
+    for (n = 0; n < 256; n++)
+        for (k = 1; k < 8; k++)
+            T[k][n] = (T[k - 1][n] >> 8) ^ T[0][T[k - 1][n] & 0xFFU];
+}
+
+static void crc16_slice_init(uint16_t T[8][256])
+{
+    uint32_t n, k, c;
+
+    for (n = 0; n < 256; n++)
+    {
+        c = n;
+        for (k = 0; k < 8; k++)
+            c = (c >> 1) ^ ((c & 1U) ? CRC16_POLY : 0U);
+        T[0][n] = (uint16_t)c;
+    }
+    for (n = 0; n < 256; n++)
+        for (k = 1; k < 8; k++)
+            T[k][n] = (uint16_t)((T[k - 1][n] >> 8) ^ T[0][T[k - 1][n] & 0xFFU]);
+}
+
+/* Not reflected: the first byte goes to the high end */
+static void ccitt_slice_init(uint16_t T[8][256])
+{
+    uint32_t n, k, c;
+
+    for (n = 0; n < 256; n++)
+    {
+        c = n << 8;
+        for (k = 0; k < 8; k++)
+            c = (c << 1) ^ ((c & 0x8000U) ? CRC16_CCITT_POLY : 0U);
+        T[0][n] = (uint16_t)c;
+    }
+    for (n = 0; n < 256; n++)
+        for (k = 1; k < 8; k++)
+            T[k][n] = (uint16_t)((T[k - 1][n] << 8) ^ T[0][T[k - 1][n] >> 8]);
+}
+
+/* GF(2) matrix, column n is the image of bit n */
+static uint32_t gf2_times(const uint32_t *mat, uint32_t vec)
+{
+    uint32_t sum = 0;
+
+    while (vec)
+    {
+        if (vec & 1U)
+            sum ^= *mat;
+        vec >>= 1;
+        mat++;
+    }
+    return sum;
+}
+
+static void gf2_square(uint32_t *square, const uint32_t *mat)
+{
+    uint32_t n;
+
+    for (n = 0; n < 32; n++)
+        square[n] = gf2_times(mat, mat[n]);
+}
+
+/* Tables that shift a CRC register over len zero bytes, len a power of two */
+static void crc_shift_init(uint32_t Z[4][256], uint32_t poly, uint32_t len)
+{
+    uint32_t even[32], odd[32], *op = odd, n, row;
+
+    /* One zero bit */
+    odd[0] = poly;
+    for (n = 1, row = 1; n < 32; n++, row <<= 1)
+        odd[n] = row;
+
+    /* Two, then four zero bits */
+    gf2_square(even, odd);
+    gf2_square(odd, even);
+
+    /* Square on until the operator covers len bytes */
+    for (;;)
+    {
+        gf2_square(even, odd);
+        op = even;
+        len >>= 1;
+        if (len == 0)
+            break;
+        gf2_square(odd, even);
+        op = odd;
+        len >>= 1;
+        if (len == 0)
+            break;
+    }
+
+    for (n = 0; n < 256; n++)
+    {
+        Z[0][n] = gf2_times(op, n);
+        Z[1][n] = gf2_times(op, n << 8);
+        Z[2][n] = gf2_times(op, n << 16);
+        Z[3][n] = gf2_times(op, n << 24);
+    }
+}
+
+/*
+ *  Builds the tables in mask that are not built yet. Two cores may build a
+ *  table at the same time; they write the same values, and the ready bit
+ *  is only seen after the table.
+ */
+static void crc_tables(uint32_t mask)
+{
+    if ((__atomic_load_n(&s_u32Ready, __ATOMIC_ACQUIRE) & mask) == mask)
+        return;
+
+    if (mask & CRC_TAB_CRC32)
+        crc32_slice_init(s_au32Crc32, CRC32_POLY);
+    if (mask & CRC_TAB_CRC32C)
+        crc32_slice_init(s_au32Crc32c, CRC32C_POLY);
+    if (mask & CRC_TAB_CRC16)
+        crc16_slice_init(s_au16Crc16);
+    if (mask & CRC_TAB_CCITT)
+        ccitt_slice_init(s_au16Ccitt);
+    if (mask & CRC_TAB_SHIFT32)
+    {
+        crc_shift_init(s_au32Long32, CRC32_POLY, CRC_LONG);
+        crc_shift_init(s_au32Short32, CRC32_POLY, CRC_SHORT);
+    }
+    if (mask & CRC_TAB_SHIFT32C)
+    {
+        crc_shift_init(s_au32Long32c, CRC32C_POLY, CRC_LONG);
+        crc_shift_init(s_au32Short32c, CRC32C_POLY, CRC_SHORT);
+    }
+
+    __atomic_fetch_or(&s_u32Ready, mask, __ATOMIC_RELEASE);
+}
+
+/* Reflected 32-bit CRC register, slice-by-8 */
+static uint32_t crc32_sw(uint32_t T[8][256], uint32_t crc, const uint8_t *p, size_t len)
+{
+    uint64_t v;
+
+    while (len && ((uintptr_t)p & 7U))
+    {
+        crc = (crc >> 8) ^ T[0][(crc ^ *p++) & 0xFFU];
+        len--;
+    }
+    for (; len >= 8; len -= 8, p += 8)
+    {
+        v = crc_load64(p) ^ crc;
+        crc = T[7][v & 0xFFU] ^ T[6][(v >> 8) & 0xFFU] ^
+              T[5][(v >> 16) & 0xFFU] ^ T[4][(v >> 24) & 0xFFU] ^
+              T[3][(v >> 32) & 0xFFU] ^ T[2][(v >> 40) & 0xFFU] ^
+              T[1][(v >> 48) & 0xFFU] ^ T[0][v >> 56];
+    }
+    while (len--)
+        crc = (crc >> 8) ^ T[0][(crc ^ *p++) & 0xFFU];
+
+    return crc;
+}
+
+#if NU_CRC_HW
+
+static int crc_hw_present(void)
+{
+    uint64_t isar0;
+
+    /* ID_AA64ISAR0_EL1.CRC32, bits [19:16] */
+    __asm volatile("mrs %0, id_aa64isar0_el1" : "=r"(isar0));
+    return ((isar0 >> 16) & 0xFU) != 0U;
+}
+
+static inline __attribute__((always_inline)) CRC_TARGET
+uint32_t crc_hw_x(uint32_t crc, uint64_t v, int c)
+{
+    if (c)
+        __asm("crc32cx %w0, %w0, %x1" : "+r"(crc) : "r"(v));
+    else
+        __asm("crc32x %w0, %w0, %x1" : "+r"(crc) : "r"(v));
+    return crc;
+}
+
+static inline __attribute__((always_inline)) CRC_TARGET
+uint32_t crc_hw_w(uint32_t crc, uint32_t v, int c)
+{
+    if (c)
+        __asm("crc32cw %w0, %w0, %w1" : "+r"(crc) : "r"(v));
+    else
+        __asm("crc32w %w0, %w0, %w1" : "+r"(crc) : "r"(v));
+    return crc;
+}
+
+static inline __attribute__((always_inline)) CRC_TARGET
+uint32_t crc_hw_h(uint32_t crc, uint32_t v, int c)
+{
+    if (c)
+        __asm("crc32ch %w0, %w0, %w1" : "+r"(crc) : "r"(v));
+    else
+        __asm("crc32h %w0, %w0, %w1" : "+r"(crc) : "r"(v));
+    return crc;
+}
+
+static inline __attribute__((always_inline)) CRC_TARGET
+uint32_t crc_hw_b(uint32_t crc, uint32_t v, int c)
+{
+    if (c)
+        __asm("crc32cb %w0, %w0, %w1" : "+r"(crc) : "r"(v));
+    else
+        __asm("crc32b %w0, %w0, %w1" : "+r"(crc) : "r"(v));
+    return crc;
+}
+
+static uint32_t crc_shift(uint32_t Z[4][256], uint32_t crc)
+{
+    return Z[0][crc & 0xFFU] ^ Z[1][(crc >> 8) & 0xFFU] ^
+           Z[2][(crc >> 16) & 0xFFU] ^ Z[3][crc >> 24];
+}
+
+/* Three chains of len / 3 bytes each while at least 3 * blk bytes are left */
+static inline __attribute__((always_inline)) CRC_TARGET
+uint32_t crc_hw_3way(uint32_t Z[4][256], uint32_t crc, const uint8_t **pp, size_t *plen, size_t blk, int c)
+{
+    const uint8_t *p = *pp, *end;
+    uint32_t crc1, crc2;
+
+    while (*plen >= 3 * blk)
+    {
+        crc1 = 0;
+        crc2 = 0;
+        end = p + blk;
+        do
+        {
+            crc = crc_hw_x(crc, crc_load64(p), c);
+            crc1 = crc_hw_x(crc1, crc_load64(p + blk), c);
+            crc2 = crc_hw_x(crc2, crc_load64(p + 2 * blk), c);
+            p += 8;
+        } while (p < end);
+
+        crc = crc_shift(Z, crc) ^ crc1;
+        crc = crc_shift(Z, crc) ^ crc2;
+        p += 2 * blk;
+        *plen -= 3 * blk;
+    }
+    *pp = p;
+
+    return crc;
+}
+
+static inline __attribute__((always_inline)) CRC_TARGET
+uint32_t crc_hw(uint32_t crc, const uint8_t *p, size_t len, int c)
+{
+    while (len && ((uintptr_t)p & 7U))
+    {
+        crc = crc_hw_b(crc, *p++, c);
+        len--;
+    }
+
+    crc = crc_hw_3way(c ? s_au32Long32c : s_au32Long32, crc, &p, &len, CRC_LONG, c);
+    crc = crc_hw_3way(c ? s_au32Short32c : s_au32Short32, crc, &p, &len, CRC_SHORT, c);
+
+    for (; len >= 8; len -= 8, p += 8)
+        crc = crc_hw_x(crc, crc_load64(p), c);
+    if (len & 4)
+    {
+        crc = crc_hw_w(crc, (uint32_t)crc_load64(p), c);
+        p += 4;
+    }
+    if (len & 2)
+    {
+        crc = crc_hw_h(crc, p[0] | ((uint32_t)p[1] << 8), c);
+        p += 2;
+    }
+    if (len & 1)
+        crc = crc_hw_b(crc, *p, c);
+
+    return crc;
+}
+
+static CRC_TARGET uint32_t crc32_hw(uint32_t crc, const uint8_t *p, size_t len)
+{
+    return crc_hw(crc, p, len, 0);
+}
+
+static CRC_TARGET uint32_t crc32c_hw(uint32_t crc, const uint8_t *p, size_t len)
+{
+    return crc_hw(crc, p, len, 1);
+}
+
+#else
+static int crc_hw_present(void)
+{
+    return 0;
+}
+#endif /* NU_CRC_HW */
+
+static int crc_use_hw(void)
+{
+    if (s_i32Hw < 0)
+        s_i32Hw = crc_hw_present();
+    return s_i32Hw;
+}
+
+/** @endcond HIDDEN_SYMBOLS */
+
+
+/**
+ *  @brief  Select the CRC32 instructions or the tables for CRC32 and CRC32C
+ *  @param[in]  enable  Non-zero for the instructions. Ignored when the CPU
+ *                      has none. They are used by default.
+ */
+void nu_crc_set_hw(int enable)
+{
+    s_i32Hw = crc_hw_present() && enable;
+}
+
+/**
+ *  @brief  Implementation in use for CRC32 and CRC32C
+ *  @return 1 if the CRC32 instructions are used, 0 for the tables
+ */
+int nu_crc_hw_enabled(void)
+{
+    return crc_use_hw();
+}
+
+/**
+ *  @brief      CRC-32 as used by Ethernet, zlib and PNG
+ *  @param[in]  crc     0, or the result of the previous call
+ *  @param[in]  data    Data
+ *  @param[in]  len     Bytes
+ *  @return     CRC of the data so far
+ */
+uint32_t nu_crc32(uint32_t crc, const void *data, size_t len)
+{
+#if NU_CRC_HW
+    if (crc_use_hw())
+    {
+        crc_tables(CRC_TAB_SHIFT32);
+        return ~crc32_hw(~crc, (const uint8_t *)data, len);
+    }
+#endif
+    crc_tables(CRC_TAB_CRC32);
+    return ~crc32_sw(s_au32Crc32, ~crc, (const uint8_t *)data, len);
+}
+
+/**
+ *  @brief      CRC-32C (Castagnoli) as used by iSCSI, SCTP and ext4
+ *  @param[in]  crc     0, or the result of the previous call
+ *  @param[in]  data    Data
+ *  @param[in]  len     Bytes
+ *  @return     CRC of the data so far
+ */
+uint32_t nu_crc32c(uint32_t crc, const void *data, size_t len)
+{
+#if NU_CRC_HW
+    if (crc_use_hw())
+    {
+        crc_tables(CRC_TAB_SHIFT32C);
+        return ~crc32c_hw(~crc, (const uint8_t *)data, len);
+    }
+#endif
+    crc_tables(CRC_TAB_CRC32C);
+    return ~crc32_sw(s_au32Crc32c, ~crc, (const uint8_t *)data, len);
+}
+
+/**
+ *  @brief      CRC-16 with polynomial 0x8005, bit reflected
+ *  @param[in]  crc     CRC16_MODBUS_INIT for Modbus, or the result of the previous call
+ *  @param[in]  data    Data
+ *  @param[in]  len     Bytes
+ *  @return     CRC of the data so far; Modbus sends the low byte first
+ */
+uint16_t nu_crc16(uint16_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint16_t (*T)[256] = s_au16Crc16;
+    uint32_t c = crc;
+
+    crc_tables(CRC_TAB_CRC16);
+
+    for (; len >= 8; len -= 8, p += 8)
+    {
+        c ^= p[0] | ((uint32_t)p[1] << 8);
+        c = T[7][c & 0xFFU] ^ T[6][c >> 8] ^ T[5][p[2]] ^ T[4][p[3]] ^
+            T[3][p[4]] ^ T[2][p[5]] ^ T[1][p[6]] ^ T[0][p[7]];
+    }
+    while (len--)
+        c = (c >> 8) ^ T[0][(c ^ *p++) & 0xFFU];
+
+    return (uint16_t)c;
+}
+
+/**
+ *  @brief      CRC-16 with polynomial 0x1021, not reflected
+ *  @param[in]  crc     CRC16_CCITT_INIT, 0 for XMODEM, or the result of the previous call
+ *  @param[in]  data    Data
+ *  @param[in]  len     Bytes
+ *  @return     CRC of the data so far; sent high byte first
+ */
+uint16_t nu_crc16_ccitt(uint16_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint16_t (*T)[256] = s_au16Ccitt;
+    uint32_t c = crc;
+
+    crc_tables(CRC_TAB_CCITT);
+
+    for (; len >= 8; len -= 8, p += 8)
+    {
+        c ^= ((uint32_t)p[0] << 8) | p[1];
+        c = T[7][c >> 8] ^ T[6][c & 0xFFU] ^ T[5][p[2]] ^ T[4][p[3]] ^
+            T[3][p[4]] ^ T[2][p[5]] ^ T[1][p[6]] ^ T[0][p[7]];
+    }
+    while (len--)
+        c = ((c << 8) & 0xFFFFU) ^ T[0][(c >> 8) ^ *p++];
+
+    return (uint16_t)c;
+}
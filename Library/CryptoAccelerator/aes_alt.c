@@ -36,6 +36,7 @@
 #include <string.h>
 #include "NuMicro.h"
 #include "tsi_cmd.h"
+#include "ce_alt.h"
 
 
  /* Parameter validation macros based on platform_util.h */
@@ -51,32 +52,22 @@
 
 #define AES_BLOCK_SIZE  (16)
 
+#if (NU_AES_DMA_SIZE % AES_BLOCK_SIZE) || (NU_AES_DMA_SIZE == 0)
+#error "NU_AES_DMA_SIZE must be a multiple of 16"
+#endif
 
+/* AES DMA buffers
+ *
+ * Input and output are staged here NU_AES_DMA_SIZE bytes at a time, the
+ * key and IV are copied here for each session.
+ */
+__ALIGNED(32) static uint8_t  s_u8in[NU_AES_DMA_SIZE];
+__ALIGNED(32) static uint8_t  s_u8out[NU_AES_DMA_SIZE];
+__ALIGNED(32) static uint32_t s_aes_key[8];
+__ALIGNED(32) static uint32_t s_aes_iv[4];
 
-__ALIGNED(4) static uint8_t s_u8in[AES_BLOCK_SIZE];
-__ALIGNED(4) static uint8_t s_u8out[AES_BLOCK_SIZE];
-
-#if defined(MBEDTLS_CIPHER_MODE_CBC)
-__STATIC_INLINE uint32_t nu_get32_le(const uint8_t* pos)
-{
-	uint32_t val;
-
-	val = *pos++;
-	val += (*pos++ << 8);
-	val += (*pos++ << 16);
-	val += (*pos++ << 24);
-
-	return val;
-}
-
-__STATIC_INLINE void nu_set32_le(uint8_t* pos, uint32_t val)
-{
-	*pos++ = val & 0xFF;
-	*pos++ = (val >> 8) & 0xFF;
-	*pos++ = (val >> 16) & 0xFF;
-	*pos = (val >> 24) & 0xFF;
-}
-#endif
+/* Inputs shorter than this use the Crypto Extension */
+static size_t s_aes_tsi_min = NU_AES_TSI_MIN;
 
 
 /* Implementation that should never be optimized out by the compiler */
@@ -86,17 +77,24 @@ static void mbedtls_zeroize(void *v, size_t n)
 	while(n--) *p++ = 0;
 }
 
-/* AES DMA compatible backup buffer if user buffer doesn't meet requirements
- *
- * AES DMA buffer location requires to be:
- * (1) Word-aligned
- * (2) Located in 0x2xxxxxxx region. Check linker files to ensure global variables are placed in this region.
- *
- * AES DMA buffer size MAX_DMA_CHAIN_SIZE must be a multiple of 16-byte block size.
- * Its value is estimated to trade memory footprint off against performance.
- *
+void nu_aes_set_tsi_min(size_t bytes)
+{
+	s_aes_tsi_min = bytes;
+}
+
+/*
+ * Run len bytes on the Crypto Extension? The context has both key
+ * schedules whenever it has one.
  */
-#define MAX_DMA_CHAIN_SIZE (AES_BLOCK_SIZE*6)
+static int nu_aes_use_ce(const mbedtls_aes_context *ctx, size_t len)
+{
+	return (ctx->nr != 0 && len < s_aes_tsi_min);
+}
+
+static const uint32_t *nu_aes_ce_rk(const mbedtls_aes_context *ctx, int decrypt)
+{
+	return decrypt ? ctx->dk : ctx->rk;
+}
 
 void mbedtls_aes_init(mbedtls_aes_context *ctx)
 {
@@ -114,17 +112,13 @@ void mbedtls_aes_free(mbedtls_aes_context *ctx)
 }
 
 /*
- * AES key schedule (encryption)
+ * Keep the key for the TSI and expand it for the Crypto Extension. Both
+ * schedules are built: mbed TLS decrypts with contexts set up by
+ * mbedtls_aes_setkey_enc() too, e.g. in the cipher layer.
  */
-int mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key,
-						   unsigned int keybits)
+static int nu_aes_setkey(mbedtls_aes_context *ctx, const unsigned char *key,
+						 unsigned int keybits)
 {
-	unsigned int i;
-	uint8_t *pu8;
-
-	AES_VALIDATE_RET(ctx != NULL);
-	AES_VALIDATE_RET(key != NULL);
-
 	switch(keybits)
 	{
 	case 128:
@@ -143,74 +137,86 @@ int mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key,
 		return(MBEDTLS_ERR_AES_INVALID_KEY_LENGTH);
 	}
 
-	pu8 = (uint8_t *)&ctx->keys[0];
+	memcpy(ctx->keys, key, ctx->keySize);
 
-	for(i = 0; i < ctx->keySize; i++)
+	ctx->rk = ctx->buf;
+	ctx->nr = 0;
+	if(nu_ce_available() & NU_CE_AES)
 	{
-		pu8[i] = key[i];
+		nu_ce_aes_setkey(ctx->dk, key, keybits, 1);
+		ctx->nr = nu_ce_aes_setkey(ctx->buf, key, keybits, 0);
 	}
 
 	return(0);
 }
 
+/*
+ * AES key schedule (encryption)
+ */
+int mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key,
+						   unsigned int keybits)
+{
+	AES_VALIDATE_RET(ctx != NULL);
+	AES_VALIDATE_RET(key != NULL);
+
+	return nu_aes_setkey(ctx, key, keybits);
+}
+
 /*
  * AES key schedule (decryption)
  */
 int mbedtls_aes_setkey_dec(mbedtls_aes_context *ctx, const unsigned char *key,
 						   unsigned int keybits)
 {
-	int ret;
-
 	AES_VALIDATE_RET(ctx != NULL);
 	AES_VALIDATE_RET(key != NULL);
 
-	/* Also checks keybits */
-	if((ret = mbedtls_aes_setkey_enc(ctx, key, keybits)) != 0)
-		goto exit;
-
-exit:
-	return(ret);
+	return nu_aes_setkey(ctx, key, keybits);
 }
 
 /* Do AES encrypt/decrypt with H/W accelerator
  *
  * NOTE: As input/output buffer doesn't follow constraint of DMA buffer, static allocated
  *       DMA compatible buffer is used for DMA instead and this needs extra copy.
+ *       Inputs longer than NU_AES_DMA_SIZE are run through the same session in
+ *       pieces, the engine carries the chaining value across them.
  *
- * NOTE: dataSize requires to be:
- *       1) Multiple of block size 16
- *       2) <= MAX_DMA_CHAIN_SIZE
+ * NOTE: dataSize requires to be a multiple of block size 16. The caller
+ *       updates its IV.
  */
 static int __nvt_aes_crypt(mbedtls_aes_context *ctx,
+						   uint32_t opMode, uint32_t encDec,
+						   const unsigned char *iv,
 						   const unsigned char *input,
 						   unsigned char *output, size_t dataSize)
 {
-	int  ret, sid;
+	size_t  pos, xlen;
+	int     ret, sid = -1;
 
-	if(dataSize > AES_BLOCK_SIZE)
-		return -1;
+	ctx->opMode = opMode;
+	ctx->encDec = encDec;
 
-	memcpy(nc_ptr(s_u8in), input, dataSize);
+	memcpy(nc_ptr(s_aes_key), ctx->keys, ctx->keySize);
+	if(iv != NULL)
+		memcpy(nc_ptr(s_aes_iv), iv, AES_BLOCK_SIZE);
+	else
+		memset(nc_ptr(s_aes_iv), 0, AES_BLOCK_SIZE);
 
 	ret = TSI_Open_Session(C_CODE_AES, &sid);
 	if (ret != 0)
 		goto err_out;
 
-	dcache_invalidate_by_mva(ctx->iv, sizeof(ctx->iv));
-
-	ret = TSI_AES_Set_IV(sid, ptr_to_u32(ctx->iv));
+	ret = TSI_AES_Set_IV(sid, ptr_to_u32(s_aes_iv));
 	if (ret != 0)
 		goto err_out;
 
-	dcache_invalidate_by_mva(ctx->keys, ctx->keySize);
-
-	ret = TSI_AES_Set_Key(sid, ctx->keySizeOp, ptr_to_u32(ctx->keys));
+	ret = TSI_AES_Set_Key(sid, ctx->keySizeOp, ptr_to_u32(s_aes_key));
 	if (ret != 0)
 		goto err_out;
 
 	ret = TSI_AES_Set_Mode(sid,             /* sid        */
 						   1,               /* kinswap    */
-						   0,               /* koutswap   */
+						   (opMode == AES_MODE_ECB) ? 0 : 1, /* koutswap */
 						   1,               /* inswap     */
 						   1,               /* outswap    */
 						   0,               /* sm4en      */
@@ -223,43 +229,34 @@ static int __nvt_aes_crypt(mbedtls_aes_context *ctx,
 	if (ret != 0)
 		goto err_out;
 
-	ret = TSI_AES_Run(sid, 1, dataSize, ptr_to_u32(s_u8in), ptr_to_u32(s_u8out));
-	if (ret != 0)
-		goto err_out;
+	for(pos = 0; pos < dataSize; pos += xlen)
+	{
+		xlen = dataSize - pos;
+		if(xlen > NU_AES_DMA_SIZE)
+			xlen = NU_AES_DMA_SIZE;
 
-	TSI_Close_Session(C_CODE_AES, sid);
+		memcpy(nc_ptr(s_u8in), input + pos, xlen);
+
+		ret = TSI_AES_Run(sid, (pos + xlen >= dataSize) ? 1 : 0, xlen,
+						  ptr_to_u32(s_u8in), ptr_to_u32(s_u8out));
+		if (ret != 0)
+			goto err_out;
 
-	memcpy(output, nc_ptr(s_u8out), dataSize);
+		memcpy(output + pos, nc_ptr(s_u8out), xlen);
+	}
+
+	TSI_Close_Session(C_CODE_AES, sid);
 
+	mbedtls_zeroize(nc_ptr(s_aes_key), sizeof(s_aes_key));
 	return 0;
 
 err_out:
 	sysprintf("TSI AES ERROR!!! 0x%x\n", ret);
-	TSI_Close_Session(C_CODE_AES, sid);
+	if (sid >= 0)
+		TSI_Close_Session(C_CODE_AES, sid);
 	TSI_Print_Error(ret);
-	return -1;
-}
-
-/*
- * AES-ECB block encryption
- */
-void mbedtls_aes_encrypt(mbedtls_aes_context *ctx,
-						 const unsigned char input[AES_BLOCK_SIZE],
-						 unsigned char output[AES_BLOCK_SIZE])
-{
-	ctx->encDec = 1;
-	__nvt_aes_crypt(ctx, input, output, AES_BLOCK_SIZE);
-}
-
-/*
- * AES-ECB block decryption
- */
-void mbedtls_aes_decrypt(mbedtls_aes_context *ctx,
-						 const unsigned char input[AES_BLOCK_SIZE],
-						 unsigned char output[AES_BLOCK_SIZE])
-{
-	ctx->encDec = 0;
-	__nvt_aes_crypt(ctx, input, output, AES_BLOCK_SIZE);
+	mbedtls_zeroize(nc_ptr(s_aes_key), sizeof(s_aes_key));
+	return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
 }
 
 /*
@@ -270,6 +267,7 @@ int mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx,
 						  const unsigned char input[AES_BLOCK_SIZE],
 						  unsigned char output[AES_BLOCK_SIZE])
 {
+	int decrypt;
 
 	AES_VALIDATE_RET(ctx != NULL);
 	AES_VALIDATE_RET(input != NULL);
@@ -277,14 +275,35 @@ int mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx,
 	AES_VALIDATE_RET(mode == MBEDTLS_AES_ENCRYPT ||
 		mode == MBEDTLS_AES_DECRYPT);
 
-	ctx->opMode = AES_MODE_ECB;
-	if(mode == MBEDTLS_AES_ENCRYPT)
-		mbedtls_aes_encrypt(ctx, input, output);
-	else
-		mbedtls_aes_decrypt(ctx, input, output);
+	decrypt = (mode == MBEDTLS_AES_DECRYPT);
+
+	if(nu_aes_use_ce(ctx, AES_BLOCK_SIZE))
+	{
+		nu_ce_aes_ecb(nu_aes_ce_rk(ctx, decrypt), ctx->nr, decrypt, input, output);
+		return(0);
+	}
 
+	return __nvt_aes_crypt(ctx, AES_MODE_ECB, !decrypt, NULL, input, output, AES_BLOCK_SIZE);
+}
 
-	return(0);
+/*
+ * AES-ECB block encryption
+ */
+void mbedtls_aes_encrypt(mbedtls_aes_context *ctx,
+						 const unsigned char input[AES_BLOCK_SIZE],
+						 unsigned char output[AES_BLOCK_SIZE])
+{
+	mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, input, output);
+}
+
+/*
+ * AES-ECB block decryption
+ */
+void mbedtls_aes_decrypt(mbedtls_aes_context *ctx,
+						 const unsigned char input[AES_BLOCK_SIZE],
+						 unsigned char output[AES_BLOCK_SIZE])
+{
+	mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_DECRYPT, input, output);
 }
 
 #if defined(MBEDTLS_CIPHER_MODE_CBC)
@@ -298,77 +317,51 @@ int mbedtls_aes_crypt_cbc(mbedtls_aes_context *ctx,
 						  const unsigned char *input,
 						  unsigned char *output)
 {
-	int  ret, sid;
-
-	ctx->opMode = AES_MODE_CBC;
-
-	if (mode == MBEDTLS_AES_ENCRYPT)
-		ctx->encDec = 1;
-	else
-		ctx->encDec = 0;
-
-	/* Fetch IV byte data in little-endian */
-	ctx->iv[0] = nu_get32_le(iv);
-	ctx->iv[1] = nu_get32_le(iv + 4);
-	ctx->iv[2] = nu_get32_le(iv + 8);
-	ctx->iv[3] = nu_get32_le(iv + 12);
+	unsigned char temp[AES_BLOCK_SIZE];
+	int  ret, decrypt;
 
-	ret = TSI_Open_Session(C_CODE_AES, &sid);
-	if (ret != 0)
-		goto err_out;
+	AES_VALIDATE_RET(ctx != NULL);
+	AES_VALIDATE_RET(mode == MBEDTLS_AES_ENCRYPT ||
+		mode == MBEDTLS_AES_DECRYPT);
+	AES_VALIDATE_RET(iv != NULL);
+	AES_VALIDATE_RET(input != NULL);
+	AES_VALIDATE_RET(output != NULL);
 
-	dcache_invalidate_by_mva(ctx->iv, sizeof(ctx->iv));
+	if(len % AES_BLOCK_SIZE)
+		return(MBEDTLS_ERR_AES_INVALID_INPUT_LENGTH);
 
-	ret = TSI_AES_Set_IV(sid, ptr_to_u32(ctx->iv));
-	if (ret != 0)
-		goto err_out;
+	if(len == 0)
+		return(0);
 
-	dcache_invalidate_by_mva(ctx->keys, ctx->keySize);
-	ret = TSI_AES_Set_Key(sid, ctx->keySizeOp, ptr_to_u32(ctx->keys));
-	if (ret != 0)
-		goto err_out;
+	decrypt = (mode == MBEDTLS_AES_DECRYPT);
 
-	ret = TSI_AES_Set_Mode(sid,             /* sid        */
-						   1,               /* kinswap    */
-						   1,               /* koutswap   */
-						   1,               /* inswap     */
-						   1,               /* outswap    */
-						   0,               /* sm4en      */
-						   ctx->encDec,     /* encrypt    */
-						   ctx->opMode,     /* mode       */
-						   ctx->keySizeOp,  /* keysz      */
-						   0,               /* ks         */
-						   0                /* ks_num     */
-						   );
-	if (ret != 0)
-		goto err_out;
-
-	memcpy(nc_ptr(s_u8in), input, len);
+	if(nu_aes_use_ce(ctx, len))
+	{
+		nu_ce_aes_cbc(nu_aes_ce_rk(ctx, decrypt), ctx->nr, decrypt, len, iv, input, output);
+		return(0);
+	}
 
-	ret = TSI_AES_Run(sid, 1, len, ptr_to_u32(s_u8in), ptr_to_u32(s_u8out));
-	if (ret != 0)
-		goto err_out;
+	/* The next IV is the last ciphertext block, which output may overwrite */
+	if(decrypt)
+		memcpy(temp, input + len - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
 
-	TSI_Close_Session(C_CODE_AES, sid);
+	ret = __nvt_aes_crypt(ctx, AES_MODE_CBC, !decrypt, iv, input, output, len);
+	if(ret != 0)
+		return(ret);
 
-	if (mode == MBEDTLS_AES_ENCRYPT)
-		memcpy(iv, nc_ptr(s_u8out), 16);
+	if(decrypt)
+		memcpy(iv, temp, AES_BLOCK_SIZE);
 	else
-		memcpy(iv, input, 16);
+		memcpy(iv, output + len - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
 
-	memcpy(output, nc_ptr(s_u8out), len);
-
-	return 0;
-
-err_out:
-	sysprintf("TSI AES ERROR!!! 0x%x\n", ret);
-	TSI_Close_Session(C_CODE_AES, sid);
-	TSI_Print_Error(ret);
-	return -1;
+	return(0);
 }
 #endif /* MBEDTLS_CIPHER_MODE_CBC */
 
 #if defined(MBEDTLS_CIPHER_MODE_CFB)
+/*
+ * AES-CFB128 buffer encryption/decryption
+ */
 int mbedtls_aes_crypt_cfb128(mbedtls_aes_context *ctx,
 							 int mode,
 							 size_t length,
@@ -377,67 +370,85 @@ int mbedtls_aes_crypt_cfb128(mbedtls_aes_context *ctx,
 							 const unsigned char *input,
 							 unsigned char *output)
 {
-	int  ret, sid;
+	unsigned char temp[AES_BLOCK_SIZE];
+	int c;
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	size_t n;
 
-	ctx->opMode = AES_MODE_CFB;
-
-	if (mode == MBEDTLS_AES_ENCRYPT)
-		ctx->encDec = 1;
-	else
-		ctx->encDec = 0;
+	AES_VALIDATE_RET(ctx != NULL);
+	AES_VALIDATE_RET(mode == MBEDTLS_AES_ENCRYPT ||
+		mode == MBEDTLS_AES_DECRYPT);
+	AES_VALIDATE_RET(iv_off != NULL);
+	AES_VALIDATE_RET(iv != NULL);
+	AES_VALIDATE_RET(input != NULL);
+	AES_VALIDATE_RET(output != NULL);
 
-	/* Fetch IV byte data in little-endian */
-	ctx->iv[0] = nu_get32_le(iv);
-	ctx->iv[1] = nu_get32_le(iv + 4);
-	ctx->iv[2] = nu_get32_le(iv + 8);
-	ctx->iv[3] = nu_get32_le(iv + 12);
+	n = *iv_off;
 
-	ret = TSI_Open_Session(C_CODE_AES, &sid);
-	if (ret != 0)
-		goto err_out;
+	if(n > 15)
+		return(MBEDTLS_ERR_AES_BAD_INPUT_DATA);
 
-	dcache_invalidate_by_mva(ctx->iv, sizeof(ctx->iv));
+	/* Whole blocks from a block boundary go to the TSI in one session */
+	if(n == 0 && length != 0 && (length % AES_BLOCK_SIZE) == 0 &&
+	   !nu_aes_use_ce(ctx, length))
+	{
+		if(mode == MBEDTLS_AES_DECRYPT)
+			memcpy(temp, input + length - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
 
-	ret = TSI_AES_Set_IV(sid, ptr_to_u32(ctx->iv));
-	if (ret != 0)
-		goto err_out;
+		ret = __nvt_aes_crypt(ctx, AES_MODE_CFB, (mode == MBEDTLS_AES_ENCRYPT),
+							  iv, input, output, length);
+		if(ret != 0)
+			return(ret);
 
-	dcache_invalidate_by_mva(ctx->keys, ctx->keySize);
-	ret = TSI_AES_Set_Key(sid, ctx->keySizeOp, ptr_to_u32(ctx->keys));
-	if (ret != 0)
-		goto err_out;
+		/* The next IV is the last ciphertext block */
+		if(mode == MBEDTLS_AES_DECRYPT)
+			memcpy(iv, temp, AES_BLOCK_SIZE);
+		else
+			memcpy(iv, output + length - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
 
-	ret = TSI_AES_Set_Mode(sid,             /* sid        */
-						   1,               /* kinswap    */
-						   1,               /* koutswap   */
-						   1,               /* inswap     */
-						   1,               /* outswap    */
-						   0,               /* sm4en      */
-						   ctx->encDec,     /* encrypt    */
-						   ctx->opMode,     /* mode       */
-						   ctx->keySizeOp,  /* keysz      */
-						   0,               /* ks         */
-						   0                /* ks_num     */
-						   );
-	if (ret != 0)
-		goto err_out;
+		return(0);
+	}
 
-	memcpy(nc_ptr(s_u8in), input, length);
+	if(mode == MBEDTLS_AES_DECRYPT)
+	{
+		while(length--)
+		{
+			if(n == 0)
+			{
+				ret = mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, iv, iv);
+				if(ret != 0)
+					goto exit;
+			}
+
+			c = *input++;
+			*output++ = (unsigned char)(c ^ iv[n]);
+			iv[n] = (unsigned char) c;
+
+			n = (n + 1) & 0x0F;
+		}
+	}
+	else
+	{
+		while(length--)
+		{
+			if(n == 0)
+			{
+				ret = mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, iv, iv);
+				if(ret != 0)
+					goto exit;
+			}
 
-	ret = TSI_AES_Run(sid, 1, length, ptr_to_u32(s_u8in), ptr_to_u32(s_u8out));
-	if (ret != 0)
-		goto err_out;
+			iv[n] = *output++ = (unsigned char)(iv[n] ^ *input++);
 
-	memcpy(output, nc_ptr(s_u8out), length);
+			n = (n + 1) & 0x0F;
+		}
+	}
 
-	TSI_Close_Session(C_CODE_AES, sid);
-	return 0;
+	*iv_off = n;
+	ret = 0;
 
-err_out:
-	sysprintf("TSI AES ERROR!!! 0x%x\n", ret);
-	TSI_Close_Session(C_CODE_AES, sid);
-	TSI_Print_Error(ret);
-	return -1;
+exit:
+	return(ret);
 }
 
 
@@ -453,6 +464,7 @@ int mbedtls_aes_crypt_cfb8(mbedtls_aes_context *ctx,
 {
 	unsigned char c;
 	unsigned char ov[AES_BLOCK_SIZE + 1];
+	int ret;
 
 	AES_VALIDATE_RET(ctx != NULL);
 	AES_VALIDATE_RET(mode == MBEDTLS_AES_ENCRYPT ||
@@ -464,7 +476,9 @@ int mbedtls_aes_crypt_cfb8(mbedtls_aes_context *ctx,
 	while(length--)
 	{
 		memcpy(ov, iv, AES_BLOCK_SIZE);
-		mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, iv, iv);
+		ret = mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, iv, iv);
+		if(ret != 0)
+			return(ret);
 
 		if(mode == MBEDTLS_AES_DECRYPT)
 			ov[AES_BLOCK_SIZE] = *input;
@@ -493,7 +507,7 @@ int mbedtls_aes_crypt_ctr(mbedtls_aes_context *ctx,
 						  const unsigned char *input,
 						  unsigned char *output)
 {
-	int c, i;
+	int c, i, ret;
 	size_t n = *nc_off;
 
 	AES_VALIDATE_RET(ctx != NULL);
@@ -507,7 +521,12 @@ int mbedtls_aes_crypt_ctr(mbedtls_aes_context *ctx,
 	{
 		if(n == 0)
 		{
-			mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, nonce_counter, stream_block);
+			ret = mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, nonce_counter, stream_block);
+			if(ret != 0)
+			{
+				*nc_off = n;
+				return(ret);
+			}
 
 			for(i = AES_BLOCK_SIZE; i > 0; i--)
 				if(++nonce_counter[i - 1] != 0)
@@ -527,7 +546,7 @@ int mbedtls_aes_crypt_ctr(mbedtls_aes_context *ctx,
 
 #if defined(MBEDTLS_CIPHER_MODE_OFB)
 /*
- * AES-CTR buffer encryption/decryption
+ * AES-OFB (Output Feedback Mode) buffer encryption/decryption
  */
 int mbedtls_aes_crypt_ofb(mbedtls_aes_context* ctx,
 						  size_t length,
@@ -536,87 +555,55 @@ int mbedtls_aes_crypt_ofb(mbedtls_aes_context* ctx,
 						  const unsigned char* input,
 						  unsigned char* output)
 {
-	int  ret, sid;
-
-	if(length == 0)
-	{
-		/* Just do nothing */
-		return (0);
-	}
+	unsigned char temp[AES_BLOCK_SIZE];
+	int ret = 0;
+	size_t n, i;
 
-	if((ctx == NULL) || (iv == NULL) || (input == NULL) || (output == NULL))
-	{
-		return MBEDTLS_ERR_AES_INVALID_INPUT_LENGTH;
-	}
+	AES_VALIDATE_RET(ctx != NULL);
+	AES_VALIDATE_RET(iv_off != NULL);
+	AES_VALIDATE_RET(iv != NULL);
+	AES_VALIDATE_RET(input != NULL);
+	AES_VALIDATE_RET(output != NULL);
 
-	if((iv_off != NULL) && (*iv_off != 0))
-	{
-		/* only support iv_off == 0 */
-		return MBEDTLS_ERR_AES_INVALID_INPUT_LENGTH;
-	}
+	n = *iv_off;
 
+	if(n > 15)
+		return(MBEDTLS_ERR_AES_BAD_INPUT_DATA);
 
-	if(*iv_off != 0)
+	/* Whole blocks from a block boundary go to the TSI in one session */
+	if(n == 0 && length != 0 && (length % AES_BLOCK_SIZE) == 0 &&
+	   !nu_aes_use_ce(ctx, length))
 	{
-		sysprintf("iv_off is not zero!\n");
-
-	}
-
-	ctx->opMode = AES_MODE_OFB;
-	ctx->encDec = 1;
-
-	/* Fetch IV byte data in little-endian */
-	ctx->iv[0] = nu_get32_le(iv);
-	ctx->iv[1] = nu_get32_le(iv + 4);
-	ctx->iv[2] = nu_get32_le(iv + 8);
-	ctx->iv[3] = nu_get32_le(iv + 12);
-
-	ret = TSI_Open_Session(C_CODE_AES, &sid);
-	if (ret != 0)
-		goto err_out;
+		memcpy(temp, input + length - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
 
-	dcache_invalidate_by_mva(ctx->iv, sizeof(ctx->iv));
-
-	ret = TSI_AES_Set_IV(sid, ptr_to_u32(ctx->iv));
-	if (ret != 0)
-		goto err_out;
+		ret = __nvt_aes_crypt(ctx, AES_MODE_OFB, 1, iv, input, output, length);
+		if(ret != 0)
+			return(ret);
 
-	dcache_invalidate_by_mva(ctx->keys, ctx->keySize);
-	ret = TSI_AES_Set_Key(sid, ctx->keySizeOp, ptr_to_u32(ctx->keys));
-	if (ret != 0)
-		goto err_out;
+		/* The next IV is the last key stream block */
+		for(i = 0; i < AES_BLOCK_SIZE; i++)
+			iv[i] = temp[i] ^ output[length - AES_BLOCK_SIZE + i];
 
-	ret = TSI_AES_Set_Mode(sid,             /* sid        */
-						   1,               /* kinswap    */
-						   1,               /* koutswap   */
-						   1,               /* inswap     */
-						   1,               /* outswap    */
-						   0,               /* sm4en      */
-						   ctx->encDec,     /* encrypt    */
-						   ctx->opMode,     /* mode       */
-						   ctx->keySizeOp,  /* keysz      */
-						   0,               /* ks         */
-						   0                /* ks_num     */
-						   );
-	if (ret != 0)
-		goto err_out;
-
-	memcpy(nc_ptr(s_u8in), input, length);
+		return(0);
+	}
 
-	ret = TSI_AES_Run(sid, 1, length, ptr_to_u32(s_u8in), ptr_to_u32(s_u8out));
-	if (ret != 0)
-		goto err_out;
+	while(length--)
+	{
+		if(n == 0)
+		{
+			ret = mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, iv, iv);
+			if(ret != 0)
+				goto exit;
+		}
+		*output++ =  *input++ ^ iv[n];
 
-	memcpy(output, nc_ptr(s_u8out), length);
+		n = (n + 1) & 0x0F;
+	}
 
-	TSI_Close_Session(C_CODE_AES, sid);
-	return 0;
+	*iv_off = n;
 
-err_out:
-	sysprintf("TSI AES ERROR!!! 0x%x\n", ret);
-	TSI_Close_Session(C_CODE_AES, sid);
-	TSI_Print_Error(ret);
-	return -1;
+exit:
+	return(ret);
 }
 #endif /* MBEDTLS_CIPHER_MODE_OFB */
 
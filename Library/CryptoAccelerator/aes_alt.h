@@ -33,8 +33,31 @@
 extern "C" {
 #endif
 
+/*
+ * Inputs of this many bytes or more go to the TSI, shorter ones to the
+ * ARMv8 Crypto Extension when the CPU has it. nu_crypto_calibrate(),
+ * run by mbedtls_platform_setup(), replaces the default with a measured
+ * value.
+ */
+#ifndef NU_AES_TSI_MIN
+#define NU_AES_TSI_MIN      (1024)
+#endif
+
+/*
+ * Size of the AES DMA buffers. Longer inputs are run through one TSI
+ * session in pieces of this size. Must be a multiple of 16.
+ */
+#ifndef NU_AES_DMA_SIZE
+#define NU_AES_DMA_SIZE     (4096)
+#endif
+
 /**
  * \brief          AES context structure
+ *
+ * The TSI takes the raw key in keys. rk, nr and buf hold the Crypto
+ * Extension encryption key schedule and dk the decryption schedule, so
+ * either key setup runs both directions on the CPU. nr is 0 when there is
+ * no schedule.
  */
 typedef struct {
     uint32_t keySize;       /* Key size: 128/192/256 */
@@ -43,6 +66,7 @@ typedef struct {
     uint32_t opMode;        /* AES_MODE_ECB/CBC/CFB */
     uint32_t iv[4];         /* IV for next block cipher */
     uint32_t keys[8];       /* Cipher key */
+    uint32_t dk[60];        /* Crypto Extension decryption key schedule */
 
     int MBEDTLS_PRIVATE(nr);             /*!< The number of rounds. */
     uint32_t *MBEDTLS_PRIVATE(rk);       /*!< AES round keys. */
@@ -269,6 +293,14 @@ void mbedtls_aes_decrypt( mbedtls_aes_context *ctx,
                           const unsigned char input[16],
                           unsigned char output[16] );
 
+/**
+ * \brief          Set the size from which AES runs on the TSI.
+ *
+ * \param bytes    Shorter inputs use the Crypto Extension. 0 sends every
+ *                 input to the TSI, SIZE_MAX none that the CPU can do.
+ */
+void nu_aes_set_tsi_min( size_t bytes );
+
 #ifdef __cplusplus
 }
 #endif
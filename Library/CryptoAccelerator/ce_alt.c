@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+ * Copyright (C) 2023, Nuvoton Technology Corporation, All Rights Reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *  AES and SHA-256 on the ARMv8 Cryptography Extension
+ *
+ *  Round keys are kept as in aes.c, little-endian words in FIPS-197 order,
+ *  so that each round key loads straight into a vector. The decryption
+ *  schedule is the one of the equivalent inverse cipher.
+ */
+
+#include "common.h"
+
+#include "mbedtls/platform_util.h"
+
+#include <string.h>
+#include "ce_alt.h"
+
+#if defined(__aarch64__) && !defined(NU_CE_DISABLE)
+
+#if !defined(__ARM_FEATURE_CRYPTO)
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("crypto"))), apply_to = function)
+#define NU_CE_POP_TARGET
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target ("arch=armv8-a+crypto")
+#define NU_CE_POP_TARGET
+#endif
+#endif /* !__ARM_FEATURE_CRYPTO */
+
+#include <arm_neon.h>
+
+static int s_ce_caps = -1;
+
+int nu_ce_available(void)
+{
+	uint64_t isar0;
+	int caps = 0;
+
+	if(s_ce_caps >= 0)
+		return s_ce_caps;
+
+	__asm__ volatile("mrs %0, ID_AA64ISAR0_EL1" : "=r"(isar0));
+
+	if(((isar0 >> 4) & 0xF) != 0)
+		caps |= NU_CE_AES;
+	if(((isar0 >> 12) & 0xF) != 0)
+		caps |= NU_CE_SHA256;
+
+	s_ce_caps = caps;
+	return caps;
+}
+
+/*
+ * SubWord() of FIPS-197: AESE with a zero key is SubBytes(ShiftRows()),
+ * and ShiftRows() only moves bytes between the four identical columns.
+ */
+static uint32_t nu_ce_sub_word(uint32_t w)
+{
+	uint8x16_t x = vreinterpretq_u8_u32(vdupq_n_u32(w));
+
+	x = vaeseq_u8(x, vdupq_n_u8(0));
+	return vgetq_lane_u32(vreinterpretq_u32_u8(x), 0);
+}
+
+static const uint8_t nu_ce_rcon[10] =
+{
+	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36
+};
+
+int nu_ce_aes_setkey(uint32_t *rk, const unsigned char *key,
+					 unsigned int keybits, int decrypt)
+{
+	uint32_t ek[60];
+	int nk, nr, total, i;
+
+	switch(keybits)
+	{
+	case 128:
+		nk = 4;
+		break;
+	case 192:
+		nk = 6;
+		break;
+	case 256:
+		nk = 8;
+		break;
+	default:
+		return -1;
+	}
+	nr = nk + 6;
+	total = 4 * (nr + 1);
+
+	for(i = 0; i < nk; i++)
+		ek[i] = MBEDTLS_GET_UINT32_LE(key, 4 * i);
+
+	for(i = nk; i < total; i++)
+	{
+		uint32_t t = ek[i - 1];
+
+		if(i % nk == 0)
+			t = nu_ce_sub_word((t >> 8) | (t << 24)) ^ nu_ce_rcon[i / nk - 1];
+		else if(nk > 6 && i % nk == 4)
+			t = nu_ce_sub_word(t);
+		ek[i] = ek[i - nk] ^ t;
+	}
+
+	if(!decrypt)
+	{
+		memcpy(rk, ek, total * 4);
+	}
+	else
+	{
+		/* Reverse order, InvMixColumns() on all but the outer keys */
+		memcpy(rk, ek + 4 * nr, 16);
+		for(i = 1; i < nr; i++)
+			vst1q_u8((uint8_t *) (rk + 4 * i),
+					 vaesimcq_u8(vld1q_u8((const uint8_t *) (ek + 4 * (nr - i)))));
+		memcpy(rk + 4 * nr, ek, 16);
+	}
+
+	mbedtls_platform_zeroize(ek, sizeof(ek));
+	return nr;
+}
+
+static inline uint8x16_t nu_ce_aes_enc_block(uint8x16_t b, const uint8_t *rk, int nr)
+{
+	int i;
+
+	for(i = 0; i < nr - 1; i++, rk += 16)
+		b = vaesmcq_u8(vaeseq_u8(b, vld1q_u8(rk)));
+	b = vaeseq_u8(b, vld1q_u8(rk));
+	return veorq_u8(b, vld1q_u8(rk + 16));
+}
+
+static inline uint8x16_t nu_ce_aes_dec_block(uint8x16_t b, const uint8_t *rk, int nr)
+{
+	int i;
+
+	for(i = 0; i < nr - 1; i++, rk += 16)
+		b = vaesimcq_u8(vaesdq_u8(b, vld1q_u8(rk)));
+	b = vaesdq_u8(b, vld1q_u8(rk));
+	return veorq_u8(b, vld1q_u8(rk + 16));
+}
+
+void nu_ce_aes_ecb(const uint32_t *rk, int nr, int decrypt,
+				   const unsigned char input[16], unsigned char output[16])
+{
+	uint8x16_t b = vld1q_u8(input);
+
+	if(decrypt)
+		b = nu_ce_aes_dec_block(b, (const uint8_t *) rk, nr);
+	else
+		b = nu_ce_aes_enc_block(b, (const uint8_t *) rk, nr);
+	vst1q_u8(output, b);
+}
+
+void nu_ce_aes_cbc(const uint32_t *rk, int nr, int decrypt, size_t len,
+				   unsigned char iv[16], const unsigned char *input,
+				   unsigned char *output)
+{
+	uint8x16_t v = vld1q_u8(iv);
+	uint8x16_t b, c;
+
+	for(; len >= 16; len -= 16, input += 16, output += 16)
+	{
+		c = vld1q_u8(input);
+		if(decrypt)
+		{
+			b = veorq_u8(nu_ce_aes_dec_block(c, (const uint8_t *) rk, nr), v);
+			v = c;
+		}
+		else
+		{
+			b = nu_ce_aes_enc_block(veorq_u8(c, v), (const uint8_t *) rk, nr);
+			v = b;
+		}
+		vst1q_u8(output, b);
+	}
+	vst1q_u8(iv, v);
+}
+
+static const uint32_t nu_ce_sha256_k[64] =
+{
+	0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+	0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+	0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+	0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+	0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+	0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+	0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+	0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+	0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+	0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+	0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+	0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+	0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+	0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+	0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+	0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+/* Four rounds with message words w */
+#define NU_CE_SHA256_4R(w, t)                                   \
+	do                                                          \
+	{                                                           \
+		uint32x4_t wk = vaddq_u32((w), vld1q_u32(&nu_ce_sha256_k[t])); \
+		uint32x4_t abcd_prev = abcd;                            \
+		abcd = vsha256hq_u32(abcd_prev, efgh, wk);              \
+		efgh = vsha256h2q_u32(efgh, abcd_prev, wk);             \
+	} while(0)
+
+void nu_ce_sha256_blocks(uint32_t state[8], const unsigned char *data, size_t blocks)
+{
+	uint32x4_t abcd = vld1q_u32(&state[0]);
+	uint32x4_t efgh = vld1q_u32(&state[4]);
+	uint32x4_t abcd_orig, efgh_orig;
+	uint32x4_t s0, s1, s2, s3;
+	int t;
+
+	for(; blocks > 0; blocks--, data += 64)
+	{
+		abcd_orig = abcd;
+		efgh_orig = efgh;
+
+		/* Message words are big-endian */
+		s0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data)));
+		s1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+		s2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+		s3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+
+		NU_CE_SHA256_4R(s0, 0);
+		NU_CE_SHA256_4R(s1, 4);
+		NU_CE_SHA256_4R(s2, 8);
+		NU_CE_SHA256_4R(s3, 12);
+
+		for(t = 16; t < 64; t += 16)
+		{
+			s0 = vsha256su1q_u32(vsha256su0q_u32(s0, s1), s2, s3);
+			NU_CE_SHA256_4R(s0, t);
+			s1 = vsha256su1q_u32(vsha256su0q_u32(s1, s2), s3, s0);
+			NU_CE_SHA256_4R(s1, t + 4);
+			s2 = vsha256su1q_u32(vsha256su0q_u32(s2, s3), s0, s1);
+			NU_CE_SHA256_4R(s2, t + 8);
+			s3 = vsha256su1q_u32(vsha256su0q_u32(s3, s0), s1, s2);
+			NU_CE_SHA256_4R(s3, t + 12);
+		}
+
+		abcd = vaddq_u32(abcd, abcd_orig);
+		efgh = vaddq_u32(efgh, efgh_orig);
+	}
+
+	vst1q_u32(&state[0], abcd);
+	vst1q_u32(&state[4], efgh);
+}
+
+/*
+ * Hooks for a stock aes.c and sha256.c, see ce_alt.h
+ */
+#if defined(MBEDTLS_AES_C) && !defined(MBEDTLS_AES_ALT)
+#include "mbedtls/aes.h"
+
+#if defined(MBEDTLS_AES_SETKEY_ENC_ALT) || defined(MBEDTLS_AES_SETKEY_DEC_ALT)
+static int nu_ce_aes_setkey_ctx(mbedtls_aes_context *ctx, const unsigned char *key,
+								unsigned int keybits, int decrypt)
+{
+	int nr;
+
+	nr = nu_ce_aes_setkey(ctx->buf, key, keybits, decrypt);
+	if(nr < 0)
+		return MBEDTLS_ERR_AES_INVALID_KEY_LENGTH;
+
+	ctx->nr = nr;
+	ctx->rk = ctx->buf;
+	return 0;
+}
+#endif
+
+#if defined(MBEDTLS_AES_SETKEY_ENC_ALT)
+int mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key,
+						   unsigned int keybits)
+{
+	return nu_ce_aes_setkey_ctx(ctx, key, keybits, 0);
+}
+#endif
+
+#if defined(MBEDTLS_AES_SETKEY_DEC_ALT)
+int mbedtls_aes_setkey_dec(mbedtls_aes_context *ctx, const unsigned char *key,
+						   unsigned int keybits)
+{
+	return nu_ce_aes_setkey_ctx(ctx, key, keybits, 1);
+}
+#endif
+
+#if defined(MBEDTLS_AES_ENCRYPT_ALT)
+int mbedtls_internal_aes_encrypt(mbedtls_aes_context *ctx,
+								 const unsigned char input[16],
+								 unsigned char output[16])
+{
+	nu_ce_aes_ecb(ctx->rk, ctx->nr, 0, input, output);
+	return 0;
+}
+#endif
+
+#if defined(MBEDTLS_AES_DECRYPT_ALT)
+int mbedtls_internal_aes_decrypt(mbedtls_aes_context *ctx,
+								 const unsigned char input[16],
+								 unsigned char output[16])
+{
+	nu_ce_aes_ecb(ctx->rk, ctx->nr, 1, input, output);
+	return 0;
+}
+#endif
+
+#endif /* MBEDTLS_AES_C && !MBEDTLS_AES_ALT */
+
+#if defined(MBEDTLS_SHA256_C) && !defined(MBEDTLS_SHA256_ALT) && defined(MBEDTLS_SHA256_PROCESS_ALT)
+#include "mbedtls/sha256.h"
+
+int mbedtls_internal_sha256_process(mbedtls_sha256_context *ctx,
+									const unsigned char data[64])
+{
+	nu_ce_sha256_blocks(ctx->state, data, 1);
+	return 0;
+}
+#endif
+
+#if defined(NU_CE_POP_TARGET)
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
+
+#else /* __aarch64__ && !NU_CE_DISABLE */
+
+int nu_ce_available(void)
+{
+	return 0;
+}
+
+/* Never called while nu_ce_available() is 0 */
+int nu_ce_aes_setkey(uint32_t *rk, const unsigned char *key,
+					 unsigned int keybits, int decrypt)
+{
+	return -1;
+}
+
+void nu_ce_aes_ecb(const uint32_t *rk, int nr, int decrypt,
+				   const unsigned char input[16], unsigned char output[16])
+{
+}
+
+void nu_ce_aes_cbc(const uint32_t *rk, int nr, int decrypt, size_t len,
+				   unsigned char iv[16], const unsigned char *input,
+				   unsigned char *output)
+{
+}
+
+void nu_ce_sha256_blocks(uint32_t state[8], const unsigned char *data, size_t blocks)
+{
+}
+
+#endif /* __aarch64__ && !NU_CE_DISABLE */
@@ -0,0 +1,97 @@
+/**
+ * \file ce_alt.h
+ *
+ * \brief AES and SHA-256 on the ARMv8 Cryptography Extension
+ *
+ *  Copyright (c) 2023 Nuvoton Technology Corp. All rights reserved.
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Every TSI command is a round trip through the Wormhole mailbox, which
+ *  costs more than the Cortex-A35 needs for a few AES blocks or SHA-256
+ *  blocks with the crypto instructions. aes_alt.c and sha256_alt.c use the
+ *  functions below for inputs shorter than a threshold and the TSI for the
+ *  rest; nu_crypto_calibrate() measures the thresholds.
+ *
+ *  Support is probed at run time from ID_AA64ISAR0_EL1. Define
+ *  NU_CE_DISABLE to build without it.
+ *
+ *  ce_alt.c needs nothing from the BSP. It can be built into a stock mbed
+ *  TLS with MBEDTLS_AES_SETKEY_ENC_ALT, MBEDTLS_AES_SETKEY_DEC_ALT,
+ *  MBEDTLS_AES_ENCRYPT_ALT, MBEDTLS_AES_DECRYPT_ALT and
+ *  MBEDTLS_SHA256_PROCESS_ALT, in place of MBEDTLS_AES_ALT and
+ *  MBEDTLS_SHA256_ALT, to run the mbed TLS AES and SHA-256 self-tests on
+ *  it, e.g. under qemu-aarch64 -cpu max, as test/Makefile does. That
+ *  build has no software fallback and needs the extension.
+ */
+
+#ifndef MBEDTLS_CE_ALT_H
+#define MBEDTLS_CE_ALT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* nu_ce_available() flags */
+#define NU_CE_AES               0x1     /*!< AESE/AESD/AESMC/AESIMC */
+#define NU_CE_SHA256            0x2     /*!< SHA256H/SHA256H2/SHA256SU0/SHA256SU1 */
+
+/**
+ * \brief          Crypto instructions of this CPU.
+ *
+ * \return         NU_CE_AES and NU_CE_SHA256 flags
+ */
+int nu_ce_available(void);
+
+/**
+ * \brief          Expand an AES key.
+ *
+ * \param rk       Receives 4 * (rounds + 1) round key words, at most 60
+ * \param key      AES key
+ * \param keybits  128, 192 or 256
+ * \param decrypt  Nonzero for the decryption schedule
+ *
+ * \return         Number of rounds, or -1 for a bad key length.
+ */
+int nu_ce_aes_setkey(uint32_t *rk, const unsigned char *key,
+					 unsigned int keybits, int decrypt);
+
+/**
+ * \brief          Encrypt or decrypt one block with a schedule of the
+ *                 same direction.
+ */
+void nu_ce_aes_ecb(const uint32_t *rk, int nr, int decrypt,
+				   const unsigned char input[16], unsigned char output[16]);
+
+/**
+ * \brief          AES-CBC over len bytes, a multiple of 16. iv is updated
+ *                 for the next call. input and output may be the same.
+ */
+void nu_ce_aes_cbc(const uint32_t *rk, int nr, int decrypt, size_t len,
+				   unsigned char iv[16], const unsigned char *input,
+				   unsigned char *output);
+
+/**
+ * \brief          Run the SHA-256 compression on blocks 64-byte blocks.
+ */
+void nu_ce_sha256_blocks(uint32_t state[8], const unsigned char *data, size_t blocks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ce_alt.h */
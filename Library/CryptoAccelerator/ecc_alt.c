@@ -0,0 +1,668 @@
+/*
+ * Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+ * Copyright (C) 2023, Nuvoton Technology Corporation, All Rights Reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *  ECDSA (SEC1 4.1.3/4.1.4) and ECDH (SEC1 3.3.1) with TSI ECC
+ *
+ *  Curves listed in platform_alt.c curve_map_tbl run on the TSI. Other
+ *  curves, e.g. Curve25519, and TSI failures fall back to the software
+ *  algorithms of ecdsa.c and ecdh.c built on the ECP module.
+ *
+ *  Operands and results go through DMA buffers shared by all contexts, and
+ *  TSI_Set_Lock() only covers one command and its ack. These ALTs are
+ *  therefore single-task: the caller must keep all ECDSA/ECDH operations
+ *  in one task or serialize each call as a whole.
+ */
+
+#include "common.h"
+
+#include "mbedtls/platform.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/error.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/ecdh.h"
+
+#if defined(MBEDTLS_ECP_C)
+#if defined(MBEDTLS_ECDSA_SIGN_ALT) || defined(MBEDTLS_ECDSA_VERIFY_ALT) || \
+	defined(MBEDTLS_ECDSA_GENKEY_ALT) || defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT) || \
+	defined(MBEDTLS_ECDH_COMPUTE_SHARED_ALT)
+
+#include <string.h>
+#include "NuMicro.h"
+#include "tsi_cmd.h"
+
+
+/* Parameter validation macros based on platform_util.h */
+#define ECC_VALIDATE_RET( cond )    \
+	MBEDTLS_INTERNAL_VALIDATE_RET( cond, MBEDTLS_ERR_ECP_BAD_INPUT_DATA )
+
+/*
+ * TSI ECC operands are hex strings, one per NU_ECC_SLOT bytes of the
+ * parameter block and of the output block.
+ */
+#define NU_ECC_SLOT     (576)
+
+__ALIGNED(32) static char s_ecc_param[NU_ECC_SLOT * 5];
+__ALIGNED(32) static char s_ecc_out[NU_ECC_SLOT * 2];
+
+
+/* Implementation that should never be optimized out by the compiler */
+static void mbedtls_zeroize(void *v, size_t n)
+{
+	volatile unsigned char *p = (unsigned char*)v;
+	while(n--) *p++ = 0;
+}
+
+/*
+ * TSI curve ID of grp, or CURVE_UNDEF if grp has to stay in software
+ */
+static E_ECC_CURVE nu_ecc_curve(const mbedtls_ecp_group *grp)
+{
+	int echar;
+
+	if(grp->N.p == NULL)
+		return CURVE_UNDEF;
+
+	return MbedTLS_ALT_get_curve((mbedtls_ecp_group *)grp, &echar);
+}
+
+static int nu_ecc_put(char *slot, const mbedtls_mpi *X)
+{
+	size_t olen;
+
+	return mbedtls_mpi_write_string(X, 16, slot, NU_ECC_SLOT, &olen);
+}
+
+static int nu_ecc_get(mbedtls_mpi *X, const char *slot)
+{
+	return mbedtls_mpi_read_string(X, 16, slot);
+}
+
+static int nu_ecc_error(const char *op, int ret)
+{
+	sysprintf("TSI ECC %s ERROR!!! 0x%x\n", op, ret);
+	TSI_Print_Error(ret);
+	return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+}
+
+#if defined(MBEDTLS_ECDSA_SIGN_ALT) || defined(MBEDTLS_ECDSA_VERIFY_ALT)
+/*
+ * Derive a suitable integer for group grp from a buffer of length len
+ * SEC1 4.1.3 step 5 aka SEC1 4.1.4 step 3
+ */
+static int derive_mpi(const mbedtls_ecp_group *grp, mbedtls_mpi *x,
+					  const unsigned char *buf, size_t blen)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	size_t n_size = (grp->nbits + 7) / 8;
+	size_t use_size = blen > n_size ? n_size : blen;
+
+	MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(x, buf, use_size));
+	if(use_size * 8 > grp->nbits)
+		MBEDTLS_MPI_CHK(mbedtls_mpi_shift_r(x, use_size * 8 - grp->nbits));
+
+	/* While at it, reduce modulo N */
+	if(mbedtls_mpi_cmp_mpi(x, &grp->N) >= 0)
+		MBEDTLS_MPI_CHK(mbedtls_mpi_sub_mpi(x, x, &grp->N));
+
+cleanup:
+	return(ret);
+}
+#endif /* MBEDTLS_ECDSA_SIGN_ALT || MBEDTLS_ECDSA_VERIFY_ALT */
+
+#if defined(MBEDTLS_ECDSA_GENKEY_ALT) || defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT)
+/*
+ * Generate d with the caller's RNG and Q = d G on the TSI
+ */
+static int nu_ecc_gen_public(mbedtls_ecp_group *grp, E_ECC_CURVE curve,
+							 mbedtls_mpi *d, mbedtls_ecp_point *Q,
+							 int (*f_rng)(void *, unsigned char *, size_t),
+							 void *p_rng)
+{
+	int ret;
+	char *param = nc_ptr(s_ecc_param);
+	char *out = nc_ptr(s_ecc_out);
+
+	MBEDTLS_MPI_CHK(mbedtls_ecp_gen_privkey(grp, d, f_rng, p_rng));
+
+	memset(param, 0, NU_ECC_SLOT);
+	MBEDTLS_MPI_CHK(nu_ecc_put(param, d));
+	memset(out, 0, NU_ECC_SLOT * 2);
+
+	ret = TSI_ECC_GenPublicKey(curve,                     /* curve_id  */
+							   0,                         /* is_ecdh   */
+							   ECC_KEY_SEL_USER,          /* psel      */
+							   0,                         /* d_knum    */
+							   ptr_to_u32(s_ecc_param),   /* priv_key  */
+							   ptr_to_u32(s_ecc_out)      /* pub_key   */
+							   );
+	if(ret != 0)
+	{
+		ret = nu_ecc_error("key generation", ret);
+		goto cleanup;
+	}
+
+	MBEDTLS_MPI_CHK(nu_ecc_get(&Q->X, out));
+	MBEDTLS_MPI_CHK(nu_ecc_get(&Q->Y, out + NU_ECC_SLOT));
+	MBEDTLS_MPI_CHK(mbedtls_mpi_lset(&Q->Z, 1));
+
+cleanup:
+	mbedtls_zeroize(param, NU_ECC_SLOT);
+	return(ret);
+}
+#endif /* MBEDTLS_ECDSA_GENKEY_ALT || MBEDTLS_ECDH_GEN_PUBLIC_ALT */
+
+
+#if defined(MBEDTLS_ECDSA_SIGN_ALT)
+int mbedtls_ecdsa_can_do(mbedtls_ecp_group_id gid)
+{
+	switch(gid)
+	{
+#ifdef MBEDTLS_ECP_DP_CURVE25519_ENABLED
+	case MBEDTLS_ECP_DP_CURVE25519: return 0;
+#endif
+#ifdef MBEDTLS_ECP_DP_CURVE448_ENABLED
+	case MBEDTLS_ECP_DP_CURVE448: return 0;
+#endif
+	default: return 1;
+	}
+}
+
+/*
+ * ECDSA signature on the TSI.
+ *
+ * The ephemeral key k is drawn from f_rng and passed in the parameter block
+ * (rsel = 0, as in the TSI_ECC_SignVerify sample), so that deterministic
+ * ECDSA, which passes its HMAC-DRBG here, stays deterministic.
+ */
+static int nu_ecdsa_sign(mbedtls_ecp_group *grp, E_ECC_CURVE curve,
+						 mbedtls_mpi *r, mbedtls_mpi *s,
+						 const mbedtls_mpi *d, const unsigned char *buf, size_t blen,
+						 int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+	int ret, sign_tries = 0;
+	mbedtls_mpi k, e;
+	char *param = nc_ptr(s_ecc_param);
+	char *sig = nc_ptr(s_ecc_out);
+
+	mbedtls_mpi_init(&k);
+	mbedtls_mpi_init(&e);
+
+	MBEDTLS_MPI_CHK(derive_mpi(grp, &e, buf, blen));
+
+	do
+	{
+		if(sign_tries++ > 10)
+		{
+			ret = MBEDTLS_ERR_ECP_RANDOM_FAILED;
+			goto cleanup;
+		}
+
+		MBEDTLS_MPI_CHK(mbedtls_ecp_gen_privkey(grp, &k, f_rng, p_rng));
+
+		memset(param, 0, NU_ECC_SLOT * 3);
+		MBEDTLS_MPI_CHK(nu_ecc_put(param, &e));
+		MBEDTLS_MPI_CHK(nu_ecc_put(param + NU_ECC_SLOT, d));
+		MBEDTLS_MPI_CHK(nu_ecc_put(param + NU_ECC_SLOT * 2, &k));
+		memset(sig, 0, NU_ECC_SLOT * 2);
+
+		ret = TSI_ECC_GenSignature(curve,                     /* curve_id   */
+								   0,                         /* rsel       */
+								   ECC_KEY_SEL_USER,          /* psel       */
+								   0,                         /* d_knum     */
+								   ptr_to_u32(s_ecc_param),   /* param_addr */
+								   ptr_to_u32(s_ecc_out)      /* sig_addr   */
+								   );
+		if(ret != 0)
+		{
+			ret = nu_ecc_error("signature generation", ret);
+			goto cleanup;
+		}
+
+		MBEDTLS_MPI_CHK(nu_ecc_get(r, sig));
+		MBEDTLS_MPI_CHK(nu_ecc_get(s, sig + NU_ECC_SLOT));
+	}
+	while(mbedtls_mpi_cmp_int(r, 0) == 0 || mbedtls_mpi_cmp_int(s, 0) == 0);
+
+cleanup:
+	mbedtls_zeroize(param, NU_ECC_SLOT * 3);
+	mbedtls_mpi_free(&k);
+	mbedtls_mpi_free(&e);
+	return(ret);
+}
+
+/*
+ * Software ECDSA signature, ecdsa.c without restart support
+ */
+static int ecdsa_sign_sw(mbedtls_ecp_group *grp, mbedtls_mpi *r, mbedtls_mpi *s,
+						 const mbedtls_mpi *d, const unsigned char *buf, size_t blen,
+						 int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+	int ret, key_tries, sign_tries;
+	mbedtls_ecp_point R;
+	mbedtls_mpi k, e, t;
+
+	mbedtls_ecp_point_init(&R);
+	mbedtls_mpi_init(&k); mbedtls_mpi_init(&e); mbedtls_mpi_init(&t);
+
+	sign_tries = 0;
+	do
+	{
+		if(sign_tries++ > 10)
+		{
+			ret = MBEDTLS_ERR_ECP_RANDOM_FAILED;
+			goto cleanup;
+		}
+
+		/*
+		 * Steps 1-3: generate a suitable ephemeral keypair
+		 * and set r = xR mod n
+		 */
+		key_tries = 0;
+		do
+		{
+			if(key_tries++ > 10)
+			{
+				ret = MBEDTLS_ERR_ECP_RANDOM_FAILED;
+				goto cleanup;
+			}
+
+			MBEDTLS_MPI_CHK(mbedtls_ecp_gen_privkey(grp, &k, f_rng, p_rng));
+			MBEDTLS_MPI_CHK(mbedtls_ecp_mul(grp, &R, &k, &grp->G, f_rng, p_rng));
+			MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(r, &R.X, &grp->N));
+		}
+		while(mbedtls_mpi_cmp_int(r, 0) == 0);
+
+		/*
+		 * Step 5: derive MPI from hashed message
+		 */
+		MBEDTLS_MPI_CHK(derive_mpi(grp, &e, buf, blen));
+
+		/*
+		 * Generate a random value to blind inv_mod in next step,
+		 * avoiding a potential timing leak.
+		 */
+		MBEDTLS_MPI_CHK(mbedtls_ecp_gen_privkey(grp, &t, f_rng, p_rng));
+
+		/*
+		 * Step 6: compute s = (e + r * d) / k = t (e + rd) / (kt) mod n
+		 */
+		MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(s, r, d));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_add_mpi(&e, &e, s));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&e, &e, &t));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&k, &k, &t));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&k, &k, &grp->N));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_inv_mod(s, &k, &grp->N));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(s, s, &e));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(s, s, &grp->N));
+	}
+	while(mbedtls_mpi_cmp_int(s, 0) == 0);
+
+cleanup:
+	mbedtls_ecp_point_free(&R);
+	mbedtls_mpi_free(&k); mbedtls_mpi_free(&e); mbedtls_mpi_free(&t);
+	return(ret);
+}
+
+/*
+ * Compute ECDSA signature of a hashed message
+ */
+int mbedtls_ecdsa_sign(mbedtls_ecp_group *grp, mbedtls_mpi *r, mbedtls_mpi *s,
+					   const mbedtls_mpi *d, const unsigned char *buf, size_t blen,
+					   int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+	int ret;
+	E_ECC_CURVE curve;
+
+	ECC_VALIDATE_RET(grp   != NULL);
+	ECC_VALIDATE_RET(r     != NULL);
+	ECC_VALIDATE_RET(s     != NULL);
+	ECC_VALIDATE_RET(d     != NULL);
+	ECC_VALIDATE_RET(f_rng != NULL);
+	ECC_VALIDATE_RET(buf   != NULL || blen == 0);
+
+	/* Fail cleanly on curves such as Curve25519 that can't be used for ECDSA */
+	if(! mbedtls_ecdsa_can_do(grp->id) || grp->N.p == NULL)
+		return(MBEDTLS_ERR_ECP_BAD_INPUT_DATA);
+
+	/* Make sure d is in range 1..n-1 */
+	if(mbedtls_mpi_cmp_int(d, 1) < 0 || mbedtls_mpi_cmp_mpi(d, &grp->N) >= 0)
+		return(MBEDTLS_ERR_ECP_INVALID_KEY);
+
+	curve = nu_ecc_curve(grp);
+	if(curve != CURVE_UNDEF)
+	{
+		ret = nu_ecdsa_sign(grp, curve, r, s, d, buf, blen, f_rng, p_rng);
+		if(ret != MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED)
+			return(ret);
+	}
+
+	return(ecdsa_sign_sw(grp, r, s, d, buf, blen, f_rng, p_rng));
+}
+#endif /* MBEDTLS_ECDSA_SIGN_ALT */
+
+
+#if defined(MBEDTLS_ECDSA_VERIFY_ALT)
+/*
+ * ECDSA verification on the TSI. r and s are already range checked.
+ */
+static int nu_ecdsa_verify(mbedtls_ecp_group *grp, E_ECC_CURVE curve,
+						   const unsigned char *buf, size_t blen,
+						   const mbedtls_ecp_point *Q,
+						   const mbedtls_mpi *r, const mbedtls_mpi *s)
+{
+	int ret;
+	mbedtls_mpi e;
+	char *param = nc_ptr(s_ecc_param);
+
+	mbedtls_mpi_init(&e);
+
+	MBEDTLS_MPI_CHK(derive_mpi(grp, &e, buf, blen));
+
+	memset(param, 0, NU_ECC_SLOT * 5);
+	MBEDTLS_MPI_CHK(nu_ecc_put(param, &e));
+	MBEDTLS_MPI_CHK(nu_ecc_put(param + NU_ECC_SLOT, &Q->X));
+	MBEDTLS_MPI_CHK(nu_ecc_put(param + NU_ECC_SLOT * 2, &Q->Y));
+	MBEDTLS_MPI_CHK(nu_ecc_put(param + NU_ECC_SLOT * 3, r));
+	MBEDTLS_MPI_CHK(nu_ecc_put(param + NU_ECC_SLOT * 4, s));
+
+	ret = TSI_ECC_VerifySignature(curve,                      /* curve_id   */
+								  ECC_KEY_SEL_USER,           /* psel       */
+								  0,                          /* x_knum     */
+								  0,                          /* y_knum     */
+								  ptr_to_u32(s_ecc_param)     /* param_addr */
+								  );
+	if(ret == ST_SIG_VERIFY_ERROR)
+		ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+	else if(ret != 0)
+		ret = nu_ecc_error("signature verification", ret);
+
+cleanup:
+	mbedtls_mpi_free(&e);
+	return(ret);
+}
+
+/*
+ * Software ECDSA verification, ecdsa.c without restart support
+ */
+static int ecdsa_verify_sw(mbedtls_ecp_group *grp,
+						   const unsigned char *buf, size_t blen,
+						   const mbedtls_ecp_point *Q,
+						   const mbedtls_mpi *r, const mbedtls_mpi *s)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	mbedtls_mpi e, s_inv, u1, u2;
+	mbedtls_ecp_point R;
+
+	mbedtls_ecp_point_init(&R);
+	mbedtls_mpi_init(&e); mbedtls_mpi_init(&s_inv);
+	mbedtls_mpi_init(&u1); mbedtls_mpi_init(&u2);
+
+	/*
+	 * Step 3: derive MPI from hashed message
+	 */
+	MBEDTLS_MPI_CHK(derive_mpi(grp, &e, buf, blen));
+
+	/*
+	 * Step 4: u1 = e / s mod n, u2 = r / s mod n
+	 */
+	MBEDTLS_MPI_CHK(mbedtls_mpi_inv_mod(&s_inv, s, &grp->N));
+
+	MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&u1, &e, &s_inv));
+	MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&u1, &u1, &grp->N));
+
+	MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&u2, r, &s_inv));
+	MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&u2, &u2, &grp->N));
+
+	/*
+	 * Step 5: R = u1 G + u2 Q
+	 */
+	MBEDTLS_MPI_CHK(mbedtls_ecp_muladd(grp, &R, &u1, &grp->G, &u2, Q));
+
+	if(mbedtls_ecp_is_zero(&R))
+	{
+		ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+		goto cleanup;
+	}
+
+	/*
+	 * Step 6: convert xR to an integer (no-op)
+	 * Step 7: reduce xR mod n (gives v)
+	 */
+	MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&R.X, &R.X, &grp->N));
+
+	/*
+	 * Step 8: check if v (that is, R.X) is equal to r
+	 */
+	if(mbedtls_mpi_cmp_mpi(&R.X, r) != 0)
+	{
+		ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+		goto cleanup;
+	}
+
+cleanup:
+	mbedtls_ecp_point_free(&R);
+	mbedtls_mpi_free(&e); mbedtls_mpi_free(&s_inv);
+	mbedtls_mpi_free(&u1); mbedtls_mpi_free(&u2);
+	return(ret);
+}
+
+/*
+ * Verify ECDSA signature of hashed message
+ */
+int mbedtls_ecdsa_verify(mbedtls_ecp_group *grp,
+						 const unsigned char *buf, size_t blen,
+						 const mbedtls_ecp_point *Q,
+						 const mbedtls_mpi *r,
+						 const mbedtls_mpi *s)
+{
+	int ret;
+	E_ECC_CURVE curve;
+
+	ECC_VALIDATE_RET(grp != NULL);
+	ECC_VALIDATE_RET(Q   != NULL);
+	ECC_VALIDATE_RET(r   != NULL);
+	ECC_VALIDATE_RET(s   != NULL);
+	ECC_VALIDATE_RET(buf != NULL || blen == 0);
+
+	/* Fail cleanly on curves such as Curve25519 that can't be used for ECDSA */
+	if(! mbedtls_ecdsa_can_do(grp->id) || grp->N.p == NULL)
+		return(MBEDTLS_ERR_ECP_BAD_INPUT_DATA);
+
+	/*
+	 * Step 1: make sure r and s are in range 1..n-1
+	 */
+	if(mbedtls_mpi_cmp_int(r, 1) < 0 || mbedtls_mpi_cmp_mpi(r, &grp->N) >= 0 ||
+	   mbedtls_mpi_cmp_int(s, 1) < 0 || mbedtls_mpi_cmp_mpi(s, &grp->N) >= 0)
+	{
+		return(MBEDTLS_ERR_ECP_VERIFY_FAILED);
+	}
+
+	curve = nu_ecc_curve(grp);
+	if(curve != CURVE_UNDEF)
+	{
+		/* The TSI takes Q as given; reject points off the curve first */
+		if((ret = mbedtls_ecp_check_pubkey(grp, Q)) != 0)
+			return(ret);
+
+		ret = nu_ecdsa_verify(grp, curve, buf, blen, Q, r, s);
+		if(ret != MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED)
+			return(ret);
+	}
+
+	return(ecdsa_verify_sw(grp, buf, blen, Q, r, s));
+}
+#endif /* MBEDTLS_ECDSA_VERIFY_ALT */
+
+
+#if defined(MBEDTLS_ECDSA_GENKEY_ALT)
+/*
+ * Generate key pair
+ */
+int mbedtls_ecdsa_genkey(mbedtls_ecdsa_context *ctx, mbedtls_ecp_group_id gid,
+						 int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+	int ret;
+	E_ECC_CURVE curve;
+
+	ECC_VALIDATE_RET(ctx   != NULL);
+	ECC_VALIDATE_RET(f_rng != NULL);
+
+	ret = mbedtls_ecp_group_load(&ctx->grp, gid);
+	if(ret != 0)
+		return(ret);
+
+	curve = nu_ecc_curve(&ctx->grp);
+	if(curve != CURVE_UNDEF)
+	{
+		ret = nu_ecc_gen_public(&ctx->grp, curve, &ctx->d, &ctx->Q, f_rng, p_rng);
+		if(ret != MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED)
+			return(ret);
+	}
+
+	return(mbedtls_ecp_gen_keypair(&ctx->grp, &ctx->d, &ctx->Q, f_rng, p_rng));
+}
+#endif /* MBEDTLS_ECDSA_GENKEY_ALT */
+
+
+#if defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT)
+/*
+ * Generate public key
+ */
+int mbedtls_ecdh_gen_public(mbedtls_ecp_group *grp, mbedtls_mpi *d, mbedtls_ecp_point *Q,
+							int (*f_rng)(void *, unsigned char *, size_t),
+							void *p_rng)
+{
+	int ret;
+	E_ECC_CURVE curve;
+
+	ECC_VALIDATE_RET(grp   != NULL);
+	ECC_VALIDATE_RET(d     != NULL);
+	ECC_VALIDATE_RET(Q     != NULL);
+	ECC_VALIDATE_RET(f_rng != NULL);
+
+	curve = nu_ecc_curve(grp);
+	if(curve != CURVE_UNDEF)
+	{
+		ret = nu_ecc_gen_public(grp, curve, d, Q, f_rng, p_rng);
+		if(ret != MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED)
+			return(ret);
+	}
+
+	MBEDTLS_MPI_CHK(mbedtls_ecp_gen_privkey(grp, d, f_rng, p_rng));
+	MBEDTLS_MPI_CHK(mbedtls_ecp_mul(grp, Q, d, &grp->G, f_rng, p_rng));
+
+cleanup:
+	return(ret);
+}
+#endif /* MBEDTLS_ECDH_GEN_PUBLIC_ALT */
+
+
+#if defined(MBEDTLS_ECDH_COMPUTE_SHARED_ALT)
+/*
+ * Shared secret z = x(d Q) on the TSI
+ */
+static int nu_ecdh_compute_shared(mbedtls_ecp_group *grp, E_ECC_CURVE curve,
+								  mbedtls_mpi *z,
+								  const mbedtls_ecp_point *Q, const mbedtls_mpi *d)
+{
+	int ret;
+	char *param = nc_ptr(s_ecc_param);
+	char *out = nc_ptr(s_ecc_out);
+
+	memset(param, 0, NU_ECC_SLOT * 3);
+	MBEDTLS_MPI_CHK(nu_ecc_put(param, &Q->X));
+	MBEDTLS_MPI_CHK(nu_ecc_put(param + NU_ECC_SLOT, &Q->Y));
+	MBEDTLS_MPI_CHK(nu_ecc_put(param + NU_ECC_SLOT * 2, d));
+	memset(out, 0, NU_ECC_SLOT * 2);
+
+	ret = TSI_ECC_Multiply(curve,                     /* curve_id   */
+						   0,                         /* type       */
+						   0x3,                       /* msel       */
+						   0x3,                       /* sps        */
+						   0,                         /* m_knum     */
+						   0,                         /* x_knum     */
+						   0,                         /* y_knum     */
+						   ptr_to_u32(s_ecc_param),   /* param_addr */
+						   ptr_to_u32(s_ecc_out)      /* dest_addr  */
+						   );
+	if(ret != 0)
+	{
+		ret = nu_ecc_error("point multiplication", ret);
+		goto cleanup;
+	}
+
+	MBEDTLS_MPI_CHK(nu_ecc_get(z, out));
+
+cleanup:
+	mbedtls_zeroize(param, NU_ECC_SLOT * 3);
+	mbedtls_zeroize(out, NU_ECC_SLOT * 2);
+	return(ret);
+}
+
+/*
+ * Compute shared secret (SEC1 3.3.1)
+ */
+int mbedtls_ecdh_compute_shared(mbedtls_ecp_group *grp, mbedtls_mpi *z,
+								const mbedtls_ecp_point *Q, const mbedtls_mpi *d,
+								int (*f_rng)(void *, unsigned char *, size_t),
+								void *p_rng)
+{
+	int ret;
+	E_ECC_CURVE curve;
+	mbedtls_ecp_point P;
+
+	ECC_VALIDATE_RET(grp != NULL);
+	ECC_VALIDATE_RET(Q   != NULL);
+	ECC_VALIDATE_RET(d   != NULL);
+	ECC_VALIDATE_RET(z   != NULL);
+
+	curve = nu_ecc_curve(grp);
+	if(curve != CURVE_UNDEF)
+	{
+		/* Same checks as mbedtls_ecp_mul(); the TSI takes Q and d as given */
+		if((ret = mbedtls_ecp_check_privkey(grp, d)) != 0 ||
+		   (ret = mbedtls_ecp_check_pubkey(grp, Q)) != 0)
+			return(ret);
+
+		ret = nu_ecdh_compute_shared(grp, curve, z, Q, d);
+		if(ret != MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED)
+			return(ret);
+	}
+
+	mbedtls_ecp_point_init(&P);
+
+	MBEDTLS_MPI_CHK(mbedtls_ecp_mul(grp, &P, d, Q, f_rng, p_rng));
+
+	if(mbedtls_ecp_is_zero(&P))
+	{
+		ret = MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+		goto cleanup;
+	}
+
+	MBEDTLS_MPI_CHK(mbedtls_mpi_copy(z, &P.X));
+
+cleanup:
+	mbedtls_ecp_point_free(&P);
+	return(ret);
+}
+#endif /* MBEDTLS_ECDH_COMPUTE_SHARED_ALT */
+
+#endif /* MBEDTLS_ECDSA_xxx_ALT || MBEDTLS_ECDH_xxx_ALT */
+#endif /* MBEDTLS_ECP_C */
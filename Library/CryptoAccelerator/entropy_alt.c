@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2023, Nuvoton Technology Corporation, All Rights Reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *  Hardware entropy source on the TSI TRNG
+ *
+ *  The TRNG output is DRBG conditioned inside the TSI and is buffered here
+ *  as is. The entropy module mixes it into its SHA-512 accumulator before
+ *  anything reaches a DRBG.
+ */
+
+#include "common.h"
+
+#include "mbedtls/entropy.h"
+#include "entropy_poll.h"
+
+#if defined(MBEDTLS_ENTROPY_C)
+#if defined(MBEDTLS_ENTROPY_HARDWARE_ALT)
+
+#include <string.h>
+#include "NuMicro.h"
+#include "tsi_cmd.h"
+#include "entropy_alt.h"
+
+#if (NU_TRNG_POOL_SIZE & (NU_TRNG_POOL_SIZE - 1)) || (NU_TRNG_POOL_SIZE % NU_TRNG_FILL_SIZE)
+#error "NU_TRNG_POOL_SIZE must be a power of two and a multiple of NU_TRNG_FILL_SIZE"
+#endif
+#if (NU_TRNG_FILL_SIZE % 32) || (NU_TRNG_FILL_SIZE == 0)
+#error "NU_TRNG_FILL_SIZE must be a multiple of 32"
+#endif
+
+#define NU_TRNG_MASK        (NU_TRNG_POOL_SIZE - 1)
+
+/* Written by the TSI and read through their non-cacheable alias */
+__ALIGNED(32) static uint8_t s_trng_pool[NU_TRNG_POOL_SIZE];
+__ALIGNED(32) static uint8_t s_trng_sync[NU_TRNG_FILL_SIZE];
+
+/*
+ * Free running ring indices. s_head is only written by the producer
+ * (nu_trng_pool_fill), s_tail only by the consumer (mbedtls_hardware_poll).
+ */
+static volatile uint32_t s_head;
+static volatile uint32_t s_tail;
+
+static int s_trng_ready;
+static NU_TRNG_POOL_STAT_T s_stat;
+
+
+/* Implementation that should never be optimized out by the compiler */
+static void mbedtls_zeroize(void *v, size_t n)
+{
+	volatile unsigned char *p = (unsigned char*)v;
+	while(n--) *p++ = 0;
+}
+
+/*
+ * Fetch len bytes, a multiple of 32, from the TRNG into dst. Returns 0 or
+ * the TSI status code.
+ */
+static int nu_trng_read(uint8_t *dst, size_t len)
+{
+	int ret;
+
+	if(!s_trng_ready)
+	{
+		/* Self-seeding from the TRNG noise source */
+		ret = TSI_TRNG_Init(0, 0);
+		if(ret != 0)
+			goto err;
+		s_trng_ready = 1;
+	}
+
+	ret = TSI_TRNG_Gen_Random(len / 4, ptr_to_u32(dst));
+	if(ret == 0)
+		return 0;
+
+err:
+	/* Reported through nu_trng_pool_stat(), the caller decides what to print */
+	s_stat.error_count++;
+	s_stat.last_error = (uint32_t)ret;
+	return ret;
+}
+
+int nu_trng_pool_fill(size_t max_bytes)
+{
+	uint8_t *pool = nc_ptr(s_trng_pool);
+	uint32_t head = s_head;
+	size_t added = 0;
+
+	if(max_bytes == 0)
+		max_bytes = NU_TRNG_POOL_SIZE;
+
+	/* NU_TRNG_POOL_SIZE is a multiple of the fill size, so a chunk never
+	 * wraps around the end of the ring */
+	while(added + NU_TRNG_FILL_SIZE <= max_bytes &&
+		  NU_TRNG_POOL_SIZE - (head - s_tail) >= NU_TRNG_FILL_SIZE)
+	{
+		if(nu_trng_read(pool + (head & NU_TRNG_MASK), NU_TRNG_FILL_SIZE) != 0)
+			return -1;
+
+		head += NU_TRNG_FILL_SIZE;
+		__DMB();
+		s_head = head;
+		added += NU_TRNG_FILL_SIZE;
+		s_stat.fill_bytes += NU_TRNG_FILL_SIZE;
+	}
+	return (int)added;
+}
+
+size_t nu_trng_pool_level(void)
+{
+	return s_head - s_tail;
+}
+
+void nu_trng_pool_stat(NU_TRNG_POOL_STAT_T *stat, int reset)
+{
+	*stat = s_stat;
+	stat->level = nu_trng_pool_level();
+	if(reset)
+		memset(&s_stat, 0, sizeof(s_stat));
+}
+
+/*
+ * Entropy poll callback for the entropy module
+ */
+int mbedtls_hardware_poll(void *data, unsigned char *output, size_t len, size_t *olen)
+{
+	uint8_t *pool = nc_ptr(s_trng_pool);
+	uint8_t *sync = nc_ptr(s_trng_sync);
+	uint32_t tail = s_tail;
+	size_t avail, n, off = 0;
+
+	(void)data;
+
+	/* Serve from the pool, at most up to the end of the ring per copy */
+	avail = s_head - tail;
+	__DMB();
+	while(off < len && avail > 0)
+	{
+		n = NU_TRNG_POOL_SIZE - (tail & NU_TRNG_MASK);
+		if(n > avail)
+			n = avail;
+		if(n > len - off)
+			n = len - off;
+
+		memcpy(output + off, pool + (tail & NU_TRNG_MASK), n);
+		/* Entropy handed out once must not be found in memory later */
+		mbedtls_zeroize(pool + (tail & NU_TRNG_MASK), n);
+
+		tail += n;
+		avail -= n;
+		off += n;
+	}
+	/* The zeroized bytes must land before the producer may refill them */
+	__DMB();
+	s_tail = tail;
+	s_stat.drain_bytes += off;
+
+	/* Pool ran dry: wait on the TRNG for the rest */
+	if(off < len)
+	{
+		s_stat.sync_count++;
+		while(off < len)
+		{
+			if(nu_trng_read(sync, NU_TRNG_FILL_SIZE) != 0)
+			{
+				mbedtls_zeroize(sync, NU_TRNG_FILL_SIZE);
+				*olen = off;
+				return MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+			}
+
+			n = len - off;
+			if(n > NU_TRNG_FILL_SIZE)
+				n = NU_TRNG_FILL_SIZE;
+			memcpy(output + off, sync, n);
+			off += n;
+			s_stat.sync_bytes += n;
+		}
+		mbedtls_zeroize(sync, NU_TRNG_FILL_SIZE);
+	}
+
+	*olen = off;
+	return 0;
+}
+
+#endif /* MBEDTLS_ENTROPY_HARDWARE_ALT */
+#endif /* MBEDTLS_ENTROPY_C */
@@ -0,0 +1,102 @@
+/**
+ * \file entropy_alt.h
+ *
+ * \brief TSI TRNG entropy source with a prefetch pool
+ *
+ *  Copyright (c) 2023 Nuvoton Technology Corp. All rights reserved.
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  mbedtls_hardware_poll() serves entropy from a pool of TSI TRNG output.
+ *  The pool is filled by nu_trng_pool_fill(), which the application calls
+ *  from a low priority task or an idle hook, so that seeding and reseeding
+ *  a DRBG during a handshake costs a memcpy instead of a TSI round trip.
+ *  When the pool runs dry mbedtls_hardware_poll() fetches the rest from the
+ *  TRNG directly.
+ *
+ *  The pool is a single-producer/single-consumer ring: one task fills, one
+ *  task polls. The TSI driver assumes a single caller, so an application
+ *  that fills from a task of its own must set a lock with TSI_Set_Lock()
+ *  before that task starts. lwIP_SSL_Client and lwIP_SSL_Server show both.
+ */
+
+#ifndef MBEDTLS_ENTROPY_ALT_H
+#define MBEDTLS_ENTROPY_ALT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Pool size in bytes. Must be a power of two and a multiple of
+ * NU_TRNG_FILL_SIZE.
+ */
+#ifndef NU_TRNG_POOL_SIZE
+#define NU_TRNG_POOL_SIZE       (4096)
+#endif
+
+/*
+ * Bytes requested from the TRNG per TSI command. Must be a multiple of 32
+ * to keep every request cache line aligned.
+ */
+#ifndef NU_TRNG_FILL_SIZE
+#define NU_TRNG_FILL_SIZE       (256)
+#endif
+
+/**
+ * \brief   Entropy pool counters. All byte counts wrap at 4 GB.
+ */
+typedef struct
+{
+	uint32_t fill_bytes;        /*!< Bytes written into the pool by nu_trng_pool_fill() */
+	uint32_t drain_bytes;       /*!< Bytes served from the pool */
+	uint32_t sync_bytes;        /*!< Bytes fetched by mbedtls_hardware_poll() while the pool was empty */
+	uint32_t sync_count;        /*!< mbedtls_hardware_poll() calls that waited on the TSI */
+	uint32_t error_count;       /*!< Failed TSI TRNG commands */
+	uint32_t last_error;        /*!< TSI status code of the last failed command */
+	uint32_t level;             /*!< Bytes currently in the pool */
+} NU_TRNG_POOL_STAT_T;
+
+/**
+ * \brief          Top up the entropy pool from the TSI TRNG.
+ *
+ * \param max_bytes  Upper bound of bytes to fetch in this call, rounded
+ *                 down to NU_TRNG_FILL_SIZE. 0 fills the pool completely.
+ *
+ * \return         Bytes added to the pool, or -1 if the TRNG failed. The
+ *                 TSI status is kept in NU_TRNG_POOL_STAT_T::last_error.
+ */
+int nu_trng_pool_fill(size_t max_bytes);
+
+/**
+ * \brief          Bytes currently in the entropy pool.
+ */
+size_t nu_trng_pool_level(void);
+
+/**
+ * \brief          Read the pool counters.
+ *
+ * \param stat     Receives a snapshot of the counters.
+ * \param reset    Nonzero to clear the counters after reading them.
+ */
+void nu_trng_pool_stat(NU_TRNG_POOL_STAT_T *stat, int reset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* entropy_alt.h */
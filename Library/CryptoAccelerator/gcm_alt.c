@@ -0,0 +1,792 @@
+/*
+ * Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+ * Copyright (C) 2023, Nuvoton Technology Corporation, All Rights Reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *  NIST SP800-38D compliant GCM implementation
+ *
+ *  http://csrc.nist.gov/publications/nistpubs/800-38D/SP-800-38D.pdf
+ *
+ *  One-shot operations with a 96-bit IV and an AES key are run on the TSI
+ *  AES-GCM engine. Everything else uses Shoup's method with 4-bit tables,
+ *  as in gcm.c.
+ */
+
+#include "common.h"
+
+#include "mbedtls/gcm.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/error.h"
+
+#if defined(MBEDTLS_GCM_C)
+#if defined(MBEDTLS_GCM_ALT)
+
+#include <string.h>
+#include "NuMicro.h"
+#include "tsi_cmd.h"
+
+
+/* Parameter validation macros based on platform_util.h */
+#define GCM_VALIDATE_RET( cond )    \
+	MBEDTLS_INTERNAL_VALIDATE_RET( cond, MBEDTLS_ERR_GCM_BAD_INPUT )
+#define GCM_VALIDATE( cond )        \
+	MBEDTLS_INTERNAL_VALIDATE( cond )
+
+#define NU_GCM_PAD16(x)     (((x) + 15) & ~15UL)
+
+#if defined(MBEDTLS_AES_ALT)
+#include "ce_alt.h"
+#define NU_GCM_SW_MIN()     ((nu_ce_available() & NU_CE_AES) ? NU_GCM_SW_THRESHOLD : 0)
+#else
+#define NU_GCM_SW_MIN()     (NU_GCM_SW_THRESHOLD)
+#endif
+
+#if (NU_GCM_DMA_SIZE % 16) || (NU_GCM_RUN_SIZE % 16) || (NU_GCM_RUN_SIZE == 0)
+#error "NU_GCM_DMA_SIZE and NU_GCM_RUN_SIZE must be multiples of 16"
+#endif
+
+/* TSI AES-GCM DMA buffers
+ *
+ * Source is laid out as J0 block | AAD padded to 16 | payload padded to 16.
+ * Destination receives the payload padded to 16, followed by the tag.
+ * All of them are written and read through their non-cacheable alias.
+ */
+__ALIGNED(32) static uint8_t  s_gcm_src[16 + NU_GCM_PAD16(NU_GCM_AAD_MAX) + NU_GCM_DMA_SIZE];
+__ALIGNED(32) static uint8_t  s_gcm_dst[NU_GCM_DMA_SIZE + 16];
+__ALIGNED(32) static uint32_t s_gcm_param[8];
+__ALIGNED(32) static uint32_t s_gcm_key[8];
+
+
+/* Implementation that should never be optimized out by the compiler */
+static void mbedtls_zeroize(void *v, size_t n)
+{
+	volatile unsigned char *p = (unsigned char*)v;
+	while(n--) *p++ = 0;
+}
+
+/*
+ * Initialize a context
+ */
+void mbedtls_gcm_init(mbedtls_gcm_context *ctx)
+{
+	GCM_VALIDATE(ctx != NULL);
+
+	memset(ctx, 0, sizeof(mbedtls_gcm_context));
+}
+
+/*
+ * Precompute small multiples of H, that is set
+ *      HH[i] || HL[i] = H times i,
+ * where i is seen as a field element as in [MGV], ie high-order bits
+ * correspond to low powers of P. The result is stored in the same way, that
+ * is the high-order bit of HH corresponds to P^0 and the low-order bit of HL
+ * corresponds to P^127.
+ */
+static int gcm_gen_table(mbedtls_gcm_context *ctx)
+{
+	int ret, i, j;
+	uint64_t hi, lo;
+	uint64_t vl, vh;
+	unsigned char h[16];
+	size_t olen = 0;
+
+	memset(h, 0, 16);
+	if((ret = mbedtls_cipher_update(&ctx->cipher_ctx, h, 16, h, &olen)) != 0)
+		return(ret);
+
+	/* pack h as two 64-bits ints, big-endian */
+	hi = MBEDTLS_GET_UINT32_BE(h,  0);
+	lo = MBEDTLS_GET_UINT32_BE(h,  4);
+	vh = (uint64_t) hi << 32 | lo;
+
+	hi = MBEDTLS_GET_UINT32_BE(h,  8);
+	lo = MBEDTLS_GET_UINT32_BE(h,  12);
+	vl = (uint64_t) hi << 32 | lo;
+
+	/* 8 = 1000 corresponds to 1 in GF(2^128) */
+	ctx->HL[8] = vl;
+	ctx->HH[8] = vh;
+
+	/* 0 corresponds to 0 in GF(2^128) */
+	ctx->HH[0] = 0;
+	ctx->HL[0] = 0;
+
+	for(i = 4; i > 0; i >>= 1)
+	{
+		uint32_t T = (vl & 1) * 0xe1000000U;
+		vl  = (vh << 63) | (vl >> 1);
+		vh  = (vh >> 1) ^ ((uint64_t) T << 32);
+
+		ctx->HL[i] = vl;
+		ctx->HH[i] = vh;
+	}
+
+	for(i = 2; i <= 8; i *= 2)
+	{
+		uint64_t *HiL = ctx->HL + i, *HiH = ctx->HH + i;
+		vh = *HiH;
+		vl = *HiL;
+		for(j = 1; j < i; j++)
+		{
+			HiH[j] = vh ^ ctx->HH[j];
+			HiL[j] = vl ^ ctx->HL[j];
+		}
+	}
+
+	mbedtls_zeroize(h, sizeof(h));
+	return(0);
+}
+
+int mbedtls_gcm_setkey(mbedtls_gcm_context *ctx,
+					   mbedtls_cipher_id_t cipher,
+					   const unsigned char *key,
+					   unsigned int keybits)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	const mbedtls_cipher_info_t *cipher_info;
+
+	GCM_VALIDATE_RET(ctx != NULL);
+	GCM_VALIDATE_RET(key != NULL);
+	GCM_VALIDATE_RET(keybits == 128 || keybits == 192 || keybits == 256);
+
+	cipher_info = mbedtls_cipher_info_from_values(cipher, keybits,
+												  MBEDTLS_MODE_ECB);
+	if(cipher_info == NULL)
+		return(MBEDTLS_ERR_GCM_BAD_INPUT);
+
+	if(cipher_info->block_size != 16)
+		return(MBEDTLS_ERR_GCM_BAD_INPUT);
+
+	mbedtls_cipher_free(&ctx->cipher_ctx);
+
+	if((ret = mbedtls_cipher_setup(&ctx->cipher_ctx, cipher_info)) != 0)
+		return(ret);
+
+	if((ret = mbedtls_cipher_setkey(&ctx->cipher_ctx, key, keybits,
+									MBEDTLS_ENCRYPT)) != 0)
+	{
+		return(ret);
+	}
+
+	if((ret = gcm_gen_table(ctx)) != 0)
+		return(ret);
+
+	/* Keep the raw key for the TSI; only AES is offloaded */
+	ctx->hw = 0;
+	mbedtls_zeroize(ctx->keys, sizeof(ctx->keys));
+	if(cipher == MBEDTLS_CIPHER_ID_AES)
+	{
+		ctx->keySize = keybits / 8;
+		if(keybits == 128)
+			ctx->keySizeOp = AES_KEY_SIZE_128;
+		else if(keybits == 192)
+			ctx->keySizeOp = AES_KEY_SIZE_192;
+		else
+			ctx->keySizeOp = AES_KEY_SIZE_256;
+		memcpy(ctx->keys, key, ctx->keySize);
+		ctx->hw = 1;
+	}
+
+	return(0);
+}
+
+/*
+ * Shoup's method for multiplication use this table with
+ *      last4[x] = x times P^128
+ * where x and last4[x] are seen as elements of GF(2^128) as in [MGV]
+ */
+static const uint64_t last4[16] =
+{
+	0x0000, 0x1c20, 0x3840, 0x2460,
+	0x7080, 0x6ca0, 0x48c0, 0x54e0,
+	0xe100, 0xfd20, 0xd940, 0xc560,
+	0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+/*
+ * Sets output to x times H using the precomputed tables.
+ * x and output are seen as elements of GF(2^128) as in [MGV].
+ */
+static void gcm_mult(mbedtls_gcm_context *ctx, const unsigned char x[16],
+					 unsigned char output[16])
+{
+	int i = 0;
+	unsigned char lo, hi, rem;
+	uint64_t zh, zl;
+
+	lo = x[15] & 0xf;
+
+	zh = ctx->HH[lo];
+	zl = ctx->HL[lo];
+
+	for(i = 15; i >= 0; i--)
+	{
+		lo = x[i] & 0xf;
+		hi = (x[i] >> 4) & 0xf;
+
+		if(i != 15)
+		{
+			rem = (unsigned char) zl & 0xf;
+			zl = (zh << 60) | (zl >> 4);
+			zh = (zh >> 4);
+			zh ^= (uint64_t) last4[rem] << 48;
+			zh ^= ctx->HH[lo];
+			zl ^= ctx->HL[lo];
+		}
+
+		rem = (unsigned char) zl & 0xf;
+		zl = (zh << 60) | (zl >> 4);
+		zh = (zh >> 4);
+		zh ^= (uint64_t) last4[rem] << 48;
+		zh ^= ctx->HH[hi];
+		zl ^= ctx->HL[hi];
+	}
+
+	MBEDTLS_PUT_UINT32_BE(zh >> 32, output, 0);
+	MBEDTLS_PUT_UINT32_BE(zh, output, 4);
+	MBEDTLS_PUT_UINT32_BE(zl >> 32, output, 8);
+	MBEDTLS_PUT_UINT32_BE(zl, output, 12);
+}
+
+int mbedtls_gcm_starts(mbedtls_gcm_context *ctx,
+					   int mode,
+					   const unsigned char *iv, size_t iv_len)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	unsigned char work_buf[16];
+	size_t i;
+	const unsigned char *p;
+	size_t use_len, olen = 0;
+	uint64_t iv_bits;
+
+	GCM_VALIDATE_RET(ctx != NULL);
+	GCM_VALIDATE_RET(iv != NULL);
+
+	/* IV is limited to 2^64 bits, so 2^61 bytes */
+	/* IV is not allowed to be zero length */
+	if(iv_len == 0 || (uint64_t) iv_len >> 61 != 0)
+		return(MBEDTLS_ERR_GCM_BAD_INPUT);
+
+	memset(ctx->y, 0x00, sizeof(ctx->y));
+	memset(ctx->buf, 0x00, sizeof(ctx->buf));
+
+	ctx->mode = mode;
+	ctx->len = 0;
+	ctx->add_len = 0;
+
+	if(iv_len == 12)
+	{
+		memcpy(ctx->y, iv, iv_len);
+		ctx->y[15] = 1;
+	}
+	else
+	{
+		memset(work_buf, 0x00, 16);
+		iv_bits = (uint64_t)iv_len * 8;
+		MBEDTLS_PUT_UINT64_BE(iv_bits, work_buf, 8);
+
+		p = iv;
+		while(iv_len > 0)
+		{
+			use_len = (iv_len < 16) ? iv_len : 16;
+
+			for(i = 0; i < use_len; i++)
+				ctx->y[i] ^= p[i];
+
+			gcm_mult(ctx, ctx->y, ctx->y);
+
+			iv_len -= use_len;
+			p += use_len;
+		}
+
+		for(i = 0; i < 16; i++)
+			ctx->y[i] ^= work_buf[i];
+
+		gcm_mult(ctx, ctx->y, ctx->y);
+	}
+
+	if((ret = mbedtls_cipher_update(&ctx->cipher_ctx, ctx->y, 16,
+									ctx->base_ectr, &olen)) != 0)
+	{
+		return(ret);
+	}
+
+	return(0);
+}
+
+/*
+ * See gcm.c for the meaning of buf, len and add_len between calls.
+ */
+int mbedtls_gcm_update_ad(mbedtls_gcm_context *ctx,
+						  const unsigned char *add, size_t add_len)
+{
+	const unsigned char *p;
+	size_t use_len, i, offset;
+
+	GCM_VALIDATE_RET(add_len == 0 || add != NULL);
+
+	/* IV is limited to 2^64 bits, so 2^61 bytes */
+	if((uint64_t) add_len >> 61 != 0)
+		return(MBEDTLS_ERR_GCM_BAD_INPUT);
+
+	offset = ctx->add_len % 16;
+	p = add;
+
+	if(offset != 0)
+	{
+		use_len = 16 - offset;
+		if(use_len > add_len)
+			use_len = add_len;
+
+		for(i = 0; i < use_len; i++)
+			ctx->buf[i+offset] ^= p[i];
+
+		if(offset + use_len == 16)
+			gcm_mult(ctx, ctx->buf, ctx->buf);
+
+		ctx->add_len += use_len;
+		add_len -= use_len;
+		p += use_len;
+	}
+
+	ctx->add_len += add_len;
+
+	while(add_len >= 16)
+	{
+		for(i = 0; i < 16; i++)
+			ctx->buf[i] ^= p[i];
+
+		gcm_mult(ctx, ctx->buf, ctx->buf);
+
+		add_len -= 16;
+		p += 16;
+	}
+
+	if(add_len > 0)
+	{
+		for(i = 0; i < add_len; i++)
+			ctx->buf[i] ^= p[i];
+	}
+
+	return(0);
+}
+
+/* Increment the counter. */
+static void gcm_incr(unsigned char y[16])
+{
+	size_t i;
+	for(i = 16; i > 12; i--)
+		if(++y[i - 1] != 0)
+			break;
+}
+
+/* Calculate and apply the encryption mask. Process use_len bytes of data,
+ * starting at position offset in the mask block. */
+static int gcm_mask(mbedtls_gcm_context *ctx,
+					unsigned char ectr[16],
+					size_t offset, size_t use_len,
+					const unsigned char *input,
+					unsigned char *output)
+{
+	size_t i;
+	size_t olen = 0;
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+
+	if((ret = mbedtls_cipher_update(&ctx->cipher_ctx, ctx->y, 16, ectr,
+									&olen)) != 0)
+	{
+		mbedtls_zeroize(ectr, 16);
+		return(ret);
+	}
+
+	for(i = 0; i < use_len; i++)
+	{
+		if(ctx->mode == MBEDTLS_GCM_DECRYPT)
+			ctx->buf[offset + i] ^= input[i];
+		output[i] = ectr[offset + i] ^ input[i];
+		if(ctx->mode == MBEDTLS_GCM_ENCRYPT)
+			ctx->buf[offset + i] ^= output[i];
+	}
+	return(0);
+}
+
+int mbedtls_gcm_update(mbedtls_gcm_context *ctx,
+					   const unsigned char *input, size_t input_length,
+					   unsigned char *output, size_t output_size,
+					   size_t *output_length)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	const unsigned char *p = input;
+	unsigned char *out_p = output;
+	size_t offset;
+	unsigned char ectr[16];
+
+	if(output_size < input_length)
+		return(MBEDTLS_ERR_GCM_BUFFER_TOO_SMALL);
+	GCM_VALIDATE_RET(output_length != NULL);
+	*output_length = input_length;
+
+	/* Exit early if input_length==0 so that we don't do any pointer arithmetic
+	 * on a potentially null pointer.
+	 * Returning early also means that the last partial block of AD remains
+	 * untouched for mbedtls_gcm_finish */
+	if(input_length == 0)
+		return(0);
+
+	GCM_VALIDATE_RET(ctx != NULL);
+	GCM_VALIDATE_RET(input != NULL);
+	GCM_VALIDATE_RET(output != NULL);
+
+	if(output > input && (size_t) (output - input) < input_length)
+		return(MBEDTLS_ERR_GCM_BAD_INPUT);
+
+	/* Total length is restricted to 2^39 - 256 bits, ie 2^36 - 2^5 bytes
+	 * Also check for possible overflow */
+	if(ctx->len + input_length < ctx->len ||
+	   (uint64_t) ctx->len + input_length > 0xFFFFFFFE0ull)
+	{
+		return(MBEDTLS_ERR_GCM_BAD_INPUT);
+	}
+
+	if(ctx->len == 0 && ctx->add_len % 16 != 0)
+	{
+		gcm_mult(ctx, ctx->buf, ctx->buf);
+	}
+
+	offset = ctx->len % 16;
+	if(offset != 0)
+	{
+		size_t use_len = 16 - offset;
+		if(use_len > input_length)
+			use_len = input_length;
+
+		if((ret = gcm_mask(ctx, ectr, offset, use_len, p, out_p)) != 0)
+			return(ret);
+
+		if(offset + use_len == 16)
+			gcm_mult(ctx, ctx->buf, ctx->buf);
+
+		ctx->len += use_len;
+		input_length -= use_len;
+		p += use_len;
+		out_p += use_len;
+	}
+
+	ctx->len += input_length;
+
+	while(input_length >= 16)
+	{
+		gcm_incr(ctx->y);
+		if((ret = gcm_mask(ctx, ectr, 0, 16, p, out_p)) != 0)
+			return(ret);
+
+		gcm_mult(ctx, ctx->buf, ctx->buf);
+
+		input_length -= 16;
+		p += 16;
+		out_p += 16;
+	}
+
+	if(input_length > 0)
+	{
+		gcm_incr(ctx->y);
+		if((ret = gcm_mask(ctx, ectr, 0, input_length, p, out_p)) != 0)
+			return(ret);
+	}
+
+	mbedtls_zeroize(ectr, sizeof(ectr));
+	return(0);
+}
+
+int mbedtls_gcm_finish(mbedtls_gcm_context *ctx,
+					   unsigned char *output, size_t output_size,
+					   size_t *output_length,
+					   unsigned char *tag, size_t tag_len)
+{
+	unsigned char work_buf[16];
+	size_t i;
+	uint64_t orig_len;
+	uint64_t orig_add_len;
+
+	GCM_VALIDATE_RET(ctx != NULL);
+	GCM_VALIDATE_RET(tag != NULL);
+
+	/* We never pass any output in finish(). */
+	(void) output;
+	(void) output_size;
+	*output_length = 0;
+
+	orig_len = ctx->len * 8;
+	orig_add_len = ctx->add_len * 8;
+
+	if(ctx->len == 0 && ctx->add_len % 16 != 0)
+	{
+		gcm_mult(ctx, ctx->buf, ctx->buf);
+	}
+
+	if(tag_len > 16 || tag_len < 4)
+		return(MBEDTLS_ERR_GCM_BAD_INPUT);
+
+	if(ctx->len % 16 != 0)
+		gcm_mult(ctx, ctx->buf, ctx->buf);
+
+	memcpy(tag, ctx->base_ectr, tag_len);
+
+	if(orig_len || orig_add_len)
+	{
+		memset(work_buf, 0x00, 16);
+
+		MBEDTLS_PUT_UINT32_BE((orig_add_len >> 32), work_buf, 0);
+		MBEDTLS_PUT_UINT32_BE((orig_add_len), work_buf, 4);
+		MBEDTLS_PUT_UINT32_BE((orig_len >> 32), work_buf, 8);
+		MBEDTLS_PUT_UINT32_BE((orig_len), work_buf, 12);
+
+		for(i = 0; i < 16; i++)
+			ctx->buf[i] ^= work_buf[i];
+
+		gcm_mult(ctx, ctx->buf, ctx->buf);
+
+		for(i = 0; i < tag_len; i++)
+			tag[i] ^= ctx->buf[i];
+	}
+
+	return(0);
+}
+
+/* Do AES-GCM encrypt/decrypt with H/W accelerator
+ *
+ * The whole record is staged in the static DMA buffers and fed to one TSI
+ * session in runs of NU_GCM_RUN_SIZE payload bytes, the first run also
+ * carrying J0 and the AAD. The engine writes the payload to the destination
+ * buffer and the tag right after the last padded payload block.
+ *
+ * NOTE: Caller guarantees iv_len == 12, add_len <= NU_GCM_AAD_MAX and
+ *       length <= NU_GCM_DMA_SIZE.
+ */
+static int __nvt_gcm_crypt(mbedtls_gcm_context *ctx,
+						   int mode,
+						   size_t length,
+						   const unsigned char *iv,
+						   const unsigned char *add,
+						   size_t add_len,
+						   const unsigned char *input,
+						   unsigned char *output,
+						   size_t tag_len,
+						   unsigned char *tag)
+{
+	uint8_t   *src = nc_ptr(s_gcm_src);
+	uint8_t   *dst = nc_ptr(s_gcm_dst);
+	uint32_t  *param = nc_ptr(s_gcm_param);
+	uint32_t  info_len, dma_len, pos, xlen;
+	int       ret, sid = -1;
+
+	/* J0 = IV || 0^31 || 1 */
+	memcpy(src, iv, 12);
+	src[12] = 0;
+	src[13] = 0;
+	src[14] = 0;
+	src[15] = 1;
+	info_len = 16;
+
+	if(add_len)
+	{
+		memcpy(src + info_len, add, add_len);
+		memset(src + info_len + add_len, 0, NU_GCM_PAD16(add_len) - add_len);
+		info_len += NU_GCM_PAD16(add_len);
+	}
+
+	if(length)
+	{
+		memcpy(src + info_len, input, length);
+		memset(src + info_len + length, 0, NU_GCM_PAD16(length) - length);
+	}
+	dma_len = info_len + NU_GCM_PAD16(length);
+
+	memcpy(nc_ptr(s_gcm_key), ctx->keys, ctx->keySize);
+
+	param[0] = 12;
+	param[1] = add_len;
+	param[2] = length;
+
+	ret = TSI_Open_Session(C_CODE_AES, &sid);
+	if (ret != 0)
+		goto err_out;
+
+	ret = TSI_AES_Set_Key(sid, ctx->keySizeOp, ptr_to_u32(s_gcm_key));
+	if (ret != 0)
+		goto err_out;
+
+	ret = TSI_AES_Set_Mode(sid,             /* sid        */
+						   1,               /* kinswap    */
+						   0,               /* koutswap   */
+						   1,               /* inswap     */
+						   1,               /* outswap    */
+						   0,               /* sm4en      */
+						   (mode == MBEDTLS_GCM_ENCRYPT) ? 1 : 0, /* encrypt */
+						   AES_MODE_GCM,    /* mode       */
+						   ctx->keySizeOp,  /* keysz      */
+						   0,               /* ks         */
+						   0                /* ks_num     */
+						   );
+	if (ret != 0)
+		goto err_out;
+
+	for(pos = 0; pos < dma_len; pos += xlen)
+	{
+		if(pos == 0)
+		{
+			param[3] = ptr_to_u32(s_gcm_src);
+			param[4] = ptr_to_u32(s_gcm_dst);
+			xlen = info_len + NU_GCM_RUN_SIZE;
+		}
+		else
+		{
+			param[3] = ptr_to_u32(s_gcm_src) + pos;
+			param[4] = ptr_to_u32(s_gcm_dst) + pos - info_len;
+			xlen = NU_GCM_RUN_SIZE;
+		}
+		if(xlen > dma_len - pos)
+			xlen = dma_len - pos;
+
+		ret = TSI_AES_GCM_Run(sid, (pos + xlen >= dma_len) ? 1 : 0, xlen, ptr_to_u32(s_gcm_param));
+		if (ret != 0)
+			goto err_out;
+	}
+
+	TSI_Close_Session(C_CODE_AES, sid);
+
+	memcpy(output, dst, length);
+	memcpy(tag, dst + NU_GCM_PAD16(length), tag_len);
+
+	mbedtls_zeroize(src, dma_len);
+	mbedtls_zeroize(dst, NU_GCM_PAD16(length) + 16);
+	mbedtls_zeroize(nc_ptr(s_gcm_key), sizeof(s_gcm_key));
+	return 0;
+
+err_out:
+	sysprintf("TSI AES-GCM ERROR!!! 0x%x\n", ret);
+	if (sid >= 0)
+		TSI_Close_Session(C_CODE_AES, sid);
+	TSI_Print_Error(ret);
+	mbedtls_zeroize(src, sizeof(s_gcm_src));
+	mbedtls_zeroize(nc_ptr(s_gcm_key), sizeof(s_gcm_key));
+	return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+}
+
+int mbedtls_gcm_crypt_and_tag(mbedtls_gcm_context *ctx,
+							  int mode,
+							  size_t length,
+							  const unsigned char *iv,
+							  size_t iv_len,
+							  const unsigned char *add,
+							  size_t add_len,
+							  const unsigned char *input,
+							  unsigned char *output,
+							  size_t tag_len,
+							  unsigned char *tag)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	size_t olen;
+
+	GCM_VALIDATE_RET(ctx != NULL);
+	GCM_VALIDATE_RET(iv != NULL);
+	GCM_VALIDATE_RET(add_len == 0 || add != NULL);
+	GCM_VALIDATE_RET(length == 0 || input != NULL);
+	GCM_VALIDATE_RET(length == 0 || output != NULL);
+	GCM_VALIDATE_RET(tag != NULL);
+
+	if(tag_len > 16 || tag_len < 4)
+		return(MBEDTLS_ERR_GCM_BAD_INPUT);
+
+	/* TLS records: AES key, 96-bit nonce, short AAD, up to one record */
+	if(ctx->hw && iv_len == 12 && add_len <= NU_GCM_AAD_MAX &&
+	   length <= NU_GCM_DMA_SIZE && length >= NU_GCM_SW_MIN())
+	{
+		return __nvt_gcm_crypt(ctx, mode, length, iv, add, add_len,
+							   input, output, tag_len, tag);
+	}
+
+	if((ret = mbedtls_gcm_starts(ctx, mode, iv, iv_len)) != 0)
+		return(ret);
+
+	if((ret = mbedtls_gcm_update_ad(ctx, add, add_len)) != 0)
+		return(ret);
+
+	if((ret = mbedtls_gcm_update(ctx, input, length,
+								 output, length, &olen)) != 0)
+		return(ret);
+
+	if((ret = mbedtls_gcm_finish(ctx, NULL, 0, &olen, tag, tag_len)) != 0)
+		return(ret);
+
+	return(0);
+}
+
+int mbedtls_gcm_auth_decrypt(mbedtls_gcm_context *ctx,
+							 size_t length,
+							 const unsigned char *iv,
+							 size_t iv_len,
+							 const unsigned char *add,
+							 size_t add_len,
+							 const unsigned char *tag,
+							 size_t tag_len,
+							 const unsigned char *input,
+							 unsigned char *output)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	unsigned char check_tag[16];
+	size_t i;
+	int diff;
+
+	GCM_VALIDATE_RET(ctx != NULL);
+	GCM_VALIDATE_RET(iv != NULL);
+	GCM_VALIDATE_RET(add_len == 0 || add != NULL);
+	GCM_VALIDATE_RET(tag != NULL);
+	GCM_VALIDATE_RET(length == 0 || input != NULL);
+	GCM_VALIDATE_RET(length == 0 || output != NULL);
+
+	if((ret = mbedtls_gcm_crypt_and_tag(ctx, MBEDTLS_GCM_DECRYPT, length,
+										iv, iv_len, add, add_len,
+										input, output, tag_len, check_tag)) != 0)
+	{
+		return(ret);
+	}
+
+	/* Check tag in "constant-time" */
+	for(diff = 0, i = 0; i < tag_len; i++)
+		diff |= tag[i] ^ check_tag[i];
+
+	if(diff != 0)
+	{
+		mbedtls_zeroize(output, length);
+		return(MBEDTLS_ERR_GCM_AUTH_FAILED);
+	}
+
+	return(0);
+}
+
+void mbedtls_gcm_free(mbedtls_gcm_context *ctx)
+{
+	if(ctx == NULL)
+		return;
+	mbedtls_cipher_free(&ctx->cipher_ctx);
+	mbedtls_zeroize(ctx, sizeof(mbedtls_gcm_context));
+}
+
+#endif /* MBEDTLS_GCM_ALT */
+#endif /* MBEDTLS_GCM_C */
@@ -0,0 +1,106 @@
+/**
+ * \file gcm_alt.h
+ *
+ * \brief AES-GCM with TSI hardware acceleration
+ *
+ *  Copyright (C) 2006-2021, Arm Limited (or its affiliates), All Rights Reserved
+ *  Copyright (c) 2023 Nuvoton Technology Corp. All rights reserved.
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  mbedtls_gcm_crypt_and_tag() and mbedtls_gcm_auth_decrypt(), which the
+ *  TLS record layer uses, run as a single TSI AES-GCM session. The
+ *  streaming API (starts/update_ad/update/finish) cannot, because the TSI
+ *  needs the total payload length before the first block, so it keeps the
+ *  table-driven software GHASH of gcm.c.
+ *
+ *  The TSI path stages J0, AAD, payload and tag in DMA buffers shared by
+ *  all contexts, and TSI_Set_Lock() only covers one command and its ack.
+ *  This ALT is therefore single-task: all GCM operations of an application
+ *  must run in one task, or the caller must serialize the whole
+ *  mbedtls_gcm_crypt_and_tag()/mbedtls_gcm_auth_decrypt() call.
+ */
+
+#ifndef MBEDTLS_GCM_ALT_H
+#define MBEDTLS_GCM_ALT_H
+
+#if defined(MBEDTLS_GCM_ALT)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Largest payload handled by the TSI. It covers a full TLS record
+ * (16 KB plaintext plus TLS 1.3 inner type and padding). Longer payloads
+ * are processed in software. Must be a multiple of 16.
+ */
+#ifndef NU_GCM_DMA_SIZE
+#define NU_GCM_DMA_SIZE         (16 * 1024 + 256)
+#endif
+
+/*
+ * Bytes of payload passed per TSI_AES_GCM_Run() call. Must be a multiple
+ * of 16.
+ */
+#ifndef NU_GCM_RUN_SIZE
+#define NU_GCM_RUN_SIZE         (4096)
+#endif
+
+/*
+ * Largest additional data handled by the TSI. TLS uses 13 bytes.
+ */
+#ifndef NU_GCM_AAD_MAX
+#define NU_GCM_AAD_MAX          (256)
+#endif
+
+/*
+ * Payloads shorter than this are processed in software. The software path
+ * encrypts every counter block through mbedtls_cipher_update(). With
+ * MBEDTLS_AES_ALT that is the ARMv8 Crypto Extension if the CPU has it,
+ * otherwise a TSI session per block, and then every payload goes to the
+ * TSI whatever this value.
+ */
+#ifndef NU_GCM_SW_THRESHOLD
+#define NU_GCM_SW_THRESHOLD     (256)
+#endif
+
+/**
+ * \brief          The GCM context structure.
+ */
+typedef struct mbedtls_gcm_context
+{
+	mbedtls_cipher_context_t cipher_ctx;    /*!< The cipher context used by the software path. */
+	uint64_t HL[16];                        /*!< Precalculated HTable low. */
+	uint64_t HH[16];                        /*!< Precalculated HTable high. */
+	uint64_t len;                           /*!< The total length of the encrypted data. */
+	uint64_t add_len;                       /*!< The total length of the additional data. */
+	unsigned char base_ectr[16];            /*!< The first ECTR for tag. */
+	unsigned char y[16];                    /*!< The Y working value. */
+	unsigned char buf[16];                  /*!< The buf working value. */
+	int mode;                               /*!< MBEDTLS_GCM_ENCRYPT or MBEDTLS_GCM_DECRYPT. */
+	int hw;                                 /*!< 1 if the key can be used by the TSI */
+	uint32_t keySize;                       /*!< Key size in bytes: 16/24/32 */
+	uint32_t keySizeOp;                     /*!< AES_KEY_SIZE_128/192/256 */
+	uint32_t keys[8];                       /*!< Cipher key */
+}
+mbedtls_gcm_context;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBEDTLS_GCM_ALT */
+
+#endif /* gcm_alt.h */
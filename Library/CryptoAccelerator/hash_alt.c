@@ -0,0 +1,463 @@
+/*
+ * Copyright (C) 2023, Nuvoton Technology Corporation, All Rights Reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *  TSI SHA engine shared by the hash alternatives, one-shot SHA-3/SM3 and
+ *  HMAC
+ */
+
+#include "common.h"
+
+#include <string.h>
+#include "mbedtls/error.h"
+#include "mbedtls/platform.h"
+#if defined(MBEDTLS_MD_C)
+#include "mbedtls/md.h"
+#endif
+#include "NuMicro.h"
+#include "tsi_cmd.h"
+#include "hash_alt.h"
+
+#if (NU_SHA_BUF_SIZE % 128) || (NU_SHA_BUF_SIZE == 0)
+#error "NU_SHA_BUF_SIZE must be a multiple of 128"
+#endif
+
+/* Message and digest, accessed through their non-cacheable alias */
+__ALIGNED(32) static uint8_t s_sha_dma[NU_SHA_BUF_SIZE];
+__ALIGNED(32) static uint8_t s_sha_dgst[64];
+
+static size_t s_hw_min = NU_SHA_HW_MIN;
+static size_t s_hw_min_256 = NU_SHA256_HW_MIN;
+
+
+/* Implementation that should never be optimized out by the compiler */
+static void mbedtls_zeroize(void *v, size_t n)
+{
+	volatile unsigned char *p = (unsigned char*)v;
+	while(n--) *p++ = 0;
+}
+
+static void nu_sha_error(int ret)
+{
+	sysprintf("TSI SHA ERROR!!! 0x%x\n", ret);
+	TSI_Print_Error(ret);
+}
+
+/*
+ * Copy the digest out of the DMA buffer. The TSI writes SM3 digests with
+ * the bytes of each word reversed.
+ */
+static void nu_sha_get_digest(int mode_sel, unsigned char *output, int dlen)
+{
+	uint8_t *dgst = nc_ptr(s_sha_dgst);
+	int i;
+
+	if(mode_sel == SHA_MODE_SEL_SM3)
+	{
+		for(i = 0; i < dlen; i++)
+			output[i] = dgst[(i & ~3) + 3 - (i & 3)];
+	}
+	else
+		memcpy(output, dgst, dlen);
+	mbedtls_zeroize(dgst, sizeof(s_sha_dgst));
+}
+
+/*
+ * Hash len bytes, at most NU_SHA_BUF_SIZE, with one TSI command
+ */
+static int nu_sha_oneshot(int mode_sel, int mode, const unsigned char *input, size_t len,
+						  unsigned char *output, int dlen)
+{
+	uint8_t *dma = nc_ptr(s_sha_dma);
+	int ret;
+
+	memcpy(dma, input, len);
+	ret = TSI_SHA_All_At_Once(1, 1, mode_sel, mode, (dlen + 3) / 4, len,
+							  ptr_to_u32(s_sha_dma), ptr_to_u32(s_sha_dgst));
+	mbedtls_zeroize(dma, len);
+	if(ret != 0)
+	{
+		nu_sha_error(ret);
+		return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+	}
+	nu_sha_get_digest(mode_sel, output, dlen);
+	return 0;
+}
+
+static int nu_sha_session_open(int mode_sel, int mode, int hmac, int keylen, int *sid)
+{
+	int ret;
+
+	ret = TSI_Open_Session(C_CODE_SHA, sid);
+	if(ret != 0)
+		goto err;
+
+	ret = TSI_SHA_Start(*sid, 1, 1, mode_sel, hmac, mode, keylen, 0, 0);
+	if(ret != 0)
+	{
+		TSI_Close_Session(C_CODE_SHA, *sid);
+		goto err;
+	}
+	return 0;
+
+err:
+	nu_sha_error(ret);
+	return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+}
+
+/*
+ * Give the first len bytes of the DMA buffer to session sid. The session
+ * is closed if this is the last data or the TSI fails.
+ */
+static int nu_sha_session_feed(int sid, size_t len, int last, int mode_sel,
+							   unsigned char *output, int dlen)
+{
+	int ret;
+
+	if(last)
+		ret = TSI_SHA_Finish(sid, (dlen + 3) / 4, len, ptr_to_u32(s_sha_dma),
+							 ptr_to_u32(s_sha_dgst));
+	else
+		ret = TSI_SHA_Update(sid, len, ptr_to_u32(s_sha_dma));
+	mbedtls_zeroize(nc_ptr(s_sha_dma), len);
+
+	if(ret != 0)
+	{
+		TSI_Close_Session(C_CODE_SHA, sid);
+		nu_sha_error(ret);
+		return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+	}
+	if(last)
+	{
+		TSI_Close_Session(C_CODE_SHA, sid);
+		nu_sha_get_digest(mode_sel, output, dlen);
+	}
+	return 0;
+}
+
+/*
+ * Hash the message in one session. In HMAC mode the key, zero padded to a
+ * word boundary, goes in front of it.
+ */
+static int nu_sha_session_run(int mode_sel, int mode, int hmac,
+							  const unsigned char *key, size_t keylen,
+							  const unsigned char *input, size_t ilen,
+							  unsigned char *output, int dlen)
+{
+	uint8_t *dma = nc_ptr(s_sha_dma);
+	size_t fill, n;
+	int sid, ret;
+
+	ret = nu_sha_session_open(mode_sel, mode, hmac, keylen, &sid);
+	if(ret != 0)
+		return ret;
+
+	fill = (keylen + 3) & ~3;
+	memset(dma, 0, fill);
+	if(keylen)
+		memcpy(dma, key, keylen);
+
+	while(ilen > NU_SHA_BUF_SIZE - fill)
+	{
+		n = NU_SHA_BUF_SIZE - fill;
+		memcpy(dma + fill, input, n);
+		input += n;
+		ilen -= n;
+
+		ret = nu_sha_session_feed(sid, NU_SHA_BUF_SIZE, 0, mode_sel, output, dlen);
+		if(ret != 0)
+			return ret;
+		fill = 0;
+	}
+	memcpy(dma + fill, input, ilen);
+	return nu_sha_session_feed(sid, fill + ilen, 1, mode_sel, output, dlen);
+}
+
+void nu_sha_set_hw_min(size_t bytes)
+{
+	s_hw_min = bytes;
+}
+
+void nu_sha256_set_hw_min(size_t bytes)
+{
+	s_hw_min_256 = bytes;
+}
+
+/*
+ * Engine of the SHA contexts
+ */
+void nu_sha_hw_starts(nu_sha_hw_context *hw, int mode_sel, int mode, int dgst_len)
+{
+	/* Restarting a context without finishing it */
+	if(hw->state == NU_SHA_ST_SESSION)
+		TSI_Close_Session(C_CODE_SHA, hw->sid);
+	mbedtls_zeroize(hw->buf, hw->buf_len);
+
+	hw->mode_sel = mode_sel;
+	hw->mode = mode;
+	hw->dgst_len = dgst_len;
+	hw->hw_min = (mode == SHA_MODE_SHA224 || mode == SHA_MODE_SHA256) ? s_hw_min_256 : s_hw_min;
+	hw->state = NU_SHA_ST_BUFFERED;
+	hw->sid = -1;
+	hw->buf_len = 0;
+}
+
+/*
+ * Hand the buffered input to the software and continue there
+ */
+static int nu_sha_hw_spill(nu_sha_hw_context *hw, nu_sha_sw_update_t sw_update, void *sw)
+{
+	int ret;
+
+	ret = sw_update(sw, hw->buf, hw->buf_len);
+	mbedtls_zeroize(hw->buf, hw->buf_len);
+	hw->buf_len = 0;
+	hw->state = NU_SHA_ST_SOFT;
+	return ret;
+}
+
+int nu_sha_hw_update(nu_sha_hw_context *hw, const unsigned char *input, size_t ilen,
+					 nu_sha_sw_update_t sw_update, void *sw)
+{
+	size_t n;
+	int ret;
+
+	switch(hw->state)
+	{
+	case NU_SHA_ST_SOFT:
+		return sw_update(sw, input, ilen);
+
+	case NU_SHA_ST_BUFFERED:
+		if(ilen <= NU_SHA_BUF_SIZE - hw->buf_len)
+		{
+			memcpy(hw->buf + hw->buf_len, input, ilen);
+			hw->buf_len += ilen;
+			return 0;
+		}
+		if(ilen < NU_SHA_SESSION_MIN || hw->hw_min == (size_t)-1 ||
+				nu_sha_session_open(hw->mode_sel, hw->mode, 0, 0, &hw->sid) != 0)
+		{
+			ret = nu_sha_hw_spill(hw, sw_update, sw);
+			if(ret != 0)
+				return ret;
+			return sw_update(sw, input, ilen);
+		}
+		hw->state = NU_SHA_ST_SESSION;
+		break;
+
+	case NU_SHA_ST_SESSION:
+		break;
+
+	default:
+		return MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED;
+	}
+
+	/* Keep the last, possibly full, buffer for the finish command */
+	while(ilen > 0)
+	{
+		if(hw->buf_len == NU_SHA_BUF_SIZE)
+		{
+			memcpy(nc_ptr(s_sha_dma), hw->buf, NU_SHA_BUF_SIZE);
+			mbedtls_zeroize(hw->buf, NU_SHA_BUF_SIZE);
+			hw->buf_len = 0;
+
+			ret = nu_sha_session_feed(hw->sid, NU_SHA_BUF_SIZE, 0, hw->mode_sel, NULL, 0);
+			if(ret != 0)
+			{
+				/* The data given to the TSI is gone with the session */
+				hw->state = NU_SHA_ST_INVALID;
+				return ret;
+			}
+		}
+
+		n = NU_SHA_BUF_SIZE - hw->buf_len;
+		if(n > ilen)
+			n = ilen;
+		memcpy(hw->buf + hw->buf_len, input, n);
+		hw->buf_len += n;
+		input += n;
+		ilen -= n;
+	}
+	return 0;
+}
+
+int nu_sha_hw_finish(nu_sha_hw_context *hw, unsigned char *output,
+					 nu_sha_sw_update_t sw_update, void *sw)
+{
+	int ret;
+
+	switch(hw->state)
+	{
+	case NU_SHA_ST_SOFT:
+		return NU_SHA_FINISH_SW;
+
+	case NU_SHA_ST_BUFFERED:
+		if(hw->buf_len >= hw->hw_min && hw->hw_min != (size_t)-1)
+		{
+			if(nu_sha_oneshot(hw->mode_sel, hw->mode, hw->buf, hw->buf_len,
+							  output, hw->dgst_len) == 0)
+			{
+				mbedtls_zeroize(hw->buf, hw->buf_len);
+				hw->buf_len = 0;
+				return 0;
+			}
+		}
+		/* Short message, or the TSI failed: the input is all still here */
+		ret = nu_sha_hw_spill(hw, sw_update, sw);
+		if(ret != 0)
+			return ret;
+		return NU_SHA_FINISH_SW;
+
+	case NU_SHA_ST_SESSION:
+		memcpy(nc_ptr(s_sha_dma), hw->buf, hw->buf_len);
+		ret = nu_sha_session_feed(hw->sid, hw->buf_len, 1, hw->mode_sel,
+								  output, hw->dgst_len);
+		mbedtls_zeroize(hw->buf, hw->buf_len);
+		hw->buf_len = 0;
+		hw->state = NU_SHA_ST_INVALID;
+		return ret;
+
+	default:
+		return MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED;
+	}
+}
+
+/*
+ * Fix up a context just copied from another one
+ */
+void nu_sha_hw_cloned(nu_sha_hw_context *hw)
+{
+	if(hw->state == NU_SHA_ST_SESSION)
+	{
+		mbedtls_zeroize(hw->buf, hw->buf_len);
+		hw->buf_len = 0;
+		hw->sid = -1;
+		hw->state = NU_SHA_ST_INVALID;
+	}
+}
+
+void nu_sha_hw_free(nu_sha_hw_context *hw)
+{
+	if(hw->state == NU_SHA_ST_SESSION)
+		TSI_Close_Session(C_CODE_SHA, hw->sid);
+	mbedtls_zeroize(hw, sizeof(nu_sha_hw_context));
+}
+
+/*
+ * One-shot SHA-3 and SM3
+ */
+int nu_hash(nu_hash_type_t type, const unsigned char *input, size_t ilen,
+			unsigned char *output)
+{
+	int mode_sel = SHA_MODE_SEL_SHA3;
+	int mode, dlen;
+
+	switch(type)
+	{
+	case NU_HASH_SHA3_224:
+		mode = SHA_MODE_SHA224;
+		dlen = 28;
+		break;
+	case NU_HASH_SHA3_256:
+		mode = SHA_MODE_SHA256;
+		dlen = 32;
+		break;
+	case NU_HASH_SHA3_384:
+		mode = SHA_MODE_SHA384;
+		dlen = 48;
+		break;
+	case NU_HASH_SHA3_512:
+		mode = SHA_MODE_SHA512;
+		dlen = 64;
+		break;
+	case NU_HASH_SM3:
+		mode_sel = SHA_MODE_SEL_SM3;
+		mode = SHA_MODE_SHA256;
+		dlen = 32;
+		break;
+	default:
+		return MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED;
+	}
+
+	if(ilen <= NU_SHA_BUF_SIZE)
+		return nu_sha_oneshot(mode_sel, mode, input, ilen, output, dlen);
+	return nu_sha_session_run(mode_sel, mode, 0, NULL, 0, input, ilen, output, dlen);
+}
+
+#if defined(MBEDTLS_MD_C)
+/*
+ * HMAC in one TSI pass over the key and the message
+ */
+int nu_hmac(int md_type, const unsigned char *key, size_t keylen,
+			const unsigned char *input, size_t ilen, unsigned char *output)
+{
+	const mbedtls_md_info_t *md_info;
+	unsigned char sum[MBEDTLS_MD_MAX_SIZE];
+	int mode_sel = SHA_MODE_SEL_SHA2;
+	int mode, ret;
+	size_t dlen;
+
+	md_info = mbedtls_md_info_from_type((mbedtls_md_type_t)md_type);
+	if(md_info == NULL)
+		return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+
+	switch(md_type)
+	{
+	case MBEDTLS_MD_MD5:
+		mode_sel = SHA_MODE_SEL_MD5;
+		mode = SHA_MODE_SHA1;
+		break;
+	case MBEDTLS_MD_SHA1:
+		mode_sel = SHA_MODE_SEL_SHA1;
+		mode = SHA_MODE_SHA1;
+		break;
+	case MBEDTLS_MD_SHA224:
+		mode = SHA_MODE_SHA224;
+		break;
+	case MBEDTLS_MD_SHA256:
+		mode = SHA_MODE_SHA256;
+		break;
+	case MBEDTLS_MD_SHA384:
+		mode = SHA_MODE_SHA384;
+		break;
+	case MBEDTLS_MD_SHA512:
+		mode = SHA_MODE_SHA512;
+		break;
+	default:
+		return mbedtls_md_hmac(md_info, key, keylen, input, ilen, output);
+	}
+	dlen = mbedtls_md_get_size(md_info);
+
+	/* RFC 2104: keys longer than the hash block are hashed first */
+	if(keylen > (md_type == MBEDTLS_MD_SHA384 || md_type == MBEDTLS_MD_SHA512 ? 128 : 64))
+	{
+		ret = mbedtls_md(md_info, key, keylen, sum);
+		if(ret != 0)
+			return ret;
+		key = sum;
+		keylen = dlen;
+	}
+
+	ret = nu_sha_session_run(mode_sel, mode, 1, key, keylen, input, ilen, output, dlen);
+	if(ret != 0)
+		ret = mbedtls_md_hmac(md_info, key, keylen, input, ilen, output);
+
+	mbedtls_zeroize(sum, sizeof(sum));
+	return ret;
+}
+#endif /* MBEDTLS_MD_C */
@@ -0,0 +1,188 @@
+/**
+ * \file hash_alt.h
+ *
+ * \brief TSI SHA engine for the SHA-1, SHA-224/256 and SHA-384/512
+ *        alternatives, and one-shot SHA-3, SM3 and HMAC
+ *
+ *  Copyright (c) 2023 Nuvoton Technology Corp. All rights reserved.
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  A message hashed by one TSI_SHA_All_At_Once() costs one TSI command, a
+ *  TSI session costs five. The SHA contexts therefore keep up to
+ *  NU_SHA_BUF_SIZE bytes of input and decide at finish time:
+ *    - shorter than the hardware threshold: software, the TSI round trip
+ *      would cost more than the hashing itself
+ *    - otherwise: one TSI_SHA_All_At_Once(), software if the TSI fails
+ *  A context whose input outgrows the buffer carries on in software, unless
+ *  a single update of NU_SHA_SESSION_MIN bytes or more made it overflow.
+ *  Bulk data like that is streamed through a TSI session.
+ *
+ *  The state of a TSI session cannot be copied. The clone of a context that
+ *  streams through a session returns MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED
+ *  from its next update or finish. TLS clones its handshake transcripts,
+ *  which are fed one handshake message at a time and never get there.
+ *
+ *  mbed TLS has no SHA-3 or SM3 module and its HMAC is two passes of the
+ *  software hash; nu_hash() and nu_hmac() run them on the TSI in one pass.
+ *
+ *  All functions share one DMA buffer. Like every other TSI user they must
+ *  not run in two tasks at the same time.
+ */
+
+#ifndef MBEDTLS_HASH_ALT_H
+#define MBEDTLS_HASH_ALT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Input kept by each SHA context and size of the DMA buffer. Must be a
+ * multiple of 128, the SHA-512 block size.
+ */
+#ifndef NU_SHA_BUF_SIZE
+#define NU_SHA_BUF_SIZE         (4096)
+#endif
+
+/*
+ * Default hardware threshold in bytes. Shorter messages are hashed in
+ * software. Measure it with the mbedTLS_SHA_Throughput sample.
+ */
+#ifndef NU_SHA_HW_MIN
+#define NU_SHA_HW_MIN           (256)
+#endif
+
+/*
+ * Same for SHA-224/256, whose software runs on the ARMv8 Crypto Extension
+ * when the CPU has it. nu_crypto_calibrate(), run by
+ * mbedtls_platform_setup(), replaces it with a measured value.
+ */
+#ifndef NU_SHA256_HW_MIN
+#define NU_SHA256_HW_MIN        (2048)
+#endif
+
+/*
+ * Smallest single update that moves an overflowing context to a TSI
+ * session instead of software.
+ */
+#ifndef NU_SHA_SESSION_MIN
+#define NU_SHA_SESSION_MIN      (16384)
+#endif
+
+/* nu_sha_hw_context.state */
+#define NU_SHA_ST_BUFFERED      0       /*!< Input kept in buf, nothing hashed yet */
+#define NU_SHA_ST_SOFT          1       /*!< Hashing in software */
+#define NU_SHA_ST_SESSION       2       /*!< Streaming through TSI session sid */
+#define NU_SHA_ST_INVALID       3       /*!< Clone of a session, or session failed */
+
+/* nu_sha_hw_finish() return value that asks for the software finish */
+#define NU_SHA_FINISH_SW        1
+
+/**
+ * \brief   TSI part of a SHA context
+ */
+typedef struct
+{
+	int       mode_sel;                 /*!< SHA_MODE_SEL_xxx */
+	int       mode;                     /*!< SHA_MODE_xxx */
+	int       dgst_len;                 /*!< Digest length in bytes */
+	size_t    hw_min;                   /*!< Hardware threshold at starts */
+	int       state;                    /*!< NU_SHA_ST_xxx */
+	int       sid;                      /*!< TSI session in NU_SHA_ST_SESSION */
+	uint32_t  buf_len;                  /*!< Bytes in buf */
+	uint8_t   buf[NU_SHA_BUF_SIZE];     /*!< Input not yet given to the TSI */
+}
+nu_sha_hw_context;
+
+/* Software update of the owning context, used when the engine gives up */
+typedef int (*nu_sha_sw_update_t)(void *ctx, const unsigned char *input, size_t ilen);
+
+/*
+ * Engine used by sha1_alt.c, sha256_alt.c and sha512_alt.c. sw is the
+ * owning mbed TLS context and is passed to sw_update.
+ */
+void nu_sha_hw_starts(nu_sha_hw_context *hw, int mode_sel, int mode, int dgst_len);
+int nu_sha_hw_update(nu_sha_hw_context *hw, const unsigned char *input, size_t ilen,
+					 nu_sha_sw_update_t sw_update, void *sw);
+int nu_sha_hw_finish(nu_sha_hw_context *hw, unsigned char *output,
+					 nu_sha_sw_update_t sw_update, void *sw);
+void nu_sha_hw_cloned(nu_sha_hw_context *hw);
+void nu_sha_hw_free(nu_sha_hw_context *hw);
+
+/**
+ * \brief          Set the hardware threshold of the SHA-1 and SHA-384/512
+ *                 contexts. Contexts already started keep theirs.
+ *
+ * \param bytes    Messages shorter than this are hashed in software.
+ *                 0 sends every message to the TSI, SIZE_MAX none.
+ */
+void nu_sha_set_hw_min(size_t bytes);
+
+/**
+ * \brief          Set the hardware threshold of the SHA-224/256 contexts.
+ *
+ * \param bytes    As for nu_sha_set_hw_min()
+ */
+void nu_sha256_set_hw_min(size_t bytes);
+
+/**
+ * \brief   Hash types of nu_hash()
+ */
+typedef enum
+{
+	NU_HASH_SHA3_224 = 0,
+	NU_HASH_SHA3_256,
+	NU_HASH_SHA3_384,
+	NU_HASH_SHA3_512,
+	NU_HASH_SM3,
+}
+nu_hash_type_t;
+
+/**
+ * \brief          Hash a message on the TSI.
+ *
+ * \param type     Hash algorithm
+ * \param input    Message
+ * \param ilen     Message length in bytes
+ * \param output   Receives the digest, 28, 32, 48 or 64 bytes
+ *
+ * \return         0 on success, MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED
+ *                 for an unknown type, or MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED.
+ */
+int nu_hash(nu_hash_type_t type, const unsigned char *input, size_t ilen,
+			unsigned char *output);
+
+/**
+ * \brief          HMAC in the TSI HMAC mode. Same arguments as
+ *                 mbedtls_md_hmac(), which it falls back to for digests
+ *                 the TSI does not have and when the TSI fails.
+ *
+ * \param md_type  MBEDTLS_MD_MD5, MBEDTLS_MD_SHA1, MBEDTLS_MD_SHA224,
+ *                 MBEDTLS_MD_SHA256, MBEDTLS_MD_SHA384 or MBEDTLS_MD_SHA512
+ *                 on the TSI, any other type in software
+ *
+ * \return         0 on success, or an MBEDTLS_ERR_MD_XXX error code.
+ */
+int nu_hmac(int md_type, const unsigned char *key, size_t keylen,
+			const unsigned char *input, size_t ilen, unsigned char *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* hash_alt.h */
@@ -26,6 +26,10 @@
 #include "mbedtls/error.h"
 
 #include "NuMicro.h"
+#include "mbedtls/aes.h"
+#include "mbedtls/sha256.h"
+#include "hash_alt.h"
+#include "ce_alt.h"
 
 
 #if defined(MBEDTLS_PLATFORM_EXIT_ALT)
@@ -53,13 +57,20 @@ int mbedtls_platform_set_exit(void (*exit_func)(int status))
 
 #if defined(MBEDTLS_PLATFORM_SETUP_TEARDOWN_ALT)
 /*
- * Placeholder platform setup that does nothing by default
+ * Platform setup. Measures the CPU/TSI thresholds, which depend on the CPU
+ * clock and on the TSI firmware, at the cost of a few hundred milliseconds
+ * per boot. Define NU_CRYPTO_NO_CALIBRATE to keep the built-in defaults
+ * instead. TSI_Init() must have been called.
  */
 int mbedtls_platform_setup( mbedtls_platform_context *ctx )
 {
     (void)ctx;
 
+#if !defined(NU_CRYPTO_NO_CALIBRATE)
+    return( nu_crypto_calibrate() );
+#else
     return( 0 );
+#endif
 }
 
 /*
@@ -161,7 +172,6 @@ E_ECC_CURVE  MbedTLS_ALT_get_curve(mbedtls_ecp_group* grp, int *echar)
     {
     	if (curve_map_tbl[i].id == grp->id)
     	{
-    		sysprintf("MbedTLS_ALT_get_curve - %d, %d, %d\n", grp->id, curve_map_tbl[i].curve, curve_map_tbl[i].echar);
     		*echar = curve_map_tbl[i].echar;
     		return curve_map_tbl[i].curve;
     	}
@@ -261,4 +271,124 @@ int MbedTLS_ALT_ECC_FixCurve(mbedtls_ecp_group* grp)
     return 0;
 }
 
+#if defined(MBEDTLS_AES_ALT) || defined(MBEDTLS_SHA256_ALT)
+/*
+ * Sizes measured by nu_crypto_calibrate(), and bytes processed for each
+ * measurement
+ */
+static const uint32_t s_calib_sizes[] = { 64, 256, 1024, 4096, 16384 };
+#define NU_CALIB_SIZES      (int)(sizeof(s_calib_sizes) / sizeof(s_calib_sizes[0]))
+#define NU_CALIB_BYTES      (64 * 1024)
+
+/* Process len bytes of buf on the CPU or on the TSI */
+typedef int (*nu_calib_fn_t)(int tsi, unsigned char *buf, uint32_t len);
+
+#if defined(MBEDTLS_AES_ALT)
+static mbedtls_aes_context s_calib_aes;
+
+static int nu_calib_aes(int tsi, unsigned char *buf, uint32_t len)
+{
+    unsigned char iv[16] = { 0 };
+
+    nu_aes_set_tsi_min(tsi ? 0 : SIZE_MAX);
+    return mbedtls_aes_crypt_cbc(&s_calib_aes, MBEDTLS_AES_ENCRYPT, len, iv, buf, buf);
+}
+#endif
+
+#if defined(MBEDTLS_SHA256_ALT)
+static int nu_calib_sha256(int tsi, unsigned char *buf, uint32_t len)
+{
+    unsigned char dgst[32];
+
+    nu_sha256_set_hw_min(tsi ? 0 : SIZE_MAX);
+    return mbedtls_sha256(buf, len, dgst, 0);
+}
+#endif
+
+static int nu_calib_time(nu_calib_fn_t fn, int tsi, unsigned char *buf,
+                         uint32_t len, uint64_t *ticks)
+{
+    uint64_t t0;
+    uint32_t i, rounds;
+    int ret;
+
+    rounds = NU_CALIB_BYTES / len;
+    if (rounds < 2)
+        rounds = 2;
+
+    t0 = EL0_GetCurrentPhysicalValue();
+    for (i = 0; i < rounds; i++)
+    {
+        if ((ret = fn(tsi, buf, len)) != 0)
+            return ret;
+    }
+    *ticks = EL0_GetCurrentPhysicalValue() - t0;
+    return 0;
+}
+
+/*
+ * Smallest measured size from which the TSI wins at every larger size,
+ * SIZE_MAX if it never does
+ */
+static int nu_calib_threshold(nu_calib_fn_t fn, unsigned char *buf, size_t *threshold)
+{
+    uint64_t t_cpu, t_tsi;
+    int i, ret;
+
+    *threshold = SIZE_MAX;
+    for (i = NU_CALIB_SIZES - 1; i >= 0; i--)
+    {
+        if ((ret = nu_calib_time(fn, 0, buf, s_calib_sizes[i], &t_cpu)) != 0)
+            return ret;
+        if ((ret = nu_calib_time(fn, 1, buf, s_calib_sizes[i], &t_tsi)) != 0)
+            return ret;
+        if (t_tsi >= t_cpu)
+            break;
+        *threshold = s_calib_sizes[i];
+    }
+    return 0;
+}
+#endif /* MBEDTLS_AES_ALT || MBEDTLS_SHA256_ALT */
+
+int nu_crypto_calibrate(void)
+{
+#if defined(MBEDTLS_AES_ALT) || defined(MBEDTLS_SHA256_ALT)
+    unsigned char *buf;
+    size_t threshold;
+    int ret = 0;
+
+    buf = mbedtls_calloc(1, s_calib_sizes[NU_CALIB_SIZES - 1]);
+    if (buf == NULL)
+        return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+
+#if defined(MBEDTLS_AES_ALT)
+    /* Without the Crypto Extension everything goes to the TSI anyway */
+    if (nu_ce_available() & NU_CE_AES)
+    {
+        mbedtls_aes_init(&s_calib_aes);
+        ret = mbedtls_aes_setkey_enc(&s_calib_aes, buf, 128);
+        if (ret == 0)
+            ret = nu_calib_threshold(nu_calib_aes, buf, &threshold);
+        mbedtls_aes_free(&s_calib_aes);
+        nu_aes_set_tsi_min((ret == 0) ? threshold : NU_AES_TSI_MIN);
+        if (ret != 0)
+            goto exit;
+    }
+#endif
+
+#if defined(MBEDTLS_SHA256_ALT)
+    ret = nu_calib_threshold(nu_calib_sha256, buf, &threshold);
+    nu_sha256_set_hw_min((ret == 0) ? threshold : NU_SHA256_HW_MIN);
+#endif
+
+#if defined(MBEDTLS_AES_ALT)
+exit:
+#endif
+    mbedtls_free(buf);
+    return ret;
+#else
+    return 0;
+#endif
+}
+
 #endif /* MBEDTLS_PLATFORM_C */
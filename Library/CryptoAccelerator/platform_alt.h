@@ -419,6 +419,20 @@ E_ECC_CURVE  MbedTLS_ALT_get_curve(mbedtls_ecp_group* grp, int *echar);
 void MbedTLS_ALT_ECC_Copy(uint32_t *dest, uint32_t *src, uint32_t size);
 int MbedTLS_ALT_ECC_FixCurve(mbedtls_ecp_group* grp);
 
+/**
+ * \brief   Time the AES and SHA-256 alternatives on the CPU and on the TSI
+ *          and set the sizes from which they use the TSI. TSI_Init() must
+ *          have succeeded.
+ *
+ *          Called by mbedtls_platform_setup() unless NU_CRYPTO_NO_CALIBRATE
+ *          is defined, in which case NU_AES_TSI_MIN and NU_SHA256_HW_MIN
+ *          apply.
+ *
+ * \return  \c 0 on success, or the error of the failing operation. The
+ *          default threshold is kept for an algorithm that failed.
+ */
+int nu_crypto_calibrate(void);
+
 #ifdef __cplusplus
 }
 #endif
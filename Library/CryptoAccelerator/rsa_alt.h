@@ -0,0 +1,121 @@
+/**
+ * \file rsa_alt.h
+ *
+ * \brief RSA with TSI hardware acceleration
+ *
+ *  Copyright (C) 2006-2021, Arm Limited (or its affiliates), All Rights Reserved
+ *  Copyright (c) 2023 Nuvoton Technology Corp. All rights reserved.
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  mbedtls_rsa_public() and mbedtls_rsa_private() run on TSI_RSA_Exp_Mod()
+ *  for 1024, 2048, 3072 and 4096-bit moduli. Other sizes use the bignum
+ *  software of rsa.c.
+ *
+ *  The private exponent may also be kept in the Key Store. Import N and E
+ *  into the context, bind the key with nu_rsa_set_ks_key() and hand the
+ *  context to mbedtls_pk_setup_rsa_alt() with nu_rsa_ks_decrypt(),
+ *  nu_rsa_ks_sign() and nu_rsa_ks_key_len().
+ */
+
+#ifndef MBEDTLS_RSA_ALT_H
+#define MBEDTLS_RSA_ALT_H
+
+#if defined(MBEDTLS_RSA_ALT)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Run private key operations in TSI CRT mode when P and Q are both half
+ * the modulus length. Set to 0 to always use the full exponent D.
+ */
+#ifndef NU_RSA_CRT
+#define NU_RSA_CRT              (1)
+#endif
+
+/**
+ * \brief   The RSA context structure.
+ */
+typedef struct mbedtls_rsa_context
+{
+	int ver;                    /*!<  Reserved for internal purposes. */
+	size_t len;                 /*!<  The size of \p N in Bytes. */
+
+	mbedtls_mpi N;              /*!<  The public modulus. */
+	mbedtls_mpi E;              /*!<  The public exponent. */
+
+	mbedtls_mpi D;              /*!<  The private exponent. */
+	mbedtls_mpi P;              /*!<  The first prime factor. */
+	mbedtls_mpi Q;              /*!<  The second prime factor. */
+
+	mbedtls_mpi DP;             /*!<  <code>D % (P - 1)</code>. */
+	mbedtls_mpi DQ;             /*!<  <code>D % (Q - 1)</code>. */
+	mbedtls_mpi QP;             /*!<  <code>1 / (Q % P)</code>. */
+
+	mbedtls_mpi RN;             /*!<  cached <code>R^2 mod N</code>. */
+
+	mbedtls_mpi RP;             /*!<  cached <code>R^2 mod P</code>. */
+	mbedtls_mpi RQ;             /*!<  cached <code>R^2 mod Q</code>. */
+
+	mbedtls_mpi Vi;             /*!<  The cached blinding value. */
+	mbedtls_mpi Vf;             /*!<  The cached un-blinding value. */
+
+	int padding;                /*!< #MBEDTLS_RSA_PKCS_V15 or #MBEDTLS_RSA_PKCS_V21. */
+	int hash_id;                /*!< Hash identifier of mbedtls_md_type_t type. */
+
+	int ks_sel;                 /*!< 0, RSA_KEY_SEL_KS_OTP or RSA_KEY_SEL_KS_SRAM */
+	int ks_num;                 /*!< Key Store key number of the private exponent */
+#if defined(MBEDTLS_THREADING_C)
+	/* Invariant: the mutex is initialized iff ver != 0. */
+	mbedtls_threading_mutex_t mutex;    /*!<  Thread-safety mutex. */
+#endif
+}
+mbedtls_rsa_context;
+
+/**
+ * \brief          Use a private exponent held by the TSI Key Store.
+ *
+ * \param ctx      RSA context with N and E imported. N must be 1024, 2048,
+ *                 3072 or 4096 bits.
+ * \param esel     RSA_KEY_SEL_KS_OTP or RSA_KEY_SEL_KS_SRAM
+ * \param knum     Key Store key number of the private exponent
+ *
+ * \return         0 on success, or MBEDTLS_ERR_RSA_BAD_INPUT_DATA.
+ */
+int nu_rsa_set_ks_key(mbedtls_rsa_context *ctx, int esel, int knum);
+
+#if defined(MBEDTLS_PK_RSA_ALT_SUPPORT)
+/*
+ * mbedtls_pk_setup_rsa_alt() callbacks for a context bound with
+ * nu_rsa_set_ks_key(). They also work for a context holding a full key.
+ */
+int nu_rsa_ks_decrypt(void *ctx, size_t *olen,
+					  const unsigned char *input, unsigned char *output,
+					  size_t output_max_len);
+int nu_rsa_ks_sign(void *ctx,
+				   int (*f_rng)(void *, unsigned char *, size_t), void *p_rng,
+				   mbedtls_md_type_t md_alg, unsigned int hashlen,
+				   const unsigned char *hash, unsigned char *sig);
+size_t nu_rsa_ks_key_len(void *ctx);
+#endif /* MBEDTLS_PK_RSA_ALT_SUPPORT */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBEDTLS_RSA_ALT */
+
+#endif /* rsa_alt.h */
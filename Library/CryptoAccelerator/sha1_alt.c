@@ -0,0 +1,404 @@
+/*
+ *  FIPS-180-1 compliant SHA-1 implementation
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  Copyright (C) 2023, Nuvoton Technology Corporation, All Rights Reserved.
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+/*
+ *  The SHA-1 standard was published by NIST in 1993.
+ *
+ *  http://www.itl.nist.gov/fipspubs/fip180-1.htm
+ *
+ *  Messages are hashed on the TSI by the engine of hash_alt.c, which falls
+ *  back to the software below for short messages and long streams.
+ */
+
+#include "common.h"
+
+#if defined(MBEDTLS_SHA1_C)
+#if defined(MBEDTLS_SHA1_ALT)
+
+#include "mbedtls/sha1.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/error.h"
+
+#include <string.h>
+#include "NuMicro.h"
+#include "tsi_cmd.h"
+
+#define SHA1_VALIDATE_RET(cond)                             \
+	MBEDTLS_INTERNAL_VALIDATE_RET(cond, MBEDTLS_ERR_SHA1_BAD_INPUT_DATA)
+
+#define SHA1_VALIDATE(cond)  MBEDTLS_INTERNAL_VALIDATE(cond)
+
+void mbedtls_sha1_init(mbedtls_sha1_context *ctx)
+{
+	SHA1_VALIDATE(ctx != NULL);
+
+	memset(ctx, 0, sizeof(mbedtls_sha1_context));
+}
+
+void mbedtls_sha1_free(mbedtls_sha1_context *ctx)
+{
+	if(ctx == NULL)
+		return;
+
+	nu_sha_hw_free(&ctx->hw);
+	mbedtls_platform_zeroize(ctx, sizeof(mbedtls_sha1_context));
+}
+
+void mbedtls_sha1_clone(mbedtls_sha1_context *dst,
+						const mbedtls_sha1_context *src)
+{
+	SHA1_VALIDATE(dst != NULL);
+	SHA1_VALIDATE(src != NULL);
+
+	*dst = *src;
+	nu_sha_hw_cloned(&dst->hw);
+}
+
+/*
+ * SHA-1 context setup
+ */
+int mbedtls_sha1_starts(mbedtls_sha1_context *ctx)
+{
+	SHA1_VALIDATE_RET(ctx != NULL);
+
+	ctx->total[0] = 0;
+	ctx->total[1] = 0;
+
+	ctx->state[0] = 0x67452301;
+	ctx->state[1] = 0xEFCDAB89;
+	ctx->state[2] = 0x98BADCFE;
+	ctx->state[3] = 0x10325476;
+	ctx->state[4] = 0xC3D2E1F0;
+
+	nu_sha_hw_starts(&ctx->hw, SHA_MODE_SEL_SHA1, SHA_MODE_SHA1, 20);
+	return(0);
+}
+
+#if !defined(MBEDTLS_SHA1_PROCESS_ALT)
+int mbedtls_internal_sha1_process(mbedtls_sha1_context *ctx,
+								   const unsigned char data[64])
+{
+	struct
+	{
+		uint32_t temp, W[16], A, B, C, D, E;
+	} local;
+
+	SHA1_VALIDATE_RET(ctx != NULL);
+	SHA1_VALIDATE_RET((const unsigned char *)data != NULL);
+
+	local.W[ 0] = MBEDTLS_GET_UINT32_BE(data,  0);
+	local.W[ 1] = MBEDTLS_GET_UINT32_BE(data,  4);
+	local.W[ 2] = MBEDTLS_GET_UINT32_BE(data,  8);
+	local.W[ 3] = MBEDTLS_GET_UINT32_BE(data, 12);
+	local.W[ 4] = MBEDTLS_GET_UINT32_BE(data, 16);
+	local.W[ 5] = MBEDTLS_GET_UINT32_BE(data, 20);
+	local.W[ 6] = MBEDTLS_GET_UINT32_BE(data, 24);
+	local.W[ 7] = MBEDTLS_GET_UINT32_BE(data, 28);
+	local.W[ 8] = MBEDTLS_GET_UINT32_BE(data, 32);
+	local.W[ 9] = MBEDTLS_GET_UINT32_BE(data, 36);
+	local.W[10] = MBEDTLS_GET_UINT32_BE(data, 40);
+	local.W[11] = MBEDTLS_GET_UINT32_BE(data, 44);
+	local.W[12] = MBEDTLS_GET_UINT32_BE(data, 48);
+	local.W[13] = MBEDTLS_GET_UINT32_BE(data, 52);
+	local.W[14] = MBEDTLS_GET_UINT32_BE(data, 56);
+	local.W[15] = MBEDTLS_GET_UINT32_BE(data, 60);
+
+#define S(x,n) (((x) << (n)) | (((x) & 0xFFFFFFFF) >> (32 - (n))))
+
+#define R(t)                                                    \
+	(                                                          \
+		local.temp = local.W[((t) -  3) & 0x0F] ^             \
+					 local.W[((t) -  8) & 0x0F] ^             \
+					 local.W[((t) - 14) & 0x0F] ^             \
+					 local.W[  (t)        & 0x0F],              \
+		(local.W[(t) & 0x0F] = S(local.temp,1))               \
+	)
+
+#define P(a,b,c,d,e,x)                                          \
+	do                                                          \
+	{                                                           \
+		(e) += S((a),5) + F((b),(c),(d)) + K + (x);             \
+		(b) = S((b),30);                                        \
+	} while(0)
+
+	local.A = ctx->state[0];
+	local.B = ctx->state[1];
+	local.C = ctx->state[2];
+	local.D = ctx->state[3];
+	local.E = ctx->state[4];
+
+#define F(x,y,z) ((z) ^ ((x) & ((y) ^ (z))))
+#define K 0x5A827999
+
+	P(local.A, local.B, local.C, local.D, local.E, local.W[0] );
+	P(local.E, local.A, local.B, local.C, local.D, local.W[1] );
+	P(local.D, local.E, local.A, local.B, local.C, local.W[2] );
+	P(local.C, local.D, local.E, local.A, local.B, local.W[3] );
+	P(local.B, local.C, local.D, local.E, local.A, local.W[4] );
+	P(local.A, local.B, local.C, local.D, local.E, local.W[5] );
+	P(local.E, local.A, local.B, local.C, local.D, local.W[6] );
+	P(local.D, local.E, local.A, local.B, local.C, local.W[7] );
+	P(local.C, local.D, local.E, local.A, local.B, local.W[8] );
+	P(local.B, local.C, local.D, local.E, local.A, local.W[9] );
+	P(local.A, local.B, local.C, local.D, local.E, local.W[10]);
+	P(local.E, local.A, local.B, local.C, local.D, local.W[11]);
+	P(local.D, local.E, local.A, local.B, local.C, local.W[12]);
+	P(local.C, local.D, local.E, local.A, local.B, local.W[13]);
+	P(local.B, local.C, local.D, local.E, local.A, local.W[14]);
+	P(local.A, local.B, local.C, local.D, local.E, local.W[15]);
+	P(local.E, local.A, local.B, local.C, local.D, R(16));
+	P(local.D, local.E, local.A, local.B, local.C, R(17));
+	P(local.C, local.D, local.E, local.A, local.B, R(18));
+	P(local.B, local.C, local.D, local.E, local.A, R(19));
+
+#undef K
+#undef F
+
+#define F(x,y,z) ((x) ^ (y) ^ (z))
+#define K 0x6ED9EBA1
+
+	P(local.A, local.B, local.C, local.D, local.E, R(20));
+	P(local.E, local.A, local.B, local.C, local.D, R(21));
+	P(local.D, local.E, local.A, local.B, local.C, R(22));
+	P(local.C, local.D, local.E, local.A, local.B, R(23));
+	P(local.B, local.C, local.D, local.E, local.A, R(24));
+	P(local.A, local.B, local.C, local.D, local.E, R(25));
+	P(local.E, local.A, local.B, local.C, local.D, R(26));
+	P(local.D, local.E, local.A, local.B, local.C, R(27));
+	P(local.C, local.D, local.E, local.A, local.B, R(28));
+	P(local.B, local.C, local.D, local.E, local.A, R(29));
+	P(local.A, local.B, local.C, local.D, local.E, R(30));
+	P(local.E, local.A, local.B, local.C, local.D, R(31));
+	P(local.D, local.E, local.A, local.B, local.C, R(32));
+	P(local.C, local.D, local.E, local.A, local.B, R(33));
+	P(local.B, local.C, local.D, local.E, local.A, R(34));
+	P(local.A, local.B, local.C, local.D, local.E, R(35));
+	P(local.E, local.A, local.B, local.C, local.D, R(36));
+	P(local.D, local.E, local.A, local.B, local.C, R(37));
+	P(local.C, local.D, local.E, local.A, local.B, R(38));
+	P(local.B, local.C, local.D, local.E, local.A, R(39));
+
+#undef K
+#undef F
+
+#define F(x,y,z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define K 0x8F1BBCDC
+
+	P(local.A, local.B, local.C, local.D, local.E, R(40));
+	P(local.E, local.A, local.B, local.C, local.D, R(41));
+	P(local.D, local.E, local.A, local.B, local.C, R(42));
+	P(local.C, local.D, local.E, local.A, local.B, R(43));
+	P(local.B, local.C, local.D, local.E, local.A, R(44));
+	P(local.A, local.B, local.C, local.D, local.E, R(45));
+	P(local.E, local.A, local.B, local.C, local.D, R(46));
+	P(local.D, local.E, local.A, local.B, local.C, R(47));
+	P(local.C, local.D, local.E, local.A, local.B, R(48));
+	P(local.B, local.C, local.D, local.E, local.A, R(49));
+	P(local.A, local.B, local.C, local.D, local.E, R(50));
+	P(local.E, local.A, local.B, local.C, local.D, R(51));
+	P(local.D, local.E, local.A, local.B, local.C, R(52));
+	P(local.C, local.D, local.E, local.A, local.B, R(53));
+	P(local.B, local.C, local.D, local.E, local.A, R(54));
+	P(local.A, local.B, local.C, local.D, local.E, R(55));
+	P(local.E, local.A, local.B, local.C, local.D, R(56));
+	P(local.D, local.E, local.A, local.B, local.C, R(57));
+	P(local.C, local.D, local.E, local.A, local.B, R(58));
+	P(local.B, local.C, local.D, local.E, local.A, R(59));
+
+#undef K
+#undef F
+
+#define F(x,y,z) ((x) ^ (y) ^ (z))
+#define K 0xCA62C1D6
+
+	P(local.A, local.B, local.C, local.D, local.E, R(60));
+	P(local.E, local.A, local.B, local.C, local.D, R(61));
+	P(local.D, local.E, local.A, local.B, local.C, R(62));
+	P(local.C, local.D, local.E, local.A, local.B, R(63));
+	P(local.B, local.C, local.D, local.E, local.A, R(64));
+	P(local.A, local.B, local.C, local.D, local.E, R(65));
+	P(local.E, local.A, local.B, local.C, local.D, R(66));
+	P(local.D, local.E, local.A, local.B, local.C, R(67));
+	P(local.C, local.D, local.E, local.A, local.B, R(68));
+	P(local.B, local.C, local.D, local.E, local.A, R(69));
+	P(local.A, local.B, local.C, local.D, local.E, R(70));
+	P(local.E, local.A, local.B, local.C, local.D, R(71));
+	P(local.D, local.E, local.A, local.B, local.C, R(72));
+	P(local.C, local.D, local.E, local.A, local.B, R(73));
+	P(local.B, local.C, local.D, local.E, local.A, R(74));
+	P(local.A, local.B, local.C, local.D, local.E, R(75));
+	P(local.E, local.A, local.B, local.C, local.D, R(76));
+	P(local.D, local.E, local.A, local.B, local.C, R(77));
+	P(local.C, local.D, local.E, local.A, local.B, R(78));
+	P(local.B, local.C, local.D, local.E, local.A, R(79));
+
+#undef K
+#undef F
+
+	ctx->state[0] += local.A;
+	ctx->state[1] += local.B;
+	ctx->state[2] += local.C;
+	ctx->state[3] += local.D;
+	ctx->state[4] += local.E;
+
+	/* Zeroise buffers and variables to clear sensitive data from memory. */
+	mbedtls_platform_zeroize(&local, sizeof(local));
+
+	return(0);
+}
+
+#endif /* !MBEDTLS_SHA1_PROCESS_ALT */
+
+
+/*
+ * SHA-1 process buffer in software
+ */
+static int sha1_sw_update(void *p, const unsigned char *input, size_t ilen)
+{
+	mbedtls_sha1_context *ctx = (mbedtls_sha1_context *)p;
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	size_t fill;
+	uint32_t left;
+
+	if(ilen == 0)
+		return(0);
+
+	left = ctx->total[0] & 0x3F;
+	fill = 64 - left;
+
+	ctx->total[0] += (uint32_t) ilen;
+	ctx->total[0] &= 0xFFFFFFFF;
+
+	if(ctx->total[0] < (uint32_t) ilen)
+		ctx->total[1]++;
+
+	if(left && ilen >= fill)
+	{
+		memcpy((void *) (ctx->buffer + left), input, fill);
+
+		if((ret = mbedtls_internal_sha1_process(ctx, ctx->buffer)) != 0)
+			return(ret);
+
+		input += fill;
+		ilen  -= fill;
+		left = 0;
+	}
+
+	while(ilen >= 64)
+	{
+		if((ret = mbedtls_internal_sha1_process(ctx, input)) != 0)
+			return(ret);
+
+		input += 64;
+		ilen  -= 64;
+	}
+
+	if(ilen > 0)
+		memcpy((void *) (ctx->buffer + left), input, ilen);
+
+	return(0);
+}
+
+/*
+ * SHA-1 final digest in software
+ */
+static int sha1_sw_finish(mbedtls_sha1_context *ctx, unsigned char output[20])
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	uint32_t used;
+	uint32_t high, low;
+
+	/*
+	 * Add padding: 0x80 then 0x00 until 8 bytes remain for the length
+	 */
+	used = ctx->total[0] & 0x3F;
+
+	ctx->buffer[used++] = 0x80;
+
+	if(used <= 56)
+	{
+		/* Enough room for padding + length in current block */
+		memset(ctx->buffer + used, 0, 56 - used);
+	}
+	else
+	{
+		/* We'll need an extra block */
+		memset(ctx->buffer + used, 0, 64 - used);
+
+		if((ret = mbedtls_internal_sha1_process(ctx, ctx->buffer)) != 0)
+			return(ret);
+
+		memset(ctx->buffer, 0, 56);
+	}
+
+	/*
+	 * Add message length
+	 */
+	high = (ctx->total[0] >> 29)
+		 | (ctx->total[1] <<  3);
+	low  = (ctx->total[0] <<  3);
+
+	MBEDTLS_PUT_UINT32_BE(high, ctx->buffer, 56);
+	MBEDTLS_PUT_UINT32_BE(low,  ctx->buffer, 60);
+
+	if((ret = mbedtls_internal_sha1_process(ctx, ctx->buffer)) != 0)
+		return(ret);
+
+	/*
+	 * Output final state
+	 */
+	MBEDTLS_PUT_UINT32_BE(ctx->state[0], output,  0);
+	MBEDTLS_PUT_UINT32_BE(ctx->state[1], output,  4);
+	MBEDTLS_PUT_UINT32_BE(ctx->state[2], output,  8);
+	MBEDTLS_PUT_UINT32_BE(ctx->state[3], output, 12);
+	MBEDTLS_PUT_UINT32_BE(ctx->state[4], output, 16);
+
+	return(0);
+}
+
+int mbedtls_sha1_update(mbedtls_sha1_context *ctx,
+						const unsigned char *input,
+						size_t ilen)
+{
+	SHA1_VALIDATE_RET(ctx != NULL);
+	SHA1_VALIDATE_RET(ilen == 0 || input != NULL);
+
+	if(ilen == 0)
+		return(0);
+
+	return(nu_sha_hw_update(&ctx->hw, input, ilen, sha1_sw_update, ctx));
+}
+
+int mbedtls_sha1_finish(mbedtls_sha1_context *ctx,
+						unsigned char output[20])
+{
+	int ret;
+
+	SHA1_VALIDATE_RET(ctx != NULL);
+	SHA1_VALIDATE_RET((unsigned char *)output != NULL);
+
+	ret = nu_sha_hw_finish(&ctx->hw, output, sha1_sw_update, ctx);
+	if(ret == NU_SHA_FINISH_SW)
+		ret = sha1_sw_finish(ctx, output);
+	return(ret);
+}
+
+#endif /* MBEDTLS_SHA1_ALT */
+#endif /* MBEDTLS_SHA1_C */
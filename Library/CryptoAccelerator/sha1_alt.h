@@ -0,0 +1,55 @@
+/**
+ * \file sha1_alt.h
+ *
+ * \brief SHA-1 with TSI hardware acceleration
+ *
+ *  Copyright (C) 2006-2021, Arm Limited (or its affiliates), All Rights Reserved
+ *  Copyright (c) 2023 Nuvoton Technology Corp. All rights reserved.
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  See hash_alt.h for when the TSI is used. The context carries
+ *  NU_SHA_BUF_SIZE bytes of input on top of the software state.
+ */
+
+#ifndef MBEDTLS_SHA1_ALT_H
+#define MBEDTLS_SHA1_ALT_H
+
+#if defined(MBEDTLS_SHA1_ALT)
+
+#include "hash_alt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief          The SHA-1 context structure.
+ */
+typedef struct mbedtls_sha1_context
+{
+	uint32_t total[2];          /*!< The number of Bytes processed.  */
+	uint32_t state[5];          /*!< The intermediate digest state.  */
+	unsigned char buffer[64];   /*!< The data block being processed. */
+	nu_sha_hw_context hw;       /*!< TSI state and buffered input */
+}
+mbedtls_sha1_context;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBEDTLS_SHA1_ALT */
+
+#endif /* sha1_alt.h */
@@ -1,197 +1,417 @@
 /*
  *  FIPS-180-2 compliant SHA-256 implementation
  *
- *  Copyright (C) 2006-2021, ARM Limited, All Rights Reserved
- *  Copyright (c) 2022 Nuvoton Technology Corp. All rights reserved.
+ *  Copyright The Mbed TLS Contributors
+ *  Copyright (C) 2023, Nuvoton Technology Corporation, All Rights Reserved.
  *
  *  SPDX-License-Identifier: Apache-2.0
  *
- *  Licensed under the Apache License, Version 2.0 (the "License"); you may
- *  not use this file except in compliance with the License.
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
  *  You may obtain a copy of the License at
  *
  *  http://www.apache.org/licenses/LICENSE-2.0
  *
  *  Unless required by applicable law or agreed to in writing, software
- *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
- *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
  *  See the License for the specific language governing permissions and
  *  limitations under the License.
- *
- *  This file implements STMicroelectronics SHA256 with HW services based on mbed TLS API
  */
 /*
  *  The SHA-256 Secure Hash Standard was published by NIST in 2002.
  *
  *  http://csrc.nist.gov/publications/fips/fips180-2/fips180-2.pdf
+ *
+ *  Messages are hashed on the TSI by the engine of hash_alt.c, which falls
+ *  back to the software below for short messages and long streams. The
+ *  software runs the blocks on the ARMv8 Crypto Extension when the CPU has
+ *  it, see ce_alt.h.
  */
 
-#ifdef MBEDTLS_ALLOW_PRIVATE_ACCESS
-#undef MBEDTLS_ALLOW_PRIVATE_ACCESS
-#endif
-
 #include "common.h"
 
+#if defined(MBEDTLS_SHA256_C)
+#if defined(MBEDTLS_SHA256_ALT)
+
 #include "mbedtls/sha256.h"
+#include "mbedtls/platform_util.h"
 #include "mbedtls/error.h"
 
-#if defined(MBEDTLS_SHA256_C)
-#if defined(MBEDTLS_SHA256_ALT)
 #include <string.h>
-#include "mbedtls/platform.h"
-#include "mbedtls/platform_util.h"
 #include "NuMicro.h"
 #include "tsi_cmd.h"
+#include "ce_alt.h"
 
 #define SHA256_VALIDATE_RET(cond)                           \
-	MBEDTLS_INTERNAL_VALIDATE_RET( cond, MBEDTLS_ERR_SHA256_BAD_INPUT_DATA )
-#define SHA256_VALIDATE(cond)  MBEDTLS_INTERNAL_VALIDATE( cond )
-
-#ifndef ARG_UNUSED
-#define ARG_UNUSED(arg)  ((void)arg)
-#endif
-
-
-static void mbedtls_zeroize(void *v, size_t n)
-{
-	volatile unsigned char *p = (unsigned char *)v;
-	while (n--)
-	{
-		*p++ = 0;
-	}
-}
+	MBEDTLS_INTERNAL_VALIDATE_RET(cond, MBEDTLS_ERR_SHA256_BAD_INPUT_DATA)
+#define SHA256_VALIDATE(cond)  MBEDTLS_INTERNAL_VALIDATE(cond)
 
 void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
 {
-	SHA256_VALIDATE( ctx != NULL );
+	SHA256_VALIDATE(ctx != NULL);
 
-	mbedtls_zeroize(ctx, sizeof(mbedtls_sha256_context));
+	memset(ctx, 0, sizeof(mbedtls_sha256_context));
 }
 
 void mbedtls_sha256_free(mbedtls_sha256_context *ctx)
 {
-	if (ctx == NULL)
-	{
+	if(ctx == NULL)
 		return;
-	}
-	mbedtls_zeroize(ctx, sizeof(mbedtls_sha256_context));
+
+	nu_sha_hw_free(&ctx->hw);
+	mbedtls_platform_zeroize(ctx, sizeof(mbedtls_sha256_context));
 }
 
 void mbedtls_sha256_clone(mbedtls_sha256_context *dst,
-						  const mbedtls_sha256_context *src)
+						   const mbedtls_sha256_context *src)
 {
-	SHA256_VALIDATE( dst != NULL );
-	SHA256_VALIDATE( src != NULL );
+	SHA256_VALIDATE(dst != NULL);
+	SHA256_VALIDATE(src != NULL);
 
 	*dst = *src;
+	nu_sha_hw_cloned(&dst->hw);
 }
 
+/*
+ * SHA-256 context setup
+ */
 int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224)
 {
-	uint32_t u32OpMode;
-	int      ret;
+	SHA256_VALIDATE_RET(ctx != NULL);
 
-	SHA256_VALIDATE_RET( ctx != NULL );
-	SHA256_VALIDATE_RET( is224 == 0 || is224 == 1 );
+#if defined(MBEDTLS_SHA224_C)
+	SHA256_VALIDATE_RET(is224 == 0 || is224 == 1);
+#else
+	SHA256_VALIDATE_RET(is224 == 0);
+#endif
 
-	ctx->MBEDTLS_PRIVATE(is224) = is224;
-	ctx->first = 1;
+	ctx->total[0] = 0;
+	ctx->total[1] = 0;
 
-	if(ctx->MBEDTLS_PRIVATE(is224))
-		u32OpMode = SHA_MODE_SHA224;
+	if(is224 == 0)
+	{
+		/* SHA-256 */
+		ctx->state[0] = 0x6A09E667;
+		ctx->state[1] = 0xBB67AE85;
+		ctx->state[2] = 0x3C6EF372;
+		ctx->state[3] = 0xA54FF53A;
+		ctx->state[4] = 0x510E527F;
+		ctx->state[5] = 0x9B05688C;
+		ctx->state[6] = 0x1F83D9AB;
+		ctx->state[7] = 0x5BE0CD19;
+	}
 	else
-		u32OpMode = SHA_MODE_SHA256;
+	{
+#if defined(MBEDTLS_SHA224_C)
+		/* SHA-224 */
+		ctx->state[0] = 0xC1059ED8;
+		ctx->state[1] = 0x367CD507;
+		ctx->state[2] = 0x3070DD17;
+		ctx->state[3] = 0xF70E5939;
+		ctx->state[4] = 0xFFC00B31;
+		ctx->state[5] = 0x68581511;
+		ctx->state[6] = 0x64F98FA7;
+		ctx->state[7] = 0xBEFA4FA4;
+#endif
+	}
+
+	ctx->is224 = is224;
+
+	nu_sha_hw_starts(&ctx->hw, SHA_MODE_SEL_SHA2,
+					 is224 ? SHA_MODE_SHA224 : SHA_MODE_SHA256, is224 ? 28 : 32);
+	return(0);
+}
+
+#if !defined(MBEDTLS_SHA256_PROCESS_ALT)
+static const uint32_t K[] =
+{
+	0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+	0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+	0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+	0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+	0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+	0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+	0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+	0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+	0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+	0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+	0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+	0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+	0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+	0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+	0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+	0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+#define  SHR(x,n) (((x) & 0xFFFFFFFF) >> (n))
+#define ROTR(x,n) (SHR(x,n) | ((x) << (32 - (n))))
+
+#define S0(x) (ROTR(x, 7) ^ ROTR(x,18) ^  SHR(x, 3))
+#define S1(x) (ROTR(x,17) ^ ROTR(x,19) ^  SHR(x,10))
+
+#define S2(x) (ROTR(x, 2) ^ ROTR(x,13) ^ ROTR(x,22))
+#define S3(x) (ROTR(x, 6) ^ ROTR(x,11) ^ ROTR(x,25))
+
+#define F0(x,y,z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define F1(x,y,z) ((z) ^ ((x) & ((y) ^ (z))))
+
+#define R(t)                                                        \
+	(                                                              \
+		local.W[t] = S1(local.W[(t) -  2]) + local.W[(t) -  7] +    \
+					 S0(local.W[(t) - 15]) + local.W[(t) - 16]      \
+	)
+
+#define P(a,b,c,d,e,f,g,h,x,K)                                      \
+	do                                                              \
+	{                                                               \
+		local.temp1 = (h) + S3(e) + F1((e),(f),(g)) + (K) + (x);    \
+		local.temp2 = S2(a) + F0((a),(b),(c));                      \
+		(d) += local.temp1; (h) = local.temp1 + local.temp2;        \
+	} while(0)
+
+int mbedtls_internal_sha256_process(mbedtls_sha256_context *ctx,
+								const unsigned char data[64])
+{
+	struct
+	{
+		uint32_t temp1, temp2, W[64];
+		uint32_t A[8];
+	} local;
+
+	unsigned int i;
+
+	if(nu_ce_available() & NU_CE_SHA256)
+	{
+		nu_ce_sha256_blocks(ctx->state, data, 1);
+		return(0);
+	}
+
+	SHA256_VALIDATE_RET(ctx != NULL);
+	SHA256_VALIDATE_RET((const unsigned char *)data != NULL);
+
+	for(i = 0; i < 8; i++)
+		local.A[i] = ctx->state[i];
+
+#if defined(MBEDTLS_SHA256_SMALLER)
+	for(i = 0; i < 64; i++)
+	{
+		if(i < 16)
+			local.W[i] = MBEDTLS_GET_UINT32_BE(data, 4 * i);
+		else
+			R(i);
 
-	ret = TSI_Open_Session(C_CODE_SHA, &ctx->sid);
-	if (ret != 0)
-		goto err_out;
+		P(local.A[0], local.A[1], local.A[2], local.A[3], local.A[4],
+		   local.A[5], local.A[6], local.A[7], local.W[i], K[i]);
 
-	ret = TSI_SHA_Start(ctx->sid, 1, 1, 0, 0, u32OpMode, 0, 0, 0);
-	if (ret != 0)
-		return ret;
+		local.temp1 = local.A[7]; local.A[7] = local.A[6];
+		local.A[6] = local.A[5]; local.A[5] = local.A[4];
+		local.A[4] = local.A[3]; local.A[3] = local.A[2];
+		local.A[2] = local.A[1]; local.A[1] = local.A[0];
+		local.A[0] = local.temp1;
+	}
+#else /* MBEDTLS_SHA256_SMALLER */
+	for(i = 0; i < 16; i++)
+		local.W[i] = MBEDTLS_GET_UINT32_BE(data, 4 * i);
+
+	for(i = 0; i < 16; i += 8)
+	{
+		P(local.A[0], local.A[1], local.A[2], local.A[3], local.A[4],
+		   local.A[5], local.A[6], local.A[7], local.W[i+0], K[i+0]);
+		P(local.A[7], local.A[0], local.A[1], local.A[2], local.A[3],
+		   local.A[4], local.A[5], local.A[6], local.W[i+1], K[i+1]);
+		P(local.A[6], local.A[7], local.A[0], local.A[1], local.A[2],
+		   local.A[3], local.A[4], local.A[5], local.W[i+2], K[i+2]);
+		P(local.A[5], local.A[6], local.A[7], local.A[0], local.A[1],
+		   local.A[2], local.A[3], local.A[4], local.W[i+3], K[i+3]);
+		P(local.A[4], local.A[5], local.A[6], local.A[7], local.A[0],
+		   local.A[1], local.A[2], local.A[3], local.W[i+4], K[i+4]);
+		P(local.A[3], local.A[4], local.A[5], local.A[6], local.A[7],
+		   local.A[0], local.A[1], local.A[2], local.W[i+5], K[i+5]);
+		P(local.A[2], local.A[3], local.A[4], local.A[5], local.A[6],
+		   local.A[7], local.A[0], local.A[1], local.W[i+6], K[i+6]);
+		P(local.A[1], local.A[2], local.A[3], local.A[4], local.A[5],
+		   local.A[6], local.A[7], local.A[0], local.W[i+7], K[i+7]);
+	}
+
+	for(i = 16; i < 64; i += 8)
+	{
+		P(local.A[0], local.A[1], local.A[2], local.A[3], local.A[4],
+		   local.A[5], local.A[6], local.A[7], R(i+0), K[i+0]);
+		P(local.A[7], local.A[0], local.A[1], local.A[2], local.A[3],
+		   local.A[4], local.A[5], local.A[6], R(i+1), K[i+1]);
+		P(local.A[6], local.A[7], local.A[0], local.A[1], local.A[2],
+		   local.A[3], local.A[4], local.A[5], R(i+2), K[i+2]);
+		P(local.A[5], local.A[6], local.A[7], local.A[0], local.A[1],
+		   local.A[2], local.A[3], local.A[4], R(i+3), K[i+3]);
+		P(local.A[4], local.A[5], local.A[6], local.A[7], local.A[0],
+		   local.A[1], local.A[2], local.A[3], R(i+4), K[i+4]);
+		P(local.A[3], local.A[4], local.A[5], local.A[6], local.A[7],
+		   local.A[0], local.A[1], local.A[2], R(i+5), K[i+5]);
+		P(local.A[2], local.A[3], local.A[4], local.A[5], local.A[6],
+		   local.A[7], local.A[0], local.A[1], R(i+6), K[i+6]);
+		P(local.A[1], local.A[2], local.A[3], local.A[4], local.A[5],
+		   local.A[6], local.A[7], local.A[0], R(i+7), K[i+7]);
+	}
+#endif /* MBEDTLS_SHA256_SMALLER */
+
+	for(i = 0; i < 8; i++)
+		ctx->state[i] += local.A[i];
 
-	return 0;
+	/* Zeroise buffers and variables to clear sensitive data from memory. */
+	mbedtls_platform_zeroize(&local, sizeof(local));
 
-err_out:
-	sysprintf("TSI SHA ERROR!!! 0x%x\n", ret);
-	TSI_Close_Session(C_CODE_SHA, ctx->sid);
-	TSI_Print_Error(ret);
-	return -1;
+	return(0);
 }
 
-int mbedtls_internal_sha256_process( mbedtls_sha256_context *ctx, const unsigned char data[NU_SHA256_BLOCK_SIZE] )
+#endif /* !MBEDTLS_SHA256_PROCESS_ALT */
+
+/*
+ * SHA-256 process buffer in software
+ */
+static int sha256_sw_update(void *p, const unsigned char *input, size_t ilen)
 {
-	ARG_UNUSED(ctx);
-	ARG_UNUSED(data);
+	mbedtls_sha256_context *ctx = (mbedtls_sha256_context *)p;
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	size_t fill;
+	uint32_t left;
+
+	if(ilen == 0)
+		return(0);
+
+	left = ctx->total[0] & 0x3F;
+	fill = 64 - left;
+
+	ctx->total[0] += (uint32_t) ilen;
+	ctx->total[0] &= 0xFFFFFFFF;
+
+	if(ctx->total[0] < (uint32_t) ilen)
+		ctx->total[1]++;
+
+	if(left && ilen >= fill)
+	{
+		memcpy((void *) (ctx->buffer + left), input, fill);
+
+		if((ret = mbedtls_internal_sha256_process(ctx, ctx->buffer)) != 0)
+			return(ret);
+
+		input += fill;
+		ilen  -= fill;
+		left = 0;
+	}
+
+	if(ilen >= 64 && (nu_ce_available() & NU_CE_SHA256))
+	{
+		nu_ce_sha256_blocks(ctx->state, input, ilen / 64);
+		input += ilen & ~(size_t)63;
+		ilen &= 63;
+	}
 
-	return MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED;
+	while(ilen >= 64)
+	{
+		if((ret = mbedtls_internal_sha256_process(ctx, input)) != 0)
+			return(ret);
+
+		input += 64;
+		ilen  -= 64;
+	}
+
+	if(ilen > 0)
+		memcpy((void *) (ctx->buffer + left), input, ilen);
+
+	return(0);
 }
 
-int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen)
+/*
+ * SHA-256 final digest in software
+ */
+static int sha256_sw_finish(mbedtls_sha256_context *ctx, unsigned char *output)
 {
-	uint32_t ofs = 0;
-	int     ret;
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	uint32_t used;
+	uint32_t high, low;
+
+	/*
+	 * Add padding: 0x80 then 0x00 until 8 bytes remain for the length
+	 */
+	used = ctx->total[0] & 0x3F;
 
-	SHA256_VALIDATE_RET( ctx != NULL );
-	SHA256_VALIDATE_RET( ilen == 0 || input != NULL );
+	ctx->buffer[used++] = 0x80;
 
-	/* Process all data block by block. the remain data will leave to next time. */
-	while (ilen > 0)
+	if(used <= 56)
 	{
-		/* Process the buffer if it is full */
-		if (ctx->buffer_len >= NU_SHA256_BLOCK_SIZE)
-		{
-			dcache_invalidate_by_mva(ctx->buffer, NU_SHA256_BLOCK_SIZE);
-			ret = TSI_SHA_Update(ctx->sid, NU_SHA256_BLOCK_SIZE, ptr_to_u32(ctx->buffer));
-			if (ret != 0)
-				return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
-			ctx->buffer_len = 0;
-		}
-		else
-		{
-			/* prepare input block */
-			if(ilen > NU_SHA256_BLOCK_SIZE - ctx->buffer_len)
-			{
-				memcpy(ctx->buffer + ctx->buffer_len, input + ofs, NU_SHA256_BLOCK_SIZE - ctx->buffer_len);
-				ilen -= NU_SHA256_BLOCK_SIZE - ctx->buffer_len;
-				ofs  += NU_SHA256_BLOCK_SIZE - ctx->buffer_len;
-				ctx->buffer_len = NU_SHA256_BLOCK_SIZE;
-			}
-			else
-			{
-				memcpy(ctx->buffer + ctx->buffer_len, input + ofs, ilen);
-				ctx->buffer_len += ilen;
-				ilen = 0;
-			}
-		}
+		/* Enough room for padding + length in current block */
+		memset(ctx->buffer + used, 0, 56 - used);
 	}
-	return 0;
+	else
+	{
+		/* We'll need an extra block */
+		memset(ctx->buffer + used, 0, 64 - used);
+
+		if((ret = mbedtls_internal_sha256_process(ctx, ctx->buffer)) != 0)
+			return(ret);
+
+		memset(ctx->buffer, 0, 56);
+	}
+
+	/*
+	 * Add message length
+	 */
+	high = (ctx->total[0] >> 29)
+		 | (ctx->total[1] <<  3);
+	low  = (ctx->total[0] <<  3);
+
+	MBEDTLS_PUT_UINT32_BE(high, ctx->buffer, 56);
+	MBEDTLS_PUT_UINT32_BE(low,  ctx->buffer, 60);
+
+	if((ret = mbedtls_internal_sha256_process(ctx, ctx->buffer)) != 0)
+		return(ret);
+
+	/*
+	 * Output final state
+	 */
+	MBEDTLS_PUT_UINT32_BE(ctx->state[0], output,  0);
+	MBEDTLS_PUT_UINT32_BE(ctx->state[1], output,  4);
+	MBEDTLS_PUT_UINT32_BE(ctx->state[2], output,  8);
+	MBEDTLS_PUT_UINT32_BE(ctx->state[3], output, 12);
+	MBEDTLS_PUT_UINT32_BE(ctx->state[4], output, 16);
+	MBEDTLS_PUT_UINT32_BE(ctx->state[5], output, 20);
+	MBEDTLS_PUT_UINT32_BE(ctx->state[6], output, 24);
+
+#if defined(MBEDTLS_SHA224_C)
+	if(ctx->is224 == 0)
+#endif
+		MBEDTLS_PUT_UINT32_BE(ctx->state[7], output, 28);
+
+	return(0);
 }
 
-static uint8_t  _sha256_dma_buff[32] __attribute__((aligned(32)));
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx,
+						  const unsigned char *input,
+						  size_t ilen)
+{
+	SHA256_VALIDATE_RET(ctx != NULL);
+	SHA256_VALIDATE_RET(ilen == 0 || input != NULL);
 
-int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char output[32])
+	if(ilen == 0)
+		return(0);
+
+	return(nu_sha_hw_update(&ctx->hw, input, ilen, sha256_sw_update, ctx));
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx,
+						  unsigned char *output)
 {
-	int32_t ret;
+	int ret;
 
-	SHA256_VALIDATE_RET( ctx != NULL );
-	SHA256_VALIDATE_RET( (unsigned char *)output != NULL );
+	SHA256_VALIDATE_RET(ctx != NULL);
+	SHA256_VALIDATE_RET((unsigned char *)output != NULL);
 
-	/* Process the buffer if it is not emtpy */
-	if (ctx->buffer_len > 0)
-	{
-		dcache_invalidate_by_mva(ctx->buffer, NU_SHA256_BLOCK_SIZE);
-		ret = TSI_SHA_Finish(ctx->sid, 8, ctx->buffer_len,
-							 ptr_to_u32(ctx->buffer), ptr_to_u32(_sha256_dma_buff));
-		if (ret != 0)
-			return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
-
-		memcpy(output, nc_ptr(_sha256_dma_buff), 32);
-		TSI_Close_Session(C_CODE_SHA, ctx->sid);
-		ctx->buffer_len = 0;
-	}
-	return 0;
+	ret = nu_sha_hw_finish(&ctx->hw, output, sha256_sw_update, ctx);
+	if(ret == NU_SHA_FINISH_SW)
+		ret = sha256_sw_finish(ctx, output);
+	return(ret);
 }
 
-#endif /* MBEDTLS_SHA256_ALT*/
+#endif /* MBEDTLS_SHA256_ALT */
 #endif /* MBEDTLS_SHA256_C */
@@ -1,14 +1,10 @@
 /**
- * \file sha256.h
+ * \file sha256_alt.h
  *
- * \brief This file contains SHA-224 and SHA-256 definitions and functions.
+ * \brief SHA-224 and SHA-256 with TSI and ARMv8 Crypto Extension acceleration
  *
- * The Secure Hash Algorithms 224 and 256 (SHA-224 and SHA-256) cryptographic
- * hash functions are defined in <em>FIPS 180-4: Secure Hash Standard (SHS)</em>.
- */
-/*
  *  Copyright (C) 2006-2021, Arm Limited (or its affiliates), All Rights Reserved
- *  Copyright (c) 2022 Nuvoton Technology Corp. All rights reserved.
+ *  Copyright (c) 2023 Nuvoton Technology Corp. All rights reserved.
  *  SPDX-License-Identifier: Apache-2.0
  *
  *  Licensed under the Apache License, Version 2.0 (the "License"); you may
@@ -23,37 +19,43 @@
  *  See the License for the specific language governing permissions and
  *  limitations under the License.
  *
- *  This file implements STMicroelectronics SHA256 API with HW services based
- *  on mbed TLS API
+ *  See hash_alt.h for when the TSI is used. The context carries
+ *  NU_SHA_BUF_SIZE bytes of input on top of the software state.
  */
 
 #ifndef MBEDTLS_SHA256_ALT_H
 #define MBEDTLS_SHA256_ALT_H
 
-#if defined (MBEDTLS_SHA256_ALT)
+#if defined(MBEDTLS_SHA256_ALT)
 
-#include "NuMicro.h"
+#include "hash_alt.h"
 
-#define  NU_SHA256_BLOCK_SIZE   (4096)
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /**
- * \brief          SHA-256 context structure
+ * \brief          The SHA-256 context structure.
  *
  *                 The structure is used both for SHA-256 and for SHA-224
  *                 checksum calculations. The choice between these two is
- *                 made in the call to mbedtls_sha256_starts_ret().
+ *                 made in the call to mbedtls_sha256_starts().
  */
 typedef struct mbedtls_sha256_context
 {
-	int32_t   MBEDTLS_PRIVATE(is224);         /*!< 0 = use SHA256, 1 = use SHA224 */
-	uint8_t   buffer[NU_SHA256_BLOCK_SIZE];   /*!< Buffer to store input data */
-	uint32_t  buffer_len;                     /*!< Number of bytes stored in sbuf */
-	int32_t   first;                          /*!< First block flag */
-	uint32_t  ctl;                            /*!< SHA register settings */
-	int       sid;
+	uint32_t total[2];          /*!< The number of Bytes processed.  */
+	uint32_t state[8];          /*!< The intermediate digest state.  */
+	unsigned char buffer[64];   /*!< The data block being processed. */
+	int is224;                  /*!< Determines which function to use:
+									 0: Use SHA-256, or 1: Use SHA-224. */
+	nu_sha_hw_context hw;       /*!< TSI state and buffered input */
 }
 mbedtls_sha256_context;
 
+#ifdef __cplusplus
+}
+#endif
 
 #endif /* MBEDTLS_SHA256_ALT */
-#endif /* MBEDTLS_SHA256_ALT_H */
+
+#endif /* sha256_alt.h */
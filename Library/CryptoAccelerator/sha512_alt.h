@@ -0,0 +1,63 @@
+/**
+ * \file sha512_alt.h
+ *
+ * \brief SHA-384 and SHA-512 with TSI hardware acceleration
+ *
+ *  Copyright (C) 2006-2021, Arm Limited (or its affiliates), All Rights Reserved
+ *  Copyright (c) 2023 Nuvoton Technology Corp. All rights reserved.
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  See hash_alt.h for when the TSI is used. The context carries
+ *  NU_SHA_BUF_SIZE bytes of input on top of the software state.
+ */
+
+#ifndef MBEDTLS_SHA512_ALT_H
+#define MBEDTLS_SHA512_ALT_H
+
+#if defined(MBEDTLS_SHA512_ALT)
+
+#include "hash_alt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief          The SHA-512 context structure.
+ *
+ *                 The structure is used both for SHA-384 and for SHA-512
+ *                 checksum calculations. The choice between these two is
+ *                 made in the call to mbedtls_sha512_starts().
+ */
+typedef struct mbedtls_sha512_context
+{
+	uint64_t total[2];          /*!< The number of Bytes processed. */
+	uint64_t state[8];          /*!< The intermediate digest state. */
+	unsigned char buffer[128];  /*!< The data block being processed. */
+#if defined(MBEDTLS_SHA384_C)
+	int is384;                  /*!< Determines which function to use:
+									 0: Use SHA-512, or 1: Use SHA-384. */
+#endif
+	nu_sha_hw_context hw;       /*!< TSI state and buffered input */
+}
+mbedtls_sha512_context;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBEDTLS_SHA512_ALT */
+
+#endif /* sha512_alt.h */
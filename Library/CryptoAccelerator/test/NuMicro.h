@@ -0,0 +1,15 @@
+/**************************************************************************//**
+ * @file     NuMicro.h
+ * @brief    Stand-in for the device header, used by the Crypto Extension
+ *           self-tests. The bundled mbed TLS includes NuMicro.h and prints
+ *           with sysprintf(), which test_ce.c maps to the C library.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __NUMICRO_H__
+#define __NUMICRO_H__
+
+int sysprintf(const char *pcStr, ...);
+
+#endif /* __NUMICRO_H__ */
@@ -0,0 +1,33 @@
+/**************************************************************************//**
+ * @file     mbedtls_config.h
+ * @brief    mbed TLS configuration of the Crypto Extension self-tests
+ *
+ *           Only AES and SHA-224/256 are built. Key expansion, the AES
+ *           block functions and the SHA-256 compression come from
+ *           ce_alt.c; everything around them is the stock aes.c and
+ *           sha256.c.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef MBEDTLS_CONFIG_H
+#define MBEDTLS_CONFIG_H
+
+#define MBEDTLS_CIPHER_MODE_CBC
+#define MBEDTLS_CIPHER_MODE_CFB
+#define MBEDTLS_CIPHER_MODE_CTR
+#define MBEDTLS_CIPHER_MODE_OFB
+#define MBEDTLS_CIPHER_MODE_XTS
+
+#define MBEDTLS_AES_C
+#define MBEDTLS_SHA224_C
+#define MBEDTLS_SHA256_C
+#define MBEDTLS_SELF_TEST
+
+#define MBEDTLS_AES_SETKEY_ENC_ALT
+#define MBEDTLS_AES_SETKEY_DEC_ALT
+#define MBEDTLS_AES_ENCRYPT_ALT
+#define MBEDTLS_AES_DECRYPT_ALT
+#define MBEDTLS_SHA256_PROCESS_ALT
+
+#endif /* MBEDTLS_CONFIG_H */
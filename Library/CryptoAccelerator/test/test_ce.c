@@ -0,0 +1,136 @@
+/**************************************************************************//**
+ * @file     test_ce.c
+ * @brief    Self-tests of the ARMv8 Crypto Extension code in ce_alt.c.
+ *
+ *           Runs the mbed TLS AES and SHA-224/256 self-tests, whose known
+ *           answers then go through nu_ce_aes_setkey(), nu_ce_aes_ecb()
+ *           and nu_ce_sha256_blocks(). nu_ce_aes_cbc() is checked against
+ *           CBC built from single blocks. The build has no software
+ *           fallback, so the CPU must have the extension, e.g. qemu-aarch64
+ *           -cpu max.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "mbedtls/aes.h"
+#include "mbedtls/sha256.h"
+#include "ce_alt.h"
+
+#define CBC_BLOCKS      37
+
+static uint32_t s_u32Seed = 7;
+
+int sysprintf(const char *pcStr, ...)
+{
+    va_list args;
+    int i32Len;
+
+    va_start(args, pcStr);
+    i32Len = vprintf(pcStr, args);
+    va_end(args);
+    return i32Len;
+}
+
+static uint32_t Rand(uint32_t u32Range)
+{
+    s_u32Seed = s_u32Seed * 1103515245U + 12345U;
+    return ((s_u32Seed >> 16) | (s_u32Seed << 16)) % u32Range;
+}
+
+static int Test_AesSelfTest(void)
+{
+    return mbedtls_aes_self_test(0) != 0;
+}
+
+static int Test_Sha256SelfTest(void)
+{
+    return mbedtls_sha256_self_test(0) != 0;
+}
+
+/* nu_ce_aes_cbc() against CBC chained by hand from nu_ce_aes_ecb(), in place and not */
+static int Test_AesCbc(void)
+{
+    static const unsigned int au32Bits[] = { 128, 192, 256 };
+    uint32_t au32Ek[60], au32Dk[60];
+    unsigned char au8Key[32], au8Iv[16], au8IvCe[16], au8In[CBC_BLOCKS * 16];
+    unsigned char au8Ref[CBC_BLOCKS * 16], au8Out[CBC_BLOCKS * 16];
+    uint32_t i, j, k;
+    int nr;
+
+    for (k = 0; k < sizeof(au32Bits) / sizeof(au32Bits[0]); k++)
+    {
+        for (i = 0; i < sizeof(au8Key); i++)
+            au8Key[i] = (unsigned char)Rand(256U);
+        for (i = 0; i < sizeof(au8In); i++)
+            au8In[i] = (unsigned char)Rand(256U);
+        for (i = 0; i < sizeof(au8Iv); i++)
+            au8Iv[i] = (unsigned char)Rand(256U);
+
+        nr = nu_ce_aes_setkey(au32Ek, au8Key, au32Bits[k], 0);
+        if ((nr != (int)(6U + au32Bits[k] / 32U)) || (nu_ce_aes_setkey(au32Dk, au8Key, au32Bits[k], 1) != nr))
+        {
+            printf("  %u-bit key: %d rounds\n", au32Bits[k], nr);
+            return 1;
+        }
+
+        /* Encrypt */
+        memcpy(au8Ref, au8In, sizeof(au8In));
+        for (i = 0; i < CBC_BLOCKS; i++)
+        {
+            for (j = 0; j < 16U; j++)
+                au8Ref[i * 16U + j] ^= (i == 0U) ? au8Iv[j] : au8Ref[(i - 1U) * 16U + j];
+            nu_ce_aes_ecb(au32Ek, nr, 0, &au8Ref[i * 16U], &au8Ref[i * 16U]);
+        }
+        memcpy(au8IvCe, au8Iv, sizeof(au8Iv));
+        nu_ce_aes_cbc(au32Ek, nr, 0, sizeof(au8In), au8IvCe, au8In, au8Out);
+        if (memcmp(au8Out, au8Ref, sizeof(au8Ref)) || memcmp(au8IvCe, &au8Ref[(CBC_BLOCKS - 1) * 16], 16))
+        {
+            printf("  %u-bit key: CBC encryption differs\n", au32Bits[k]);
+            return 1;
+        }
+
+        /* Decrypt in place */
+        memcpy(au8IvCe, au8Iv, sizeof(au8Iv));
+        nu_ce_aes_cbc(au32Dk, nr, 1, sizeof(au8Out), au8IvCe, au8Out, au8Out);
+        if (memcmp(au8Out, au8In, sizeof(au8In)) || memcmp(au8IvCe, &au8Ref[(CBC_BLOCKS - 1) * 16], 16))
+        {
+            printf("  %u-bit key: CBC decryption differs\n", au32Bits[k]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    struct
+    {
+        const char *pcName;
+        int (*pfnTest)(void);
+    } asTest[] =
+    {
+        { "AES self-test",              Test_AesSelfTest },
+        { "SHA-224/256 self-test",      Test_Sha256SelfTest },
+        { "AES-CBC against ECB",        Test_AesCbc },
+    };
+    uint32_t i;
+    int i32Fail, i32Total = 0;
+
+    if ((nu_ce_available() & (NU_CE_AES | NU_CE_SHA256)) != (NU_CE_AES | NU_CE_SHA256))
+    {
+        printf("The CPU has no AES/SHA-256 instructions, e.g. run with qemu-aarch64 -cpu max\n");
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(asTest) / sizeof(asTest[0]); i++)
+    {
+        i32Fail = asTest[i].pfnTest();
+        printf("%-32s %s\n", asTest[i].pcName, i32Fail ? "FAIL" : "PASS");
+        i32Total |= i32Fail;
+    }
+
+    return i32Total;
+}
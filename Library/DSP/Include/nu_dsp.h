@@ -0,0 +1,176 @@
+/**************************************************************************//**
+ * @file     nu_dsp.h
+ * @brief    DSP kernels for acquired sensor data
+ *
+ *           Every kernel has an Advanced SIMD (NEON) version and a portable C
+ *           version. The NEON versions work on four independent outputs or
+ *           lanes at a time and keep the order of operations of each one;
+ *           the C versions use fmaf() in the same order. Both therefore give
+ *           bit-identical results, and dsp_set_neon() can switch between them
+ *           at run time to compare or benchmark them.
+ *
+ *           The kernels need fmaf(), sqrtf() and sqrt() from libm.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __NU_DSP_H__
+#define __NU_DSP_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @addtogroup DSP_Library DSP Library
+  @{
+*/
+
+/** @addtogroup DSP_EXPORTED_CONSTANTS DSP Library Exported Constants
+  @{
+*/
+
+#define DSP_OK                  0       /*!< Operation succeeded */
+#define DSP_ERR_PARAM           -1      /*!< Invalid parameter */
+
+#define DSP_FFT_MIN             4U      /*!< Smallest FFT length */
+#define DSP_FFT_MAX             4096U   /*!< Largest FFT length */
+
+/** Floats of twiddle table needed by a float FFT of length n */
+#define DSP_FFT_F32_TWIDDLE_LEN(n)      (2U * (n))
+/** Halfwords of twiddle table needed by a Q15 FFT of length n */
+#define DSP_FFT_Q15_TWIDDLE_LEN(n)      (2U * (n))
+
+/*! @}*/ /* end of group DSP_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup DSP_EXPORTED_STRUCTS DSP Library Exported Structs
+  @{
+*/
+
+/**
+ *  @brief  Float FIR filter.
+ *          pState holds numTaps - 1 + blockSize samples.
+ */
+typedef struct
+{
+    uint32_t        numTaps;        /*!< Filter length */
+    uint32_t        blockSize;      /*!< Most samples per call */
+    const float     *pCoeffs;       /*!< h[0] .. h[numTaps - 1] */
+    float           *pState;        /*!< History followed by the current block */
+} dsp_fir_f32_t;
+
+/**
+ *  @brief  Q15 FIR filter, 64-bit accumulation.
+ *          pState holds numTaps - 1 + blockSize samples.
+ */
+typedef struct
+{
+    uint32_t        numTaps;        /*!< Filter length */
+    uint32_t        blockSize;      /*!< Most samples per call */
+    const int16_t   *pCoeffs;       /*!< h[0] .. h[numTaps - 1] */
+    int16_t         *pState;        /*!< History followed by the current block */
+} dsp_fir_q15_t;
+
+/**
+ *  @brief  Float FIR decimator.
+ *          Only every M-th output is computed, which is the polyphase form
+ *          of filter-then-downsample. pState holds numTaps - 1 + blockSize
+ *          samples.
+ */
+typedef struct
+{
+    uint32_t        M;              /*!< Decimation factor */
+    uint32_t        numTaps;        /*!< Filter length */
+    uint32_t        blockSize;      /*!< Most input samples per call, a multiple of M */
+    const float     *pCoeffs;       /*!< h[0] .. h[numTaps - 1] */
+    float           *pState;        /*!< History followed by the current block */
+} dsp_fir_decim_f32_t;
+
+/**
+ *  @brief  Float biquad cascade, transposed direct form II.
+ *          Each stage has the coefficients {b0, b1, b2, a1, a2} of
+ *          y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2],
+ *          so a1 and a2 are the negated denominator coefficients.
+ *          pState holds 2 floats per stage and channel.
+ */
+typedef struct
+{
+    uint32_t        numStages;      /*!< Second-order sections */
+    const float     *pCoeffs;       /*!< 5 * numStages coefficients */
+    float           *pState;        /*!< Delay line */
+} dsp_biquad_f32_t;
+
+/**
+ *  @brief  Float radix-4 FFT of length 4^k, complex interleaved in place.
+ */
+typedef struct
+{
+    uint32_t        fftLen;         /*!< Transform length */
+    const float     *pTwiddle;      /*!< DSP_FFT_F32_TWIDDLE_LEN(fftLen) floats set up by dsp_fft_f32_init() */
+} dsp_fft_f32_t;
+
+/**
+ *  @brief  Q15 radix-4 FFT of length 4^k, complex interleaved in place.
+ *          Each stage scales by 1/4, so the output is the DFT divided by fftLen.
+ */
+typedef struct
+{
+    uint32_t        fftLen;         /*!< Transform length */
+    const int16_t   *pTwiddle;      /*!< DSP_FFT_Q15_TWIDDLE_LEN(fftLen) halfwords set up by dsp_fft_q15_init() */
+} dsp_fft_q15_t;
+
+/*! @}*/ /* end of group DSP_EXPORTED_STRUCTS */
+
+
+/** @addtogroup DSP_EXPORTED_FUNCTIONS DSP Library Exported Functions
+  @{
+*/
+
+/* Kernel selection */
+void dsp_set_neon(int enable);
+int  dsp_neon_enabled(void);
+
+/* Sample conversion. stride is the distance between samples of one channel,
+   e.g. the number of sample modules in an EADC_SVC block. */
+void dsp_u16_to_f32(const uint16_t *pSrc, uint32_t stride, float *pDst, uint32_t n, float offset, float scale);
+void dsp_q15_to_f32(const int16_t *pSrc, uint32_t stride, float *pDst, uint32_t n);
+void dsp_f32_to_q15(const float *pSrc, int16_t *pDst, uint32_t n);
+
+/* FIR filters and decimator */
+int  dsp_fir_f32_init(dsp_fir_f32_t *S, uint32_t numTaps, const float *pCoeffs, float *pState, uint32_t blockSize);
+void dsp_fir_f32(dsp_fir_f32_t *S, const float *pSrc, float *pDst, uint32_t n);
+int  dsp_fir_q15_init(dsp_fir_q15_t *S, uint32_t numTaps, const int16_t *pCoeffs, int16_t *pState, uint32_t blockSize);
+void dsp_fir_q15(dsp_fir_q15_t *S, const int16_t *pSrc, int16_t *pDst, uint32_t n);
+int  dsp_fir_decim_f32_init(dsp_fir_decim_f32_t *S, uint32_t M, uint32_t numTaps, const float *pCoeffs,
+                            float *pState, uint32_t blockSize);
+void dsp_fir_decim_f32(dsp_fir_decim_f32_t *S, const float *pSrc, float *pDst, uint32_t n);
+
+/* Biquad cascades. The 4-channel version filters x[4 * i + ch] of four
+   interleaved channels with the same coefficients and its own state. */
+void dsp_biquad_f32_init(dsp_biquad_f32_t *S, uint32_t numStages, const float *pCoeffs, float *pState);
+void dsp_biquad_f32(dsp_biquad_f32_t *S, const float *pSrc, float *pDst, uint32_t n);
+void dsp_biquad4_f32_init(dsp_biquad_f32_t *S, uint32_t numStages, const float *pCoeffs, float *pState);
+void dsp_biquad4_f32(dsp_biquad_f32_t *S, const float *pSrc, float *pDst, uint32_t frames);
+
+/* Radix-4 FFT. Output is in natural order. The inverse is not scaled. */
+int  dsp_fft_f32_init(dsp_fft_f32_t *S, uint32_t fftLen, float *pTwiddle);
+void dsp_fft_f32(const dsp_fft_f32_t *S, float *pData, int inverse);
+int  dsp_fft_q15_init(dsp_fft_q15_t *S, uint32_t fftLen, int16_t *pTwiddle);
+void dsp_fft_q15(const dsp_fft_q15_t *S, int16_t *pData);
+
+/* RMS and peak magnitude over a window of n samples */
+void dsp_rms_peak_f32(const float *pSrc, uint32_t n, float *pRms, float *pPeak);
+void dsp_rms_peak_q15(const int16_t *pSrc, uint32_t n, int16_t *pRms, int16_t *pPeak);
+
+/*! @}*/ /* end of group DSP_EXPORTED_FUNCTIONS */
+
+/*! @}*/ /* end of group DSP_Library */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NU_DSP_H__ */
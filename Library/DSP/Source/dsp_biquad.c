@@ -0,0 +1,149 @@
+/**************************************************************************//**
+ * @file     dsp_biquad.c
+ * @brief    Biquad IIR cascades, transposed direct form II
+ *
+ *           A single channel is a chain of dependent operations, so it runs
+ *           in scalar code on either path. The 4-channel version keeps one
+ *           channel per vector lane, which is how interleaved frames of four
+ *           EADC sample modules arrive.
+ *
+ *           Per sample and stage:
+ *               y  = b0 x + d1
+ *               d1 = b1 x + (a1 y + d2)
+ *               d2 = b2 x + a2 y
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <string.h>
+#include "dsp_internal.h"
+
+/**
+ *  @brief  Set up a single-channel biquad cascade
+ *  @param[out] S           Filter instance
+ *  @param[in]  numStages   Second-order sections
+ *  @param[in]  pCoeffs     {b0, b1, b2, a1, a2} per stage
+ *  @param[in]  pState      2 * numStages floats
+ */
+void dsp_biquad_f32_init(dsp_biquad_f32_t *S, uint32_t numStages, const float *pCoeffs, float *pState)
+{
+    S->numStages = numStages;
+    S->pCoeffs = pCoeffs;
+    S->pState = pState;
+    memset(pState, 0, 2U * numStages * sizeof(float));
+}
+
+/**
+ *  @brief  Filter a block with a single-channel biquad cascade
+ *  @param[in]  S       Filter instance
+ *  @param[in]  pSrc    n input samples
+ *  @param[out] pDst    n output samples, may be pSrc
+ *  @param[in]  n       Samples
+ */
+void dsp_biquad_f32(dsp_biquad_f32_t *S, const float *pSrc, float *pDst, uint32_t n)
+{
+    const float *c = S->pCoeffs;
+    float       *d = S->pState;
+    const float *in = pSrc;
+    uint32_t    st, i;
+    float       b0, b1, b2, a1, a2, d1, d2, x, y;
+
+    for (st = 0; st < S->numStages; st++, c += 5, d += 2)
+    {
+        b0 = c[0];
+        b1 = c[1];
+        b2 = c[2];
+        a1 = c[3];
+        a2 = c[4];
+        d1 = d[0];
+        d2 = d[1];
+
+        for (i = 0; i < n; i++)
+        {
+            x = in[i];
+            y = fmaf(b0, x, d1);
+            d1 = fmaf(b1, x, fmaf(a1, y, d2));
+            d2 = fmaf(b2, x, a2 * y);
+            pDst[i] = y;
+        }
+
+        d[0] = d1;
+        d[1] = d2;
+        in = pDst;
+    }
+}
+
+/**
+ *  @brief  Set up a 4-channel biquad cascade
+ *  @param[out] S           Filter instance
+ *  @param[in]  numStages   Second-order sections, shared by the channels
+ *  @param[in]  pCoeffs     {b0, b1, b2, a1, a2} per stage
+ *  @param[in]  pState      8 * numStages floats
+ */
+void dsp_biquad4_f32_init(dsp_biquad_f32_t *S, uint32_t numStages, const float *pCoeffs, float *pState)
+{
+    S->numStages = numStages;
+    S->pCoeffs = pCoeffs;
+    S->pState = pState;
+    memset(pState, 0, 8U * numStages * sizeof(float));
+}
+
+/**
+ *  @brief  Filter four interleaved channels
+ *  @param[in]  S       Filter instance
+ *  @param[in]  pSrc    frames * 4 samples, channel ch of frame i at pSrc[4 * i + ch]
+ *  @param[out] pDst    frames * 4 samples, may be pSrc
+ *  @param[in]  frames  Frames
+ */
+void dsp_biquad4_f32(dsp_biquad_f32_t *S, const float *pSrc, float *pDst, uint32_t frames)
+{
+    const float *c = S->pCoeffs;
+    float       *d = S->pState;
+    const float *in = pSrc;
+    uint32_t    st, i, ch;
+
+    for (st = 0; st < S->numStages; st++, c += 5, d += 8)
+    {
+#if NU_DSP_NEON
+        if (DSP_USE_NEON())
+        {
+            float32x4_t b0 = vdupq_n_f32(c[0]), b1 = vdupq_n_f32(c[1]), b2 = vdupq_n_f32(c[2]);
+            float32x4_t a1 = vdupq_n_f32(c[3]), a2 = vdupq_n_f32(c[4]);
+            float32x4_t d1 = vld1q_f32(d), d2 = vld1q_f32(d + 4);
+            float32x4_t x, y;
+
+            for (i = 0; i < frames; i++)
+            {
+                x = vld1q_f32(in + 4U * i);
+                y = vfmaq_f32(d1, b0, x);
+                d1 = vfmaq_f32(vfmaq_f32(d2, a1, y), b1, x);
+                d2 = vfmaq_f32(vmulq_f32(a2, y), b2, x);
+                vst1q_f32(pDst + 4U * i, y);
+            }
+
+            vst1q_f32(d, d1);
+            vst1q_f32(d + 4, d2);
+        }
+        else
+#endif
+        {
+            for (ch = 0; ch < 4U; ch++)
+            {
+                float d1 = d[ch], d2 = d[4U + ch], x, y;
+
+                for (i = 0; i < frames; i++)
+                {
+                    x = in[4U * i + ch];
+                    y = fmaf(c[0], x, d1);
+                    d1 = fmaf(c[1], x, fmaf(c[3], y, d2));
+                    d2 = fmaf(c[2], x, c[4] * y);
+                    pDst[4U * i + ch] = y;
+                }
+
+                d[ch] = d1;
+                d[4U + ch] = d2;
+            }
+        }
+        in = pDst;
+    }
+}
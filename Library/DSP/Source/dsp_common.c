@@ -0,0 +1,72 @@
+/**************************************************************************//**
+ * @file     dsp_common.c
+ * @brief    DSP library kernel selection and helpers
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include "dsp_internal.h"
+
+int g_dsp_neon = NU_DSP_NEON;
+
+/**
+ *  @brief  Select the NEON or the C kernels
+ *  @param[in]  enable  Non-zero for NEON. Ignored when built without NEON.
+ */
+void dsp_set_neon(int enable)
+{
+    g_dsp_neon = NU_DSP_NEON && enable;
+}
+
+/**
+ *  @brief  Kernels in use
+ *  @return 1 if the NEON kernels run, 0 for the C kernels
+ */
+int dsp_neon_enabled(void)
+{
+    return DSP_USE_NEON();
+}
+
+/*
+ *  sin and cos in double precision for twiddle tables, without libm.
+ *  The angle is reduced to [-pi/4, pi/4] by quadrant and the Taylor series
+ *  are summed to well below double rounding.
+ */
+void dsp_sincos(double theta, double *pSin, double *pCos)
+{
+    const double half_pi = 1.57079632679489661923;
+    double q = theta / half_pi;
+    long   k = (long)(q < 0.0 ? q - 0.5 : q + 0.5);
+    double r = theta - (double)k * half_pi;
+    double r2 = r * r;
+    double s = r, c = 1.0, ts = r, tc = 1.0;
+    int    i;
+
+    for (i = 1; i < 12; i++)
+    {
+        ts *= -r2 / (double)((2 * i) * (2 * i + 1));
+        tc *= -r2 / (double)((2 * i - 1) * (2 * i));
+        s += ts;
+        c += tc;
+    }
+
+    switch (k & 3)
+    {
+    case 0:
+        *pSin = s;
+        *pCos = c;
+        break;
+    case 1:
+        *pSin = c;
+        *pCos = -s;
+        break;
+    case 2:
+        *pSin = -s;
+        *pCos = -c;
+        break;
+    default:
+        *pSin = -c;
+        *pCos = s;
+        break;
+    }
+}
@@ -0,0 +1,133 @@
+/**************************************************************************//**
+ * @file     dsp_conv.c
+ * @brief    Sample format conversion
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include "dsp_internal.h"
+
+#if NU_DSP_NEON
+/*
+ *  Load four samples of one channel. The strided loads read stride - 1
+ *  samples past the fourth one, so callers keep the last group for the
+ *  scalar tail.
+ */
+static inline uint16x4_t dsp_ld4_u16(const uint16_t *p, uint32_t stride)
+{
+    switch (stride)
+    {
+    case 1:
+        return vld1_u16(p);
+    case 2:
+        return vld2_u16(p).val[0];
+    case 3:
+        return vld3_u16(p).val[0];
+    case 4:
+        return vld4_u16(p).val[0];
+    default:
+    {
+        uint16x4_t v = vdup_n_u16(p[0]);
+        v = vset_lane_u16(p[stride], v, 1);
+        v = vset_lane_u16(p[2 * stride], v, 2);
+        return vset_lane_u16(p[3 * stride], v, 3);
+    }
+    }
+}
+#endif
+
+/**
+ *  @brief  Convert unsigned samples, e.g. EADC results, to float
+ *  @param[in]  pSrc    First sample of the channel
+ *  @param[in]  stride  Samples between two samples of the channel
+ *  @param[out] pDst    n floats, ((float)x - offset) * scale
+ *  @param[in]  n       Samples to convert
+ *  @param[in]  offset  Value of the zero level, e.g. 2048 for a 12-bit EADC around mid-scale
+ *  @param[in]  scale   Factor applied after the offset, e.g. 1.0f / 2048
+ */
+void dsp_u16_to_f32(const uint16_t *pSrc, uint32_t stride, float *pDst, uint32_t n, float offset, float scale)
+{
+    uint32_t i = 0;
+
+#if NU_DSP_NEON
+    if (DSP_USE_NEON())
+    {
+        float32x4_t vo = vdupq_n_f32(offset), vs = vdupq_n_f32(scale);
+
+        for (; i + 4 < n; i += 4)
+        {
+            float32x4_t v = vcvtq_f32_u32(vmovl_u16(dsp_ld4_u16(pSrc + i * stride, stride)));
+            vst1q_f32(pDst + i, vmulq_f32(vsubq_f32(v, vo), vs));
+        }
+    }
+#endif
+
+    for (; i < n; i++)
+        pDst[i] = ((float)pSrc[i * stride] - offset) * scale;
+}
+
+/**
+ *  @brief  Convert Q15 samples, e.g. I2S data, to float in [-1, 1)
+ *  @param[in]  pSrc    First sample of the channel
+ *  @param[in]  stride  Samples between two samples of the channel
+ *  @param[out] pDst    n floats
+ *  @param[in]  n       Samples to convert
+ */
+void dsp_q15_to_f32(const int16_t *pSrc, uint32_t stride, float *pDst, uint32_t n)
+{
+    uint32_t i = 0;
+
+#if NU_DSP_NEON
+    if (DSP_USE_NEON())
+    {
+        for (; i + 4 < n; i += 4)
+        {
+            int16x4_t v = vreinterpret_s16_u16(dsp_ld4_u16((const uint16_t *)pSrc + i * stride, stride));
+            /* Fixed-point conversion with 15 fraction bits is exact, as is the scalar x / 32768 */
+            vst1q_f32(pDst + i, vcvtq_n_f32_s32(vmovl_s16(v), 15));
+        }
+    }
+#endif
+
+    for (; i < n; i++)
+        pDst[i] = (float)pSrc[i * stride] * (1.0f / 32768.0f);
+}
+
+/**
+ *  @brief  Convert float to Q15, rounding to nearest and saturating
+ *  @param[in]  pSrc    n floats
+ *  @param[out] pDst    n Q15 samples
+ *  @param[in]  n       Samples to convert
+ */
+void dsp_f32_to_q15(const float *pSrc, int16_t *pDst, uint32_t n)
+{
+    uint32_t i = 0;
+
+#if NU_DSP_NEON
+    if (DSP_USE_NEON())
+    {
+        float32x4_t k = vdupq_n_f32(32768.0f);
+
+        for (; i + 4 <= n; i += 4)
+        {
+            int32x4_t v = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(pSrc + i), k));
+            vst1_s16(pDst + i, vqmovn_s32(v));
+        }
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        float v = rintf(pSrc[i] * 32768.0f);
+
+        /* Compared as float, as the vector conversion saturates before narrowing */
+        if (v >= 32767.0f)
+            pDst[i] = 32767;
+        else if (v <= -32768.0f)
+            pDst[i] = -32768;
+        else if (v != v)
+            pDst[i] = 0;
+        else
+            pDst[i] = (int16_t)v;
+    }
+}
@@ -0,0 +1,422 @@
+/**************************************************************************//**
+ * @file     dsp_fft.c
+ * @brief    Radix-4 decimation-in-frequency FFT
+ *
+ *           A stage with span L combines x[j], x[j + L], x[j + 2L], x[j + 3L]
+ *           of every group of 4L points and multiplies the results by
+ *           W^0, W^j, W^2j and W^3j, W = exp(-2 pi i / 4L). Stages with
+ *           L >= 4 run four values of j per vector; the last stage (L = 1)
+ *           has no twiddles and, like the final base-4 digit reversal, is
+ *           shared by both paths.
+ *
+ *           The twiddle table holds the stages from L = N / 4 down to 4, each
+ *           as blocks of four j: {w1re[4], w1im[4], w2re[4], w2im[4], w3re[4],
+ *           w3im[4]}, which is 6L entries per stage and 2N - 8 in total.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include "dsp_internal.h"
+
+/// @cond HIDDEN_SYMBOLS
+
+static int dsp_fft_len_ok(uint32_t fftLen)
+{
+    /* A power of 4: one bit set, at an even position */
+    return (fftLen >= DSP_FFT_MIN) && (fftLen <= DSP_FFT_MAX) &&
+           ((fftLen & (fftLen - 1U)) == 0U) && ((fftLen & 0x55555555U) != 0U);
+}
+
+/* Fill one twiddle entry: m-th power of W^j for the stage with span L */
+static void dsp_fft_twiddle(uint32_t L, uint32_t j, uint32_t m, double *pRe, double *pIm)
+{
+    const double two_pi = 6.28318530717958647693;
+    double s, c;
+
+    dsp_sincos(two_pi * (double)(m * j) / (double)(4U * L), &s, &c);
+    *pRe = c;
+    *pIm = -s;
+}
+
+static uint32_t dsp_fft_tw_index(uint32_t j, uint32_t m, uint32_t part)
+{
+    /* part 0 is the real, part 1 the imaginary half of W^mj, m = 1..3 */
+    return (j / 4U) * 24U + ((m - 1U) * 2U + part) * 4U + (j % 4U);
+}
+
+static void dsp_fft_digit_reverse_f32(float *pData, uint32_t fftLen)
+{
+    uint32_t i, r, t, d;
+    float    re, im;
+
+    for (i = 1; i < fftLen - 1U; i++)
+    {
+        r = 0;
+        for (t = i, d = fftLen; d > 1U; d >>= 2)
+        {
+            r = (r << 2) | (t & 3U);
+            t >>= 2;
+        }
+        if (r > i)
+        {
+            re = pData[2U * i];
+            im = pData[2U * i + 1U];
+            pData[2U * i] = pData[2U * r];
+            pData[2U * i + 1U] = pData[2U * r + 1U];
+            pData[2U * r] = re;
+            pData[2U * r + 1U] = im;
+        }
+    }
+}
+
+static void dsp_fft_digit_reverse_q15(int16_t *pData, uint32_t fftLen)
+{
+    uint32_t i, r, t, d;
+    int16_t  re, im;
+
+    for (i = 1; i < fftLen - 1U; i++)
+    {
+        r = 0;
+        for (t = i, d = fftLen; d > 1U; d >>= 2)
+        {
+            r = (r << 2) | (t & 3U);
+            t >>= 2;
+        }
+        if (r > i)
+        {
+            re = pData[2U * i];
+            im = pData[2U * i + 1U];
+            pData[2U * i] = pData[2U * r];
+            pData[2U * i + 1U] = pData[2U * r + 1U];
+            pData[2U * r] = re;
+            pData[2U * r + 1U] = im;
+        }
+    }
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+/**
+ *  @brief  Set up a float FFT
+ *  @param[out] S           FFT instance
+ *  @param[in]  fftLen      Power of 4 from DSP_FFT_MIN to DSP_FFT_MAX
+ *  @param[in]  pTwiddle    DSP_FFT_F32_TWIDDLE_LEN(fftLen) floats, filled here
+ *  @return DSP_OK or DSP_ERR_PARAM
+ */
+int dsp_fft_f32_init(dsp_fft_f32_t *S, uint32_t fftLen, float *pTwiddle)
+{
+    uint32_t L, j, m;
+    float    *tw = pTwiddle;
+    double   re, im;
+
+    if (!dsp_fft_len_ok(fftLen))
+        return DSP_ERR_PARAM;
+
+    for (L = fftLen / 4U; L >= 4U; tw += 6U * L, L /= 4U)
+    {
+        for (j = 0; j < L; j++)
+        {
+            for (m = 1; m <= 3U; m++)
+            {
+                dsp_fft_twiddle(L, j, m, &re, &im);
+                tw[dsp_fft_tw_index(j, m, 0)] = (float)re;
+                tw[dsp_fft_tw_index(j, m, 1)] = (float)im;
+            }
+        }
+    }
+
+    S->fftLen = fftLen;
+    S->pTwiddle = pTwiddle;
+    return DSP_OK;
+}
+
+/**
+ *  @brief  Float FFT in place
+ *  @param[in]      S       FFT instance
+ *  @param[in,out]  pData   fftLen complex values {re, im}, natural order in and out
+ *  @param[in]      inverse Non-zero for the inverse transform, not scaled by 1 / fftLen
+ */
+void dsp_fft_f32(const dsp_fft_f32_t *S, float *pData, int inverse)
+{
+    uint32_t    N = S->fftLen;
+    const float *tw = S->pTwiddle;
+    uint32_t    L, g, j, m;
+    float       *p;
+
+    /* The inverse is the conjugate of the forward transform of the conjugate */
+    if (inverse)
+    {
+        for (j = 0; j < N; j++)
+            pData[2U * j + 1U] = -pData[2U * j + 1U];
+    }
+
+    for (L = N / 4U; L >= 4U; tw += 6U * L, L /= 4U)
+    {
+        for (g = 0; g < N; g += 4U * L)
+        {
+            p = pData + 2U * g;
+            j = 0;
+
+#if NU_DSP_NEON
+            if (DSP_USE_NEON())
+            {
+                for (; j < L; j += 4U)
+                {
+                    const float *w = tw + 6U * j;
+                    float32x4x2_t a = vld2q_f32(p + 2U * j);
+                    float32x4x2_t b = vld2q_f32(p + 2U * (j + L));
+                    float32x4x2_t c = vld2q_f32(p + 2U * (j + 2U * L));
+                    float32x4x2_t d = vld2q_f32(p + 2U * (j + 3U * L));
+                    float32x4_t   t0r = vaddq_f32(a.val[0], c.val[0]), t0i = vaddq_f32(a.val[1], c.val[1]);
+                    float32x4_t   t1r = vsubq_f32(a.val[0], c.val[0]), t1i = vsubq_f32(a.val[1], c.val[1]);
+                    float32x4_t   t2r = vaddq_f32(b.val[0], d.val[0]), t2i = vaddq_f32(b.val[1], d.val[1]);
+                    float32x4_t   t3r = vsubq_f32(b.val[0], d.val[0]), t3i = vsubq_f32(b.val[1], d.val[1]);
+                    float32x4_t   yr[3], yi[3], wr, wi;
+                    float32x4x2_t o;
+
+                    o.val[0] = vaddq_f32(t0r, t2r);
+                    o.val[1] = vaddq_f32(t0i, t2i);
+                    vst2q_f32(p + 2U * j, o);
+
+                    yr[0] = vaddq_f32(t1r, t3i);
+                    yi[0] = vsubq_f32(t1i, t3r);
+                    yr[1] = vsubq_f32(t0r, t2r);
+                    yi[1] = vsubq_f32(t0i, t2i);
+                    yr[2] = vsubq_f32(t1r, t3i);
+                    yi[2] = vaddq_f32(t1i, t3r);
+
+                    for (m = 0; m < 3U; m++)
+                    {
+                        wr = vld1q_f32(w + 8U * m);
+                        wi = vld1q_f32(w + 8U * m + 4U);
+                        o.val[0] = vfmaq_f32(vnegq_f32(vmulq_f32(yi[m], wi)), yr[m], wr);
+                        o.val[1] = vfmaq_f32(vmulq_f32(yi[m], wr), yr[m], wi);
+                        vst2q_f32(p + 2U * (j + (m + 1U) * L), o);
+                    }
+                }
+            }
+#endif
+
+            for (; j < L; j++)
+            {
+                float *pa = p + 2U * j, *pb = pa + 2U * L, *pc = pb + 2U * L, *pd = pc + 2U * L;
+                float t0r = pa[0] + pc[0], t0i = pa[1] + pc[1];
+                float t1r = pa[0] - pc[0], t1i = pa[1] - pc[1];
+                float t2r = pb[0] + pd[0], t2i = pb[1] + pd[1];
+                float t3r = pb[0] - pd[0], t3i = pb[1] - pd[1];
+                float yr[3], yi[3], wr, wi;
+                float *out[3];
+
+                out[0] = pb;
+                out[1] = pc;
+                out[2] = pd;
+
+                pa[0] = t0r + t2r;
+                pa[1] = t0i + t2i;
+
+                yr[0] = t1r + t3i;
+                yi[0] = t1i - t3r;
+                yr[1] = t0r - t2r;
+                yi[1] = t0i - t2i;
+                yr[2] = t1r - t3i;
+                yi[2] = t1i + t3r;
+
+                for (m = 0; m < 3U; m++)
+                {
+                    wr = tw[dsp_fft_tw_index(j, m + 1U, 0)];
+                    wi = tw[dsp_fft_tw_index(j, m + 1U, 1)];
+                    out[m][0] = fmaf(yr[m], wr, -(yi[m] * wi));
+                    out[m][1] = fmaf(yr[m], wi, yi[m] * wr);
+                }
+            }
+        }
+    }
+
+    /* Last stage, L = 1 */
+    for (g = 0; g < N; g += 4U)
+    {
+        float *pa = pData + 2U * g;
+        float t0r = pa[0] + pa[4], t0i = pa[1] + pa[5];
+        float t1r = pa[0] - pa[4], t1i = pa[1] - pa[5];
+        float t2r = pa[2] + pa[6], t2i = pa[3] + pa[7];
+        float t3r = pa[2] - pa[6], t3i = pa[3] - pa[7];
+
+        pa[0] = t0r + t2r;
+        pa[1] = t0i + t2i;
+        pa[2] = t1r + t3i;
+        pa[3] = t1i - t3r;
+        pa[4] = t0r - t2r;
+        pa[5] = t0i - t2i;
+        pa[6] = t1r - t3i;
+        pa[7] = t1i + t3r;
+    }
+
+    dsp_fft_digit_reverse_f32(pData, N);
+
+    if (inverse)
+    {
+        for (j = 0; j < N; j++)
+            pData[2U * j + 1U] = -pData[2U * j + 1U];
+    }
+}
+
+/**
+ *  @brief  Set up a Q15 FFT
+ *  @param[out] S           FFT instance
+ *  @param[in]  fftLen      Power of 4 from DSP_FFT_MIN to DSP_FFT_MAX
+ *  @param[in]  pTwiddle    DSP_FFT_Q15_TWIDDLE_LEN(fftLen) halfwords, filled here
+ *  @return DSP_OK or DSP_ERR_PARAM
+ */
+int dsp_fft_q15_init(dsp_fft_q15_t *S, uint32_t fftLen, int16_t *pTwiddle)
+{
+    uint32_t L, j, m;
+    int16_t  *tw = pTwiddle;
+    double   re, im;
+
+    if (!dsp_fft_len_ok(fftLen))
+        return DSP_ERR_PARAM;
+
+    for (L = fftLen / 4U; L >= 4U; tw += 6U * L, L /= 4U)
+    {
+        for (j = 0; j < L; j++)
+        {
+            for (m = 1; m <= 3U; m++)
+            {
+                dsp_fft_twiddle(L, j, m, &re, &im);
+                re *= 32767.0;
+                im *= 32767.0;
+                tw[dsp_fft_tw_index(j, m, 0)] = (int16_t)(re < 0.0 ? re - 0.5 : re + 0.5);
+                tw[dsp_fft_tw_index(j, m, 1)] = (int16_t)(im < 0.0 ? im - 0.5 : im + 0.5);
+            }
+        }
+    }
+
+    S->fftLen = fftLen;
+    S->pTwiddle = pTwiddle;
+    return DSP_OK;
+}
+
+/**
+ *  @brief  Q15 forward FFT in place
+ *  @param[in]      S       FFT instance
+ *  @param[in,out]  pData   fftLen complex values {re, im}, natural order in and out.
+ *                          The output is the DFT divided by fftLen.
+ *
+ *  Every stage divides its inputs by 4 with an arithmetic shift, so no
+ *  butterfly can overflow. Twiddle products are truncated to Q15 and
+ *  saturated.
+ */
+void dsp_fft_q15(const dsp_fft_q15_t *S, int16_t *pData)
+{
+    uint32_t      N = S->fftLen;
+    const int16_t *tw = S->pTwiddle;
+    uint32_t      L, g, j, m;
+    int16_t       *p;
+
+    for (L = N / 4U; L >= 4U; tw += 6U * L, L /= 4U)
+    {
+        for (g = 0; g < N; g += 4U * L)
+        {
+            p = pData + 2U * g;
+            j = 0;
+
+#if NU_DSP_NEON
+            if (DSP_USE_NEON())
+            {
+                for (; j < L; j += 4U)
+                {
+                    const int16_t *w = tw + 6U * j;
+                    int16x4x2_t a = vld2_s16(p + 2U * j);
+                    int16x4x2_t b = vld2_s16(p + 2U * (j + L));
+                    int16x4x2_t c = vld2_s16(p + 2U * (j + 2U * L));
+                    int16x4x2_t d = vld2_s16(p + 2U * (j + 3U * L));
+                    int16x4_t   ar = vshr_n_s16(a.val[0], 2), ai = vshr_n_s16(a.val[1], 2);
+                    int16x4_t   br = vshr_n_s16(b.val[0], 2), bi = vshr_n_s16(b.val[1], 2);
+                    int16x4_t   cr = vshr_n_s16(c.val[0], 2), ci = vshr_n_s16(c.val[1], 2);
+                    int16x4_t   dr = vshr_n_s16(d.val[0], 2), di = vshr_n_s16(d.val[1], 2);
+                    int16x4_t   t0r = vadd_s16(ar, cr), t0i = vadd_s16(ai, ci);
+                    int16x4_t   t1r = vsub_s16(ar, cr), t1i = vsub_s16(ai, ci);
+                    int16x4_t   t2r = vadd_s16(br, dr), t2i = vadd_s16(bi, di);
+                    int16x4_t   t3r = vsub_s16(br, dr), t3i = vsub_s16(bi, di);
+                    int16x4_t   yr[3], yi[3], wr, wi;
+                    int16x4x2_t o;
+
+                    o.val[0] = vadd_s16(t0r, t2r);
+                    o.val[1] = vadd_s16(t0i, t2i);
+                    vst2_s16(p + 2U * j, o);
+
+                    yr[0] = vadd_s16(t1r, t3i);
+                    yi[0] = vsub_s16(t1i, t3r);
+                    yr[1] = vsub_s16(t0r, t2r);
+                    yi[1] = vsub_s16(t0i, t2i);
+                    yr[2] = vsub_s16(t1r, t3i);
+                    yi[2] = vadd_s16(t1i, t3r);
+
+                    for (m = 0; m < 3U; m++)
+                    {
+                        wr = vld1_s16(w + 8U * m);
+                        wi = vld1_s16(w + 8U * m + 4U);
+                        o.val[0] = vqshrn_n_s32(vmlsl_s16(vmull_s16(yr[m], wr), yi[m], wi), 15);
+                        o.val[1] = vqshrn_n_s32(vmlal_s16(vmull_s16(yr[m], wi), yi[m], wr), 15);
+                        vst2_s16(p + 2U * (j + (m + 1U) * L), o);
+                    }
+                }
+            }
+#endif
+
+            for (; j < L; j++)
+            {
+                int16_t *pa = p + 2U * j, *pb = pa + 2U * L, *pc = pb + 2U * L, *pd = pc + 2U * L;
+                int32_t ar = pa[0] >> 2, ai = pa[1] >> 2, br = pb[0] >> 2, bi = pb[1] >> 2;
+                int32_t cr = pc[0] >> 2, ci = pc[1] >> 2, dr = pd[0] >> 2, di = pd[1] >> 2;
+                int32_t t0r = ar + cr, t0i = ai + ci, t1r = ar - cr, t1i = ai - ci;
+                int32_t t2r = br + dr, t2i = bi + di, t3r = br - dr, t3i = bi - di;
+                int32_t yr[3], yi[3], wr, wi;
+                int16_t *out[3];
+
+                out[0] = pb;
+                out[1] = pc;
+                out[2] = pd;
+
+                pa[0] = (int16_t)(t0r + t2r);
+                pa[1] = (int16_t)(t0i + t2i);
+
+                yr[0] = t1r + t3i;
+                yi[0] = t1i - t3r;
+                yr[1] = t0r - t2r;
+                yi[1] = t0i - t2i;
+                yr[2] = t1r - t3i;
+                yi[2] = t1i + t3r;
+
+                for (m = 0; m < 3U; m++)
+                {
+                    wr = tw[dsp_fft_tw_index(j, m + 1U, 0)];
+                    wi = tw[dsp_fft_tw_index(j, m + 1U, 1)];
+                    out[m][0] = dsp_sat_q15((yr[m] * wr - yi[m] * wi) >> 15);
+                    out[m][1] = dsp_sat_q15((yr[m] * wi + yi[m] * wr) >> 15);
+                }
+            }
+        }
+    }
+
+    /* Last stage, L = 1 */
+    for (g = 0; g < N; g += 4U)
+    {
+        int16_t *pa = pData + 2U * g;
+        int32_t ar = pa[0] >> 2, ai = pa[1] >> 2, br = pa[2] >> 2, bi = pa[3] >> 2;
+        int32_t cr = pa[4] >> 2, ci = pa[5] >> 2, dr = pa[6] >> 2, di = pa[7] >> 2;
+        int32_t t0r = ar + cr, t0i = ai + ci, t1r = ar - cr, t1i = ai - ci;
+        int32_t t2r = br + dr, t2i = bi + di, t3r = br - dr, t3i = bi - di;
+
+        pa[0] = (int16_t)(t0r + t2r);
+        pa[1] = (int16_t)(t0i + t2i);
+        pa[2] = (int16_t)(t1r + t3i);
+        pa[3] = (int16_t)(t1i - t3r);
+        pa[4] = (int16_t)(t0r - t2r);
+        pa[5] = (int16_t)(t0i - t2i);
+        pa[6] = (int16_t)(t1r - t3i);
+        pa[7] = (int16_t)(t1i + t3r);
+    }
+
+    dsp_fft_digit_reverse_q15(pData, N);
+}
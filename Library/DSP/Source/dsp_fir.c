@@ -0,0 +1,244 @@
+/**************************************************************************//**
+ * @file     dsp_fir.c
+ * @brief    FIR filters and FIR decimator
+ *
+ *           The filters compute four consecutive outputs per vector, each
+ *           accumulating its taps from h[0] up with fused multiply-adds. The
+ *           decimator computes one output at a time with four partial sums
+ *           over the taps, reduced as (s0 + s1) + (s2 + s3), followed by the
+ *           leftover taps. The C code follows the same order.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <string.h>
+#include "dsp_internal.h"
+
+/**
+ *  @brief  Set up a float FIR filter
+ *  @param[out] S           Filter instance
+ *  @param[in]  numTaps     Filter length, at least 1
+ *  @param[in]  pCoeffs     numTaps coefficients, h[0] first
+ *  @param[in]  pState      numTaps - 1 + blockSize floats
+ *  @param[in]  blockSize   Most samples passed to one dsp_fir_f32() call
+ *  @return DSP_OK or DSP_ERR_PARAM
+ */
+int dsp_fir_f32_init(dsp_fir_f32_t *S, uint32_t numTaps, const float *pCoeffs, float *pState, uint32_t blockSize)
+{
+    if ((numTaps == 0U) || (blockSize == 0U))
+        return DSP_ERR_PARAM;
+
+    S->numTaps = numTaps;
+    S->blockSize = blockSize;
+    S->pCoeffs = pCoeffs;
+    S->pState = pState;
+    memset(pState, 0, (numTaps - 1U + blockSize) * sizeof(float));
+    return DSP_OK;
+}
+
+/**
+ *  @brief  Filter a block with a float FIR filter
+ *  @param[in]  S       Filter instance
+ *  @param[in]  pSrc    n input samples
+ *  @param[out] pDst    n output samples, may be pSrc
+ *  @param[in]  n       Samples, at most blockSize
+ */
+void dsp_fir_f32(dsp_fir_f32_t *S, const float *pSrc, float *pDst, uint32_t n)
+{
+    const float *h = S->pCoeffs;
+    uint32_t    taps = S->numTaps;
+    float       *b = S->pState;
+    /* x[i - k] is xs[i - k], with the history right in front of the block */
+    const float *xs = b + taps - 1U;
+    uint32_t    i = 0, k;
+    float       acc;
+
+    memcpy(b + taps - 1U, pSrc, n * sizeof(float));
+
+#if NU_DSP_NEON
+    if (DSP_USE_NEON())
+    {
+        for (; i + 4U <= n; i += 4U)
+        {
+            float32x4_t vacc = vdupq_n_f32(0.0f);
+
+            for (k = 0; k < taps; k++)
+                vacc = vfmaq_n_f32(vacc, vld1q_f32(xs + i - k), h[k]);
+            vst1q_f32(pDst + i, vacc);
+        }
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        acc = 0.0f;
+        for (k = 0; k < taps; k++)
+            acc = fmaf(xs[(int32_t)(i - k)], h[k], acc);
+        pDst[i] = acc;
+    }
+
+    memmove(b, b + n, (taps - 1U) * sizeof(float));
+}
+
+/**
+ *  @brief  Set up a Q15 FIR filter
+ *  @param[out] S           Filter instance
+ *  @param[in]  numTaps     Filter length, at least 1
+ *  @param[in]  pCoeffs     numTaps Q15 coefficients, h[0] first
+ *  @param[in]  pState      numTaps - 1 + blockSize halfwords
+ *  @param[in]  blockSize   Most samples passed to one dsp_fir_q15() call
+ *  @return DSP_OK or DSP_ERR_PARAM
+ */
+int dsp_fir_q15_init(dsp_fir_q15_t *S, uint32_t numTaps, const int16_t *pCoeffs, int16_t *pState, uint32_t blockSize)
+{
+    if ((numTaps == 0U) || (blockSize == 0U))
+        return DSP_ERR_PARAM;
+
+    S->numTaps = numTaps;
+    S->blockSize = blockSize;
+    S->pCoeffs = pCoeffs;
+    S->pState = pState;
+    memset(pState, 0, (numTaps - 1U + blockSize) * sizeof(int16_t));
+    return DSP_OK;
+}
+
+/**
+ *  @brief  Filter a block with a Q15 FIR filter
+ *  @param[in]  S       Filter instance
+ *  @param[in]  pSrc    n input samples
+ *  @param[out] pDst    n output samples, may be pSrc. Each is the exact sum of
+ *                      products, rounded to Q15 and saturated.
+ *  @param[in]  n       Samples, at most blockSize
+ */
+void dsp_fir_q15(dsp_fir_q15_t *S, const int16_t *pSrc, int16_t *pDst, uint32_t n)
+{
+    const int16_t *h = S->pCoeffs;
+    uint32_t      taps = S->numTaps;
+    int16_t       *b = S->pState;
+    const int16_t *xs = b + taps - 1U;
+    uint32_t      i = 0, k;
+    int64_t       acc;
+
+    memcpy(b + taps - 1U, pSrc, n * sizeof(int16_t));
+
+#if NU_DSP_NEON
+    if (DSP_USE_NEON())
+    {
+        for (; i + 4U <= n; i += 4U)
+        {
+            int64x2_t lo = vdupq_n_s64(0), hi = vdupq_n_s64(0);
+            int32x4_t p;
+
+            for (k = 0; k < taps; k++)
+            {
+                p = vmull_n_s16(vld1_s16(xs + i - k), h[k]);
+                lo = vaddw_s32(lo, vget_low_s32(p));
+                hi = vaddw_high_s32(hi, p);
+            }
+            lo = vshrq_n_s64(vaddq_s64(lo, vdupq_n_s64(1 << 14)), 15);
+            hi = vshrq_n_s64(vaddq_s64(hi, vdupq_n_s64(1 << 14)), 15);
+            vst1_s16(pDst + i, vqmovn_s32(vcombine_s32(vqmovn_s64(lo), vqmovn_s64(hi))));
+        }
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        acc = 0;
+        for (k = 0; k < taps; k++)
+            acc += (int32_t)xs[(int32_t)(i - k)] * h[k];
+        pDst[i] = dsp_sat_q15((acc + (1 << 14)) >> 15);
+    }
+
+    memmove(b, b + n, (taps - 1U) * sizeof(int16_t));
+}
+
+/**
+ *  @brief  Set up a float FIR decimator
+ *  @param[out] S           Decimator instance
+ *  @param[in]  M           Decimation factor, at least 1
+ *  @param[in]  numTaps     Filter length, at least 1
+ *  @param[in]  pCoeffs     numTaps coefficients, h[0] first
+ *  @param[in]  pState      numTaps - 1 + blockSize floats
+ *  @param[in]  blockSize   Most input samples passed to one call, a multiple of M
+ *  @return DSP_OK or DSP_ERR_PARAM
+ */
+int dsp_fir_decim_f32_init(dsp_fir_decim_f32_t *S, uint32_t M, uint32_t numTaps, const float *pCoeffs,
+                           float *pState, uint32_t blockSize)
+{
+    if ((M == 0U) || (numTaps == 0U) || (blockSize == 0U) || (blockSize % M))
+        return DSP_ERR_PARAM;
+
+    S->M = M;
+    S->numTaps = numTaps;
+    S->blockSize = blockSize;
+    S->pCoeffs = pCoeffs;
+    S->pState = pState;
+    memset(pState, 0, (numTaps - 1U + blockSize) * sizeof(float));
+    return DSP_OK;
+}
+
+/**
+ *  @brief  Filter and decimate a block
+ *  @param[in]  S       Decimator instance
+ *  @param[in]  pSrc    n input samples
+ *  @param[out] pDst    n / M output samples, y[m] = sum h[k] x[m * M + M - 1 - k]
+ *  @param[in]  n       Input samples, a multiple of M and at most blockSize
+ */
+void dsp_fir_decim_f32(dsp_fir_decim_f32_t *S, const float *pSrc, float *pDst, uint32_t n)
+{
+    const float *h = S->pCoeffs;
+    uint32_t    taps = S->numTaps;
+    uint32_t    M = S->M;
+    float       *b = S->pState;
+    uint32_t    groups = taps / 4U;
+    uint32_t    m, j, k;
+    const float *x;
+    float       s0, s1, s2, s3, acc;
+
+    memcpy(b + taps - 1U, pSrc, n * sizeof(float));
+
+    for (m = 0; m < n / M; m++)
+    {
+        /* x[-k] is the k-th sample back from the newest one of this output */
+        x = b + taps - 1U + m * M + M - 1U;
+
+#if NU_DSP_NEON
+        if (DSP_USE_NEON())
+        {
+            float32x4_t vs = vdupq_n_f32(0.0f), vx;
+
+            for (j = 0; j < groups; j++)
+            {
+                /* Lane l takes x[-4j - l]: load x[-4j - 3] .. x[-4j] and reverse */
+                vx = vld1q_f32(x - 4U * j - 3U);
+                vx = vrev64q_f32(vcombine_f32(vget_high_f32(vx), vget_low_f32(vx)));
+                vs = vfmaq_f32(vs, vx, vld1q_f32(h + 4U * j));
+            }
+            s0 = vgetq_lane_f32(vs, 0);
+            s1 = vgetq_lane_f32(vs, 1);
+            s2 = vgetq_lane_f32(vs, 2);
+            s3 = vgetq_lane_f32(vs, 3);
+        }
+        else
+#endif
+        {
+            s0 = s1 = s2 = s3 = 0.0f;
+            for (j = 0; j < groups; j++)
+            {
+                k = 4U * j;
+                s0 = fmaf(x[-(int32_t)k], h[k], s0);
+                s1 = fmaf(x[-(int32_t)k - 1], h[k + 1U], s1);
+                s2 = fmaf(x[-(int32_t)k - 2], h[k + 2U], s2);
+                s3 = fmaf(x[-(int32_t)k - 3], h[k + 3U], s3);
+            }
+        }
+
+        acc = (s0 + s1) + (s2 + s3);
+        for (k = groups * 4U; k < taps; k++)
+            acc = fmaf(x[-(int32_t)k], h[k], acc);
+        pDst[m] = acc;
+    }
+
+    memmove(b, b + n, (taps - 1U) * sizeof(float));
+}
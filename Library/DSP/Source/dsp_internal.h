@@ -0,0 +1,38 @@
+/**************************************************************************//**
+ * @file     dsp_internal.h
+ * @brief    DSP library internal definitions
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __DSP_INTERNAL_H__
+#define __DSP_INTERNAL_H__
+
+#include <stddef.h>
+#include <math.h>
+#include "nu_dsp.h"
+
+/* Build with NU_DSP_NO_NEON to leave only the C kernels */
+#if defined(__aarch64__) && defined(__ARM_NEON) && !defined(NU_DSP_NO_NEON)
+#define NU_DSP_NEON     1
+#include <arm_neon.h>
+#else
+#define NU_DSP_NEON     0
+#endif
+
+extern int g_dsp_neon;
+
+#define DSP_USE_NEON()  (NU_DSP_NEON && g_dsp_neon)
+
+static inline int16_t dsp_sat_q15(int64_t v)
+{
+    if (v > 32767)
+        return 32767;
+    if (v < -32768)
+        return -32768;
+    return (int16_t)v;
+}
+
+void dsp_sincos(double theta, double *pSin, double *pCos);
+
+#endif /* __DSP_INTERNAL_H__ */
@@ -0,0 +1,118 @@
+/**************************************************************************//**
+ * @file     dsp_stats.c
+ * @brief    RMS and peak magnitude
+ *
+ *           The float sum of squares runs in four partial sums over x[4i + l],
+ *           reduced as (s0 + s1) + (s2 + s3) before the leftover samples. The
+ *           Q15 sum of squares is exact in 64 bits.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include "dsp_internal.h"
+
+/**
+ *  @brief  RMS and peak magnitude of float samples
+ *  @param[in]  pSrc    n samples
+ *  @param[in]  n       Samples, at least 1
+ *  @param[out] pRms    sqrt(sum(x^2) / n)
+ *  @param[out] pPeak   max |x|
+ */
+void dsp_rms_peak_f32(const float *pSrc, uint32_t n, float *pRms, float *pPeak)
+{
+    uint32_t groups = n / 4U;
+    uint32_t i;
+    float    s0, s1, s2, s3, sum, peak = 0.0f, a;
+
+#if NU_DSP_NEON
+    if (DSP_USE_NEON())
+    {
+        float32x4_t vs = vdupq_n_f32(0.0f), vp = vdupq_n_f32(0.0f), v;
+
+        for (i = 0; i < groups; i++)
+        {
+            v = vld1q_f32(pSrc + 4U * i);
+            vs = vfmaq_f32(vs, v, v);
+            vp = vmaxnmq_f32(vp, vabsq_f32(v));
+        }
+        s0 = vgetq_lane_f32(vs, 0);
+        s1 = vgetq_lane_f32(vs, 1);
+        s2 = vgetq_lane_f32(vs, 2);
+        s3 = vgetq_lane_f32(vs, 3);
+        peak = vmaxnmvq_f32(vp);
+    }
+    else
+#endif
+    {
+        s0 = s1 = s2 = s3 = 0.0f;
+        for (i = 0; i < groups; i++)
+        {
+            const float *x = pSrc + 4U * i;
+
+            s0 = fmaf(x[0], x[0], s0);
+            s1 = fmaf(x[1], x[1], s1);
+            s2 = fmaf(x[2], x[2], s2);
+            s3 = fmaf(x[3], x[3], s3);
+            peak = fmaxf(peak, fmaxf(fmaxf(fabsf(x[0]), fabsf(x[1])), fmaxf(fabsf(x[2]), fabsf(x[3]))));
+        }
+    }
+
+    sum = (s0 + s1) + (s2 + s3);
+    for (i = groups * 4U; i < n; i++)
+    {
+        a = pSrc[i];
+        sum = fmaf(a, a, sum);
+        peak = fmaxf(peak, fabsf(a));
+    }
+
+    *pRms = (n != 0U) ? sqrtf(sum / (float)n) : 0.0f;
+    *pPeak = peak;
+}
+
+/**
+ *  @brief  RMS and peak magnitude of Q15 samples
+ *  @param[in]  pSrc    n samples
+ *  @param[in]  n       Samples, at least 1
+ *  @param[out] pRms    sqrt(sum(x^2) / n), rounded
+ *  @param[out] pPeak   max |x|, with |-32768| saturated to 32767
+ */
+void dsp_rms_peak_q15(const int16_t *pSrc, uint32_t n, int16_t *pRms, int16_t *pPeak)
+{
+    uint64_t sum = 0;
+    int32_t  peak = 0, a;
+    uint32_t i = 0;
+
+#if NU_DSP_NEON
+    if (DSP_USE_NEON())
+    {
+        uint64x2_t vs = vdupq_n_u64(0);
+        int16x8_t  vp = vdupq_n_s16(0), v;
+
+        /* A Q15 square is at most 2^30, so it is also a valid unsigned lane for the pairwise 64-bit add */
+        for (; i + 8U <= n; i += 8U)
+        {
+            v = vld1q_s16(pSrc + i);
+            vs = vpadalq_u32(vs, vreinterpretq_u32_s32(vmull_s16(vget_low_s16(v), vget_low_s16(v))));
+            vs = vpadalq_u32(vs, vreinterpretq_u32_s32(vmull_high_s16(v, v)));
+            vp = vmaxq_s16(vp, vqabsq_s16(v));
+        }
+        sum = vaddvq_u64(vs);
+        peak = vmaxvq_s16(vp);
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        a = pSrc[i];
+        sum += (uint64_t)(a * a);
+        a = (a < 0) ? -a : a;
+        if (a > 32767)
+            a = 32767;
+        if (a > peak)
+            peak = a;
+    }
+
+    /* Integer sum, so the result does not depend on the path taken */
+    *pRms = (n != 0U) ? dsp_sat_q15((int64_t)(sqrt((double)sum / (double)n) + 0.5)) : 0;
+    *pPeak = (int16_t)peak;
+}
@@ -0,0 +1,630 @@
+/**************************************************************************//**
+ * @file     test_dsp.c
+ * @brief    Host test of the DSP kernels. Every kernel is run on random data
+ *           in blocks of random length and must match a plain reference
+ *           implementation bit for bit. Each reference keeps the order of
+ *           operations documented for its kernel. The FFTs are checked
+ *           against a direct DFT in double precision.
+ *
+ *           The tests run once with the C kernels and, when the library is
+ *           built with NEON, once more with the NEON kernels.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "nu_dsp.h"
+
+#define MAX_BLOCK       256
+#define MAX_TAPS        40
+#define MAX_STAGES      4
+#define SIGNAL_LEN      2000
+#define FFT_MAX_LEN     4096
+
+static uint32_t s_u32Seed = 7;
+
+static float    s_afIn[SIGNAL_LEN + MAX_BLOCK], s_afOut[SIGNAL_LEN], s_afRef[SIGNAL_LEN];
+static int16_t  s_ai16In[SIGNAL_LEN + MAX_BLOCK], s_ai16Out[SIGNAL_LEN], s_ai16Ref[SIGNAL_LEN];
+static float    s_afState[8 * MAX_STAGES + MAX_TAPS + MAX_BLOCK];
+static int16_t  s_ai16State[MAX_TAPS + MAX_BLOCK];
+
+static float    s_afFftTw[DSP_FFT_F32_TWIDDLE_LEN(FFT_MAX_LEN)], s_afFft[2 * FFT_MAX_LEN];
+static int16_t  s_ai16FftTw[DSP_FFT_Q15_TWIDDLE_LEN(FFT_MAX_LEN)], s_ai16Fft[2 * FFT_MAX_LEN];
+static double   s_adDft[2 * FFT_MAX_LEN], s_adCos[FFT_MAX_LEN], s_adSin[FFT_MAX_LEN];
+
+static uint32_t Rand(uint32_t u32Range)
+{
+    s_u32Seed = s_u32Seed * 1103515245U + 12345U;
+    return ((s_u32Seed >> 16) | (s_u32Seed << 16)) % u32Range;
+}
+
+/* Uniform in [-1, 1) */
+static float RandF(void)
+{
+    return (float)((int32_t)Rand(65536U) - 32768) * (1.0f / 32768.0f);
+}
+
+static void FillF32(float *pf, uint32_t n, float fAmp)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+        pf[i] = fAmp * RandF();
+}
+
+static void FillQ15(int16_t *pi16, uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+        pi16[i] = (int16_t)((int32_t)Rand(65536U) - 32768);
+}
+
+/* Bitwise comparison, so that -0.0f and 0.0f or two NaNs are not taken as equal or different by accident */
+static int SameF32(const char *pcWhat, const float *pfGot, const float *pfRef, uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (memcmp(&pfGot[i], &pfRef[i], sizeof(float)) != 0)
+        {
+            printf("  %s [%u]: got %.9g, reference %.9g\n", pcWhat, i, pfGot[i], pfRef[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int SameQ15(const char *pcWhat, const int16_t *pi16Got, const int16_t *pi16Ref, uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (pi16Got[i] != pi16Ref[i])
+        {
+            printf("  %s [%u]: got %d, reference %d\n", pcWhat, i, pi16Got[i], pi16Ref[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int16_t SatQ15(int64_t v)
+{
+    return (int16_t)((v > 32767) ? 32767 : (v < -32768) ? -32768 : v);
+}
+
+static int Test_Convert(void)
+{
+    static uint16_t au16Src[SIGNAL_LEN];
+    uint32_t n, u32Stride, i;
+    float    f;
+    int      i32Fail = 0;
+
+    for (i = 0; i < SIGNAL_LEN; i++)
+        au16Src[i] = (uint16_t)Rand(65536U);
+
+    for (u32Stride = 1; u32Stride <= 6U; u32Stride++)
+    {
+        for (n = 1; n * u32Stride <= SIGNAL_LEN && n <= 67U; n++)
+        {
+            dsp_u16_to_f32(au16Src, u32Stride, s_afOut, n, 2048.0f, 1.0f / 2048.0f);
+            for (i = 0; i < n; i++)
+                s_afRef[i] = ((float)au16Src[i * u32Stride] - 2048.0f) * (1.0f / 2048.0f);
+            i32Fail |= SameF32("u16_to_f32", s_afOut, s_afRef, n);
+
+            dsp_q15_to_f32((const int16_t *)au16Src, u32Stride, s_afOut, n);
+            for (i = 0; i < n; i++)
+                s_afRef[i] = (float)(int16_t)au16Src[i * u32Stride] / 32768.0f;
+            i32Fail |= SameF32("q15_to_f32", s_afOut, s_afRef, n);
+        }
+    }
+
+    /* Out-of-range values, exact halves and NaN */
+    FillF32(s_afIn, SIGNAL_LEN, 1.5f);
+    s_afIn[3] = 1.0f;
+    s_afIn[4] = -1.0f;
+    s_afIn[5] = 0.5f / 32768.0f;
+    s_afIn[6] = 1.5f / 32768.0f;
+    s_afIn[7] = -2.5f / 32768.0f;
+    s_afIn[8] = NAN;
+    s_afIn[9] = INFINITY;
+    s_afIn[10] = -INFINITY;
+    for (n = 1; n <= 67U; n++)
+    {
+        dsp_f32_to_q15(s_afIn, s_ai16Out, n);
+        for (i = 0; i < n; i++)
+        {
+            /* Round half to even, saturate, NaN to 0 */
+            f = s_afIn[i] * 32768.0f;
+            if (f != f)
+                s_ai16Ref[i] = 0;
+            else if (f >= 32767.0f)
+                s_ai16Ref[i] = 32767;
+            else if (f <= -32768.0f)
+                s_ai16Ref[i] = -32768;
+            else
+                s_ai16Ref[i] = (int16_t)nearbyintf(f);
+        }
+        i32Fail |= SameQ15("f32_to_q15", s_ai16Out, s_ai16Ref, n);
+    }
+
+    return i32Fail;
+}
+
+static int Test_FirF32(void)
+{
+    static const uint32_t au32Taps[] = { 1, 2, 5, 16, 33, MAX_TAPS };
+    static float afCoef[MAX_TAPS];
+    dsp_fir_f32_t sFir;
+    uint32_t t, u32Taps, i, k, n, u32Block;
+    float    fAcc;
+    int      i32Fail = 0;
+
+    FillF32(s_afIn, SIGNAL_LEN, 1.0f);
+
+    for (t = 0; t < sizeof(au32Taps) / sizeof(au32Taps[0]); t++)
+    {
+        u32Taps = au32Taps[t];
+        u32Block = 1U + Rand(MAX_BLOCK);
+        FillF32(afCoef, u32Taps, 0.5f);
+
+        /* y[i] = h[0] x[i] + h[1] x[i - 1] + ..., accumulated from h[0] with fused multiply-adds */
+        for (i = 0; i < SIGNAL_LEN; i++)
+        {
+            fAcc = 0.0f;
+            for (k = 0; k < u32Taps; k++)
+                fAcc = fmaf((k <= i) ? s_afIn[i - k] : 0.0f, afCoef[k], fAcc);
+            s_afRef[i] = fAcc;
+        }
+
+        if (dsp_fir_f32_init(&sFir, u32Taps, afCoef, s_afState, u32Block) != DSP_OK)
+            return 1;
+        for (i = 0; i < SIGNAL_LEN; i += n)
+        {
+            n = 1U + Rand(u32Block);
+            if (n > SIGNAL_LEN - i)
+                n = SIGNAL_LEN - i;
+            dsp_fir_f32(&sFir, s_afIn + i, s_afOut + i, n);
+        }
+        i32Fail |= SameF32("fir_f32", s_afOut, s_afRef, SIGNAL_LEN);
+
+        /* In place */
+        memcpy(s_afOut, s_afIn, sizeof(s_afOut));
+        dsp_fir_f32_init(&sFir, u32Taps, afCoef, s_afState, u32Block);
+        for (i = 0; i < SIGNAL_LEN; i += n)
+        {
+            n = (u32Block < SIGNAL_LEN - i) ? u32Block : SIGNAL_LEN - i;
+            dsp_fir_f32(&sFir, s_afOut + i, s_afOut + i, n);
+        }
+        i32Fail |= SameF32("fir_f32 in place", s_afOut, s_afRef, SIGNAL_LEN);
+    }
+
+    return i32Fail;
+}
+
+static int Test_FirQ15(void)
+{
+    static const uint32_t au32Taps[] = { 1, 3, 8, 31, MAX_TAPS };
+    static int16_t ai16Coef[MAX_TAPS];
+    dsp_fir_q15_t sFir;
+    uint32_t t, u32Taps, i, k, n, u32Block;
+    int64_t  i64Acc;
+    int      i32Fail = 0;
+
+    /* Full-scale input and coefficients, so the outputs saturate */
+    FillQ15(s_ai16In, SIGNAL_LEN);
+
+    for (t = 0; t < sizeof(au32Taps) / sizeof(au32Taps[0]); t++)
+    {
+        u32Taps = au32Taps[t];
+        u32Block = 1U + Rand(MAX_BLOCK);
+        FillQ15(ai16Coef, u32Taps);
+
+        for (i = 0; i < SIGNAL_LEN; i++)
+        {
+            i64Acc = 0;
+            for (k = 0; k < u32Taps && k <= i; k++)
+                i64Acc += (int64_t)s_ai16In[i - k] * ai16Coef[k];
+            s_ai16Ref[i] = SatQ15((i64Acc + (1 << 14)) >> 15);
+        }
+
+        if (dsp_fir_q15_init(&sFir, u32Taps, ai16Coef, s_ai16State, u32Block) != DSP_OK)
+            return 1;
+        for (i = 0; i < SIGNAL_LEN; i += n)
+        {
+            n = 1U + Rand(u32Block);
+            if (n > SIGNAL_LEN - i)
+                n = SIGNAL_LEN - i;
+            dsp_fir_q15(&sFir, s_ai16In + i, s_ai16Out + i, n);
+        }
+        i32Fail |= SameQ15("fir_q15", s_ai16Out, s_ai16Ref, SIGNAL_LEN);
+    }
+
+    return i32Fail;
+}
+
+static int Test_FirDecim(void)
+{
+    static const uint32_t au32M[] = { 1, 2, 3, 4, 8 };
+    static const uint32_t au32Taps[] = { 1, 4, 7, 24, 37 };
+    static float afCoef[MAX_TAPS];
+    dsp_fir_decim_f32_t sDec;
+    uint32_t t, M, u32Taps, u32Block, u32Out, i, m, j, k, n;
+    float    s[4], fAcc;
+    int      i32Fail = 0;
+
+    FillF32(s_afIn, SIGNAL_LEN, 1.0f);
+
+    for (t = 0; t < sizeof(au32M) / sizeof(au32M[0]); t++)
+    {
+        M = au32M[t];
+        u32Taps = au32Taps[t];
+        u32Block = M * (1U + Rand(MAX_BLOCK / M));
+        u32Out = SIGNAL_LEN / M;
+        FillF32(afCoef, u32Taps, 0.5f);
+
+        /* y[m] = sum h[k] x[m M + M - 1 - k] in four partial sums over k mod 4,
+           reduced as (s0 + s1) + (s2 + s3), then the leftover taps */
+        for (m = 0; m < u32Out; m++)
+        {
+            i = m * M + M - 1U;
+            s[0] = s[1] = s[2] = s[3] = 0.0f;
+            for (k = 0; k < (u32Taps & ~3U); k++)
+                s[k & 3U] = fmaf((k <= i) ? s_afIn[i - k] : 0.0f, afCoef[k], s[k & 3U]);
+            fAcc = (s[0] + s[1]) + (s[2] + s[3]);
+            for (; k < u32Taps; k++)
+                fAcc = fmaf((k <= i) ? s_afIn[i - k] : 0.0f, afCoef[k], fAcc);
+            s_afRef[m] = fAcc;
+        }
+
+        if (dsp_fir_decim_f32_init(&sDec, M, u32Taps, afCoef, s_afState, u32Block) != DSP_OK)
+            return 1;
+        for (i = 0, j = 0; i < u32Out * M; i += n, j += n / M)
+        {
+            n = M * (1U + Rand(u32Block / M));
+            if (n > u32Out * M - i)
+                n = u32Out * M - i;
+            dsp_fir_decim_f32(&sDec, s_afIn + i, s_afOut + j, n);
+        }
+        i32Fail |= SameF32("fir_decim_f32", s_afOut, s_afRef, u32Out);
+    }
+
+    /* The block size must be a multiple of M */
+    if (dsp_fir_decim_f32_init(&sDec, 4, 8, afCoef, s_afState, 10) != DSP_ERR_PARAM)
+    {
+        printf("  fir_decim_f32_init accepted a block size that is not a multiple of M\n");
+        i32Fail = 1;
+    }
+
+    return i32Fail;
+}
+
+/* One sample through a cascade in transposed direct form II */
+static float BiquadRef(const float *pfCoef, uint32_t u32Stages, float *pfD, float x)
+{
+    uint32_t st;
+    float    y = x;
+
+    for (st = 0; st < u32Stages; st++, pfCoef += 5, pfD += 2)
+    {
+        y = fmaf(pfCoef[0], x, pfD[0]);
+        pfD[0] = fmaf(pfCoef[1], x, fmaf(pfCoef[3], y, pfD[1]));
+        pfD[1] = fmaf(pfCoef[2], x, pfCoef[4] * y);
+        x = y;
+    }
+
+    return y;
+}
+
+static void BiquadCoef(float *pfCoef, uint32_t u32Stages)
+{
+    uint32_t st;
+
+    /* Random stable sections: poles at radius r and angle w, a1 = 2r cos(w), a2 = -r^2 */
+    for (st = 0; st < u32Stages; st++)
+    {
+        float r = 0.5f + 0.45f * (RandF() + 1.0f) / 2.0f, w = 3.1415927f * (RandF() + 1.0f) / 2.0f;
+
+        pfCoef[5 * st + 0] = RandF();
+        pfCoef[5 * st + 1] = RandF();
+        pfCoef[5 * st + 2] = RandF();
+        pfCoef[5 * st + 3] = 2.0f * r * cosf(w);
+        pfCoef[5 * st + 4] = -r * r;
+    }
+}
+
+static int Test_Biquad(void)
+{
+    static float afCoef[5 * MAX_STAGES];
+    float    afD[2 * MAX_STAGES];
+    dsp_biquad_f32_t sBq;
+    uint32_t u32Stages, i, n;
+    int      i32Fail = 0;
+
+    FillF32(s_afIn, SIGNAL_LEN, 1.0f);
+
+    for (u32Stages = 1; u32Stages <= MAX_STAGES; u32Stages++)
+    {
+        BiquadCoef(afCoef, u32Stages);
+
+        memset(afD, 0, sizeof(afD));
+        for (i = 0; i < SIGNAL_LEN; i++)
+            s_afRef[i] = BiquadRef(afCoef, u32Stages, afD, s_afIn[i]);
+
+        dsp_biquad_f32_init(&sBq, u32Stages, afCoef, s_afState);
+        for (i = 0; i < SIGNAL_LEN; i += n)
+        {
+            n = 1U + Rand(MAX_BLOCK);
+            if (n > SIGNAL_LEN - i)
+                n = SIGNAL_LEN - i;
+            dsp_biquad_f32(&sBq, s_afIn + i, s_afOut + i, n);
+        }
+        i32Fail |= SameF32("biquad_f32", s_afOut, s_afRef, SIGNAL_LEN);
+    }
+
+    return i32Fail;
+}
+
+static int Test_Biquad4(void)
+{
+    static float afCoef[5 * MAX_STAGES];
+    float    afD[4][2 * MAX_STAGES];
+    dsp_biquad_f32_t sBq;
+    uint32_t u32Stages, u32Frames = SIGNAL_LEN / 4U, i, ch, n;
+    int      i32Fail = 0;
+
+    FillF32(s_afIn, SIGNAL_LEN, 1.0f);
+
+    for (u32Stages = 1; u32Stages <= MAX_STAGES; u32Stages++)
+    {
+        BiquadCoef(afCoef, u32Stages);
+
+        /* Each channel on its own */
+        memset(afD, 0, sizeof(afD));
+        for (i = 0; i < u32Frames; i++)
+            for (ch = 0; ch < 4U; ch++)
+                s_afRef[4U * i + ch] = BiquadRef(afCoef, u32Stages, afD[ch], s_afIn[4U * i + ch]);
+
+        dsp_biquad4_f32_init(&sBq, u32Stages, afCoef, s_afState);
+        for (i = 0; i < u32Frames; i += n)
+        {
+            n = 1U + Rand(MAX_BLOCK / 4U);
+            if (n > u32Frames - i)
+                n = u32Frames - i;
+            dsp_biquad4_f32(&sBq, s_afIn + 4U * i, s_afOut + 4U * i, n);
+        }
+        i32Fail |= SameF32("biquad4_f32", s_afOut, s_afRef, 4U * u32Frames);
+    }
+
+    return i32Fail;
+}
+
+static int Test_RmsPeak(void)
+{
+    uint32_t n, i, u32Off;
+    float    s[4], fSum, fPeak, fRms, fGotRms, fGotPeak;
+    uint64_t u64Sum;
+    int32_t  i32Peak, a;
+    int16_t  i16Rms, i16Peak, i16Ref;
+    int      i32Fail = 0;
+
+    FillF32(s_afIn, SIGNAL_LEN, 2.0f);
+    FillQ15(s_ai16In, SIGNAL_LEN);
+    s_ai16In[100] = -32768;
+
+    for (n = 1; n <= 300U; n += 1U + Rand(7U))
+    {
+        u32Off = Rand(SIGNAL_LEN - n);
+
+        /* Four partial sums over x[4i + l], then the leftover samples */
+        s[0] = s[1] = s[2] = s[3] = 0.0f;
+        for (i = 0; i < (n & ~3U); i++)
+            s[i & 3U] = fmaf(s_afIn[u32Off + i], s_afIn[u32Off + i], s[i & 3U]);
+        fSum = (s[0] + s[1]) + (s[2] + s[3]);
+        fPeak = 0.0f;
+        for (i = 0; i < n; i++)
+        {
+            if (i >= (n & ~3U))
+                fSum = fmaf(s_afIn[u32Off + i], s_afIn[u32Off + i], fSum);
+            fPeak = fmaxf(fPeak, fabsf(s_afIn[u32Off + i]));
+        }
+        fRms = sqrtf(fSum / (float)n);
+
+        dsp_rms_peak_f32(s_afIn + u32Off, n, &fGotRms, &fGotPeak);
+        i32Fail |= SameF32("rms_f32", &fGotRms, &fRms, 1);
+        i32Fail |= SameF32("peak_f32", &fGotPeak, &fPeak, 1);
+
+        /* Exact sum of squares */
+        u64Sum = 0;
+        i32Peak = 0;
+        for (i = 0; i < n; i++)
+        {
+            a = s_ai16In[u32Off + i];
+            u64Sum += (uint64_t)(a * a);
+            a = (a < 0) ? -a : a;
+            i32Peak = (a > i32Peak) ? a : i32Peak;
+        }
+        i32Peak = (i32Peak > 32767) ? 32767 : i32Peak;
+
+        dsp_rms_peak_q15(s_ai16In + u32Off, n, &i16Rms, &i16Peak);
+        i16Ref = SatQ15((int64_t)(sqrt((double)u64Sum / (double)n) + 0.5));
+        i32Fail |= SameQ15("rms_q15", &i16Rms, &i16Ref, 1);
+        i16Ref = (int16_t)i32Peak;
+        i32Fail |= SameQ15("peak_q15", &i16Peak, &i16Ref, 1);
+    }
+
+    return i32Fail;
+}
+
+/* X[k] = sum x[n] exp(-2 pi i n k / N) */
+static void Dft(const double *pdIn, double *pdOut, uint32_t N)
+{
+    uint32_t k, n, r;
+    double   re, im;
+
+    for (n = 0; n < N; n++)
+    {
+        s_adCos[n] = cos(6.283185307179586 * n / N);
+        s_adSin[n] = sin(6.283185307179586 * n / N);
+    }
+
+    for (k = 0; k < N; k++)
+    {
+        re = im = 0.0;
+        for (n = 0, r = 0; n < N; n++, r = (r + k) % N)
+        {
+            re += pdIn[2 * n] * s_adCos[r] + pdIn[2 * n + 1] * s_adSin[r];
+            im += pdIn[2 * n + 1] * s_adCos[r] - pdIn[2 * n] * s_adSin[r];
+        }
+        pdOut[2 * k] = re;
+        pdOut[2 * k + 1] = im;
+    }
+}
+
+static int Test_FftF32(void)
+{
+    static double adIn[2 * FFT_MAX_LEN];
+    static float  afSave[2 * FFT_MAX_LEN];
+    dsp_fft_f32_t sFft;
+    uint32_t N, i, u32Stages;
+    double   dErr, dErrInv, dNorm;
+    int      i32Fail = 0;
+
+    for (N = DSP_FFT_MIN, u32Stages = 1; N <= DSP_FFT_MAX; N *= 4U, u32Stages++)
+    {
+        if (dsp_fft_f32_init(&sFft, N, s_afFftTw) != DSP_OK)
+        {
+            printf("  fft_f32_init(%u) failed\n", N);
+            return 1;
+        }
+
+        FillF32(s_afFft, 2U * N, 1.0f);
+        memcpy(afSave, s_afFft, 2U * N * sizeof(float));
+        for (i = 0; i < 2U * N; i++)
+            adIn[i] = s_afFft[i];
+        Dft(adIn, s_adDft, N);
+
+        /* The error of a float FFT grows with sqrt(N) times the number of stages */
+        dsp_fft_f32(&sFft, s_afFft, 0);
+        dErr = 0.0;
+        for (i = 0; i < 2U * N; i++)
+            dErr = fmax(dErr, fabs(s_afFft[i] - s_adDft[i]));
+        dNorm = sqrt((double)N) * u32Stages * 1.2e-7;
+
+        dsp_fft_f32(&sFft, s_afFft, 1);
+        dErrInv = 0.0;
+        for (i = 0; i < 2U * N; i++)
+            dErrInv = fmax(dErrInv, fabs(s_afFft[i] / N - afSave[i]));
+
+        if ((dErr > 8.0 * dNorm) || (dErrInv > 8.0 * dNorm))
+        {
+            printf("  N %u: forward error %.3g, round trip error %.3g, bound %.3g\n", N, dErr, dErrInv, 8.0 * dNorm);
+            i32Fail = 1;
+        }
+    }
+
+    for (N = 0; N <= 2U * DSP_FFT_MAX; N++)
+    {
+        for (i = N; (i > 1U) && ((i & 3U) == 0U); i >>= 2)
+            ;
+        if ((dsp_fft_f32_init(&sFft, N, s_afFftTw) == DSP_OK) != (i == 1U && N >= DSP_FFT_MIN && N <= DSP_FFT_MAX))
+        {
+            printf("  fft_f32_init(%u) gave the wrong answer\n", N);
+            i32Fail = 1;
+        }
+    }
+
+    return i32Fail;
+}
+
+static int Test_FftQ15(void)
+{
+    static double adIn[2 * FFT_MAX_LEN];
+    dsp_fft_q15_t sFft;
+    uint32_t N, i, u32Stages;
+    double   dErr, dExp;
+    int      i32Fail = 0;
+
+    for (N = DSP_FFT_MIN, u32Stages = 1; N <= DSP_FFT_MAX; N *= 4U, u32Stages++)
+    {
+        if (dsp_fft_q15_init(&sFft, N, s_ai16FftTw) != DSP_OK)
+        {
+            printf("  fft_q15_init(%u) failed\n", N);
+            return 1;
+        }
+
+        /* Components within +-23170, so that no value has a magnitude of 1 or
+           more and no twiddle product saturates */
+        for (i = 0; i < 2U * N; i++)
+        {
+            s_ai16Fft[i] = (int16_t)((int32_t)Rand(2U * 23170U + 1U) - 23170);
+            adIn[i] = s_ai16Fft[i];
+        }
+        Dft(adIn, s_adDft, N);
+
+        /* The output is the DFT divided by N. Each stage shifts its four
+           inputs right by 2, which loses up to 3 LSB in a sum, and truncates
+           the twiddle products. */
+        dsp_fft_q15(&sFft, s_ai16Fft);
+        dErr = 0.0;
+        for (i = 0; i < 2U * N; i++)
+        {
+            dExp = s_adDft[i] / N;
+            dErr = fmax(dErr, fabs(s_ai16Fft[i] - dExp));
+        }
+
+        if (dErr > 3.0 * u32Stages + 1.0)
+        {
+            printf("  N %u: error %.3g LSB, bound %u LSB\n", N, dErr, 3U * u32Stages + 1U);
+            i32Fail = 1;
+        }
+    }
+
+    return i32Fail;
+}
+
+int main(void)
+{
+    struct
+    {
+        const char *pcName;
+        int (*pfnTest)(void);
+    } asTest[] =
+    {
+        { "Sample conversion",          Test_Convert },
+        { "Float FIR",                  Test_FirF32 },
+        { "Q15 FIR",                    Test_FirQ15 },
+        { "FIR decimator",              Test_FirDecim },
+        { "Biquad cascade",             Test_Biquad },
+        { "4-channel biquad cascade",   Test_Biquad4 },
+        { "RMS and peak",               Test_RmsPeak },
+        { "Float FFT against DFT",      Test_FftF32 },
+        { "Q15 FFT against DFT",        Test_FftQ15 },
+    };
+    char     acName[64];
+    uint32_t i;
+    int      i32Neon, i32Fail, i32Total = 0;
+
+    for (i32Neon = 0; i32Neon <= 1; i32Neon++)
+    {
+        dsp_set_neon(i32Neon);
+        if (dsp_neon_enabled() != i32Neon)
+            break;
+
+        for (i = 0; i < sizeof(asTest) / sizeof(asTest[0]); i++)
+        {
+            s_u32Seed = 7U + i;
+            i32Fail = asTest[i].pfnTest();
+            snprintf(acName, sizeof(acName), "%s (%s)", asTest[i].pcName, i32Neon ? "NEON" : "C");
+            printf("%-40s %s\n", acName, i32Fail ? "FAIL" : "PASS");
+            i32Total |= i32Fail;
+        }
+    }
+
+    return i32Total;
+}
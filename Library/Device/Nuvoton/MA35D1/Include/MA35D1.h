@@ -628,6 +628,7 @@ int  sysIsKbHit(void);
 #include "sys.h"
 #include "clk.h"
 #include "uart.h"
+#include "uart_svc.h"
 #include "hwsem.h"
 #include "whc.h"
 #include "gpio.h"
@@ -637,9 +638,11 @@ int  sysIsKbHit(void);
 #include "timer_pwm.h"
 #include "pdma.h"
 #include "i2c.h"
+#include "i2c_svc.h"
 #include "i2s.h"
 #include "epwm.h"
 #include "eadc.h"
+#include "eadc_svc.h"
 #include "adc.h"
 #include "wdt.h"
 #include "wwdt.h"
@@ -648,6 +651,7 @@ int  sysIsKbHit(void);
 #include "sc.h"
 #include "spi.h"
 #include "qspi.h"
+#include "sflash_svc.h"
 #include "rtc.h"
 #include "kpi.h"
 #include "canfd.h"
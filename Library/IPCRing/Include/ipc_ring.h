@@ -0,0 +1,134 @@
+/**************************************************************************//**
+ * @file     ipc_ring.h
+ * @brief    Lock-free message ring between the A35 cores
+ *
+ *           A ring holds a power of two number of fixed size entries in
+ *           memory seen by both cores. The producer owns the head index and
+ *           the consumer the tail index; each index sits in a cache line of
+ *           its own, next to a private copy of the other side's index, so a
+ *           push or pop touches the remote line only when the ring looks
+ *           full or empty. Indices are published with store-release (STLR)
+ *           and read with load-acquire (LDAR).
+ *
+ *           Entries are published in batches: RING_Write() and RING_Commit()
+ *           move the head once for all their entries. A consumer that has
+ *           drained the ring may sleep after RING_Sleep(); a producer calls
+ *           RING_CheckWake() after a batch and rings its doorbell (e.g. an
+ *           SGI) only when that returns 1, so there is at most one doorbell
+ *           per batch and none while the consumer is busy.
+ *
+ *           The ring has a single consumer. Several producers are allowed
+ *           when it is created with RING_MPSC, which serializes them with a
+ *           spin lock taken with exclusive access (LDAXR/STXR), or with
+ *           RING_MPSC_HWSEM(), which uses a hardware semaphore channel
+ *           instead, for memory where exclusive access cannot be used.
+ *           Producers on one core must not preempt each other inside
+ *           RING_Write() or between RING_Reserve() and RING_Commit().
+ *
+ *           Both A35 cores are in one coherent cluster, so the ring may be
+ *           in cached DDR. The M4 is not coherent with them and cannot use
+ *           a ring; use WHC or OpenAMP for it.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __IPC_RING_H__
+#define __IPC_RING_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @addtogroup IPC_RING_Library Inter-core Ring Library
+  @{
+*/
+
+/** @addtogroup IPC_RING_EXPORTED_CONSTANTS Inter-core Ring Exported Constants
+  @{
+*/
+
+#define RING_OK                 0       /*!< Operation succeeded */
+#define RING_ERR_PARAM          -1      /*!< Invalid parameter */
+
+#define RING_CACHE_LINE         64U     /*!< Cache line size of the Cortex-A35 */
+
+#define RING_SPSC               0x0U    /*!< One producer and one consumer */
+#define RING_MPSC               0x1U    /*!< Several producers serialized by a spin lock */
+#define RING_MPSC_HWSEM(ch)     (0x3U | ((uint32_t)(ch) << 8)) /*!< Several producers serialized by HWSEM channel ch (0 ~ 7) */
+
+#define RING_BUF_SIZE(entries, size)    ((entries) * (size))   /*!< Bytes of entry buffer for RING_Init() */
+
+/*! @}*/ /* end of group IPC_RING_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup IPC_RING_EXPORTED_STRUCTS Inter-core Ring Exported Structs
+  @{
+*/
+
+/**
+ *  @brief  Ring control block, shared by both cores.
+ *          Place it in memory mapped at the same address on both cores.
+ *          The members are private to the library.
+ */
+typedef struct
+{
+    /* Written by the producer */
+    volatile uint32_t   u32Head;        /*!< Next entry to write, free running */
+    uint32_t            u32TailCache;   /*!< Tail last seen by the producer */
+    volatile uint32_t   u32Lock;        /*!< Producer lock of RING_MPSC */
+    uint8_t             au8Pad0[RING_CACHE_LINE - 12];
+
+    /* Written by the consumer */
+    volatile uint32_t   u32Tail;        /*!< Next entry to read, free running */
+    uint32_t            u32HeadCache;   /*!< Head last seen by the consumer */
+    uint8_t             au8Pad1[RING_CACHE_LINE - 8];
+
+    /* Set by the consumer before it sleeps, cleared by the producer */
+    volatile uint32_t   u32Sleep;
+    uint8_t             au8Pad2[RING_CACHE_LINE - 4];
+
+    /* Constant after RING_Init() */
+    uint8_t             *pu8Buf;        /*!< Entry buffer */
+    uint32_t            u32Mask;        /*!< Entries - 1 */
+    uint32_t            u32EntrySize;   /*!< Bytes per entry */
+    uint32_t            u32Flags;       /*!< RING_SPSC, RING_MPSC or RING_MPSC_HWSEM() */
+    uint8_t             au8Pad3[RING_CACHE_LINE - 8 - 12];
+} __attribute__((aligned(RING_CACHE_LINE))) RING_T;
+
+/*! @}*/ /* end of group IPC_RING_EXPORTED_STRUCTS */
+
+
+/** @addtogroup IPC_RING_EXPORTED_FUNCTIONS Inter-core Ring Exported Functions
+  @{
+*/
+
+/* Setup, called by one core before the other one uses the ring */
+int32_t  RING_Init(RING_T *psRing, void *pvBuf, uint32_t u32Entries, uint32_t u32EntrySize, uint32_t u32Flags);
+
+/* Producer */
+uint32_t RING_Write(RING_T *psRing, const void *pvData, uint32_t u32Count);
+void    *RING_Reserve(RING_T *psRing, uint32_t *pu32Count);
+void     RING_Commit(RING_T *psRing, uint32_t u32Count);
+int32_t  RING_CheckWake(RING_T *psRing);
+
+/* Consumer */
+uint32_t RING_Read(RING_T *psRing, void *pvData, uint32_t u32Count);
+const void *RING_Peek(RING_T *psRing, uint32_t *pu32Count);
+void     RING_Release(RING_T *psRing, uint32_t u32Count);
+int32_t  RING_Sleep(RING_T *psRing);
+
+/* Either side; a snapshot that may be stale when it returns */
+uint32_t RING_GetCount(RING_T *psRing);
+
+/*! @}*/ /* end of group IPC_RING_EXPORTED_FUNCTIONS */
+
+/*! @}*/ /* end of group IPC_RING_Library */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IPC_RING_H__ */
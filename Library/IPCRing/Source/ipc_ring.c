@@ -0,0 +1,337 @@
+/**************************************************************************//**
+ * @file     ipc_ring.c
+ * @brief    Lock-free message ring between the A35 cores
+ *
+ *           Head and tail run freely and are masked on use, so head - tail
+ *           is the number of entries in the ring and a full ring needs no
+ *           spare entry. Each side keeps the last value it loaded of the
+ *           other side's index and reloads it only when that value says the
+ *           ring is full (producer) or empty (consumer).
+ *
+ *           Ordering: entries are written before the head is stored with
+ *           release and read after it is loaded with acquire; the tail
+ *           works the same way the other way round. The sleep flag needs a
+ *           full barrier on both sides, as each side stores one word and
+ *           then loads the word stored by the other.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+#include "ipc_ring.h"
+
+/** @cond HIDDEN_SYMBOLS */
+
+#define RING_F_MPSC         0x1U
+#define RING_F_HWSEM        0x2U
+#define RING_HWSEM_CH(f)    (((f) >> 8) & 0x7U)
+
+/* Each core locks HWSEM with a key of its own */
+#define RING_HWSEM_KEY()    ((uint8_t)(0x3C + cpuid()))
+
+#define RING_LOAD_ACQ(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)          /* LDAR */
+#define RING_STORE_REL(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)    /* STLR */
+#define RING_FENCE()            __atomic_thread_fence(__ATOMIC_SEQ_CST)         /* DMB ISH */
+
+static void RING_Lock(RING_T *psRing)
+{
+    if (!(psRing->u32Flags & RING_F_MPSC))
+        return;
+
+    if (psRing->u32Flags & RING_F_HWSEM)
+    {
+        HWSEM_Spin_Lock(HWSEM0, RING_HWSEM_CH(psRing->u32Flags), RING_HWSEM_KEY());
+        /* No ring access may be done before the semaphore is owned */
+        __DMB();
+        return;
+    }
+
+    /* LDAXR/STXR; wait with plain loads so the line is not pulled back and forth */
+    while (__atomic_exchange_n(&psRing->u32Lock, 1U, __ATOMIC_ACQUIRE))
+    {
+        while (psRing->u32Lock)
+            ;
+    }
+}
+
+static void RING_Unlock(RING_T *psRing)
+{
+    if (!(psRing->u32Flags & RING_F_MPSC))
+        return;
+
+    if (psRing->u32Flags & RING_F_HWSEM)
+    {
+        __DMB();
+        HWSEM_UNLOCK(HWSEM0, RING_HWSEM_CH(psRing->u32Flags), RING_HWSEM_KEY());
+        return;
+    }
+
+    RING_STORE_REL(&psRing->u32Lock, 0U);
+}
+
+/* Free entries from u32Head, loading the tail only if fewer than u32Want seem free */
+static uint32_t RING_Space(RING_T *psRing, uint32_t u32Head, uint32_t u32Want)
+{
+    uint32_t u32Size = psRing->u32Mask + 1U;
+    uint32_t u32Free = u32Size - (u32Head - psRing->u32TailCache);
+
+    if (u32Free < u32Want)
+    {
+        psRing->u32TailCache = RING_LOAD_ACQ(&psRing->u32Tail);
+        u32Free = u32Size - (u32Head - psRing->u32TailCache);
+    }
+    return u32Free;
+}
+
+/* Used entries from u32Tail, loading the head only if fewer than u32Want seem used */
+static uint32_t RING_Used(RING_T *psRing, uint32_t u32Tail, uint32_t u32Want)
+{
+    uint32_t u32Used = psRing->u32HeadCache - u32Tail;
+
+    if (u32Used < u32Want)
+    {
+        psRing->u32HeadCache = RING_LOAD_ACQ(&psRing->u32Head);
+        u32Used = psRing->u32HeadCache - u32Tail;
+    }
+    return u32Used;
+}
+
+/** @endcond HIDDEN_SYMBOLS */
+
+
+/**
+ *  @brief      Creates an empty ring
+ *  @param[out] psRing          Control block, RING_CACHE_LINE aligned
+ *  @param[in]  pvBuf           RING_BUF_SIZE(u32Entries, u32EntrySize) bytes
+ *  @param[in]  u32Entries      Number of entries, a power of two
+ *  @param[in]  u32EntrySize    Bytes per entry
+ *  @param[in]  u32Flags        RING_SPSC, RING_MPSC or RING_MPSC_HWSEM()
+ *  @return     RING_OK or RING_ERR_PARAM
+ *  @details    The other core must not use the ring before this returns;
+ *              hand the ring over e.g. with a flag stored after this call.
+ *              With RING_MPSC_HWSEM() the HWSEM clock must be enabled.
+ */
+int32_t RING_Init(RING_T *psRing, void *pvBuf, uint32_t u32Entries, uint32_t u32EntrySize, uint32_t u32Flags)
+{
+    if ((psRing == NULL) || (pvBuf == NULL) || (u32EntrySize == 0U) ||
+        ((uintptr_t)psRing & (RING_CACHE_LINE - 1U)) ||
+        (u32Entries < 2U) || (u32Entries & (u32Entries - 1U)) ||
+        ((u32Flags != RING_SPSC) && (u32Flags != RING_MPSC) &&
+         ((u32Flags & ~0x700U) != RING_MPSC_HWSEM(0))))
+        return RING_ERR_PARAM;
+
+    memset(psRing, 0, sizeof(RING_T));
+    psRing->pu8Buf = (uint8_t *)pvBuf;
+    psRing->u32Mask = u32Entries - 1U;
+    psRing->u32EntrySize = u32EntrySize;
+    psRing->u32Flags = u32Flags;
+    __DMB();
+
+    return RING_OK;
+}
+
+/**
+ *  @brief      Copies entries into the ring and publishes them
+ *  @param[in]  psRing      Ring
+ *  @param[in]  pvData      u32Count entries
+ *  @param[in]  u32Count    Entries to write
+ *  @return     Entries written, less than u32Count if the ring is full
+ *  @details    The entries are published together, then call RING_CheckWake().
+ */
+uint32_t RING_Write(RING_T *psRing, const void *pvData, uint32_t u32Count)
+{
+    const uint8_t *pu8Data = (const uint8_t *)pvData;
+    uint32_t u32Head, u32Idx, u32First, u32Size = psRing->u32EntrySize;
+
+    RING_Lock(psRing);
+
+    u32Head = psRing->u32Head;
+    u32First = RING_Space(psRing, u32Head, u32Count);
+    if (u32Count > u32First)
+        u32Count = u32First;
+
+    if (u32Count)
+    {
+        u32Idx = u32Head & psRing->u32Mask;
+        u32First = psRing->u32Mask + 1U - u32Idx;
+        if (u32First > u32Count)
+            u32First = u32Count;
+
+        memcpy(psRing->pu8Buf + u32Idx * u32Size, pu8Data, u32First * u32Size);
+        if (u32Count > u32First)
+            memcpy(psRing->pu8Buf, pu8Data + u32First * u32Size, (u32Count - u32First) * u32Size);
+
+        RING_STORE_REL(&psRing->u32Head, u32Head + u32Count);
+    }
+
+    RING_Unlock(psRing);
+
+    return u32Count;
+}
+
+/**
+ *  @brief      Gets free entries to be filled in place
+ *  @param[in]  psRing      Ring
+ *  @param[in,out] pu32Count   Entries wanted; entries returned, which are
+ *                          contiguous and may be fewer
+ *  @return     The first entry, or NULL if the ring is full
+ *  @details    Fill the entries and publish them with RING_Commit(). On a
+ *              RING_MPSC ring the producer lock is held until then.
+ */
+void *RING_Reserve(RING_T *psRing, uint32_t *pu32Count)
+{
+    uint32_t u32Head, u32Idx, u32Count;
+
+    RING_Lock(psRing);
+
+    u32Head = psRing->u32Head;
+    u32Idx = u32Head & psRing->u32Mask;
+    u32Count = RING_Space(psRing, u32Head, *pu32Count);
+    if (u32Count > *pu32Count)
+        u32Count = *pu32Count;
+    if (u32Count > psRing->u32Mask + 1U - u32Idx)
+        u32Count = psRing->u32Mask + 1U - u32Idx;
+
+    *pu32Count = u32Count;
+    if (u32Count == 0U)
+    {
+        RING_Unlock(psRing);
+        return NULL;
+    }
+
+    return psRing->pu8Buf + u32Idx * psRing->u32EntrySize;
+}
+
+/**
+ *  @brief      Publishes entries filled after RING_Reserve()
+ *  @param[in]  psRing      Ring
+ *  @param[in]  u32Count    Entries filled, at most the count reserved, may be 0
+ *  @details    Call RING_CheckWake() afterwards.
+ */
+void RING_Commit(RING_T *psRing, uint32_t u32Count)
+{
+    if (u32Count)
+        RING_STORE_REL(&psRing->u32Head, psRing->u32Head + u32Count);
+
+    RING_Unlock(psRing);
+}
+
+/**
+ *  @brief      Checks whether the consumer has to be woken
+ *  @param[in]  psRing      Ring
+ *  @return     1 once after the consumer went to sleep, else 0
+ *  @details    Call once per batch written. Ring the doorbell of the
+ *              consumer core when this returns 1.
+ */
+int32_t RING_CheckWake(RING_T *psRing)
+{
+    /* The head store goes before the flag load, see RING_Sleep() */
+    RING_FENCE();
+    if (psRing->u32Sleep == 0U)
+        return 0;
+
+    psRing->u32Sleep = 0U;
+    return 1;
+}
+
+/**
+ *  @brief      Copies entries out of the ring and frees them
+ *  @param[in]  psRing      Ring
+ *  @param[out] pvData      Room for u32Count entries
+ *  @param[in]  u32Count    Entries wanted
+ *  @return     Entries read, 0 if the ring is empty
+ */
+uint32_t RING_Read(RING_T *psRing, void *pvData, uint32_t u32Count)
+{
+    uint8_t *pu8Data = (uint8_t *)pvData;
+    uint32_t u32Tail = psRing->u32Tail, u32Idx, u32First, u32Size = psRing->u32EntrySize;
+
+    u32First = RING_Used(psRing, u32Tail, u32Count);
+    if (u32Count > u32First)
+        u32Count = u32First;
+    if (u32Count == 0U)
+        return 0U;
+
+    u32Idx = u32Tail & psRing->u32Mask;
+    u32First = psRing->u32Mask + 1U - u32Idx;
+    if (u32First > u32Count)
+        u32First = u32Count;
+
+    memcpy(pu8Data, psRing->pu8Buf + u32Idx * u32Size, u32First * u32Size);
+    if (u32Count > u32First)
+        memcpy(pu8Data + u32First * u32Size, psRing->pu8Buf, (u32Count - u32First) * u32Size);
+
+    RING_STORE_REL(&psRing->u32Tail, u32Tail + u32Count);
+
+    return u32Count;
+}
+
+/**
+ *  @brief      Gets entries to be used in place
+ *  @param[in]  psRing      Ring
+ *  @param[in,out] pu32Count   Entries wanted; entries returned, which are
+ *                          contiguous and may be fewer
+ *  @return     The first entry, or NULL if the ring is empty
+ *  @details    The entries stay valid until RING_Release().
+ */
+const void *RING_Peek(RING_T *psRing, uint32_t *pu32Count)
+{
+    uint32_t u32Tail = psRing->u32Tail, u32Idx, u32Count;
+
+    u32Idx = u32Tail & psRing->u32Mask;
+    u32Count = RING_Used(psRing, u32Tail, *pu32Count);
+    if (u32Count > *pu32Count)
+        u32Count = *pu32Count;
+    if (u32Count > psRing->u32Mask + 1U - u32Idx)
+        u32Count = psRing->u32Mask + 1U - u32Idx;
+
+    *pu32Count = u32Count;
+
+    return u32Count ? psRing->pu8Buf + u32Idx * psRing->u32EntrySize : NULL;
+}
+
+/**
+ *  @brief      Frees entries got with RING_Peek()
+ *  @param[in]  psRing      Ring
+ *  @param[in]  u32Count    Entries done with, at most the count peeked
+ */
+void RING_Release(RING_T *psRing, uint32_t u32Count)
+{
+    RING_STORE_REL(&psRing->u32Tail, psRing->u32Tail + u32Count);
+}
+
+/**
+ *  @brief      Tells the producers that the consumer is going to sleep
+ *  @param[in]  psRing      Ring
+ *  @return     1 if the ring is empty and the consumer may sleep until the
+ *              doorbell, 0 if entries came in meanwhile
+ *  @details    A doorbell that comes between this call and the wait must
+ *              not be lost: wait for a semaphore given by the doorbell
+ *              interrupt, or do WFI with interrupts masked. A doorbell may
+ *              also come when the consumer is already awake.
+ */
+int32_t RING_Sleep(RING_T *psRing)
+{
+    psRing->u32Sleep = 1U;
+    /* The flag store goes before the head load, see RING_CheckWake() */
+    RING_FENCE();
+    if (RING_LOAD_ACQ(&psRing->u32Head) != psRing->u32Tail)
+    {
+        psRing->u32Sleep = 0U;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ *  @brief      Gets the number of entries in the ring
+ *  @param[in]  psRing      Ring
+ *  @return     Entries written and not yet read
+ */
+uint32_t RING_GetCount(RING_T *psRing)
+{
+    uint32_t u32Tail = RING_LOAD_ACQ(&psRing->u32Tail);
+
+    return RING_LOAD_ACQ(&psRing->u32Head) - u32Tail;
+}
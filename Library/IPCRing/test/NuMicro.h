@@ -0,0 +1,53 @@
+/**************************************************************************//**
+ * @file     NuMicro.h
+ * @brief    Host stand-in for the device header, used by the IPCRing host
+ *           test. Each test thread plays a core: cpuid() is a per-thread
+ *           number and the HWSEM channels are words taken with compare and
+ *           swap, owned by the key of the thread that took them.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __NUMICRO_H__
+#define __NUMICRO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sched.h>
+
+#define __DMB()         __sync_synchronize()
+
+typedef struct
+{
+    volatile uint32_t SEM[8];
+} HWSEM_T;
+
+extern HWSEM_T g_sSimHwsem;
+extern __thread uint32_t g_u32SimCpu;
+
+#define HWSEM0          (&g_sSimHwsem)
+
+static inline uint32_t cpuid(void)
+{
+    return g_u32SimCpu;
+}
+
+static inline void HWSEM_Spin_Lock(HWSEM_T *hwsem, uint32_t u32Num, uint8_t u8Key)
+{
+    uint32_t u32Free = 0U;
+
+    while (!__atomic_compare_exchange_n(&hwsem->SEM[u32Num], &u32Free, u8Key, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        u32Free = 0U;
+        sched_yield();
+    }
+}
+
+/* Only the owner's key unlocks, as on the hardware */
+#define HWSEM_UNLOCK(hwsem, u32Num, u8Key) \
+    do { \
+        uint32_t u32Own = (u8Key); \
+        __atomic_compare_exchange_n(&(hwsem)->SEM[(u32Num)], &u32Own, 0U, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED); \
+    } while (0)
+
+#endif /* __NUMICRO_H__ */
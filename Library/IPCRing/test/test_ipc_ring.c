@@ -0,0 +1,313 @@
+/**************************************************************************//**
+ * @file     test_ipc_ring.c
+ * @brief    Host test of the inter-core ring with threads for the cores.
+ *
+ *           Producers push numbered entries with RING_Write() and with
+ *           RING_Reserve()/RING_Commit() in batches of random size; the
+ *           consumer takes them with RING_Read() and RING_Peek()/
+ *           RING_Release(). Every entry must arrive once, intact and, per
+ *           producer, in order. With the doorbell the consumer sleeps on a
+ *           semaphore after RING_Sleep() and a lost wake-up fails the test.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "NuMicro.h"
+#include "ipc_ring.h"
+
+#define MAX_PRODUCERS   4U
+#define MAX_BATCH       7U
+#define RING_ENTRIES    64U
+#define WAKE_TIMEOUT_S  5
+#define SLOW_COMMIT     512U    /* One reservation in this many yields before the commit */
+
+HWSEM_T g_sSimHwsem;
+__thread uint32_t g_u32SimCpu;
+
+/* 12 bytes, so entries straddle the end of the ring at odd offsets */
+typedef struct
+{
+    uint32_t u32Producer;
+    uint32_t u32Seq;
+    uint32_t u32Check;
+} ENTRY_T;
+
+typedef struct
+{
+    uint32_t u32Producers;
+    uint32_t u32PerProducer;
+    int      i32Doorbell;
+} RUN_T;
+
+typedef struct
+{
+    const RUN_T *psRun;
+    uint32_t u32Id;
+    uint32_t u32Seed;
+} PRODUCER_T;
+
+static RING_T  s_sRing;
+static ENTRY_T s_asBuf[RING_ENTRIES];
+static sem_t   s_sDoorbell;
+static uint32_t s_u32Doorbells;
+static volatile int s_i32Stop;
+
+static uint32_t Rand(uint32_t *pu32Seed, uint32_t u32Range)
+{
+    *pu32Seed = *pu32Seed * 1103515245U + 12345U;
+    return ((*pu32Seed >> 16) | (*pu32Seed << 16)) % u32Range;
+}
+
+static uint32_t Check(uint32_t u32Producer, uint32_t u32Seq)
+{
+    return (u32Seq * 2654435761U) ^ (u32Producer << 24) ^ 0x5A5A5A5AU;
+}
+
+static void Doorbell(const RUN_T *psRun)
+{
+    if (psRun->i32Doorbell && RING_CheckWake(&s_sRing))
+    {
+        __atomic_add_fetch(&s_u32Doorbells, 1U, __ATOMIC_RELAXED);
+        sem_post(&s_sDoorbell);
+    }
+}
+
+static void *Producer(void *pvArg)
+{
+    PRODUCER_T *psProd = (PRODUCER_T *)pvArg;
+    const RUN_T *psRun = psProd->psRun;
+    ENTRY_T asBatch[MAX_BATCH], *psEntry;
+    uint32_t u32Seq = 0U, n, i;
+
+    /* Each producer is a core of its own, with its own HWSEM key */
+    g_u32SimCpu = 1U + psProd->u32Id;
+
+    while ((u32Seq < psRun->u32PerProducer) && !s_i32Stop)
+    {
+        n = 1U + Rand(&psProd->u32Seed, MAX_BATCH);
+        if (n > psRun->u32PerProducer - u32Seq)
+            n = psRun->u32PerProducer - u32Seq;
+
+        if (Rand(&psProd->u32Seed, 2U))
+        {
+            for (i = 0; i < n; i++)
+            {
+                asBatch[i].u32Producer = psProd->u32Id;
+                asBatch[i].u32Seq = u32Seq + i;
+                asBatch[i].u32Check = Check(psProd->u32Id, u32Seq + i);
+            }
+            n = RING_Write(&s_sRing, asBatch, n);
+        }
+        else
+        {
+            psEntry = (ENTRY_T *)RING_Reserve(&s_sRing, &n);
+            for (i = 0; i < n; i++)
+            {
+                psEntry[i].u32Producer = psProd->u32Id;
+                psEntry[i].u32Seq = u32Seq + i;
+                psEntry[i].u32Check = Check(psProd->u32Id, u32Seq + i);
+            }
+            /* Now and then a slow core: others must wait on the producer lock */
+            if ((psEntry != NULL) && (Rand(&psProd->u32Seed, SLOW_COMMIT) == 0U))
+                sched_yield();
+            if (psEntry != NULL)
+                RING_Commit(&s_sRing, n);
+        }
+
+        if (n == 0U)
+        {
+            sched_yield();
+            continue;
+        }
+        u32Seq += n;
+        Doorbell(psRun);
+    }
+    return NULL;
+}
+
+static int Consume(const RUN_T *psRun)
+{
+    ENTRY_T asBatch[MAX_BATCH + 2U];
+    const ENTRY_T *psEntry;
+    uint32_t au32Next[MAX_PRODUCERS] = { 0 };
+    uint32_t u32Total = psRun->u32Producers * psRun->u32PerProducer, u32Got = 0U, u32Seed = 99U, n, i;
+    struct timespec sTs;
+
+    while (u32Got < u32Total)
+    {
+        n = 1U + Rand(&u32Seed, MAX_BATCH + 2U);
+        if (Rand(&u32Seed, 2U))
+        {
+            n = RING_Read(&s_sRing, asBatch, n);
+            psEntry = asBatch;
+        }
+        else
+            psEntry = (const ENTRY_T *)RING_Peek(&s_sRing, &n);
+
+        for (i = 0; i < n; i++)
+        {
+            const ENTRY_T *psE = &psEntry[i];
+
+            if ((psE->u32Producer >= psRun->u32Producers) || (psE->u32Check != Check(psE->u32Producer, psE->u32Seq)))
+            {
+                printf("  entry %u is corrupt: producer %u, seq %u\n", u32Got + i, psE->u32Producer, psE->u32Seq);
+                return 1;
+            }
+            if (psE->u32Seq != au32Next[psE->u32Producer])
+            {
+                printf("  producer %u: got seq %u, expected %u\n", psE->u32Producer, psE->u32Seq,
+                       au32Next[psE->u32Producer]);
+                return 1;
+            }
+            au32Next[psE->u32Producer]++;
+        }
+        if (psEntry != asBatch)
+            RING_Release(&s_sRing, n);
+        u32Got += n;
+
+        if (n != 0U)
+            continue;
+
+        if (!psRun->i32Doorbell)
+        {
+            sched_yield();
+            continue;
+        }
+
+        /* Drained: sleep until the doorbell */
+        if (RING_Sleep(&s_sRing))
+        {
+            clock_gettime(CLOCK_REALTIME, &sTs);
+            sTs.tv_sec += WAKE_TIMEOUT_S;
+            while (sem_timedwait(&s_sDoorbell, &sTs) != 0)
+            {
+                if (errno == ETIMEDOUT)
+                {
+                    printf("  doorbell lost with %u of %u entries received, %u in the ring\n", u32Got, u32Total,
+                           RING_GetCount(&s_sRing));
+                    return 1;
+                }
+            }
+        }
+    }
+
+    if (RING_GetCount(&s_sRing) != 0U)
+    {
+        printf("  %u entries left over\n", RING_GetCount(&s_sRing));
+        return 1;
+    }
+    return 0;
+}
+
+static int Run(uint32_t u32Flags, uint32_t u32Producers, uint32_t u32PerProducer, int i32Doorbell)
+{
+    RUN_T sRun;
+    PRODUCER_T asProd[MAX_PRODUCERS];
+    pthread_t asThread[MAX_PRODUCERS];
+    uint32_t i;
+    int i32Fail;
+
+    if (RING_Init(&s_sRing, s_asBuf, RING_ENTRIES, sizeof(ENTRY_T), u32Flags) != RING_OK)
+    {
+        printf("  RING_Init failed\n");
+        return 1;
+    }
+    sem_init(&s_sDoorbell, 0, 0);
+    s_u32Doorbells = 0U;
+    s_i32Stop = 0;
+
+    sRun.u32Producers = u32Producers;
+    sRun.u32PerProducer = u32PerProducer;
+    sRun.i32Doorbell = i32Doorbell;
+    for (i = 0; i < u32Producers; i++)
+    {
+        asProd[i].psRun = &sRun;
+        asProd[i].u32Id = i;
+        asProd[i].u32Seed = 1U + i;
+        pthread_create(&asThread[i], NULL, Producer, &asProd[i]);
+    }
+
+    i32Fail = Consume(&sRun);
+
+    /* A failed consumer leaves the producers waiting on a full ring */
+    s_i32Stop = i32Fail;
+    for (i = 0; i < u32Producers; i++)
+        pthread_join(asThread[i], NULL);
+    sem_destroy(&s_sDoorbell);
+
+    if (i32Doorbell)
+        printf("  %u entries, %u doorbells\n", u32Producers * u32PerProducer, s_u32Doorbells);
+    return i32Fail;
+}
+
+static int Test_Spsc(void)
+{
+    return Run(RING_SPSC, 1U, 1000000U, 0);
+}
+
+static int Test_SpscDoorbell(void)
+{
+    return Run(RING_SPSC, 1U, 300000U, 1);
+}
+
+static int Test_MpscSpinLock(void)
+{
+    return Run(RING_MPSC, MAX_PRODUCERS, 200000U, 1);
+}
+
+static int Test_MpscHwsem(void)
+{
+    return Run(RING_MPSC_HWSEM(3), MAX_PRODUCERS, 200000U, 1);
+}
+
+static int Test_Init(void)
+{
+    static ENTRY_T asBuf[8];
+    int i32Fail = 0;
+
+    i32Fail |= RING_Init(&s_sRing, asBuf, 8U, sizeof(ENTRY_T), RING_SPSC) != RING_OK;
+    i32Fail |= RING_Init(&s_sRing, asBuf, 6U, sizeof(ENTRY_T), RING_SPSC) != RING_ERR_PARAM;
+    i32Fail |= RING_Init(&s_sRing, asBuf, 1U, sizeof(ENTRY_T), RING_SPSC) != RING_ERR_PARAM;
+    i32Fail |= RING_Init(&s_sRing, asBuf, 8U, 0U, RING_SPSC) != RING_ERR_PARAM;
+    i32Fail |= RING_Init(&s_sRing, NULL, 8U, sizeof(ENTRY_T), RING_SPSC) != RING_ERR_PARAM;
+    i32Fail |= RING_Init(&s_sRing, asBuf, 8U, sizeof(ENTRY_T), 0x2U) != RING_ERR_PARAM;
+    i32Fail |= RING_Init(&s_sRing, asBuf, 8U, sizeof(ENTRY_T), RING_MPSC_HWSEM(7)) != RING_OK;
+    /* The control block must be cache line aligned */
+    i32Fail |= RING_Init((RING_T *)((uint8_t *)&s_sRing + 4), asBuf, 8U, sizeof(ENTRY_T), RING_SPSC) != RING_ERR_PARAM;
+    if (i32Fail)
+        printf("  RING_Init accepted a bad parameter or refused a good one\n");
+    return i32Fail;
+}
+
+int main(void)
+{
+    struct
+    {
+        const char *pcName;
+        int (*pfnTest)(void);
+    } asTest[] =
+    {
+        { "Init parameters",            Test_Init },
+        { "SPSC ordering",              Test_Spsc },
+        { "SPSC with doorbell",         Test_SpscDoorbell },
+        { "MPSC spin lock ordering",    Test_MpscSpinLock },
+        { "MPSC HWSEM ordering",        Test_MpscHwsem },
+    };
+    uint32_t i;
+    int i32Fail, i32Total = 0;
+
+    for (i = 0; i < sizeof(asTest) / sizeof(asTest[0]); i++)
+    {
+        i32Fail = asTest[i].pfnTest();
+        printf("%-32s %s\n", asTest[i].pcName, i32Fail ? "FAIL" : "PASS");
+        i32Total |= i32Fail;
+    }
+
+    return i32Total;
+}
@@ -0,0 +1,242 @@
+/**************************************************************************//**
+ * @file     nand_ftl.h
+ * @brief    Log-structured flash translation layer for SPI-NAND and raw NAND
+ *
+ *           The FTL presents a NAND partition as an array of 512-byte
+ *           sectors, e.g. for FatFs. Sectors are appended to the current
+ *           block in runs of pages; each run is closed by a meta page that
+ *           lists the sector numbers of its slots, so a run either is
+ *           complete or is ignored after a power cut. Page 0 of each block
+ *           holds a header with the block sequence number and erase count.
+ *
+ *           The sector map is kept in RAM and written to checkpoint blocks
+ *           from time to time. Mount loads the newest checkpoint and replays
+ *           the runs written after it. Space is reclaimed by garbage
+ *           collecting the block with the fewest valid sectors, free blocks
+ *           are taken lowest erase count first, and a block holding cold
+ *           data is moved when the spread of erase counts grows too large.
+ *
+ *           The FTL does not use the spare area, so any driver with its own
+ *           ECC and bad block marking can sit below it through FTL_PORT_T.
+ *           It is not reentrant; callers serialize access, as FatFs does.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __NAND_FTL_H__
+#define __NAND_FTL_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @addtogroup NAND_FTL_Library NAND Flash Translation Layer Library
+  @{
+*/
+
+/** @addtogroup NAND_FTL_EXPORTED_CONSTANTS NAND FTL Exported Constants
+  @{
+*/
+
+#define FTL_OK                  0       /*!< Operation succeeded */
+#define FTL_ERR_PARAM           -1      /*!< Invalid parameter or geometry */
+#define FTL_ERR_IO              -2      /*!< Uncorrectable read or failed port access */
+#define FTL_ERR_NOSPC           -3      /*!< Too many bad blocks to go on writing */
+#define FTL_ERR_FORMAT          -4      /*!< The partition holds no FTL, see FTL_Format() */
+#define FTL_ERR_WORK            -5      /*!< Work area smaller than FTL_GetWorkSize() */
+
+#define FTL_PORT_SCRUB          1       /*!< Port read result: data good, but the block should be rewritten */
+
+#define FTL_SECTOR_SIZE         512U    /*!< Sector size seen by the host */
+#define FTL_MAX_PAGE_SIZE       8192U   /*!< Largest supported page size */
+#define FTL_MAX_PAGES_PER_BLOCK 256U    /*!< Largest supported pages per block */
+
+/*! @}*/ /* end of group NAND_FTL_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup NAND_FTL_EXPORTED_STRUCTS NAND FTL Exported Structs
+  @{
+*/
+
+/**
+ *  @brief  Flash access used by the FTL.
+ *          Pages and blocks are numbered from the start of the device.
+ *          Every function returns FTL_OK or a negative value on failure;
+ *          pfnRead may also return FTL_PORT_SCRUB and pfnIsBad returns 1
+ *          for a bad block. Buffers are 4-byte aligned.
+ */
+typedef struct
+{
+    uint32_t    u32PageSize;            /*!< Main area bytes per page, a multiple of FTL_SECTOR_SIZE */
+    uint32_t    u32PagesPerBlock;       /*!< Pages per erase block */
+    uint32_t    u32Blocks;              /*!< Blocks in the device */
+    void        *pvCtx;                 /*!< Passed to every function */
+    int32_t (*pfnRead)(void *pvCtx, uint32_t u32Page, uint32_t u32Count, uint8_t *pu8Buf);     /*!< Read u32Count pages of one block */
+    int32_t (*pfnProgram)(void *pvCtx, uint32_t u32Page, const uint8_t *pu8Buf);             /*!< Program one page */
+    int32_t (*pfnErase)(void *pvCtx, uint32_t u32Block);                                     /*!< Erase one block */
+    int32_t (*pfnIsBad)(void *pvCtx, uint32_t u32Block);                                     /*!< Bad block check */
+    int32_t (*pfnMarkBad)(void *pvCtx, uint32_t u32Block);                                   /*!< Bad block marking */
+} FTL_PORT_T;
+
+/**
+ *  @brief  FTL configuration for FTL_Mount() and FTL_Format().
+ */
+typedef struct
+{
+    const FTL_PORT_T    *psPort;        /*!< Flash access */
+    uint32_t    u32FirstBlock;          /*!< First block of the partition */
+    uint32_t    u32Blocks;              /*!< Blocks in the partition, 0 for the rest of the device */
+    void        *pvWork;                /*!< Work area, 8-byte aligned */
+    uint32_t    u32WorkSize;            /*!< Bytes at pvWork, at least FTL_GetWorkSize() */
+} FTL_CFG_T;
+
+/**
+ *  @brief  FTL counters since mount.
+ *          Write amplification is u32PagesProgrammed * sectors per page
+ *          divided by u32HostWrites.
+ */
+typedef struct
+{
+    uint32_t    u32Sectors;             /*!< Sectors exported to the host */
+    uint32_t    u32SectorsPerPage;      /*!< Sectors per NAND page */
+    uint32_t    u32HostWrites;          /*!< Sectors written by the host */
+    uint32_t    u32HostReads;           /*!< Sectors read by the host */
+    uint32_t    u32Trimmed;             /*!< Sectors trimmed by the host */
+    uint32_t    u32PagesProgrammed;     /*!< All pages programmed */
+    uint32_t    u32DataPages;           /*!< Pages holding host or relocated sectors */
+    uint32_t    u32MetaPages;           /*!< Run meta pages */
+    uint32_t    u32HeaderPages;         /*!< Block header pages */
+    uint32_t    u32CkptPages;           /*!< Checkpoint pages */
+    uint32_t    u32PadSectors;          /*!< Empty slots programmed by FTL_Sync() */
+    uint32_t    u32GcSectors;           /*!< Sectors relocated by garbage collection */
+    uint32_t    u32GcBlocks;            /*!< Blocks reclaimed */
+    uint32_t    u32WearMoves;           /*!< Blocks reclaimed for wear leveling */
+    uint32_t    u32Checkpoints;         /*!< Checkpoints written */
+    uint32_t    u32Erases;              /*!< Blocks erased */
+    uint32_t    u32PagesRead;           /*!< Pages read from the port */
+    uint32_t    u32BadBlocks;           /*!< Bad blocks in the partition */
+    uint32_t    u32FreeBlocks;          /*!< Erased blocks ready for use */
+    uint32_t    u32MinErase;            /*!< Lowest erase count of a good block */
+    uint32_t    u32MaxErase;            /*!< Highest erase count of a good block */
+    uint32_t    u32ReplayedPages;       /*!< Pages scanned by the last mount after the checkpoint */
+} FTL_STAT_T;
+
+/** @cond HIDDEN_SYMBOLS */
+typedef struct
+{
+    uint32_t    u32Erase;               /* Erase count */
+    uint32_t    u32Seq;                 /* Sequence number from the header */
+    uint32_t    u32Ckpt;                /* Checkpoint blocks: checkpoint number */
+    uint16_t    u16Valid;               /* Data blocks: valid sectors. Checkpoint blocks: index */
+    uint8_t     u8State;                /* FTL_BLK_xxx */
+    uint8_t     u8Flags;                /* FTL_BF_xxx */
+} FTL_BLK_T;
+/** @endcond HIDDEN_SYMBOLS */
+
+/**
+ *  @brief  FTL instance. All fields are private.
+ */
+typedef struct
+{
+    /** @cond HIDDEN_SYMBOLS */
+    const FTL_PORT_T *psPort;
+    uint32_t    u32FirstBlock;
+    uint32_t    u32Blocks;
+    uint32_t    u32PageSize;
+    uint32_t    u32Ppb;                 /* Pages per block */
+    uint32_t    u32Spp;                 /* Sectors per page */
+    uint32_t    u32RunMax;              /* Most data pages per run */
+    uint32_t    u32Sectors;             /* Exported sectors */
+    uint32_t    u32CkptBytes;           /* Checkpoint stream length */
+    uint32_t    u32CkptPages;
+    uint32_t    u32CkptBlocks;          /* Blocks taken by one checkpoint */
+    uint32_t    u32GcLow;               /* Collect garbage below this many free blocks */
+    uint32_t    *pu32Map;               /* Sector -> slot */
+    uint32_t    *pu32Rmap;              /* Slot -> sector */
+    FTL_BLK_T   *psBlk;
+    uint8_t     *pu8Wbuf;               /* Page being filled */
+    uint8_t     *pu8Cache;              /* Last page read */
+    uint8_t     *pu8Meta;               /* Meta page of the current run */
+    uint8_t     *pu8Tmp;
+    uint32_t    u32CachePage;
+    uint32_t    u32Seq;                 /* Last block sequence number used */
+    uint32_t    u32CkptSeq;             /* Last checkpoint number used */
+    uint32_t    u32CkptPrev;            /* Checkpoint number of the blocks in use, 0 if none */
+    uint32_t    u32SinceCkpt;           /* Pages programmed since the last checkpoint */
+    uint32_t    u32Open;                /* Block being written */
+    uint32_t    u32Page;                /* Next page in it */
+    uint32_t    u32RunStart;            /* First data page of the current run */
+    uint32_t    u32Fill;                /* Sectors in pu8Wbuf */
+    uint32_t    u32Busy;                /* Nesting of garbage collection */
+    uint32_t    u32GcCount;
+    uint32_t    u32Dirty;               /* Map changed since the last checkpoint */
+    uint32_t    u32Mounted;
+    FTL_STAT_T  sStat;
+    /** @endcond HIDDEN_SYMBOLS */
+} FTL_T;
+
+/**
+ *  @brief  NAND simulator in RAM, for FTL_SimPort().
+ *          Programming only clears bits, like NAND, so a page programmed
+ *          twice without an erase is caught by the FTL's CRCs. When
+ *          u32CutAfter program and erase operations have been done, the
+ *          next one is left half done and every later access fails, as
+ *          on a power cut; clear u32Cut to power up again.
+ */
+typedef struct
+{
+    uint8_t     *pu8Mem;                /*!< u32Blocks * u32PagesPerBlock * u32PageSize bytes */
+    uint8_t     *pu8Bad;                /*!< One byte per block, nonzero for a bad block */
+    uint32_t    u32PageSize;            /*!< Bytes per page */
+    uint32_t    u32PagesPerBlock;       /*!< Pages per block */
+    uint32_t    u32Blocks;              /*!< Blocks */
+    uint32_t    u32CutAfter;            /*!< Operations until the power cut, 0 for none */
+    uint32_t    u32FailRate;            /*!< One program in this many fails, 0 for none */
+    uint32_t    u32Seed;                /*!< Random seed for cuts and failures */
+    uint32_t    u32Cut;                 /*!< Set once the power is cut */
+    uint32_t    u32Reads;               /*!< Pages read */
+    uint32_t    u32Programs;            /*!< Pages programmed */
+    uint32_t    u32Erases;              /*!< Blocks erased */
+} FTL_SIM_T;
+
+/*! @}*/ /* end of group NAND_FTL_EXPORTED_STRUCTS */
+
+
+/** @addtogroup NAND_FTL_EXPORTED_FUNCTIONS NAND FTL Exported Functions
+  @{
+*/
+
+uint32_t FTL_GetWorkSize(const FTL_PORT_T *psPort, uint32_t u32Blocks);
+int32_t  FTL_Format(FTL_T *psFtl, const FTL_CFG_T *psCfg);
+int32_t  FTL_Mount(FTL_T *psFtl, const FTL_CFG_T *psCfg);
+int32_t  FTL_Unmount(FTL_T *psFtl);
+uint32_t FTL_GetSectorCount(FTL_T *psFtl);
+uint32_t FTL_GetEraseSectors(FTL_T *psFtl);
+int32_t  FTL_Read(FTL_T *psFtl, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf);
+int32_t  FTL_Write(FTL_T *psFtl, uint32_t u32Sector, uint32_t u32Count, const uint8_t *pu8Buf);
+int32_t  FTL_Trim(FTL_T *psFtl, uint32_t u32Sector, uint32_t u32Count);
+int32_t  FTL_Sync(FTL_T *psFtl);
+int32_t  FTL_Checkpoint(FTL_T *psFtl);
+void     FTL_GetStat(FTL_T *psFtl, FTL_STAT_T *psStat);
+
+/* Ports. Include sflash_svc.h (or NuMicro.h) first for the SPI-NAND port; the
+   MTD port is built with the yaffs2 U-Boot MTD headers on the include path. */
+#ifdef __SFLASH_SVC_H__
+int32_t  FTL_SflashPort(FTL_PORT_T *psPort, SFLASH_SVC_T *psSvc);
+#endif
+struct mtd_info;
+int32_t  FTL_MtdPort(FTL_PORT_T *psPort, struct mtd_info *psMtd);
+int32_t  FTL_SimPort(FTL_PORT_T *psPort, FTL_SIM_T *psSim);
+
+/*! @}*/ /* end of group NAND_FTL_EXPORTED_FUNCTIONS */
+
+/*! @}*/ /* end of group NAND_FTL_Library */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NAND_FTL_H__ */
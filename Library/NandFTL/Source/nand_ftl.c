@@ -0,0 +1,1440 @@
+/**************************************************************************//**
+ * @file     nand_ftl.c
+ * @brief    Log-structured flash translation layer for SPI-NAND and raw NAND
+ *
+ *           A slot is one sector of one page, numbered
+ *           (block * pages per block + page) * sectors per page + sector,
+ *           with blocks counted from the start of the partition.
+ *
+ *           Block layout:
+ *             page 0           header: type, sequence number, erase count
+ *             data pages       slots of the current run
+ *             meta page        sector number of every slot of the run
+ *             ...              further runs
+ *           A run ends when it reaches u32RunMax pages, when the block is
+ *           full and on FTL_Sync(). A block is only appended to while it is
+ *           open; after a power cut the FTL starts a new one.
+ *
+ *           Checkpoint blocks hold a header and then a stream made of
+ *           FTL_CKPT_T, the erase count of every block, the sector map and
+ *           a CRC32 of all that. Blocks whose sequence number is higher than
+ *           the one recorded in the checkpoint are replayed on mount, as is
+ *           the rest of the block that was open when it was taken.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <string.h>
+#include "nand_ftl.h"
+
+/** @cond HIDDEN_SYMBOLS */
+
+#define FTL_NONE            0xFFFFFFFFU
+
+#define FTL_MAGIC_BLOCK     0x4C54464EU     /* "NFTL" */
+#define FTL_MAGIC_META      0x4154454DU     /* "META" */
+#define FTL_MAGIC_CKPT      0x54504B43U     /* "CKPT" */
+#define FTL_VERSION         1U
+
+#define FTL_TYPE_DATA       1U
+#define FTL_TYPE_CKPT       2U
+
+#define FTL_BLK_FREE        0U              /* Erased */
+#define FTL_BLK_DATA        1U              /* Written, closed */
+#define FTL_BLK_OPEN        2U              /* Being written */
+#define FTL_BLK_CKPT        3U              /* Part of a checkpoint */
+#define FTL_BLK_BAD         4U
+#define FTL_BLK_DIRTY       5U              /* Neither erased nor valid, found on mount */
+
+#define FTL_BF_SCRUB        0x01U           /* Read needed correction near the limit */
+#define FTL_BF_RETIRE       0x02U           /* Program failed, mark bad once empty */
+#define FTL_BF_ERASE        0x04U           /* Looked erased on mount, erase before use */
+
+#define FTL_WEAR_GAP        64U             /* Erase count spread that moves cold data */
+#define FTL_WEAR_PERIOD     16U             /* Look at the spread every this many collections */
+#define FTL_CKPT_RATIO      16U             /* Checkpoint after programming this many times its size */
+#define FTL_MIN_BLOCKS      16U
+
+#define FTL_META_HDR        32U             /* Meta page header bytes, followed by the sector list */
+
+typedef struct
+{
+    uint32_t    u32Magic;
+    uint32_t    u32Version;
+    uint32_t    u32Type;
+    uint32_t    u32Seq;
+    uint32_t    u32Erase;
+    uint32_t    u32Ckpt;                    /* Checkpoint number */
+    uint32_t    u32Index;                   /* Block index within the checkpoint */
+    uint32_t    u32Geometry;                /* Page size << 16 | pages per block */
+    uint32_t    u32Sectors;
+    uint32_t    u32Crc;
+} FTL_HDR_T;
+
+typedef struct
+{
+    uint32_t    u32Magic;
+    uint32_t    u32Seq;                     /* Sequence number of the block */
+    uint32_t    u32First;                   /* First data page of the run */
+    uint32_t    u32Count;                   /* Data pages in the run */
+    uint32_t    u32Crc;                     /* Of the 16 bytes above and the sector list */
+} FTL_META_T;
+
+typedef struct
+{
+    uint32_t    u32Magic;
+    uint32_t    u32Number;
+    uint32_t    u32Seq;                     /* Highest sequence number covered */
+    uint32_t    u32Open;                    /* Block open at that time, or FTL_NONE */
+    uint32_t    u32Page;                    /* Its next page */
+    uint32_t    u32Blocks;
+    uint32_t    u32Sectors;
+    uint32_t    u32Resv;
+} FTL_CKPT_T;
+
+static const uint32_t s_au32Crc16[16] =
+{
+    0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU, 0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+    0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU, 0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU
+};
+
+/* CRC-32 (IEEE), running value without the final inversion */
+static uint32_t FTL_Crc(uint32_t u32Crc, const void *pvData, uint32_t u32Len)
+{
+    const uint8_t *pu8 = (const uint8_t *)pvData;
+
+    while (u32Len--)
+    {
+        u32Crc ^= *pu8++;
+        u32Crc = (u32Crc >> 4) ^ s_au32Crc16[u32Crc & 0xFU];
+        u32Crc = (u32Crc >> 4) ^ s_au32Crc16[u32Crc & 0xFU];
+    }
+    return u32Crc;
+}
+
+static uint32_t FTL_AbsPage(FTL_T *psFtl, uint32_t u32Blk, uint32_t u32Page)
+{
+    return (psFtl->u32FirstBlock + u32Blk) * psFtl->u32Ppb + u32Page;
+}
+
+static uint32_t FTL_Slot(FTL_T *psFtl, uint32_t u32Blk, uint32_t u32Page, uint32_t u32Sec)
+{
+    return (u32Blk * psFtl->u32Ppb + u32Page) * psFtl->u32Spp + u32Sec;
+}
+
+static uint32_t *FTL_RunList(FTL_T *psFtl)
+{
+    return (uint32_t *)(psFtl->pu8Meta + FTL_META_HDR);
+}
+
+static int32_t FTL_IsErased(const uint8_t *pu8Buf, uint32_t u32Len)
+{
+    const uint32_t *pu32 = (const uint32_t *)pu8Buf;
+    uint32_t i;
+
+    for (i = 0; i < u32Len / 4U; i++)
+    {
+        if (pu32[i] != FTL_NONE)
+            return 0;
+    }
+    return 1;
+}
+
+/* Geometry and sizes derived from the port; the work area is not touched */
+static int32_t FTL_Layout(FTL_T *psFtl, const FTL_PORT_T *psPort, uint32_t u32FirstBlock, uint32_t u32Blocks)
+{
+    uint32_t u32Spare, u32Usable, u32DataPages, i;
+
+    if ((psPort == NULL) || (psPort->u32PageSize == 0U) || (psPort->u32PageSize % FTL_SECTOR_SIZE) ||
+            (psPort->u32PageSize > FTL_MAX_PAGE_SIZE) || (psPort->u32PagesPerBlock < 4U) ||
+            (psPort->u32PagesPerBlock > FTL_MAX_PAGES_PER_BLOCK) || (u32FirstBlock >= psPort->u32Blocks))
+        return FTL_ERR_PARAM;
+
+    if (u32Blocks == 0U)
+        u32Blocks = psPort->u32Blocks - u32FirstBlock;
+    if ((u32Blocks < FTL_MIN_BLOCKS) || (u32Blocks > psPort->u32Blocks - u32FirstBlock))
+        return FTL_ERR_PARAM;
+
+    psFtl->psPort = psPort;
+    psFtl->u32FirstBlock = u32FirstBlock;
+    psFtl->u32Blocks = u32Blocks;
+    psFtl->u32PageSize = psPort->u32PageSize;
+    psFtl->u32Ppb = psPort->u32PagesPerBlock;
+    psFtl->u32Spp = psPort->u32PageSize / FTL_SECTOR_SIZE;
+
+    psFtl->u32RunMax = (psFtl->u32PageSize - FTL_META_HDR) / (4U * psFtl->u32Spp);
+    if (psFtl->u32RunMax > psFtl->u32Ppb - 2U)
+        psFtl->u32RunMax = psFtl->u32Ppb - 2U;
+
+    /* Room for bad blocks (2 %) and over-provisioning that keeps garbage
+       collection cheap (4 %, at least 4 blocks) */
+    u32Spare = u32Blocks / 50U + ((u32Blocks / 25U > 4U) ? u32Blocks / 25U : 4U);
+    u32Usable = u32Blocks - u32Spare;
+    u32DataPages = psFtl->u32Ppb - 1U - (psFtl->u32Ppb - 1U + psFtl->u32RunMax) / (psFtl->u32RunMax + 1U);
+
+    /* The checkpoint size depends on the sector count and the other way round */
+    psFtl->u32CkptBlocks = 1U;
+    for (i = 0; i < 3U; i++)
+    {
+        /* Two checkpoints, the open block and the collection reserve */
+        if (u32Usable <= 2U * psFtl->u32CkptBlocks + 3U)
+            return FTL_ERR_PARAM;
+        psFtl->u32Sectors = (u32Usable - 2U * psFtl->u32CkptBlocks - 3U) * u32DataPages * psFtl->u32Spp;
+        psFtl->u32CkptBytes = sizeof(FTL_CKPT_T) + 4U * u32Blocks + 4U * psFtl->u32Sectors + 4U;
+        psFtl->u32CkptPages = (psFtl->u32CkptBytes + psFtl->u32PageSize - 1U) / psFtl->u32PageSize;
+        psFtl->u32CkptBlocks = (psFtl->u32CkptPages + psFtl->u32Ppb - 2U) / (psFtl->u32Ppb - 1U);
+    }
+    if (u32Usable <= 2U * psFtl->u32CkptBlocks + 3U)
+        return FTL_ERR_PARAM;
+    psFtl->u32GcLow = psFtl->u32CkptBlocks + 2U;
+
+    return FTL_OK;
+}
+
+static uint32_t FTL_WorkSize(FTL_T *psFtl)
+{
+    return 4U * psFtl->u32Sectors + 4U * psFtl->u32Blocks * psFtl->u32Ppb * psFtl->u32Spp +
+           ((sizeof(FTL_BLK_T) * psFtl->u32Blocks + 7U) & ~7U) + 4U * psFtl->u32PageSize;
+}
+
+static int32_t FTL_Init(FTL_T *psFtl, const FTL_CFG_T *psCfg)
+{
+    uint8_t *pu8;
+    int32_t i32Ret;
+
+    if ((psFtl == NULL) || (psCfg == NULL))
+        return FTL_ERR_PARAM;
+
+    memset(psFtl, 0, sizeof(FTL_T));
+    i32Ret = FTL_Layout(psFtl, psCfg->psPort, psCfg->u32FirstBlock, psCfg->u32Blocks);
+    if (i32Ret != FTL_OK)
+        return i32Ret;
+    if ((psCfg->pvWork == NULL) || ((uintptr_t)psCfg->pvWork & 7U) || (psCfg->u32WorkSize < FTL_WorkSize(psFtl)))
+        return FTL_ERR_WORK;
+
+    /* Page buffers first, so they stay aligned for DMA */
+    pu8 = (uint8_t *)psCfg->pvWork;
+    psFtl->pu8Wbuf = pu8;
+    pu8 += psFtl->u32PageSize;
+    psFtl->pu8Cache = pu8;
+    pu8 += psFtl->u32PageSize;
+    psFtl->pu8Meta = pu8;
+    pu8 += psFtl->u32PageSize;
+    psFtl->pu8Tmp = pu8;
+    pu8 += psFtl->u32PageSize;
+    psFtl->psBlk = (FTL_BLK_T *)pu8;
+    pu8 += (sizeof(FTL_BLK_T) * psFtl->u32Blocks + 7U) & ~7U;
+    psFtl->pu32Map = (uint32_t *)pu8;
+    pu8 += 4U * psFtl->u32Sectors;
+    psFtl->pu32Rmap = (uint32_t *)pu8;
+
+    memset(psFtl->psBlk, 0, sizeof(FTL_BLK_T) * psFtl->u32Blocks);
+    memset(psFtl->pu32Map, 0xFF, 4U * psFtl->u32Sectors);
+    memset(psFtl->pu32Rmap, 0xFF, 4U * psFtl->u32Blocks * psFtl->u32Ppb * psFtl->u32Spp);
+    psFtl->u32CachePage = FTL_NONE;
+    psFtl->u32Open = FTL_NONE;
+    psFtl->sStat.u32Sectors = psFtl->u32Sectors;
+    psFtl->sStat.u32SectorsPerPage = psFtl->u32Spp;
+
+    return FTL_OK;
+}
+
+static int32_t FTL_PortRead(FTL_T *psFtl, uint32_t u32Blk, uint32_t u32Page, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    const FTL_PORT_T *psPort = psFtl->psPort;
+    int32_t i32Ret;
+
+    i32Ret = psPort->pfnRead(psPort->pvCtx, FTL_AbsPage(psFtl, u32Blk, u32Page), u32Count, pu8Buf);
+    psFtl->sStat.u32PagesRead += u32Count;
+    if (i32Ret == FTL_PORT_SCRUB)
+    {
+        psFtl->psBlk[u32Blk].u8Flags |= FTL_BF_SCRUB;
+        i32Ret = FTL_OK;
+    }
+    return (i32Ret < 0) ? FTL_ERR_IO : FTL_OK;
+}
+
+static int32_t FTL_PortProgram(FTL_T *psFtl, uint32_t u32Blk, uint32_t u32Page, const uint8_t *pu8Buf)
+{
+    const FTL_PORT_T *psPort = psFtl->psPort;
+
+    psFtl->sStat.u32PagesProgrammed++;
+    psFtl->u32SinceCkpt++;
+    return (psPort->pfnProgram(psPort->pvCtx, FTL_AbsPage(psFtl, u32Blk, u32Page), pu8Buf) < 0) ? FTL_ERR_IO : FTL_OK;
+}
+
+/* Partition-relative page into pu8Cache */
+static int32_t FTL_LoadPage(FTL_T *psFtl, uint32_t u32Blk, uint32_t u32Page)
+{
+    uint32_t u32Id = u32Blk * psFtl->u32Ppb + u32Page;
+    int32_t i32Ret;
+
+    if (u32Id == psFtl->u32CachePage)
+        return FTL_OK;
+
+    psFtl->u32CachePage = FTL_NONE;
+    i32Ret = FTL_PortRead(psFtl, u32Blk, u32Page, 1U, psFtl->pu8Cache);
+    if (i32Ret == FTL_OK)
+        psFtl->u32CachePage = u32Id;
+    return i32Ret;
+}
+
+static void FTL_MarkBad(FTL_T *psFtl, uint32_t u32Blk)
+{
+    const FTL_PORT_T *psPort = psFtl->psPort;
+
+    (void)psPort->pfnMarkBad(psPort->pvCtx, psFtl->u32FirstBlock + u32Blk);
+    psFtl->psBlk[u32Blk].u8State = FTL_BLK_BAD;
+    psFtl->psBlk[u32Blk].u8Flags = 0U;
+    psFtl->psBlk[u32Blk].u16Valid = 0U;
+    psFtl->sStat.u32BadBlocks++;
+}
+
+/* Erases a block into the free pool, or retires it */
+static void FTL_Release(FTL_T *psFtl, uint32_t u32Blk)
+{
+    const FTL_PORT_T *psPort = psFtl->psPort;
+    FTL_BLK_T *psBlk = &psFtl->psBlk[u32Blk];
+
+    if (psFtl->u32CachePage / psFtl->u32Ppb == u32Blk)
+        psFtl->u32CachePage = FTL_NONE;
+
+    if (psBlk->u8Flags & FTL_BF_RETIRE)
+    {
+        FTL_MarkBad(psFtl, u32Blk);
+        return;
+    }
+
+    psFtl->sStat.u32Erases++;
+    psBlk->u32Erase++;
+    if (psPort->pfnErase(psPort->pvCtx, psFtl->u32FirstBlock + u32Blk) < 0)
+    {
+        FTL_MarkBad(psFtl, u32Blk);
+        return;
+    }
+    psBlk->u8State = FTL_BLK_FREE;
+    psBlk->u8Flags = 0U;
+    psBlk->u16Valid = 0U;
+    psBlk->u32Seq = 0U;
+    psBlk->u32Ckpt = 0U;
+    psFtl->sStat.u32FreeBlocks++;
+}
+
+/* Free block with the lowest erase count, or the highest one for cold
+   data, taken out of the pool */
+static uint32_t FTL_Alloc(FTL_T *psFtl, uint32_t u32Worn)
+{
+    const FTL_PORT_T *psPort = psFtl->psPort;
+    FTL_BLK_T *psBlk = psFtl->psBlk;
+    uint32_t i, u32Best;
+
+    for (;;)
+    {
+        u32Best = FTL_NONE;
+        for (i = 0; i < psFtl->u32Blocks; i++)
+        {
+            if ((psBlk[i].u8State == FTL_BLK_FREE) &&
+                    ((u32Best == FTL_NONE) || (u32Worn ? (psBlk[i].u32Erase > psBlk[u32Best].u32Erase) :
+                                               (psBlk[i].u32Erase < psBlk[u32Best].u32Erase))))
+                u32Best = i;
+        }
+        if (u32Best == FTL_NONE)
+            return FTL_NONE;
+        psFtl->sStat.u32FreeBlocks--;
+
+        /* An erase cut short can leave page 0 erased and the rest not */
+        if (!(psBlk[u32Best].u8Flags & FTL_BF_ERASE))
+            return u32Best;
+        psBlk[u32Best].u8Flags &= ~FTL_BF_ERASE;
+        psBlk[u32Best].u32Erase++;
+        psFtl->sStat.u32Erases++;
+        if (psPort->pfnErase(psPort->pvCtx, psFtl->u32FirstBlock + u32Best) == FTL_OK)
+            return u32Best;
+        FTL_MarkBad(psFtl, u32Best);
+    }
+}
+
+static int32_t FTL_WriteHeader(FTL_T *psFtl, uint32_t u32Blk, uint32_t u32Type, uint32_t u32Ckpt, uint32_t u32Index)
+{
+    FTL_HDR_T *psHdr = (FTL_HDR_T *)psFtl->pu8Tmp;
+
+    memset(psFtl->pu8Tmp, 0xFF, psFtl->u32PageSize);
+    psHdr->u32Magic = FTL_MAGIC_BLOCK;
+    psHdr->u32Version = FTL_VERSION;
+    psHdr->u32Type = u32Type;
+    psHdr->u32Seq = psFtl->u32Seq;
+    psHdr->u32Erase = psFtl->psBlk[u32Blk].u32Erase;
+    psHdr->u32Ckpt = u32Ckpt;
+    psHdr->u32Index = u32Index;
+    psHdr->u32Geometry = (psFtl->u32PageSize << 16) | psFtl->u32Ppb;
+    psHdr->u32Sectors = psFtl->u32Sectors;
+    psHdr->u32Crc = FTL_Crc(FTL_NONE, psHdr, sizeof(FTL_HDR_T) - 4U);
+    psFtl->sStat.u32HeaderPages++;
+
+    return FTL_PortProgram(psFtl, u32Blk, 0U, psFtl->pu8Tmp);
+}
+
+/* Takes a free block and makes it the open data block, without collecting garbage */
+static int32_t FTL_OpenRaw(FTL_T *psFtl, uint32_t u32Worn)
+{
+    uint32_t u32Blk;
+
+    for (;;)
+    {
+        u32Blk = FTL_Alloc(psFtl, u32Worn);
+        if (u32Blk == FTL_NONE)
+            return FTL_ERR_NOSPC;
+
+        psFtl->u32Seq++;
+        if (FTL_WriteHeader(psFtl, u32Blk, FTL_TYPE_DATA, 0U, 0U) == FTL_OK)
+            break;
+        FTL_MarkBad(psFtl, u32Blk);
+    }
+
+    psFtl->psBlk[u32Blk].u8State = FTL_BLK_OPEN;
+    psFtl->psBlk[u32Blk].u32Seq = psFtl->u32Seq;
+    psFtl->psBlk[u32Blk].u16Valid = 0U;
+    psFtl->u32Open = u32Blk;
+    psFtl->u32Page = 1U;
+    psFtl->u32RunStart = 1U;
+    psFtl->u32Fill = 0U;
+    return FTL_OK;
+}
+
+static void FTL_Unmap(FTL_T *psFtl, uint32_t u32Sector)
+{
+    uint32_t u32Slot = psFtl->pu32Map[u32Sector];
+
+    if (u32Slot != FTL_NONE)
+    {
+        psFtl->pu32Rmap[u32Slot] = FTL_NONE;
+        psFtl->psBlk[u32Slot / (psFtl->u32Ppb * psFtl->u32Spp)].u16Valid--;
+        psFtl->pu32Map[u32Sector] = FTL_NONE;
+    }
+}
+
+static void FTL_Map(FTL_T *psFtl, uint32_t u32Sector, uint32_t u32Slot)
+{
+    FTL_Unmap(psFtl, u32Sector);
+    psFtl->pu32Map[u32Sector] = u32Slot;
+    psFtl->pu32Rmap[u32Slot] = u32Sector;
+    psFtl->psBlk[u32Slot / (psFtl->u32Ppb * psFtl->u32Spp)].u16Valid++;
+}
+
+/*
+ * A program in the open block failed. The pages of the uncommitted run are
+ * copied to a new block at the same offsets, so the run's sector list stays
+ * as it is, and the old block is retired once collected. The caller retries
+ * the failed page at psFtl->u32Page.
+ */
+static int32_t FTL_MoveRun(FTL_T *psFtl, uint32_t u32Pending)
+{
+    uint32_t u32Old = psFtl->u32Open, u32OldStart = psFtl->u32RunStart;
+    uint32_t u32Pages = psFtl->u32Page - psFtl->u32RunStart;
+    uint32_t u32New, i, j, u32From, u32To, u32Sector;
+    int32_t i32Ret;
+
+    psFtl->psBlk[u32Old].u8State = FTL_BLK_DATA;
+    psFtl->psBlk[u32Old].u8Flags |= FTL_BF_RETIRE;
+
+    for (;;)
+    {
+        psFtl->u32Open = FTL_NONE;
+        i32Ret = FTL_OpenRaw(psFtl, 0U);
+        if (i32Ret != FTL_OK)
+            return i32Ret;
+        u32New = psFtl->u32Open;
+
+        for (i = 0; i < u32Pages; i++)
+        {
+            if (FTL_LoadPage(psFtl, u32Old, u32OldStart + i) != FTL_OK)
+                memset(psFtl->pu8Cache, 0xFF, psFtl->u32PageSize);
+            i32Ret = FTL_PortProgram(psFtl, u32New, 1U + i, psFtl->pu8Cache);
+            if (i32Ret != FTL_OK)
+                break;
+            psFtl->sStat.u32DataPages++;
+        }
+        if (i == u32Pages)
+            break;
+        FTL_MarkBad(psFtl, u32New);
+    }
+
+    /* Move the sectors that still live in the copied pages and in the page buffer */
+    for (i = 0; i < u32Pages + u32Pending; i++)
+    {
+        for (j = 0; j < psFtl->u32Spp; j++)
+        {
+            u32From = FTL_Slot(psFtl, u32Old, u32OldStart + i, j);
+            u32To = FTL_Slot(psFtl, u32New, 1U + i, j);
+            u32Sector = psFtl->pu32Rmap[u32From];
+            if (u32Sector != FTL_NONE)
+                FTL_Map(psFtl, u32Sector, u32To);
+        }
+    }
+
+    psFtl->u32RunStart = 1U;
+    psFtl->u32Page = 1U + u32Pages;
+    return FTL_OK;
+}
+
+static int32_t FTL_Close(FTL_T *psFtl)
+{
+    psFtl->psBlk[psFtl->u32Open].u8State = FTL_BLK_DATA;
+    psFtl->u32Open = FTL_NONE;
+    return FTL_OK;
+}
+
+/* Writes the meta page of the current run */
+static int32_t FTL_Commit(FTL_T *psFtl)
+{
+    FTL_META_T *psMeta = (FTL_META_T *)psFtl->pu8Meta;
+    uint32_t u32Count;
+    int32_t i32Ret;
+
+    if ((psFtl->u32Open == FTL_NONE) || (psFtl->u32Page == psFtl->u32RunStart))
+        return FTL_OK;
+
+    for (;;)
+    {
+        u32Count = psFtl->u32Page - psFtl->u32RunStart;
+        psMeta->u32Magic = FTL_MAGIC_META;
+        psMeta->u32Seq = psFtl->psBlk[psFtl->u32Open].u32Seq;
+        psMeta->u32First = psFtl->u32RunStart;
+        psMeta->u32Count = u32Count;
+        psMeta->u32Crc = FTL_Crc(FTL_Crc(FTL_NONE, psMeta, 16U), FTL_RunList(psFtl), 4U * u32Count * psFtl->u32Spp);
+        memset(psFtl->pu8Meta + FTL_META_HDR + 4U * u32Count * psFtl->u32Spp, 0xFF,
+               psFtl->u32PageSize - FTL_META_HDR - 4U * u32Count * psFtl->u32Spp);
+
+        psFtl->sStat.u32MetaPages++;
+        if (FTL_PortProgram(psFtl, psFtl->u32Open, psFtl->u32Page, psFtl->pu8Meta) == FTL_OK)
+            break;
+        i32Ret = FTL_MoveRun(psFtl, 0U);
+        if (i32Ret != FTL_OK)
+            return i32Ret;
+    }
+
+    psFtl->u32Page++;
+    psFtl->u32RunStart = psFtl->u32Page;
+    if (psFtl->u32Page >= psFtl->u32Ppb - 1U)
+        return FTL_Close(psFtl);
+    return FTL_OK;
+}
+
+/* Programs the page buffer, padding it if it is not full */
+static int32_t FTL_ProgramBuf(FTL_T *psFtl)
+{
+    uint32_t *pu32List = FTL_RunList(psFtl) + (psFtl->u32Page - psFtl->u32RunStart) * psFtl->u32Spp;
+    int32_t i32Ret;
+
+    if (psFtl->u32Fill < psFtl->u32Spp)
+    {
+        memset(psFtl->pu8Wbuf + psFtl->u32Fill * FTL_SECTOR_SIZE, 0xFF, (psFtl->u32Spp - psFtl->u32Fill) * FTL_SECTOR_SIZE);
+        memset(pu32List + psFtl->u32Fill, 0xFF, 4U * (psFtl->u32Spp - psFtl->u32Fill));
+        psFtl->sStat.u32PadSectors += psFtl->u32Spp - psFtl->u32Fill;
+    }
+
+    psFtl->sStat.u32DataPages++;
+    while (FTL_PortProgram(psFtl, psFtl->u32Open, psFtl->u32Page, psFtl->pu8Wbuf) != FTL_OK)
+    {
+        i32Ret = FTL_MoveRun(psFtl, 1U);
+        if (i32Ret != FTL_OK)
+            return i32Ret;
+    }
+
+    psFtl->u32Page++;
+    psFtl->u32Fill = 0U;
+    if ((psFtl->u32Page - psFtl->u32RunStart >= psFtl->u32RunMax) || (psFtl->u32Page >= psFtl->u32Ppb - 1U))
+        return FTL_Commit(psFtl);
+    return FTL_OK;
+}
+
+static int32_t FTL_Flush(FTL_T *psFtl)
+{
+    int32_t i32Ret;
+
+    if (psFtl->u32Open == FTL_NONE)
+        return FTL_OK;
+    if (psFtl->u32Fill != 0U)
+    {
+        i32Ret = FTL_ProgramBuf(psFtl);
+        if (i32Ret != FTL_OK)
+            return i32Ret;
+    }
+    return FTL_Commit(psFtl);
+}
+
+static int32_t FTL_Put(FTL_T *psFtl, uint32_t u32Sector, const uint8_t *pu8Src);
+
+/* Block to collect: a retired or scrubbed one, a cold one when wear is
+   uneven, otherwise the one with the fewest valid sectors */
+static uint32_t FTL_PickVictim(FTL_T *psFtl, uint32_t *pu32Wear)
+{
+    FTL_BLK_T *psBlk = psFtl->psBlk;
+    uint32_t i, u32Best = FTL_NONE, u32Cold = FTL_NONE, u32Max = 0U;
+
+    *pu32Wear = 0U;
+    for (i = 0; i < psFtl->u32Blocks; i++)
+    {
+        if (psBlk[i].u8State == FTL_BLK_BAD)
+            continue;
+        if (psBlk[i].u32Erase > u32Max)
+            u32Max = psBlk[i].u32Erase;
+        if (psBlk[i].u8State != FTL_BLK_DATA)
+            continue;
+        if (psBlk[i].u8Flags & (FTL_BF_RETIRE | FTL_BF_SCRUB))
+            return i;
+        if ((u32Best == FTL_NONE) || (psBlk[i].u16Valid < psBlk[u32Best].u16Valid))
+            u32Best = i;
+        if ((u32Cold == FTL_NONE) || (psBlk[i].u32Erase < psBlk[u32Cold].u32Erase))
+            u32Cold = i;
+    }
+
+    if ((u32Cold != FTL_NONE) && ((psFtl->u32GcCount % FTL_WEAR_PERIOD) == 0U) &&
+            (u32Max - psBlk[u32Cold].u32Erase > FTL_WEAR_GAP))
+    {
+        *pu32Wear = 1U;
+        return u32Cold;
+    }
+    return u32Best;
+}
+
+/*
+ * Moves the valid sectors of a block away, commits them and erases the
+ * block. A cold block for wear leveling is copied into a block of its own,
+ * taken from the most worn free ones, so its data does not mix with data
+ * written by the host and get copied again by every later collection.
+ */
+static int32_t FTL_Collect(FTL_T *psFtl, uint32_t u32Blk, uint32_t u32Wear)
+{
+    uint32_t u32Page, u32Sec, u32Slot, u32Sector;
+    int32_t i32Ret = FTL_OK;
+
+    psFtl->u32Busy++;
+    psFtl->u32GcCount++;
+
+    if (u32Wear)
+    {
+        psFtl->sStat.u32WearMoves++;
+        i32Ret = FTL_Flush(psFtl);
+        if (i32Ret != FTL_OK)
+            goto out;
+        if (psFtl->u32Open != FTL_NONE)
+            FTL_Close(psFtl);
+        i32Ret = FTL_OpenRaw(psFtl, 1U);
+        if (i32Ret != FTL_OK)
+            goto out;
+    }
+
+    for (u32Page = 1U; (u32Page < psFtl->u32Ppb) && (psFtl->psBlk[u32Blk].u16Valid != 0U); u32Page++)
+    {
+        for (u32Sec = 0; u32Sec < psFtl->u32Spp; u32Sec++)
+        {
+            u32Slot = FTL_Slot(psFtl, u32Blk, u32Page, u32Sec);
+            u32Sector = psFtl->pu32Rmap[u32Slot];
+            if (u32Sector == FTL_NONE)
+                continue;
+
+            if (FTL_LoadPage(psFtl, u32Blk, u32Page) != FTL_OK)
+            {
+                /* Lost to an uncorrectable error; reads return erased data */
+                FTL_Unmap(psFtl, u32Sector);
+                continue;
+            }
+            i32Ret = FTL_Put(psFtl, u32Sector, psFtl->pu8Cache + u32Sec * FTL_SECTOR_SIZE);
+            if (i32Ret != FTL_OK)
+                goto out;
+            psFtl->sStat.u32GcSectors++;
+        }
+    }
+
+    /* The copies must be on flash before the originals go */
+    i32Ret = FTL_Flush(psFtl);
+    if (i32Ret != FTL_OK)
+        goto out;
+    if (u32Wear && (psFtl->u32Open != FTL_NONE))
+        FTL_Close(psFtl);
+
+    psFtl->psBlk[u32Blk].u16Valid = 0U;
+    FTL_Release(psFtl, u32Blk);
+    psFtl->sStat.u32GcBlocks++;
+
+out:
+    psFtl->u32Busy--;
+    return i32Ret;
+}
+
+static int32_t FTL_EnsureFree(FTL_T *psFtl, uint32_t u32Need)
+{
+    uint32_t u32Blk, u32Wear, u32Tries = 0U;
+    int32_t i32Ret;
+
+    while ((psFtl->sStat.u32FreeBlocks < u32Need) && (u32Tries++ < 2U * psFtl->u32Blocks))
+    {
+        u32Blk = FTL_PickVictim(psFtl, &u32Wear);
+        if (u32Blk == FTL_NONE)
+            break;
+        i32Ret = FTL_Collect(psFtl, u32Blk, u32Wear);
+        if (i32Ret != FTL_OK)
+            return i32Ret;
+    }
+    return FTL_OK;
+}
+
+static int32_t FTL_WriteCheckpoint(FTL_T *psFtl);
+
+static int32_t FTL_Open(FTL_T *psFtl)
+{
+    int32_t i32Ret;
+
+    if (psFtl->u32Busy == 0U)
+    {
+        i32Ret = FTL_EnsureFree(psFtl, psFtl->u32GcLow);
+        if (i32Ret != FTL_OK)
+            return i32Ret;
+        if (psFtl->u32Open != FTL_NONE)
+            return FTL_OK;
+
+        if (psFtl->u32SinceCkpt >= FTL_CKPT_RATIO * psFtl->u32CkptPages)
+        {
+            i32Ret = FTL_WriteCheckpoint(psFtl);
+            if (i32Ret != FTL_OK)
+                return i32Ret;
+        }
+    }
+    return FTL_OpenRaw(psFtl, 0U);
+}
+
+static int32_t FTL_Put(FTL_T *psFtl, uint32_t u32Sector, const uint8_t *pu8Src)
+{
+    uint32_t u32Index;
+    int32_t i32Ret;
+
+    if (psFtl->u32Open == FTL_NONE)
+    {
+        i32Ret = FTL_Open(psFtl);
+        if (i32Ret != FTL_OK)
+            return i32Ret;
+    }
+
+    memcpy(psFtl->pu8Wbuf + psFtl->u32Fill * FTL_SECTOR_SIZE, pu8Src, FTL_SECTOR_SIZE);
+    u32Index = (psFtl->u32Page - psFtl->u32RunStart) * psFtl->u32Spp + psFtl->u32Fill;
+    FTL_RunList(psFtl)[u32Index] = u32Sector;
+    FTL_Map(psFtl, u32Sector, FTL_Slot(psFtl, psFtl->u32Open, psFtl->u32Page, psFtl->u32Fill));
+    psFtl->u32Dirty = 1U;
+
+    if (++psFtl->u32Fill == psFtl->u32Spp)
+        return FTL_ProgramBuf(psFtl);
+    return FTL_OK;
+}
+
+/* Copies [u32Off, u32Off + u32Len) of the checkpoint stream, without the
+   CRC, to pu8Buf, or from pu8Buf when pu32Erase is given. Loaded erase
+   counts go to pu32Erase rather than to the block table. */
+static void FTL_CkptCopy(FTL_T *psFtl, FTL_CKPT_T *psHdr, uint32_t *pu32Erase,
+                         uint32_t u32Off, uint8_t *pu8Buf, uint32_t u32Len)
+{
+    uint32_t u32Part, u32Base = 0U, u32Size, u32N, i;
+    uint8_t *pu8Area;
+
+    for (u32Part = 0; (u32Part < 3U) && (u32Len != 0U); u32Part++, u32Base += u32Size)
+    {
+        if (u32Part == 0U)
+        {
+            u32Size = sizeof(FTL_CKPT_T);
+            pu8Area = (uint8_t *)psHdr;
+        }
+        else if (u32Part == 1U)
+        {
+            u32Size = 4U * psFtl->u32Blocks;
+            pu8Area = (uint8_t *)pu32Erase;
+        }
+        else
+        {
+            u32Size = 4U * psFtl->u32Sectors;
+            pu8Area = (uint8_t *)psFtl->pu32Map;
+        }
+
+        if (u32Off >= u32Base + u32Size)
+            continue;
+        u32N = u32Base + u32Size - u32Off;
+        if (u32N > u32Len)
+            u32N = u32Len;
+
+        if (pu32Erase != NULL)
+        {
+            memcpy(pu8Area + (u32Off - u32Base), pu8Buf, u32N);
+        }
+        else if (u32Part == 1U)
+        {
+            for (i = u32Off - u32Base; i < u32Off - u32Base + u32N; i++)
+                *pu8Buf++ = (uint8_t)(psFtl->psBlk[i / 4U].u32Erase >> (8U * (i & 3U)));
+            pu8Buf -= u32N;
+        }
+        else
+        {
+            memcpy(pu8Buf, pu8Area + (u32Off - u32Base), u32N);
+        }
+        u32Off += u32N;
+        pu8Buf += u32N;
+        u32Len -= u32N;
+    }
+}
+
+/* Length of the checkpoint page at u32Off and how much of it precedes the CRC */
+static uint32_t FTL_CkptPage(FTL_T *psFtl, uint32_t u32Off, uint32_t *pu32Data)
+{
+    uint32_t u32Len = psFtl->u32CkptBytes - u32Off, u32End = psFtl->u32CkptBytes - 4U;
+
+    if (u32Len > psFtl->u32PageSize)
+        u32Len = psFtl->u32PageSize;
+    *pu32Data = (u32Off >= u32End) ? 0U : ((u32End - u32Off < u32Len) ? (u32End - u32Off) : u32Len);
+    return u32Len;
+}
+
+static void FTL_DropCheckpoint(FTL_T *psFtl, uint32_t u32Number)
+{
+    uint32_t i;
+
+    for (i = 0; i < psFtl->u32Blocks; i++)
+    {
+        if ((psFtl->psBlk[i].u8State == FTL_BLK_CKPT) && (psFtl->psBlk[i].u32Ckpt == u32Number))
+            FTL_Release(psFtl, i);
+    }
+}
+
+static int32_t FTL_WriteCheckpoint(FTL_T *psFtl)
+{
+    FTL_CKPT_T sHdr;
+    uint32_t u32Off, u32Len, u32Data, u32Index, u32Blk, u32Page, u32Crc, u32Tries, i;
+    int32_t i32Ret;
+
+    i32Ret = FTL_Flush(psFtl);
+    if (i32Ret != FTL_OK)
+        return i32Ret;
+
+    for (u32Tries = 0; u32Tries < 4U; u32Tries++)
+    {
+        /* The old checkpoint is kept until the new one is complete */
+        psFtl->u32Busy++;
+        i32Ret = FTL_EnsureFree(psFtl, psFtl->u32CkptBlocks + 1U);
+        psFtl->u32Busy--;
+        if (i32Ret != FTL_OK)
+            return i32Ret;
+        if (psFtl->sStat.u32FreeBlocks < psFtl->u32CkptBlocks)
+            return FTL_ERR_NOSPC;
+
+        /* Collection may have committed more runs */
+        i32Ret = FTL_Flush(psFtl);
+        if (i32Ret != FTL_OK)
+            return i32Ret;
+
+        memset(&sHdr, 0, sizeof(sHdr));
+        sHdr.u32Magic = FTL_MAGIC_CKPT;
+        sHdr.u32Number = ++psFtl->u32CkptSeq;
+        sHdr.u32Seq = psFtl->u32Seq;
+        sHdr.u32Open = psFtl->u32Open;
+        sHdr.u32Page = psFtl->u32Page;
+        sHdr.u32Blocks = psFtl->u32Blocks;
+        sHdr.u32Sectors = psFtl->u32Sectors;
+
+        u32Off = 0U;
+        u32Crc = FTL_NONE;
+        u32Blk = FTL_NONE;
+        u32Page = psFtl->u32Ppb;
+        u32Index = 0U;
+        while (u32Off < psFtl->u32CkptBytes)
+        {
+            if (u32Page == psFtl->u32Ppb)
+            {
+                u32Blk = FTL_Alloc(psFtl, 0U);
+                if (u32Blk == FTL_NONE)
+                {
+                    i32Ret = FTL_ERR_NOSPC;
+                    break;
+                }
+                psFtl->psBlk[u32Blk].u8State = FTL_BLK_CKPT;
+                psFtl->psBlk[u32Blk].u32Ckpt = sHdr.u32Number;
+                psFtl->psBlk[u32Blk].u16Valid = (uint16_t)u32Index;
+                i32Ret = FTL_WriteHeader(psFtl, u32Blk, FTL_TYPE_CKPT, sHdr.u32Number, u32Index++);
+                if (i32Ret != FTL_OK)
+                {
+                    psFtl->psBlk[u32Blk].u8Flags |= FTL_BF_RETIRE;
+                    break;
+                }
+                u32Page = 1U;
+            }
+
+            memset(psFtl->pu8Tmp, 0xFF, psFtl->u32PageSize);
+            u32Len = FTL_CkptPage(psFtl, u32Off, &u32Data);
+            FTL_CkptCopy(psFtl, &sHdr, NULL, u32Off, psFtl->pu8Tmp, u32Data);
+            u32Crc = FTL_Crc(u32Crc, psFtl->pu8Tmp, u32Data);
+            for (i = u32Data; i < u32Len; i++)
+                psFtl->pu8Tmp[i] = (uint8_t)(u32Crc >> (8U * (u32Off + i - (psFtl->u32CkptBytes - 4U))));
+
+            psFtl->sStat.u32CkptPages++;
+            i32Ret = FTL_PortProgram(psFtl, u32Blk, u32Page, psFtl->pu8Tmp);
+            if (i32Ret != FTL_OK)
+            {
+                psFtl->psBlk[u32Blk].u8Flags |= FTL_BF_RETIRE;
+                break;
+            }
+            u32Off += u32Len;
+            u32Page++;
+        }
+
+        if (i32Ret == FTL_OK)
+        {
+            if (psFtl->u32CkptPrev != 0U)
+                FTL_DropCheckpoint(psFtl, psFtl->u32CkptPrev);
+            psFtl->u32CkptPrev = sHdr.u32Number;
+            psFtl->u32SinceCkpt = 0U;
+            psFtl->u32Dirty = 0U;
+            psFtl->sStat.u32Checkpoints++;
+            return FTL_OK;
+        }
+
+        FTL_DropCheckpoint(psFtl, sHdr.u32Number);
+        if (i32Ret == FTL_ERR_NOSPC)
+            return i32Ret;
+    }
+    return FTL_ERR_IO;
+}
+
+/* Loads checkpoint u32Number into the map; erase counts go to pu32Erase */
+static int32_t FTL_LoadCheckpoint(FTL_T *psFtl, uint32_t u32Number, FTL_CKPT_T *psHdr, uint32_t *pu32Erase)
+{
+    uint32_t u32Off, u32Len, u32Data, u32Index, u32Blk, u32Page, u32Crc, u32Stored, i;
+
+    u32Off = 0U;
+    u32Crc = FTL_NONE;
+    u32Blk = FTL_NONE;
+    u32Page = psFtl->u32Ppb;
+    u32Index = 0U;
+    u32Stored = 0U;
+    while (u32Off < psFtl->u32CkptBytes)
+    {
+        if (u32Page == psFtl->u32Ppb)
+        {
+            for (i = 0; i < psFtl->u32Blocks; i++)
+            {
+                if ((psFtl->psBlk[i].u8State == FTL_BLK_CKPT) && (psFtl->psBlk[i].u32Ckpt == u32Number) &&
+                        (psFtl->psBlk[i].u16Valid == u32Index))
+                    break;
+            }
+            if (i == psFtl->u32Blocks)
+                return FTL_ERR_FORMAT;
+            u32Blk = i;
+            u32Index++;
+            u32Page = 1U;
+        }
+
+        if (FTL_PortRead(psFtl, u32Blk, u32Page, 1U, psFtl->pu8Tmp) != FTL_OK)
+            return FTL_ERR_IO;
+
+        if (u32Off == 0U)
+        {
+            memcpy(psHdr, psFtl->pu8Tmp, sizeof(FTL_CKPT_T));
+            if ((psHdr->u32Magic != FTL_MAGIC_CKPT) || (psHdr->u32Number != u32Number) ||
+                    (psHdr->u32Blocks != psFtl->u32Blocks) || (psHdr->u32Sectors != psFtl->u32Sectors) ||
+                    ((psHdr->u32Open != FTL_NONE) && (psHdr->u32Open >= psFtl->u32Blocks)))
+                return FTL_ERR_FORMAT;
+        }
+
+        u32Len = FTL_CkptPage(psFtl, u32Off, &u32Data);
+        FTL_CkptCopy(psFtl, psHdr, pu32Erase, u32Off, psFtl->pu8Tmp, u32Data);
+        u32Crc = FTL_Crc(u32Crc, psFtl->pu8Tmp, u32Data);
+        for (i = u32Data; i < u32Len; i++)
+            u32Stored |= (uint32_t)psFtl->pu8Tmp[i] << (8U * (u32Off + i - (psFtl->u32CkptBytes - 4U)));
+        u32Off += u32Len;
+        u32Page++;
+    }
+
+    return (u32Stored == u32Crc) ? FTL_OK : FTL_ERR_FORMAT;
+}
+
+/* Applies the committed runs of a block from u32Page on */
+static void FTL_Replay(FTL_T *psFtl, uint32_t u32Blk, uint32_t u32Page)
+{
+    const FTL_META_T *psMeta = (const FTL_META_T *)psFtl->pu8Tmp;
+    const uint32_t *pu32List = (const uint32_t *)(psFtl->pu8Tmp + FTL_META_HDR);
+    uint32_t u32Start = u32Page, u32Count, u32Sector, i;
+
+    for (; u32Page < psFtl->u32Ppb; u32Page++)
+    {
+        psFtl->sStat.u32ReplayedPages++;
+        if (FTL_PortRead(psFtl, u32Blk, u32Page, 1U, psFtl->pu8Tmp) != FTL_OK)
+            continue;
+
+        u32Count = u32Page - u32Start;
+        if ((psMeta->u32Magic != FTL_MAGIC_META) || (psMeta->u32Seq != psFtl->psBlk[u32Blk].u32Seq) ||
+                (psMeta->u32First != u32Start) || (psMeta->u32Count != u32Count) ||
+                (u32Count == 0U) || (u32Count > psFtl->u32RunMax) ||
+                (psMeta->u32Crc != FTL_Crc(FTL_Crc(FTL_NONE, psMeta, 16U), pu32List, 4U * u32Count * psFtl->u32Spp)))
+            continue;
+
+        for (i = 0; i < u32Count * psFtl->u32Spp; i++)
+        {
+            u32Sector = pu32List[i];
+            if (u32Sector < psFtl->u32Sectors)
+                psFtl->pu32Map[u32Sector] = FTL_Slot(psFtl, u32Blk, u32Start + i / psFtl->u32Spp, i % psFtl->u32Spp);
+        }
+        u32Start = u32Page + 1U;
+    }
+}
+
+/* Reads the header page of a block into its table entry */
+static int32_t FTL_ScanBlock(FTL_T *psFtl, uint32_t u32Blk)
+{
+    const FTL_PORT_T *psPort = psFtl->psPort;
+    const FTL_HDR_T *psHdr = (const FTL_HDR_T *)psFtl->pu8Tmp;
+    FTL_BLK_T *psBlk = &psFtl->psBlk[u32Blk];
+
+    psBlk->u8State = FTL_BLK_DIRTY;
+    if (psPort->pfnIsBad(psPort->pvCtx, psFtl->u32FirstBlock + u32Blk) != 0)
+    {
+        psBlk->u8State = FTL_BLK_BAD;
+        return FTL_OK;
+    }
+    if (FTL_PortRead(psFtl, u32Blk, 0U, 1U, psFtl->pu8Tmp) != FTL_OK)
+        return FTL_OK;
+
+    if (FTL_IsErased(psFtl->pu8Tmp, psFtl->u32PageSize))
+    {
+        psBlk->u8State = FTL_BLK_FREE;
+        psBlk->u8Flags = FTL_BF_ERASE;
+        return FTL_OK;
+    }
+    if ((psHdr->u32Magic != FTL_MAGIC_BLOCK) || (psHdr->u32Crc != FTL_Crc(FTL_NONE, psHdr, sizeof(FTL_HDR_T) - 4U)))
+        return FTL_OK;
+    if ((psHdr->u32Version != FTL_VERSION) || (psHdr->u32Geometry != ((psFtl->u32PageSize << 16) | psFtl->u32Ppb)) ||
+            (psHdr->u32Sectors != psFtl->u32Sectors))
+        return FTL_ERR_FORMAT;
+
+    psBlk->u32Seq = psHdr->u32Seq;
+    psBlk->u32Erase = psHdr->u32Erase;
+    if (psHdr->u32Type == FTL_TYPE_CKPT)
+    {
+        psBlk->u8State = FTL_BLK_CKPT;
+        psBlk->u32Ckpt = psHdr->u32Ckpt;
+        psBlk->u16Valid = (uint16_t)psHdr->u32Index;
+    }
+    else if (psHdr->u32Type == FTL_TYPE_DATA)
+    {
+        psBlk->u8State = FTL_BLK_DATA;
+    }
+    return FTL_OK;
+}
+
+/** @endcond HIDDEN_SYMBOLS */
+
+/**
+ *  @brief      Bytes of work area needed for a partition
+ *  @param[in]  psPort      Flash access
+ *  @param[in]  u32Blocks   Blocks in the partition
+ *  @return     Work area size, 0 if the geometry is not supported
+ *  @details    The sector map and the slot map take 4 bytes per sector
+ *              each, about 0.4 % of the partition, plus four page buffers.
+ */
+uint32_t FTL_GetWorkSize(const FTL_PORT_T *psPort, uint32_t u32Blocks)
+{
+    FTL_T sFtl;
+
+    memset(&sFtl, 0, sizeof(sFtl));
+    if (FTL_Layout(&sFtl, psPort, 0U, u32Blocks) != FTL_OK)
+        return 0U;
+    return FTL_WorkSize(&sFtl);
+}
+
+/**
+ *  @brief      Erases a partition for an empty FTL
+ *  @param[out] psFtl   FTL instance, used as scratch
+ *  @param[in]  psCfg   Configuration
+ *  @return     FTL_OK or FTL_ERR_xxx
+ *  @details    Erase counts found in block headers are carried over.
+ *              Mount the partition afterwards with FTL_Mount().
+ */
+int32_t FTL_Format(FTL_T *psFtl, const FTL_CFG_T *psCfg)
+{
+    const FTL_HDR_T *psHdr;
+    uint32_t i;
+    int32_t i32Ret;
+
+    i32Ret = FTL_Init(psFtl, psCfg);
+    if (i32Ret != FTL_OK)
+        return i32Ret;
+
+    psHdr = (const FTL_HDR_T *)psFtl->pu8Tmp;
+    for (i = 0; i < psFtl->u32Blocks; i++)
+    {
+        if (psFtl->psPort->pfnIsBad(psFtl->psPort->pvCtx, psFtl->u32FirstBlock + i) != 0)
+        {
+            psFtl->psBlk[i].u8State = FTL_BLK_BAD;
+            continue;
+        }
+        if ((FTL_PortRead(psFtl, i, 0U, 1U, psFtl->pu8Tmp) == FTL_OK) && (psHdr->u32Magic == FTL_MAGIC_BLOCK) &&
+                (psHdr->u32Crc == FTL_Crc(FTL_NONE, psHdr, sizeof(FTL_HDR_T) - 4U)))
+            psFtl->psBlk[i].u32Erase = psHdr->u32Erase;
+        FTL_Release(psFtl, i);
+    }
+    return FTL_OK;
+}
+
+/**
+ *  @brief      Mounts the FTL on a partition
+ *  @param[out] psFtl   FTL instance
+ *  @param[in]  psCfg   Configuration. The work area is used until FTL_Unmount().
+ *  @return     FTL_OK, FTL_ERR_FORMAT if the partition holds something else
+ *              or was formatted with another geometry, or FTL_ERR_xxx
+ *  @details    An erased partition mounts as an empty FTL. Runs that were
+ *              not committed when the power was lost are dropped.
+ */
+int32_t FTL_Mount(FTL_T *psFtl, const FTL_CFG_T *psCfg)
+{
+    FTL_BLK_T *psBlk;
+    FTL_CKPT_T sHdr;
+    uint32_t *pu32Erase;
+    uint32_t i, u32Number, u32Found = 0U, u32Dirty = 0U, u32Last, u32Next, u32Slot;
+    int32_t i32Ret;
+
+    i32Ret = FTL_Init(psFtl, psCfg);
+    if (i32Ret != FTL_OK)
+        return i32Ret;
+    psBlk = psFtl->psBlk;
+
+    for (i = 0; i < psFtl->u32Blocks; i++)
+    {
+        i32Ret = FTL_ScanBlock(psFtl, i);
+        if (i32Ret != FTL_OK)
+            return i32Ret;
+
+        if ((psBlk[i].u8State == FTL_BLK_DATA) || (psBlk[i].u8State == FTL_BLK_CKPT))
+        {
+            u32Found = 1U;
+            if (psBlk[i].u32Seq > psFtl->u32Seq)
+                psFtl->u32Seq = psBlk[i].u32Seq;
+            if ((psBlk[i].u8State == FTL_BLK_CKPT) && (psBlk[i].u32Ckpt > psFtl->u32CkptSeq))
+                psFtl->u32CkptSeq = psBlk[i].u32Ckpt;
+        }
+        else if (psBlk[i].u8State == FTL_BLK_DIRTY)
+            u32Dirty = 1U;
+        else if (psBlk[i].u8State == FTL_BLK_BAD)
+            psFtl->sStat.u32BadBlocks++;
+    }
+    if (!u32Found && u32Dirty)
+        return FTL_ERR_FORMAT;
+
+    /* Newest complete checkpoint. The slot map is not built yet, so it
+       holds the erase counts meanwhile. */
+    pu32Erase = psFtl->pu32Rmap;
+    memset(&sHdr, 0, sizeof(sHdr));
+    for (u32Number = psFtl->u32CkptSeq; u32Number != 0U; u32Number--)
+    {
+        for (i = 0; i < psFtl->u32Blocks; i++)
+        {
+            if ((psBlk[i].u8State == FTL_BLK_CKPT) && (psBlk[i].u32Ckpt == u32Number) && (psBlk[i].u16Valid == 0U))
+                break;
+        }
+        if (i == psFtl->u32Blocks)
+            continue;
+        if (FTL_LoadCheckpoint(psFtl, u32Number, &sHdr, pu32Erase) == FTL_OK)
+            break;
+        memset(psFtl->pu32Map, 0xFF, 4U * psFtl->u32Sectors);
+        memset(&sHdr, 0, sizeof(sHdr));
+    }
+    psFtl->u32CkptPrev = u32Number;
+    if (u32Number == 0U)
+    {
+        sHdr.u32Open = FTL_NONE;
+        memset(pu32Erase, 0, 4U * psFtl->u32Blocks);
+    }
+
+    /* Blocks without a header get their erase count from the checkpoint */
+    for (i = 0; i < psFtl->u32Blocks; i++)
+    {
+        if ((psBlk[i].u8State == FTL_BLK_FREE) || (psBlk[i].u8State == FTL_BLK_DIRTY))
+            psBlk[i].u32Erase = pu32Erase[i];
+    }
+    memset(pu32Erase, 0xFF, 4U * psFtl->u32Blocks);
+
+    /* Entries into blocks rewritten or erased since the checkpoint are stale */
+    for (i = 0; i < psFtl->u32Sectors; i++)
+    {
+        u32Slot = psFtl->pu32Map[i];
+        if (u32Slot == FTL_NONE)
+            continue;
+        u32Slot /= psFtl->u32Ppb * psFtl->u32Spp;
+        if ((u32Slot >= psFtl->u32Blocks) || (psBlk[u32Slot].u8State != FTL_BLK_DATA) || (psBlk[u32Slot].u32Seq > sHdr.u32Seq))
+            psFtl->pu32Map[i] = FTL_NONE;
+    }
+
+    /* Replay in sequence order */
+    if ((sHdr.u32Open != FTL_NONE) && (psBlk[sHdr.u32Open].u8State == FTL_BLK_DATA) &&
+            (psBlk[sHdr.u32Open].u32Seq <= sHdr.u32Seq) && (sHdr.u32Page < psFtl->u32Ppb))
+        FTL_Replay(psFtl, sHdr.u32Open, sHdr.u32Page);
+    for (u32Last = sHdr.u32Seq;;)
+    {
+        u32Next = FTL_NONE;
+        for (i = 0; i < psFtl->u32Blocks; i++)
+        {
+            if ((psBlk[i].u8State == FTL_BLK_DATA) && (psBlk[i].u32Seq > u32Last) &&
+                    ((u32Next == FTL_NONE) || (psBlk[i].u32Seq < psBlk[u32Next].u32Seq)))
+                u32Next = i;
+        }
+        if (u32Next == FTL_NONE)
+            break;
+        FTL_Replay(psFtl, u32Next, 1U);
+        u32Last = psBlk[u32Next].u32Seq;
+    }
+
+    for (i = 0; i < psFtl->u32Sectors; i++)
+    {
+        u32Slot = psFtl->pu32Map[i];
+        if (u32Slot != FTL_NONE)
+        {
+            psFtl->pu32Rmap[u32Slot] = i;
+            psBlk[u32Slot / (psFtl->u32Ppb * psFtl->u32Spp)].u16Valid++;
+        }
+    }
+
+    /* Erase what is neither data nor the checkpoint in use */
+    for (i = 0; i < psFtl->u32Blocks; i++)
+    {
+        if (psBlk[i].u8State == FTL_BLK_FREE)
+            psFtl->sStat.u32FreeBlocks++;
+        else if ((psBlk[i].u8State == FTL_BLK_DIRTY) ||
+                 ((psBlk[i].u8State == FTL_BLK_CKPT) && (psBlk[i].u32Ckpt != u32Number)))
+            FTL_Release(psFtl, i);
+    }
+
+    /* A long replay brings the next checkpoint forward */
+    psFtl->u32SinceCkpt = psFtl->sStat.u32ReplayedPages;
+    psFtl->u32Dirty = (psFtl->sStat.u32ReplayedPages != 0U);
+    psFtl->u32Mounted = 1U;
+    return FTL_OK;
+}
+
+/**
+ *  @brief      Commits buffered sectors and writes a checkpoint if needed
+ *  @param[in]  psFtl   FTL instance
+ *  @return     FTL_OK or FTL_ERR_xxx
+ *  @details    After unmount the next mount does not have to replay.
+ */
+int32_t FTL_Unmount(FTL_T *psFtl)
+{
+    int32_t i32Ret;
+
+    if ((psFtl == NULL) || !psFtl->u32Mounted)
+        return FTL_ERR_PARAM;
+
+    i32Ret = psFtl->u32Dirty ? FTL_WriteCheckpoint(psFtl) : FTL_Flush(psFtl);
+    psFtl->u32Mounted = 0U;
+    return i32Ret;
+}
+
+/**
+ *  @brief      Sectors exported to the host
+ *  @param[in]  psFtl   FTL instance
+ *  @return     Sector count
+ *  @details    The count only depends on the geometry and the partition size.
+ */
+uint32_t FTL_GetSectorCount(FTL_T *psFtl)
+{
+    return psFtl->u32Sectors;
+}
+
+/**
+ *  @brief      Sectors per erase block, a hint for file system alignment
+ *  @param[in]  psFtl   FTL instance
+ *  @return     Sector count
+ */
+uint32_t FTL_GetEraseSectors(FTL_T *psFtl)
+{
+    return psFtl->u32Ppb * psFtl->u32Spp;
+}
+
+/**
+ *  @brief      Reads sectors
+ *  @param[in]  psFtl       FTL instance
+ *  @param[in]  u32Sector   First sector
+ *  @param[in]  u32Count    Sectors
+ *  @param[out] pu8Buf      u32Count * FTL_SECTOR_SIZE bytes
+ *  @return     FTL_OK or FTL_ERR_xxx
+ *  @details    Sectors never written or trimmed read as 0xFF. Whole pages
+ *              that are laid out in order on flash are read straight into
+ *              pu8Buf, several pages per port call if pu8Buf is 4-byte
+ *              aligned.
+ */
+int32_t FTL_Read(FTL_T *psFtl, uint32_t u32Sector, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    uint32_t u32Slot, u32Blk, u32Page, u32Sec, u32Pages, u32Max, i, u32Slots;
+    int32_t i32Ret;
+
+    if ((psFtl == NULL) || !psFtl->u32Mounted || (pu8Buf == NULL) ||
+            (u32Sector >= psFtl->u32Sectors) || (u32Count > psFtl->u32Sectors - u32Sector))
+        return FTL_ERR_PARAM;
+
+    psFtl->sStat.u32HostReads += u32Count;
+    u32Slots = psFtl->u32Ppb * psFtl->u32Spp;
+    while (u32Count != 0U)
+    {
+        u32Slot = psFtl->pu32Map[u32Sector];
+        if (u32Slot == FTL_NONE)
+        {
+            memset(pu8Buf, 0xFF, FTL_SECTOR_SIZE);
+            u32Max = 1U;
+            goto next;
+        }
+
+        u32Blk = u32Slot / u32Slots;
+        u32Page = (u32Slot % u32Slots) / psFtl->u32Spp;
+        u32Sec = u32Slot % psFtl->u32Spp;
+        if ((u32Blk == psFtl->u32Open) && (u32Page == psFtl->u32Page))
+        {
+            memcpy(pu8Buf, psFtl->pu8Wbuf + u32Sec * FTL_SECTOR_SIZE, FTL_SECTOR_SIZE);
+            u32Max = 1U;
+            goto next;
+        }
+
+        /* Pages whose sectors are all in order go straight to pu8Buf */
+        u32Pages = 0U;
+        if ((u32Sec == 0U) && (((uintptr_t)pu8Buf & 3U) == 0U))
+        {
+            u32Max = u32Count / psFtl->u32Spp;
+            if (u32Max > psFtl->u32Ppb - u32Page)
+                u32Max = psFtl->u32Ppb - u32Page;
+            if ((u32Blk == psFtl->u32Open) && (u32Max > psFtl->u32Page - u32Page))
+                u32Max = psFtl->u32Page - u32Page;
+            for (i = 0; i < u32Max * psFtl->u32Spp; i++)
+            {
+                if (psFtl->pu32Map[u32Sector + i] != u32Slot + i)
+                    break;
+            }
+            u32Pages = i / psFtl->u32Spp;
+        }
+
+        if (u32Pages != 0U)
+        {
+            i32Ret = FTL_PortRead(psFtl, u32Blk, u32Page, u32Pages, pu8Buf);
+            if (i32Ret != FTL_OK)
+                return i32Ret;
+            u32Max = u32Pages * psFtl->u32Spp;
+        }
+        else
+        {
+            i32Ret = FTL_LoadPage(psFtl, u32Blk, u32Page);
+            if (i32Ret != FTL_OK)
+                return i32Ret;
+            memcpy(pu8Buf, psFtl->pu8Cache + u32Sec * FTL_SECTOR_SIZE, FTL_SECTOR_SIZE);
+            u32Max = 1U;
+        }
+
+next:
+        u32Sector += u32Max;
+        u32Count -= u32Max;
+        pu8Buf += u32Max * FTL_SECTOR_SIZE;
+    }
+    return FTL_OK;
+}
+
+/**
+ *  @brief      Writes sectors
+ *  @param[in]  psFtl       FTL instance
+ *  @param[in]  u32Sector   First sector
+ *  @param[in]  u32Count    Sectors
+ *  @param[in]  pu8Buf      u32Count * FTL_SECTOR_SIZE bytes
+ *  @return     FTL_OK or FTL_ERR_xxx
+ *  @details    The data is safe from power loss after FTL_Sync().
+ */
+int32_t FTL_Write(FTL_T *psFtl, uint32_t u32Sector, uint32_t u32Count, const uint8_t *pu8Buf)
+{
+    int32_t i32Ret;
+
+    if ((psFtl == NULL) || !psFtl->u32Mounted || (pu8Buf == NULL) ||
+            (u32Sector >= psFtl->u32Sectors) || (u32Count > psFtl->u32Sectors - u32Sector))
+        return FTL_ERR_PARAM;
+
+    for (; u32Count != 0U; u32Count--)
+    {
+        i32Ret = FTL_Put(psFtl, u32Sector++, pu8Buf);
+        if (i32Ret != FTL_OK)
+            return i32Ret;
+        psFtl->sStat.u32HostWrites++;
+        pu8Buf += FTL_SECTOR_SIZE;
+    }
+    return FTL_OK;
+}
+
+/**
+ *  @brief      Discards sectors
+ *  @param[in]  psFtl       FTL instance
+ *  @param[in]  u32Sector   First sector
+ *  @param[in]  u32Count    Sectors
+ *  @return     FTL_OK or FTL_ERR_PARAM
+ *  @details    Trimmed sectors are not copied by garbage collection. A trim
+ *              is made durable by the next checkpoint; before that, a power
+ *              cut may bring the old data back.
+ */
+int32_t FTL_Trim(FTL_T *psFtl, uint32_t u32Sector, uint32_t u32Count)
+{
+    if ((psFtl == NULL) || !psFtl->u32Mounted ||
+            (u32Sector >= psFtl->u32Sectors) || (u32Count > psFtl->u32Sectors - u32Sector))
+        return FTL_ERR_PARAM;
+
+    psFtl->sStat.u32Trimmed += u32Count;
+    for (; u32Count != 0U; u32Count--)
+        FTL_Unmap(psFtl, u32Sector++);
+    psFtl->u32Dirty = 1U;
+    return FTL_OK;
+}
+
+/**
+ *  @brief      Commits buffered sectors to flash
+ *  @param[in]  psFtl   FTL instance
+ *  @return     FTL_OK or FTL_ERR_xxx
+ *  @details    Costs a padded data page and a meta page when a run is open,
+ *              nothing otherwise.
+ */
+int32_t FTL_Sync(FTL_T *psFtl)
+{
+    if ((psFtl == NULL) || !psFtl->u32Mounted)
+        return FTL_ERR_PARAM;
+    return FTL_Flush(psFtl);
+}
+
+/**
+ *  @brief      Commits buffered sectors and writes a checkpoint now
+ *  @param[in]  psFtl   FTL instance
+ *  @return     FTL_OK or FTL_ERR_xxx
+ *  @details    Checkpoints are also written on their own as data is
+ *              written. Call before a planned power-off to keep the next
+ *              mount short.
+ */
+int32_t FTL_Checkpoint(FTL_T *psFtl)
+{
+    if ((psFtl == NULL) || !psFtl->u32Mounted)
+        return FTL_ERR_PARAM;
+    return FTL_WriteCheckpoint(psFtl);
+}
+
+/**
+ *  @brief      Gets the counters
+ *  @param[in]  psFtl   FTL instance
+ *  @param[out] psStat  Counters since mount, with the current erase count range
+ */
+void FTL_GetStat(FTL_T *psFtl, FTL_STAT_T *psStat)
+{
+    uint32_t i;
+
+    psFtl->sStat.u32MinErase = FTL_NONE;
+    psFtl->sStat.u32MaxErase = 0U;
+    for (i = 0; i < psFtl->u32Blocks; i++)
+    {
+        if (psFtl->psBlk[i].u8State == FTL_BLK_BAD)
+            continue;
+        if (psFtl->psBlk[i].u32Erase < psFtl->sStat.u32MinErase)
+            psFtl->sStat.u32MinErase = psFtl->psBlk[i].u32Erase;
+        if (psFtl->psBlk[i].u32Erase > psFtl->sStat.u32MaxErase)
+            psFtl->sStat.u32MaxErase = psFtl->psBlk[i].u32Erase;
+    }
+    *psStat = psFtl->sStat;
+}
@@ -0,0 +1,91 @@
+/**************************************************************************//**
+ * @file     nand_ftl_mtd.c
+ * @brief    FTL port for raw NAND through the U-Boot MTD layer of yaffs2
+ *
+ *           Sits on the NFI driver of ThirdParty/yaffs2/platform/nfi_nand.c,
+ *           which does the BCH ECC and keeps the bad block markers in the
+ *           spare area. Build with the include paths and __UBOOT__ defines
+ *           of the NAND_Yaffs2 sample and call nand_init() first.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stddef.h>
+#include "nand_ftl.h"
+#include <common.h>
+#include <linux/mtd/mtd.h>
+
+/** @cond HIDDEN_SYMBOLS */
+
+static int32_t FTL_MtdRead(void *pvCtx, uint32_t u32Page, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    struct mtd_info *mtd = (struct mtd_info *)pvCtx;
+    size_t retlen;
+    int ret;
+
+    /* One MTD read lets the NFI driver run its page DMA back to back */
+    ret = mtd_read(mtd, (loff_t)u32Page * mtd->writesize, (size_t)u32Count * mtd->writesize, &retlen, pu8Buf);
+    if (mtd_is_bitflip(ret))
+        return FTL_PORT_SCRUB;
+    return (ret < 0) ? FTL_ERR_IO : FTL_OK;
+}
+
+static int32_t FTL_MtdProgram(void *pvCtx, uint32_t u32Page, const uint8_t *pu8Buf)
+{
+    struct mtd_info *mtd = (struct mtd_info *)pvCtx;
+    size_t retlen;
+
+    return (mtd_write(mtd, (loff_t)u32Page * mtd->writesize, mtd->writesize, &retlen, pu8Buf) < 0) ? FTL_ERR_IO : FTL_OK;
+}
+
+static int32_t FTL_MtdErase(void *pvCtx, uint32_t u32Block)
+{
+    struct mtd_info *mtd = (struct mtd_info *)pvCtx;
+    struct erase_info instr;
+
+    memset(&instr, 0, sizeof(instr));
+    instr.mtd = mtd;
+    instr.addr = (uint64_t)u32Block * mtd->erasesize;
+    instr.len = mtd->erasesize;
+    return (mtd_erase(mtd, &instr) < 0) ? FTL_ERR_IO : FTL_OK;
+}
+
+static int32_t FTL_MtdIsBad(void *pvCtx, uint32_t u32Block)
+{
+    struct mtd_info *mtd = (struct mtd_info *)pvCtx;
+
+    return (mtd_block_isbad(mtd, (loff_t)u32Block * mtd->erasesize) != 0) ? 1 : 0;
+}
+
+static int32_t FTL_MtdMarkBad(void *pvCtx, uint32_t u32Block)
+{
+    struct mtd_info *mtd = (struct mtd_info *)pvCtx;
+
+    return (mtd_block_markbad(mtd, (loff_t)u32Block * mtd->erasesize) < 0) ? FTL_ERR_IO : FTL_OK;
+}
+
+/** @endcond HIDDEN_SYMBOLS */
+
+/**
+ *  @brief      Sets up an FTL port on an MTD device
+ *  @param[out] psPort  Port to fill in
+ *  @param[in]  psMtd   MTD device, e.g. &nand_info[0] after nand_init()
+ *  @return     FTL_OK, or FTL_ERR_PARAM if the device is not NAND
+ */
+int32_t FTL_MtdPort(FTL_PORT_T *psPort, struct mtd_info *psMtd)
+{
+    if ((psMtd == NULL) || !mtd_type_is_nand(psMtd) ||
+            (psMtd->writesize == 0U) || (psMtd->erasesize == 0U))
+        return FTL_ERR_PARAM;
+
+    psPort->u32PageSize = psMtd->writesize;
+    psPort->u32PagesPerBlock = psMtd->erasesize / psMtd->writesize;
+    psPort->u32Blocks = (uint32_t)(psMtd->size / psMtd->erasesize);
+    psPort->pvCtx = psMtd;
+    psPort->pfnRead = FTL_MtdRead;
+    psPort->pfnProgram = FTL_MtdProgram;
+    psPort->pfnErase = FTL_MtdErase;
+    psPort->pfnIsBad = FTL_MtdIsBad;
+    psPort->pfnMarkBad = FTL_MtdMarkBad;
+    return FTL_OK;
+}
@@ -0,0 +1,72 @@
+/**************************************************************************//**
+ * @file     nand_ftl_sflash.c
+ * @brief    FTL port for SPI-NAND on the QSPI serial flash service
+ *
+ *           The device's on-die ECC corrects the pages; the spare area is left
+ *           to it and to the bad block markers of sflash_svc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include "NuMicro.h"
+#include "nand_ftl.h"
+
+/** @cond HIDDEN_SYMBOLS */
+
+static int32_t FTL_SflashRead(void *pvCtx, uint32_t u32Page, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    return (SFLASHSVC_Read((SFLASH_SVC_T *)pvCtx, u32Page, u32Count, pu8Buf, NULL) == SFLASH_SVC_OK) ? FTL_OK : FTL_ERR_IO;
+}
+
+static int32_t FTL_SflashProgram(void *pvCtx, uint32_t u32Page, const uint8_t *pu8Buf)
+{
+    return (SFLASHSVC_Program((SFLASH_SVC_T *)pvCtx, u32Page, 1UL, pu8Buf, NULL) == SFLASH_SVC_OK) ? FTL_OK : FTL_ERR_IO;
+}
+
+static int32_t FTL_SflashErase(void *pvCtx, uint32_t u32Block)
+{
+    return (SFLASHSVC_Erase((SFLASH_SVC_T *)pvCtx, u32Block, 1UL) == SFLASH_SVC_OK) ? FTL_OK : FTL_ERR_IO;
+}
+
+static int32_t FTL_SflashIsBad(void *pvCtx, uint32_t u32Block)
+{
+    int32_t i32Ret = SFLASHSVC_IsBadBlock((SFLASH_SVC_T *)pvCtx, u32Block);
+
+    /* A block whose marker cannot be read is not used */
+    return (i32Ret == 0L) ? 0L : 1L;
+}
+
+static int32_t FTL_SflashMarkBad(void *pvCtx, uint32_t u32Block)
+{
+    return (SFLASHSVC_MarkBadBlock((SFLASH_SVC_T *)pvCtx, u32Block) == SFLASH_SVC_OK) ? FTL_OK : FTL_ERR_IO;
+}
+
+/** @endcond HIDDEN_SYMBOLS */
+
+/**
+ *  @brief      Sets up an FTL port on an open serial flash service
+ *  @param[out] psPort  Port to fill in
+ *  @param[in]  psSvc   Service opened on a SPI-NAND device
+ *  @return     FTL_OK, or FTL_ERR_PARAM if the device is not SPI-NAND
+ *  @details    The port waits for each request, so the service must not
+ *              be shared with asynchronous users while the FTL is mounted.
+ */
+int32_t FTL_SflashPort(FTL_PORT_T *psPort, SFLASH_SVC_T *psSvc)
+{
+    SFLASH_SVC_INFO_T sInfo;
+
+    SFLASHSVC_GetInfo(psSvc, &sInfo);
+    if (sInfo.u32Type != SFLASH_SVC_TYPE_NAND)
+        return FTL_ERR_PARAM;
+
+    psPort->u32PageSize = sInfo.u32PageSize;
+    psPort->u32PagesPerBlock = sInfo.u32PagesPerBlock;
+    psPort->u32Blocks = sInfo.u32Blocks;
+    psPort->pvCtx = psSvc;
+    psPort->pfnRead = FTL_SflashRead;
+    psPort->pfnProgram = FTL_SflashProgram;
+    psPort->pfnErase = FTL_SflashErase;
+    psPort->pfnIsBad = FTL_SflashIsBad;
+    psPort->pfnMarkBad = FTL_SflashMarkBad;
+    return FTL_OK;
+}
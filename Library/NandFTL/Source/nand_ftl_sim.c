@@ -0,0 +1,146 @@
+/**************************************************************************//**
+ * @file     nand_ftl_sim.c
+ * @brief    NAND simulator in RAM for testing the FTL
+ *
+ *           Has no target dependencies, so it also builds on a host for
+ *           power-cut and write amplification runs of the FTL, see
+ *           test/test_nand_ftl.c.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <string.h>
+#include "nand_ftl.h"
+
+/** @cond HIDDEN_SYMBOLS */
+
+static uint32_t FTL_SimRand(FTL_SIM_T *psSim)
+{
+    uint32_t x = psSim->u32Seed ? psSim->u32Seed : 0x2545F491U;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    psSim->u32Seed = x;
+    return x;
+}
+
+static uint8_t *FTL_SimPage(FTL_SIM_T *psSim, uint32_t u32Page)
+{
+    return psSim->pu8Mem + (size_t)u32Page * psSim->u32PageSize;
+}
+
+/* Counts a program or erase; nonzero if the power goes during this one */
+static int32_t FTL_SimCut(FTL_SIM_T *psSim)
+{
+    return (psSim->u32CutAfter != 0U) && (psSim->u32Programs + psSim->u32Erases >= psSim->u32CutAfter);
+}
+
+static int32_t FTL_SimRead(void *pvCtx, uint32_t u32Page, uint32_t u32Count, uint8_t *pu8Buf)
+{
+    FTL_SIM_T *psSim = (FTL_SIM_T *)pvCtx;
+
+    if (psSim->u32Cut || ((u32Page + u32Count) > psSim->u32Blocks * psSim->u32PagesPerBlock))
+        return FTL_ERR_IO;
+    memcpy(pu8Buf, FTL_SimPage(psSim, u32Page), (size_t)u32Count * psSim->u32PageSize);
+    psSim->u32Reads += u32Count;
+    return FTL_OK;
+}
+
+static int32_t FTL_SimProgram(void *pvCtx, uint32_t u32Page, const uint8_t *pu8Buf)
+{
+    FTL_SIM_T *psSim = (FTL_SIM_T *)pvCtx;
+    uint8_t *pu8Dst;
+    uint32_t i, u32Len = psSim->u32PageSize;
+
+    if (psSim->u32Cut || (u32Page >= psSim->u32Blocks * psSim->u32PagesPerBlock) ||
+            psSim->pu8Bad[u32Page / psSim->u32PagesPerBlock])
+        return FTL_ERR_IO;
+
+    pu8Dst = FTL_SimPage(psSim, u32Page);
+    if (FTL_SimCut(psSim))
+    {
+        psSim->u32Cut = 1U;
+        u32Len = FTL_SimRand(psSim) % psSim->u32PageSize;
+    }
+    else if ((psSim->u32FailRate != 0U) && (FTL_SimRand(psSim) % psSim->u32FailRate == 0U))
+    {
+        /* A failed program leaves part of the page behind */
+        u32Len = FTL_SimRand(psSim) % psSim->u32PageSize;
+        for (i = 0; i < u32Len; i++)
+            pu8Dst[i] &= pu8Buf[i];
+        psSim->u32Programs++;
+        return FTL_ERR_IO;
+    }
+
+    /* Programming only clears bits */
+    for (i = 0; i < u32Len; i++)
+        pu8Dst[i] &= pu8Buf[i];
+    psSim->u32Programs++;
+    return psSim->u32Cut ? FTL_ERR_IO : FTL_OK;
+}
+
+static int32_t FTL_SimErase(void *pvCtx, uint32_t u32Block)
+{
+    FTL_SIM_T *psSim = (FTL_SIM_T *)pvCtx;
+    uint32_t u32Len = psSim->u32PagesPerBlock * psSim->u32PageSize;
+
+    if (psSim->u32Cut || (u32Block >= psSim->u32Blocks) || psSim->pu8Bad[u32Block])
+        return FTL_ERR_IO;
+
+    if (FTL_SimCut(psSim))
+    {
+        /* An interrupted erase leaves the block partly erased */
+        psSim->u32Cut = 1U;
+        u32Len = FTL_SimRand(psSim) % u32Len;
+    }
+    memset(FTL_SimPage(psSim, u32Block * psSim->u32PagesPerBlock), 0xFF, u32Len);
+    psSim->u32Erases++;
+    return psSim->u32Cut ? FTL_ERR_IO : FTL_OK;
+}
+
+static int32_t FTL_SimIsBad(void *pvCtx, uint32_t u32Block)
+{
+    FTL_SIM_T *psSim = (FTL_SIM_T *)pvCtx;
+
+    return (u32Block >= psSim->u32Blocks) || psSim->pu8Bad[u32Block];
+}
+
+static int32_t FTL_SimMarkBad(void *pvCtx, uint32_t u32Block)
+{
+    FTL_SIM_T *psSim = (FTL_SIM_T *)pvCtx;
+
+    if (psSim->u32Cut || (u32Block >= psSim->u32Blocks))
+        return FTL_ERR_IO;
+    psSim->pu8Bad[u32Block] = 1U;
+    return FTL_OK;
+}
+
+/** @endcond HIDDEN_SYMBOLS */
+
+/**
+ *  @brief      Sets up an FTL port on a RAM NAND simulator
+ *  @param[out] psPort  Port to fill in
+ *  @param[in]  psSim   Simulator with memory, geometry and fault settings
+ *                      filled in. The memory is not cleared, so a port set
+ *                      up again after a power cut sees the old contents;
+ *                      fill pu8Mem with 0xFF and pu8Bad with 0 for a new chip.
+ *  @return     FTL_OK or FTL_ERR_PARAM
+ */
+int32_t FTL_SimPort(FTL_PORT_T *psPort, FTL_SIM_T *psSim)
+{
+    if ((psSim == NULL) || (psSim->pu8Mem == NULL) || (psSim->pu8Bad == NULL) ||
+            (psSim->u32PageSize == 0U) || (psSim->u32PagesPerBlock == 0U) || (psSim->u32Blocks == 0U))
+        return FTL_ERR_PARAM;
+
+    psPort->u32PageSize = psSim->u32PageSize;
+    psPort->u32PagesPerBlock = psSim->u32PagesPerBlock;
+    psPort->u32Blocks = psSim->u32Blocks;
+    psPort->pvCtx = psSim;
+    psPort->pfnRead = FTL_SimRead;
+    psPort->pfnProgram = FTL_SimProgram;
+    psPort->pfnErase = FTL_SimErase;
+    psPort->pfnIsBad = FTL_SimIsBad;
+    psPort->pfnMarkBad = FTL_SimMarkBad;
+    return FTL_OK;
+}
@@ -0,0 +1,408 @@
+/**************************************************************************//**
+ * @file     test_nand_ftl.c
+ * @brief    Host test of the NAND FTL on the RAM NAND simulator.
+ *
+ *           The power-cut runs write, trim, sync and checkpoint at random
+ *           and cut the power after a random number of program and erase
+ *           operations. After each remount every sector must hold a
+ *           generation it was written with and nothing older than what was
+ *           committed. The write amplification runs report the FTL counters
+ *           for sequential and random workloads and check that they add up
+ *           to what the simulator saw.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nand_ftl.h"
+
+#define SIM_PAGE_SIZE       2048U
+#define SIM_PAGES_PER_BLOCK 32U
+#define SIM_BLOCKS          256U
+#define SIM_SECTORS_MAX     (SIM_BLOCKS * SIM_PAGES_PER_BLOCK * (SIM_PAGE_SIZE / FTL_SECTOR_SIZE))
+#define MAX_IO_SECTORS      16U
+
+static uint8_t   s_au8SimMem[SIM_BLOCKS * SIM_PAGES_PER_BLOCK * SIM_PAGE_SIZE];
+static uint8_t   s_au8SimBad[SIM_BLOCKS];
+static uint64_t  *s_pu64Work;
+static uint32_t  s_u32WorkSize;
+static uint32_t  s_au32Buf[MAX_IO_SECTORS * FTL_SECTOR_SIZE / 4];
+static uint32_t  s_au32Check[FTL_SECTOR_SIZE / 4];
+
+/* Per sector: newest generation written and oldest one the FTL may still
+   return, 0 meaning never written or trimmed */
+static uint32_t  s_au32Newest[SIM_SECTORS_MAX];
+static uint32_t  s_au32Oldest[SIM_SECTORS_MAX];
+static uint8_t   s_au8Trimmed[SIM_SECTORS_MAX];
+
+static FTL_SIM_T s_sSim;
+static FTL_PORT_T s_sPort;
+static FTL_T     s_sFtl;
+static FTL_CFG_T s_sCfg;
+static uint32_t  s_u32Seed = 1;
+
+static uint32_t Rand(uint32_t u32Range)
+{
+    s_u32Seed = s_u32Seed * 1103515245U + 12345U;
+    return ((s_u32Seed >> 16) | (s_u32Seed << 16)) % u32Range;
+}
+
+static void Fill(uint32_t *pu32Buf, uint32_t u32Sector, uint32_t u32Gen)
+{
+    uint32_t i;
+
+    for (i = 0; i < FTL_SECTOR_SIZE / 4; i += 2)
+    {
+        pu32Buf[i] = u32Sector;
+        pu32Buf[i + 1] = u32Gen ^ i;
+    }
+}
+
+/* Generation held by a sector read back, 0 for an erased sector, 0xFFFFFFFF for garbage */
+static uint32_t Generation(const uint32_t *pu32Buf, uint32_t u32Sector)
+{
+    uint32_t u32Gen = pu32Buf[1];
+
+    memset(s_au32Check, 0xFF, sizeof(s_au32Check));
+    if (memcmp(pu32Buf, s_au32Check, FTL_SECTOR_SIZE) == 0)
+        return 0U;
+    Fill(s_au32Check, u32Sector, u32Gen);
+    if ((u32Gen == 0U) || (memcmp(pu32Buf, s_au32Check, FTL_SECTOR_SIZE) != 0))
+        return 0xFFFFFFFFU;
+    return u32Gen;
+}
+
+/* A fresh chip, with u32Bad factory bad blocks */
+static void SimNew(uint32_t u32Bad, uint32_t u32FailRate)
+{
+    uint32_t i;
+
+    memset(s_au8SimMem, 0xFF, sizeof(s_au8SimMem));
+    memset(s_au8SimBad, 0, sizeof(s_au8SimBad));
+    for (i = 0; i < u32Bad; i++)
+        s_au8SimBad[1U + Rand(SIM_BLOCKS - 1U)] = 1U;
+
+    memset(&s_sSim, 0, sizeof(s_sSim));
+    s_sSim.pu8Mem = s_au8SimMem;
+    s_sSim.pu8Bad = s_au8SimBad;
+    s_sSim.u32PageSize = SIM_PAGE_SIZE;
+    s_sSim.u32PagesPerBlock = SIM_PAGES_PER_BLOCK;
+    s_sSim.u32Blocks = SIM_BLOCKS;
+    s_sSim.u32FailRate = u32FailRate;
+    s_sSim.u32Seed = s_u32Seed;
+    FTL_SimPort(&s_sPort, &s_sSim);
+
+    memset(&s_sCfg, 0, sizeof(s_sCfg));
+    s_sCfg.psPort = &s_sPort;
+    s_sCfg.pvWork = s_pu64Work;
+    s_sCfg.u32WorkSize = s_u32WorkSize;
+
+    memset(s_au32Newest, 0, sizeof(s_au32Newest));
+    memset(s_au32Oldest, 0, sizeof(s_au32Oldest));
+    memset(s_au8Trimmed, 0, sizeof(s_au8Trimmed));
+}
+
+static int32_t SimMount(void)
+{
+    int32_t i32Ret;
+
+    i32Ret = FTL_Mount(&s_sFtl, &s_sCfg);
+    if (i32Ret == FTL_ERR_FORMAT)
+    {
+        i32Ret = FTL_Format(&s_sFtl, &s_sCfg);
+        if (i32Ret == FTL_OK)
+            i32Ret = FTL_Mount(&s_sFtl, &s_sCfg);
+    }
+    return i32Ret;
+}
+
+/* Everything written so far is committed */
+static void Committed(int i32Checkpoint)
+{
+    uint32_t i;
+
+    for (i = 0; i < SIM_SECTORS_MAX; i++)
+    {
+        if (!s_au8Trimmed[i])
+            s_au32Oldest[i] = s_au32Newest[i];
+        else if (i32Checkpoint)
+        {
+            /* The trim is on flash now, the old data cannot come back */
+            s_au32Newest[i] = s_au32Oldest[i] = 0U;
+            s_au8Trimmed[i] = 0U;
+        }
+    }
+}
+
+/* Every sector must hold a generation from its allowed range */
+static int CheckAll(uint32_t u32Round)
+{
+    uint32_t u32Sectors = FTL_GetSectorCount(&s_sFtl), i, j, n, u32Gen;
+    int32_t  i32Ret;
+
+    for (i = 0; i < u32Sectors; i += n)
+    {
+        n = (u32Sectors - i < MAX_IO_SECTORS) ? u32Sectors - i : MAX_IO_SECTORS;
+        i32Ret = FTL_Read(&s_sFtl, i, n, (uint8_t *)s_au32Buf);
+        if (i32Ret != FTL_OK)
+        {
+            printf("  round %u: read of sector %u failed %d\n", u32Round, i, i32Ret);
+            return 1;
+        }
+        for (j = 0; j < n; j++)
+        {
+            u32Gen = Generation(s_au32Buf + j * (FTL_SECTOR_SIZE / 4), i + j);
+
+            /* Generations only grow, so anything in between was also written to this sector */
+            if ((u32Gen < s_au32Oldest[i + j]) || (u32Gen > s_au32Newest[i + j]))
+            {
+                printf("  round %u: sector %u holds generation %d, expected %u..%u\n", u32Round, i + j,
+                       (int)u32Gen, s_au32Oldest[i + j], s_au32Newest[i + j]);
+                return 1;
+            }
+            /* What the mount found is on flash and stays */
+            s_au32Oldest[i + j] = s_au32Newest[i + j] = u32Gen;
+            s_au8Trimmed[i + j] = 0U;
+        }
+    }
+    return 0;
+}
+
+/* Random writes, trims, syncs and checkpoints until the power goes or an error */
+static int32_t Workload(uint32_t *pu32Gen, uint32_t u32Hot)
+{
+    uint32_t u32Sectors = FTL_GetSectorCount(&s_sFtl), u32Op, u32Sector, n, i;
+    int32_t  i32Ret = FTL_OK;
+
+    while (!s_sSim.u32Cut)
+    {
+        u32Op = Rand(1000U);
+        n = 1U + Rand(MAX_IO_SECTORS);
+        u32Sector = (Rand(4U) != 0U) ? Rand(u32Hot) : Rand(u32Sectors);
+        if (n > u32Sectors - u32Sector)
+            n = u32Sectors - u32Sector;
+
+        if (u32Op < 900U)
+        {
+            for (i = 0; i < n; i++)
+            {
+                Fill(s_au32Buf + i * (FTL_SECTOR_SIZE / 4), u32Sector + i, ++*pu32Gen);
+                s_au32Newest[u32Sector + i] = *pu32Gen;
+                s_au8Trimmed[u32Sector + i] = 0U;
+            }
+            i32Ret = FTL_Write(&s_sFtl, u32Sector, n, (const uint8_t *)s_au32Buf);
+        }
+        else if (u32Op < 970U)
+        {
+            i32Ret = FTL_Sync(&s_sFtl);
+            if (i32Ret == FTL_OK)
+                Committed(0);
+        }
+        else if (u32Op < 990U)
+        {
+            i32Ret = FTL_Trim(&s_sFtl, u32Sector, n);
+            for (i = 0; i < n; i++)
+            {
+                s_au32Oldest[u32Sector + i] = 0U;
+                s_au8Trimmed[u32Sector + i] = 1U;
+            }
+        }
+        else
+        {
+            i32Ret = FTL_Checkpoint(&s_sFtl);
+            if (i32Ret == FTL_OK)
+                Committed(1);
+        }
+
+        if (i32Ret != FTL_OK)
+            break;
+    }
+    return i32Ret;
+}
+
+static int PowerCuts(uint32_t u32Rounds, uint32_t u32Bad, uint32_t u32FailRate)
+{
+    FTL_STAT_T sStat;
+    uint32_t u32Round, u32Gen = 0U, u32Replayed = 0U;
+    int32_t  i32Ret;
+
+    SimNew(u32Bad, u32FailRate);
+
+    for (u32Round = 0; u32Round < u32Rounds; u32Round++)
+    {
+        i32Ret = SimMount();
+        if (i32Ret != FTL_OK)
+        {
+            printf("  round %u: mount failed %d\n", u32Round, i32Ret);
+            return 1;
+        }
+        if (CheckAll(u32Round))
+            return 1;
+        FTL_GetStat(&s_sFtl, &sStat);
+        u32Replayed += sStat.u32ReplayedPages;
+
+        s_sSim.u32CutAfter = s_sSim.u32Programs + s_sSim.u32Erases + 1U + Rand(5000U);
+        i32Ret = Workload(&u32Gen, FTL_GetSectorCount(&s_sFtl) / 8U);
+        if (!s_sSim.u32Cut)
+        {
+            printf("  round %u: error %d before the power cut\n", u32Round, i32Ret);
+            return 1;
+        }
+
+        /* Power up again */
+        s_sSim.u32Cut = 0U;
+        s_sSim.u32CutAfter = 0U;
+    }
+
+    /* A clean unmount leaves nothing to replay */
+    if ((SimMount() != FTL_OK) || CheckAll(u32Rounds) || (FTL_Unmount(&s_sFtl) != FTL_OK) ||
+            (SimMount() != FTL_OK) || CheckAll(u32Rounds + 1U))
+    {
+        printf("  clean unmount and mount failed\n");
+        return 1;
+    }
+    FTL_GetStat(&s_sFtl, &sStat);
+    if (sStat.u32ReplayedPages != 0U)
+    {
+        printf("  mount after a clean unmount replayed %u pages\n", sStat.u32ReplayedPages);
+        return 1;
+    }
+
+    printf("  %u cuts: %u sector writes, %u pages programmed, %u erases, %u pages replayed, %u bad blocks\n",
+           u32Rounds, u32Gen, s_sSim.u32Programs, s_sSim.u32Erases, u32Replayed, sStat.u32BadBlocks);
+    FTL_Unmount(&s_sFtl);
+    return 0;
+}
+
+static int Test_PowerCuts(void)
+{
+    return PowerCuts(300U, 0U, 0U);
+}
+
+static int Test_PowerCutsBadBlocks(void)
+{
+    /* Factory bad blocks and programs that fail now and then, within the
+       2 % of the partition the FTL keeps for bad blocks */
+    return PowerCuts(100U, 2U, 100000U);
+}
+
+/* Write amplification of u32Io-sector writes over the first u32Fill percent
+   of a fresh volume, either in order or at random */
+static int WriteAmp(const char *pcName, uint32_t u32Fill, uint32_t u32Io, int i32Seq, uint32_t u32Writes,
+                    uint32_t u32MaxWa)
+{
+    FTL_STAT_T sStat;
+    uint32_t u32Sectors, u32Span, u32Sector, u32Done, u32Programs, u32Erases, u32Wa;
+
+    SimNew(0U, 0U);
+    if (SimMount() != FTL_OK)
+        return 1;
+    u32Sectors = FTL_GetSectorCount(&s_sFtl);
+
+    /* Fill the span first, then start counting */
+    u32Span = u32Sectors / 100U * u32Fill / MAX_IO_SECTORS * MAX_IO_SECTORS;
+    for (u32Sector = 0; u32Sector < u32Span; u32Sector += MAX_IO_SECTORS)
+    {
+        if (FTL_Write(&s_sFtl, u32Sector, MAX_IO_SECTORS, (const uint8_t *)s_au32Buf) != FTL_OK)
+            return 1;
+    }
+    if (FTL_Unmount(&s_sFtl) != FTL_OK || SimMount() != FTL_OK)
+        return 1;
+    u32Programs = s_sSim.u32Programs;
+    u32Erases = s_sSim.u32Erases;
+
+    for (u32Done = 0, u32Sector = 0; u32Done < u32Writes; u32Done += u32Io)
+    {
+        if (!i32Seq)
+            u32Sector = Rand(u32Span / u32Io) * u32Io;
+        else if (u32Sector + u32Io > u32Span)
+            u32Sector = 0U;
+        if (FTL_Write(&s_sFtl, u32Sector, u32Io, (const uint8_t *)s_au32Buf) != FTL_OK)
+            return 1;
+        u32Sector += u32Io;
+        /* A sync every 256 KB, as a file system would on close */
+        if ((u32Done % 512U) + u32Io > 512U && FTL_Sync(&s_sFtl) != FTL_OK)
+            return 1;
+    }
+    if (FTL_Sync(&s_sFtl) != FTL_OK)
+        return 1;
+    FTL_GetStat(&s_sFtl, &sStat);
+
+    u32Wa = (uint32_t)((uint64_t)sStat.u32PagesProgrammed * sStat.u32SectorsPerPage * 100U / sStat.u32HostWrites);
+    printf("  %-26s WA %u.%02u: %u host sectors, %u data + %u meta + %u header + %u checkpoint pages,\n"
+           "  %-26s %u pad sectors, %u sectors moved by GC, %u erases, erase count %u..%u\n",
+           pcName, u32Wa / 100U, u32Wa % 100U, sStat.u32HostWrites, sStat.u32DataPages, sStat.u32MetaPages,
+           sStat.u32HeaderPages, sStat.u32CkptPages, "", sStat.u32PadSectors, sStat.u32GcSectors, sStat.u32Erases,
+           sStat.u32MinErase, sStat.u32MaxErase);
+
+    /* The counters must add up to what the chip saw */
+    if ((sStat.u32HostWrites != u32Done) ||
+            (sStat.u32PagesProgrammed != sStat.u32DataPages + sStat.u32MetaPages + sStat.u32HeaderPages + sStat.u32CkptPages) ||
+            (sStat.u32PagesProgrammed != s_sSim.u32Programs - u32Programs) ||
+            (sStat.u32Erases != s_sSim.u32Erases - u32Erases))
+    {
+        printf("  counters do not match: programs %u (chip %u), erases %u (chip %u), host writes %u (%u)\n",
+               sStat.u32PagesProgrammed, s_sSim.u32Programs - u32Programs, sStat.u32Erases,
+               s_sSim.u32Erases - u32Erases, sStat.u32HostWrites, u32Done);
+        return 1;
+    }
+    if (u32Wa > u32MaxWa)
+    {
+        printf("  write amplification above %u.%02u\n", u32MaxWa / 100U, u32MaxWa % 100U);
+        return 1;
+    }
+
+    FTL_Unmount(&s_sFtl);
+    return 0;
+}
+
+static int Test_WriteAmplification(void)
+{
+    int i32Fail = 0;
+
+    i32Fail |= WriteAmp("sequential 8 KB, 50% full", 50U, MAX_IO_SECTORS, 1, 200000U, 130U);
+    i32Fail |= WriteAmp("random 4 KB, 50% full", 50U, 8U, 0, 200000U, 250U);
+    i32Fail |= WriteAmp("random 512 B, 50% full", 50U, 1U, 0, 100000U, 400U);
+    i32Fail |= WriteAmp("random 512 B, 80% full", 80U, 1U, 0, 100000U, 800U);
+    return i32Fail;
+}
+
+int main(void)
+{
+    struct
+    {
+        const char *pcName;
+        int (*pfnTest)(void);
+    } asTest[] =
+    {
+        { "Power cuts",                         Test_PowerCuts },
+        { "Power cuts with bad blocks",         Test_PowerCutsBadBlocks },
+        { "Write amplification",                Test_WriteAmplification },
+    };
+    uint32_t i;
+    int i32Fail, i32Total = 0;
+
+    s_sSim.u32PageSize = SIM_PAGE_SIZE;
+    s_sSim.u32PagesPerBlock = SIM_PAGES_PER_BLOCK;
+    s_sSim.u32Blocks = SIM_BLOCKS;
+    s_sSim.pu8Mem = s_au8SimMem;
+    s_sSim.pu8Bad = s_au8SimBad;
+    FTL_SimPort(&s_sPort, &s_sSim);
+    s_u32WorkSize = FTL_GetWorkSize(&s_sPort, 0U);
+    s_pu64Work = malloc(s_u32WorkSize);
+    if ((s_u32WorkSize == 0U) || (s_pu64Work == NULL))
+        return 1;
+
+    for (i = 0; i < sizeof(asTest) / sizeof(asTest[0]); i++)
+    {
+        s_u32Seed = 1U + i;
+        i32Fail = asTest[i].pfnTest();
+        printf("%-32s %s\n", asTest[i].pcName, i32Fail ? "FAIL" : "PASS");
+        i32Total |= i32Fail;
+    }
+
+    free(s_pu64Work);
+    return i32Total;
+}
@@ -185,6 +185,10 @@ typedef enum
     eCANFD_REJ_NON_MATCH_FRM   = 0x3          /*!< Reject Non-Matching Frames. */
 } E_CANFD_ACC_NON_MATCH_FRM;
 
+#define CANFD_FLTR_MAX_RULES        256    /*!< Maximum number of rules accepted by CANFD_CompileFilters() */
+#define CANFD_FLTR_ERR_PARAM        (-1)   /*!< Invalid filter rule */
+#define CANFD_FLTR_ERR_NO_SPACE     (-2)   /*!< Compiled filters do not fit in hardware or Message RAM */
+
 /*! @}*/ /* end of group CANFD_EXPORTED_CONSTANTS */
 
 /** @addtogroup CANFD_EXPORTED_STRUCTS CANFD Exported Structs
@@ -376,6 +380,36 @@ typedef struct
     uint8_t             bBitRateSwitch;  /*!< Bit Rate Switch */
 } CANFD_TX_EVNT_ELEM_T;
 
+/*! Acceptance rule for CANFD_CompileFilters() */
+typedef struct
+{
+    E_CANFD_ID_TYPE     eIdType;       /*!< Standard ID or Extended ID */
+    uint32_t            u32IdLow;      /*!< First accepted ID */
+    uint32_t            u32IdHigh;     /*!< Last accepted ID, equal to u32IdLow for a single ID */
+    E_CANFD_FLTR_CONFIG eConfig;       /*!< Target: Rx FIFO 0/1, Rx buffer, reject or priority */
+    uint32_t            u32RxBufIdx;   /*!< Rx buffer index if eConfig is eCANFD_FLTR_ELEM_STO_RX_BUF_OR_DBG_MSG */
+} CANFD_FLTR_RULE_T;
+
+/*! Compiled filter element list */
+typedef struct
+{
+    uint32_t          au32Std[CANFD_MAX_11_BIT_FTR_ELEMS];     /*!< Standard ID filter elements */
+    uint32_t          au32Ext[CANFD_MAX_29_BIT_FTR_ELEMS][2];  /*!< Extended ID filter elements (F0, F1) */
+    uint32_t          u32StdCnt;                               /*!< Number of standard ID filter elements */
+    uint32_t          u32ExtCnt;                               /*!< Number of extended ID filter elements */
+} CANFD_FLTR_LIST_T;
+
+/*! Software message ring. Lock-free for one producer and one consumer. */
+typedef struct
+{
+    CANFD_FD_MSG_T    *psBuf;        /*!< Ring storage (u32Mask + 1 messages) */
+    uint32_t          u32Mask;       /*!< Ring size - 1, ring size is a power of two */
+    volatile uint32_t u32Head;       /*!< Producer index (free running) */
+    volatile uint32_t u32Tail;       /*!< Consumer index (free running) */
+    uint32_t          u32Overrun;    /*!< Producer found the ring full */
+    uint32_t          u32HwLost;     /*!< Hardware Rx FIFO message lost events */
+} CANFD_MSG_RING_T;
+
 /// @cond HIDDEN_SYMBOLS
 #define CANFD_REG_READ_TIME       3
 
@@ -462,6 +496,18 @@ void CANFD_RunToNormal(CANFD_T *canfd, uint8_t u8Enable);
 void CANFD_GetDefaultConfig(CANFD_FD_T *psConfig, uint8_t u8OpMode);
 void CANFD_ClearStatusFlag(CANFD_T *canfd, uint32_t u32InterruptFlag);
 uint32_t CANFD_GetStatusFlag(CANFD_T *canfd, uint32_t u32IntTypeFlag);
+uint32_t CANFD_InitTxFifoQueue(CANFD_T *canfd, CANFD_ELEM_SIZE_T *psElemSize, E_CANFD_MODE eMode, uint32_t u32DBufNum, uint32_t u32ElemCnt);
+uint32_t CANFD_ReadRxFifoMsgs(CANFD_T *canfd, uint8_t u8FifoIdx, CANFD_FD_MSG_T *psMsgBuf, uint32_t u32MaxCnt);
+void CANFD_RingInit(CANFD_MSG_RING_T *psRing, CANFD_FD_MSG_T *psBuf, uint32_t u32Size);
+uint32_t CANFD_RingPut(CANFD_MSG_RING_T *psRing, CANFD_FD_MSG_T *psMsg);
+uint32_t CANFD_RingGet(CANFD_MSG_RING_T *psRing, CANFD_FD_MSG_T *psMsg);
+uint32_t CANFD_RingCount(CANFD_MSG_RING_T *psRing);
+uint32_t CANFD_DrainRxFifoToRing(CANFD_T *canfd, uint8_t u8FifoIdx, CANFD_MSG_RING_T *psRing);
+uint32_t CANFD_TxRingRefill(CANFD_T *canfd, CANFD_MSG_RING_T *psRing);
+uint32_t CANFD_TxRingSend(CANFD_T *canfd, CANFD_MSG_RING_T *psRing, CANFD_FD_MSG_T *psTxMsg);
+int32_t CANFD_CompileFilters(const CANFD_FLTR_RULE_T *psRules, uint32_t u32NumRules, CANFD_FLTR_LIST_T *psList);
+int32_t CANFD_BalanceRam(CANFD_FD_T *psConfig, const CANFD_FLTR_LIST_T *psList);
+void CANFD_InstallFilters(CANFD_T *canfd, const CANFD_FLTR_LIST_T *psList);
 
 /*! @}*/ /* end of group CANFD_EXPORTED_FUNCTIONS */
 
@@ -0,0 +1,141 @@
+/**************************************************************************//**
+ * @file     eadc_svc.h
+ * @brief    EADC streaming acquisition service header file
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __EADC_SVC_H__
+#define __EADC_SVC_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup EADC_SVC_Driver EADC Streaming Acquisition Service
+  @{
+*/
+
+/** @addtogroup EADC_SVC_EXPORTED_CONSTANTS EADC Streaming Acquisition Service Exported Constants
+  @{
+*/
+
+#define EADC_SVC_OK             0L      /*!< Operation succeeded \hideinitializer */
+#define EADC_SVC_ERR_PARAM      -1L     /*!< Invalid parameter, e.g. block size not a multiple of a cache line \hideinitializer */
+
+#define EADC_SVC_MODULE_MAX     9UL     /*!< Sample modules that can request PDMA (EADC_PDMACTL[8:0]) \hideinitializer */
+#define EADC_SVC_BLOCK_MAX      16UL    /*!< Most buffers in the descriptor ring \hideinitializer */
+#define EADC_SVC_TXCNT_MAX      0x10000UL   /*!< Most samples per block (TXCNT is 16 bits) \hideinitializer */
+
+#define EADC_SVC_BLK_OVERRUN    0x1UL   /*!< An unreleased block was overwritten since the previous block \hideinitializer */
+#define EADC_SVC_BLK_TRG_LOST   0x2UL   /*!< A trigger came while a conversion was still pending, so a frame was lost \hideinitializer */
+
+/*! @}*/ /* end of group EADC_SVC_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup EADC_SVC_EXPORTED_STRUCTS EADC Streaming Acquisition Service Exported Structs
+  @{
+*/
+
+/**
+ *  @brief  A filled block as handed to the block-ready callback.
+ *          Samples are interleaved frame by frame, one sample per sample module
+ *          in module order. The data stays valid until the block is released
+ *          and at most (u32Blocks - 1) blocks later.
+ */
+typedef struct
+{
+    const uint16_t  *pu16Data;      /*!< First sample of the block */
+    uint32_t        u32Frames;      /*!< Frames in the block */
+    uint32_t        u32Seq;         /*!< Block sequence number, free-running from 0 */
+    uint64_t        u64Frame;       /*!< Index of the first frame since EADCSVC_Open() */
+    uint64_t        u64Timestamp;   /*!< Physical counter (CNTPCT) when the block completed */
+    uint32_t        u32Flags;       /*!< EADC_SVC_BLK_xxx */
+} EADC_SVC_BLOCK_T;
+
+/**
+ *  @brief  Block-ready callback, called from PDMA interrupt context.
+ *          Process the block in place and call EADCSVC_Release(), or hand
+ *          psBlk->u32Seq to a task that releases it when it is done.
+ */
+typedef void (*EADC_SVC_CB)(void *pvArg, const EADC_SVC_BLOCK_T *psBlk);
+
+/**
+ *  @brief  Stream configuration passed to EADCSVC_Open().
+ *          Sample modules 0 to (u32Modules - 1) convert au32Channel[] on every
+ *          trigger. The ring pu16Buf holds u32Blocks blocks of u32BlockFrames
+ *          frames. It is invalidated from the data cache block by block, so it
+ *          must be 64-byte aligned and each block a multiple of 64 bytes.
+ */
+typedef struct
+{
+    EADC_T      *eadc;              /*!< EADC controller */
+    PDMA_T      *pdma;              /*!< PDMA controller serving the stream */
+    uint32_t    u32Ch;              /*!< PDMA channel */
+    uint32_t    u32Req;             /*!< PDMA request source, e.g. \ref PDMA_EADC0_RX */
+    uint32_t    u32InputMode;       /*!< \ref EADC_CTL_DIFFEN_SINGLE_END or \ref EADC_CTL_DIFFEN_DIFFERENTIAL */
+    uint32_t    u32TriggerSrc;      /*!< Common trigger, e.g. \ref EADC_EPWM0TG0_TRIGGER or \ref EADC_TIMER0_TRIGGER */
+    uint32_t    u32Modules;         /*!< Sample modules per frame, 1 to EADC_SVC_MODULE_MAX */
+    uint32_t    au32Channel[EADC_SVC_MODULE_MAX];   /*!< Analog input of each sample module */
+    uint16_t    *pu16Buf;           /*!< Ring storage, u32Blocks * u32BlockFrames * u32Modules samples */
+    uint32_t    u32Blocks;          /*!< Blocks in the ring, 2 to EADC_SVC_BLOCK_MAX */
+    uint32_t    u32BlockFrames;     /*!< Frames per block */
+    EADC_SVC_CB pfnBlock;           /*!< Block-ready callback, required */
+    void        *pvArg;             /*!< Argument passed to pfnBlock */
+} EADC_SVC_CFG_T;
+
+/**
+ *  @brief  Stream statistics. All counters are free-running.
+ */
+typedef struct
+{
+    uint32_t    u32Blocks;          /*!< Blocks completed by PDMA */
+    uint32_t    u32Overrun;         /*!< Blocks overwritten before they were released */
+    uint32_t    u32TriggerLost;     /*!< Blocks during which a trigger was lost */
+} EADC_SVC_STAT_T;
+
+/**
+ *  @brief  Stream control block. Treat as opaque.
+ */
+typedef struct
+{
+    uint32_t            au32Desc[EADC_SVC_BLOCK_MAX][8] __attribute__((aligned(64)));  /*!< Looping scatter-gather descriptors, one per block */
+    EADC_SVC_CFG_T      sCfg;
+    uint32_t            u32BlockLen;        /*!< Samples per block */
+    uint32_t            u32ModuleMsk;       /*!< Sample modules of the stream */
+    volatile uint32_t   u32Done;            /*!< Blocks completed by PDMA */
+    volatile uint32_t   u32Released;        /*!< Blocks released by the consumer, in order */
+    uint64_t            u64Frames;          /*!< Frames completed by PDMA */
+    EADC_SVC_STAT_T     sStat;
+} EADC_SVC_T;
+
+/*! @}*/ /* end of group EADC_SVC_EXPORTED_STRUCTS */
+
+
+/** @addtogroup EADC_SVC_EXPORTED_FUNCTIONS EADC Streaming Acquisition Service Exported Functions
+  @{
+*/
+
+int32_t EADCSVC_Open(EADC_SVC_T *psSvc, const EADC_SVC_CFG_T *psCfg);
+void EADCSVC_Close(EADC_SVC_T *psSvc);
+void EADCSVC_Release(EADC_SVC_T *psSvc, uint32_t u32Seq);
+void EADCSVC_GetStat(EADC_SVC_T *psSvc, EADC_SVC_STAT_T *psStat);
+void EADCSVC_PDMA_IRQHandler(EADC_SVC_T *psSvc);
+
+/*! @}*/ /* end of group EADC_SVC_EXPORTED_FUNCTIONS */
+
+/*! @}*/ /* end of group EADC_SVC_Driver */
+
+/*! @}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__EADC_SVC_H__*/
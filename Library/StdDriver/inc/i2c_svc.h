@@ -0,0 +1,143 @@
+/**************************************************************************//**
+ * @file     i2c_svc.h
+ * @brief    I2C asynchronous transaction engine header file
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __I2C_SVC_H__
+#define __I2C_SVC_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup I2C_SVC_Driver I2C Transaction Engine
+  @{
+*/
+
+/** @addtogroup I2C_SVC_EXPORTED_CONSTANTS I2C Transaction Engine Exported Constants
+  @{
+*/
+
+#define I2C_SVC_OK              0L      /*!< Transaction completed \hideinitializer */
+#define I2C_SVC_PENDING         1L      /*!< Transaction queued or in progress \hideinitializer */
+#define I2C_SVC_ERR_PARAM       -1L     /*!< Invalid transaction descriptor \hideinitializer */
+#define I2C_SVC_ERR_NACK        -2L     /*!< Address or data byte was not acknowledged \hideinitializer */
+#define I2C_SVC_ERR_ARB         -3L     /*!< Arbitration lost \hideinitializer */
+#define I2C_SVC_ERR_BUS         -4L     /*!< Bus error or unexpected controller status \hideinitializer */
+#define I2C_SVC_ERR_TIMEOUT     -5L     /*!< Controller time-out counter expired \hideinitializer */
+
+#define I2C_SVC_DMA_DEFAULT_THRESHOLD   16UL    /*!< Default payload length from which PDMA is used \hideinitializer */
+
+/*! @}*/ /* end of group I2C_SVC_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup I2C_SVC_EXPORTED_STRUCTS I2C Transaction Engine Exported Structs
+  @{
+*/
+
+struct I2C_SVC_XFER;
+
+/**
+ *  @brief  Completion callback, called from interrupt context once per transaction.
+ *          A FreeRTOS application typically gives a semaphore or task notification here.
+ */
+typedef void (*I2C_SVC_CB)(struct I2C_SVC_XFER *psXfer);
+
+/**
+ *  @brief  Transaction descriptor.
+ *          A transaction writes u32TxLen bytes, then reads u32RxLen bytes after a
+ *          repeated START, then ends with STOP. Either phase can be empty; with both
+ *          empty only the address is sent, which probes for the device.
+ *          The descriptor is owned by the engine from \ref I2CSVC_Submit until
+ *          i32Status leaves \ref I2C_SVC_PENDING.
+ */
+typedef struct I2C_SVC_XFER
+{
+    uint8_t                 u8SlaveAddr;    /*!< 7-bit slave address */
+    const uint8_t           *pu8Tx;         /*!< Write phase data, e.g. register address followed by payload */
+    uint32_t                u32TxLen;       /*!< Write phase length */
+    uint8_t                 *pu8Rx;         /*!< Read phase buffer */
+    uint32_t                u32RxLen;       /*!< Read phase length */
+    I2C_SVC_CB              pfnDone;        /*!< Completion callback, can be NULL */
+    void                    *pvArg;         /*!< User argument for pfnDone */
+    volatile int32_t        i32Status;      /*!< \ref I2C_SVC_PENDING, \ref I2C_SVC_OK or a negative error */
+    uint32_t                u32TxDone;      /*!< Bytes written so far */
+    uint32_t                u32RxDone;      /*!< Bytes read so far */
+    struct I2C_SVC_XFER     *psNext;        /*!< Queue link, owned by the engine */
+} I2C_SVC_XFER_T;
+
+/**
+ *  @brief  Bus configuration passed to I2CSVC_Open().
+ *          Set pdma to NULL to run every transaction byte by byte from the I2C interrupt.
+ */
+typedef struct
+{
+    I2C_T       *i2c;               /*!< I2C port, already opened by \ref I2C_Open */
+    IRQn_ID_t   eIrq;               /*!< Interrupt number of the I2C port */
+    PDMA_T      *pdma;              /*!< PDMA controller for long payloads, or NULL */
+    uint32_t    u32TxCh;            /*!< PDMA channel for TX */
+    uint32_t    u32RxCh;            /*!< PDMA channel for RX */
+    uint32_t    u32TxReq;           /*!< PDMA request source for TX, e.g. \ref PDMA_I2C2_TX */
+    uint32_t    u32RxReq;           /*!< PDMA request source for RX, e.g. \ref PDMA_I2C2_RX */
+    uint32_t    u32DmaThreshold;    /*!< Smallest payload moved by PDMA, 0 selects \ref I2C_SVC_DMA_DEFAULT_THRESHOLD */
+} I2C_SVC_CFG_T;
+
+/**
+ *  @brief  Bus statistics. All counters are free-running.
+ */
+typedef struct
+{
+    uint32_t    u32Xfers;           /*!< Transactions completed successfully */
+    uint32_t    u32Errors;          /*!< Transactions completed with an error */
+    uint32_t    u32Nacks;           /*!< Of which NACK */
+    uint32_t    u32ArbLost;         /*!< Of which arbitration lost */
+    uint32_t    u32Timeouts;        /*!< Of which time-out */
+    uint32_t    u32DmaXfers;        /*!< Payloads moved by PDMA */
+    uint32_t    u32Bytes;           /*!< Payload bytes moved in either direction */
+} I2C_SVC_STAT_T;
+
+/**
+ *  @brief  Bus control block. Treat as opaque.
+ */
+typedef struct
+{
+    I2C_SVC_CFG_T           sCfg;
+    I2C_SVC_XFER_T          *psHead;        /*!< Transaction on the bus, or NULL when idle */
+    I2C_SVC_XFER_T          *psTail;        /*!< Last queued transaction */
+    uint32_t                u32Dma;         /*!< PDMA payload in flight: 0 none, 1 TX, 2 RX */
+    I2C_SVC_STAT_T          sStat;
+} I2C_SVC_T;
+
+/*! @}*/ /* end of group I2C_SVC_EXPORTED_STRUCTS */
+
+
+/** @addtogroup I2C_SVC_EXPORTED_FUNCTIONS I2C Transaction Engine Exported Functions
+  @{
+*/
+
+int32_t I2CSVC_Open(I2C_SVC_T *psSvc, const I2C_SVC_CFG_T *psCfg);
+void I2CSVC_Close(I2C_SVC_T *psSvc);
+int32_t I2CSVC_Submit(I2C_SVC_T *psSvc, I2C_SVC_XFER_T *psXfer);
+uint32_t I2CSVC_IsIdle(I2C_SVC_T *psSvc);
+void I2CSVC_GetStat(I2C_SVC_T *psSvc, I2C_SVC_STAT_T *psStat);
+void I2CSVC_IRQHandler(I2C_SVC_T *psSvc);
+
+/*! @}*/ /* end of group I2C_SVC_EXPORTED_FUNCTIONS */
+
+/*! @}*/ /* end of group I2C_SVC_Driver */
+
+/*! @}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__I2C_SVC_H__*/
@@ -0,0 +1,208 @@
+/**************************************************************************//**
+ * @file     sflash_svc.h
+ * @brief    QSPI serial flash service header file
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __SFLASH_SVC_H__
+#define __SFLASH_SVC_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup SFLASH_SVC_Driver QSPI Serial Flash Service
+  @{
+*/
+
+/** @addtogroup SFLASH_SVC_EXPORTED_CONSTANTS QSPI Serial Flash Service Exported Constants
+  @{
+*/
+
+#define SFLASH_SVC_OK               0L      /*!< Request completed \hideinitializer */
+#define SFLASH_SVC_PENDING          1L      /*!< Request queued or in progress \hideinitializer */
+#define SFLASH_SVC_ERR_PARAM        -1L     /*!< Invalid configuration or request \hideinitializer */
+#define SFLASH_SVC_ERR_NODEV        -2L     /*!< No supported flash device answered \hideinitializer */
+#define SFLASH_SVC_ERR_TIMEOUT      -3L     /*!< Flash stayed busy too long \hideinitializer */
+#define SFLASH_SVC_ERR_PROGRAM      -4L     /*!< SPI-NAND reported program failure \hideinitializer */
+#define SFLASH_SVC_ERR_ERASE        -5L     /*!< SPI-NAND reported erase failure \hideinitializer */
+#define SFLASH_SVC_ERR_ECC          -6L     /*!< At least one page had uncorrectable bit errors \hideinitializer */
+#define SFLASH_SVC_ERR_BUSY         -7L     /*!< Requests are still queued \hideinitializer */
+
+#define SFLASH_SVC_TYPE_NOR         1UL     /*!< SPI-NOR flash \hideinitializer */
+#define SFLASH_SVC_TYPE_NAND        2UL     /*!< SPI-NAND flash with on-die ECC \hideinitializer */
+
+#define SFLASH_SVC_OP_READ          0UL     /*!< Read u32Count pages \hideinitializer */
+#define SFLASH_SVC_OP_PROGRAM       1UL     /*!< Program u32Count erased pages \hideinitializer */
+#define SFLASH_SVC_OP_ERASE         2UL     /*!< Erase u32Count blocks \hideinitializer */
+
+#define SFLASH_SVC_CFG_NO_QUAD      0x01UL  /*!< IO2/IO3 are not wired to the flash; dual I/O is still used \hideinitializer */
+#define SFLASH_SVC_CFG_SINGLE       0x02UL  /*!< Use IO0/IO1 as plain MOSI/MISO only \hideinitializer */
+#define SFLASH_SVC_CFG_NOR_SMALL_ERASE  0x04UL  /*!< SPI-NOR: erase in the smallest unit, usually 4 KB, instead of 64 KB \hideinitializer */
+
+#define SFLASH_SVC_FLAG_CONT_READ   0x01UL  /*!< SPI-NAND continuous read across pages (Winbond BUF=0) \hideinitializer */
+#define SFLASH_SVC_FLAG_CACHE_READ  0x02UL  /*!< SPI-NAND sequential cache read (31h/3Fh) \hideinitializer */
+#define SFLASH_SVC_FLAG_QE          0x04UL  /*!< Quad enable bit must be set before quad transfers \hideinitializer */
+#define SFLASH_SVC_FLAG_PLANE       0x08UL  /*!< SPI-NAND with two planes, selected by column address bit 12 \hideinitializer */
+#define SFLASH_SVC_FLAG_SFDP        0x10UL  /*!< SPI-NOR configured from its SFDP basic parameter table \hideinitializer */
+
+#define SFLASH_SVC_DMA_MAX          0x40000UL   /*!< Largest data phase moved by one PDMA transfer, in bytes \hideinitializer */
+
+/*! @}*/ /* end of group SFLASH_SVC_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup SFLASH_SVC_EXPORTED_STRUCTS QSPI Serial Flash Service Exported Structs
+  @{
+*/
+
+struct SFLASH_SVC_REQ;
+
+/**
+ *  @brief  Completion callback, called once per request from the PDMA interrupt or from
+ *          \ref SFLASHSVC_Poll, whichever finishes the request.
+ */
+typedef void (*SFLASH_SVC_CB)(struct SFLASH_SVC_REQ *psReq);
+
+/**
+ *  @brief  Page, program or erase request.
+ *          Pages are numbered from 0 across the whole device. An erase names the first page of
+ *          its first block, which must be block aligned, and counts blocks. Data and spare
+ *          buffers must be 4-byte aligned; 64-byte alignment keeps cache maintenance from
+ *          touching neighbouring variables. The request is owned by the service from
+ *          \ref SFLASHSVC_Submit until i32Status leaves \ref SFLASH_SVC_PENDING.
+ */
+typedef struct SFLASH_SVC_REQ
+{
+    uint32_t                u32Op;          /*!< \ref SFLASH_SVC_OP_READ, \ref SFLASH_SVC_OP_PROGRAM or \ref SFLASH_SVC_OP_ERASE */
+    uint32_t                u32Page;        /*!< First page */
+    uint32_t                u32Count;       /*!< Pages to read or program, or blocks to erase */
+    uint8_t                 *pu8Data;       /*!< u32Count * u32PageSize bytes; only read from when programming */
+    uint8_t                 *pu8Spare;      /*!< SPI-NAND: u32Count * u32SpareSize bytes, or NULL to skip the spare area */
+    SFLASH_SVC_CB           pfnDone;        /*!< Completion callback, can be NULL */
+    void                    *pvArg;         /*!< User argument for pfnDone */
+    volatile int32_t        i32Status;      /*!< \ref SFLASH_SVC_PENDING, \ref SFLASH_SVC_OK or a negative error */
+    uint32_t                u32Done;        /*!< Pages or blocks finished. After a program or erase error, the failing one is u32Done. */
+    uint32_t                u32Corrected;   /*!< SPI-NAND: pages whose data was corrected by on-die ECC */
+    struct SFLASH_SVC_REQ   *psNext;        /*!< Queue link, owned by the service */
+} SFLASH_SVC_REQ_T;
+
+/**
+ *  @brief  Port configuration passed to SFLASHSVC_Open().
+ *          The QSPI and PDMA module clocks and the QSPI pins must already be set up.
+ */
+typedef struct
+{
+    QSPI_T      *qspi;              /*!< QSPI port */
+    uint32_t    u32BusClock;        /*!< SPI clock in Hz */
+    uint32_t    u32Flags;           /*!< \ref SFLASH_SVC_CFG_NO_QUAD, \ref SFLASH_SVC_CFG_SINGLE, \ref SFLASH_SVC_CFG_NOR_SMALL_ERASE */
+    PDMA_T      *pdma;              /*!< PDMA controller for the data phase */
+    IRQn_ID_t   eIrq;               /*!< Interrupt number of the PDMA controller */
+    uint32_t    u32TxCh;            /*!< PDMA channel for TX */
+    uint32_t    u32RxCh;            /*!< PDMA channel for RX */
+    uint32_t    u32TxReq;           /*!< PDMA request source for TX, e.g. \ref PDMA_QSPI0_TX */
+    uint32_t    u32RxReq;           /*!< PDMA request source for RX, e.g. \ref PDMA_QSPI0_RX */
+} SFLASH_SVC_CFG_T;
+
+/**
+ *  @brief  Device geometry and features found by SFLASHSVC_Open().
+ */
+typedef struct
+{
+    uint32_t    u32Type;            /*!< \ref SFLASH_SVC_TYPE_NOR or \ref SFLASH_SVC_TYPE_NAND */
+    uint32_t    u32JedecId;         /*!< Manufacturer ID in bits 23:16, device ID below */
+    uint32_t    u32PageSize;        /*!< Read and program unit in bytes */
+    uint32_t    u32SpareSize;       /*!< SPI-NAND spare bytes per page available to the user, 0 for SPI-NOR */
+    uint32_t    u32PagesPerBlock;   /*!< Pages per erase block */
+    uint32_t    u32Blocks;          /*!< Erase blocks */
+    uint32_t    u32BlockSize;       /*!< Erase block size in bytes */
+    uint32_t    u32ReadIo;          /*!< Data lines used to read: 1, 2 or 4 */
+    uint32_t    u32ProgIo;          /*!< Data lines used to program: 1 or 4 */
+    uint32_t    u32Flags;           /*!< SFLASH_SVC_FLAG_* features in use */
+} SFLASH_SVC_INFO_T;
+
+/**
+ *  @brief  Service statistics. All counters are free-running.
+ */
+typedef struct
+{
+    uint32_t    u32Requests;        /*!< Requests completed successfully */
+    uint32_t    u32Errors;          /*!< Requests completed with an error */
+    uint32_t    u32PagesRead;       /*!< Pages read */
+    uint32_t    u32PagesProgrammed; /*!< Pages programmed */
+    uint32_t    u32BlocksErased;    /*!< Blocks erased */
+    uint32_t    u32DmaXfers;        /*!< PDMA data phases */
+    uint32_t    u32EccCorrected;    /*!< SPI-NAND pages corrected by on-die ECC */
+    uint32_t    u32EccFailed;       /*!< SPI-NAND pages with uncorrectable errors */
+    uint32_t    u32Timeouts;        /*!< Busy time-outs */
+} SFLASH_SVC_STAT_T;
+
+/**
+ *  @brief  Service control block. Treat as opaque.
+ */
+typedef struct
+{
+    uint32_t            au32Desc[2][4] __attribute__((aligned(64)));   /*!< Data and spare descriptors of the data phase */
+    SFLASH_SVC_CFG_T    sCfg;
+    SFLASH_SVC_INFO_T   sInfo;
+    uint32_t            u32Ctl;         /*!< QSPI_CTL for command phases: 1-bit, 8-bit width */
+    uint8_t             u8ReadOp;       /*!< SPI-NOR read or SPI-NAND read-from-cache opcode */
+    uint8_t             u8ReadDummy;    /*!< Dummy clocks after the address, mode clocks included */
+    uint8_t             u8ProgOp;       /*!< SPI-NOR page program or SPI-NAND program load opcode */
+    uint8_t             u8EraseOp;      /*!< Block erase opcode */
+    uint8_t             u8AddrBytes;    /*!< SPI-NOR address bytes */
+    SFLASH_SVC_REQ_T    *psHead;        /*!< Request in progress, or NULL when idle */
+    SFLASH_SVC_REQ_T    *psTail;        /*!< Last queued request */
+    uint32_t            u32State;       /*!< Idle, data phase on PDMA, or flash busy */
+    uint32_t            u32Seq;         /*!< SPI-NAND read sequence: single page, cache read or continuous read */
+    uint32_t            u32Chunk;       /*!< Pages moved by the data phase in flight */
+    uint32_t            u32DmaDir;      /*!< Direction of the data phase in flight */
+    uint32_t            u32DmaIo;       /*!< Data lines of the data phase in flight */
+    uint8_t             *pu8DmaData;    /*!< Data buffer of the data phase in flight */
+    uint32_t            u32DmaDataLen;
+    uint8_t             *pu8DmaSpare;   /*!< Spare buffer of the data phase in flight, or NULL */
+    uint32_t            u32DmaSpareLen;
+    uint64_t            u64Deadline;    /*!< Generic timer count at which a busy flash has timed out */
+    int32_t             i32Err;         /*!< Deferred error of the request in progress */
+    SFLASH_SVC_STAT_T   sStat;
+} SFLASH_SVC_T;
+
+/*! @}*/ /* end of group SFLASH_SVC_EXPORTED_STRUCTS */
+
+
+/** @addtogroup SFLASH_SVC_EXPORTED_FUNCTIONS QSPI Serial Flash Service Exported Functions
+  @{
+*/
+
+int32_t SFLASHSVC_Open(SFLASH_SVC_T *psSvc, const SFLASH_SVC_CFG_T *psCfg);
+void SFLASHSVC_Close(SFLASH_SVC_T *psSvc);
+void SFLASHSVC_GetInfo(SFLASH_SVC_T *psSvc, SFLASH_SVC_INFO_T *psInfo);
+int32_t SFLASHSVC_Submit(SFLASH_SVC_T *psSvc, SFLASH_SVC_REQ_T *psReq);
+void SFLASHSVC_Poll(SFLASH_SVC_T *psSvc);
+uint32_t SFLASHSVC_IsIdle(SFLASH_SVC_T *psSvc);
+void SFLASHSVC_GetStat(SFLASH_SVC_T *psSvc, SFLASH_SVC_STAT_T *psStat);
+void SFLASHSVC_PDMA_IRQHandler(SFLASH_SVC_T *psSvc);
+int32_t SFLASHSVC_Read(SFLASH_SVC_T *psSvc, uint32_t u32Page, uint32_t u32Count, uint8_t *pu8Data, uint8_t *pu8Spare);
+int32_t SFLASHSVC_Program(SFLASH_SVC_T *psSvc, uint32_t u32Page, uint32_t u32Count, const uint8_t *pu8Data,
+                          const uint8_t *pu8Spare);
+int32_t SFLASHSVC_Erase(SFLASH_SVC_T *psSvc, uint32_t u32Block, uint32_t u32Count);
+int32_t SFLASHSVC_IsBadBlock(SFLASH_SVC_T *psSvc, uint32_t u32Block);
+int32_t SFLASHSVC_MarkBadBlock(SFLASH_SVC_T *psSvc, uint32_t u32Block);
+
+/*! @}*/ /* end of group SFLASH_SVC_EXPORTED_FUNCTIONS */
+
+/*! @}*/ /* end of group SFLASH_SVC_Driver */
+
+/*! @}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__SFLASH_SVC_H__*/
@@ -196,6 +196,7 @@ typedef struct tsi_cmd_t
 /*-------------------------------------------------------------------------------------------------*/
 void TSI_Print_Error(int code);
 int TSI_Init(void);
+void TSI_Set_Lock(void (*lock)(void), void (*unlock)(void));
 int TSI_Sync(void);
 int TSI_Get_Version(uint32_t *ver_code);
 int TSI_Reset(void);
@@ -0,0 +1,138 @@
+/**************************************************************************//**
+ * @file     uart_svc.h
+ * @brief    UART ring buffer service header file
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __UART_SVC_H__
+#define __UART_SVC_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup UART_SVC_Driver UART Ring Buffer Service
+  @{
+*/
+
+/** @addtogroup UART_SVC_EXPORTED_CONSTANTS UART Ring Buffer Service Exported Constants
+  @{
+*/
+
+#define UART_SVC_OK             0L      /*!< Operation succeeded \hideinitializer */
+#define UART_SVC_ERR_PARAM      -1L     /*!< Invalid parameter, e.g. buffer size not a power of two \hideinitializer */
+
+#define UART_SVC_EVT_RX         0x1UL   /*!< New data is available in the RX ring \hideinitializer */
+#define UART_SVC_EVT_TX         0x2UL   /*!< Space was freed in the TX ring \hideinitializer */
+#define UART_SVC_EVT_TX_DONE    0x4UL   /*!< TX ring ran empty and the last PDMA transfer completed \hideinitializer */
+#define UART_SVC_EVT_ERROR      0x8UL   /*!< Line error or overrun was recorded \hideinitializer */
+
+#define UART_SVC_TXCNT_MAX      0x10000UL   /*!< Largest single PDMA transfer (TXCNT is 16 bits) \hideinitializer */
+
+/*! @}*/ /* end of group UART_SVC_EXPORTED_CONSTANTS */
+
+
+/** @addtogroup UART_SVC_EXPORTED_STRUCTS UART Ring Buffer Service Exported Structs
+  @{
+*/
+
+/**
+ *  @brief  Event callback, called from interrupt context.
+ *          A FreeRTOS application typically calls vTaskNotifyGiveFromISR() or
+ *          xSemaphoreGiveFromISR() here and yields on exit of its IRQ handler.
+ */
+typedef void (*UART_SVC_CB)(void *pvArg, uint32_t u32Events);
+
+/**
+ *  @brief  Port configuration passed to UARTSVC_Open().
+ *          Both ring sizes must be powers of two. The RX ring size must be at
+ *          least 2 bytes and no larger than 2 * UART_SVC_TXCNT_MAX because it
+ *          is filled as two PDMA scatter-gather halves. The buffers are
+ *          accessed through their non-cacheable alias and should be 64-byte
+ *          aligned with a size that is a multiple of 64 bytes.
+ */
+typedef struct
+{
+    UART_T      *uart;              /*!< UART port */
+    PDMA_T      *pdma;              /*!< PDMA controller serving this port */
+    uint32_t    u32TxCh;            /*!< PDMA channel for TX */
+    uint32_t    u32RxCh;            /*!< PDMA channel for RX */
+    uint32_t    u32TxReq;           /*!< PDMA request source for TX, e.g. \ref PDMA_UART1_TX */
+    uint32_t    u32RxReq;           /*!< PDMA request source for RX, e.g. \ref PDMA_UART1_RX */
+    uint8_t     *pu8TxBuf;          /*!< TX ring storage */
+    uint32_t    u32TxSize;          /*!< TX ring size in bytes */
+    uint8_t     *pu8RxBuf;          /*!< RX ring storage */
+    uint32_t    u32RxSize;          /*!< RX ring size in bytes */
+    uint32_t    u32RxTimeout;       /*!< RX idle time-out in bit times, see \ref UART_SetTimeoutCnt */
+    UART_SVC_CB pfnEvent;           /*!< Event callback, can be NULL */
+    void        *pvArg;             /*!< Argument passed to pfnEvent */
+} UART_SVC_CFG_T;
+
+/**
+ *  @brief  Port statistics. All counters are free-running.
+ */
+typedef struct
+{
+    uint32_t    u32RxBytes;         /*!< Bytes handed to the reader */
+    uint32_t    u32TxBytes;         /*!< Bytes moved to the UART by PDMA */
+    uint32_t    u32RxOverrun;       /*!< Bytes lost because the reader fell a full ring behind */
+    uint32_t    u32FifoOverrun;     /*!< UART RX FIFO overflow events */
+    uint32_t    u32LineErrors;      /*!< Break, framing and parity errors */
+    uint32_t    u32RxTimeouts;      /*!< Partial blocks flushed by RX time-out */
+    uint32_t    u32TxDropped;       /*!< Bytes refused by UARTSVC_Write() because the TX ring was full */
+} UART_SVC_STAT_T;
+
+/**
+ *  @brief  Port control block. Treat as opaque.
+ */
+typedef struct
+{
+    uint32_t            au32RxDesc[2][8] __attribute__((aligned(64)));  /*!< Looping RX scatter-gather descriptors, one per half. Owns its cache line. */
+    UART_SVC_CFG_T      sCfg;
+    uint8_t             *pu8TxRing;         /*!< Non-cacheable view of pu8TxBuf */
+    uint8_t             *pu8RxRing;         /*!< Non-cacheable view of pu8RxBuf */
+    uint32_t            u32RxHalf;          /*!< Bytes per RX half */
+    volatile uint32_t   u32RxDone;          /*!< RX halves completed by PDMA */
+    volatile uint32_t   u32RxHead;          /*!< Bytes written by PDMA, free-running */
+    uint32_t            u32RxTail;          /*!< Bytes consumed by the reader, free-running */
+    volatile uint32_t   u32TxHead;          /*!< Bytes queued by the writer, free-running */
+    volatile uint32_t   u32TxTail;          /*!< Bytes sent by PDMA, free-running */
+    volatile uint32_t   u32TxBusy;          /*!< Length of the PDMA TX transfer in flight, 0 if idle */
+    UART_SVC_STAT_T     sStat;
+} UART_SVC_T;
+
+/*! @}*/ /* end of group UART_SVC_EXPORTED_STRUCTS */
+
+
+/** @addtogroup UART_SVC_EXPORTED_FUNCTIONS UART Ring Buffer Service Exported Functions
+  @{
+*/
+
+int32_t UARTSVC_Open(UART_SVC_T *psSvc, const UART_SVC_CFG_T *psCfg);
+void UARTSVC_Close(UART_SVC_T *psSvc);
+uint32_t UARTSVC_Read(UART_SVC_T *psSvc, uint8_t *pu8Buf, uint32_t u32Len);
+uint32_t UARTSVC_Write(UART_SVC_T *psSvc, const uint8_t *pu8Buf, uint32_t u32Len);
+uint32_t UARTSVC_RxAvailable(UART_SVC_T *psSvc);
+uint32_t UARTSVC_TxFree(UART_SVC_T *psSvc);
+void UARTSVC_GetStat(UART_SVC_T *psSvc, UART_SVC_STAT_T *psStat);
+void UARTSVC_UART_IRQHandler(UART_SVC_T *psSvc);
+void UARTSVC_PDMA_IRQHandler(UART_SVC_T *psSvc);
+
+/*! @}*/ /* end of group UART_SVC_EXPORTED_FUNCTIONS */
+
+/*! @}*/ /* end of group UART_SVC_Driver */
+
+/*! @}*/ /* end of group Standard_Driver */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__UART_SVC_H__*/
@@ -774,6 +774,10 @@ void CANFD_Open(CANFD_T *psCanfd, CANFD_FD_T *psCanfdStr)
     if (psCanfdStr->sElemSize.u32TxBuf != 0)
         CANFD_InitTxDBuf(psCanfd, &psCanfdStr->sMRamStartAddr, &psCanfdStr->sElemSize, eCANFD_BYTE64);
 
+    /*Configures the Tx FIFO/Queue behind the dedicated Tx buffers */
+    if ((psCanfdStr->sElemSize.u32TxBuf != 0) && (psCanfdStr->sTxConfig.u32ElemCnt != 0))
+        CANFD_InitTxFifoQueue(psCanfd, &psCanfdStr->sElemSize, psCanfdStr->sTxConfig.eModeSel, psCanfdStr->sTxConfig.u32DBufNumber, psCanfdStr->sTxConfig.u32ElemCnt);
+
     /*Configures the Rx Buffer element */
     if (psCanfdStr->sElemSize.u32RxBuf != 0)
         CANFD_InitRxDBuf(psCanfd, &psCanfdStr->sMRamStartAddr, &psCanfdStr->sElemSize, eCANFD_BYTE64);
@@ -998,6 +1002,78 @@ void CANFD_DisableInt(CANFD_T *psCanfd, uint32_t u32IntLine0, uint32_t u32IntLin
 }
 
 
+/**
+ * @brief       Encodes a message into a Tx buffer element of the Message RAM.
+ *
+ * @param[in]   psTxMsg        Pointer to CAN FD message frame to be sent.
+ * @param[in]   psTxBuffer     Tx buffer element in the Message RAM.
+ *
+ * @details     The identifier and configuration words are built locally and
+ *              written once each, since the Message RAM is device memory.
+ */
+static void CANFD_CopyMsgToTxBuf(CANFD_FD_MSG_T *psTxMsg, CANFD_BUF_T *psTxBuffer)
+{
+    uint32_t u32Id, u32Config, u32Idx;
+
+    if (psTxMsg->eIdType == eCANFD_XID)
+    {
+        u32Id = TX_BUFFER_T0_ELEM_XTD_Msk | (psTxMsg->u32Id & 0x1FFFFFFF);
+    }
+    else
+    {
+        u32Id = (psTxMsg->u32Id & 0x7FF) << 18;
+    }
+
+    if (psTxMsg->eFrmType == eCANFD_REMOTE_FRM) u32Id |= TX_BUFFER_T0_ELEM_RTR_Msk;
+
+    u32Config = (CANFD_EncodeDLC(psTxMsg->u32DLC) << 16);
+
+    if (psTxMsg->bFDFormat) u32Config |= TX_BUFFER_T1_ELEM_FDF_Msk;
+
+    if (psTxMsg->bBitRateSwitch) u32Config |= TX_BUFFER_T1_ELEM_BSR_Msk;
+
+    psTxBuffer->u32Id = u32Id;
+    psTxBuffer->u32Config = u32Config;
+
+    for (u32Idx = 0; u32Idx < (psTxMsg->u32DLC + (4 - 1)) / 4; u32Idx++)
+    {
+        psTxBuffer->au32Data[u32Idx] = psTxMsg->au32Data[u32Idx];
+    }
+}
+
+
+/**
+ * @brief       Wait for the CAN bus to be idle before a transmission request.
+ *
+ * @param[in]   psCanfd        The pointer of the specified CAN FD module.
+ *
+ * @return      1  Transmission request may be issued.
+ *              0  Timeout.
+ *
+ * @details     Only the first silicon revision requires the controller to be
+ *              idle when TXBAR is written; other revisions return at once.
+ */
+static uint32_t CANFD_WaitTxIdle(CANFD_T *psCanfd)
+{
+    uint32_t u32TimeOutCount = SystemCoreClock/100; // 1 ms timeout
+
+    if((inpw(ptr_to_u32(SYS_BASE + 0x1F0)) & (0xf000000)) == 0x0)
+    {
+        /* Wait for CAN communication status to be idle */
+        while(CANFD_GET_COMMUNICATION_STATE(psCanfd) != eCANFD_IDLE)
+        {
+            if (u32TimeOutCount == 0)
+            {
+                return 0;
+            }
+            u32TimeOutCount--;
+        }
+    }
+
+    return 1;
+}
+
+
 /**
  * @brief       Copy Tx Message to  TX buffer and Request transmission.
  *
@@ -1043,8 +1119,7 @@ uint32_t CANFD_TransmitTxMsg(CANFD_T *psCanfd, uint32_t u32TxBufIdx, CANFD_FD_MS
 uint32_t CANFD_TransmitDMsg(CANFD_T *psCanfd, uint32_t u32TxBufIdx, CANFD_FD_MSG_T *psTxMsg)
 {
     CANFD_BUF_T *psTxBuffer;
-    uint32_t u32TimeOutCount = SystemCoreClock/100; // 1 ms timeout
-    uint32_t u32Idx = 0, u32Success = 1;
+    uint32_t u32Success = 1;
 
     if (u32TxBufIdx >= CANFD_MAX_TX_BUF_ELEMS) return 0;
 
@@ -1053,40 +1128,10 @@ uint32_t CANFD_TransmitDMsg(CANFD_T *psCanfd, uint32_t u32TxBufIdx, CANFD_FD_MSG
 
     psTxBuffer = (CANFD_BUF_T *)(ptr_to_u32(psCanfd) + (uint32_t)CANFD_SRAM_BASE_ADDR + (psCanfd->TXBC & 0xFFFF) + (u32TxBufIdx * sizeof(CANFD_BUF_T)));
 
-    if (psTxMsg->eIdType == eCANFD_XID)
-    {
-        psTxBuffer->u32Id = TX_BUFFER_T0_ELEM_XTD_Msk | (psTxMsg->u32Id & 0x1FFFFFFF);
-    }
-    else
-    {
-        psTxBuffer->u32Id = (psTxMsg->u32Id & 0x7FF) << 18;
-    }
-
-    if (psTxMsg->eFrmType == eCANFD_REMOTE_FRM) psTxBuffer->u32Id |= TX_BUFFER_T0_ELEM_RTR_Msk;
-
-    psTxBuffer->u32Config = (CANFD_EncodeDLC(psTxMsg->u32DLC) << 16);
-
-    if (psTxMsg->bFDFormat) psTxBuffer->u32Config |= TX_BUFFER_T1_ELEM_FDF_Msk;
-
-    if (psTxMsg->bBitRateSwitch) psTxBuffer->u32Config |= TX_BUFFER_T1_ELEM_BSR_Msk;
-
-    for (u32Idx = 0; u32Idx < (psTxMsg->u32DLC + (4 - 1)) / 4; u32Idx++)
-    {
-        psTxBuffer->au32Data[u32Idx] = psTxMsg->au32Data[u32Idx];
-    }
+    CANFD_CopyMsgToTxBuf(psTxMsg, psTxBuffer);
 
-    if((inpw(ptr_to_u32(SYS_BASE + 0x1F0)) & (0xf000000)) == 0x0)
-    {
-        /* Wait for CAN communication status to be idle */
-        while(CANFD_GET_COMMUNICATION_STATE(psCanfd) != eCANFD_IDLE)
-        {
-            if (u32TimeOutCount == 0)
-            {
-                return 0;
-            }
-            u32TimeOutCount--;
-        }
-    }
+    if (CANFD_WaitTxIdle(psCanfd) == 0)
+        return 0;
 
     psCanfd->TXBAR = (1 << u32TxBufIdx);
 
@@ -1865,6 +1910,761 @@ void CANFD_RunToNormal(CANFD_T *psCanfd, uint8_t u8Enable)
     }
 }
 
+/**
+ * @brief       Configures the Tx FIFO/Queue section of the Tx buffers.
+ *
+ * @param[in]   psCanfd         The pointer of the specified CAN FD module.
+ * @param[in]   psElemSize      Message RAM partition, the same one passed to CANFD_InitTxDBuf().
+ * @param[in]   eMode           eCANFD_FIFO_MODE or eCANFD_QUEUE_MODE.
+ * @param[in]   u32DBufNum      Number of dedicated Tx buffers.
+ * @param[in]   u32ElemCnt      Number of Tx FIFO/Queue elements.
+ *
+ * @return      1 Tx FIFO/Queue configured.
+ *              0 Not in configuration mode, or the elements do not fit in the partition.
+ *
+ * @details     Must be called with CCCR.INIT and CCCR.CCE set, e.g. between
+ *              CANFD_InitTxDBuf() and CANFD_RunToNormal() as CANFD_Open() does.
+ *              The Tx FIFO/Queue elements follow the dedicated Tx buffers in the
+ *              Message RAM, so u32DBufNum + u32ElemCnt must not exceed the number
+ *              of Tx buffer elements (psElemSize->u32TxBuf) the RAM was partitioned
+ *              for; more would overlap the sections placed after the Tx buffers.
+ */
+uint32_t CANFD_InitTxFifoQueue(CANFD_T *psCanfd, CANFD_ELEM_SIZE_T *psElemSize, E_CANFD_MODE eMode, uint32_t u32DBufNum, uint32_t u32ElemCnt)
+{
+    if ((psCanfd->CCCR & (CANFD_CCCR_CCE_Msk | CANFD_CCCR_INIT_Msk)) != (CANFD_CCCR_CCE_Msk | CANFD_CCCR_INIT_Msk)) return 0;
+
+    if ((u32DBufNum + u32ElemCnt) > psElemSize->u32TxBuf) return 0;
+
+    if ((u32DBufNum + u32ElemCnt) > CANFD_MAX_TX_BUF_ELEMS) return 0;
+
+    psCanfd->TXBC = (psCanfd->TXBC & CANFD_TXBC_TBSA_Msk)
+                    | ((u32DBufNum << CANFD_TXBC_NDTB_Pos) & CANFD_TXBC_NDTB_Msk)
+                    | ((u32ElemCnt << CANFD_TXBC_TFQS_Pos) & CANFD_TXBC_TFQS_Msk)
+                    | ((eMode == eCANFD_QUEUE_MODE) ? CANFD_TXBC_TFQM_Msk : 0);
+
+    return 1;
+}
+
+
+/**
+ * @brief       Initializes a software message ring.
+ *
+ * @param[in]   psRing      Ring control structure.
+ * @param[in]   psBuf       Storage of u32Size messages.
+ * @param[in]   u32Size     Number of messages, must be a power of two.
+ *
+ * @details     The ring is lock-free for one producer and one consumer, for
+ *              example the CAN FD interrupt handler and a task.
+ */
+void CANFD_RingInit(CANFD_MSG_RING_T *psRing, CANFD_FD_MSG_T *psBuf, uint32_t u32Size)
+{
+    psRing->psBuf = psBuf;
+    psRing->u32Mask = u32Size - 1;
+    psRing->u32Head = 0;
+    psRing->u32Tail = 0;
+    psRing->u32Overrun = 0;
+    psRing->u32HwLost = 0;
+}
+
+
+/**
+ * @brief       Puts a message into a software message ring.
+ *
+ * @param[in]   psRing      Ring control structure.
+ * @param[in]   psMsg       Message to be copied into the ring.
+ *
+ * @return      1 Success.
+ *              0 Ring is full. The overrun counter is incremented.
+ */
+uint32_t CANFD_RingPut(CANFD_MSG_RING_T *psRing, CANFD_FD_MSG_T *psMsg)
+{
+    uint32_t u32Head = psRing->u32Head;
+
+    if ((u32Head - psRing->u32Tail) > psRing->u32Mask)
+    {
+        psRing->u32Overrun++;
+        return 0;
+    }
+
+    psRing->psBuf[u32Head & psRing->u32Mask] = *psMsg;
+    /* Publish the slot only after its content is visible */
+    __DMB();
+    psRing->u32Head = u32Head + 1;
+    return 1;
+}
+
+
+/**
+ * @brief       Gets a message from a software message ring.
+ *
+ * @param[in]   psRing      Ring control structure.
+ * @param[out]  psMsg       Location to store the message.
+ *
+ * @return      1 Success.
+ *              0 Ring is empty.
+ */
+uint32_t CANFD_RingGet(CANFD_MSG_RING_T *psRing, CANFD_FD_MSG_T *psMsg)
+{
+    uint32_t u32Tail = psRing->u32Tail;
+
+    if (u32Tail == psRing->u32Head)
+        return 0;
+
+    __DMB();
+    *psMsg = psRing->psBuf[u32Tail & psRing->u32Mask];
+    __DMB();
+    psRing->u32Tail = u32Tail + 1;
+    return 1;
+}
+
+
+/**
+ * @brief       Number of messages waiting in a software message ring.
+ *
+ * @param[in]   psRing      Ring control structure.
+ *
+ * @return      Number of messages.
+ */
+uint32_t CANFD_RingCount(CANFD_MSG_RING_T *psRing)
+{
+    return psRing->u32Head - psRing->u32Tail;
+}
+
+
+/**
+ * @brief       Converts an Rx FIFO element into a message structure.
+ *
+ * @param[in]   psRxBuf         Rx FIFO element in the Message RAM.
+ * @param[in]   psMsgBuf        Location to store read message.
+ *
+ * @details     Same result as CANFD_CopyDBufToMsgBuf(), but the header words are read
+ *              once and the payload is copied in words.
+ */
+static void CANFD_FetchRxElem(CANFD_BUF_T *psRxBuf, CANFD_FD_MSG_T *psMsgBuf)
+{
+    uint32_t u32Id = psRxBuf->u32Id;
+    uint32_t u32Config = psRxBuf->u32Config;
+    uint32_t u32Idx, u32Words;
+
+    psMsgBuf->bErrStaInd = (u32Id & RX_BUFFER_AND_FIFO_R0_ELEM_ESI_Msk) ? TRUE : FALSE;
+
+    if (u32Id & RX_BUFFER_AND_FIFO_R0_ELEM_XTD_Msk)
+    {
+        psMsgBuf->u32Id = (u32Id & RX_BUFFER_AND_FIFO_R0_ELEM_ID_Msk);
+        psMsgBuf->eIdType = eCANFD_XID;
+    }
+    else
+    {
+        psMsgBuf->u32Id = (u32Id >> 18) & 0x7FF;
+        psMsgBuf->eIdType = eCANFD_SID;
+    }
+
+    psMsgBuf->eFrmType = (u32Id & RX_BUFFER_AND_FIFO_R0_ELEM_RTR_Msk) ? eCANFD_REMOTE_FRM : eCANFD_DATA_FRM;
+    psMsgBuf->bFDFormat = (u32Config & RX_BUFFER_AND_FIFO_R1_ELEM_FDF_Msk) ? TRUE : FALSE;
+    psMsgBuf->bBitRateSwitch = (u32Config & RX_BUFFER_AND_FIFO_R1_ELEM_BSR_Msk) ? TRUE : FALSE;
+    psMsgBuf->u32DLC = CANFD_DecodeDLC((u32Config & RX_BUFFER_AND_FIFO_R1_ELEM_DLC_Msk) >> RX_BUFFER_AND_FIFO_R1_ELEM_DLC_Pos);
+
+    u32Words = (psMsgBuf->u32DLC + (4 - 1)) / 4;
+
+    for (u32Idx = 0; u32Idx < u32Words; u32Idx++)
+    {
+        psMsgBuf->au32Data[u32Idx] = psRxBuf->au32Data[u32Idx];
+    }
+}
+
+
+/**
+ * @brief       Drains Rx FIFO elements into a message array or ring storage.
+ *
+ * @param[in]   psCanfd     The pointer of the specified CAN FD module.
+ * @param[in]   u8FifoIdx   Number of the FIFO, 0 or 1.
+ * @param[in]   psDst       Destination message storage.
+ * @param[in]   u32Start    First destination slot.
+ * @param[in]   u32Mask     Destination slot mask (ring size - 1), 0xFFFFFFFF for a flat array.
+ * @param[in]   u32MaxCnt   Maximum number of messages to read.
+ * @param[out]  pu32Lost    Set to 1 if the hardware FIFO reported message lost.
+ *
+ * @return      Number of messages read.
+ *
+ * @details     RXFS is read once; all elements up to the fill level are copied and
+ *              only the last get index is acknowledged.
+ */
+static uint32_t CANFD_DrainRxFifo(CANFD_T *psCanfd, uint8_t u8FifoIdx, CANFD_FD_MSG_T *psDst,
+                                  uint32_t u32Start, uint32_t u32Mask, uint32_t u32MaxCnt, uint32_t *pu32Lost)
+{
+    __I  uint32_t *pRXFS;
+    __IO uint32_t *pRXFC, *pRXFA;
+    uint64_t u64Base;
+    uint32_t u32Status, u32Fill, u32GetIdx, u32FifoSize, u32Cnt;
+    uint32_t u32LostIR;
+
+    *pu32Lost = 0;
+
+    if (u8FifoIdx >= CANFD_NUM_RX_FIFOS) return 0;
+
+    if (u8FifoIdx == 0)
+    {
+        pRXFS = &(psCanfd->RXF0S);
+        pRXFC = &(psCanfd->RXF0C);
+        pRXFA = &(psCanfd->RXF0A);
+        u32LostIR = CANFD_IR_RF0L_Msk;
+    }
+    else
+    {
+        pRXFS = &(psCanfd->RXF1S);
+        pRXFC = &(psCanfd->RXF1C);
+        pRXFA = &(psCanfd->RXF1A);
+        u32LostIR = CANFD_IR_RF1L_Msk;
+    }
+
+    u32Status = CANFD_ReadReg(ptr_to_u32(&(*pRXFS)));
+    u32Fill = u32Status & CANFD_RXF0S_F0FL_Msk;
+
+    if (u32Fill == 0) return 0;
+
+    if (u32Fill > u32MaxCnt) u32Fill = u32MaxCnt;
+
+    u32GetIdx = (u32Status & CANFD_RXF0S_F0GI_Msk) >> CANFD_RXF0S_F0GI_Pos;
+    u32FifoSize = (*pRXFC & CANFD_RXF0C_F0S_Msk) >> CANFD_RXF0C_F0S_Pos;
+    u64Base = (uint64_t)psCanfd + (uint32_t)CANFD_SRAM_BASE_ADDR + (*pRXFC & 0xFFFF);
+
+    for (u32Cnt = 0; u32Cnt < u32Fill; u32Cnt++)
+    {
+        CANFD_FetchRxElem((CANFD_BUF_T *)(u64Base + u32GetIdx * sizeof(CANFD_BUF_T)),
+                          &psDst[(u32Start + u32Cnt) & u32Mask]);
+
+        if (u32Cnt + 1 < u32Fill)
+        {
+            if (++u32GetIdx >= u32FifoSize) u32GetIdx = 0;
+        }
+    }
+
+    /* One acknowledge releases every element up to and including this index */
+    *pRXFA = u32GetIdx;
+
+    if (u32Status & CANFD_RXFS_RFL)
+    {
+        psCanfd->IR = u32LostIR;
+        *pu32Lost = 1;
+    }
+
+    return u32Fill;
+}
+
+
+/**
+ * @brief       Reads all pending CAN FD Messages from an Rx FIFO in one pass.
+ *
+ * @param[in]   psCanfd     The pointer of the specified CAN FD module.
+ * @param[in]   u8FifoIdx   Number of the FIFO, 0 or 1.
+ * @param[out]  psMsgBuf    Array of message frame structures for reception.
+ * @param[in]   u32MaxCnt   Number of elements in psMsgBuf.
+ *
+ * @return      Number of messages read.
+ *
+ * @details     Unlike CANFD_ReadRxFifoMsg(), the FIFO status is read once and the
+ *              FIFO is acknowledged once for the whole batch.
+ */
+uint32_t CANFD_ReadRxFifoMsgs(CANFD_T *psCanfd, uint8_t u8FifoIdx, CANFD_FD_MSG_T *psMsgBuf, uint32_t u32MaxCnt)
+{
+    uint32_t u32Lost;
+
+    return CANFD_DrainRxFifo(psCanfd, u8FifoIdx, psMsgBuf, 0, 0xFFFFFFFFul, u32MaxCnt, &u32Lost);
+}
+
+
+/**
+ * @brief       Drains an Rx FIFO into a software message ring.
+ *
+ * @param[in]   psCanfd     The pointer of the specified CAN FD module.
+ * @param[in]   u8FifoIdx   Number of the FIFO, 0 or 1.
+ * @param[in]   psRing      Software message ring, filled as producer.
+ *
+ * @return      Number of messages moved into the ring.
+ *
+ * @details     Intended to be called from the Rx FIFO new message/watermark interrupt.
+ *              Elements are decoded straight into the ring slots. When the ring has no
+ *              room, messages stay in the hardware FIFO and the overrun counter counts
+ *              the call. Hardware message lost events are counted in u32HwLost.
+ */
+uint32_t CANFD_DrainRxFifoToRing(CANFD_T *psCanfd, uint8_t u8FifoIdx, CANFD_MSG_RING_T *psRing)
+{
+    uint32_t u32Head = psRing->u32Head;
+    uint32_t u32Free = psRing->u32Mask + 1 - (u32Head - psRing->u32Tail);
+    uint32_t u32Cnt, u32Lost;
+
+    if (u32Free == 0)
+    {
+        psRing->u32Overrun++;
+        return 0;
+    }
+
+    u32Cnt = CANFD_DrainRxFifo(psCanfd, u8FifoIdx, psRing->psBuf, u32Head, psRing->u32Mask, u32Free, &u32Lost);
+    psRing->u32HwLost += u32Lost;
+
+    if (u32Cnt)
+    {
+        __DMB();
+        psRing->u32Head = u32Head + u32Cnt;
+    }
+
+    return u32Cnt;
+}
+
+
+/**
+ * @brief       Moves messages from a software Tx ring into the hardware Tx FIFO/Queue.
+ *
+ * @param[in]   psCanfd     The pointer of the specified CAN FD module.
+ * @param[in]   psRing      Software message ring, drained as consumer.
+ *
+ * @return      Number of messages handed over to the hardware.
+ *
+ * @details     Call from the Transmission Completed / Tx FIFO Empty interrupt. The Tx
+ *              FIFO/Queue must have been set up by CANFD_InitTxFifoQueue(). All elements
+ *              written in one call are requested with a single TXBAR write.
+ *              In FIFO mode the elements are filled in order from the put index, up to
+ *              the free level. In Queue mode the put index only names the first free
+ *              buffer, so every Queue buffer without a pending request (TXBRP) is used.
+ *              Messages leave the software ring only once TXBAR has been written; if the
+ *              bus does not go idle in time they stay queued and 0 is returned.
+ */
+uint32_t CANFD_TxRingRefill(CANFD_T *psCanfd, CANFD_MSG_RING_T *psRing)
+{
+    uint64_t u64Base;
+    uint32_t u32Tail = psRing->u32Tail;
+    uint32_t u32Status, u32PutIdx, u32FifoStart, u32FifoEnd, u32Free, u32Req = 0, u32Cnt = 0;
+
+    u32FifoStart = (psCanfd->TXBC & CANFD_TXBC_NDTB_Msk) >> CANFD_TXBC_NDTB_Pos;
+    u32FifoEnd = u32FifoStart + ((psCanfd->TXBC & CANFD_TXBC_TFQS_Msk) >> CANFD_TXBC_TFQS_Pos);
+    if (u32FifoEnd == u32FifoStart) return 0;
+
+    u64Base = (uint64_t)psCanfd + (uint32_t)CANFD_SRAM_BASE_ADDR + (psCanfd->TXBC & 0xFFFF);
+    u32Status = CANFD_ReadReg(ptr_to_u32(&psCanfd->TXFQS));
+    if (u32Status & CANFD_TXFQS_TFQF_Msk) return 0;
+
+    u32PutIdx = (u32Status & CANFD_TXFQS_TFQP_Msk) >> CANFD_TXFQS_TFQP_Pos;
+
+    if (psCanfd->TXBC & CANFD_TXBC_TFQM_Msk)
+    {
+        /* Queue: buffers are freed in any order, use each one not pending */
+        u32Free = ~CANFD_ReadReg(ptr_to_u32(&psCanfd->TXBRP));
+        u32Free &= (uint32_t)(((uint64_t)1 << u32FifoEnd) - ((uint64_t)1 << u32FifoStart));
+    }
+    else
+    {
+        /* FIFO: the free elements run in order from the put index */
+        u32Free = (u32Status & CANFD_TXFQS_TFFL_Msk) >> CANFD_TXFQS_TFFL_Pos;
+    }
+
+    while ((u32Tail != psRing->u32Head) && u32Free)
+    {
+        if (psCanfd->TXBC & CANFD_TXBC_TFQM_Msk)
+        {
+            u32PutIdx = (uint32_t)__builtin_ctz(u32Free);
+            u32Free &= u32Free - 1;
+        }
+        else
+        {
+            u32Free--;
+        }
+
+        __DMB();
+        CANFD_CopyMsgToTxBuf(&psRing->psBuf[u32Tail & psRing->u32Mask],
+                             (CANFD_BUF_T *)(u64Base + u32PutIdx * sizeof(CANFD_BUF_T)));
+        u32Req |= (1UL << u32PutIdx);
+        u32Tail++;
+        u32Cnt++;
+
+        /* The hardware put index only advances when TXBAR is written */
+        if (++u32PutIdx >= u32FifoEnd) u32PutIdx = u32FifoStart;
+    }
+
+    if (u32Req == 0)
+        return 0;
+
+    /* Nothing was requested; the elements written are overwritten by the next call */
+    if (CANFD_WaitTxIdle(psCanfd) == 0)
+        return 0;
+
+    psCanfd->TXBAR = u32Req;
+
+    __DMB();
+    psRing->u32Tail = u32Tail;
+
+    return u32Cnt;
+}
+
+
+/**
+ * @brief       Queues a message for transmission through the Tx FIFO/Queue.
+ *
+ * @param[in]   psCanfd     The pointer of the specified CAN FD module.
+ * @param[in]   psRing      Software Tx ring.
+ * @param[in]   psTxMsg     Message to be sent.
+ *
+ * @return      1 Message queued.
+ *              0 Software ring is full.
+ *
+ * @details     The message is always queued in the software ring, then the hardware
+ *              is refilled with the CAN FD interrupt lines masked so that this call
+ *              and the interrupt handler never write the Tx FIFO at the same time.
+ *              Enable CANFD_IE_TCE_Msk and call CANFD_TxRingRefill() from the
+ *              interrupt handler to keep the hardware fed.
+ */
+uint32_t CANFD_TxRingSend(CANFD_T *psCanfd, CANFD_MSG_RING_T *psRing, CANFD_FD_MSG_T *psTxMsg)
+{
+    uint32_t u32ILE;
+
+    if (CANFD_RingPut(psRing, psTxMsg) == 0)
+        return 0;
+
+    u32ILE = psCanfd->ILE;
+    psCanfd->ILE = 0;
+    CANFD_TxRingRefill(psCanfd, psRing);
+    psCanfd->ILE = u32ILE;
+
+    return 1;
+}
+
+/// @cond HIDDEN_SYMBOLS
+/* ID span used while compiling filters */
+typedef struct
+{
+    uint32_t u32Lo;    /* Lower ID, or cube value */
+    uint32_t u32Hi;    /* Upper ID, or cube don't-care bits */
+} CANFD_FLTR_SPAN_T;
+
+/* Compiler work area, kept out of CANFD_FLTR_LIST_T so the list stays small */
+static CANFD_FLTR_SPAN_T s_asFltrWork[CANFD_FLTR_MAX_RULES];
+
+/**
+ * @brief       Appends one filter element to a compiled filter list.
+ *
+ * @details     The element is only stored while it fits in the list; the count keeps
+ *              running so the caller learns how many elements would be required.
+ */
+static void CANFD_FltrEmit(CANFD_FLTR_LIST_T *psList, E_CANFD_ID_TYPE eIdType, uint32_t u32Type,
+                           uint32_t u32Config, uint32_t u32Id1, uint32_t u32Id2)
+{
+    if (eIdType == eCANFD_SID)
+    {
+        if (psList->u32StdCnt < CANFD_MAX_11_BIT_FTR_ELEMS)
+        {
+            psList->au32Std[psList->u32StdCnt] = (u32Type << 30) | (u32Config << 27)
+                                                 | ((u32Id1 & 0x7FF) << 16) | (u32Id2 & 0x7FF);
+        }
+
+        psList->u32StdCnt++;
+    }
+    else
+    {
+        if (psList->u32ExtCnt < CANFD_MAX_29_BIT_FTR_ELEMS)
+        {
+            psList->au32Ext[psList->u32ExtCnt][0] = (u32Config << 29) | (u32Id1 & 0x1FFFFFFF);
+            psList->au32Ext[psList->u32ExtCnt][1] = (u32Type << 30) | (u32Id2 & 0x1FFFFFFF);
+        }
+
+        psList->u32ExtCnt++;
+    }
+}
+
+
+/**
+ * @brief       Sorts spans by lower bound (insertion sort, lists are short and mostly sorted).
+ */
+static void CANFD_FltrSortSpans(CANFD_FLTR_SPAN_T *psSpan, uint32_t u32Num)
+{
+    CANFD_FLTR_SPAN_T sTmp;
+    uint32_t i, j;
+
+    for (i = 1; i < u32Num; i++)
+    {
+        sTmp = psSpan[i];
+
+        for (j = i; (j > 0) && (psSpan[j - 1].u32Lo > sTmp.u32Lo); j--)
+            psSpan[j] = psSpan[j - 1];
+
+        psSpan[j] = sTmp;
+    }
+}
+
+
+/**
+ * @brief       Compiles the spans of one (ID type, target) group into filter elements.
+ *
+ * @details     Overlapping and adjacent spans are merged first. Spans covering more than
+ *              one ID become range elements; extended ranges use EFT = 11b so XIDAM does
+ *              not widen them. Single IDs are combined into classic
+ *              filter/mask elements where an exact power-of-two cube of IDs exists, and
+ *              the rest are paired into dual ID elements.
+ */
+static void CANFD_FltrCompileGroup(CANFD_FLTR_LIST_T *psList, E_CANFD_ID_TYPE eIdType,
+                                   uint32_t u32Config, CANFD_FLTR_SPAN_T *psSpan, uint32_t u32Num)
+{
+    uint32_t u32IdMsk = (eIdType == eCANFD_SID) ? 0x7FFul : 0x1FFFFFFFul;
+    uint32_t u32RangeType = (eIdType == eCANFD_SID) ? eCANFD_SID_FLTR_TYPE_RANGE : eCANFD_XID_FLTR_TYPE_RANGE_XIDAM_NOT_APP;
+    uint32_t i, j, u32Out, u32Singles, u32Diff, u32Merged;
+
+    if (u32Num == 0) return;
+
+    /* Merge overlapping or adjacent spans */
+    CANFD_FltrSortSpans(psSpan, u32Num);
+
+    for (i = 1, u32Out = 0; i < u32Num; i++)
+    {
+        if (psSpan[i].u32Lo <= psSpan[u32Out].u32Hi + 1)
+        {
+            if (psSpan[i].u32Hi > psSpan[u32Out].u32Hi)
+                psSpan[u32Out].u32Hi = psSpan[i].u32Hi;
+        }
+        else
+        {
+            psSpan[++u32Out] = psSpan[i];
+        }
+    }
+
+    u32Num = u32Out + 1;
+
+    /* Emit ranges, then compact single IDs to the front as (value, don't care) cubes */
+    for (i = 0, u32Singles = 0; i < u32Num; i++)
+    {
+        if (psSpan[i].u32Hi != psSpan[i].u32Lo)
+        {
+            CANFD_FltrEmit(psList, eIdType, u32RangeType, u32Config, psSpan[i].u32Lo, psSpan[i].u32Hi);
+        }
+        else
+        {
+            psSpan[u32Singles].u32Lo = psSpan[i].u32Lo;
+            psSpan[u32Singles].u32Hi = 0;
+            u32Singles++;
+        }
+    }
+
+    /*
+     *  Merge cubes with the same don't-care set that differ in exactly one
+     *  other bit. Merged cubes keep the lower value, the absorbed one is
+     *  marked by setting its don't-care word to all ones.
+     */
+    do
+    {
+        u32Merged = 0;
+
+        for (i = 0; i < u32Singles; i++)
+        {
+            if (psSpan[i].u32Hi == 0xFFFFFFFFul) continue;
+
+            for (j = i + 1; j < u32Singles; j++)
+            {
+                if ((psSpan[j].u32Hi != psSpan[i].u32Hi)) continue;
+
+                u32Diff = psSpan[i].u32Lo ^ psSpan[j].u32Lo;
+
+                if ((u32Diff != 0) && ((u32Diff & (u32Diff - 1)) == 0))
+                {
+                    psSpan[i].u32Lo &= ~u32Diff;
+                    psSpan[i].u32Hi |= u32Diff;
+                    psSpan[j].u32Hi = 0xFFFFFFFFul;
+                    u32Merged = 1;
+                    break;
+                }
+            }
+        }
+
+        for (i = 0, u32Out = 0; i < u32Singles; i++)
+        {
+            if (psSpan[i].u32Hi != 0xFFFFFFFFul)
+                psSpan[u32Out++] = psSpan[i];
+        }
+
+        u32Singles = u32Out;
+    }
+    while (u32Merged);
+
+    /* Cubes become classic elements, the remaining single IDs are paired */
+    for (i = 0, j = 0xFFFFFFFFul; i < u32Singles; i++)
+    {
+        if (psSpan[i].u32Hi != 0)
+        {
+            CANFD_FltrEmit(psList, eIdType, eCANFD_SID_FLTR_TYPE_CLASSIC, u32Config,
+                           psSpan[i].u32Lo, ~psSpan[i].u32Hi & u32IdMsk);
+        }
+        else if (j == 0xFFFFFFFFul)
+        {
+            j = psSpan[i].u32Lo;
+        }
+        else
+        {
+            CANFD_FltrEmit(psList, eIdType, eCANFD_SID_FLTR_TYPE_DUAL, u32Config, j, psSpan[i].u32Lo);
+            j = 0xFFFFFFFFul;
+        }
+    }
+
+    if (j != 0xFFFFFFFFul)
+        CANFD_FltrEmit(psList, eIdType, eCANFD_SID_FLTR_TYPE_DUAL, u32Config, j, j);
+}
+/// @endcond HIDDEN_SYMBOLS
+
+
+/**
+ * @brief       Compiles a list of acceptance rules into Message RAM filter elements.
+ *
+ * @param[in]   psRules      Rules. Each covers one ID (u32IdLow == u32IdHigh) or an ID range.
+ * @param[in]   u32NumRules  Number of rules (max. CANFD_FLTR_MAX_RULES).
+ * @param[out]  psList       Compiled standard and extended filter elements.
+ *
+ * @return      0                          Success.
+ *              CANFD_FLTR_ERR_PARAM       Invalid rule (range to an Rx buffer, ID out of range, too many rules).
+ *              CANFD_FLTR_ERR_NO_SPACE    More elements than the hardware supports. u32StdCnt and
+ *                                         u32ExtCnt still report the number required.
+ *
+ * @details     Rules are grouped by ID type and target. Rules of a group are merged into the
+ *              smallest set of range, classic filter/mask and dual ID elements that accept
+ *              exactly the same IDs. Because the filter stops at the first match, reject rules
+ *              are emitted first, followed by Rx buffer rules, then priority and FIFO rules.
+ *              Rules targeting an Rx buffer must name a single ID and are not merged.
+ *              Uses a static work area, so it is not reentrant; call it from one context.
+ */
+int32_t CANFD_CompileFilters(const CANFD_FLTR_RULE_T *psRules, uint32_t u32NumRules, CANFD_FLTR_LIST_T *psList)
+{
+    static const uint8_t au8Order[] =
+    {
+        eCANFD_FLTR_ELEM_REJ_ID, eCANFD_FLTR_ELEM_STO_RX_BUF_OR_DBG_MSG,
+        eCANFD_FLTR_ELEM_SET_PRI, eCANFD_FLTR_ELEM_SET_PRI_STO_FIFO0, eCANFD_FLTR_ELEM_SET_PRI_STO_FIFO1,
+        eCANFD_FLTR_ELEM_STO_FIFO0, eCANFD_FLTR_ELEM_STO_FIFO1
+    };
+    uint32_t u32Ord, u32Type, i, u32Num, u32IdMsk;
+    E_CANFD_ID_TYPE eIdType;
+
+    psList->u32StdCnt = 0;
+    psList->u32ExtCnt = 0;
+
+    if (u32NumRules > CANFD_FLTR_MAX_RULES) return CANFD_FLTR_ERR_PARAM;
+
+    for (i = 0; i < u32NumRules; i++)
+    {
+        u32IdMsk = (psRules[i].eIdType == eCANFD_SID) ? 0x7FFul : 0x1FFFFFFFul;
+
+        if ((psRules[i].u32IdHigh < psRules[i].u32IdLow) || (psRules[i].u32IdHigh > u32IdMsk))
+            return CANFD_FLTR_ERR_PARAM;
+
+        if ((psRules[i].eConfig == eCANFD_FLTR_ELEM_STO_RX_BUF_OR_DBG_MSG) &&
+                ((psRules[i].u32IdHigh != psRules[i].u32IdLow) || (psRules[i].u32RxBufIdx >= CANFD_MAX_RX_BUF_ELEMS)))
+            return CANFD_FLTR_ERR_PARAM;
+    }
+
+    for (u32Ord = 0; u32Ord < sizeof(au8Order); u32Ord++)
+    {
+        for (u32Type = 0; u32Type < 2; u32Type++)
+        {
+            eIdType = (u32Type == 0) ? eCANFD_SID : eCANFD_XID;
+
+            for (i = 0, u32Num = 0; i < u32NumRules; i++)
+            {
+                if ((psRules[i].eIdType != eIdType) || (psRules[i].eConfig != au8Order[u32Ord]))
+                    continue;
+
+                if (au8Order[u32Ord] == eCANFD_FLTR_ELEM_STO_RX_BUF_OR_DBG_MSG)
+                {
+                    /* ID2[10:9] = 00b: store into Rx buffer, ID2[5:0]: buffer index */
+                    CANFD_FltrEmit(psList, eIdType, 0, au8Order[u32Ord], psRules[i].u32IdLow, psRules[i].u32RxBufIdx & 0x3F);
+                    continue;
+                }
+
+                s_asFltrWork[u32Num].u32Lo = psRules[i].u32IdLow;
+                s_asFltrWork[u32Num].u32Hi = psRules[i].u32IdHigh;
+                u32Num++;
+            }
+
+            CANFD_FltrCompileGroup(psList, eIdType, au8Order[u32Ord], s_asFltrWork, u32Num);
+        }
+    }
+
+    if ((psList->u32StdCnt > CANFD_MAX_11_BIT_FTR_ELEMS) || (psList->u32ExtCnt > CANFD_MAX_29_BIT_FTR_ELEMS))
+        return CANFD_FLTR_ERR_NO_SPACE;
+
+    return 0;
+}
+
+
+/**
+ * @brief       Sizes the filter lists to a compiled filter list and gives the rest of the
+ *              Message RAM to the Rx FIFOs.
+ *
+ * @param[in]   psConfig     CAN FD configuration, normally from CANFD_GetDefaultConfig().
+ * @param[in]   psList       Compiled filter list from CANFD_CompileFilters().
+ *
+ * @return      0                          Success.
+ *              CANFD_FLTR_ERR_NO_SPACE    Filters and buffers do not fit in u32MRamSize.
+ *
+ * @details     Tx buffers, Rx buffers and the Tx event FIFO keep their size. The remaining
+ *              elements are split between Rx FIFO 0 and 1 in the ratio of their current size
+ *              (all to FIFO 0 if both are zero), each capped at 64 elements. The start
+ *              addresses in sMRamStartAddr are recalculated; call CANFD_Open() afterwards.
+ */
+int32_t CANFD_BalanceRam(CANFD_FD_T *psConfig, const CANFD_FLTR_LIST_T *psList)
+{
+    CANFD_ELEM_SIZE_T *psSize = &psConfig->sElemSize;
+    uint32_t u32Used, u32Fifo, u32Fifo0, u32Fifo1;
+
+    psSize->u32SIDFC = psList->u32StdCnt;
+    psSize->u32XIDFC = psList->u32ExtCnt;
+
+    u32Used = psSize->u32SIDFC * sizeof(CANFD_STD_FILTER_T) + psSize->u32XIDFC * sizeof(CANFD_EXT_FILTER_T)
+              + (psSize->u32TxBuf + psSize->u32RxBuf) * sizeof(CANFD_BUF_T)
+              + psSize->u32TxEventFifo * 8;
+
+    if (u32Used > psConfig->u32MRamSize) return CANFD_FLTR_ERR_NO_SPACE;
+
+    u32Fifo = (psConfig->u32MRamSize - u32Used) / sizeof(CANFD_BUF_T);
+
+    if ((psSize->u32RxFifo0 + psSize->u32RxFifo1) == 0)
+    {
+        u32Fifo0 = u32Fifo;
+    }
+    else
+    {
+        u32Fifo0 = (u32Fifo * psSize->u32RxFifo0) / (psSize->u32RxFifo0 + psSize->u32RxFifo1);
+    }
+
+    u32Fifo1 = u32Fifo - u32Fifo0;
+
+    if (u32Fifo0 > CANFD_MAX_RX_FIFO0_ELEMS) u32Fifo0 = CANFD_MAX_RX_FIFO0_ELEMS;
+    if (u32Fifo1 > CANFD_MAX_RX_FIFO1_ELEMS) u32Fifo1 = CANFD_MAX_RX_FIFO1_ELEMS;
+
+    psSize->u32RxFifo0 = u32Fifo0;
+    psSize->u32RxFifo1 = u32Fifo1;
+
+    CANFD_CalculateRamAddress(&psConfig->sMRamStartAddr, psSize);
+
+    return 0;
+}
+
+
+/**
+ * @brief       Writes a compiled filter list into the Message RAM.
+ *
+ * @param[in]   psCanfd      The pointer of the specified CAN FD module.
+ * @param[in]   psList       Compiled filter list from CANFD_CompileFilters().
+ *
+ * @details     The filter list sizes in SIDFC/XIDFC are set to the number of compiled
+ *              elements so unused elements are not scanned. The list start addresses are
+ *              kept. Must be called in configuration change mode (after CANFD_Open()).
+ */
+void CANFD_InstallFilters(CANFD_T *psCanfd, const CANFD_FLTR_LIST_T *psList)
+{
+    uint32_t i;
+
+    psCanfd->SIDFC = (psCanfd->SIDFC & CANFD_SIDFC_FLSSA_Msk) | ((psList->u32StdCnt & 0xFF) << CANFD_SIDFC_LSS_Pos);
+    psCanfd->XIDFC = (psCanfd->XIDFC & CANFD_XIDFC_FLESA_Msk) | ((psList->u32ExtCnt & 0x7F) << CANFD_XIDFC_LSE_Pos);
+
+    for (i = 0; i < psList->u32StdCnt; i++)
+        CANFD_SetSIDFltr(psCanfd, i, psList->au32Std[i]);
+
+    for (i = 0; i < psList->u32ExtCnt; i++)
+        CANFD_SetXIDFltr(psCanfd, i, psList->au32Ext[i][0], psList->au32Ext[i][1]);
+}
+
 /*! @}*/ /* end of group CANFD_EXPORTED_FUNCTIONS */
 
 /*! @}*/ /* end of group CANFD_Driver */
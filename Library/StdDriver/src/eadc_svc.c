@@ -0,0 +1,277 @@
+/**************************************************************************//**
+ * @file     eadc_svc.c
+ * @brief    EADC streaming acquisition service source file
+ *
+ *           One trigger, from EPWM or a timer, starts every sample module of
+ *           the stream. Each conversion requests PDMA, which moves EADC_CURDAT
+ *           into a ring of blocks described by a looping scatter-gather
+ *           descriptor chain. PDMA runs from one block into the next without
+ *           CPU help. The transfer-done interrupt finds the blocks PDMA has
+ *           finished from its current descriptor, so transfer-done events that
+ *           merged while the interrupt was held off are not lost; each finished
+ *           block has its descriptor reloaded and is handed to the consumer.
+ *
+ *           The consumer releases blocks in order. A block that is still held
+ *           when PDMA comes round to its buffer again is counted as overrun
+ *           and flagged on the next delivered block; sampling never stops.
+ *           The interrupt must be serviced within (u32Blocks - 1) block
+ *           periods, or whole laps of the ring cannot be told apart.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup EADC_SVC_Driver EADC Streaming Acquisition Service
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+static uint32_t EADCSVC_DescCtl(EADC_SVC_T *psSvc)
+{
+    return ((psSvc->u32BlockLen - 1UL) << PDMA_DSCT_CTL_TXCNT_Pos) | PDMA_WIDTH_16 | PDMA_SAR_FIX | PDMA_DAR_INC |
+           PDMA_REQ_SINGLE | PDMA_BURST_1 | PDMA_OP_SCATTER;
+}
+
+static uint16_t *EADCSVC_BlockBuf(EADC_SVC_T *psSvc, uint32_t u32Seq)
+{
+    return psSvc->sCfg.pu16Buf + (u32Seq % psSvc->sCfg.u32Blocks) * psSvc->u32BlockLen;
+}
+
+/* Blocks PDMA has finished since the last one handed over, from the descriptor it is working on */
+static uint32_t EADCSVC_Retired(EADC_SVC_T *psSvc)
+{
+    uint32_t u32Blocks = psSvc->sCfg.u32Blocks;
+    uint32_t u32Cur = (psSvc->sCfg.pdma->CURSCAT[psSvc->sCfg.u32Ch] - ptr_to_u32(psSvc->au32Desc[0])) /
+                      sizeof(psSvc->au32Desc[0]);
+
+    /* 0 while PDMA is between descriptors; the block is then taken on the next interrupt */
+    if (u32Cur >= u32Blocks)
+        return 0UL;
+
+    return (u32Cur + u32Blocks - psSvc->u32Done % u32Blocks) % u32Blocks;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup EADC_SVC_EXPORTED_FUNCTIONS EADC Streaming Acquisition Service Exported Functions
+  @{
+*/
+
+/**
+ *    @brief        Open an EADC stream
+ *
+ *    @param[out]   psSvc   Stream control block.
+ *    @param[in]    psCfg   Stream configuration. The EADC and PDMA module clocks must be enabled
+ *                          and the analog input pins configured.
+ *
+ *    @retval       EADC_SVC_OK         Stream is armed
+ *    @retval       EADC_SVC_ERR_PARAM  Invalid configuration
+ *
+ *    @details      Enables the A/D converter, configures the sample modules of the stream on the
+ *                  common trigger and starts PDMA on the descriptor ring. Sampling begins with the
+ *                  first trigger, so the application starts its EPWM or timer afterwards. The EADC
+ *                  interrupts are disabled, as PDMA requests require. The application routes the
+ *                  PDMA interrupt to \ref EADCSVC_PDMA_IRQHandler.
+ */
+int32_t EADCSVC_Open(EADC_SVC_T *psSvc, const EADC_SVC_CFG_T *psCfg)
+{
+    EADC_T   *eadc = psCfg->eadc;
+    PDMA_T   *pdma = psCfg->pdma;
+    volatile uint32_t *pu32Desc;
+    uint32_t u32BlockLen, i;
+
+    u32BlockLen = psCfg->u32BlockFrames * psCfg->u32Modules;
+
+    if ((psCfg->u32Modules == 0UL) || (psCfg->u32Modules > EADC_SVC_MODULE_MAX) ||
+            (psCfg->u32Blocks < 2UL) || (psCfg->u32Blocks > EADC_SVC_BLOCK_MAX) ||
+            (psCfg->u32BlockFrames == 0UL) || (psCfg->u32BlockFrames > EADC_SVC_TXCNT_MAX) ||
+            (u32BlockLen > EADC_SVC_TXCNT_MAX) || ((u32BlockLen * sizeof(uint16_t)) & 0x3FUL) ||
+            (ptr_to_u32(psCfg->pu16Buf) & 0x3FUL) || (psCfg->u32Ch >= PDMA_CH_MAX) ||
+            (psCfg->pfnBlock == NULL))
+        return EADC_SVC_ERR_PARAM;
+
+    for (i = 0UL; i < psCfg->u32Modules; i++)
+    {
+        if (psCfg->au32Channel[i] > 15UL)
+            return EADC_SVC_ERR_PARAM;
+    }
+
+    memset(psSvc, 0, sizeof(EADC_SVC_T));
+    psSvc->sCfg = *psCfg;
+    psSvc->u32BlockLen = u32BlockLen;
+    psSvc->u32ModuleMsk = (1UL << psCfg->u32Modules) - 1UL;
+
+    /* Descriptors are written through the non-cacheable alias, blocks are invalidated when they are handed over */
+    dcache_clean_invalidate_by_mva(psSvc->au32Desc, sizeof(psSvc->au32Desc));
+    dcache_clean_invalidate_by_mva(psCfg->pu16Buf, psCfg->u32Blocks * u32BlockLen * sizeof(uint16_t));
+
+    for (i = 0UL; i < psCfg->u32Blocks; i++)
+    {
+        pu32Desc = nc_ptr(psSvc->au32Desc[i]);
+        pu32Desc[0] = EADCSVC_DescCtl(psSvc);
+        pu32Desc[1] = ptr_to_u32(&eadc->CURDAT);
+        pu32Desc[2] = ptr_to_u32(EADCSVC_BlockBuf(psSvc, i));
+        pu32Desc[3] = ptr_to_u32(psSvc->au32Desc[(i + 1UL) % psCfg->u32Blocks]);
+    }
+    __DSB();
+
+    PDMA_Open(pdma, 1UL << psCfg->u32Ch);
+    PDMA_SetTransferMode(pdma, psCfg->u32Ch, psCfg->u32Req, TRUE, ptr_to_u32(psSvc->au32Desc[0]));
+    PDMA_EnableInt(pdma, psCfg->u32Ch, PDMA_INT_TRANS_DONE);
+
+    EADC_Open(eadc, psCfg->u32InputMode);
+    EADC_DISABLE_INT(eadc, 0xFUL);
+
+    /* Modules started by the same trigger convert in module order, which gives the frame layout */
+    for (i = 0UL; i < psCfg->u32Modules; i++)
+        EADC_ConfigSampleModule(eadc, i, psCfg->u32TriggerSrc, psCfg->au32Channel[i]);
+
+    EADC_CLR_SAMPLE_MODULE_OV_FLAG(eadc, psSvc->u32ModuleMsk);
+    EADC_ENABLE_SAMPLE_MODULE_PDMA(eadc, psSvc->u32ModuleMsk);
+
+    return EADC_SVC_OK;
+}
+
+/**
+ *    @brief        Stop an EADC stream
+ *
+ *    @param[in]    psSvc   Stream control block.
+ *
+ *    @return       None
+ *
+ *    @details      Detaches the sample modules from their trigger, stops the PDMA channel and
+ *                  powers down the A/D converter. The trigger source and the PDMA controller are
+ *                  left running for other users. A block in progress is discarded.
+ */
+void EADCSVC_Close(EADC_SVC_T *psSvc)
+{
+    EADC_T   *eadc = psSvc->sCfg.eadc;
+    PDMA_T   *pdma = psSvc->sCfg.pdma;
+    uint32_t i;
+
+    for (i = 0UL; i < psSvc->sCfg.u32Modules; i++)
+        EADC_ConfigSampleModule(eadc, i, EADC_SOFTWARE_TRIGGER, psSvc->sCfg.au32Channel[i]);
+    EADC_DISABLE_SAMPLE_MODULE_PDMA(eadc, psSvc->u32ModuleMsk);
+    EADC_Close(eadc);
+
+    PDMA_DisableInt(pdma, psSvc->sCfg.u32Ch, PDMA_INT_TRANS_DONE);
+    PDMA_STOP(pdma, psSvc->sCfg.u32Ch);
+    PDMA_CLR_TD_FLAG(pdma, 1UL << psSvc->sCfg.u32Ch);
+}
+
+/**
+ *    @brief        Release blocks back to PDMA
+ *
+ *    @param[in]    psSvc   Stream control block.
+ *    @param[in]    u32Seq  Sequence number of the last block the consumer is done with. All
+ *                          earlier blocks are released with it.
+ *
+ *    @return       None
+ *
+ *    @details      Can be called from the block-ready callback or from one consumer task.
+ */
+void EADCSVC_Release(EADC_SVC_T *psSvc, uint32_t u32Seq)
+{
+    if ((int32_t)(u32Seq + 1UL - psSvc->u32Released) > 0)
+        psSvc->u32Released = u32Seq + 1UL;
+}
+
+/**
+ *    @brief        Get stream statistics
+ *
+ *    @param[in]    psSvc   Stream control block.
+ *    @param[out]   psStat  Snapshot of the counters.
+ *
+ *    @return       None
+ */
+void EADCSVC_GetStat(EADC_SVC_T *psSvc, EADC_SVC_STAT_T *psStat)
+{
+    *psStat = psSvc->sStat;
+}
+
+/**
+ *    @brief        PDMA interrupt service for an EADC stream
+ *
+ *    @param[in]    psSvc   Stream control block.
+ *
+ *    @return       None
+ *
+ *    @details      Call from the IRQ handler of the PDMA controller serving the stream. Only the
+ *                  transfer-done flag of the stream's channel is consumed, so the controller can be
+ *                  shared with other services.
+ */
+void EADCSVC_PDMA_IRQHandler(EADC_SVC_T *psSvc)
+{
+    PDMA_T   *pdma = psSvc->sCfg.pdma;
+    EADC_T   *eadc = psSvc->sCfg.eadc;
+    uint32_t u32ChMsk = 1UL << psSvc->sCfg.u32Ch;
+    uint32_t u32Blocks = psSvc->sCfg.u32Blocks;
+    uint32_t u32Seq, u32Victim, u32Ov, u32Retired;
+    EADC_SVC_BLOCK_T sBlk;
+
+    if (!(PDMA_GET_TD_STS(pdma) & u32ChMsk))
+        return;
+    PDMA_CLR_TD_FLAG(pdma, u32ChMsk);
+
+    sBlk.u64Timestamp = EL0_GetCurrentPhysicalValue();
+    sBlk.u32Flags = 0UL;
+
+    u32Ov = EADC_GET_SAMPLE_MODULE_OV_FLAG(eadc, psSvc->u32ModuleMsk);
+    if (u32Ov)
+    {
+        EADC_CLR_SAMPLE_MODULE_OV_FLAG(eadc, u32Ov);
+        psSvc->sStat.u32TriggerLost++;
+        sBlk.u32Flags |= EADC_SVC_BLK_TRG_LOST;
+    }
+
+    /* One transfer-done flag may stand for several blocks, and more may finish while the callbacks run */
+    for (u32Retired = EADCSVC_Retired(psSvc); u32Retired != 0UL; u32Retired = EADCSVC_Retired(psSvc))
+    {
+        while (u32Retired-- != 0UL)
+        {
+            /* Re-arm the retired descriptor so the ring keeps looping even if PDMA wrote it back as idle */
+            u32Seq = psSvc->u32Done;
+            ((volatile uint32_t *)nc_ptr(psSvc->au32Desc[u32Seq % u32Blocks]))[0] = EADCSVC_DescCtl(psSvc);
+            psSvc->u32Done = u32Seq + 1UL;
+            psSvc->sStat.u32Blocks++;
+
+            /* PDMA went on into the buffer of block u32Seq + 1, which last held block u32Seq + 1 - u32Blocks */
+            if (u32Seq + 1UL >= u32Blocks)
+            {
+                u32Victim = u32Seq + 1UL - u32Blocks;
+                if ((int32_t)(u32Victim - psSvc->u32Released) >= 0)
+                {
+                    psSvc->sStat.u32Overrun++;
+                    sBlk.u32Flags |= EADC_SVC_BLK_OVERRUN;
+                }
+            }
+
+            sBlk.pu16Data = EADCSVC_BlockBuf(psSvc, u32Seq);
+            sBlk.u32Frames = psSvc->sCfg.u32BlockFrames;
+            sBlk.u32Seq = u32Seq;
+            sBlk.u64Frame = psSvc->u64Frames;
+            psSvc->u64Frames += sBlk.u32Frames;
+
+            /* Lines of the block may have been fetched while PDMA was writing it */
+            dcache_invalidate_by_mva(sBlk.pu16Data, psSvc->u32BlockLen * sizeof(uint16_t));
+
+            psSvc->sCfg.pfnBlock(psSvc->sCfg.pvArg, &sBlk);
+            sBlk.u32Flags = 0UL;
+        }
+        sBlk.u64Timestamp = EL0_GetCurrentPhysicalValue();
+    }
+}
+
+/*! @}*/ /* end of group EADC_SVC_EXPORTED_FUNCTIONS */
+
+/*! @}*/ /* end of group EADC_SVC_Driver */
+
+/*! @}*/ /* end of group Standard_Driver */
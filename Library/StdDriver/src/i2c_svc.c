@@ -0,0 +1,426 @@
+/**************************************************************************//**
+ * @file     i2c_svc.c
+ * @brief    I2C asynchronous transaction engine source file
+ *
+ *           Transactions are queued per bus and run back to back from the I2C
+ *           interrupt. When one transaction ends and another is queued, STOP
+ *           and START are requested together so the controller issues the next
+ *           START right after the STOP without waiting for the CPU. Payloads of
+ *           at least u32DmaThreshold bytes are moved by PDMA; the controller
+ *           raises no per-byte interrupts while PDMA owns the data register.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup I2C_SVC_Driver I2C Transaction Engine
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define I2C_SVC_DMA_NONE    0UL
+#define I2C_SVC_DMA_TX      1UL
+#define I2C_SVC_DMA_RX      2UL
+
+static uint32_t I2CSVC_UseDma(I2C_SVC_T *psSvc, uint32_t u32Len)
+{
+    return (psSvc->sCfg.pdma != NULL) && (u32Len >= psSvc->sCfg.u32DmaThreshold) && (u32Len <= 0x10000UL);
+}
+
+static void I2CSVC_StartDma(I2C_SVC_T *psSvc, uint32_t u32Dir)
+{
+    I2C_SVC_XFER_T *psXfer = psSvc->psHead;
+    PDMA_T  *pdma = psSvc->sCfg.pdma;
+    I2C_T   *i2c = psSvc->sCfg.i2c;
+
+    if (u32Dir == I2C_SVC_DMA_TX)
+    {
+        dcache_clean_by_mva(psXfer->pu8Tx, psXfer->u32TxLen);
+        PDMA_SetTransferCnt(pdma, psSvc->sCfg.u32TxCh, PDMA_WIDTH_8, psXfer->u32TxLen);
+        PDMA_SetTransferAddr(pdma, psSvc->sCfg.u32TxCh, ptr_to_u32(psXfer->pu8Tx), PDMA_SAR_INC,
+                             ptr_to_u32(&i2c->DAT), PDMA_DAR_FIX);
+        PDMA_SetTransferMode(pdma, psSvc->sCfg.u32TxCh, psSvc->sCfg.u32TxReq, FALSE, 0UL);
+        i2c->CTL1 |= I2C_CTL1_TXPDMAEN_Msk;
+    }
+    else
+    {
+        dcache_clean_invalidate_by_mva(psXfer->pu8Rx, psXfer->u32RxLen);
+        PDMA_SetTransferCnt(pdma, psSvc->sCfg.u32RxCh, PDMA_WIDTH_8, psXfer->u32RxLen);
+        PDMA_SetTransferAddr(pdma, psSvc->sCfg.u32RxCh, ptr_to_u32(&i2c->DAT), PDMA_SAR_FIX,
+                             ptr_to_u32(psXfer->pu8Rx), PDMA_DAR_INC);
+        PDMA_SetTransferMode(pdma, psSvc->sCfg.u32RxCh, psSvc->sCfg.u32RxReq, FALSE, 0UL);
+        i2c->CTL1 |= I2C_CTL1_RXPDMAEN_Msk;
+    }
+    psSvc->u32Dma = u32Dir;
+    psSvc->sStat.u32DmaXfers++;
+}
+
+/*
+ *  Retire the PDMA payload. Returns 1 if PDMA finished the whole payload,
+ *  0 if it is still running (the transfer is left untouched then) unless
+ *  bForce is set, which aborts it.
+ */
+static uint32_t I2CSVC_EndDma(I2C_SVC_T *psSvc, uint32_t bForce)
+{
+    I2C_SVC_XFER_T *psXfer = psSvc->psHead;
+    PDMA_T   *pdma = psSvc->sCfg.pdma;
+    uint32_t u32Ch = (psSvc->u32Dma == I2C_SVC_DMA_TX) ? psSvc->sCfg.u32TxCh : psSvc->sCfg.u32RxCh;
+    uint32_t u32Done = (PDMA_GET_TD_STS(pdma) & (1UL << u32Ch)) ? 1UL : 0UL;
+
+    if (!u32Done && !bForce)
+        return 0UL;
+
+    psSvc->sCfg.i2c->CTL1 &= ~(I2C_CTL1_TXPDMAEN_Msk | I2C_CTL1_RXPDMAEN_Msk);
+    if (!u32Done)
+        PDMA_STOP(pdma, u32Ch);
+    PDMA_CLR_TD_FLAG(pdma, 1UL << u32Ch);
+
+    if (u32Done)
+    {
+        if (psSvc->u32Dma == I2C_SVC_DMA_TX)
+        {
+            psXfer->u32TxDone = psXfer->u32TxLen;
+        }
+        else
+        {
+            dcache_invalidate_by_mva(psXfer->pu8Rx, psXfer->u32RxLen);
+            psXfer->u32RxDone = psXfer->u32RxLen;
+        }
+    }
+    psSvc->u32Dma = I2C_SVC_DMA_NONE;
+    return u32Done;
+}
+
+/*
+ *  Finish the transaction on the bus and chain the next one.
+ *  The callback runs after the bus has been handed to the next transaction.
+ */
+static void I2CSVC_Complete(I2C_SVC_T *psSvc, int32_t i32Status)
+{
+    I2C_SVC_XFER_T *psXfer = psSvc->psHead;
+    uint32_t       u32Ctrl;
+
+    if (psSvc->u32Dma != I2C_SVC_DMA_NONE)
+        I2CSVC_EndDma(psSvc, 1UL);
+
+    psSvc->psHead = psXfer->psNext;
+    if (psSvc->psHead == NULL)
+        psSvc->psTail = NULL;
+
+    /*
+     *  The only control register write for the ending transaction. After a lost arbitration
+     *  the controller is no longer master and must not send STOP: it releases the bus and,
+     *  with STA, starts the next transaction once the bus is free.
+     */
+    if (i32Status == I2C_SVC_ERR_ARB)
+        u32Ctrl = I2C_CTL_SI_AA;
+    else
+        u32Ctrl = I2C_CTL_STO_SI;
+    if (psSvc->psHead != NULL)
+        u32Ctrl |= I2C_CTL_STA;                                                 /* START the next one */
+    I2C_SET_CONTROL_REG(psSvc->sCfg.i2c, u32Ctrl);
+
+    psSvc->sStat.u32Bytes += psXfer->u32TxDone + psXfer->u32RxDone;
+    switch (i32Status)
+    {
+    case I2C_SVC_OK:
+        psSvc->sStat.u32Xfers++;
+        break;
+    case I2C_SVC_ERR_NACK:
+        psSvc->sStat.u32Nacks++;
+        psSvc->sStat.u32Errors++;
+        break;
+    case I2C_SVC_ERR_ARB:
+        psSvc->sStat.u32ArbLost++;
+        psSvc->sStat.u32Errors++;
+        break;
+    case I2C_SVC_ERR_TIMEOUT:
+        psSvc->sStat.u32Timeouts++;
+        psSvc->sStat.u32Errors++;
+        break;
+    default:
+        psSvc->sStat.u32Errors++;
+        break;
+    }
+
+    __DMB();
+    psXfer->i32Status = i32Status;
+    if (psXfer->pfnDone != NULL)
+        psXfer->pfnDone(psXfer);
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup I2C_SVC_EXPORTED_FUNCTIONS I2C Transaction Engine Exported Functions
+  @{
+*/
+
+/**
+ *    @brief        Open an I2C transaction engine on a bus
+ *
+ *    @param[out]   psSvc   Bus control block.
+ *    @param[in]    psCfg   Bus configuration.
+ *
+ *    @retval       I2C_SVC_OK          Engine is ready
+ *    @retval       I2C_SVC_ERR_PARAM   Invalid configuration
+ *
+ *    @details      The application installs an IRQ handler for psCfg->eIrq that calls
+ *                  \ref I2CSVC_IRQHandler before calling this function; the interrupt is
+ *                  enabled here. No PDMA interrupt is used: PDMA completion is picked up
+ *                  from the I2C interrupt that follows the last payload byte.
+ */
+int32_t I2CSVC_Open(I2C_SVC_T *psSvc, const I2C_SVC_CFG_T *psCfg)
+{
+    if ((psCfg->i2c == NULL) ||
+            ((psCfg->pdma != NULL) && ((psCfg->u32TxCh >= PDMA_CH_MAX) || (psCfg->u32RxCh >= PDMA_CH_MAX) ||
+                                       (psCfg->u32TxCh == psCfg->u32RxCh))))
+        return I2C_SVC_ERR_PARAM;
+
+    memset(psSvc, 0, sizeof(I2C_SVC_T));
+    psSvc->sCfg = *psCfg;
+    if (psSvc->sCfg.u32DmaThreshold == 0UL)
+        psSvc->sCfg.u32DmaThreshold = I2C_SVC_DMA_DEFAULT_THRESHOLD;
+
+    if (psCfg->pdma != NULL)
+    {
+        PDMA_Open(psCfg->pdma, (1UL << psCfg->u32TxCh) | (1UL << psCfg->u32RxCh));
+        PDMA_SetBurstType(psCfg->pdma, psCfg->u32TxCh, PDMA_REQ_SINGLE, 0UL);
+        PDMA_SetBurstType(psCfg->pdma, psCfg->u32RxCh, PDMA_REQ_SINGLE, 0UL);
+    }
+
+    psCfg->i2c->CTL1 &= ~(I2C_CTL1_TXPDMAEN_Msk | I2C_CTL1_RXPDMAEN_Msk);
+    I2C_ClearTimeoutFlag(psCfg->i2c);
+    I2C_EnableTimeout(psCfg->i2c, 1);
+    I2C_EnableInt(psCfg->i2c);
+    IRQ_Enable(psCfg->eIrq);
+
+    return I2C_SVC_OK;
+}
+
+/**
+ *    @brief        Close an I2C transaction engine
+ *
+ *    @param[in]    psSvc   Bus control block.
+ *
+ *    @return       None
+ *
+ *    @details      Transactions still queued complete with \ref I2C_SVC_ERR_BUS; their
+ *                  callbacks are not called.
+ */
+void I2CSVC_Close(I2C_SVC_T *psSvc)
+{
+    I2C_SVC_XFER_T *psXfer;
+
+    IRQ_Disable(psSvc->sCfg.eIrq);
+    I2C_DisableInt(psSvc->sCfg.i2c);
+    I2C_DisableTimeout(psSvc->sCfg.i2c);
+
+    if (psSvc->u32Dma != I2C_SVC_DMA_NONE)
+        I2CSVC_EndDma(psSvc, 1UL);
+
+    if (psSvc->psHead != NULL)
+        I2C_SET_CONTROL_REG(psSvc->sCfg.i2c, I2C_CTL_STO_SI);
+
+    for (psXfer = psSvc->psHead; psXfer != NULL; psXfer = psXfer->psNext)
+        psXfer->i32Status = I2C_SVC_ERR_BUS;
+
+    psSvc->psHead = psSvc->psTail = NULL;
+}
+
+/**
+ *    @brief        Queue a transaction
+ *
+ *    @param[in]    psSvc   Bus control block.
+ *    @param[in]    psXfer  Transaction descriptor. u8SlaveAddr, the buffers, lengths and
+ *                          pfnDone/pvArg must be filled in; the remaining fields are set here.
+ *
+ *    @retval       I2C_SVC_PENDING     Transaction queued
+ *    @retval       I2C_SVC_ERR_PARAM   Invalid descriptor
+ *
+ *    @details      Can be called from task context or from a completion callback.
+ *                  If the bus is idle the START condition is issued immediately.
+ *                  Buffers moved by PDMA should be 64-byte aligned.
+ */
+int32_t I2CSVC_Submit(I2C_SVC_T *psSvc, I2C_SVC_XFER_T *psXfer)
+{
+    if ((psXfer == NULL) || (psXfer->u8SlaveAddr > 0x7FU) ||
+            ((psXfer->u32TxLen != 0UL) && (psXfer->pu8Tx == NULL)) ||
+            ((psXfer->u32RxLen != 0UL) && (psXfer->pu8Rx == NULL)))
+        return I2C_SVC_ERR_PARAM;
+
+    psXfer->psNext = NULL;
+    psXfer->u32TxDone = 0UL;
+    psXfer->u32RxDone = 0UL;
+    psXfer->i32Status = I2C_SVC_PENDING;
+
+    IRQ_Disable(psSvc->sCfg.eIrq);
+    if (psSvc->psHead == NULL)
+    {
+        psSvc->psHead = psSvc->psTail = psXfer;
+        I2C_START(psSvc->sCfg.i2c);
+    }
+    else
+    {
+        psSvc->psTail->psNext = psXfer;
+        psSvc->psTail = psXfer;
+    }
+    IRQ_Enable(psSvc->sCfg.eIrq);
+
+    return I2C_SVC_PENDING;
+}
+
+/**
+ *    @brief        Check whether the engine has no transaction queued or on the bus
+ *
+ *    @param[in]    psSvc   Bus control block.
+ *
+ *    @retval       1   Idle
+ *    @retval       0   Busy
+ */
+uint32_t I2CSVC_IsIdle(I2C_SVC_T *psSvc)
+{
+    return (*(I2C_SVC_XFER_T * volatile *)&psSvc->psHead == NULL) ? 1UL : 0UL;
+}
+
+/**
+ *    @brief        Get bus statistics
+ *
+ *    @param[in]    psSvc   Bus control block.
+ *    @param[out]   psStat  Snapshot of the counters.
+ *
+ *    @return       None
+ */
+void I2CSVC_GetStat(I2C_SVC_T *psSvc, I2C_SVC_STAT_T *psStat)
+{
+    *psStat = psSvc->sStat;
+}
+
+/**
+ *    @brief        I2C interrupt service for the transaction engine
+ *
+ *    @param[in]    psSvc   Bus control block.
+ *
+ *    @return       None
+ *
+ *    @details      Call from the I2Cn IRQ handler. Advances the transaction on the bus by
+ *                  one controller state and chains the next queued transaction when it ends.
+ */
+void I2CSVC_IRQHandler(I2C_SVC_T *psSvc)
+{
+    I2C_T          *i2c = psSvc->sCfg.i2c;
+    I2C_SVC_XFER_T *psXfer = psSvc->psHead;
+    uint32_t       u32Ctrl = I2C_CTL_SI;
+
+    if (I2C_GET_TIMEOUT_FLAG(i2c))
+    {
+        I2C_ClearTimeoutFlag(i2c);
+        if (psXfer != NULL)
+            I2CSVC_Complete(psSvc, I2C_SVC_ERR_TIMEOUT);
+        return;
+    }
+
+    if (psXfer == NULL)
+    {
+        I2C_SET_CONTROL_REG(i2c, I2C_CTL_SI);
+        return;
+    }
+
+    switch (I2C_GET_STATUS(i2c))
+    {
+    case 0x08u:                                                             /* START */
+        if ((psXfer->u32TxLen != 0UL) || (psXfer->u32RxLen == 0UL))
+            I2C_SET_DATA(i2c, (uint8_t)(psXfer->u8SlaveAddr << 1u));        /* SLA+W */
+        else
+            I2C_SET_DATA(i2c, (uint8_t)((psXfer->u8SlaveAddr << 1u) | 0x01u));  /* SLA+R */
+        break;
+    case 0x10u:                                                             /* Repeated START */
+        I2C_SET_DATA(i2c, (uint8_t)((psXfer->u8SlaveAddr << 1u) | 0x01u));  /* SLA+R */
+        break;
+    case 0x18u:                                                             /* SLA+W ACK */
+        if (psXfer->u32TxLen == 0UL)
+        {
+            I2CSVC_Complete(psSvc, I2C_SVC_OK);                              /* Address probe */
+            return;
+        }
+        if (I2CSVC_UseDma(psSvc, psXfer->u32TxLen))
+            I2CSVC_StartDma(psSvc, I2C_SVC_DMA_TX);
+        else
+            I2C_SET_DATA(i2c, psXfer->pu8Tx[psXfer->u32TxDone++]);
+        break;
+    case 0x28u:                                                             /* Data ACK */
+        if ((psSvc->u32Dma == I2C_SVC_DMA_TX) && !I2CSVC_EndDma(psSvc, 0UL))
+            break;                                                          /* PDMA still feeding */
+        if (psXfer->u32TxDone < psXfer->u32TxLen)
+        {
+            I2C_SET_DATA(i2c, psXfer->pu8Tx[psXfer->u32TxDone++]);
+        }
+        else if (psXfer->u32RxLen != 0UL)
+        {
+            u32Ctrl = I2C_CTL_STA_SI;                                       /* Repeated START for the read phase */
+        }
+        else
+        {
+            I2CSVC_Complete(psSvc, I2C_SVC_OK);
+            return;
+        }
+        break;
+    case 0x40u:                                                             /* SLA+R ACK */
+        if (I2CSVC_UseDma(psSvc, psXfer->u32RxLen))
+        {
+            I2CSVC_StartDma(psSvc, I2C_SVC_DMA_RX);
+            u32Ctrl = I2C_CTL_SI_AA;
+        }
+        else if (psXfer->u32RxLen > 1UL)
+        {
+            u32Ctrl = I2C_CTL_SI_AA;
+        }
+        break;                                                              /* Single byte: NACK it */
+    case 0x50u:                                                             /* Data received, ACK returned */
+        psXfer->pu8Rx[psXfer->u32RxDone++] = (uint8_t)I2C_GET_DATA(i2c);
+        if (psXfer->u32RxDone < psXfer->u32RxLen - 1UL)
+            u32Ctrl = I2C_CTL_SI_AA;
+        break;
+    case 0x58u:                                                             /* Last byte received, NACK returned */
+        if (psSvc->u32Dma == I2C_SVC_DMA_RX)
+        {
+            if (!I2CSVC_EndDma(psSvc, 1UL))
+            {
+                I2CSVC_Complete(psSvc, I2C_SVC_ERR_BUS);
+                return;
+            }
+        }
+        else if (psXfer->u32RxDone < psXfer->u32RxLen)
+        {
+            psXfer->pu8Rx[psXfer->u32RxDone++] = (uint8_t)I2C_GET_DATA(i2c);
+        }
+        I2CSVC_Complete(psSvc, I2C_SVC_OK);
+        return;
+    case 0x20u:                                                             /* SLA+W NACK */
+    case 0x30u:                                                             /* Data NACK */
+    case 0x48u:                                                             /* SLA+R NACK */
+        I2CSVC_Complete(psSvc, I2C_SVC_ERR_NACK);
+        return;
+    case 0x38u:                                                             /* Arbitration lost */
+        I2CSVC_Complete(psSvc, I2C_SVC_ERR_ARB);
+        return;
+    default:                                                                /* Bus error or unknown status */
+        I2CSVC_Complete(psSvc, I2C_SVC_ERR_BUS);
+        return;
+    }
+
+    I2C_SET_CONTROL_REG(i2c, u32Ctrl);
+}
+
+/*! @}*/ /* end of group I2C_SVC_EXPORTED_FUNCTIONS */
+
+/*! @}*/ /* end of group I2C_SVC_Driver */
+
+/*! @}*/ /* end of group Standard_Driver */
@@ -0,0 +1,1388 @@
+/**************************************************************************//**
+ * @file     sflash_svc.c
+ * @brief    QSPI serial flash service source file
+ *
+ *           SFLASHSVC_Open() identifies the part on the port. A SPI-NOR part
+ *           with an SFDP basic parameter table is configured from it: size,
+ *           address bytes, fast read opcode and dummy clocks for 1-1-4 or
+ *           1-1-2, erase opcodes and sizes, page size and how to set the quad
+ *           enable bit. SPI-NAND parts are matched by JEDEC ID against a small
+ *           table; SPI-NOR parts without SFDP fall back to the capacity byte of
+ *           their ID and single-line commands.
+ *
+ *           Commands, addresses and dummy clocks are sent by the CPU in 1-bit
+ *           mode. The data phase then switches the port to dual or quad mode,
+ *           32-bit units with byte reorder, and runs on PDMA: a SPI-NAND page
+ *           with its spare area is one scatter-gather transfer of two
+ *           descriptors. Consecutive SPI-NAND pages are read with continuous
+ *           read (one transfer for up to SFLASH_SVC_DMA_MAX bytes) or with
+ *           sequential cache read, where the array loads the next page while
+ *           PDMA drains the current one.
+ *
+ *           Requests are queued and completed asynchronously. The SPI-NAND
+ *           array-to-cache time of a page read (tens of microseconds) is waited
+ *           for in line; program and erase completion is detected by
+ *           SFLASHSVC_Poll(), which the application calls periodically while
+ *           requests are outstanding.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup SFLASH_SVC_Driver QSPI Serial Flash Service
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define SFLASH_SVC_TICKS_PER_US     12ULL       /* The generic timer counts at 12 MHz */
+
+#define SFLASH_ST_IDLE              0UL
+#define SFLASH_ST_DMA               1UL         /* Data phase on PDMA */
+#define SFLASH_ST_BUSY              2UL         /* Flash is programming or erasing */
+
+#define SFLASH_SEQ_PAGE             0UL
+#define SFLASH_SEQ_CACHE            1UL         /* 31h issued, the array is loading the next page */
+#define SFLASH_SEQ_CONT             2UL         /* Continuous read in flight, BUF=0 */
+
+#define SFLASH_DIR_RX               0UL
+#define SFLASH_DIR_TX               1UL
+
+/* Worst-case busy times in microseconds */
+#define SFLASH_TMO_RESET            2000UL
+#define SFLASH_TMO_READ             1000UL
+#define SFLASH_TMO_WRSR             20000UL
+#define SFLASH_TMO_PROGRAM          10000UL
+#define SFLASH_TMO_NAND_ERASE       50000UL
+#define SFLASH_TMO_NOR_ERASE        5000000UL
+
+/* Commands common to both types */
+#define SF_CMD_WREN                 0x06U
+#define SF_CMD_RDID                 0x9FU
+#define SF_SR_BUSY                  0x01U
+
+/* SPI-NOR */
+#define SNOR_CMD_RDSR               0x05U
+#define SNOR_CMD_RDSR2              0x35U
+#define SNOR_CMD_WRSR               0x01U
+#define SNOR_CMD_WRSR2              0x31U
+#define SNOR_CMD_RDSR2_B7           0x3FU
+#define SNOR_CMD_WRSR2_B7           0x3EU
+#define SNOR_CMD_FAST_READ          0x0BU
+#define SNOR_CMD_PP                 0x02U
+#define SNOR_CMD_PP_1_1_4           0x32U
+#define SNOR_CMD_SE_4K              0x20U
+#define SNOR_CMD_BE_64K             0xD8U
+#define SNOR_CMD_EN4B               0xB7U
+#define SNOR_CMD_RSTEN              0x66U
+#define SNOR_CMD_RST                0x99U
+#define SNOR_CMD_SFDP               0x5AU
+
+/* SPI-NAND */
+#define SNAND_CMD_RESET             0xFFU
+#define SNAND_CMD_GET_FEATURE       0x0FU
+#define SNAND_CMD_SET_FEATURE       0x1FU
+#define SNAND_CMD_PAGE_READ         0x13U
+#define SNAND_CMD_CACHE_READ_SEQ    0x31U
+#define SNAND_CMD_CACHE_READ_END    0x3FU
+#define SNAND_CMD_READ_CACHE        0x0BU
+#define SNAND_CMD_READ_CACHE_X2     0x3BU
+#define SNAND_CMD_READ_CACHE_X4     0x6BU
+#define SNAND_CMD_PROG_LOAD         0x02U
+#define SNAND_CMD_PROG_LOAD_X4      0x32U
+#define SNAND_CMD_PROG_EXEC         0x10U
+#define SNAND_CMD_BLOCK_ERASE       0xD8U
+
+#define SNAND_REG_PROT              0xA0U
+#define SNAND_REG_CFG               0xB0U
+#define SNAND_REG_STATUS            0xC0U
+
+#define SNAND_CFG_QE                0x01U
+#define SNAND_CFG_BUF               0x08U
+#define SNAND_CFG_ECC_EN            0x10U
+
+#define SNAND_SR_E_FAIL             0x04U
+#define SNAND_SR_P_FAIL             0x08U
+#define SNAND_SR_ECC_Pos            4U
+#define SNAND_SR_ECC_Msk            0x30U
+
+/*
+ *  Supported SPI-NAND parts. The ID follows one dummy byte after 9Fh. The spare
+ *  size is the part of the spare area that is free for the user on every listed
+ *  part of that geometry, not necessarily all of it.
+ */
+typedef struct
+{
+    uint32_t    u32Id;              /* ID bytes, first one in bits 23:16 for 3-byte IDs, 15:8 for 2-byte IDs */
+    uint8_t     u8IdLen;
+    uint16_t    u16PageSize;
+    uint16_t    u16SpareSize;
+    uint16_t    u16PagesPerBlock;
+    uint16_t    u16Blocks;
+    uint32_t    u32Flags;
+} SFLASH_SVC_NAND_ID_T;
+
+static const SFLASH_SVC_NAND_ID_T s_asNandId[] =
+{
+    { 0xEFAA21UL, 3U, 2048U,  64U, 64U, 1024U, SFLASH_SVC_FLAG_CONT_READ },     /* Winbond W25N01GV */
+    { 0xEFAE21UL, 3U, 2048U,  64U, 64U, 1024U, SFLASH_SVC_FLAG_CONT_READ },     /* Winbond W25N01KV */
+    { 0xEFBE21UL, 3U, 2048U,  64U, 64U, 1024U, SFLASH_SVC_FLAG_CONT_READ },     /* Winbond W25N01KW */
+    { 0xEFAA22UL, 3U, 2048U, 128U, 64U, 2048U, SFLASH_SVC_FLAG_CONT_READ },     /* Winbond W25N02KV */
+    { 0xEFAA23UL, 3U, 2048U, 128U, 64U, 4096U, SFLASH_SVC_FLAG_CONT_READ },     /* Winbond W25N04KV */
+    { 0x2C14UL,   2U, 2048U, 128U, 64U, 1024U, SFLASH_SVC_FLAG_CACHE_READ },    /* Micron MT29F1G01ABAFD */
+    { 0x2C24UL,   2U, 2048U, 128U, 64U, 2048U, SFLASH_SVC_FLAG_CACHE_READ | SFLASH_SVC_FLAG_PLANE },    /* Micron MT29F2G01ABAGD */
+    { 0xC212UL,   2U, 2048U,  64U, 64U, 1024U, SFLASH_SVC_FLAG_QE },            /* Macronix MX35LF1GE4AB */
+    { 0xC222UL,   2U, 2048U,  64U, 64U, 2048U, SFLASH_SVC_FLAG_QE | SFLASH_SVC_FLAG_PLANE },    /* Macronix MX35LF2GE4AB */
+    { 0xC8D1UL,   2U, 2048U, 128U, 64U, 1024U, SFLASH_SVC_FLAG_QE },            /* GigaDevice GD5F1GQ4UB */
+    { 0xC8D2UL,   2U, 2048U, 128U, 64U, 2048U, SFLASH_SVC_FLAG_QE },            /* GigaDevice GD5F2GQ4UB */
+};
+
+static uint64_t SFLASHSVC_Deadline(uint32_t u32Us)
+{
+    return EL0_GetCurrentPhysicalValue() + (uint64_t)u32Us * SFLASH_SVC_TICKS_PER_US;
+}
+
+static uint32_t SFLASHSVC_Expired(uint64_t u64Deadline)
+{
+    return (EL0_GetCurrentPhysicalValue() >= u64Deadline) ? 1UL : 0UL;
+}
+
+static void SFLASHSVC_DelayUs(uint32_t u32Us)
+{
+    uint64_t u64End = SFLASHSVC_Deadline(u32Us);
+
+    while (!SFLASHSVC_Expired(u64End)) {}
+}
+
+static uint32_t SFLASHSVC_IsNand(SFLASH_SVC_T *psSvc)
+{
+    return (psSvc->sInfo.u32Type == SFLASH_SVC_TYPE_NAND) ? 1UL : 0UL;
+}
+
+/* Exchange bytes one at a time in 1-bit mode; SS is left as it is */
+static void SFLASHSVC_Pio(QSPI_T *qspi, const uint8_t *pu8Tx, uint32_t u32TxLen, uint8_t *pu8Rx, uint32_t u32RxLen)
+{
+    uint32_t i, u32Rx;
+
+    for (i = 0UL; i < u32TxLen + u32RxLen; i++)
+    {
+        QSPI_WRITE_TX(qspi, (i < u32TxLen) ? pu8Tx[i] : 0xFFUL);
+        while (QSPI_GET_RX_FIFO_EMPTY_FLAG(qspi)) {}
+        u32Rx = QSPI_READ_RX(qspi);
+        if (i >= u32TxLen)
+            pu8Rx[i - u32TxLen] = (uint8_t)u32Rx;
+    }
+}
+
+/*
+ *  Clock out dummy cycles in 1-bit mode. A count that is not a multiple of 8 is
+ *  sent as one wider unit first, so it must be 0 or at least 8.
+ */
+static void SFLASHSVC_Dummy(QSPI_T *qspi, uint32_t u32Clocks)
+{
+    uint32_t u32Rem = u32Clocks % 8UL;
+
+    if (u32Rem != 0UL)
+    {
+        while (QSPI_IS_BUSY(qspi)) {}
+        QSPI_SET_DATA_WIDTH(qspi, 8UL + u32Rem);
+        QSPI_WRITE_TX(qspi, 0xFFFFFFFFUL);
+        while (QSPI_GET_RX_FIFO_EMPTY_FLAG(qspi)) {}
+        (void)QSPI_READ_RX(qspi);
+        while (QSPI_IS_BUSY(qspi)) {}
+        QSPI_SET_DATA_WIDTH(qspi, 8UL);
+        u32Clocks -= 8UL + u32Rem;
+    }
+
+    for (; u32Clocks != 0UL; u32Clocks -= 8UL)
+    {
+        QSPI_WRITE_TX(qspi, 0xFFUL);
+        while (QSPI_GET_RX_FIFO_EMPTY_FLAG(qspi)) {}
+        (void)QSPI_READ_RX(qspi);
+    }
+}
+
+/* One complete command: SS low, write, read, SS high */
+static void SFLASHSVC_Cmd(SFLASH_SVC_T *psSvc, const uint8_t *pu8Tx, uint32_t u32TxLen, uint8_t *pu8Rx, uint32_t u32RxLen)
+{
+    QSPI_T *qspi = psSvc->sCfg.qspi;
+
+    QSPI_SET_SS_LOW(qspi);
+    SFLASHSVC_Pio(qspi, pu8Tx, u32TxLen, pu8Rx, u32RxLen);
+    while (QSPI_IS_BUSY(qspi)) {}
+    QSPI_SET_SS_HIGH(qspi);
+}
+
+static void SFLASHSVC_Cmd1(SFLASH_SVC_T *psSvc, uint8_t u8Op)
+{
+    SFLASHSVC_Cmd(psSvc, &u8Op, 1UL, NULL, 0UL);
+}
+
+/* Opcode, address MSB first and dummy clocks, leaving SS low for the data phase */
+static void SFLASHSVC_Header(SFLASH_SVC_T *psSvc, uint8_t u8Op, uint32_t u32Addr, uint32_t u32AddrBytes, uint32_t u32Dummy)
+{
+    QSPI_T   *qspi = psSvc->sCfg.qspi;
+    uint8_t  au8Hdr[5];
+    uint32_t i;
+
+    au8Hdr[0] = u8Op;
+    for (i = 0UL; i < u32AddrBytes; i++)
+        au8Hdr[1UL + i] = (uint8_t)(u32Addr >> (8UL * (u32AddrBytes - 1UL - i)));
+
+    QSPI_SET_SS_LOW(qspi);
+    SFLASHSVC_Pio(qspi, au8Hdr, 1UL + u32AddrBytes, NULL, 0UL);
+    SFLASHSVC_Dummy(qspi, u32Dummy);
+}
+
+/* 3-byte row address commands of SPI-NAND: page read, program execute, block erase */
+static void SFLASHSVC_RowCmd(SFLASH_SVC_T *psSvc, uint8_t u8Op, uint32_t u32Row)
+{
+    SFLASHSVC_Header(psSvc, u8Op, u32Row, 3UL, 0UL);
+    while (QSPI_IS_BUSY(psSvc->sCfg.qspi)) {}
+    QSPI_SET_SS_HIGH(psSvc->sCfg.qspi);
+}
+
+static uint8_t SFLASHSVC_GetFeature(SFLASH_SVC_T *psSvc, uint8_t u8Reg)
+{
+    uint8_t au8Cmd[2] = { SNAND_CMD_GET_FEATURE, u8Reg }, u8Val;
+
+    SFLASHSVC_Cmd(psSvc, au8Cmd, 2UL, &u8Val, 1UL);
+    return u8Val;
+}
+
+static void SFLASHSVC_SetFeature(SFLASH_SVC_T *psSvc, uint8_t u8Reg, uint8_t u8Val)
+{
+    uint8_t au8Cmd[3] = { SNAND_CMD_SET_FEATURE, u8Reg, u8Val };
+
+    SFLASHSVC_Cmd(psSvc, au8Cmd, 3UL, NULL, 0UL);
+}
+
+static uint8_t SFLASHSVC_Status(SFLASH_SVC_T *psSvc)
+{
+    uint8_t u8Op = SNOR_CMD_RDSR, u8Sr;
+
+    if (SFLASHSVC_IsNand(psSvc))
+        return SFLASHSVC_GetFeature(psSvc, SNAND_REG_STATUS);
+
+    SFLASHSVC_Cmd(psSvc, &u8Op, 1UL, &u8Sr, 1UL);
+    return u8Sr;
+}
+
+static int32_t SFLASHSVC_WaitReady(SFLASH_SVC_T *psSvc, uint32_t u32Us, uint8_t *pu8Sr)
+{
+    uint64_t u64End = SFLASHSVC_Deadline(u32Us);
+    uint8_t  u8Sr;
+
+    do
+    {
+        u8Sr = SFLASHSVC_Status(psSvc);
+        if (!(u8Sr & SF_SR_BUSY))
+        {
+            if (pu8Sr != NULL)
+                *pu8Sr = u8Sr;
+            return SFLASH_SVC_OK;
+        }
+    }
+    while (!SFLASHSVC_Expired(u64End));
+
+    psSvc->sStat.u32Timeouts++;
+    return SFLASH_SVC_ERR_TIMEOUT;
+}
+
+/* SPI-NAND column address of the start of a page in the block's plane */
+static uint32_t SFLASHSVC_Column(SFLASH_SVC_T *psSvc, uint32_t u32Page, uint32_t u32Offset)
+{
+    uint32_t u32Block = u32Page / psSvc->sInfo.u32PagesPerBlock;
+
+    if ((psSvc->sInfo.u32Flags & SFLASH_SVC_FLAG_PLANE) && (u32Block & 1UL))
+        u32Offset |= 0x1000UL;
+    return u32Offset;
+}
+
+/*
+ *  Start the data phase on PDMA. SS is low and the header has been sent. Data
+ *  and spare are moved by one transfer of one or two descriptors.
+ */
+static void SFLASHSVC_StartData(SFLASH_SVC_T *psSvc, uint32_t u32Dir, uint32_t u32Io, uint8_t *pu8Data,
+                                uint32_t u32DataLen, uint8_t *pu8Spare, uint32_t u32SpareLen)
+{
+    QSPI_T   *qspi = psSvc->sCfg.qspi;
+    PDMA_T   *pdma = psSvc->sCfg.pdma;
+    volatile uint32_t *pu32Desc = nc_ptr(psSvc->au32Desc[0]);
+    uint32_t u32Ch, u32Req, u32Ctl, u32Fix, u32Port, u32Base;
+
+    while (QSPI_IS_BUSY(qspi)) {}
+
+    u32Ctl = (psSvc->u32Ctl & ~QSPI_CTL_DWIDTH_Msk) | QSPI_CTL_REORDER_Msk;    /* 32-bit units, bytes in memory order */
+    if (u32Io == 4UL)
+        u32Ctl |= QSPI_CTL_QUADIOEN_Msk;
+    else if (u32Io == 2UL)
+        u32Ctl |= QSPI_CTL_DUALIOEN_Msk;
+
+    if (u32Dir == SFLASH_DIR_RX)
+    {
+        dcache_clean_invalidate_by_mva(pu8Data, u32DataLen);
+        if (u32SpareLen != 0UL)
+            dcache_clean_invalidate_by_mva(pu8Spare, u32SpareLen);
+        QSPI_ClearRxFIFO(qspi);
+        while (qspi->STATUS & QSPI_STATUS_TXRXRST_Msk) {}
+        u32Ch = psSvc->sCfg.u32RxCh;
+        u32Req = psSvc->sCfg.u32RxReq;
+        u32Fix = PDMA_SAR_FIX | PDMA_DAR_INC;
+        u32Port = ptr_to_u32(&qspi->RX);
+    }
+    else
+    {
+        dcache_clean_by_mva(pu8Data, u32DataLen);
+        if (u32SpareLen != 0UL)
+            dcache_clean_by_mva(pu8Spare, u32SpareLen);
+        if (u32Io != 1UL)
+            u32Ctl |= QSPI_CTL_DATDIR_Msk;
+        u32Ch = psSvc->sCfg.u32TxCh;
+        u32Req = psSvc->sCfg.u32TxReq;
+        u32Fix = PDMA_SAR_INC | PDMA_DAR_FIX;
+        u32Port = ptr_to_u32(&qspi->TX);
+    }
+
+    u32Base = PDMA_WIDTH_32 | u32Fix | PDMA_REQ_SINGLE | PDMA_BURST_1;
+    pu32Desc[0] = ((u32DataLen / 4UL - 1UL) << PDMA_DSCT_CTL_TXCNT_Pos) | u32Base |
+                  ((u32SpareLen != 0UL) ? (PDMA_OP_SCATTER | PDMA_TBINTDIS_DISABLE) : PDMA_OP_BASIC);
+    pu32Desc[1] = (u32Dir == SFLASH_DIR_RX) ? u32Port : ptr_to_u32(pu8Data);
+    pu32Desc[2] = (u32Dir == SFLASH_DIR_RX) ? ptr_to_u32(pu8Data) : u32Port;
+    pu32Desc[3] = ptr_to_u32(psSvc->au32Desc[1]);
+    if (u32SpareLen != 0UL)
+    {
+        pu32Desc = nc_ptr(psSvc->au32Desc[1]);
+        pu32Desc[0] = ((u32SpareLen / 4UL - 1UL) << PDMA_DSCT_CTL_TXCNT_Pos) | u32Base | PDMA_OP_BASIC;
+        pu32Desc[1] = (u32Dir == SFLASH_DIR_RX) ? u32Port : ptr_to_u32(pu8Spare);
+        pu32Desc[2] = (u32Dir == SFLASH_DIR_RX) ? ptr_to_u32(pu8Spare) : u32Port;
+        pu32Desc[3] = 0UL;
+    }
+    __DSB();
+
+    psSvc->u32DmaDir = u32Dir;
+    psSvc->u32DmaIo = u32Io;
+    psSvc->pu8DmaData = pu8Data;
+    psSvc->u32DmaDataLen = u32DataLen;
+    psSvc->pu8DmaSpare = pu8Spare;
+    psSvc->u32DmaSpareLen = u32SpareLen;
+    psSvc->u32State = SFLASH_ST_DMA;
+    psSvc->sStat.u32DmaXfers++;
+
+    PDMA_SetTransferMode(pdma, u32Ch, u32Req, TRUE, ptr_to_u32(psSvc->au32Desc[0]));
+    if (u32Dir == SFLASH_DIR_TX)
+    {
+        qspi->CTL = u32Ctl;
+        QSPI_TRIGGER_TX_PDMA(qspi);
+    }
+    else if (u32Io != 1UL)
+    {
+        /* Dual and quad input clock in data as PDMA drains the RX FIFO */
+        qspi->CTL = u32Ctl;
+        QSPI_TRIGGER_RX_PDMA(qspi);
+    }
+    else
+    {
+        /* A single-line read needs receive-only mode for the clock; PDMA must be ready first */
+        QSPI_TRIGGER_RX_PDMA(qspi);
+        qspi->CTL = u32Ctl | QSPI_CTL_RXONLY_Msk;
+    }
+}
+
+/* Retire the data phase: back to 1-bit command mode with SS high */
+static void SFLASHSVC_EndData(SFLASH_SVC_T *psSvc)
+{
+    QSPI_T   *qspi = psSvc->sCfg.qspi;
+    uint32_t u32Ch = (psSvc->u32DmaDir == SFLASH_DIR_RX) ? psSvc->sCfg.u32RxCh : psSvc->sCfg.u32TxCh;
+
+    PDMA_CLR_TD_FLAG(psSvc->sCfg.pdma, 1UL << u32Ch);
+    if (psSvc->u32DmaDir == SFLASH_DIR_RX)
+        qspi->CTL &= ~QSPI_CTL_RXONLY_Msk;
+    QSPI_DISABLE_TX_RX_PDMA(qspi);
+    while (QSPI_IS_BUSY(qspi)) {}
+    QSPI_SET_SS_HIGH(qspi);
+    qspi->CTL = psSvc->u32Ctl;
+
+    /* Receive-only mode and single-line writes leave bytes behind in the RX FIFO */
+    QSPI_ClearRxFIFO(qspi);
+    while (qspi->STATUS & QSPI_STATUS_TXRXRST_Msk) {}
+
+    if (psSvc->u32DmaDir == SFLASH_DIR_RX)
+    {
+        dcache_invalidate_by_mva(psSvc->pu8DmaData, psSvc->u32DmaDataLen);
+        if (psSvc->u32DmaSpareLen != 0UL)
+            dcache_invalidate_by_mva(psSvc->pu8DmaSpare, psSvc->u32DmaSpareLen);
+    }
+    psSvc->u32State = SFLASH_ST_IDLE;
+}
+
+/* Account for the on-die ECC result of a page read */
+static void SFLASHSVC_CheckEcc(SFLASH_SVC_T *psSvc, uint8_t u8Sr, uint32_t u32Pages)
+{
+    SFLASH_SVC_REQ_T *psReq = psSvc->psHead;
+    uint32_t u32Ecc = (u8Sr & SNAND_SR_ECC_Msk) >> SNAND_SR_ECC_Pos;
+
+    /* 10b is uncorrectable on every part; 11b is too in continuous read, a corrected page otherwise */
+    if ((u32Ecc == 2UL) || ((u32Ecc == 3UL) && (psSvc->u32Seq == SFLASH_SEQ_CONT)))
+    {
+        psSvc->sStat.u32EccFailed += u32Pages;
+        if (psSvc->i32Err == SFLASH_SVC_OK)
+            psSvc->i32Err = SFLASH_SVC_ERR_ECC;
+    }
+    else if (u32Ecc != 0UL)
+    {
+        psSvc->sStat.u32EccCorrected += u32Pages;
+        psReq->u32Corrected += u32Pages;
+    }
+}
+
+static void SFLASHSVC_SetBuf(SFLASH_SVC_T *psSvc, uint32_t u32On)
+{
+    uint8_t u8Cfg = SFLASHSVC_GetFeature(psSvc, SNAND_REG_CFG);
+
+    u8Cfg = u32On ? (u8Cfg | SNAND_CFG_BUF) : (u8Cfg & ~SNAND_CFG_BUF);
+    SFLASHSVC_SetFeature(psSvc, SNAND_REG_CFG, u8Cfg);
+}
+
+/*
+ *  Start the next step of a SPI-NAND read. Returns SFLASH_SVC_PENDING with the
+ *  data phase on PDMA, or a negative error.
+ */
+static int32_t SFLASHSVC_NandRead(SFLASH_SVC_T *psSvc, SFLASH_SVC_REQ_T *psReq)
+{
+    uint32_t u32Page = psReq->u32Page + psReq->u32Done;
+    uint32_t u32Left = psReq->u32Count - psReq->u32Done;
+    uint32_t u32PageSize = psSvc->sInfo.u32PageSize;
+    uint32_t u32SpareSize = psSvc->sInfo.u32SpareSize;
+    uint8_t  *pu8Spare = NULL;
+    uint8_t  u8Sr;
+    int32_t  i32Ret;
+
+    if ((psSvc->sInfo.u32Flags & SFLASH_SVC_FLAG_CONT_READ) && (psReq->pu8Spare == NULL) && (u32Left > 1UL))
+    {
+        /* Main areas of consecutive pages back to back, one transfer per SFLASH_SVC_DMA_MAX bytes */
+        psSvc->u32Chunk = (u32Left < SFLASH_SVC_DMA_MAX / u32PageSize) ? u32Left : SFLASH_SVC_DMA_MAX / u32PageSize;
+        psSvc->u32Seq = SFLASH_SEQ_CONT;
+        SFLASHSVC_SetBuf(psSvc, 0UL);
+        SFLASHSVC_RowCmd(psSvc, SNAND_CMD_PAGE_READ, u32Page);
+        i32Ret = SFLASHSVC_WaitReady(psSvc, SFLASH_TMO_READ, &u8Sr);
+        if (i32Ret != SFLASH_SVC_OK)
+        {
+            psSvc->u32Seq = SFLASH_SEQ_PAGE;
+            SFLASHSVC_SetBuf(psSvc, 1UL);
+            return i32Ret;
+        }
+        /* The column address bytes are dummy cycles with BUF=0 */
+        SFLASHSVC_Header(psSvc, psSvc->u8ReadOp, 0UL, 2UL, psSvc->u8ReadDummy);
+        SFLASHSVC_StartData(psSvc, SFLASH_DIR_RX, psSvc->sInfo.u32ReadIo, psReq->pu8Data + psReq->u32Done * u32PageSize,
+                            psSvc->u32Chunk * u32PageSize, NULL, 0UL);
+        return SFLASH_SVC_PENDING;
+    }
+
+    if (psSvc->u32Seq != SFLASH_SEQ_CACHE)
+    {
+        SFLASHSVC_RowCmd(psSvc, SNAND_CMD_PAGE_READ, u32Page);
+        i32Ret = SFLASHSVC_WaitReady(psSvc, SFLASH_TMO_READ, &u8Sr);
+        if (i32Ret != SFLASH_SVC_OK)
+            return i32Ret;
+        if ((psSvc->sInfo.u32Flags & SFLASH_SVC_FLAG_CACHE_READ) && (u32Left > 1UL))
+            psSvc->u32Seq = SFLASH_SEQ_CACHE;
+    }
+
+    if (psSvc->u32Seq == SFLASH_SEQ_CACHE)
+    {
+        /* Move this page to the cache; 31h also starts loading the next one into the data register */
+        SFLASHSVC_Cmd1(psSvc, (u32Left > 1UL) ? SNAND_CMD_CACHE_READ_SEQ : SNAND_CMD_CACHE_READ_END);
+        if (u32Left == 1UL)
+            psSvc->u32Seq = SFLASH_SEQ_PAGE;
+        i32Ret = SFLASHSVC_WaitReady(psSvc, SFLASH_TMO_READ, &u8Sr);
+        if (i32Ret != SFLASH_SVC_OK)
+        {
+            psSvc->u32Seq = SFLASH_SEQ_PAGE;
+            SFLASHSVC_Cmd1(psSvc, SNAND_CMD_RESET);
+            return i32Ret;
+        }
+    }
+
+    SFLASHSVC_CheckEcc(psSvc, u8Sr, 1UL);
+
+    if (psReq->pu8Spare != NULL)
+        pu8Spare = psReq->pu8Spare + psReq->u32Done * u32SpareSize;
+    psSvc->u32Chunk = 1UL;
+    SFLASHSVC_Header(psSvc, psSvc->u8ReadOp, SFLASHSVC_Column(psSvc, u32Page, 0UL), 2UL, psSvc->u8ReadDummy);
+    SFLASHSVC_StartData(psSvc, SFLASH_DIR_RX, psSvc->sInfo.u32ReadIo, psReq->pu8Data + psReq->u32Done * u32PageSize,
+                        u32PageSize, pu8Spare, (pu8Spare != NULL) ? u32SpareSize : 0UL);
+    return SFLASH_SVC_PENDING;
+}
+
+/* Start the next unit of the request at the head of the queue */
+static int32_t SFLASHSVC_StartUnit(SFLASH_SVC_T *psSvc, SFLASH_SVC_REQ_T *psReq)
+{
+    uint32_t u32PageSize = psSvc->sInfo.u32PageSize;
+    uint32_t u32Page = psReq->u32Page + psReq->u32Done;
+    uint32_t u32Left = psReq->u32Count - psReq->u32Done;
+    uint32_t u32Nand = SFLASHSVC_IsNand(psSvc);
+    uint8_t  *pu8Spare = NULL;
+
+    switch (psReq->u32Op)
+    {
+    case SFLASH_SVC_OP_READ:
+        if (u32Nand)
+            return SFLASHSVC_NandRead(psSvc, psReq);
+
+        psSvc->u32Chunk = (u32Left < SFLASH_SVC_DMA_MAX / u32PageSize) ? u32Left : SFLASH_SVC_DMA_MAX / u32PageSize;
+        SFLASHSVC_Header(psSvc, psSvc->u8ReadOp, u32Page * u32PageSize, psSvc->u8AddrBytes, psSvc->u8ReadDummy);
+        SFLASHSVC_StartData(psSvc, SFLASH_DIR_RX, psSvc->sInfo.u32ReadIo, psReq->pu8Data + psReq->u32Done * u32PageSize,
+                            psSvc->u32Chunk * u32PageSize, NULL, 0UL);
+        return SFLASH_SVC_PENDING;
+
+    case SFLASH_SVC_OP_PROGRAM:
+        psSvc->u32Chunk = 1UL;
+        SFLASHSVC_Cmd1(psSvc, SF_CMD_WREN);
+        if (u32Nand)
+        {
+            /* Program load fills the rest of the cache, spare included, with FFh */
+            if (psReq->pu8Spare != NULL)
+                pu8Spare = psReq->pu8Spare + psReq->u32Done * psSvc->sInfo.u32SpareSize;
+            SFLASHSVC_Header(psSvc, psSvc->u8ProgOp, SFLASHSVC_Column(psSvc, u32Page, 0UL), 2UL, 0UL);
+        }
+        else
+        {
+            SFLASHSVC_Header(psSvc, psSvc->u8ProgOp, u32Page * u32PageSize, psSvc->u8AddrBytes, 0UL);
+        }
+        SFLASHSVC_StartData(psSvc, SFLASH_DIR_TX, psSvc->sInfo.u32ProgIo, psReq->pu8Data + psReq->u32Done * u32PageSize,
+                            u32PageSize, pu8Spare, (pu8Spare != NULL) ? psSvc->sInfo.u32SpareSize : 0UL);
+        return SFLASH_SVC_PENDING;
+
+    default:
+        u32Page = psReq->u32Page + psReq->u32Done * psSvc->sInfo.u32PagesPerBlock;
+        SFLASHSVC_Cmd1(psSvc, SF_CMD_WREN);
+        if (u32Nand)
+        {
+            SFLASHSVC_RowCmd(psSvc, psSvc->u8EraseOp, u32Page);
+            psSvc->u64Deadline = SFLASHSVC_Deadline(SFLASH_TMO_NAND_ERASE);
+        }
+        else
+        {
+            SFLASHSVC_Header(psSvc, psSvc->u8EraseOp, u32Page * u32PageSize, psSvc->u8AddrBytes, 0UL);
+            while (QSPI_IS_BUSY(psSvc->sCfg.qspi)) {}
+            QSPI_SET_SS_HIGH(psSvc->sCfg.qspi);
+            psSvc->u64Deadline = SFLASHSVC_Deadline(SFLASH_TMO_NOR_ERASE);
+        }
+        psSvc->u32State = SFLASH_ST_BUSY;
+        return SFLASH_SVC_PENDING;
+    }
+}
+
+/*
+ *  Finish the request at the head of the queue and start the next one.
+ *  The callback runs after the port has been handed to the next request.
+ */
+static void SFLASHSVC_Complete(SFLASH_SVC_T *psSvc, int32_t i32Status)
+{
+    SFLASH_SVC_REQ_T *psReq = psSvc->psHead;
+
+    psSvc->psHead = psReq->psNext;
+    if (psSvc->psHead == NULL)
+        psSvc->psTail = NULL;
+    psSvc->i32Err = SFLASH_SVC_OK;
+
+    if (i32Status == SFLASH_SVC_OK)
+        psSvc->sStat.u32Requests++;
+    else
+        psSvc->sStat.u32Errors++;
+
+    __DMB();
+    psReq->i32Status = i32Status;
+    if (psReq->pfnDone != NULL)
+        psReq->pfnDone(psReq);
+}
+
+/* Run requests until one waits for PDMA or for the flash */
+static void SFLASHSVC_Run(SFLASH_SVC_T *psSvc)
+{
+    SFLASH_SVC_REQ_T *psReq;
+    int32_t i32Ret;
+
+    while ((psSvc->u32State == SFLASH_ST_IDLE) && ((psReq = psSvc->psHead) != NULL))
+    {
+        if (psReq->u32Done == psReq->u32Count)
+        {
+            SFLASHSVC_Complete(psSvc, psSvc->i32Err);
+            continue;
+        }
+
+        i32Ret = SFLASHSVC_StartUnit(psSvc, psReq);
+        if (i32Ret < 0)
+            SFLASHSVC_Complete(psSvc, i32Ret);
+    }
+}
+
+/* The data phase in flight has finished */
+static void SFLASHSVC_DataDone(SFLASH_SVC_T *psSvc)
+{
+    SFLASH_SVC_REQ_T *psReq = psSvc->psHead;
+    uint8_t u8Sr;
+
+    SFLASHSVC_EndData(psSvc);
+
+    if (psReq->u32Op == SFLASH_SVC_OP_READ)
+    {
+        if (psSvc->u32Seq == SFLASH_SEQ_CONT)
+        {
+            /* In continuous read the ECC bits sum up every page of the run */
+            u8Sr = SFLASHSVC_GetFeature(psSvc, SNAND_REG_STATUS);
+            SFLASHSVC_CheckEcc(psSvc, u8Sr, psSvc->u32Chunk);
+            SFLASHSVC_SetBuf(psSvc, 1UL);
+            psSvc->u32Seq = SFLASH_SEQ_PAGE;
+        }
+        psReq->u32Done += psSvc->u32Chunk;
+        psSvc->sStat.u32PagesRead += psSvc->u32Chunk;
+        return;
+    }
+
+    /* Program: the page is in the flash buffer */
+    if (SFLASHSVC_IsNand(psSvc))
+        SFLASHSVC_RowCmd(psSvc, SNAND_CMD_PROG_EXEC, psReq->u32Page + psReq->u32Done);
+    psSvc->u64Deadline = SFLASHSVC_Deadline(SFLASH_TMO_PROGRAM);
+    psSvc->u32State = SFLASH_ST_BUSY;
+}
+
+/* The flash has finished a program or erase */
+static void SFLASHSVC_FlashDone(SFLASH_SVC_T *psSvc, uint8_t u8Sr)
+{
+    SFLASH_SVC_REQ_T *psReq = psSvc->psHead;
+
+    psSvc->u32State = SFLASH_ST_IDLE;
+    if (psReq->u32Op == SFLASH_SVC_OP_PROGRAM)
+    {
+        if (SFLASHSVC_IsNand(psSvc) && (u8Sr & SNAND_SR_P_FAIL))
+        {
+            SFLASHSVC_Complete(psSvc, SFLASH_SVC_ERR_PROGRAM);
+            return;
+        }
+        psSvc->sStat.u32PagesProgrammed++;
+    }
+    else
+    {
+        if (SFLASHSVC_IsNand(psSvc) && (u8Sr & SNAND_SR_E_FAIL))
+        {
+            SFLASHSVC_Complete(psSvc, SFLASH_SVC_ERR_ERASE);
+            return;
+        }
+        psSvc->sStat.u32BlocksErased++;
+    }
+    psReq->u32Done++;
+}
+
+/* Advance the engine; the PDMA interrupt is masked or this is the PDMA interrupt */
+static void SFLASHSVC_Service(SFLASH_SVC_T *psSvc)
+{
+    uint32_t u32Ch;
+    uint8_t  u8Sr;
+
+    if (psSvc->u32State == SFLASH_ST_DMA)
+    {
+        u32Ch = (psSvc->u32DmaDir == SFLASH_DIR_RX) ? psSvc->sCfg.u32RxCh : psSvc->sCfg.u32TxCh;
+        if (!(PDMA_GET_TD_STS(psSvc->sCfg.pdma) & (1UL << u32Ch)))
+            return;
+        SFLASHSVC_DataDone(psSvc);
+    }
+
+    if (psSvc->u32State == SFLASH_ST_BUSY)
+    {
+        u8Sr = SFLASHSVC_Status(psSvc);
+        if (u8Sr & SF_SR_BUSY)
+        {
+            if (!SFLASHSVC_Expired(psSvc->u64Deadline))
+                return;
+            psSvc->sStat.u32Timeouts++;
+            psSvc->u32State = SFLASH_ST_IDLE;
+            SFLASHSVC_Complete(psSvc, SFLASH_SVC_ERR_TIMEOUT);
+        }
+        else
+        {
+            SFLASHSVC_FlashDone(psSvc, u8Sr);
+        }
+    }
+
+    SFLASHSVC_Run(psSvc);
+}
+
+/* Wait for a request submitted by one of the synchronous wrappers */
+static int32_t SFLASHSVC_Wait(SFLASH_SVC_T *psSvc, SFLASH_SVC_REQ_T *psReq)
+{
+    int32_t i32Ret = SFLASHSVC_Submit(psSvc, psReq);
+
+    if (i32Ret != SFLASH_SVC_PENDING)
+        return i32Ret;
+    while (psReq->i32Status == SFLASH_SVC_PENDING)
+        SFLASHSVC_Poll(psSvc);
+    return psReq->i32Status;
+}
+
+/* Read SFDP bytes: 5Ah, 3-byte address, 8 dummy clocks */
+static void SFLASHSVC_ReadSfdp(SFLASH_SVC_T *psSvc, uint32_t u32Addr, uint8_t *pu8Buf, uint32_t u32Len)
+{
+    SFLASHSVC_Header(psSvc, SNOR_CMD_SFDP, u32Addr, 3UL, 8UL);
+    SFLASHSVC_Pio(psSvc->sCfg.qspi, NULL, 0UL, pu8Buf, u32Len);
+    while (QSPI_IS_BUSY(psSvc->sCfg.qspi)) {}
+    QSPI_SET_SS_HIGH(psSvc->sCfg.qspi);
+}
+
+/* Set the SPI-NOR quad enable bit the way BFPT DWORD 15 bits 22:20 describe */
+static int32_t SFLASHSVC_NorSetQe(SFLASH_SVC_T *psSvc, uint32_t u32Qer)
+{
+    uint8_t au8Cmd[3], u8Sr1, u8Sr2;
+
+    au8Cmd[0] = SNOR_CMD_RDSR;
+    SFLASHSVC_Cmd(psSvc, au8Cmd, 1UL, &u8Sr1, 1UL);
+
+    switch (u32Qer)
+    {
+    case 0UL:
+        return SFLASH_SVC_OK;
+    case 1UL:
+    case 4UL:
+        /* QE is SR2 bit 1, written together with SR1; SR2 may not be readable */
+        au8Cmd[0] = SNOR_CMD_WRSR;
+        au8Cmd[1] = u8Sr1;
+        au8Cmd[2] = 0x02U;
+        break;
+    case 2UL:
+        if (u8Sr1 & 0x40U)
+            return SFLASH_SVC_OK;
+        au8Cmd[0] = SNOR_CMD_WRSR;
+        au8Cmd[1] = u8Sr1 | 0x40U;
+        break;
+    case 3UL:
+        au8Cmd[0] = SNOR_CMD_RDSR2_B7;
+        SFLASHSVC_Cmd(psSvc, au8Cmd, 1UL, &u8Sr2, 1UL);
+        if (u8Sr2 & 0x80U)
+            return SFLASH_SVC_OK;
+        au8Cmd[0] = SNOR_CMD_WRSR2_B7;
+        au8Cmd[1] = u8Sr2 | 0x80U;
+        break;
+    case 5UL:
+    case 6UL:
+        au8Cmd[0] = SNOR_CMD_RDSR2;
+        SFLASHSVC_Cmd(psSvc, au8Cmd, 1UL, &u8Sr2, 1UL);
+        if (u8Sr2 & 0x02U)
+            return SFLASH_SVC_OK;
+        au8Cmd[0] = (u32Qer == 5UL) ? SNOR_CMD_WRSR : SNOR_CMD_WRSR2;
+        au8Cmd[1] = (u32Qer == 5UL) ? u8Sr1 : (uint8_t)(u8Sr2 | 0x02U);
+        au8Cmd[2] = u8Sr2 | 0x02U;
+        break;
+    default:
+        return SFLASH_SVC_ERR_NODEV;
+    }
+
+    SFLASHSVC_Cmd1(psSvc, SF_CMD_WREN);
+    SFLASHSVC_Cmd(psSvc, au8Cmd, ((u32Qer == 2UL) || (u32Qer == 3UL) || (u32Qer == 6UL)) ? 2UL : 3UL, NULL, 0UL);
+    return SFLASHSVC_WaitReady(psSvc, SFLASH_TMO_WRSR, NULL);
+}
+
+/* Configure a SPI-NOR part from its SFDP basic parameter table (JESD216) */
+static int32_t SFLASHSVC_ProbeSfdp(SFLASH_SVC_T *psSvc)
+{
+    SFLASH_SVC_INFO_T *psInfo = &psSvc->sInfo;
+    uint32_t au32Dw[16], u32Len, u32Ptr, u32Size, u32Erase = 0UL, u32Exp, i;
+    uint32_t u32TypeSize, u32Better;
+    uint32_t u32Quad = !(psSvc->sCfg.u32Flags & (SFLASH_SVC_CFG_NO_QUAD | SFLASH_SVC_CFG_SINGLE));
+    uint32_t u32Dual = !(psSvc->sCfg.u32Flags & SFLASH_SVC_CFG_SINGLE);
+    uint32_t u32Dummy;
+    uint8_t  au8Buf[64];
+    int32_t  i32Ret;
+
+    SFLASHSVC_ReadSfdp(psSvc, 0UL, au8Buf, 16UL);
+    if (memcmp(au8Buf, "SFDP", 4) != 0)
+        return SFLASH_SVC_ERR_NODEV;
+
+    /* The first parameter header is the basic flash parameter table, ID FF00h */
+    u32Len = au8Buf[11];
+    u32Ptr = au8Buf[12] | ((uint32_t)au8Buf[13] << 8) | ((uint32_t)au8Buf[14] << 16);
+    if ((au8Buf[8] != 0x00U) || (au8Buf[15] != 0xFFU) || (u32Len < 9UL))
+        return SFLASH_SVC_ERR_NODEV;
+    if (u32Len > 16UL)
+        u32Len = 16UL;
+
+    memset(au32Dw, 0, sizeof(au32Dw));
+    SFLASHSVC_ReadSfdp(psSvc, u32Ptr, au8Buf, u32Len * 4UL);
+    for (i = 0UL; i < u32Len; i++)
+        au32Dw[i] = au8Buf[4 * i] | ((uint32_t)au8Buf[4 * i + 1] << 8) | ((uint32_t)au8Buf[4 * i + 2] << 16) |
+                    ((uint32_t)au8Buf[4 * i + 3] << 24);
+
+    /* DWORD 2: density in bits */
+    if (au32Dw[1] & 0x80000000UL)
+    {
+        u32Exp = au32Dw[1] & 0x7FFFFFFFUL;
+        if ((u32Exp < 3UL) || (u32Exp > 34UL))
+            return SFLASH_SVC_ERR_NODEV;
+        u32Size = 1UL << (u32Exp - 3UL);
+    }
+    else
+    {
+        u32Size = (au32Dw[1] >> 3) + 1UL;
+    }
+
+    /* DWORD 1 bits 18:17: 3-byte only, 3 or 4, 4-byte only */
+    psSvc->u8AddrBytes = 3U;
+    if (u32Size > 0x1000000UL)
+    {
+        switch ((au32Dw[0] >> 17) & 0x3UL)
+        {
+        case 0UL:
+            u32Size = 0x1000000UL;
+            break;
+        case 1UL:
+            SFLASHSVC_Cmd1(psSvc, SF_CMD_WREN);
+            SFLASHSVC_Cmd1(psSvc, SNOR_CMD_EN4B);
+            psSvc->u8AddrBytes = 4U;
+            break;
+        default:
+            psSvc->u8AddrBytes = 4U;
+            break;
+        }
+    }
+
+    /* DWORDs 8 and 9: four erase types, size as a power of two and opcode */
+    for (i = 0UL; i < 4UL; i++)
+    {
+        u32Exp = (au32Dw[7UL + i / 2UL] >> (16UL * (i % 2UL))) & 0xFFUL;
+        if ((u32Exp == 0UL) || (u32Exp > 24UL))
+            continue;
+        u32TypeSize = 1UL << u32Exp;
+
+        /* Smallest type on request, otherwise 64 KB, otherwise the largest */
+        if (psSvc->sCfg.u32Flags & SFLASH_SVC_CFG_NOR_SMALL_ERASE)
+            u32Better = (u32Erase == 0UL) || (u32TypeSize < u32Erase);
+        else
+            u32Better = (u32Erase == 0UL) || ((u32Erase != 0x10000UL) && ((u32TypeSize == 0x10000UL) || (u32TypeSize > u32Erase)));
+        if (u32Better)
+        {
+            u32Erase = u32TypeSize;
+            psSvc->u8EraseOp = (uint8_t)(au32Dw[7UL + i / 2UL] >> (16UL * (i % 2UL) + 8UL));
+        }
+    }
+    if (u32Erase == 0UL)
+        return SFLASH_SVC_ERR_NODEV;
+
+    /* DWORD 11 bits 7:4: page size, JESD216A and later */
+    psInfo->u32PageSize = (u32Len >= 11UL) ? (1UL << ((au32Dw[10] >> 4) & 0xFUL)) : 256UL;
+    if ((psInfo->u32PageSize < 4UL) || (psInfo->u32PageSize > u32Erase))
+        psInfo->u32PageSize = 256UL;
+
+    /* Fast read: 1-1-4 (DWORD 1 bit 22, DWORD 3), else 1-1-2 (bit 16, DWORD 4), else 0Bh */
+    psSvc->u8ReadOp = SNOR_CMD_FAST_READ;
+    psSvc->u8ReadDummy = 8U;
+    psInfo->u32ReadIo = 1UL;
+    u32Dummy = ((au32Dw[2] >> 16) & 0x1FUL) + ((au32Dw[2] >> 21) & 0x7UL);
+    if (u32Quad && (au32Dw[0] & (1UL << 22)) && ((u32Dummy == 0UL) || (u32Dummy >= 8UL)))
+    {
+        psSvc->u8ReadOp = (uint8_t)(au32Dw[2] >> 24);
+        psSvc->u8ReadDummy = (uint8_t)u32Dummy;
+        psInfo->u32ReadIo = 4UL;
+    }
+    else
+    {
+        u32Dummy = (au32Dw[3] & 0x1FUL) + ((au32Dw[3] >> 5) & 0x7UL);
+        if (u32Dual && (au32Dw[0] & (1UL << 16)) && ((u32Dummy == 0UL) || (u32Dummy >= 8UL)))
+        {
+            psSvc->u8ReadOp = (uint8_t)(au32Dw[3] >> 8);
+            psSvc->u8ReadDummy = (uint8_t)u32Dummy;
+            psInfo->u32ReadIo = 2UL;
+        }
+    }
+
+    if (psInfo->u32ReadIo == 4UL)
+    {
+        /* DWORD 15 bits 22:20: quad enable requirement */
+        i32Ret = SFLASHSVC_NorSetQe(psSvc, (u32Len >= 15UL) ? ((au32Dw[14] >> 20) & 0x7UL) : 0UL);
+        if (i32Ret != SFLASH_SVC_OK)
+            return i32Ret;
+    }
+
+    psInfo->u32BlockSize = u32Erase;
+    psInfo->u32Blocks = u32Size / u32Erase;
+    psInfo->u32Flags |= SFLASH_SVC_FLAG_SFDP;
+    return SFLASH_SVC_OK;
+}
+
+static int32_t SFLASHSVC_Probe(SFLASH_SVC_T *psSvc)
+{
+    SFLASH_SVC_INFO_T *psInfo = &psSvc->sInfo;
+    uint32_t u32Quad = !(psSvc->sCfg.u32Flags & (SFLASH_SVC_CFG_NO_QUAD | SFLASH_SVC_CFG_SINGLE));
+    uint32_t u32Dual = !(psSvc->sCfg.u32Flags & SFLASH_SVC_CFG_SINGLE);
+    uint32_t u32Id, i;
+    uint8_t  u8Op = SF_CMD_RDID, au8Id[4], u8Cfg;
+
+    /* Reset whichever kind of part is there; each ignores the other's reset */
+    SFLASHSVC_Cmd1(psSvc, SNAND_CMD_RESET);
+    SFLASHSVC_DelayUs(SFLASH_TMO_RESET);
+    SFLASHSVC_Cmd1(psSvc, SNOR_CMD_RSTEN);
+    SFLASHSVC_Cmd1(psSvc, SNOR_CMD_RST);
+    SFLASHSVC_DelayUs(SFLASH_TMO_RESET);
+
+    SFLASHSVC_Cmd(psSvc, &u8Op, 1UL, au8Id, 4UL);
+
+    /* SPI-NAND: the ID follows a dummy byte */
+    for (i = 0UL; i < sizeof(s_asNandId) / sizeof(s_asNandId[0]); i++)
+    {
+        const SFLASH_SVC_NAND_ID_T *psId = &s_asNandId[i];
+
+        u32Id = (psId->u8IdLen == 3U) ? (((uint32_t)au8Id[1] << 16) | ((uint32_t)au8Id[2] << 8) | au8Id[3]) :
+                (((uint32_t)au8Id[1] << 8) | au8Id[2]);
+        if (u32Id != psId->u32Id)
+            continue;
+
+        psInfo->u32Type = SFLASH_SVC_TYPE_NAND;
+        psInfo->u32JedecId = u32Id;
+        psInfo->u32PageSize = psId->u16PageSize;
+        psInfo->u32SpareSize = psId->u16SpareSize;
+        psInfo->u32PagesPerBlock = psId->u16PagesPerBlock;
+        psInfo->u32Blocks = psId->u16Blocks;
+        psInfo->u32BlockSize = psInfo->u32PageSize * psInfo->u32PagesPerBlock;
+        psInfo->u32Flags = psId->u32Flags;
+        psInfo->u32ReadIo = u32Quad ? 4UL : (u32Dual ? 2UL : 1UL);
+        psInfo->u32ProgIo = u32Quad ? 4UL : 1UL;
+        psSvc->u8ReadOp = u32Quad ? SNAND_CMD_READ_CACHE_X4 : (u32Dual ? SNAND_CMD_READ_CACHE_X2 : SNAND_CMD_READ_CACHE);
+        psSvc->u8ReadDummy = 8U;
+        psSvc->u8ProgOp = u32Quad ? SNAND_CMD_PROG_LOAD_X4 : SNAND_CMD_PROG_LOAD;
+        psSvc->u8EraseOp = SNAND_CMD_BLOCK_ERASE;
+        if (!u32Quad)
+            psInfo->u32Flags &= ~SFLASH_SVC_FLAG_QE;
+
+        /* Blocks come up write protected; on-die ECC on, buffer read mode, quad enable if needed */
+        SFLASHSVC_SetFeature(psSvc, SNAND_REG_PROT, 0x00U);
+        u8Cfg = SFLASHSVC_GetFeature(psSvc, SNAND_REG_CFG) | SNAND_CFG_ECC_EN;
+        if (psInfo->u32Flags & SFLASH_SVC_FLAG_CONT_READ)
+            u8Cfg |= SNAND_CFG_BUF;
+        if (psInfo->u32Flags & SFLASH_SVC_FLAG_QE)
+            u8Cfg |= SNAND_CFG_QE;
+        SFLASHSVC_SetFeature(psSvc, SNAND_REG_CFG, u8Cfg);
+        return SFLASH_SVC_OK;
+    }
+
+    /* SPI-NOR: the ID comes right after the opcode */
+    if ((au8Id[0] == 0x00U) || (au8Id[0] == 0xFFU))
+        return SFLASH_SVC_ERR_NODEV;
+    psInfo->u32Type = SFLASH_SVC_TYPE_NOR;
+    psInfo->u32JedecId = ((uint32_t)au8Id[0] << 16) | ((uint32_t)au8Id[1] << 8) | au8Id[2];
+    psSvc->u8ProgOp = SNOR_CMD_PP;
+    psInfo->u32ProgIo = 1UL;
+
+    if (SFLASHSVC_ProbeSfdp(psSvc) != SFLASH_SVC_OK)
+    {
+        /* No usable SFDP: size from the capacity byte, single-line commands, 64 KB blocks */
+        if ((au8Id[2] < 0x10U) || (au8Id[2] > 0x18U))
+            return SFLASH_SVC_ERR_NODEV;
+        psInfo->u32Flags = 0UL;
+        psInfo->u32PageSize = 256UL;
+        psInfo->u32BlockSize = 0x10000UL;
+        psInfo->u32Blocks = (1UL << au8Id[2]) / psInfo->u32BlockSize;
+        psInfo->u32ReadIo = 1UL;
+        psSvc->u8ReadOp = SNOR_CMD_FAST_READ;
+        psSvc->u8ReadDummy = 8U;
+        psSvc->u8EraseOp = SNOR_CMD_BE_64K;
+        psSvc->u8AddrBytes = 3U;
+        if (psSvc->sCfg.u32Flags & SFLASH_SVC_CFG_NOR_SMALL_ERASE)
+        {
+            psInfo->u32BlockSize = 0x1000UL;
+            psInfo->u32Blocks = (1UL << au8Id[2]) / psInfo->u32BlockSize;
+            psSvc->u8EraseOp = SNOR_CMD_SE_4K;
+        }
+    }
+    else if ((psInfo->u32ReadIo == 4UL) && ((au8Id[0] == 0xEFU) || (au8Id[0] == 0xC8U)))
+    {
+        /* SFDP has no program opcodes; Winbond and GigaDevice parts take 1-1-4 page program as 32h */
+        psSvc->u8ProgOp = SNOR_CMD_PP_1_1_4;
+        psInfo->u32ProgIo = 4UL;
+    }
+
+    psInfo->u32PagesPerBlock = psInfo->u32BlockSize / psInfo->u32PageSize;
+    return SFLASH_SVC_OK;
+}
+
+/* Synchronous single-line access to the spare area of the first page of a block */
+static int32_t SFLASHSVC_Marker(SFLASH_SVC_T *psSvc, uint32_t u32Block, uint32_t u32Mark, uint8_t *pu8Marker)
+{
+    uint32_t u32Page = u32Block * psSvc->sInfo.u32PagesPerBlock;
+    uint32_t u32Col = SFLASHSVC_Column(psSvc, u32Page, psSvc->sInfo.u32PageSize);
+    uint8_t  au8Cmd[6], u8Sr;
+    int32_t  i32Ret;
+
+    if (!SFLASHSVC_IsNand(psSvc) || (u32Block >= psSvc->sInfo.u32Blocks))
+        return SFLASH_SVC_ERR_PARAM;
+
+    IRQ_Disable(psSvc->sCfg.eIrq);
+    if (psSvc->psHead != NULL)
+    {
+        IRQ_Enable(psSvc->sCfg.eIrq);
+        return SFLASH_SVC_ERR_BUSY;
+    }
+
+    if (u32Mark)
+    {
+        au8Cmd[0] = SNAND_CMD_PROG_LOAD;
+        au8Cmd[1] = (uint8_t)(u32Col >> 8);
+        au8Cmd[2] = (uint8_t)u32Col;
+        au8Cmd[3] = 0x00U;
+        au8Cmd[4] = 0x00U;
+        SFLASHSVC_Cmd1(psSvc, SF_CMD_WREN);
+        SFLASHSVC_Cmd(psSvc, au8Cmd, 5UL, NULL, 0UL);
+        SFLASHSVC_RowCmd(psSvc, SNAND_CMD_PROG_EXEC, u32Page);
+        i32Ret = SFLASHSVC_WaitReady(psSvc, SFLASH_TMO_PROGRAM, &u8Sr);
+        if ((i32Ret == SFLASH_SVC_OK) && (u8Sr & SNAND_SR_P_FAIL))
+            i32Ret = SFLASH_SVC_ERR_PROGRAM;
+    }
+    else
+    {
+        SFLASHSVC_RowCmd(psSvc, SNAND_CMD_PAGE_READ, u32Page);
+        i32Ret = SFLASHSVC_WaitReady(psSvc, SFLASH_TMO_READ, NULL);
+        if (i32Ret == SFLASH_SVC_OK)
+        {
+            au8Cmd[0] = SNAND_CMD_READ_CACHE;
+            au8Cmd[1] = (uint8_t)(u32Col >> 8);
+            au8Cmd[2] = (uint8_t)u32Col;
+            au8Cmd[3] = 0xFFU;
+            SFLASHSVC_Cmd(psSvc, au8Cmd, 4UL, pu8Marker, 1UL);
+        }
+    }
+
+    IRQ_Enable(psSvc->sCfg.eIrq);
+    return i32Ret;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup SFLASH_SVC_EXPORTED_FUNCTIONS QSPI Serial Flash Service Exported Functions
+  @{
+*/
+
+/**
+ *    @brief        Open the serial flash on a QSPI port
+ *
+ *    @param[out]   psSvc   Service control block.
+ *    @param[in]    psCfg   Port configuration.
+ *
+ *    @retval       SFLASH_SVC_OK           Flash identified and configured
+ *    @retval       SFLASH_SVC_ERR_PARAM    Invalid configuration
+ *    @retval       SFLASH_SVC_ERR_NODEV    No supported flash answered
+ *    @retval       SFLASH_SVC_ERR_TIMEOUT  Flash did not finish writing its status register
+ *
+ *    @details      Opens the port in SPI mode 0 with software-controlled SS, resets the flash and
+ *                  configures it as described in the file header. SPI-NAND blocks are unprotected
+ *                  and on-die ECC is enabled. The application routes the PDMA interrupt to
+ *                  \ref SFLASHSVC_PDMA_IRQHandler and enables it; requests also complete without
+ *                  it, from \ref SFLASHSVC_Poll.
+ */
+int32_t SFLASHSVC_Open(SFLASH_SVC_T *psSvc, const SFLASH_SVC_CFG_T *psCfg)
+{
+    int32_t i32Ret;
+
+    if ((psCfg->qspi == NULL) || (psCfg->pdma == NULL) || (psCfg->u32BusClock == 0UL) ||
+            (psCfg->u32TxCh >= PDMA_CH_MAX) || (psCfg->u32RxCh >= PDMA_CH_MAX) || (psCfg->u32TxCh == psCfg->u32RxCh))
+        return SFLASH_SVC_ERR_PARAM;
+
+    memset(psSvc, 0, sizeof(SFLASH_SVC_T));
+    psSvc->sCfg = *psCfg;
+
+    QSPI_Open(psCfg->qspi, QSPI_MASTER, QSPI_MODE_0, 8UL, psCfg->u32BusClock);
+    QSPI_DisableAutoSS(psCfg->qspi);
+    QSPI_SET_SS_HIGH(psCfg->qspi);
+    psSvc->u32Ctl = psCfg->qspi->CTL;
+
+    i32Ret = SFLASHSVC_Probe(psSvc);
+    if (i32Ret != SFLASH_SVC_OK)
+    {
+        QSPI_Close(psCfg->qspi);
+        return i32Ret;
+    }
+
+    dcache_clean_invalidate_by_mva(psSvc->au32Desc, sizeof(psSvc->au32Desc));
+    PDMA_Open(psCfg->pdma, (1UL << psCfg->u32TxCh) | (1UL << psCfg->u32RxCh));
+    PDMA_EnableInt(psCfg->pdma, psCfg->u32TxCh, PDMA_INT_TRANS_DONE);
+    PDMA_EnableInt(psCfg->pdma, psCfg->u32RxCh, PDMA_INT_TRANS_DONE);
+
+    return SFLASH_SVC_OK;
+}
+
+/**
+ *    @brief        Close the serial flash service
+ *
+ *    @param[in]    psSvc   Service control block.
+ *
+ *    @return       None
+ *
+ *    @details      Waits for the request in progress to finish, then closes the port. Requests still
+ *                  queued behind it are left pending. The PDMA controller is left running for other
+ *                  users.
+ */
+void SFLASHSVC_Close(SFLASH_SVC_T *psSvc)
+{
+    while (psSvc->u32State != SFLASH_ST_IDLE)
+        SFLASHSVC_Poll(psSvc);
+
+    IRQ_Disable(psSvc->sCfg.eIrq);
+    psSvc->psHead = psSvc->psTail = NULL;
+    PDMA_DisableInt(psSvc->sCfg.pdma, psSvc->sCfg.u32TxCh, PDMA_INT_TRANS_DONE);
+    PDMA_DisableInt(psSvc->sCfg.pdma, psSvc->sCfg.u32RxCh, PDMA_INT_TRANS_DONE);
+    IRQ_Enable(psSvc->sCfg.eIrq);
+    QSPI_Close(psSvc->sCfg.qspi);
+}
+
+/**
+ *    @brief        Get the geometry and features of the flash
+ *
+ *    @param[in]    psSvc   Service control block.
+ *    @param[out]   psInfo  Device information.
+ *
+ *    @return       None
+ */
+void SFLASHSVC_GetInfo(SFLASH_SVC_T *psSvc, SFLASH_SVC_INFO_T *psInfo)
+{
+    *psInfo = psSvc->sInfo;
+}
+
+/**
+ *    @brief        Queue a read, program or erase request
+ *
+ *    @param[in]    psSvc   Service control block.
+ *    @param[in]    psReq   Request. u32Op, u32Page, u32Count, the buffers and pfnDone must be set.
+ *
+ *    @retval       SFLASH_SVC_PENDING      Request queued
+ *    @retval       SFLASH_SVC_ERR_PARAM    Invalid request
+ *
+ *    @details      The request starts right away when the service is idle. A read completes with
+ *                  \ref SFLASH_SVC_ERR_ECC if any page was uncorrectable, after reading the rest.
+ *                  A program or erase stops at the first failing page or block.
+ */
+int32_t SFLASHSVC_Submit(SFLASH_SVC_T *psSvc, SFLASH_SVC_REQ_T *psReq)
+{
+    SFLASH_SVC_INFO_T *psInfo = &psSvc->sInfo;
+    uint32_t u32Pages;
+
+    if ((psReq == NULL) || (psReq->u32Op > SFLASH_SVC_OP_ERASE) || (psReq->u32Count == 0UL))
+        return SFLASH_SVC_ERR_PARAM;
+
+    if (psReq->u32Op == SFLASH_SVC_OP_ERASE)
+    {
+        if ((psReq->u32Page % psInfo->u32PagesPerBlock) ||
+                (psReq->u32Count > psInfo->u32Blocks - psReq->u32Page / psInfo->u32PagesPerBlock))
+            return SFLASH_SVC_ERR_PARAM;
+    }
+    else
+    {
+        u32Pages = psInfo->u32Blocks * psInfo->u32PagesPerBlock;
+        if ((psReq->u32Page >= u32Pages) || (psReq->u32Count > u32Pages - psReq->u32Page) ||
+                (psReq->pu8Data == NULL) || (ptr_to_u32(psReq->pu8Data) & 0x3UL) ||
+                ((psReq->pu8Spare != NULL) && ((psInfo->u32SpareSize == 0UL) || (ptr_to_u32(psReq->pu8Spare) & 0x3UL))))
+            return SFLASH_SVC_ERR_PARAM;
+    }
+
+    psReq->psNext = NULL;
+    psReq->u32Done = 0UL;
+    psReq->u32Corrected = 0UL;
+    psReq->i32Status = SFLASH_SVC_PENDING;
+
+    IRQ_Disable(psSvc->sCfg.eIrq);
+    if (psSvc->psHead == NULL)
+    {
+        psSvc->psHead = psSvc->psTail = psReq;
+        SFLASHSVC_Run(psSvc);
+    }
+    else
+    {
+        psSvc->psTail->psNext = psReq;
+        psSvc->psTail = psReq;
+    }
+    IRQ_Enable(psSvc->sCfg.eIrq);
+
+    return SFLASH_SVC_PENDING;
+}
+
+/**
+ *    @brief        Check for program, erase and data phase completion
+ *
+ *    @param[in]    psSvc   Service control block.
+ *
+ *    @return       None
+ *
+ *    @details      Reads the flash status while a program or erase is in progress and moves on
+ *                  when it is done. Call periodically from one task, a timer or the main loop while
+ *                  requests are outstanding; once a millisecond keeps erases close to their
+ *                  datasheet time. Also retires a finished data phase when the PDMA interrupt is
+ *                  not used.
+ */
+void SFLASHSVC_Poll(SFLASH_SVC_T *psSvc)
+{
+    IRQ_Disable(psSvc->sCfg.eIrq);
+    if (psSvc->psHead != NULL)
+        SFLASHSVC_Service(psSvc);
+    IRQ_Enable(psSvc->sCfg.eIrq);
+}
+
+/**
+ *    @brief        Check whether the service has no request queued or in progress
+ *
+ *    @param[in]    psSvc   Service control block.
+ *
+ *    @retval       1   Idle
+ *    @retval       0   Busy
+ */
+uint32_t SFLASHSVC_IsIdle(SFLASH_SVC_T *psSvc)
+{
+    return (*(SFLASH_SVC_REQ_T * volatile *)&psSvc->psHead == NULL) ? 1UL : 0UL;
+}
+
+/**
+ *    @brief        Get service statistics
+ *
+ *    @param[in]    psSvc   Service control block.
+ *    @param[out]   psStat  Snapshot of the counters.
+ *
+ *    @return       None
+ */
+void SFLASHSVC_GetStat(SFLASH_SVC_T *psSvc, SFLASH_SVC_STAT_T *psStat)
+{
+    *psStat = psSvc->sStat;
+}
+
+/**
+ *    @brief        PDMA interrupt service for the serial flash
+ *
+ *    @param[in]    psSvc   Service control block.
+ *
+ *    @return       None
+ *
+ *    @details      Call from the PDMA IRQ handler. Only the transfer-done flags of the two channels
+ *                  of this service are handled, so other services can share the controller. Ends
+ *                  the data phase and starts the next page or request.
+ */
+void SFLASHSVC_PDMA_IRQHandler(SFLASH_SVC_T *psSvc)
+{
+    if ((psSvc->psHead != NULL) && (psSvc->u32State == SFLASH_ST_DMA))
+        SFLASHSVC_Service(psSvc);
+}
+
+/**
+ *    @brief        Read pages and wait for them
+ *
+ *    @param[in]    psSvc       Service control block.
+ *    @param[in]    u32Page     First page.
+ *    @param[in]    u32Count    Pages.
+ *    @param[out]   pu8Data     u32Count pages, 4-byte aligned.
+ *    @param[out]   pu8Spare    SPI-NAND spare areas, 4-byte aligned, or NULL.
+ *
+ *    @return       \ref SFLASH_SVC_OK or a negative error
+ */
+int32_t SFLASHSVC_Read(SFLASH_SVC_T *psSvc, uint32_t u32Page, uint32_t u32Count, uint8_t *pu8Data, uint8_t *pu8Spare)
+{
+    SFLASH_SVC_REQ_T sReq;
+
+    memset(&sReq, 0, sizeof(sReq));
+    sReq.u32Op = SFLASH_SVC_OP_READ;
+    sReq.u32Page = u32Page;
+    sReq.u32Count = u32Count;
+    sReq.pu8Data = pu8Data;
+    sReq.pu8Spare = pu8Spare;
+    return SFLASHSVC_Wait(psSvc, &sReq);
+}
+
+/**
+ *    @brief        Program erased pages and wait for them
+ *
+ *    @param[in]    psSvc       Service control block.
+ *    @param[in]    u32Page     First page.
+ *    @param[in]    u32Count    Pages.
+ *    @param[in]    pu8Data     u32Count pages, 4-byte aligned.
+ *    @param[in]    pu8Spare    SPI-NAND spare areas, 4-byte aligned, or NULL to leave them erased.
+ *
+ *    @return       \ref SFLASH_SVC_OK or a negative error
+ */
+int32_t SFLASHSVC_Program(SFLASH_SVC_T *psSvc, uint32_t u32Page, uint32_t u32Count, const uint8_t *pu8Data,
+                          const uint8_t *pu8Spare)
+{
+    SFLASH_SVC_REQ_T sReq;
+
+    memset(&sReq, 0, sizeof(sReq));
+    sReq.u32Op = SFLASH_SVC_OP_PROGRAM;
+    sReq.u32Page = u32Page;
+    sReq.u32Count = u32Count;
+    sReq.pu8Data = (uint8_t *)pu8Data;
+    sReq.pu8Spare = (uint8_t *)pu8Spare;
+    return SFLASHSVC_Wait(psSvc, &sReq);
+}
+
+/**
+ *    @brief        Erase blocks and wait for them
+ *
+ *    @param[in]    psSvc       Service control block.
+ *    @param[in]    u32Block    First block.
+ *    @param[in]    u32Count    Blocks.
+ *
+ *    @return       \ref SFLASH_SVC_OK or a negative error
+ */
+int32_t SFLASHSVC_Erase(SFLASH_SVC_T *psSvc, uint32_t u32Block, uint32_t u32Count)
+{
+    SFLASH_SVC_REQ_T sReq;
+
+    memset(&sReq, 0, sizeof(sReq));
+    sReq.u32Op = SFLASH_SVC_OP_ERASE;
+    sReq.u32Page = u32Block * psSvc->sInfo.u32PagesPerBlock;
+    sReq.u32Count = u32Count;
+    return SFLASHSVC_Wait(psSvc, &sReq);
+}
+
+/**
+ *    @brief        Check the bad block marker of a SPI-NAND block
+ *
+ *    @param[in]    psSvc       Service control block.
+ *    @param[in]    u32Block    Block.
+ *
+ *    @retval       1                       Block is marked bad
+ *    @retval       0                       Block is good
+ *    @retval       SFLASH_SVC_ERR_BUSY     Requests are queued
+ *    @retval       <0                      Other error
+ *
+ *    @details      Reads the first spare byte of the first page of the block, where factory and
+ *                  \ref SFLASHSVC_MarkBadBlock markers are kept. Needs an idle service.
+ */
+int32_t SFLASHSVC_IsBadBlock(SFLASH_SVC_T *psSvc, uint32_t u32Block)
+{
+    uint8_t u8Marker = 0xFFU;
+    int32_t i32Ret = SFLASHSVC_Marker(psSvc, u32Block, 0UL, &u8Marker);
+
+    if (i32Ret != SFLASH_SVC_OK)
+        return i32Ret;
+    return (u8Marker != 0xFFU) ? 1L : 0L;
+}
+
+/**
+ *    @brief        Mark a SPI-NAND block bad
+ *
+ *    @param[in]    psSvc       Service control block.
+ *    @param[in]    u32Block    Block.
+ *
+ *    @return       \ref SFLASH_SVC_OK or a negative error
+ *
+ *    @details      Programs zeros into the first two spare bytes of the first page of the block.
+ *                  Needs an idle service.
+ */
+int32_t SFLASHSVC_MarkBadBlock(SFLASH_SVC_T *psSvc, uint32_t u32Block)
+{
+    return SFLASHSVC_Marker(psSvc, u32Block, 1UL, NULL);
+}
+
+/*! @}*/ /* end of group SFLASH_SVC_EXPORTED_FUNCTIONS */
+
+/*! @}*/ /* end of group SFLASH_SVC_Driver */
+
+/*! @}*/ /* end of group Standard_Driver */
@@ -106,6 +106,10 @@ static int get_whc1_irq_flag(void)
 
 #endif
 
+/* Optional lock that makes each command/ack exchange atomic, see TSI_Set_Lock() */
+static void (*s_pfnTsiLock)(void);
+static void (*s_pfnTsiUnlock)(void);
+
 static uint32_t get_time(void)
 {
 	return EL0_GetCurrentPhysicalValue() / 12000;
@@ -185,11 +189,17 @@ int tsi_send_command_and_wait(TSI_REQ_T *req, int time_out)
 {
 	int  ret;
 
+	/* An ack is matched to the first ready channel, so two callers must not overlap */
+	if (s_pfnTsiLock)
+		s_pfnTsiLock();
+
 	ret = tsi_send_command(req);
-	if (ret != 0)
-		return ret;
+	if (ret == 0)
+		ret = tsi_wait_ack(req, time_out);
+
+	if (s_pfnTsiUnlock)
+		s_pfnTsiUnlock();
 
-	ret = tsi_wait_ack(req, time_out);
 	if (ret != 0)
 		return ret;
 
@@ -224,6 +234,22 @@ void TSI_Print_Error(int code)
 	sysprintf("\nUnknow error code 0x%x!\n", code);
 }
 
+/**
+  * @brief      Set the lock taken around every TSI command.
+  * @param[in]  lock      Acquires the lock, e.g. takes an RTOS mutex. NULL for none.
+  * @param[in]  unlock    Releases the lock. NULL for none.
+  * @details    The TSI driver assumes a single caller. An application that issues TSI
+  *             commands from more than one task, for example a crypto task and an entropy
+  *             pool fill task, must set a lock before the second task starts. The lock is
+  *             held for one command and its ack; sessions opened by different tasks may
+  *             still interleave. Neither function may be called from an interrupt handler.
+  */
+void TSI_Set_Lock(void (*lock)(void), void (*unlock)(void))
+{
+	s_pfnTsiLock = lock;
+	s_pfnTsiUnlock = unlock;
+}
+
 /**
   * @brief    Force TSI back to the initial state.
   * @return   0            success
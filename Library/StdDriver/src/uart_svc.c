@@ -0,0 +1,466 @@
+/**************************************************************************//**
+ * @file     uart_svc.c
+ * @brief    UART ring buffer service source file
+ *
+ *           RX runs PDMA continuously in scatter-gather mode over two halves
+ *           of the RX ring. A transfer-done interrupt publishes a full half;
+ *           the UART receive time-out publishes the partial half so that
+ *           short frames are not held back. TX sends contiguous chunks of the
+ *           TX ring in PDMA basic mode and chains the next chunk from the
+ *           transfer-done interrupt.
+ *
+ *           Each port has one reader and one writer. The IRQ handlers of a
+ *           port must run on the same core as its reader and writer.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <string.h>
+#include "NuMicro.h"
+
+/** @addtogroup Standard_Driver Standard Driver
+  @{
+*/
+
+/** @addtogroup UART_SVC_Driver UART Ring Buffer Service
+  @{
+*/
+
+/// @cond HIDDEN_SYMBOLS
+
+#define UART_SVC_INTEN      (UART_INTEN_RLSIEN_Msk | UART_INTEN_BUFEIEN_Msk | UART_INTEN_RXTOIEN_Msk | \
+                             UART_INTEN_TXPDMAEN_Msk | UART_INTEN_RXPDMAEN_Msk)
+
+static uint32_t UARTSVC_RxDescCtl(UART_SVC_T *psSvc)
+{
+    return ((psSvc->u32RxHalf - 1UL) << PDMA_DSCT_CTL_TXCNT_Pos) | PDMA_WIDTH_8 | PDMA_SAR_FIX | PDMA_DAR_INC |
+           PDMA_REQ_SINGLE | PDMA_BURST_1 | PDMA_OP_SCATTER;
+}
+
+static void UARTSVC_Notify(UART_SVC_T *psSvc, uint32_t u32Events)
+{
+    if ((u32Events != 0UL) && (psSvc->sCfg.pfnEvent != NULL))
+        psSvc->sCfg.pfnEvent(psSvc->sCfg.pvArg, u32Events);
+}
+
+/*
+ *  Publish a completed RX half. The descriptor that just retired is
+ *  reloaded so the loop keeps running even if PDMA wrote it back as idle.
+ */
+static void UARTSVC_RxHalfDone(UART_SVC_T *psSvc)
+{
+    volatile uint32_t *pu32Desc = nc_ptr(psSvc->au32RxDesc[psSvc->u32RxDone & 1UL]);
+    uint32_t u32Head;
+
+    pu32Desc[0] = UARTSVC_RxDescCtl(psSvc);
+
+    psSvc->u32RxDone++;
+    u32Head = psSvc->u32RxDone * psSvc->u32RxHalf;
+    if ((int32_t)(u32Head - psSvc->u32RxHead) > 0)
+        psSvc->u32RxHead = u32Head;
+}
+
+/*
+ *  Publish the bytes PDMA has written into the current half so far.
+ *  TXCNT of the channel counts down the remaining transfers; if the half
+ *  completes while it is being sampled, the pending transfer-done is
+ *  consumed first and the current half is sampled again.
+ */
+static void UARTSVC_RxFlushPartial(UART_SVC_T *psSvc)
+{
+    PDMA_T   *pdma = psSvc->sCfg.pdma;
+    uint32_t u32ChMsk = 1UL << psSvc->sCfg.u32RxCh;
+    uint32_t u32Remain, u32Head;
+
+    for (;;)
+    {
+        if (PDMA_GET_TD_STS(pdma) & u32ChMsk)
+        {
+            PDMA_CLR_TD_FLAG(pdma, u32ChMsk);
+            UARTSVC_RxHalfDone(psSvc);
+        }
+
+        u32Remain = ((pdma->DSCT[psSvc->sCfg.u32RxCh].CTL & PDMA_DSCT_CTL_TXCNT_Msk) >> PDMA_DSCT_CTL_TXCNT_Pos) + 1UL;
+
+        if (!(PDMA_GET_TD_STS(pdma) & u32ChMsk))
+            break;
+    }
+
+    if (u32Remain > psSvc->u32RxHalf)
+        return;
+
+    u32Head = psSvc->u32RxDone * psSvc->u32RxHalf + (psSvc->u32RxHalf - u32Remain);
+    if ((int32_t)(u32Head - psSvc->u32RxHead) > 0)
+        psSvc->u32RxHead = u32Head;
+}
+
+/*
+ *  Start PDMA on the next contiguous chunk of the TX ring.
+ *  Called only when no TX transfer is in flight.
+ */
+static void UARTSVC_TxKick(UART_SVC_T *psSvc)
+{
+    PDMA_T   *pdma = psSvc->sCfg.pdma;
+    uint32_t u32Ch = psSvc->sCfg.u32TxCh;
+    uint32_t u32Off, u32Len;
+
+    u32Len = psSvc->u32TxHead - psSvc->u32TxTail;
+    if (u32Len == 0UL)
+    {
+        psSvc->u32TxBusy = 0UL;
+        return;
+    }
+
+    u32Off = psSvc->u32TxTail & (psSvc->sCfg.u32TxSize - 1UL);
+    if (u32Len > psSvc->sCfg.u32TxSize - u32Off)
+        u32Len = psSvc->sCfg.u32TxSize - u32Off;
+    if (u32Len > UART_SVC_TXCNT_MAX)
+        u32Len = UART_SVC_TXCNT_MAX;
+
+    psSvc->u32TxBusy = u32Len;
+
+    /* Ring data was written through the non-cacheable alias; order it before the PDMA start */
+    __DSB();
+
+    PDMA_SetTransferCnt(pdma, u32Ch, PDMA_WIDTH_8, u32Len);
+    PDMA_SetTransferAddr(pdma, u32Ch, ptr_to_u32(psSvc->sCfg.pu8TxBuf + u32Off), PDMA_SAR_INC,
+                         ptr_to_u32(psSvc->sCfg.uart), PDMA_DAR_FIX);
+    PDMA_SetTransferMode(pdma, u32Ch, psSvc->sCfg.u32TxReq, FALSE, 0UL);
+}
+
+/* Oldest RX byte that PDMA has not started to overwrite yet */
+static uint32_t UARTSVC_RxMinValid(UART_SVC_T *psSvc)
+{
+    return (psSvc->u32RxDone - 1UL) * psSvc->u32RxHalf;
+}
+
+/// @endcond HIDDEN_SYMBOLS
+
+
+/** @addtogroup UART_SVC_EXPORTED_FUNCTIONS UART Ring Buffer Service Exported Functions
+  @{
+*/
+
+/**
+ *    @brief        Open a UART ring buffer service port
+ *
+ *    @param[out]   psSvc   Port control block.
+ *    @param[in]    psCfg   Port configuration. The UART must already be opened by \ref UART_Open
+ *                          and the PDMA module clock enabled.
+ *
+ *    @retval       UART_SVC_OK         Port is running
+ *    @retval       UART_SVC_ERR_PARAM  Invalid configuration
+ *
+ *    @details      Starts continuous RX PDMA and enables the UART receive time-out, line status,
+ *                  buffer error and PDMA request bits. The application routes its UART and PDMA
+ *                  interrupts to \ref UARTSVC_UART_IRQHandler and \ref UARTSVC_PDMA_IRQHandler.
+ */
+int32_t UARTSVC_Open(UART_SVC_T *psSvc, const UART_SVC_CFG_T *psCfg)
+{
+    PDMA_T   *pdma = psCfg->pdma;
+    UART_T   *uart = psCfg->uart;
+    volatile uint32_t *pu32Desc;
+    uint32_t i;
+
+    if ((psCfg->u32TxSize == 0UL) || (psCfg->u32TxSize & (psCfg->u32TxSize - 1UL)) ||
+            (psCfg->u32RxSize < 2UL) || (psCfg->u32RxSize & (psCfg->u32RxSize - 1UL)) ||
+            (psCfg->u32RxSize > 2UL * UART_SVC_TXCNT_MAX) ||
+            (psCfg->u32TxCh >= PDMA_CH_MAX) || (psCfg->u32RxCh >= PDMA_CH_MAX) ||
+            (psCfg->u32TxCh == psCfg->u32RxCh))
+        return UART_SVC_ERR_PARAM;
+
+    memset(psSvc, 0, sizeof(UART_SVC_T));
+    psSvc->sCfg = *psCfg;
+    psSvc->u32RxHalf = psCfg->u32RxSize / 2UL;
+
+    /* From here on the rings and descriptors are only touched through the non-cacheable alias */
+    dcache_clean_invalidate_by_mva(psSvc->au32RxDesc, sizeof(psSvc->au32RxDesc));
+    dcache_clean_invalidate_by_mva(psCfg->pu8TxBuf, psCfg->u32TxSize);
+    dcache_clean_invalidate_by_mva(psCfg->pu8RxBuf, psCfg->u32RxSize);
+    psSvc->pu8TxRing = nc_ptr(psCfg->pu8TxBuf);
+    psSvc->pu8RxRing = nc_ptr(psCfg->pu8RxBuf);
+
+    for (i = 0UL; i < 2UL; i++)
+    {
+        pu32Desc = nc_ptr(psSvc->au32RxDesc[i]);
+        pu32Desc[0] = UARTSVC_RxDescCtl(psSvc);
+        pu32Desc[1] = ptr_to_u32(uart);
+        pu32Desc[2] = ptr_to_u32(psCfg->pu8RxBuf + i * psSvc->u32RxHalf);
+        pu32Desc[3] = ptr_to_u32(psSvc->au32RxDesc[i ^ 1UL]);
+    }
+    __DSB();
+
+    PDMA_Open(pdma, (1UL << psCfg->u32TxCh) | (1UL << psCfg->u32RxCh));
+    PDMA_SetBurstType(pdma, psCfg->u32TxCh, PDMA_REQ_SINGLE, 0UL);
+    PDMA_SetTransferMode(pdma, psCfg->u32RxCh, psCfg->u32RxReq, TRUE, ptr_to_u32(psSvc->au32RxDesc[0]));
+    PDMA_EnableInt(pdma, psCfg->u32TxCh, PDMA_INT_TRANS_DONE);
+    PDMA_EnableInt(pdma, psCfg->u32RxCh, PDMA_INT_TRANS_DONE);
+
+    UART_SetTimeoutCnt(uart, psCfg->u32RxTimeout);
+    uart->FIFOSTS = UART_FIFOSTS_RXOVIF_Msk | UART_FIFOSTS_BIF_Msk | UART_FIFOSTS_FEF_Msk | UART_FIFOSTS_PEF_Msk;
+    uart->INTEN |= UART_SVC_INTEN;
+
+    return UART_SVC_OK;
+}
+
+/**
+ *    @brief        Stop a UART ring buffer service port
+ *
+ *    @param[in]    psSvc   Port control block.
+ *
+ *    @return       None
+ *
+ *    @details      Disables the UART PDMA requests and interrupts used by the service and stops
+ *                  both PDMA channels. The PDMA controller itself is left open for other users.
+ */
+void UARTSVC_Close(UART_SVC_T *psSvc)
+{
+    PDMA_T *pdma = psSvc->sCfg.pdma;
+
+    psSvc->sCfg.uart->INTEN &= ~(UART_SVC_INTEN | UART_INTEN_TOCNTEN_Msk);
+
+    PDMA_DisableInt(pdma, psSvc->sCfg.u32TxCh, PDMA_INT_TRANS_DONE);
+    PDMA_DisableInt(pdma, psSvc->sCfg.u32RxCh, PDMA_INT_TRANS_DONE);
+    PDMA_STOP(pdma, psSvc->sCfg.u32TxCh);
+    PDMA_STOP(pdma, psSvc->sCfg.u32RxCh);
+    PDMA_CLR_TD_FLAG(pdma, (1UL << psSvc->sCfg.u32TxCh) | (1UL << psSvc->sCfg.u32RxCh));
+    psSvc->u32TxBusy = 0UL;
+}
+
+/**
+ *    @brief        Number of received bytes ready to read
+ *
+ *    @param[in]    psSvc   Port control block.
+ *
+ *    @return       Bytes available, never more than the RX ring size
+ */
+uint32_t UARTSVC_RxAvailable(UART_SVC_T *psSvc)
+{
+    uint32_t u32Tail = psSvc->u32RxTail;
+    uint32_t u32Min = UARTSVC_RxMinValid(psSvc);
+
+    if ((int32_t)(u32Tail - u32Min) < 0)
+        u32Tail = u32Min;
+    return psSvc->u32RxHead - u32Tail;
+}
+
+/**
+ *    @brief        Non-blocking read from the RX ring
+ *
+ *    @param[in]    psSvc   Port control block.
+ *    @param[out]   pu8Buf  Destination buffer.
+ *    @param[in]    u32Len  Maximum bytes to read.
+ *
+ *    @return       Bytes copied to pu8Buf
+ *
+ *    @details      If the reader fell so far behind that PDMA is writing over unread data, the
+ *                  oldest bytes are skipped and added to \ref UART_SVC_STAT_T::u32RxOverrun.
+ *                  The check is repeated after the copy, so bytes PDMA overwrote while they were
+ *                  being copied are dropped from the front of pu8Buf and counted the same way.
+ */
+uint32_t UARTSVC_Read(UART_SVC_T *psSvc, uint8_t *pu8Buf, uint32_t u32Len)
+{
+    uint32_t u32Mask = psSvc->sCfg.u32RxSize - 1UL;
+    uint32_t u32Head = psSvc->u32RxHead;
+    uint32_t u32Tail = psSvc->u32RxTail;
+    uint32_t u32Min = UARTSVC_RxMinValid(psSvc);
+    uint32_t u32Off, u32Part, u32Lost;
+
+    if ((int32_t)(u32Tail - u32Min) < 0)
+    {
+        psSvc->sStat.u32RxOverrun += u32Min - u32Tail;
+        u32Tail = u32Min;
+    }
+
+    if (u32Len > u32Head - u32Tail)
+        u32Len = u32Head - u32Tail;
+
+    /* Head is published by the IRQ handlers after PDMA wrote the data */
+    __DMB();
+
+    u32Off = u32Tail & u32Mask;
+    u32Part = psSvc->sCfg.u32RxSize - u32Off;
+    if (u32Part > u32Len)
+        u32Part = u32Len;
+    memcpy(pu8Buf, psSvc->pu8RxRing + u32Off, u32Part);
+    memcpy(pu8Buf + u32Part, psSvc->pu8RxRing, u32Len - u32Part);
+
+    /* PDMA may have moved on to the half being copied; drop what it overwrote */
+    __DMB();
+    u32Min = UARTSVC_RxMinValid(psSvc);
+    if ((int32_t)(u32Tail - u32Min) < 0)
+    {
+        u32Lost = u32Min - u32Tail;
+        if (u32Lost > u32Len)
+            u32Lost = u32Len;
+        psSvc->sStat.u32RxOverrun += u32Lost;
+        memmove(pu8Buf, pu8Buf + u32Lost, u32Len - u32Lost);
+        u32Tail += u32Lost;
+        u32Len -= u32Lost;
+    }
+
+    psSvc->u32RxTail = u32Tail + u32Len;
+    psSvc->sStat.u32RxBytes += u32Len;
+    return u32Len;
+}
+
+/**
+ *    @brief        Free space in the TX ring
+ *
+ *    @param[in]    psSvc   Port control block.
+ *
+ *    @return       Bytes that \ref UARTSVC_Write can accept now
+ */
+uint32_t UARTSVC_TxFree(UART_SVC_T *psSvc)
+{
+    return psSvc->sCfg.u32TxSize - (psSvc->u32TxHead - psSvc->u32TxTail);
+}
+
+/**
+ *    @brief        Non-blocking write to the TX ring
+ *
+ *    @param[in]    psSvc   Port control block.
+ *    @param[in]    pu8Buf  Data to send.
+ *    @param[in]    u32Len  Bytes to send.
+ *
+ *    @return       Bytes queued. The rest is counted in \ref UART_SVC_STAT_T::u32TxDropped;
+ *                  callers that must not drop data wait for \ref UART_SVC_EVT_TX and retry.
+ */
+uint32_t UARTSVC_Write(UART_SVC_T *psSvc, const uint8_t *pu8Buf, uint32_t u32Len)
+{
+    uint32_t u32Mask = psSvc->sCfg.u32TxSize - 1UL;
+    uint32_t u32Head = psSvc->u32TxHead;
+    uint32_t u32Free = UARTSVC_TxFree(psSvc);
+    uint32_t u32Off, u32Part;
+
+    if (u32Len > u32Free)
+    {
+        psSvc->sStat.u32TxDropped += u32Len - u32Free;
+        u32Len = u32Free;
+    }
+    if (u32Len == 0UL)
+        return 0UL;
+
+    u32Off = u32Head & u32Mask;
+    u32Part = psSvc->sCfg.u32TxSize - u32Off;
+    if (u32Part > u32Len)
+        u32Part = u32Len;
+    memcpy(psSvc->pu8TxRing + u32Off, pu8Buf, u32Part);
+    memcpy(psSvc->pu8TxRing, pu8Buf + u32Part, u32Len - u32Part);
+
+    __DMB();
+    psSvc->u32TxHead = u32Head + u32Len;
+    __DMB();
+
+    /*
+     *  The transfer-done handler re-reads the head after it retires a chunk,
+     *  so an idle channel seen here cannot be restarted by the handler too.
+     */
+    if (psSvc->u32TxBusy == 0UL)
+        UARTSVC_TxKick(psSvc);
+
+    return u32Len;
+}
+
+/**
+ *    @brief        Get port statistics
+ *
+ *    @param[in]    psSvc   Port control block.
+ *    @param[out]   psStat  Snapshot of the counters.
+ *
+ *    @return       None
+ */
+void UARTSVC_GetStat(UART_SVC_T *psSvc, UART_SVC_STAT_T *psStat)
+{
+    *psStat = psSvc->sStat;
+}
+
+/**
+ *    @brief        UART interrupt service for a ring buffer port
+ *
+ *    @param[in]    psSvc   Port control block.
+ *
+ *    @return       None
+ *
+ *    @details      Call from the UARTn IRQ handler. Flushes a partial RX half on receive
+ *                  time-out and records line status and RX FIFO overflow errors.
+ */
+void UARTSVC_UART_IRQHandler(UART_SVC_T *psSvc)
+{
+    UART_T   *uart = psSvc->sCfg.uart;
+    uint32_t u32IntSts = uart->INTSTS;
+    uint32_t u32FifoSts = uart->FIFOSTS;
+    uint32_t u32Events = 0UL;
+    uint32_t u32Head;
+
+    if (u32IntSts & (UART_INTSTS_RXTOINT_Msk | UART_INTSTS_PTOINT_Msk))
+    {
+        u32Head = psSvc->u32RxHead;
+        UARTSVC_RxFlushPartial(psSvc);
+        psSvc->sStat.u32RxTimeouts++;
+        if (psSvc->u32RxHead != u32Head)
+            u32Events |= UART_SVC_EVT_RX;
+    }
+
+    if (u32FifoSts & (UART_FIFOSTS_BIF_Msk | UART_FIFOSTS_FEF_Msk | UART_FIFOSTS_PEF_Msk))
+    {
+        psSvc->sStat.u32LineErrors++;
+        uart->FIFOSTS = UART_FIFOSTS_BIF_Msk | UART_FIFOSTS_FEF_Msk | UART_FIFOSTS_PEF_Msk;
+        u32Events |= UART_SVC_EVT_ERROR;
+    }
+
+    if (u32FifoSts & UART_FIFOSTS_RXOVIF_Msk)
+    {
+        psSvc->sStat.u32FifoOverrun++;
+        uart->FIFOSTS = UART_FIFOSTS_RXOVIF_Msk;
+        u32Events |= UART_SVC_EVT_ERROR;
+    }
+
+    UARTSVC_Notify(psSvc, u32Events);
+}
+
+/**
+ *    @brief        PDMA interrupt service for a ring buffer port
+ *
+ *    @param[in]    psSvc   Port control block.
+ *
+ *    @return       None
+ *
+ *    @details      Call from the IRQ handler of the PDMA controller serving the port. Only the
+ *                  transfer-done flags of the port's two channels are consumed, so several
+ *                  ports can share one PDMA controller.
+ */
+void UARTSVC_PDMA_IRQHandler(UART_SVC_T *psSvc)
+{
+    PDMA_T   *pdma = psSvc->sCfg.pdma;
+    uint32_t u32RxMsk = 1UL << psSvc->sCfg.u32RxCh;
+    uint32_t u32TxMsk = 1UL << psSvc->sCfg.u32TxCh;
+    uint32_t u32TdSts = PDMA_GET_TD_STS(pdma);
+    uint32_t u32Events = 0UL;
+
+    if (u32TdSts & u32RxMsk)
+    {
+        PDMA_CLR_TD_FLAG(pdma, u32RxMsk);
+        UARTSVC_RxHalfDone(psSvc);
+        u32Events |= UART_SVC_EVT_RX;
+    }
+
+    if ((u32TdSts & u32TxMsk) && (psSvc->u32TxBusy != 0UL))
+    {
+        PDMA_CLR_TD_FLAG(pdma, u32TxMsk);
+        psSvc->u32TxTail += psSvc->u32TxBusy;
+        psSvc->sStat.u32TxBytes += psSvc->u32TxBusy;
+        UARTSVC_TxKick(psSvc);
+        u32Events |= UART_SVC_EVT_TX;
+        if (psSvc->u32TxBusy == 0UL)
+            u32Events |= UART_SVC_EVT_TX_DONE;
+    }
+
+    UARTSVC_Notify(psSvc, u32Events);
+}
+
+/*! @}*/ /* end of group UART_SVC_EXPORTED_FUNCTIONS */
+
+/*! @}*/ /* end of group UART_SVC_Driver */
+
+/*! @}*/ /* end of group Standard_Driver */
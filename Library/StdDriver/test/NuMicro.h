@@ -0,0 +1,77 @@
+/**************************************************************************//**
+ * @file     NuMicro.h
+ * @brief    Host stand-in for the device header, used by the StdDriver host
+ *           tests. It provides just enough of MA35D1.h for a driver to build
+ *           on a PC: the peripheral register blocks are plain memory the
+ *           simulator maps below 4 GB, so the 32-bit address casts of the
+ *           drivers keep working.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __NUMICRO_H__
+#define __NUMICRO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define __I     volatile const
+#define __O     volatile
+#define __IO    volatile
+
+#define __STATIC_INLINE static inline
+#define __DMB()         __sync_synchronize()
+
+#define TRUE    1
+#define FALSE   0
+
+typedef uint32_t u32;
+
+#define ptr_to_u32(x)   ((uint32_t)((uint64_t)(x)))
+#define ptr_s(x)        ((void *)((uint64_t)(x) & 0xffffffffULL))
+#define inpw(x)         (*(volatile uint32_t *)((uint64_t)(x)))
+#define outpw(x, v)     (*(volatile uint32_t *)((uint64_t)(x)) = (v))
+
+/* Set up by the simulator */
+extern uint32_t SystemCoreClock;
+extern uint64_t g_u64SimSysBase;
+extern uint64_t g_u64SimCanfdBase;
+
+#define SYS_BASE        g_u64SimSysBase
+
+/* Clock control, only the fields read by the drivers */
+typedef struct
+{
+    uint32_t CLKDIV0;
+    uint32_t CLKSEL4;
+} CLK_T;
+
+extern CLK_T g_sSimClk;
+#define CLK             (&g_sSimClk)
+
+#define APLL            1
+#define VPLL            6
+#define CANFD0_MODULE   0
+#define CANFD1_MODULE   1
+#define CANFD2_MODULE   2
+#define CANFD3_MODULE   3
+uint32_t CLK_GetPLLClockFreq(uint32_t u32PllIdx);
+
+typedef enum
+{
+    CANFD00_IRQn, CANFD01_IRQn, CANFD10_IRQn, CANFD11_IRQn,
+    CANFD20_IRQn, CANFD21_IRQn, CANFD30_IRQn, CANFD31_IRQn
+} IRQn_Type;
+int32_t IRQ_Disable(IRQn_Type irqn);
+
+#include "canfd_reg.h"
+
+/* Only CANFD0 is simulated; the others are distinct dummy addresses */
+#define CANFD0          ((CANFD_T *)g_u64SimCanfdBase)
+#define CANFD1          ((CANFD_T *)0x10)
+#define CANFD2          ((CANFD_T *)0x20)
+#define CANFD3          ((CANFD_T *)0x30)
+
+#include "canfd.h"
+
+#endif /* __NUMICRO_H__ */
@@ -0,0 +1,428 @@
+/**************************************************************************//**
+ * @file     canfd_sim.c
+ * @brief    Host model of one CAN FD controller for the StdDriver host tests.
+ *
+ *           Rx FIFOs keep their get index, put index and fill level in RXFnS
+ *           as the hardware does. The Tx FIFO/Queue model keeps TXFQS and
+ *           TXBRP, and checks what the driver requests: in FIFO mode the
+ *           requested buffers must run in order from the put index, and no
+ *           request may name a buffer that is still pending. The content of a
+ *           buffer is saved when it is requested and compared when it is sent,
+ *           which catches a driver writing into a pending buffer.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "canfd_sim.h"
+
+#define SIM_MAP_SIZE        0x4000
+#define SIM_REV_B           0x01000000UL    /* SYS 0x1F0, non-zero revision field */
+#define SIM_RXFA_IDLE       0xFFFFFFFFUL    /* RXFnA value while no acknowledge is pending */
+
+/* Writes a register the driver only reads */
+#define SIM_WR(reg, val)    (*(volatile uint32_t *)&(reg) = (val))
+
+uint32_t SystemCoreClock = 100000;          /* WaitTxIdle gives up after 1000 polls */
+uint64_t g_u64SimSysBase;
+uint64_t g_u64SimCanfdBase;
+CLK_T    g_sSimClk;
+uint32_t g_u32SimErrors;
+
+static struct
+{
+    uint8_t     *pu8Map;
+    uint32_t    u32TxGet;                   /* FIFO mode, next buffer to send */
+    uint32_t    u32TxFree;                  /* FIFO mode, free elements */
+    uint32_t    u32Seed;
+    CANFD_BUF_T asSaved[CANFD_MAX_TX_BUF_ELEMS];
+} s_sSim;
+
+static const uint8_t s_au8DlcBytes[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+uint32_t CLK_GetPLLClockFreq(uint32_t u32PllIdx)
+{
+    (void)u32PllIdx;
+    return 0;
+}
+
+int32_t IRQ_Disable(IRQn_Type irqn)
+{
+    (void)irqn;
+    return 0;
+}
+
+static void SimFail(const char *pcMsg, uint32_t u32Val)
+{
+    printf("  model: %s (%u)\n", pcMsg, u32Val);
+    g_u32SimErrors++;
+}
+
+static CANFD_BUF_T *SimElem(CANFD_T *psCanfd, uint32_t u32Offset, uint32_t u32Idx)
+{
+    return (CANFD_BUF_T *)(s_sSim.pu8Map + CANFD_SRAM_BASE_ADDR + (u32Offset & 0xFFFC) + u32Idx * sizeof(CANFD_BUF_T));
+}
+
+static uint32_t SimDlcCode(uint32_t u32Bytes)
+{
+    uint32_t i;
+
+    for (i = 0; i < 16; i++)
+    {
+        if (s_au8DlcBytes[i] >= u32Bytes)
+            return i;
+    }
+    return 15;
+}
+
+static void SimEncode(const CANFD_FD_MSG_T *psMsg, CANFD_BUF_T *psElem)
+{
+    uint32_t i;
+
+    if (psMsg->eIdType == eCANFD_XID)
+        psElem->u32Id = (1UL << 30) | (psMsg->u32Id & 0x1FFFFFFF);
+    else
+        psElem->u32Id = (psMsg->u32Id & 0x7FF) << 18;
+    if (psMsg->eFrmType == eCANFD_REMOTE_FRM)
+        psElem->u32Id |= (1UL << 29);
+
+    psElem->u32Config = SimDlcCode(psMsg->u32DLC) << 16;
+    if (psMsg->bFDFormat)
+        psElem->u32Config |= (1UL << 21);
+    if (psMsg->bBitRateSwitch)
+        psElem->u32Config |= (1UL << 20);
+
+    for (i = 0; i < CANFD_MAX_MESSAGE_WORDS; i++)
+        psElem->au32Data[i] = psMsg->au32Data[i];
+}
+
+static void SimDecode(const CANFD_BUF_T *psElem, CANFD_FD_MSG_T *psMsg)
+{
+    memset(psMsg, 0, sizeof(*psMsg));
+
+    if (psElem->u32Id & (1UL << 30))
+    {
+        psMsg->eIdType = eCANFD_XID;
+        psMsg->u32Id = psElem->u32Id & 0x1FFFFFFF;
+    }
+    else
+    {
+        psMsg->eIdType = eCANFD_SID;
+        psMsg->u32Id = (psElem->u32Id >> 18) & 0x7FF;
+    }
+    psMsg->eFrmType = (psElem->u32Id & (1UL << 29)) ? eCANFD_REMOTE_FRM : eCANFD_DATA_FRM;
+    psMsg->u32DLC = s_au8DlcBytes[(psElem->u32Config >> 16) & 0xF];
+    psMsg->bFDFormat = (psElem->u32Config & (1UL << 21)) ? 1 : 0;
+    psMsg->bBitRateSwitch = (psElem->u32Config & (1UL << 20)) ? 1 : 0;
+    memcpy(psMsg->au8Data, (const void *)psElem->au32Data, psMsg->u32DLC);
+}
+
+int CANFD_SimMsgEqual(const CANFD_FD_MSG_T *psA, const CANFD_FD_MSG_T *psB)
+{
+    return (psA->eIdType == psB->eIdType) && (psA->u32Id == psB->u32Id) &&
+           (psA->eFrmType == psB->eFrmType) && (psA->u32DLC == psB->u32DLC) &&
+           (!psA->bFDFormat == !psB->bFDFormat) && (!psA->bBitRateSwitch == !psB->bBitRateSwitch) &&
+           (memcmp(psA->au8Data, psB->au8Data, psA->u32DLC) == 0);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Controller                                                                                              */
+/*---------------------------------------------------------------------------------------------------------*/
+CANFD_T *CANFD_SimOpen(CANFD_FD_T *psConfig)
+{
+    CANFD_T *psCanfd;
+    uint8_t *pu8Map;
+
+    /* The drivers cast addresses to 32 bits, so the model lives below 2 GB */
+    pu8Map = mmap(NULL, SIM_MAP_SIZE * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (pu8Map == MAP_FAILED)
+        return NULL;
+
+    memset(&s_sSim, 0, sizeof(s_sSim));
+    s_sSim.pu8Map = pu8Map;
+    s_sSim.u32Seed = 1;
+    g_u64SimCanfdBase = (uint64_t)pu8Map;
+    g_u64SimSysBase = (uint64_t)(pu8Map + SIM_MAP_SIZE);
+    g_u32SimErrors = 0;
+    CANFD_SimSetRevA(0, 0);
+
+    psCanfd = CANFD0;
+    psCanfd->CCCR = CANFD_CCCR_INIT_Msk | CANFD_CCCR_CCE_Msk;
+    SIM_WR(psCanfd->PSR, (uint32_t)eCANFD_IDLE << CANFD_PSR_ACT_Pos);
+
+    if (psConfig->sElemSize.u32SIDFC != 0)
+        CANFD_ConfigSIDFC(psCanfd, &psConfig->sMRamStartAddr, &psConfig->sElemSize);
+    if (psConfig->sElemSize.u32XIDFC != 0)
+        CANFD_ConfigXIDFC(psCanfd, &psConfig->sMRamStartAddr, &psConfig->sElemSize);
+    if (psConfig->sElemSize.u32TxBuf != 0)
+        CANFD_InitTxDBuf(psCanfd, &psConfig->sMRamStartAddr, &psConfig->sElemSize, eCANFD_BYTE64);
+    if ((psConfig->sElemSize.u32TxBuf != 0) && (psConfig->sTxConfig.u32ElemCnt != 0))
+        CANFD_InitTxFifoQueue(psCanfd, &psConfig->sElemSize, psConfig->sTxConfig.eModeSel,
+                              psConfig->sTxConfig.u32DBufNumber, psConfig->sTxConfig.u32ElemCnt);
+    if (psConfig->sElemSize.u32RxFifo0 != 0)
+        CANFD_InitRxFifo(psCanfd, 0, &psConfig->sMRamStartAddr, &psConfig->sElemSize, 0, eCANFD_BYTE64);
+    if (psConfig->sElemSize.u32RxFifo1 != 0)
+        CANFD_InitRxFifo(psCanfd, 1, &psConfig->sMRamStartAddr, &psConfig->sElemSize, 0, eCANFD_BYTE64);
+
+    return psCanfd;
+}
+
+void CANFD_SimClose(void)
+{
+    if (s_sSim.pu8Map != NULL)
+        munmap(s_sSim.pu8Map, SIM_MAP_SIZE * 2);
+    s_sSim.pu8Map = NULL;
+}
+
+void CANFD_SimSetRevA(int i32RevA, int i32BusBusy)
+{
+    SIM_WR(*(uint32_t *)(g_u64SimSysBase + 0x1F0), i32RevA ? 0 : SIM_REV_B);
+    SIM_WR(CANFD0->PSR, (uint32_t)(i32BusBusy ? eCANFD_TRANSMITTER : eCANFD_IDLE) << CANFD_PSR_ACT_Pos);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Rx FIFO                                                                                                 */
+/*---------------------------------------------------------------------------------------------------------*/
+static void SimRxRegs(CANFD_T *psCanfd, uint32_t u32Fifo, volatile uint32_t **ppRXFC,
+                      volatile uint32_t **ppRXFS, volatile uint32_t **ppRXFA, uint32_t *pu32LostIR)
+{
+    *ppRXFC = (u32Fifo == 0) ? &psCanfd->RXF0C : &psCanfd->RXF1C;
+    *ppRXFS = (volatile uint32_t *)((u32Fifo == 0) ? &psCanfd->RXF0S : &psCanfd->RXF1S);
+    *ppRXFA = (u32Fifo == 0) ? &psCanfd->RXF0A : &psCanfd->RXF1A;
+    *pu32LostIR = (u32Fifo == 0) ? CANFD_IR_RF0L_Msk : CANFD_IR_RF1L_Msk;
+}
+
+uint32_t CANFD_SimRxPush(CANFD_T *psCanfd, uint32_t u32Fifo, const CANFD_FD_MSG_T *psMsg)
+{
+    volatile uint32_t *pRXFC, *pRXFS, *pRXFA;
+    uint32_t u32LostIR, u32Size, u32Status, u32Fill, u32Put;
+
+    SimRxRegs(psCanfd, u32Fifo, &pRXFC, &pRXFS, &pRXFA, &u32LostIR);
+    u32Size = (*pRXFC & CANFD_RXF0C_F0S_Msk) >> CANFD_RXF0C_F0S_Pos;
+    u32Status = *pRXFS;
+    u32Fill = u32Status & CANFD_RXF0S_F0FL_Msk;
+    u32Put = (u32Status & CANFD_RXF0S_F0PI_Msk) >> CANFD_RXF0S_F0PI_Pos;
+
+    if (u32Fill == u32Size)
+    {
+        /* Blocking mode: the new frame is dropped */
+        *pRXFS = u32Status | CANFD_RXF0S_RF0L_Msk;
+        SIM_WR(psCanfd->IR, psCanfd->IR | u32LostIR);
+        return 0;
+    }
+
+    SimEncode(psMsg, SimElem(psCanfd, *pRXFC, u32Put));
+    u32Put = (u32Put + 1) % u32Size;
+    u32Fill++;
+
+    u32Status &= ~(CANFD_RXF0S_F0FL_Msk | CANFD_RXF0S_F0PI_Msk | CANFD_RXF0S_F0F_Msk);
+    u32Status |= u32Fill | (u32Put << CANFD_RXF0S_F0PI_Pos) | ((u32Fill == u32Size) ? CANFD_RXF0S_F0F_Msk : 0);
+    *pRXFS = u32Status;
+    *pRXFA = SIM_RXFA_IDLE;
+    return 1;
+}
+
+void CANFD_SimRxAck(CANFD_T *psCanfd, uint32_t u32Fifo)
+{
+    volatile uint32_t *pRXFC, *pRXFS, *pRXFA;
+    uint32_t u32LostIR, u32Size, u32Status, u32Fill, u32Get, u32Ack, u32Released;
+
+    SimRxRegs(psCanfd, u32Fifo, &pRXFC, &pRXFS, &pRXFA, &u32LostIR);
+
+    /* The driver clears the lost flag by writing 1 to IR */
+    if ((psCanfd->IR & u32LostIR) == u32LostIR)
+    {
+        *pRXFS &= ~CANFD_RXF0S_RF0L_Msk;
+        SIM_WR(psCanfd->IR, psCanfd->IR & ~u32LostIR);
+    }
+
+    u32Ack = *pRXFA;
+    if (u32Ack == SIM_RXFA_IDLE)
+        return;
+    *pRXFA = SIM_RXFA_IDLE;
+
+    u32Size = (*pRXFC & CANFD_RXF0C_F0S_Msk) >> CANFD_RXF0C_F0S_Pos;
+    u32Status = *pRXFS;
+    u32Fill = u32Status & CANFD_RXF0S_F0FL_Msk;
+    u32Get = (u32Status & CANFD_RXF0S_F0GI_Msk) >> CANFD_RXF0S_F0GI_Pos;
+
+    u32Released = (u32Ack + u32Size - u32Get) % u32Size + 1;
+    if ((u32Ack >= u32Size) || (u32Released > u32Fill))
+    {
+        SimFail("Rx FIFO acknowledge outside the filled elements", u32Ack);
+        return;
+    }
+
+    u32Fill -= u32Released;
+    u32Get = (u32Ack + 1) % u32Size;
+    u32Status &= ~(CANFD_RXF0S_F0FL_Msk | CANFD_RXF0S_F0GI_Msk | CANFD_RXF0S_F0F_Msk);
+    *pRXFS = u32Status | u32Fill | (u32Get << CANFD_RXF0S_F0GI_Pos);
+}
+
+uint32_t CANFD_SimRxFill(CANFD_T *psCanfd, uint32_t u32Fifo)
+{
+    return ((u32Fifo == 0) ? psCanfd->RXF0S : psCanfd->RXF1S) & CANFD_RXF0S_F0FL_Msk;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Tx FIFO/Queue                                                                                           */
+/*---------------------------------------------------------------------------------------------------------*/
+static void SimTxRange(CANFD_T *psCanfd, uint32_t *pu32Start, uint32_t *pu32End)
+{
+    *pu32Start = (psCanfd->TXBC & CANFD_TXBC_NDTB_Msk) >> CANFD_TXBC_NDTB_Pos;
+    *pu32End = *pu32Start + ((psCanfd->TXBC & CANFD_TXBC_TFQS_Msk) >> CANFD_TXBC_TFQS_Pos);
+}
+
+/* Rebuilds TXFQS from the model state */
+static void SimTxStatus(CANFD_T *psCanfd)
+{
+    uint32_t u32Start, u32End, u32Put, u32Idx;
+
+    SimTxRange(psCanfd, &u32Start, &u32End);
+
+    if (psCanfd->TXBC & CANFD_TXBC_TFQM_Msk)
+    {
+        /* Queue: put index is the first free buffer, free level and get index read 0 */
+        for (u32Idx = u32Start; u32Idx < u32End; u32Idx++)
+        {
+            if ((psCanfd->TXBRP & (1UL << u32Idx)) == 0)
+                break;
+        }
+        if (u32Idx == u32End)
+            SIM_WR(psCanfd->TXFQS, CANFD_TXFQS_TFQF_Msk);
+        else
+            SIM_WR(psCanfd->TXFQS, u32Idx << CANFD_TXFQS_TFQP_Pos);
+    }
+    else
+    {
+        u32Put = s_sSim.u32TxGet + (u32End - u32Start) - s_sSim.u32TxFree;
+        if (u32Put >= u32End)
+            u32Put -= u32End - u32Start;
+        SIM_WR(psCanfd->TXFQS, s_sSim.u32TxFree | (s_sSim.u32TxGet << CANFD_TXFQS_TFG_Pos) |
+               (u32Put << CANFD_TXFQS_TFQP_Pos) | ((s_sSim.u32TxFree == 0) ? CANFD_TXFQS_TFQF_Msk : 0));
+    }
+}
+
+void CANFD_SimRunToNormal(CANFD_T *psCanfd)
+{
+    uint32_t u32Start, u32End;
+
+    psCanfd->CCCR &= ~(CANFD_CCCR_INIT_Msk | CANFD_CCCR_CCE_Msk);
+    SIM_WR(psCanfd->TXBRP, 0);
+    psCanfd->TXBAR = 0;
+
+    SimTxRange(psCanfd, &u32Start, &u32End);
+    s_sSim.u32TxGet = u32Start;
+    s_sSim.u32TxFree = u32End - u32Start;
+    SimTxStatus(psCanfd);
+
+    psCanfd->RXF0A = SIM_RXFA_IDLE;
+    psCanfd->RXF1A = SIM_RXFA_IDLE;
+}
+
+void CANFD_SimTxRequest(CANFD_T *psCanfd)
+{
+    uint32_t u32Req = psCanfd->TXBAR, u32Left, u32Start, u32End, u32Put, u32Idx, u32Cnt = 0;
+
+    if (u32Req == 0)
+        return;
+    psCanfd->TXBAR = 0;
+
+    SimTxRange(psCanfd, &u32Start, &u32End);
+
+    if (u32Req & psCanfd->TXBRP)
+        SimFail("request of a buffer still pending", u32Req & psCanfd->TXBRP);
+    if (u32Req & ~(uint32_t)(((uint64_t)1 << u32End) - ((uint64_t)1 << u32Start)))
+        SimFail("request outside the Tx FIFO/Queue", u32Req);
+
+    if ((psCanfd->TXBC & CANFD_TXBC_TFQM_Msk) == 0)
+    {
+        /* FIFO: the requests must run from the put index without a gap */
+        u32Left = u32Req;
+        u32Put = (psCanfd->TXFQS & CANFD_TXFQS_TFQP_Msk) >> CANFD_TXFQS_TFQP_Pos;
+        while (u32Left & (1UL << u32Put))
+        {
+            u32Left &= ~(1UL << u32Put);
+            u32Cnt++;
+            if (++u32Put >= u32End)
+                u32Put = u32Start;
+        }
+        if (u32Left)
+            SimFail("FIFO request not in put index order", u32Left);
+        if (u32Cnt > s_sSim.u32TxFree)
+            SimFail("FIFO request beyond the free level", u32Cnt);
+        else
+            s_sSim.u32TxFree -= u32Cnt;
+    }
+
+    /* Keep what was requested, to see whether the driver overwrites it */
+    for (u32Idx = u32Start; u32Idx < u32End; u32Idx++)
+    {
+        if (u32Req & (1UL << u32Idx))
+            s_sSim.asSaved[u32Idx] = *SimElem(psCanfd, psCanfd->TXBC, u32Idx);
+    }
+
+    SIM_WR(psCanfd->TXBRP, psCanfd->TXBRP | u32Req);
+    SimTxStatus(psCanfd);
+}
+
+static void SimTxOne(CANFD_T *psCanfd, uint32_t u32Idx, CANFD_FD_MSG_T *psOut)
+{
+    CANFD_BUF_T *psElem = SimElem(psCanfd, psCanfd->TXBC, u32Idx);
+
+    if (memcmp((const void *)psElem, &s_sSim.asSaved[u32Idx], sizeof(CANFD_BUF_T)) != 0)
+        SimFail("pending Tx buffer overwritten", u32Idx);
+
+    SimDecode(&s_sSim.asSaved[u32Idx], psOut);
+    SIM_WR(psCanfd->TXBRP, psCanfd->TXBRP & ~(1UL << u32Idx));
+    SIM_WR(psCanfd->TXBTO, psCanfd->TXBTO | (1UL << u32Idx));
+}
+
+uint32_t CANFD_SimTxSend(CANFD_T *psCanfd, uint32_t u32Max, CANFD_FD_MSG_T *psOut)
+{
+    uint32_t u32Start, u32End, u32Pending, u32Pick, u32Idx, u32Cnt = 0;
+
+    SimTxRange(psCanfd, &u32Start, &u32End);
+
+    while (u32Cnt < u32Max)
+    {
+        u32Pending = psCanfd->TXBRP & (uint32_t)(((uint64_t)1 << u32End) - ((uint64_t)1 << u32Start));
+        if (u32Pending == 0)
+            break;
+
+        if (psCanfd->TXBC & CANFD_TXBC_TFQM_Msk)
+        {
+            /* Queue: the bus arbitration decides, model it as any pending buffer */
+            s_sSim.u32Seed = s_sSim.u32Seed * 1103515245U + 12345U;
+            u32Pick = (s_sSim.u32Seed >> 16) % (uint32_t)__builtin_popcount(u32Pending);
+            while (u32Pick--)
+                u32Pending &= u32Pending - 1;
+            u32Idx = (uint32_t)__builtin_ctz(u32Pending);
+        }
+        else
+        {
+            u32Idx = s_sSim.u32TxGet;
+            if ((u32Pending & (1UL << u32Idx)) == 0)
+            {
+                SimFail("FIFO get index not pending", u32Idx);
+                break;
+            }
+            if (++s_sSim.u32TxGet >= u32End)
+                s_sSim.u32TxGet = u32Start;
+            s_sSim.u32TxFree++;
+        }
+
+        SimTxOne(psCanfd, u32Idx, &psOut[u32Cnt++]);
+    }
+
+    SimTxStatus(psCanfd);
+    return u32Cnt;
+}
+
+uint32_t CANFD_SimTxPending(CANFD_T *psCanfd)
+{
+    return (uint32_t)__builtin_popcount(psCanfd->TXBRP);
+}
@@ -0,0 +1,48 @@
+/**************************************************************************//**
+ * @file     canfd_sim.h
+ * @brief    Host model of one CAN FD controller for the StdDriver host tests.
+ *
+ *           The register block and the Message RAM are plain memory, so the
+ *           model cannot see a register write when it happens. A test calls
+ *           the driver, then CANFD_SimTxRequest() or CANFD_SimRxAck() to let
+ *           the model act on what the driver wrote to TXBAR or RXFnA, the way
+ *           the hardware would have done at once.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __CANFD_SIM_H__
+#define __CANFD_SIM_H__
+
+#include "NuMicro.h"
+
+/* Model checks that failed; any failure is also printed */
+extern uint32_t g_u32SimErrors;
+
+/* Maps the controller, applies psConfig like CANFD_Open() and leaves it in
+   configuration mode (INIT and CCE set) */
+CANFD_T *CANFD_SimOpen(CANFD_FD_T *psConfig);
+void     CANFD_SimClose(void);
+
+/* Leaves configuration mode; the Tx FIFO/Queue and Rx FIFOs start empty */
+void     CANFD_SimRunToNormal(CANFD_T *psCanfd);
+
+/* Revision A waits for the bus to go idle before TXBAR is written */
+void     CANFD_SimSetRevA(int i32RevA, int i32BusBusy);
+
+/* Rx FIFO: the bus delivers a frame; returns 0 when the FIFO was full and the
+   frame was lost */
+uint32_t CANFD_SimRxPush(CANFD_T *psCanfd, uint32_t u32Fifo, const CANFD_FD_MSG_T *psMsg);
+void     CANFD_SimRxAck(CANFD_T *psCanfd, uint32_t u32Fifo);
+uint32_t CANFD_SimRxFill(CANFD_T *psCanfd, uint32_t u32Fifo);
+
+/* Tx FIFO/Queue: act on TXBAR, then send up to u32Max pending frames. In
+   Queue mode pending buffers are sent in a pseudo random order. */
+void     CANFD_SimTxRequest(CANFD_T *psCanfd);
+uint32_t CANFD_SimTxSend(CANFD_T *psCanfd, uint32_t u32Max, CANFD_FD_MSG_T *psOut);
+uint32_t CANFD_SimTxPending(CANFD_T *psCanfd);
+
+/* Compare two frames field by field; 1 when equal */
+int      CANFD_SimMsgEqual(const CANFD_FD_MSG_T *psA, const CANFD_FD_MSG_T *psB);
+
+#endif /* __CANFD_SIM_H__ */
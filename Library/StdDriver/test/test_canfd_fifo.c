@@ -0,0 +1,345 @@
+/**************************************************************************//**
+ * @file     test_canfd_fifo.c
+ * @brief    Host test of the CAN FD batched Rx FIFO drain, the software
+ *           message rings and the Tx FIFO/Queue refill, against the
+ *           simulated controller of canfd_sim.c.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "canfd_sim.h"
+
+#define TX_MSGS         2000
+#define RING_SIZE       64
+
+static const uint8_t s_au8Dlc[] = { 4, 5, 8, 12, 20, 32, 48, 64 };
+
+static CANFD_FD_MSG_T s_asRingBuf[RING_SIZE];
+static CANFD_FD_MSG_T s_asOut[CANFD_MAX_TX_BUF_ELEMS];
+static uint8_t        s_au8Seen[TX_MSGS];
+static uint32_t       s_u32Seed = 7;
+
+static uint32_t Rand(uint32_t u32Range)
+{
+    s_u32Seed = s_u32Seed * 1103515245U + 12345U;
+    return (s_u32Seed >> 16) % u32Range;
+}
+
+/* Frame number u32Seq, which is kept in its first four data bytes */
+static void MakeMsg(uint32_t u32Seq, CANFD_FD_MSG_T *psMsg)
+{
+    uint32_t i;
+
+    memset(psMsg, 0, sizeof(*psMsg));
+    psMsg->eIdType = (u32Seq & 1) ? eCANFD_XID : eCANFD_SID;
+    psMsg->u32Id = (u32Seq & 1) ? (u32Seq * 2654435761U) & 0x1FFFFFFF : u32Seq & 0x7FF;
+    psMsg->eFrmType = eCANFD_DATA_FRM;
+    psMsg->u32DLC = s_au8Dlc[u32Seq % sizeof(s_au8Dlc)];
+    psMsg->bFDFormat = (psMsg->u32DLC > 8);
+    psMsg->bBitRateSwitch = psMsg->bFDFormat && (u32Seq & 2);
+    for (i = 4; i < psMsg->u32DLC; i++)
+        psMsg->au8Data[i] = (uint8_t)(u32Seq * 7 + i);
+    memcpy(psMsg->au8Data, &u32Seq, 4);
+}
+
+static uint32_t MsgSeq(const CANFD_FD_MSG_T *psMsg)
+{
+    uint32_t u32Seq;
+
+    memcpy(&u32Seq, psMsg->au8Data, 4);
+    return u32Seq;
+}
+
+static int CheckMsg(uint32_t u32Seq, const CANFD_FD_MSG_T *psMsg)
+{
+    CANFD_FD_MSG_T sExp;
+
+    MakeMsg(u32Seq, &sExp);
+    if (CANFD_SimMsgEqual(&sExp, psMsg))
+        return 0;
+    printf("  frame %u: got id 0x%x dlc %u seq %u\n", u32Seq, psMsg->u32Id, psMsg->u32DLC, MsgSeq(psMsg));
+    return 1;
+}
+
+static CANFD_T *Open(E_CANFD_MODE eMode, uint32_t u32DBuf, uint32_t u32Elem)
+{
+    CANFD_FD_T sConfig;
+    CANFD_T *psCanfd;
+
+    CANFD_GetDefaultConfig(&sConfig, CANFD_OP_CAN_FD_MODE);
+    sConfig.sTxConfig.eModeSel = eMode;
+    sConfig.sTxConfig.u32DBufNumber = u32DBuf;
+    sConfig.sTxConfig.u32ElemCnt = u32Elem;
+
+    psCanfd = CANFD_SimOpen(&sConfig);
+    if (psCanfd != NULL)
+        CANFD_SimRunToNormal(psCanfd);
+    return psCanfd;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Rx FIFO into an array: batches of random size that wrap around the FIFO                                 */
+/*---------------------------------------------------------------------------------------------------------*/
+static int Test_RxBatch(void)
+{
+    CANFD_T *psCanfd = Open(eCANFD_FIFO_MODE, 0, 0);
+    CANFD_FD_MSG_T asRead[40], sMsg;
+    uint32_t u32Push = 0, u32Read = 0, u32Cnt, u32Max, i, n;
+    int i32Fail = 0;
+
+    for (n = 0; n < 500; n++)
+    {
+        /* Never more than the FIFO holds, so nothing is lost */
+        u32Cnt = Rand(33 - CANFD_SimRxFill(psCanfd, 0));
+        while (u32Cnt--)
+        {
+            MakeMsg(u32Push++, &sMsg);
+            if (CANFD_SimRxPush(psCanfd, 0, &sMsg) == 0)
+                i32Fail = 1;
+        }
+
+        u32Max = 1 + Rand(40);
+        u32Cnt = CANFD_ReadRxFifoMsgs(psCanfd, 0, asRead, u32Max);
+        CANFD_SimRxAck(psCanfd, 0);
+
+        if (u32Cnt > u32Max)
+            i32Fail = 1;
+        for (i = 0; i < u32Cnt; i++)
+            i32Fail |= CheckMsg(u32Read++, &asRead[i]);
+        if (CANFD_SimRxFill(psCanfd, 0) != u32Push - u32Read)
+            i32Fail = 1;
+    }
+
+    CANFD_SimClose();
+    return i32Fail;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Rx FIFO into a ring: partial drains, ring full and hardware message lost                                */
+/*---------------------------------------------------------------------------------------------------------*/
+static int Test_RxRing(void)
+{
+    CANFD_T *psCanfd = Open(eCANFD_FIFO_MODE, 0, 0);
+    CANFD_MSG_RING_T sRing;
+    CANFD_FD_MSG_T sMsg;
+    uint32_t u32Push = 0, u32Read = 0, u32Cnt, i;
+    int i32Fail = 0;
+
+    CANFD_RingInit(&sRing, s_asRingBuf, 16);
+
+    /* 32 fit the FIFO, the 33rd is lost */
+    for (i = 0; i < 33; i++)
+    {
+        MakeMsg(u32Push, &sMsg);
+        u32Push += CANFD_SimRxPush(psCanfd, 1, &sMsg);
+    }
+    if (u32Push != 32)
+        i32Fail = 1;
+
+    /* The ring takes 16, the rest stays in the FIFO */
+    u32Cnt = CANFD_DrainRxFifoToRing(psCanfd, 1, &sRing);
+    CANFD_SimRxAck(psCanfd, 1);
+    if ((u32Cnt != 16) || (CANFD_RingCount(&sRing) != 16) || (sRing.u32HwLost != 1) ||
+        (CANFD_SimRxFill(psCanfd, 1) != 16))
+        i32Fail = 1;
+
+    /* Ring full: nothing moves, the call is counted */
+    if ((CANFD_DrainRxFifoToRing(psCanfd, 1, &sRing) != 0) || (sRing.u32Overrun != 1))
+        i32Fail = 1;
+    CANFD_SimRxAck(psCanfd, 1);
+
+    /* Consumer and producer take turns */
+    while (u32Read < 32)
+    {
+        for (i = Rand(6); i > 0 && CANFD_RingGet(&sRing, &sMsg); i--)
+            i32Fail |= CheckMsg(u32Read++, &sMsg);
+
+        CANFD_DrainRxFifoToRing(psCanfd, 1, &sRing);
+        CANFD_SimRxAck(psCanfd, 1);
+    }
+
+    /* The lost flag was cleared, so it is counted once */
+    if ((CANFD_RingCount(&sRing) != 0) || (CANFD_SimRxFill(psCanfd, 1) != 0) || (sRing.u32HwLost != 1))
+        i32Fail = 1;
+
+    CANFD_SimClose();
+    return i32Fail;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Tx ring through the FIFO or Queue, with the bus taking frames at random times                           */
+/*---------------------------------------------------------------------------------------------------------*/
+static int Test_TxRing(E_CANFD_MODE eMode)
+{
+    CANFD_T *psCanfd = Open(eMode, 2, 6);
+    CANFD_MSG_RING_T sRing;
+    CANFD_FD_MSG_T sMsg;
+    uint32_t u32Sent = 0, u32Done = 0, u32Cnt, u32Seq, i;
+    int i32Fail = 0;
+
+    CANFD_RingInit(&sRing, s_asRingBuf, RING_SIZE);
+    memset(s_au8Seen, 0, sizeof(s_au8Seen));
+
+    while (u32Done < TX_MSGS)
+    {
+        /* Task: a burst of sends */
+        for (i = Rand(12); (i > 0) && (u32Sent < TX_MSGS); i--)
+        {
+            MakeMsg(u32Sent, &sMsg);
+            if (CANFD_TxRingSend(psCanfd, &sRing, &sMsg) == 0)
+                break;
+            CANFD_SimTxRequest(psCanfd);
+            u32Sent++;
+        }
+
+        /* Bus: some frames go out, then the TC interrupt refills */
+        u32Cnt = CANFD_SimTxSend(psCanfd, Rand(5), s_asOut);
+        for (i = 0; i < u32Cnt; i++)
+        {
+            u32Seq = MsgSeq(&s_asOut[i]);
+            if ((eMode == eCANFD_FIFO_MODE) && (u32Seq != u32Done + i))
+                i32Fail = 1;
+            if ((u32Seq >= TX_MSGS) || s_au8Seen[u32Seq])
+            {
+                i32Fail = 1;
+                continue;
+            }
+            s_au8Seen[u32Seq] = 1;
+            i32Fail |= CheckMsg(u32Seq, &s_asOut[i]);
+        }
+        u32Done += u32Cnt;
+
+        CANFD_TxRingRefill(psCanfd, &sRing);
+        CANFD_SimTxRequest(psCanfd);
+
+        /* Every free FIFO/Queue buffer was refilled before frames wait in the ring */
+        if ((CANFD_RingCount(&sRing) != 0) && (CANFD_SimTxPending(psCanfd) != 6))
+        {
+            printf("  refill left %u of 6 buffers pending\n", CANFD_SimTxPending(psCanfd));
+            i32Fail = 1;
+            break;
+        }
+
+        /* The hardware holds no more than the FIFO/Queue, the rest waits in the ring */
+        if (CANFD_SimTxPending(psCanfd) + CANFD_RingCount(&sRing) != u32Sent - u32Done)
+        {
+            printf("  %u sent, %u done, %u pending, %u in ring\n", u32Sent, u32Done,
+                   CANFD_SimTxPending(psCanfd), CANFD_RingCount(&sRing));
+            i32Fail = 1;
+            break;
+        }
+    }
+
+    CANFD_SimClose();
+    return i32Fail;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Revision A with a busy bus: the refill gives up and the frames stay in the ring                         */
+/*---------------------------------------------------------------------------------------------------------*/
+static int Test_TxTimeout(void)
+{
+    CANFD_T *psCanfd = Open(eCANFD_FIFO_MODE, 0, 8);
+    CANFD_MSG_RING_T sRing;
+    CANFD_FD_MSG_T sMsg;
+    uint32_t i;
+    int i32Fail = 0;
+
+    CANFD_RingInit(&sRing, s_asRingBuf, RING_SIZE);
+    CANFD_SimSetRevA(1, 1);
+
+    for (i = 0; i < 3; i++)
+    {
+        MakeMsg(i, &sMsg);
+        if (CANFD_TxRingSend(psCanfd, &sRing, &sMsg) != 1)
+            i32Fail = 1;
+        CANFD_SimTxRequest(psCanfd);
+    }
+    if ((CANFD_RingCount(&sRing) != 3) || (CANFD_SimTxPending(psCanfd) != 0))
+        i32Fail = 1;
+    if (CANFD_TxRingRefill(psCanfd, &sRing) != 0)
+        i32Fail = 1;
+
+    /* Bus idle: all three go, in order */
+    CANFD_SimSetRevA(1, 0);
+    if (CANFD_TxRingRefill(psCanfd, &sRing) != 3)
+        i32Fail = 1;
+    CANFD_SimTxRequest(psCanfd);
+    if ((CANFD_RingCount(&sRing) != 0) || (CANFD_SimTxSend(psCanfd, 8, s_asOut) != 3))
+        i32Fail = 1;
+    for (i = 0; i < 3; i++)
+        i32Fail |= CheckMsg(i, &s_asOut[i]);
+
+    CANFD_SimClose();
+    return i32Fail;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Tx FIFO/Queue configuration is checked against the Message RAM partition and the mode                  */
+/*---------------------------------------------------------------------------------------------------------*/
+static int Test_TxInit(void)
+{
+    CANFD_FD_T sConfig;
+    CANFD_T *psCanfd;
+    int i32Fail = 0;
+
+    CANFD_GetDefaultConfig(&sConfig, CANFD_OP_CAN_FD_MODE);
+    psCanfd = CANFD_SimOpen(&sConfig);
+
+    /* The default partition has 8 Tx buffer elements */
+    if (CANFD_InitTxFifoQueue(psCanfd, &sConfig.sElemSize, eCANFD_FIFO_MODE, 2, 7) != 0)
+        i32Fail = 1;
+    if (CANFD_InitTxFifoQueue(psCanfd, &sConfig.sElemSize, eCANFD_QUEUE_MODE, 2, 6) != 1)
+        i32Fail = 1;
+    if ((psCanfd->TXBC & (CANFD_TXBC_NDTB_Msk | CANFD_TXBC_TFQS_Msk | CANFD_TXBC_TFQM_Msk)) !=
+        ((2UL << CANFD_TXBC_NDTB_Pos) | (6UL << CANFD_TXBC_TFQS_Pos) | CANFD_TXBC_TFQM_Msk))
+        i32Fail = 1;
+    if ((psCanfd->TXBC & CANFD_TXBC_TBSA_Msk) != (sConfig.sMRamStartAddr.u32TXBC_TBSA & CANFD_TXBC_TBSA_Msk))
+        i32Fail = 1;
+
+    /* Outside configuration mode nothing changes */
+    CANFD_SimRunToNormal(psCanfd);
+    if (CANFD_InitTxFifoQueue(psCanfd, &sConfig.sElemSize, eCANFD_FIFO_MODE, 0, 4) != 0)
+        i32Fail = 1;
+    if (((psCanfd->TXBC & CANFD_TXBC_TFQS_Msk) >> CANFD_TXBC_TFQS_Pos) != 6)
+        i32Fail = 1;
+
+    CANFD_SimClose();
+    return i32Fail;
+}
+
+int main(void)
+{
+    struct
+    {
+        const char *pcName;
+        int (*pfnTest)(void);
+    } asTest[] =
+    {
+        { "Rx FIFO batch read",         Test_RxBatch },
+        { "Rx FIFO drain to ring",      Test_RxRing },
+        { "Tx ring, refill timeout",    Test_TxTimeout },
+        { "Tx FIFO/Queue init",         Test_TxInit },
+    };
+    uint32_t i;
+    int i32Fail, i32Total = 0;
+
+    for (i = 0; i < sizeof(asTest) / sizeof(asTest[0]); i++)
+    {
+        i32Fail = asTest[i].pfnTest() || g_u32SimErrors;
+        printf("%-32s %s\n", asTest[i].pcName, i32Fail ? "FAIL" : "PASS");
+        i32Total |= i32Fail;
+    }
+
+    i32Fail = Test_TxRing(eCANFD_FIFO_MODE) || g_u32SimErrors;
+    printf("%-32s %s\n", "Tx ring through FIFO", i32Fail ? "FAIL" : "PASS");
+    i32Total |= i32Fail;
+
+    i32Fail = Test_TxRing(eCANFD_QUEUE_MODE) || g_u32SimErrors;
+    printf("%-32s %s\n", "Tx ring through Queue", i32Fail ? "FAIL" : "PASS");
+    i32Total |= i32Fail;
+
+    return i32Total;
+}
@@ -0,0 +1,349 @@
+/**************************************************************************//**
+ * @file     test_canfd_filter.c
+ * @brief    Host test of the CAN FD acceptance filter compiler. Random rule
+ *           sets are compiled and installed in the simulated Message RAM, and
+ *           a model of the M_CAN first-match filter scan over the installed
+ *           elements must give the same result as a plain walk of the rules,
+ *           for every 11-bit ID and for a sample of 29-bit IDs.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "canfd_sim.h"
+
+#define RULE_SETS       400
+#define MAX_RULES       48
+#define XID_CLUSTER     0x12345000U
+#define XID_DEFAULT_MSK 0x1FFFFFFFU
+
+/* Filter result: the element config (0 when nothing matched) and, for the
+   Rx buffer config, the buffer index */
+#define RESULT(cfg, idx)    (((uint32_t)(cfg) << 8) | (idx))
+
+static CANFD_FLTR_RULE_T s_asRule[MAX_RULES];
+static CANFD_FLTR_LIST_T s_sList;
+static uint32_t          s_u32Seed = 11;
+
+static const uint8_t s_au8Order[] =
+{
+    eCANFD_FLTR_ELEM_REJ_ID, eCANFD_FLTR_ELEM_STO_RX_BUF_OR_DBG_MSG,
+    eCANFD_FLTR_ELEM_SET_PRI, eCANFD_FLTR_ELEM_SET_PRI_STO_FIFO0, eCANFD_FLTR_ELEM_SET_PRI_STO_FIFO1,
+    eCANFD_FLTR_ELEM_STO_FIFO0, eCANFD_FLTR_ELEM_STO_FIFO1
+};
+
+static uint32_t Rand(uint32_t u32Range)
+{
+    s_u32Seed = s_u32Seed * 1103515245U + 12345U;
+    return ((s_u32Seed >> 16) | (s_u32Seed << 16)) % u32Range;
+}
+
+/* What the rules ask for: the highest ranked target whose rules cover the ID.
+   Rx buffer rules of the same ID keep their order. */
+static uint32_t NaiveMatch(const CANFD_FLTR_RULE_T *psRules, uint32_t u32Num, E_CANFD_ID_TYPE eIdType, uint32_t u32Id)
+{
+    uint32_t u32Ord, i;
+
+    for (u32Ord = 0; u32Ord < sizeof(s_au8Order); u32Ord++)
+    {
+        for (i = 0; i < u32Num; i++)
+        {
+            if ((psRules[i].eIdType != eIdType) || (psRules[i].eConfig != s_au8Order[u32Ord]))
+                continue;
+            if ((u32Id >= psRules[i].u32IdLow) && (u32Id <= psRules[i].u32IdHigh))
+                return RESULT(psRules[i].eConfig,
+                              (psRules[i].eConfig == eCANFD_FLTR_ELEM_STO_RX_BUF_OR_DBG_MSG) ? psRules[i].u32RxBufIdx : 0);
+        }
+    }
+
+    return RESULT(0, 0);
+}
+
+/* The controller: scan the installed standard filter list, first match wins */
+static uint32_t HwMatchStd(CANFD_T *psCanfd, uint32_t u32Id)
+{
+    const uint32_t *pu32Elem = (const uint32_t *)((uint8_t *)psCanfd + CANFD_SRAM_BASE_ADDR
+                                                  + (psCanfd->SIDFC & CANFD_SIDFC_FLSSA_Msk));
+    uint32_t u32Cnt = (psCanfd->SIDFC & CANFD_SIDFC_LSS_Msk) >> CANFD_SIDFC_LSS_Pos;
+    uint32_t i, u32Sft, u32Sfec, u32Id1, u32Id2, u32Match;
+
+    for (i = 0; i < u32Cnt; i++)
+    {
+        u32Sft = pu32Elem[i] >> 30;
+        u32Sfec = (pu32Elem[i] >> 27) & 7;
+        u32Id1 = (pu32Elem[i] >> 16) & 0x7FF;
+        u32Id2 = pu32Elem[i] & 0x7FF;
+
+        if (u32Sfec == eCANFD_FLTR_ELEM_DIS)
+            continue;
+
+        if (u32Sfec == eCANFD_FLTR_ELEM_STO_RX_BUF_OR_DBG_MSG)
+        {
+            /* SFT is ignored, SFID2[5:0] is the buffer */
+            if (u32Id == u32Id1)
+                return RESULT(u32Sfec, u32Id2 & 0x3F);
+            continue;
+        }
+
+        switch (u32Sft)
+        {
+        case eCANFD_SID_FLTR_TYPE_RANGE:
+            u32Match = (u32Id >= u32Id1) && (u32Id <= u32Id2);
+            break;
+        case eCANFD_SID_FLTR_TYPE_DUAL:
+            u32Match = (u32Id == u32Id1) || (u32Id == u32Id2);
+            break;
+        case eCANFD_SID_FLTR_TYPE_CLASSIC:
+            u32Match = ((u32Id ^ u32Id1) & u32Id2) == 0;
+            break;
+        default:
+            u32Match = 0;
+            break;
+        }
+
+        if (u32Match)
+            return RESULT(u32Sfec, 0);
+    }
+
+    return RESULT(0, 0);
+}
+
+/* Same for the extended list. XIDAM is ANDed with the received ID for every
+   element type except the EFT = 11b range. */
+static uint32_t HwMatchExt(CANFD_T *psCanfd, uint32_t u32XidAm, uint32_t u32Id)
+{
+    const uint32_t *pu32Elem = (const uint32_t *)((uint8_t *)psCanfd + CANFD_SRAM_BASE_ADDR
+                                                  + (psCanfd->XIDFC & CANFD_XIDFC_FLESA_Msk));
+    uint32_t u32Cnt = (psCanfd->XIDFC & CANFD_XIDFC_LSE_Msk) >> CANFD_XIDFC_LSE_Pos;
+    uint32_t i, u32Eft, u32Efec, u32Id1, u32Id2, u32Msk, u32Match;
+
+    for (i = 0; i < u32Cnt; i++)
+    {
+        u32Efec = pu32Elem[i * 2] >> 29;
+        u32Id1 = pu32Elem[i * 2] & 0x1FFFFFFF;
+        u32Eft = pu32Elem[i * 2 + 1] >> 30;
+        u32Id2 = pu32Elem[i * 2 + 1] & 0x1FFFFFFF;
+        u32Msk = u32Id & u32XidAm;
+
+        if (u32Efec == eCANFD_FLTR_ELEM_DIS)
+            continue;
+
+        if (u32Efec == eCANFD_FLTR_ELEM_STO_RX_BUF_OR_DBG_MSG)
+        {
+            if (u32Msk == u32Id1)
+                return RESULT(u32Efec, u32Id2 & 0x3F);
+            continue;
+        }
+
+        switch (u32Eft)
+        {
+        case eCANFD_XID_FLTR_TYPE_RANGE:
+            u32Match = (u32Msk >= u32Id1) && (u32Msk <= u32Id2);
+            break;
+        case eCANFD_XID_FLTR_TYPE_DUAL:
+            u32Match = (u32Msk == u32Id1) || (u32Msk == u32Id2);
+            break;
+        case eCANFD_XID_FLTR_TYPE_CLASSIC:
+            u32Match = ((u32Msk ^ u32Id1) & u32Id2) == 0;
+            break;
+        default:
+            u32Match = (u32Id >= u32Id1) && (u32Id <= u32Id2);
+            break;
+        }
+
+        if (u32Match)
+            return RESULT(u32Efec, 0);
+    }
+
+    return RESULT(0, 0);
+}
+
+/* Compile, size the Message RAM to the list and install it like an application would */
+static CANFD_T *Install(const CANFD_FLTR_RULE_T *psRules, uint32_t u32Num, int32_t *pi32Ret)
+{
+    CANFD_FD_T sConfig;
+    CANFD_T *psCanfd;
+
+    *pi32Ret = CANFD_CompileFilters(psRules, u32Num, &s_sList);
+    if (*pi32Ret != 0)
+        return NULL;
+
+    CANFD_GetDefaultConfig(&sConfig, CANFD_OP_CAN_FD_MODE);
+    *pi32Ret = CANFD_BalanceRam(&sConfig, &s_sList);
+    if (*pi32Ret != 0)
+        return NULL;
+
+    psCanfd = CANFD_SimOpen(&sConfig);
+    if (psCanfd != NULL)
+        CANFD_InstallFilters(psCanfd, &s_sList);
+    return psCanfd;
+}
+
+static int CheckId(CANFD_T *psCanfd, const CANFD_FLTR_RULE_T *psRules, uint32_t u32Num,
+                   E_CANFD_ID_TYPE eIdType, uint32_t u32Id)
+{
+    uint32_t u32Exp, u32Got;
+
+    u32Exp = NaiveMatch(psRules, u32Num, eIdType, u32Id);
+    u32Got = (eIdType == eCANFD_SID) ? HwMatchStd(psCanfd, u32Id) : HwMatchExt(psCanfd, XID_DEFAULT_MSK, u32Id);
+    if (u32Exp == u32Got)
+        return 0;
+
+    printf("  %s id 0x%x: expected %x, filter gives %x\n", (eIdType == eCANFD_SID) ? "std" : "ext",
+           u32Id, u32Exp, u32Got);
+    return 1;
+}
+
+static void RandomRule(CANFD_FLTR_RULE_T *psRule)
+{
+    uint32_t u32Msk, u32Len;
+
+    memset(psRule, 0, sizeof(*psRule));
+    psRule->eIdType = Rand(2) ? eCANFD_XID : eCANFD_SID;
+    psRule->eConfig = (E_CANFD_FLTR_CONFIG)(1 + Rand(7));
+
+    /* Most IDs come from a small window so rules overlap and merge */
+    if (psRule->eIdType == eCANFD_SID)
+    {
+        u32Msk = 0x7FF;
+        psRule->u32IdLow = Rand(3) ? 0x300 + Rand(96) : Rand(0x800);
+        u32Len = Rand(48);
+    }
+    else
+    {
+        u32Msk = 0x1FFFFFFF;
+        psRule->u32IdLow = Rand(3) ? XID_CLUSTER + Rand(1024) : Rand(0x20000000);
+        u32Len = Rand(2) ? Rand(16) : Rand(4096);
+    }
+
+    psRule->u32IdHigh = psRule->u32IdLow;
+    if (psRule->eConfig == eCANFD_FLTR_ELEM_STO_RX_BUF_OR_DBG_MSG)
+        psRule->u32RxBufIdx = Rand(CANFD_MAX_RX_BUF_ELEMS);
+    else if (Rand(5) < 2)
+        psRule->u32IdHigh = (psRule->u32IdLow + u32Len > u32Msk) ? u32Msk : psRule->u32IdLow + u32Len;
+}
+
+static int Test_RandomSets(void)
+{
+    CANFD_T *psCanfd;
+    uint32_t u32Set, u32Num, u32Id, i, u32Installed = 0;
+    int32_t i32Ret;
+    int i32Fail = 0;
+
+    for (u32Set = 0; (u32Set < RULE_SETS) && !i32Fail; u32Set++)
+    {
+        u32Num = 1 + Rand(MAX_RULES);
+        for (i = 0; i < u32Num; i++)
+            RandomRule(&s_asRule[i]);
+
+        psCanfd = Install(s_asRule, u32Num, &i32Ret);
+        if (psCanfd == NULL)
+        {
+            /* Only an honest shortage of elements may fail */
+            if ((i32Ret != CANFD_FLTR_ERR_NO_SPACE) ||
+                    ((s_sList.u32StdCnt <= CANFD_MAX_11_BIT_FTR_ELEMS) && (s_sList.u32ExtCnt <= CANFD_MAX_29_BIT_FTR_ELEMS)))
+            {
+                printf("  set %u: compile/install returned %d\n", u32Set, i32Ret);
+                i32Fail = 1;
+            }
+            continue;
+        }
+
+        u32Installed++;
+
+        for (u32Id = 0; u32Id < 0x800; u32Id++)
+            i32Fail |= CheckId(psCanfd, s_asRule, u32Num, eCANFD_SID, u32Id);
+
+        /* Rule edges and their neighbours, then random IDs near and far */
+        for (i = 0; i < u32Num; i++)
+        {
+            if (s_asRule[i].eIdType != eCANFD_XID)
+                continue;
+            i32Fail |= CheckId(psCanfd, s_asRule, u32Num, eCANFD_XID, (s_asRule[i].u32IdLow - 1) & 0x1FFFFFFF);
+            i32Fail |= CheckId(psCanfd, s_asRule, u32Num, eCANFD_XID, s_asRule[i].u32IdLow);
+            i32Fail |= CheckId(psCanfd, s_asRule, u32Num, eCANFD_XID, (s_asRule[i].u32IdLow + s_asRule[i].u32IdHigh) / 2);
+            i32Fail |= CheckId(psCanfd, s_asRule, u32Num, eCANFD_XID, s_asRule[i].u32IdHigh);
+            i32Fail |= CheckId(psCanfd, s_asRule, u32Num, eCANFD_XID, (s_asRule[i].u32IdHigh + 1) & 0x1FFFFFFF);
+        }
+
+        for (i = 0; i < 2048; i++)
+        {
+            u32Id = (i & 1) ? Rand(0x20000000) : XID_CLUSTER + Rand(6144);
+            i32Fail |= CheckId(psCanfd, s_asRule, u32Num, eCANFD_XID, u32Id);
+        }
+
+        CANFD_SimClose();
+    }
+
+    /* The sets are sized so most of them fit */
+    if (u32Installed < RULE_SETS / 2)
+    {
+        printf("  only %u of %u sets fit\n", u32Installed, RULE_SETS);
+        i32Fail = 1;
+    }
+
+    return i32Fail;
+}
+
+/* An extended range must not be widened by XIDAM (EFT = 11b) */
+static int Test_XidRangeIgnoresXidam(void)
+{
+    CANFD_FLTR_RULE_T sRule;
+    CANFD_T *psCanfd;
+    uint32_t u32Id, u32Exp, u32Got;
+    int32_t i32Ret;
+    int i32Fail = 0;
+
+    memset(&sRule, 0, sizeof(sRule));
+    sRule.eIdType = eCANFD_XID;
+    sRule.u32IdLow = 0x1000;
+    sRule.u32IdHigh = 0x10FF;
+    sRule.eConfig = eCANFD_FLTR_ELEM_STO_FIFO0;
+
+    psCanfd = Install(&sRule, 1, &i32Ret);
+    if (psCanfd == NULL)
+    {
+        printf("  compile/install returned %d\n", i32Ret);
+        return 1;
+    }
+
+    /* A J1939 style mask that drops ID bits 8-11 */
+    for (u32Id = 0x0E00; (u32Id < 0x2100) && !i32Fail; u32Id++)
+    {
+        u32Exp = NaiveMatch(&sRule, 1, eCANFD_XID, u32Id);
+        u32Got = HwMatchExt(psCanfd, 0x1FFFF0FF, u32Id);
+        if (u32Exp != u32Got)
+        {
+            printf("  id 0x%x: expected %x, filter gives %x\n", u32Id, u32Exp, u32Got);
+            i32Fail = 1;
+        }
+    }
+
+    CANFD_SimClose();
+    return i32Fail;
+}
+
+int main(void)
+{
+    struct
+    {
+        const char *pcName;
+        int (*pfnTest)(void);
+    } asTest[] =
+    {
+        { "Random rule sets",           Test_RandomSets },
+        { "Ext range with XIDAM",       Test_XidRangeIgnoresXidam },
+    };
+    uint32_t i;
+    int i32Fail, i32Total = 0;
+
+    for (i = 0; i < sizeof(asTest) / sizeof(asTest[0]); i++)
+    {
+        i32Fail = asTest[i].pfnTest() || g_u32SimErrors;
+        printf("%-32s %s\n", asTest[i].pcName, i32Fail ? "FAIL" : "PASS");
+        i32Total |= i32Fail;
+    }
+
+    return i32Total;
+}
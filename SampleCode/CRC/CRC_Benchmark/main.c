@@ -0,0 +1,218 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @brief    Check and benchmark the CRC library.
+ *
+ *           Each CRC is first checked against the standard check value of
+ *           "123456789" and against a bit-by-bit reference on buffers of
+ *           many lengths and alignments. CRC32 and CRC32C are checked with
+ *           both the CRC32 instructions and the tables. Then each CRC is
+ *           timed with the generic timer on a 4 MB buffer and reported in
+ *           MB/s.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "NuMicro.h"
+#include "nu_crc.h"
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Define global variables and constants                                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+#define BENCH_SIZE      (4 * 1024 * 1024)
+#define BENCH_LOOPS     4
+#define CHECK_SIZE      (3 * 8192 * 2 + 1000)  /* Takes the long and short three-way loops */
+
+static uint8_t g_au8Buf[BENCH_SIZE] __attribute__((aligned(64)));
+
+typedef struct
+{
+    const char  *pcName;
+    uint32_t    u32Check;               /* CRC of "123456789" */
+    uint32_t    u32Init;
+    int         i32Hw;                  /* Uses the CRC32 instructions when enabled */
+} CRC_INFO_T;
+
+static const CRC_INFO_T g_asCrc[] =
+{
+    { "CRC-32",             0xCBF43926U, 0,                 1 },
+    { "CRC-32C",            0xE3069283U, 0,                 1 },
+    { "CRC-16/MODBUS",      0x4B37U,     CRC16_MODBUS_INIT, 0 },
+    { "CRC-16/CCITT-FALSE", 0x29B1U,     CRC16_CCITT_INIT,  0 },
+};
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* CRCs by the library and bit by bit                                                                      */
+/*---------------------------------------------------------------------------------------------------------*/
+static uint32_t CRC_Lib(uint32_t u32Id, uint32_t u32Crc, const void *pvData, uint32_t u32Len)
+{
+    switch (u32Id)
+    {
+    case 0:
+        return nu_crc32(u32Crc, pvData, u32Len);
+    case 1:
+        return nu_crc32c(u32Crc, pvData, u32Len);
+    case 2:
+        return nu_crc16((uint16_t)u32Crc, pvData, u32Len);
+    default:
+        return nu_crc16_ccitt((uint16_t)u32Crc, pvData, u32Len);
+    }
+}
+
+static uint32_t CRC_Bitwise(uint32_t u32Id, uint32_t u32Crc, const uint8_t *pu8, uint32_t u32Len)
+{
+    uint32_t i;
+
+    if (u32Id <= 1)
+        u32Crc = ~u32Crc;
+
+    while (u32Len--)
+    {
+        if (u32Id == 3)
+        {
+            u32Crc ^= (uint32_t)*pu8++ << 8;
+            for (i = 0; i < 8; i++)
+                u32Crc = ((u32Crc << 1) ^ ((u32Crc & 0x8000U) ? 0x1021U : 0U)) & 0xFFFFU;
+        }
+        else
+        {
+            u32Crc ^= *pu8++;
+            for (i = 0; i < 8; i++)
+                u32Crc = (u32Crc >> 1) ^ ((u32Crc & 1U) ? ((u32Id == 0) ? 0xEDB88320U :
+                                                           (u32Id == 1) ? 0x82F63B78U : 0xA001U) : 0U);
+        }
+    }
+
+    return (u32Id <= 1) ? ~u32Crc : u32Crc;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Checks                                                                                                  */
+/*---------------------------------------------------------------------------------------------------------*/
+static const uint32_t g_au32Len[] = { 0, 1, 2, 3, 4, 7, 8, 9, 15, 16, 17, 63, 255, 767, 768, 769, 1000,
+                                      3 * 8192 - 1, 3 * 8192, 3 * 8192 + 1, CHECK_SIZE };
+
+static int CRC_Check(uint32_t u32Id)
+{
+    const CRC_INFO_T *psCrc = &g_asCrc[u32Id];
+    uint32_t u32Off, i, u32Len, u32Ref, u32Half;
+    int i32Fail = 0;
+
+    if (CRC_Lib(u32Id, psCrc->u32Init, "123456789", 9) != psCrc->u32Check)
+        i32Fail = 1;
+
+    for (u32Off = 0; u32Off < 8; u32Off++)
+    {
+        for (i = 0; i < sizeof(g_au32Len) / sizeof(g_au32Len[0]); i++)
+        {
+            u32Len = g_au32Len[i];
+            u32Ref = CRC_Bitwise(u32Id, psCrc->u32Init, g_au8Buf + u32Off, u32Len);
+
+            if (CRC_Lib(u32Id, psCrc->u32Init, g_au8Buf + u32Off, u32Len) != u32Ref)
+                i32Fail = 1;
+
+            /* Continued over two calls */
+            u32Half = u32Len / 2;
+            if (CRC_Lib(u32Id, CRC_Lib(u32Id, psCrc->u32Init, g_au8Buf + u32Off, u32Half),
+                        g_au8Buf + u32Off + u32Half, u32Len - u32Half) != u32Ref)
+                i32Fail = 1;
+        }
+    }
+
+    return i32Fail;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Benchmark                                                                                               */
+/*---------------------------------------------------------------------------------------------------------*/
+static uint32_t CRC_Bench(uint32_t u32Id)
+{
+    uint64_t u64Ticks;
+    uint32_t i, u32Crc = g_asCrc[u32Id].u32Init;
+
+    u64Ticks = EL0_GetCurrentPhysicalValue();
+    for (i = 0; i < BENCH_LOOPS; i++)
+        u32Crc = CRC_Lib(u32Id, u32Crc, g_au8Buf, BENCH_SIZE);
+    u64Ticks = EL0_GetCurrentPhysicalValue() - u64Ticks;
+
+    /* Keep the result alive */
+    __asm volatile("" :: "r"(u32Crc));
+
+    return (uint32_t)((uint64_t)BENCH_SIZE * BENCH_LOOPS * raw_read_cntfrq_el0() / u64Ticks / (1024 * 1024));
+}
+
+void SYS_Init(void)
+{
+    /* Enable UART module clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Select UART module clock source as SYSCLK1 and UART module clock divider as 15 */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL2_UART0SEL_SYSCLK1_DIV2, CLK_CLKDIV1_UART0(15));
+
+    /* Set GPE multi-function pins for UART0 RXD and TXD */
+    SYS->GPE_MFPH &= ~(SYS_GPE_MFPH_PE14MFP_Msk | SYS_GPE_MFPH_PE15MFP_Msk);
+    SYS->GPE_MFPH |= (SYS_GPE_MFPH_PE14MFP_UART0_TXD | SYS_GPE_MFPH_PE15MFP_UART0_RXD);
+}
+
+void UART0_Init()
+{
+    /* Configure UART0 and set UART0 baud rate */
+    UART_Open(UART0, 115200);
+}
+
+/* main function */
+int main(void)
+{
+    uint32_t i, u32Seed = 1, u32Hw, u32Table;
+    int i32Hw;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Init System, IP clock and multi-function I/O */
+    SYS_Init();
+
+    /* Lock protected registers */
+    SYS_LockReg();
+
+    /* Init UART0 for sysprintf */
+    UART0_Init();
+
+    global_timer_init();
+
+    for (i = 0; i < BENCH_SIZE; i++)
+    {
+        u32Seed = u32Seed * 1103515245U + 12345U;
+        g_au8Buf[i] = (uint8_t)(u32Seed >> 16);
+    }
+
+    i32Hw = nu_crc_hw_enabled();
+    sysprintf("\nCRC32 instructions %s\n", i32Hw ? "present" : "not present, tables only");
+
+    sysprintf("\nCheck value and bit-by-bit reference, 8 alignments, lengths up to %d:\n", CHECK_SIZE);
+    for (i = 0; i < sizeof(g_asCrc) / sizeof(g_asCrc[0]); i++)
+    {
+        nu_crc_set_hw(0);
+        u32Table = CRC_Check(i);
+        nu_crc_set_hw(1);
+        u32Hw = g_asCrc[i].i32Hw && i32Hw ? CRC_Check(i) : 0;
+        sysprintf("  %-20s %s\n", g_asCrc[i].pcName, (u32Table || u32Hw) ? "FAIL" : "PASS");
+    }
+
+    sysprintf("\nMB/s over %d MB:\n", BENCH_SIZE / (1024 * 1024));
+    sysprintf("  %-20s %10s %10s\n", "CRC", "tables", "CRC32 ins");
+    for (i = 0; i < sizeof(g_asCrc) / sizeof(g_asCrc[0]); i++)
+    {
+        nu_crc_set_hw(0);
+        u32Table = CRC_Bench(i);
+        nu_crc_set_hw(1);
+        if (g_asCrc[i].i32Hw && i32Hw)
+            sysprintf("  %-20s %10d %10d\n", g_asCrc[i].pcName, u32Table, CRC_Bench(i));
+        else
+            sysprintf("  %-20s %10d %10s\n", g_asCrc[i].pcName, u32Table, "-");
+    }
+
+    sysprintf("\nDone\n");
+
+    while (1) {};
+}
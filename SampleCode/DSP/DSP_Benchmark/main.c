@@ -0,0 +1,531 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @brief    Check and benchmark the DSP library kernels, and run them on an
+ *           EADC stream.
+ *
+ *           Every kernel first runs with the C and with the NEON versions and
+ *           the outputs are compared bit by bit. The FFTs are also compared to
+ *           a direct DFT. Then each kernel is timed with the PMU cycle counter
+ *           and reported in CPU cycles per sample for both versions.
+ *
+ *           The stream demo samples EADC0 CH0 - CH3 on an EPWM0 trigger into
+ *           blocks of EADC_SVC and computes the RMS and peak of each channel in
+ *           the block callback.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "NuMicro.h"
+#include "nu_dsp.h"
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Define global variables and constants                                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+#define BLOCK_LEN       1024            /* Samples per kernel call */
+#define FIR_TAPS        64
+#define DECIM_M         4
+#define DECIM_TAPS      48
+#define BIQUAD_STAGES   4
+#define FFT_LEN         1024
+#define BENCH_LOOPS     16
+
+#define STREAM_CH       4               /* EADC0 CH0 - CH3, one sample module each */
+#define STREAM_FRAMES   256             /* Frames per block */
+#define STREAM_BLOCKS   4
+
+static float    g_afIn[BLOCK_LEN], g_afOut[2][BLOCK_LEN];
+static int16_t  g_ai16In[BLOCK_LEN], g_ai16Out[2][BLOCK_LEN];
+static uint16_t g_au16Adc[BLOCK_LEN * 4];
+
+static float    g_afFirCoef[FIR_TAPS], g_afFirState[FIR_TAPS - 1 + BLOCK_LEN];
+static int16_t  g_ai16FirCoef[FIR_TAPS], g_ai16FirState[FIR_TAPS - 1 + BLOCK_LEN];
+static float    g_afDecCoef[DECIM_TAPS], g_afDecState[DECIM_TAPS - 1 + BLOCK_LEN];
+static float    g_afBqCoef[5 * BIQUAD_STAGES], g_afBqState[8 * BIQUAD_STAGES];
+
+static float    g_afFftTw[DSP_FFT_F32_TWIDDLE_LEN(FFT_LEN)], g_afFft[2][2 * FFT_LEN];
+static int16_t  g_ai16FftTw[DSP_FFT_Q15_TWIDDLE_LEN(FFT_LEN)], g_ai16Fft[2][2 * FFT_LEN];
+
+static dsp_fir_f32_t        g_sFir;
+static dsp_fir_q15_t        g_sFirQ15;
+static dsp_fir_decim_f32_t  g_sDec;
+static dsp_biquad_f32_t     g_sBq;
+static dsp_fft_f32_t        g_sFft;
+static dsp_fft_q15_t        g_sFftQ15;
+
+static uint16_t g_au16Stream[STREAM_BLOCKS * STREAM_FRAMES * STREAM_CH] __attribute__((aligned(64)));
+static float    g_afStream[STREAM_FRAMES];
+static EADC_SVC_T g_sStream;
+static volatile float    g_afRms[STREAM_CH], g_afPeak[STREAM_CH];
+static volatile uint32_t g_u32StreamSeq, g_u32StreamFlags;
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* PMU cycle counter                                                                                       */
+/*---------------------------------------------------------------------------------------------------------*/
+static void PMU_Init(void)
+{
+    uint64_t u64Pmcr;
+
+    __asm volatile("mrs %0, pmcr_el0" : "=r"(u64Pmcr));
+    u64Pmcr |= (1UL << 0) | (1UL << 2);         /* E: enable counters, C: reset cycle counter */
+    __asm volatile("msr pmcr_el0, %0" :: "r"(u64Pmcr));
+    __asm volatile("msr pmcntenset_el0, %0" :: "r"(1UL << 31));
+    __asm volatile("isb");
+}
+
+static inline uint64_t PMU_Cycles(void)
+{
+    uint64_t u64Cnt;
+
+    __asm volatile("isb; mrs %0, pmccntr_el0" : "=r"(u64Cnt) :: "memory");
+    return u64Cnt;
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Test data                                                                                               */
+/*---------------------------------------------------------------------------------------------------------*/
+static uint32_t g_u32Rand = 0x12345678;
+
+static float RandF(void)
+{
+    g_u32Rand = g_u32Rand * 1664525UL + 1013904223UL;
+    return (float)(int32_t)g_u32Rand * (1.0f / 2147483648.0f);
+}
+
+static void Data_Init(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < BLOCK_LEN; i++)
+    {
+        g_afIn[i] = 0.5f * sinf(0.05f * i) + 0.25f * RandF();
+        g_ai16In[i] = (int16_t)(g_afIn[i] * 32767.0f);
+    }
+    for (i = 0; i < BLOCK_LEN * 4; i++)
+        g_au16Adc[i] = (uint16_t)((g_u32Rand = g_u32Rand * 1664525UL + 1013904223UL) >> 20);
+
+    /* Windowed-sinc low-pass filters */
+    for (i = 0; i < FIR_TAPS; i++)
+    {
+        float t = (float)i - (FIR_TAPS - 1) / 2.0f;
+        float w = 0.54f - 0.46f * cosf(6.2831853f * i / (FIR_TAPS - 1));
+
+        g_afFirCoef[i] = w * ((t == 0.0f) ? 0.25f : sinf(0.7853982f * t) / (3.1415927f * t));
+        g_ai16FirCoef[i] = (int16_t)(g_afFirCoef[i] * 32767.0f);
+    }
+    for (i = 0; i < DECIM_TAPS; i++)
+    {
+        float t = (float)i - (DECIM_TAPS - 1) / 2.0f;
+        float w = 0.54f - 0.46f * cosf(6.2831853f * i / (DECIM_TAPS - 1));
+
+        g_afDecCoef[i] = w * sinf(0.7853982f * t) / (3.1415927f * t);
+    }
+
+    /* Four identical second-order low-pass sections, fc = fs / 20, Q = 0.707 */
+    for (i = 0; i < BIQUAD_STAGES; i++)
+    {
+        float w0 = 6.2831853f / 20.0f, alpha = sinf(w0) / (2.0f * 0.7071068f), a0 = 1.0f + alpha;
+        float b1 = (1.0f - cosf(w0)) / a0;
+
+        g_afBqCoef[5 * i + 0] = b1 / 2.0f;
+        g_afBqCoef[5 * i + 1] = b1;
+        g_afBqCoef[5 * i + 2] = b1 / 2.0f;
+        g_afBqCoef[5 * i + 3] = 2.0f * cosf(w0) / a0;
+        g_afBqCoef[5 * i + 4] = -(1.0f - alpha) / a0;
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Kernels under test. Each one starts from the same state and input, and writes to g_xxOut[path].        */
+/*---------------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+    const char  *pcName;
+    void        (*pfnRun)(int path);
+    uint32_t    u32Samples;             /* Input samples per call */
+    const void  *pvOut[2];
+    uint32_t    u32OutBytes;
+} KERNEL_T;
+
+static void Run_U16ToF32(int path)
+{
+    dsp_u16_to_f32(g_au16Adc + 1, 4, g_afOut[path], BLOCK_LEN, 2048.0f, 1.0f / 2048.0f);
+}
+
+static void Run_F32ToQ15(int path)
+{
+    dsp_f32_to_q15(g_afIn, g_ai16Out[path], BLOCK_LEN);
+}
+
+static void Run_FirF32(int path)
+{
+    dsp_fir_f32_init(&g_sFir, FIR_TAPS, g_afFirCoef, g_afFirState, BLOCK_LEN);
+    dsp_fir_f32(&g_sFir, g_afIn, g_afOut[path], BLOCK_LEN);
+}
+
+static void Run_FirQ15(int path)
+{
+    dsp_fir_q15_init(&g_sFirQ15, FIR_TAPS, g_ai16FirCoef, g_ai16FirState, BLOCK_LEN);
+    dsp_fir_q15(&g_sFirQ15, g_ai16In, g_ai16Out[path], BLOCK_LEN);
+}
+
+static void Run_Decim(int path)
+{
+    dsp_fir_decim_f32_init(&g_sDec, DECIM_M, DECIM_TAPS, g_afDecCoef, g_afDecState, BLOCK_LEN);
+    dsp_fir_decim_f32(&g_sDec, g_afIn, g_afOut[path], BLOCK_LEN);
+}
+
+static void Run_Biquad4(int path)
+{
+    dsp_biquad4_f32_init(&g_sBq, BIQUAD_STAGES, g_afBqCoef, g_afBqState);
+    dsp_biquad4_f32(&g_sBq, g_afIn, g_afOut[path], BLOCK_LEN / 4);
+}
+
+static void Run_RmsPeak(int path)
+{
+    int16_t i16Rms, i16Peak;
+
+    dsp_rms_peak_f32(g_afIn, BLOCK_LEN, &g_afOut[path][0], &g_afOut[path][1]);
+    dsp_rms_peak_q15(g_ai16In, BLOCK_LEN, &i16Rms, &i16Peak);
+    g_afOut[path][2] = i16Rms;
+    g_afOut[path][3] = i16Peak;
+}
+
+static void Run_FftF32(int path)
+{
+    uint32_t i;
+
+    for (i = 0; i < FFT_LEN; i++)
+    {
+        g_afFft[path][2 * i] = g_afIn[i];
+        g_afFft[path][2 * i + 1] = 0.0f;
+    }
+    dsp_fft_f32(&g_sFft, g_afFft[path], 0);
+}
+
+static void Run_FftQ15(int path)
+{
+    uint32_t i;
+
+    for (i = 0; i < FFT_LEN; i++)
+    {
+        g_ai16Fft[path][2 * i] = g_ai16In[i];
+        g_ai16Fft[path][2 * i + 1] = 0;
+    }
+    dsp_fft_q15(&g_sFftQ15, g_ai16Fft[path]);
+}
+
+static const KERNEL_T g_asKernel[] =
+{
+    { "u16->f32, stride 4",   Run_U16ToF32, BLOCK_LEN,     { g_afOut[0], g_afOut[1] },     BLOCK_LEN * sizeof(float) },
+    { "f32->q15",             Run_F32ToQ15, BLOCK_LEN,     { g_ai16Out[0], g_ai16Out[1] }, BLOCK_LEN * sizeof(int16_t) },
+    { "FIR f32, 64 taps",     Run_FirF32,   BLOCK_LEN,     { g_afOut[0], g_afOut[1] },     BLOCK_LEN * sizeof(float) },
+    { "FIR q15, 64 taps",     Run_FirQ15,   BLOCK_LEN,     { g_ai16Out[0], g_ai16Out[1] }, BLOCK_LEN * sizeof(int16_t) },
+    { "Decimator 4, 48 taps", Run_Decim,    BLOCK_LEN,     { g_afOut[0], g_afOut[1] },     BLOCK_LEN / DECIM_M * sizeof(float) },
+    { "Biquad 4ch x 4 stage", Run_Biquad4,  BLOCK_LEN,     { g_afOut[0], g_afOut[1] },     BLOCK_LEN * sizeof(float) },
+    { "RMS/peak f32 + q15",   Run_RmsPeak,  2 * BLOCK_LEN, { g_afOut[0], g_afOut[1] },     4 * sizeof(float) },
+    { "FFT f32, 1024",        Run_FftF32,   FFT_LEN,       { g_afFft[0], g_afFft[1] },     sizeof(g_afFft[0]) },
+    { "FFT q15, 1024",        Run_FftQ15,   FFT_LEN,       { g_ai16Fft[0], g_ai16Fft[1] }, sizeof(g_ai16Fft[0]) },
+};
+
+#define KERNEL_NUM  (sizeof(g_asKernel) / sizeof(g_asKernel[0]))
+
+/* Largest error of the FFT outputs against a direct DFT of g_afIn, in units of 1e-6 of the largest bin */
+static uint32_t FFT_CheckDFT(const float *pfF32, const int16_t *pi16Q15, uint32_t *pu32ErrQ15)
+{
+    uint32_t k, n;
+    double   re, im, a, max = 0.0, err = 0.0, errq = 0.0;
+    static float afRef[2 * FFT_LEN];
+
+    for (k = 0; k < FFT_LEN; k++)
+    {
+        re = im = 0.0;
+        for (n = 0; n < FFT_LEN; n++)
+        {
+            a = -6.283185307179586 * (double)((k * n) % FFT_LEN) / FFT_LEN;
+            re += g_afIn[n] * cos(a);
+            im += g_afIn[n] * sin(a);
+        }
+        afRef[2 * k] = (float)re;
+        afRef[2 * k + 1] = (float)im;
+        if (fabs(re) > max) max = fabs(re);
+        if (fabs(im) > max) max = fabs(im);
+    }
+
+    for (k = 0; k < 2 * FFT_LEN; k++)
+    {
+        /* The Q15 input is g_afIn scaled by 32767 and the output is scaled by 1 / FFT_LEN */
+        a = fabs(pfF32[k] - afRef[k]);
+        if (a > err) err = a;
+        a = fabs(pi16Q15[k] * (double)FFT_LEN / 32767.0 - afRef[k]);
+        if (a > errq) errq = a;
+    }
+
+    *pu32ErrQ15 = (uint32_t)(errq / max * 1e6);
+    return (uint32_t)(err / max * 1e6);
+}
+
+static int32_t DSP_SelfCheck(void)
+{
+    uint32_t i, u32Err, u32ErrQ15;
+    int32_t  i32Fail = 0;
+
+    sysprintf("\nNEON and C kernels must give identical results:\n");
+    for (i = 0; i < KERNEL_NUM; i++)
+    {
+        dsp_set_neon(0);
+        g_asKernel[i].pfnRun(0);
+        dsp_set_neon(1);
+        g_asKernel[i].pfnRun(1);
+
+        if (memcmp(g_asKernel[i].pvOut[0], g_asKernel[i].pvOut[1], g_asKernel[i].u32OutBytes) == 0)
+        {
+            sysprintf("  %-22s PASS\n", g_asKernel[i].pcName);
+        }
+        else
+        {
+            sysprintf("  %-22s FAIL\n", g_asKernel[i].pcName);
+            i32Fail = -1;
+        }
+    }
+    if (!dsp_neon_enabled())
+        sysprintf("  (built without NEON, both runs used the C kernels)\n");
+
+    u32Err = FFT_CheckDFT(g_afFft[1], g_ai16Fft[1], &u32ErrQ15);
+    sysprintf("\nFFT against direct DFT, max error / max bin: f32 %d ppm, q15 %d ppm\n", u32Err, u32ErrQ15);
+    /* Float error stays near rounding; Q15 loses log4(N) * 2 bits to the stage scaling */
+    if ((u32Err > 10) || (u32ErrQ15 > 5000))
+    {
+        sysprintf("  FAIL\n");
+        i32Fail = -1;
+    }
+
+    return i32Fail;
+}
+
+static void DSP_Benchmark(void)
+{
+    uint32_t i, u32Loop, u32Cps[2];
+    uint64_t u64Start;
+    int      path;
+
+    sysprintf("\nCPU cycles per sample, %d samples per call:\n", BLOCK_LEN);
+    sysprintf("  %-22s %10s %10s %8s\n", "kernel", "C", "NEON", "speedup");
+
+    for (i = 0; i < KERNEL_NUM; i++)
+    {
+        for (path = 0; path < 2; path++)
+        {
+            dsp_set_neon(path);
+            g_asKernel[i].pfnRun(path);         /* Warm the caches */
+
+            u64Start = PMU_Cycles();
+            for (u32Loop = 0; u32Loop < BENCH_LOOPS; u32Loop++)
+                g_asKernel[i].pfnRun(path);
+            /* In hundredths of a cycle */
+            u32Cps[path] = (uint32_t)((PMU_Cycles() - u64Start) * 100 / (BENCH_LOOPS * g_asKernel[i].u32Samples));
+        }
+
+        sysprintf("  %-22s %7d.%02d %7d.%02d %5d.%02d\n", g_asKernel[i].pcName,
+                  u32Cps[0] / 100, u32Cps[0] % 100, u32Cps[1] / 100, u32Cps[1] % 100,
+                  u32Cps[0] / u32Cps[1], (u32Cps[0] * 100 / u32Cps[1]) % 100);
+    }
+
+    dsp_set_neon(1);
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* EADC stream                                                                                             */
+/*---------------------------------------------------------------------------------------------------------*/
+static void Stream_Block(void *pvArg, const EADC_SVC_BLOCK_T *psBlk)
+{
+    uint32_t ch;
+    float    fRms, fPeak;
+
+    /* Frames are CH0 .. CH3 in sample module order */
+    for (ch = 0; ch < STREAM_CH; ch++)
+    {
+        dsp_u16_to_f32(psBlk->pu16Data + ch, STREAM_CH, g_afStream, psBlk->u32Frames, 2048.0f, 1.0f / 2048.0f);
+        dsp_rms_peak_f32(g_afStream, psBlk->u32Frames, &fRms, &fPeak);
+        g_afRms[ch] = fRms;
+        g_afPeak[ch] = fPeak;
+    }
+    g_u32StreamFlags |= psBlk->u32Flags;
+    g_u32StreamSeq = psBlk->u32Seq;
+
+    EADCSVC_Release((EADC_SVC_T *)pvArg, psBlk->u32Seq);
+}
+
+void PDMA2_IRQHandler(void)
+{
+    EADCSVC_PDMA_IRQHandler(&g_sStream);
+}
+
+static void DSP_StreamDemo(void)
+{
+    EADC_SVC_CFG_T sCfg;
+    EADC_SVC_STAT_T sStat;
+    uint32_t ch, u32Seq = 0, u32Shown = 0;
+
+    memset(&sCfg, 0, sizeof(sCfg));
+    sCfg.eadc = EADC0;
+    sCfg.pdma = PDMA2;
+    sCfg.u32Ch = 2;
+    sCfg.u32Req = PDMA_EADC0_RX;
+    sCfg.u32InputMode = EADC_CTL_DIFFEN_SINGLE_END;
+    sCfg.u32TriggerSrc = EADC_EPWM0TG0_TRIGGER;
+    sCfg.u32Modules = STREAM_CH;
+    for (ch = 0; ch < STREAM_CH; ch++)
+        sCfg.au32Channel[ch] = ch;
+    sCfg.pu16Buf = g_au16Stream;
+    sCfg.u32Blocks = STREAM_BLOCKS;
+    sCfg.u32BlockFrames = STREAM_FRAMES;
+    sCfg.pfnBlock = Stream_Block;
+    sCfg.pvArg = &g_sStream;
+
+    if (EADCSVC_Open(&g_sStream, &sCfg) != EADC_SVC_OK)
+    {
+        sysprintf("EADCSVC_Open failed\n");
+        return;
+    }
+
+    IRQ_SetHandler((IRQn_ID_t)PDMA2_IRQn, PDMA2_IRQHandler);
+    IRQ_Enable((IRQn_ID_t)PDMA2_IRQn);
+
+    sysprintf("\nEADC0 CH0 - CH3, RMS and peak in 1/1000 of half scale. Press any key to stop.\n");
+    EPWM_Start(EPWM0, BIT0);
+
+    while (sysIsKbHit() == 0)
+    {
+        if (g_u32StreamSeq == u32Seq)
+            continue;
+        u32Seq = g_u32StreamSeq;
+
+        /* Blocks come faster than UART can print, show every 16th */
+        if (++u32Shown % 16)
+            continue;
+
+        sysprintf("block %6d:", u32Seq);
+        for (ch = 0; ch < STREAM_CH; ch++)
+            sysprintf("  CH%d %4d/%4d", ch, (int)(g_afRms[ch] * 1000.0f), (int)(g_afPeak[ch] * 1000.0f));
+        sysprintf("%s\n", g_u32StreamFlags ? "  (overrun or trigger lost)" : "");
+        g_u32StreamFlags = 0;
+    }
+    sysgetchar();
+
+    EPWM_ForceStop(EPWM0, BIT0);
+    IRQ_Disable((IRQn_ID_t)PDMA2_IRQn);
+    EADCSVC_Close(&g_sStream);
+
+    EADCSVC_GetStat(&g_sStream, &sStat);
+    sysprintf("%d blocks, %d overrun, %d with lost triggers\n", sStat.u32Blocks, sStat.u32Overrun, sStat.u32TriggerLost);
+}
+
+void SYS_Init(void)
+{
+    /* Enable UART module clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Select UART module clock source as SYSCLK1 and UART module clock divider as 15 */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL2_UART0SEL_SYSCLK1_DIV2, CLK_CLKDIV1_UART0(15));
+
+    /* Enable EPWM0 module clock */
+    CLK_EnableModuleClock(EPWM0_MODULE);
+
+    /* Enable EADC module clock */
+    CLK_EnableModuleClock(EADC_MODULE);
+
+    /* EADC clock source is 180 MHz, set divider to 18, ADC clock is 180/18 MHz */
+    CLK_SetModuleClock(EADC_MODULE, 0, CLK_CLKDIV4_EADC(18));
+
+    /* Enable PDMA clock source */
+    CLK_EnableModuleClock(PDMA2_MODULE);
+
+    /* Set GPE multi-function pins for UART0 RXD and TXD */
+    SYS->GPE_MFPH &= ~(SYS_GPE_MFPH_PE14MFP_Msk | SYS_GPE_MFPH_PE15MFP_Msk);
+    SYS->GPE_MFPH |= (SYS_GPE_MFPH_PE14MFP_UART0_TXD | SYS_GPE_MFPH_PE15MFP_UART0_RXD);
+
+    /* Set PB.0 ~ PB.3 to input mode */
+    PB->MODE &= ~(GPIO_MODE_MODE0_Msk | GPIO_MODE_MODE1_Msk | GPIO_MODE_MODE2_Msk | GPIO_MODE_MODE3_Msk);
+    /* Configure the GPB0 - GPB3 ADC analog input pins.  */
+    SYS->GPB_MFPL &= ~(SYS_GPB_MFPL_PB0MFP_Msk | SYS_GPB_MFPL_PB1MFP_Msk |
+                       SYS_GPB_MFPL_PB2MFP_Msk | SYS_GPB_MFPL_PB3MFP_Msk);
+    SYS->GPB_MFPL |= (SYS_GPB_MFPL_PB0MFP_EADC0_CH0 | SYS_GPB_MFPL_PB1MFP_EADC0_CH1 |
+                      SYS_GPB_MFPL_PB2MFP_EADC0_CH2 | SYS_GPB_MFPL_PB3MFP_EADC0_CH3);
+
+    /* Disable the GPB0 - GPB3 digital input path to avoid the leakage current. */
+    GPIO_DISABLE_DIGITAL_PATH(PB, BIT3|BIT2|BIT1|BIT0);
+}
+
+void UART0_Init()
+{
+    /* Configure UART0 and set UART0 baud rate */
+    UART_Open(UART0, 115200);
+}
+
+void EPWM0_Init()
+{
+    /* One trigger every (prescaler + 1) * (CNR + 1) EPWM clocks, which starts all four sample modules */
+    EPWM_SET_PRESCALER(EPWM0, 0, 9);
+
+    /* Set up counter type */
+    EPWM0->CTL1 &= ~EPWM_CTL1_CNTTYPE0_Msk;
+
+    /* Set EPWM0 timer duty */
+    EPWM_SET_CMR(EPWM0, 0, 500);
+
+    /* Set EPWM0 timer period */
+    EPWM_SET_CNR(EPWM0, 0, 999);
+
+    /* EPWM period point trigger ADC enable */
+    EPWM_EnableADCTrigger(EPWM0, 0, EPWM_TRG_ADC_EVEN_PERIOD);
+}
+
+int32_t main(void)
+{
+    uint8_t u8Option;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Init System, IP clock and multi-function I/O */
+    SYS_Init();
+
+    /* Lock protected registers */
+    SYS_LockReg();
+
+    /* Init UART0 for sysprintf */
+    UART0_Init();
+
+    /* Init EPWM for EADC */
+    EPWM0_Init();
+
+    PMU_Init();
+    Data_Init();
+    dsp_fft_f32_init(&g_sFft, FFT_LEN, g_afFftTw);
+    dsp_fft_q15_init(&g_sFftQ15, FFT_LEN, g_ai16FftTw);
+
+    sysprintf("\n+-----------------------------------------------+\n");
+    sysprintf("|     DSP library check and benchmark sample    |\n");
+    sysprintf("+-----------------------------------------------+\n");
+
+    if (DSP_SelfCheck() != 0)
+        sysprintf("\nSelf check FAILED\n");
+    else
+        sysprintf("\nSelf check passed\n");
+
+    DSP_Benchmark();
+
+    while (1)
+    {
+        sysprintf("\n  [1] Run the benchmark again\n");
+        sysprintf("  [2] Stream EADC0 CH0 - CH3 through the DSP kernels\n");
+        u8Option = sysgetchar();
+
+        if (u8Option == '1')
+            DSP_Benchmark();
+        else if (u8Option == '2')
+            DSP_StreamDemo();
+    }
+}
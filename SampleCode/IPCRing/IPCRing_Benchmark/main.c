@@ -0,0 +1,395 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @brief    Check and benchmark the inter-core ring library between the two
+ *           A35 cores.
+ *
+ *           Core 0 runs main() and core 1 runs main1(); both share the rings,
+ *           which are in cached DDR. Every message carries a sequence number
+ *           that the receiving core checks.
+ *
+ *           Stream: core 0 sends messages to core 1 in batches. Core 1 either
+ *           polls the ring or sleeps in WFI when it is empty, and is then
+ *           woken by an SGI that core 0 sends at most once per batch.
+ *           Ping-pong: one message goes to core 1 and back, the time is taken
+ *           with the generic timer and half the round trip is reported.
+ *           MPSC: both cores send into one ring read by core 0, the producers
+ *           are serialized by the spin lock or by a HWSEM channel.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "NuMicro.h"
+#include "ipc_ring.h"
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Define global variables and constants                                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+#define RING_ENTRIES    256
+#define STREAM_MSGS     (1024 * 1024)
+#define MAX_BATCH       32
+#define PING_ROUNDS     10000
+#define MPSC_MSGS       (256 * 1024)    /* Per producer */
+
+#define DOORBELL_SGI    SGI1_IRQn       /* SGI0 is the yield SGI of the FreeRTOS-SMP port */
+#define HWSEM_CH        0
+
+#define TEST_IDLE       0
+#define TEST_STREAM     1
+#define TEST_PING       2
+#define TEST_MPSC       3
+
+typedef struct
+{
+    uint32_t    u32Seq;
+    uint32_t    u32Src;                 /* Producing core */
+    uint64_t    u64Data;
+} MSG_T;
+
+static RING_T   g_sRing01, g_sRing10;   /* Core 0 to core 1 and back */
+static MSG_T    g_asBuf01[RING_ENTRIES] __attribute__((aligned(64)));
+static MSG_T    g_asBuf10[RING_ENTRIES] __attribute__((aligned(64)));
+
+/* Set by core 0 before it starts a test, cleared by core 1 when done */
+static volatile uint32_t g_u32Test, g_u32Sleep, g_u32Errors1, g_u32Doorbells;
+
+extern void arm64_enable_int(void);
+extern void arm64_disable_int(void);
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Generic timer, counts at the same rate on both cores                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+static inline uint64_t Ticks(void)
+{
+    return EL0_GetCurrentPhysicalValue();
+}
+
+static uint32_t TicksToNs(uint64_t u64Ticks)
+{
+    return (uint32_t)(u64Ticks * 1000000000ULL / raw_read_cntfrq_el0());
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Core 1                                                                                                  */
+/*---------------------------------------------------------------------------------------------------------*/
+static void Doorbell_IRQHandler(void)
+{
+    g_u32Doorbells++;
+}
+
+/* Sleeps until the producer rings, unless the ring got entries meanwhile */
+static void Core1_Wait(RING_T *psRing)
+{
+    /* A pending SGI ends WFI even with interrupts masked, so it is not lost */
+    arm64_disable_int();
+    if (RING_Sleep(psRing))
+        __WFI();
+    arm64_enable_int();
+}
+
+static void Core1_Stream(void)
+{
+    const MSG_T *psMsg;
+    uint32_t u32Expect = 0, u32Count, i;
+
+    while (u32Expect < STREAM_MSGS)
+    {
+        u32Count = MAX_BATCH;
+        psMsg = RING_Peek(&g_sRing01, &u32Count);
+        if (psMsg == NULL)
+        {
+            if (g_u32Sleep)
+                Core1_Wait(&g_sRing01);
+            continue;
+        }
+
+        for (i = 0; i < u32Count; i++)
+        {
+            if (psMsg[i].u32Seq != u32Expect)
+            {
+                g_u32Errors1++;
+                u32Expect = psMsg[i].u32Seq;
+            }
+            u32Expect++;
+        }
+        RING_Release(&g_sRing01, u32Count);
+    }
+}
+
+static void Core1_Ping(void)
+{
+    MSG_T sMsg, *psOut;
+    uint32_t u32Round, u32Count;
+
+    for (u32Round = 0; u32Round < PING_ROUNDS; u32Round++)
+    {
+        while (RING_Read(&g_sRing01, &sMsg, 1) == 0)
+        {
+            if (g_u32Sleep)
+                Core1_Wait(&g_sRing01);
+        }
+
+        /* The reply is built in place; core 0 polls, so no doorbell */
+        do
+        {
+            u32Count = 1;
+            psOut = RING_Reserve(&g_sRing10, &u32Count);
+        } while (psOut == NULL);
+        psOut->u32Seq = sMsg.u32Seq;
+        psOut->u32Src = 1;
+        psOut->u64Data = sMsg.u64Data;
+        RING_Commit(&g_sRing10, 1);
+    }
+}
+
+static void Core1_Mpsc(void)
+{
+    MSG_T sMsg = { 0, 1, 0 };
+
+    while (sMsg.u32Seq < MPSC_MSGS)
+        sMsg.u32Seq += RING_Write(&g_sRing10, &sMsg, 1);
+}
+
+/* main1 function */
+int main1(void)
+{
+    uint32_t u32Test;
+
+    global_timer_init();
+
+    /* SGIs are banked, so core 1 enables its doorbell itself */
+    IRQ_SetHandler((IRQn_ID_t)DOORBELL_SGI, Doorbell_IRQHandler);
+    IRQ_SetPriority((IRQn_ID_t)DOORBELL_SGI, GIC_GetPriority((IRQn_Type)NonSecPhysicalTimer_IRQn));
+    IRQ_Enable((IRQn_ID_t)DOORBELL_SGI);
+
+    while (1)
+    {
+        while ((u32Test = g_u32Test) == TEST_IDLE)
+            ;
+        /* Rings and parameters were set up before the test number */
+        __DMB();
+
+        if (u32Test == TEST_STREAM)
+            Core1_Stream();
+        else if (u32Test == TEST_PING)
+            Core1_Ping();
+        else if (u32Test == TEST_MPSC)
+            Core1_Mpsc();
+
+        __DMB();
+        g_u32Test = TEST_IDLE;
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Core 0                                                                                                  */
+/*---------------------------------------------------------------------------------------------------------*/
+static void Core1_Start(uint32_t u32Test, uint32_t u32Sleep)
+{
+    g_u32Sleep = u32Sleep;
+    g_u32Errors1 = 0;
+    g_u32Doorbells = 0;
+    __DMB();
+    g_u32Test = u32Test;
+}
+
+static void Core1_Join(void)
+{
+    while (g_u32Test != TEST_IDLE)
+        ;
+    __DMB();
+}
+
+static void Doorbell(RING_T *psRing, uint32_t *pu32Sent)
+{
+    if (RING_CheckWake(psRing))
+    {
+        GIC_SendSGI(DOORBELL_SGI, 1U << 1, 0);
+        (*pu32Sent)++;
+    }
+}
+
+static void Test_Stream(uint32_t u32Batch, uint32_t u32Sleep)
+{
+    static MSG_T asMsg[MAX_BATCH];
+    uint32_t u32Seq = 0, u32Count, u32Sent, u32Rung = 0, u32Ns, i;
+    uint64_t u64Ticks;
+
+    RING_Init(&g_sRing01, g_asBuf01, RING_ENTRIES, sizeof(MSG_T), RING_SPSC);
+    memset(asMsg, 0, sizeof(asMsg));
+
+    u64Ticks = Ticks();
+    Core1_Start(TEST_STREAM, u32Sleep);
+
+    while (u32Seq < STREAM_MSGS)
+    {
+        for (i = 0; i < u32Batch; i++)
+            asMsg[i].u32Seq = u32Seq + i;
+
+        /* One publication, and one doorbell at most, per batch */
+        for (u32Sent = 0; u32Sent < u32Batch; u32Sent += u32Count)
+        {
+            u32Count = RING_Write(&g_sRing01, &asMsg[u32Sent], u32Batch - u32Sent);
+            if (u32Count)
+                Doorbell(&g_sRing01, &u32Rung);
+        }
+        u32Seq += u32Batch;
+    }
+
+    Core1_Join();
+    u64Ticks = Ticks() - u64Ticks;
+    /* In 1/100 ns */
+    u32Ns = (uint32_t)(u64Ticks * 100000000000ULL / raw_read_cntfrq_el0() / STREAM_MSGS);
+
+    sysprintf("  batch %2d, %-8s: %9d msg/s, %3d.%02d ns/msg, %6d doorbells sent, %6d taken, %d errors\n",
+              u32Batch, u32Sleep ? "doorbell" : "polling",
+              (uint32_t)((uint64_t)STREAM_MSGS * raw_read_cntfrq_el0() / u64Ticks),
+              u32Ns / 100, u32Ns % 100, u32Rung, g_u32Doorbells, g_u32Errors1);
+}
+
+static void Test_Ping(uint32_t u32Sleep)
+{
+    MSG_T sMsg = { 0, 0, 0 };
+    uint32_t u32Round, u32Rung = 0, u32Errors = 0;
+    uint64_t u64Start, u64Ticks, u64Min = ~0ULL, u64Max = 0, u64Sum = 0;
+
+    RING_Init(&g_sRing01, g_asBuf01, RING_ENTRIES, sizeof(MSG_T), RING_SPSC);
+    RING_Init(&g_sRing10, g_asBuf10, RING_ENTRIES, sizeof(MSG_T), RING_SPSC);
+    Core1_Start(TEST_PING, u32Sleep);
+
+    for (u32Round = 0; u32Round < PING_ROUNDS; u32Round++)
+    {
+        sMsg.u32Seq = u32Round;
+        u64Start = Ticks();
+
+        RING_Write(&g_sRing01, &sMsg, 1);
+        Doorbell(&g_sRing01, &u32Rung);
+        while (RING_Read(&g_sRing10, &sMsg, 1) == 0)
+            ;
+
+        u64Ticks = Ticks() - u64Start;
+        if (sMsg.u32Seq != u32Round)
+            u32Errors++;
+        if (u64Ticks < u64Min)
+            u64Min = u64Ticks;
+        if (u64Ticks > u64Max)
+            u64Max = u64Ticks;
+        u64Sum += u64Ticks;
+    }
+    Core1_Join();
+
+    /* The timer ticks are coarser than a handoff, the average is the figure to look at */
+    sysprintf("  %-8s: one-way min %5d ns, avg %5d ns, max %6d ns, %5d doorbells, %d errors\n",
+              u32Sleep ? "doorbell" : "polling",
+              TicksToNs(u64Min) / 2, TicksToNs(u64Sum) / PING_ROUNDS / 2,
+              TicksToNs(u64Max) / 2, u32Rung, u32Errors);
+}
+
+static void Test_Mpsc(uint32_t u32Flags)
+{
+    const MSG_T *psMsg;
+    MSG_T sMsg = { 0, 0, 0 };
+    uint32_t au32Expect[2] = { 0, 0 }, u32Count, u32Errors = 0, i;
+    uint64_t u64Ticks;
+
+    RING_Init(&g_sRing10, g_asBuf10, RING_ENTRIES, sizeof(MSG_T), u32Flags);
+
+    u64Ticks = Ticks();
+    Core1_Start(TEST_MPSC, 0);
+
+    /* Core 0 is a producer too and drains the ring between its writes */
+    while (au32Expect[0] + au32Expect[1] < 2 * MPSC_MSGS)
+    {
+        if (sMsg.u32Seq < MPSC_MSGS)
+            sMsg.u32Seq += RING_Write(&g_sRing10, &sMsg, 1);
+
+        u32Count = MAX_BATCH;
+        psMsg = RING_Peek(&g_sRing10, &u32Count);
+        for (i = 0; i < u32Count; i++)
+        {
+            if ((psMsg[i].u32Src > 1) || (psMsg[i].u32Seq != au32Expect[psMsg[i].u32Src]))
+            {
+                u32Errors++;
+                if (psMsg[i].u32Src > 1)
+                    continue;
+                au32Expect[psMsg[i].u32Src] = psMsg[i].u32Seq;
+            }
+            au32Expect[psMsg[i].u32Src]++;
+        }
+        RING_Release(&g_sRing10, u32Count);
+    }
+
+    Core1_Join();
+    u64Ticks = Ticks() - u64Ticks;
+
+    sysprintf("  %-9s: %9d msg/s, %d errors\n",
+              (u32Flags == RING_MPSC) ? "spin lock" : "HWSEM",
+              (uint32_t)((uint64_t)2 * MPSC_MSGS * raw_read_cntfrq_el0() / u64Ticks), u32Errors);
+}
+
+void SYS_Init(void)
+{
+    /* Enable UART module clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+
+    /* Select UART module clock source as SYSCLK1 and UART module clock divider as 15 */
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL2_UART0SEL_SYSCLK1_DIV2, CLK_CLKDIV1_UART0(15));
+
+    /* Enable HWSEM clock */
+    CLK_EnableModuleClock(HWS_MODULE);
+
+    /* Set GPE multi-function pins for UART0 RXD and TXD */
+    SYS->GPE_MFPH &= ~(SYS_GPE_MFPH_PE14MFP_Msk | SYS_GPE_MFPH_PE15MFP_Msk);
+    SYS->GPE_MFPH |= (SYS_GPE_MFPH_PE14MFP_UART0_TXD | SYS_GPE_MFPH_PE15MFP_UART0_RXD);
+
+    /* Reset HWSEM */
+    SYS->IPRST0 = SYS_IPRST0_HWSEMRST_Msk;
+    SYS->IPRST0 = 0;
+}
+
+void UART0_Init()
+{
+    /* Configure UART0 and set UART0 baud rate */
+    UART_Open(UART0, 115200);
+}
+
+/* main function */
+int main(void)
+{
+    uint32_t au32Batch[] = { 1, 8, MAX_BATCH }, i;
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Init System, IP clock and multi-function I/O */
+    SYS_Init();
+
+    /* Lock protected registers */
+    SYS_LockReg();
+
+    /* Init UART0 for sysprintf */
+    UART0_Init();
+
+    global_timer_init();
+
+    sysprintf("\nInter-core ring benchmark, %d-byte entries, %d-entry rings, timer %d Hz\n",
+              (uint32_t)sizeof(MSG_T), RING_ENTRIES, (uint32_t)raw_read_cntfrq_el0());
+
+    sysprintf("\nStream core 0 -> core 1, %d messages:\n", STREAM_MSGS);
+    for (i = 0; i < sizeof(au32Batch) / sizeof(au32Batch[0]); i++)
+        Test_Stream(au32Batch[i], 0);
+    for (i = 0; i < sizeof(au32Batch) / sizeof(au32Batch[0]); i++)
+        Test_Stream(au32Batch[i], 1);
+
+    sysprintf("\nPing-pong core 0 -> core 1 -> core 0, %d rounds:\n", PING_ROUNDS);
+    Test_Ping(0);
+    Test_Ping(1);
+
+    sysprintf("\nMPSC core 0 + core 1 -> core 0, 2 x %d messages:\n", MPSC_MSGS);
+    Test_Mpsc(RING_MPSC);
+    Test_Mpsc(RING_MPSC_HWSEM(HWSEM_CH));
+
+    sysprintf("\nDone\n");
+
+    while (1) {};
+}
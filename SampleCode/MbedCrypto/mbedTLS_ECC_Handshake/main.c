@@ -0,0 +1,218 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @brief    Measure the public key cost of an ECDHE-ECDSA TLS handshake
+ *           with mbedTLS and report handshakes per second.
+ *
+ *           One handshake is counted as the ECC work done by both peers:
+ *             - server: ephemeral ECDH key, ECDSA signature of its key share,
+ *                       shared secret
+ *             - client: ECDSA verification, ephemeral ECDH key,
+ *                       shared secret
+ *           Build the library with and without the ECDSA/ECDH ALT switches
+ *           in mbedtls_config.h to compare TSI and software.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "NuMicro.h"
+#include "tsi_cmd.h"
+#include "common.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/sha256.h"
+
+#define BENCH_ROUNDS    20
+
+typedef struct
+{
+	const char            *name;
+	mbedtls_ecp_group_id  kex;      /* ECDHE group */
+	mbedtls_ecp_group_id  sig;      /* server certificate curve */
+} BENCH_SUITE_T;
+
+static const BENCH_SUITE_T  _suites[] =
+{
+	{ "ECDHE P-256 / ECDSA P-256", MBEDTLS_ECP_DP_SECP256R1, MBEDTLS_ECP_DP_SECP256R1 },
+	{ "ECDHE P-384 / ECDSA P-384", MBEDTLS_ECP_DP_SECP384R1, MBEDTLS_ECP_DP_SECP384R1 },
+	{ "ECDHE BP256 / ECDSA BP256", MBEDTLS_ECP_DP_BP256R1,   MBEDTLS_ECP_DP_BP256R1   },
+#ifdef MBEDTLS_ECP_DP_CURVE25519_ENABLED
+	{ "ECDHE X25519 / ECDSA P-256", MBEDTLS_ECP_DP_CURVE25519, MBEDTLS_ECP_DP_SECP256R1 },
+#endif
+};
+
+static uint32_t  _rnd_state = 0x2545F491;
+
+/*
+ * xorshift32 random source for benchmarking only. It is NOT suitable for
+ * real key generation.
+ */
+static int bench_rng(void *p_rng, unsigned char *output, size_t len)
+{
+	uint32_t  x = _rnd_state;
+
+	(void)p_rng;
+	while (len--)
+	{
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		*output++ = (unsigned char)x;
+	}
+	_rnd_state = x;
+	return 0;
+}
+
+static uint64_t get_time_us(void)
+{
+	return EL0_GetCurrentPhysicalValue() / 12;
+}
+
+void SYS_Init(void)
+{
+	/* Enable UART module clock */
+	CLK_EnableModuleClock(UART0_MODULE);
+
+	/* Select UART module clock source as SYSCLK1 and UART module clock divider as 15 */
+	CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL2_UART0SEL_SYSCLK1_DIV2, CLK_CLKDIV1_UART0(15));
+
+	/* enable Wormhole 1 clock */
+	CLK_EnableModuleClock(WH1_MODULE);
+
+	/* Set GPE multi-function pins for UART0 RXD and TXD */
+	SYS->GPE_MFPH &= ~(SYS_GPE_MFPH_PE14MFP_Msk | SYS_GPE_MFPH_PE15MFP_Msk);
+	SYS->GPE_MFPH |= (SYS_GPE_MFPH_PE14MFP_UART0_TXD | SYS_GPE_MFPH_PE15MFP_UART0_RXD);
+}
+
+static int bench_suite(const BENCH_SUITE_T *suite)
+{
+	mbedtls_ecp_group  kex_grp, sig_grp;
+	mbedtls_mpi        cert_d, srv_d, cli_d, srv_z, cli_z, r, s;
+	mbedtls_ecp_point  cert_Q, srv_Q, cli_Q;
+	unsigned char      share[MBEDTLS_ECP_MAX_PT_LEN], hash[32];
+	size_t             share_len;
+	uint64_t           t0, t_start;
+	uint64_t           t_keygen = 0, t_sign = 0, t_verify = 0, t_shared = 0, t_total;
+	int                i, ret;
+
+	mbedtls_ecp_group_init(&kex_grp);
+	mbedtls_ecp_group_init(&sig_grp);
+	mbedtls_mpi_init(&cert_d); mbedtls_mpi_init(&srv_d); mbedtls_mpi_init(&cli_d);
+	mbedtls_mpi_init(&srv_z);  mbedtls_mpi_init(&cli_z);
+	mbedtls_mpi_init(&r);      mbedtls_mpi_init(&s);
+	mbedtls_ecp_point_init(&cert_Q);
+	mbedtls_ecp_point_init(&srv_Q);
+	mbedtls_ecp_point_init(&cli_Q);
+
+	MBEDTLS_MPI_CHK(mbedtls_ecp_group_load(&kex_grp, suite->kex));
+	MBEDTLS_MPI_CHK(mbedtls_ecp_group_load(&sig_grp, suite->sig));
+
+	/* Server certificate key, not part of the timed handshake */
+	MBEDTLS_MPI_CHK(mbedtls_ecp_gen_keypair(&sig_grp, &cert_d, &cert_Q, bench_rng, NULL));
+
+	t_start = get_time_us();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+	{
+		/* Server: ephemeral key share, signed with the certificate key */
+		t0 = get_time_us();
+		MBEDTLS_MPI_CHK(mbedtls_ecdh_gen_public(&kex_grp, &srv_d, &srv_Q, bench_rng, NULL));
+		t_keygen += get_time_us() - t0;
+
+		MBEDTLS_MPI_CHK(mbedtls_ecp_point_write_binary(&kex_grp, &srv_Q, MBEDTLS_ECP_PF_UNCOMPRESSED,
+													   &share_len, share, sizeof(share)));
+		MBEDTLS_MPI_CHK(mbedtls_sha256(share, share_len, hash, 0));
+
+		t0 = get_time_us();
+		MBEDTLS_MPI_CHK(mbedtls_ecdsa_sign(&sig_grp, &r, &s, &cert_d, hash, sizeof(hash), bench_rng, NULL));
+		t_sign += get_time_us() - t0;
+
+		/* Client: check the signature, answer with its own key share */
+		t0 = get_time_us();
+		MBEDTLS_MPI_CHK(mbedtls_ecdsa_verify(&sig_grp, hash, sizeof(hash), &cert_Q, &r, &s));
+		t_verify += get_time_us() - t0;
+
+		t0 = get_time_us();
+		MBEDTLS_MPI_CHK(mbedtls_ecdh_gen_public(&kex_grp, &cli_d, &cli_Q, bench_rng, NULL));
+		t_keygen += get_time_us() - t0;
+
+		/* Both sides derive the premaster secret */
+		t0 = get_time_us();
+		MBEDTLS_MPI_CHK(mbedtls_ecdh_compute_shared(&kex_grp, &cli_z, &srv_Q, &cli_d, bench_rng, NULL));
+		MBEDTLS_MPI_CHK(mbedtls_ecdh_compute_shared(&kex_grp, &srv_z, &cli_Q, &srv_d, bench_rng, NULL));
+		t_shared += get_time_us() - t0;
+
+		if (mbedtls_mpi_cmp_mpi(&cli_z, &srv_z) != 0)
+		{
+			sysprintf("Shared secret mismatch at round %d!\n", i);
+			ret = -1;
+			goto cleanup;
+		}
+	}
+	t_total = get_time_us() - t_start;
+
+	sysprintf("%-28s %6d %6d %6d %6d   %4d.%02d\n", suite->name,
+			  (uint32_t)(t_keygen / (2 * BENCH_ROUNDS)),
+			  (uint32_t)(t_sign / BENCH_ROUNDS),
+			  (uint32_t)(t_verify / BENCH_ROUNDS),
+			  (uint32_t)(t_shared / (2 * BENCH_ROUNDS)),
+			  (uint32_t)(BENCH_ROUNDS * 1000000ULL / t_total),
+			  (uint32_t)((BENCH_ROUNDS * 100000000ULL / t_total) % 100));
+	ret = 0;
+
+cleanup:
+	if (ret != 0)
+		sysprintf("%-28s failed! (-0x%x)\n", suite->name, -ret);
+
+	mbedtls_ecp_group_free(&kex_grp);
+	mbedtls_ecp_group_free(&sig_grp);
+	mbedtls_mpi_free(&cert_d); mbedtls_mpi_free(&srv_d); mbedtls_mpi_free(&cli_d);
+	mbedtls_mpi_free(&srv_z);  mbedtls_mpi_free(&cli_z);
+	mbedtls_mpi_free(&r);      mbedtls_mpi_free(&s);
+	mbedtls_ecp_point_free(&cert_Q);
+	mbedtls_ecp_point_free(&srv_Q);
+	mbedtls_ecp_point_free(&cli_Q);
+	return ret;
+}
+
+int32_t main(void)
+{
+	int  i;
+
+	/* Unlock protected registers */
+	SYS_UnlockReg();
+
+	/* Init System, IP clock and multi-function I/O */
+	SYS_Init();
+
+	/* Init UART0 for sysprintf */
+	UART_Open(UART0, 115200);
+
+	if (TSI_Init() != 0)
+	{
+		sysprintf("TSI Init failed!\n");
+		while (1);
+	}
+
+	sysprintf("MBEDTLS ECDHE-ECDSA handshake benchmark, %d rounds per suite\n", BENCH_ROUNDS);
+
+#if defined(MBEDTLS_ECDSA_SIGN_ALT) || defined(MBEDTLS_ECDH_COMPUTE_SHARED_ALT)
+	sysprintf("Hardware Accellerator Enabled.\n");
+#else
+	sysprintf("Pure software crypto running.\n");
+#endif
+
+	_rnd_state ^= (uint32_t)EL0_GetCurrentPhysicalValue();
+
+	sysprintf("\n%-28s %6s %6s %6s %6s   %s\n", "suite", "keygen", "sign", "verify", "shared", "handshake/s");
+	sysprintf("%-28s %6s %6s %6s %6s\n", "", "(us)", "(us)", "(us)", "(us)");
+	for (i = 0; i < sizeof(_suites) / sizeof(_suites[0]); i++)
+		bench_suite(&_suites[i]);
+
+	sysprintf("Test Done!\n");
+	while(1);
+}
+
+int mbedtls_platform_entropy_poll( void *data, unsigned char *output, size_t len, size_t *olen )
+{
+	return 0;
+}
@@ -0,0 +1,189 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @brief    Compare TSI and software hashing throughput across message
+ *           sizes with mbedTLS.
+ *
+ *           SHA-1, SHA-384 and SHA-512 are run twice through the same ALT
+ *           functions, once forced to software and once forced to the TSI
+ *           by nu_sha_set_hw_min(). The last column shows the faster one;
+ *           the smallest size won by the TSI is a good NU_SHA_HW_MIN.
+ *           HMAC-SHA256 compares mbedtls_md_hmac() with nu_hmac(), and
+ *           SHA3-256 and SM3 are TSI only.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "NuMicro.h"
+#include "tsi_cmd.h"
+#include "common.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/sha512.h"
+#include "mbedtls/md.h"
+#include "hash_alt.h"
+
+/* Bytes hashed per measurement, at least BENCH_MIN_ROUNDS messages */
+#define BENCH_BYTES         (256 * 1024)
+#define BENCH_MIN_ROUNDS    4
+#define BENCH_MAX_MSG       (64 * 1024)
+
+enum
+{
+	BENCH_SHA1 = 0,
+	BENCH_SHA384,
+	BENCH_SHA512,
+	BENCH_HMAC_SHA256,
+	BENCH_SHA3_256,
+	BENCH_SM3,
+};
+
+static const char *_bench_name[] =
+{
+	"SHA-1", "SHA-384", "SHA-512", "HMAC-SHA256", "SHA3-256", "SM3"
+};
+
+static const uint32_t  _sizes[] = { 16, 64, 256, 1024, 4096, 16384, 65536 };
+
+static uint8_t  _msg[BENCH_MAX_MSG];
+static uint8_t  _key[32];
+
+static uint64_t get_time_us(void)
+{
+	return EL0_GetCurrentPhysicalValue() / 12;
+}
+
+void SYS_Init(void)
+{
+	/* Enable UART module clock */
+	CLK_EnableModuleClock(UART0_MODULE);
+
+	/* Select UART module clock source as SYSCLK1 and UART module clock divider as 15 */
+	CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL2_UART0SEL_SYSCLK1_DIV2, CLK_CLKDIV1_UART0(15));
+
+	/* enable Wormhole 1 clock */
+	CLK_EnableModuleClock(WH1_MODULE);
+
+	/* Set GPE multi-function pins for UART0 RXD and TXD */
+	SYS->GPE_MFPH &= ~(SYS_GPE_MFPH_PE14MFP_Msk | SYS_GPE_MFPH_PE15MFP_Msk);
+	SYS->GPE_MFPH |= (SYS_GPE_MFPH_PE14MFP_UART0_TXD | SYS_GPE_MFPH_PE15MFP_UART0_RXD);
+}
+
+/*
+ * Hash one message. hw selects the TSI path where there is a choice.
+ */
+static int bench_one(int algo, int hw, uint32_t len, uint8_t *out)
+{
+	const mbedtls_md_info_t  *md_info;
+
+	switch (algo)
+	{
+	case BENCH_SHA1:
+		return mbedtls_sha1(_msg, len, out);
+	case BENCH_SHA384:
+		return mbedtls_sha512(_msg, len, out, 1);
+	case BENCH_SHA512:
+		return mbedtls_sha512(_msg, len, out, 0);
+	case BENCH_HMAC_SHA256:
+		if (hw)
+			return nu_hmac(MBEDTLS_MD_SHA256, _key, sizeof(_key), _msg, len, out);
+		md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+		return mbedtls_md_hmac(md_info, _key, sizeof(_key), _msg, len, out);
+	case BENCH_SHA3_256:
+		return nu_hash(NU_HASH_SHA3_256, _msg, len, out);
+	default:
+		return nu_hash(NU_HASH_SM3, _msg, len, out);
+	}
+}
+
+/*
+ * Throughput in KB/s, or 0 on error
+ */
+static uint32_t bench_rate(int algo, int hw, uint32_t len)
+{
+	uint8_t   out[64];
+	uint32_t  rounds, i;
+	uint64_t  t0, us;
+
+	nu_sha_set_hw_min(hw ? 0 : (size_t)-1);
+	nu_sha256_set_hw_min(hw ? 0 : (size_t)-1);
+
+	rounds = BENCH_BYTES / len;
+	if (rounds < BENCH_MIN_ROUNDS)
+		rounds = BENCH_MIN_ROUNDS;
+
+	t0 = get_time_us();
+	for (i = 0; i < rounds; i++)
+	{
+		if (bench_one(algo, hw, len, out) != 0)
+			return 0;
+	}
+	us = get_time_us() - t0;
+	if (us == 0)
+		us = 1;
+	return (uint32_t)((uint64_t)rounds * len * 1000000ULL / 1024 / us);
+}
+
+static void bench_algo(int algo)
+{
+	uint32_t  sw, hw;
+	int       i, has_sw;
+
+	has_sw = (algo <= BENCH_HMAC_SHA256);
+
+	for (i = 0; i < sizeof(_sizes) / sizeof(_sizes[0]); i++)
+	{
+		hw = bench_rate(algo, 1, _sizes[i]);
+		sw = has_sw ? bench_rate(algo, 0, _sizes[i]) : 0;
+
+		if (has_sw)
+			sysprintf("%-12s %6d %10d %10d   %s\n", _bench_name[algo], _sizes[i], sw, hw,
+					  (hw > sw) ? "TSI" : "software");
+		else
+			sysprintf("%-12s %6d %10s %10d\n", _bench_name[algo], _sizes[i], "-", hw);
+	}
+}
+
+int32_t main(void)
+{
+	int  i;
+
+	/* Unlock protected registers */
+	SYS_UnlockReg();
+
+	/* Init System, IP clock and multi-function I/O */
+	SYS_Init();
+
+	/* Init UART0 for sysprintf */
+	UART_Open(UART0, 115200);
+
+	if (TSI_Init() != 0)
+	{
+		sysprintf("TSI Init failed!\n");
+		while (1);
+	}
+
+	for (i = 0; i < sizeof(_msg); i++)
+		_msg[i] = (uint8_t)(i * 7 + 1);
+	for (i = 0; i < sizeof(_key); i++)
+		_key[i] = (uint8_t)(0xA5 ^ i);
+
+	sysprintf("MBEDTLS hash throughput, KB/s\n");
+#if !defined(MBEDTLS_SHA1_ALT) || !defined(MBEDTLS_SHA512_ALT)
+	sysprintf("Build the library with MBEDTLS_SHA1_ALT and MBEDTLS_SHA512_ALT!\n");
+	while (1);
+#endif
+
+	sysprintf("\n%-12s %6s %10s %10s   %s\n", "hash", "bytes", "software", "TSI", "faster");
+	for (i = BENCH_SHA1; i <= BENCH_SM3; i++)
+		bench_algo(i);
+
+	nu_sha_set_hw_min(NU_SHA_HW_MIN);
+	nu_sha256_set_hw_min(NU_SHA256_HW_MIN);
+	sysprintf("Test Done!\n");
+	while(1);
+}
+
+int mbedtls_platform_entropy_poll( void *data, unsigned char *output, size_t len, size_t *olen )
+{
+	return 0;
+}
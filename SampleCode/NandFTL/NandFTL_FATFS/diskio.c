@@ -0,0 +1,135 @@
+/*-----------------------------------------------------------------------*/
+/* Low level disk I/O module skeleton for FatFs     (C)ChaN, 2013        */
+/*-----------------------------------------------------------------------*/
+/* If a working storage control module is available, it should be        */
+/* attached to the FatFs via a glue function rather than modifying it.   */
+/* This is an example of glue functions to attach various exsisting      */
+/* storage control module to the FatFs module with a defined API.        */
+/*-----------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "nand_ftl.h"
+#include "diskio.h"     /* FatFs lower layer API */
+#include "ff.h"
+
+#define FTL_DRIVE       0        /* SPI-NAND through the FTL */
+
+static FTL_T *s_psFtl;
+
+/* Called by the application once the FTL is mounted */
+void disk_ftl_attach(FTL_T *psFtl)
+{
+    s_psFtl = psFtl;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Initialize a Drive                                                    */
+/*-----------------------------------------------------------------------*/
+
+DSTATUS disk_initialize (BYTE pdrv)       /* Physical drive number (0..) */
+{
+    if ((pdrv != FTL_DRIVE) || (s_psFtl == NULL))
+        return STA_NOINIT;
+
+    return RES_OK;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Get Disk Status                                                       */
+/*-----------------------------------------------------------------------*/
+
+DSTATUS disk_status (BYTE pdrv)       /* Physical drive number (0..) */
+{
+    if ((pdrv != FTL_DRIVE) || (s_psFtl == NULL))
+        return STA_NOINIT;
+
+    return RES_OK;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Read Sector(s)                                                        */
+/*-----------------------------------------------------------------------*/
+
+DRESULT disk_read (
+    BYTE pdrv,      /* Physical drive number (0..) */
+    BYTE *buff,     /* Data buffer to store read data */
+    DWORD sector,   /* Sector address (LBA) */
+    UINT count      /* Number of sectors to read (1..128) */
+)
+{
+    if ((pdrv != FTL_DRIVE) || (s_psFtl == NULL))
+        return RES_NOTRDY;
+
+    /* The FTL copies through its own buffers, so any alignment will do */
+    return (FTL_Read(s_psFtl, sector, count, buff) == FTL_OK) ? RES_OK : RES_ERROR;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Write Sector(s)                                                       */
+/*-----------------------------------------------------------------------*/
+
+DRESULT disk_write (
+    BYTE pdrv,          /* Physical drive number (0..) */
+    const BYTE *buff,   /* Data to be written */
+    DWORD sector,       /* Sector address (LBA) */
+    UINT count          /* Number of sectors to write (1..128) */
+)
+{
+    if ((pdrv != FTL_DRIVE) || (s_psFtl == NULL))
+        return RES_NOTRDY;
+
+    return (FTL_Write(s_psFtl, sector, count, buff) == FTL_OK) ? RES_OK : RES_ERROR;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Miscellaneous Functions                                               */
+/*-----------------------------------------------------------------------*/
+
+DRESULT disk_ioctl (
+    BYTE pdrv,      /* Physical drive number (0..) */
+    BYTE cmd,       /* Control code */
+    void *buff      /* Buffer to send/receive control data */
+)
+{
+    DRESULT res = RES_OK;
+
+    if ((pdrv != FTL_DRIVE) || (s_psFtl == NULL))
+        return RES_NOTRDY;
+
+    switch(cmd)
+    {
+    case CTRL_SYNC:
+        /* Programs the partly filled page so that the data survives a power cut */
+        if (FTL_Sync(s_psFtl) != FTL_OK)
+            res = RES_ERROR;
+        break;
+    case GET_SECTOR_COUNT:
+        *(DWORD*)buff = FTL_GetSectorCount(s_psFtl);
+        break;
+    case GET_SECTOR_SIZE:
+        *(WORD*)buff = FTL_SECTOR_SIZE;
+        break;
+    case GET_BLOCK_SIZE:
+        /* f_mkfs() aligns the data area to the erase block */
+        *(DWORD*)buff = FTL_GetEraseSectors(s_psFtl);
+        break;
+#if FF_USE_TRIM
+    case CTRL_TRIM:
+        /* Inclusive range of freed sectors */
+        if (FTL_Trim(s_psFtl, ((DWORD*)buff)[0], ((DWORD*)buff)[1] - ((DWORD*)buff)[0] + 1) != FTL_OK)
+            res = RES_ERROR;
+        break;
+#endif
+    default:
+        res = RES_PARERR;
+        break;
+    }
+    return res;
+}
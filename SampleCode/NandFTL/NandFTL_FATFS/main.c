@@ -0,0 +1,449 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @brief    FAT file system on SPI-NAND through the NAND FTL.
+ *
+ *           The SPI-NAND on QSPI0 is opened with the serial flash service
+ *           and a partition of it is mounted with the FTL, which FatFs then
+ *           uses as drive 0 through diskio.c. The sample formats the volume
+ *           if needed, times writing and reading back a file and prints the
+ *           FTL counters, including the write amplification.
+ *
+ *           With POWER_CUT_TEST set to 1 the FTL is first run on the RAM
+ *           NAND simulator, cutting the power at a different point of each
+ *           round and checking after the remount that every synced sector
+ *           reads back.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "NuMicro.h"
+#include "sflash_svc.h"
+#include "nand_ftl.h"
+#include "diskio.h"
+#include "ff.h"
+
+/*---------------------------------------------------------------------------------------------------------*/
+/* Define global variables and constants                                                                   */
+/*---------------------------------------------------------------------------------------------------------*/
+#define FTL_FIRST_BLOCK     0           /* Partition of the SPI-NAND used by the FTL */
+#define FTL_BLOCKS          1024
+#define FTL_WORK_SIZE       (4 * 1024 * 1024)
+
+#define TEST_FILE           "0:\\ftl_test.bin"
+#define TEST_FILE_SIZE      (4 * 1024 * 1024)
+#define TEST_CHUNK          (32 * 1024)
+
+#define POWER_CUT_TEST      1
+#define SIM_PAGE_SIZE       2048
+#define SIM_PAGES_PER_BLOCK 64
+#define SIM_BLOCKS          32
+#define SIM_ROUNDS          50
+#define SIM_WORK_SIZE       (256 * 1024)
+
+extern void disk_ftl_attach(FTL_T *psFtl);
+
+static SFLASH_SVC_T s_sSvc;
+static FTL_PORT_T s_sPort;
+static FTL_T s_sFtl;
+static FATFS s_sFatFs;
+static FIL s_sFile;
+
+static uint64_t s_au64Work[FTL_WORK_SIZE / 8];
+static uint8_t s_au8Buf[TEST_CHUNK] __attribute__((aligned(64)));
+static uint8_t s_au8MkfsWork[FF_MAX_SS * 8] __attribute__((aligned(4)));
+
+#if POWER_CUT_TEST
+static uint8_t s_au8SimMem[SIM_BLOCKS * SIM_PAGES_PER_BLOCK * SIM_PAGE_SIZE];
+static uint8_t s_au8SimBad[SIM_BLOCKS];
+static uint64_t s_au64SimWork[SIM_WORK_SIZE / 8];
+static uint32_t s_au32Synced[SIM_BLOCKS * SIM_PAGES_PER_BLOCK * (SIM_PAGE_SIZE / FTL_SECTOR_SIZE)];
+static uint32_t s_au32Written[SIM_BLOCKS * SIM_PAGES_PER_BLOCK * (SIM_PAGE_SIZE / FTL_SECTOR_SIZE)];
+#endif
+
+unsigned long get_fattime(void)
+{
+    return 0x00000;
+}
+
+void PDMA0_IRQHandler(void)
+{
+    SFLASHSVC_PDMA_IRQHandler(&s_sSvc);
+}
+
+static uint32_t Elapsed_us(uint64_t u64Start)
+{
+    return (uint32_t)((EL0_GetCurrentPhysicalValue() - u64Start) * 1000000ULL / raw_read_cntfrq_el0());
+}
+
+void UART0_Init()
+{
+    /* Enable UART0 clock */
+    CLK_EnableModuleClock(UART0_MODULE);
+    CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL2_UART0SEL_HXT, CLK_CLKDIV1_UART0(1));
+
+    /* Set multi-function pins */
+    SYS->GPE_MFPH &= ~(SYS_GPE_MFPH_PE14MFP_Msk | SYS_GPE_MFPH_PE15MFP_Msk);
+    SYS->GPE_MFPH |= (SYS_GPE_MFPH_PE14MFP_UART0_TXD | SYS_GPE_MFPH_PE15MFP_UART0_RXD);
+
+    /* Init UART to 115200-8n1 for print message */
+    UART_Open(UART0, 115200);
+}
+
+void SYS_Init(void)
+{
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* System Clock Initial                                                                                    */
+    /*---------------------------------------------------------------------------------------------------------*/
+
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Set APLL to 200 MHz */
+    CLK_SetPLLClockFreq(APLL, PLL_OPMODE_INTEGER, FREQ_PLLSRC, 200000000);
+
+    /* Enable IP clock */
+    CLK_SetModuleClock(SYSCK1_MODULE, CLK_CLKSEL0_SYSCK1SEL_SYSPLL, MODULE_NoMsk);
+    CLK_SetModuleClock(QSPI0_MODULE, CLK_CLKSEL4_QSPI0SEL_APLL, MODULE_NoMsk);
+    CLK_EnableModuleClock(QSPI0_MODULE);
+    CLK_EnableModuleClock(GPD_MODULE);
+    CLK_EnableModuleClock(PDMA0_MODULE);
+    SYS_ResetModule(PDMA0_RST);
+
+    /*---------------------------------------------------------------------------------------------------------*/
+    /* I/O Multi-function Initial                                                                              */
+    /*---------------------------------------------------------------------------------------------------------*/
+    SYS->GPD_MFPL &= ~(SYS_GPD_MFPL_PD0MFP_Msk | SYS_GPD_MFPL_PD1MFP_Msk | SYS_GPD_MFPL_PD2MFP_Msk | SYS_GPD_MFPL_PD3MFP_Msk
+                       | SYS_GPD_MFPL_PD4MFP_Msk | SYS_GPD_MFPL_PD5MFP_Msk);
+    SYS->GPD_MFPL |= SYS_GPD_MFPL_PD0MFP_QSPI0_SS0 | SYS_GPD_MFPL_PD1MFP_QSPI0_CLK | SYS_GPD_MFPL_PD2MFP_QSPI0_MOSI0 | SYS_GPD_MFPL_PD3MFP_QSPI0_MISO0
+                     | SYS_GPD_MFPL_PD4MFP_QSPI0_MOSI1 | SYS_GPD_MFPL_PD5MFP_QSPI0_MISO1;
+
+    /* Set GPIO driver strength */
+    PD->DSL = 0x333333;
+
+    /* Lock protected registers */
+    SYS_LockReg();
+}
+
+static void PrintStat(FTL_T *psFtl)
+{
+    FTL_STAT_T sStat;
+    uint32_t u32Wa;
+
+    FTL_GetStat(psFtl, &sStat);
+    u32Wa = sStat.u32HostWrites ? (uint32_t)((uint64_t)sStat.u32PagesProgrammed * sStat.u32SectorsPerPage * 100U /
+                                             sStat.u32HostWrites) : 0U;
+
+    sysprintf("  Sectors %d, %d per page\n", sStat.u32Sectors, sStat.u32SectorsPerPage);
+    sysprintf("  Host writes %d, reads %d, trimmed %d\n", sStat.u32HostWrites, sStat.u32HostReads, sStat.u32Trimmed);
+    sysprintf("  Pages programmed %d: data %d, meta %d, header %d, checkpoint %d\n", sStat.u32PagesProgrammed,
+              sStat.u32DataPages, sStat.u32MetaPages, sStat.u32HeaderPages, sStat.u32CkptPages);
+    sysprintf("  GC: %d blocks, %d sectors moved, %d wear moves, %d checkpoints\n", sStat.u32GcBlocks,
+              sStat.u32GcSectors, sStat.u32WearMoves, sStat.u32Checkpoints);
+    sysprintf("  Erases %d, erase count %d..%d, free blocks %d, bad blocks %d\n", sStat.u32Erases,
+              sStat.u32MinErase, sStat.u32MaxErase, sStat.u32FreeBlocks, sStat.u32BadBlocks);
+    sysprintf("  Write amplification %d.%02d\n", u32Wa / 100U, u32Wa % 100U);
+}
+
+#if POWER_CUT_TEST
+static void SimFill(uint8_t *pu8Buf, uint32_t u32Sector, uint32_t u32Gen)
+{
+    uint32_t *pu32Buf = (uint32_t *)pu8Buf;
+    uint32_t i;
+
+    for (i = 0; i < FTL_SECTOR_SIZE / 4; i += 2)
+    {
+        pu32Buf[i] = u32Sector;
+        pu32Buf[i + 1] = u32Gen;
+    }
+}
+
+/* Mounts the simulator, formatting it the first time */
+static int32_t SimMount(FTL_SIM_T *psSim, FTL_CFG_T *psCfg)
+{
+    int32_t i32Ret;
+
+    FTL_SimPort(&s_sPort, psSim);
+    i32Ret = FTL_Mount(&s_sFtl, psCfg);
+    if (i32Ret == FTL_ERR_FORMAT)
+    {
+        i32Ret = FTL_Format(&s_sFtl, psCfg);
+        if (i32Ret == FTL_OK)
+            i32Ret = FTL_Mount(&s_sFtl, psCfg);
+    }
+    return i32Ret;
+}
+
+/*
+ *  Every round writes random sectors with a new generation number and syncs
+ *  from time to time, with the power cut after a random number of program
+ *  and erase operations. After the remount each sector must hold its last
+ *  synced generation or the one written after it.
+ */
+static int32_t PowerCutTest(void)
+{
+    FTL_SIM_T sSim;
+    FTL_CFG_T sCfg;
+    uint32_t u32Round, u32Sectors, u32Sector, u32Rand = 1U, i;
+    uint32_t u32Gen = 0U, u32Got;
+    int32_t i32Ret;
+
+    memset(s_au8SimMem, 0xFF, sizeof(s_au8SimMem));
+    memset(s_au8SimBad, 0, sizeof(s_au8SimBad));
+    memset(s_au32Synced, 0, sizeof(s_au32Synced));
+    memset(s_au32Written, 0, sizeof(s_au32Written));
+    memset(&sSim, 0, sizeof(sSim));
+    sSim.pu8Mem = s_au8SimMem;
+    sSim.pu8Bad = s_au8SimBad;
+    sSim.u32PageSize = SIM_PAGE_SIZE;
+    sSim.u32PagesPerBlock = SIM_PAGES_PER_BLOCK;
+    sSim.u32Blocks = SIM_BLOCKS;
+    sSim.u32Seed = 1U;
+
+    memset(&sCfg, 0, sizeof(sCfg));
+    sCfg.psPort = &s_sPort;
+    sCfg.pvWork = s_au64SimWork;
+    sCfg.u32WorkSize = sizeof(s_au64SimWork);
+
+    FTL_SimPort(&s_sPort, &sSim);
+    if (FTL_GetWorkSize(&s_sPort, 0U) > sizeof(s_au64SimWork))
+        return FTL_ERR_WORK;
+
+    for (u32Round = 0; u32Round < SIM_ROUNDS; u32Round++)
+    {
+        i32Ret = SimMount(&sSim, &sCfg);
+        if (i32Ret != FTL_OK)
+        {
+            sysprintf("Round %d: mount failed %d\n", u32Round, i32Ret);
+            return i32Ret;
+        }
+        u32Sectors = FTL_GetSectorCount(&s_sFtl);
+
+        /* Check the survivors of the last cut */
+        for (i = 0; i < u32Sectors; i++)
+        {
+            if (s_au32Written[i] == 0U)
+                continue;
+            if (FTL_Read(&s_sFtl, i, 1U, s_au8Buf) != FTL_OK)
+                return FTL_ERR_IO;
+            u32Got = ((uint32_t *)s_au8Buf)[1];
+            SimFill(s_au8Buf + FTL_SECTOR_SIZE, i, u32Got);
+            if (memcmp(s_au8Buf, s_au8Buf + FTL_SECTOR_SIZE, FTL_SECTOR_SIZE) != 0)
+            {
+                /* Never written sectors read as 0xFF */
+                memset(s_au8Buf + FTL_SECTOR_SIZE, 0xFF, FTL_SECTOR_SIZE);
+                if (memcmp(s_au8Buf, s_au8Buf + FTL_SECTOR_SIZE, FTL_SECTOR_SIZE) != 0)
+                    u32Got = 0xFFFFFFFFU;
+                else
+                    u32Got = 0U;
+            }
+            /* Unsynced writes may or may not have made it, in order */
+            if ((u32Got < s_au32Synced[i]) || (u32Got > s_au32Written[i]))
+            {
+                sysprintf("Round %d: sector %d has generation %d, expected %d or %d\n", u32Round, i, u32Got,
+                          s_au32Synced[i], s_au32Written[i]);
+                return FTL_ERR_IO;
+            }
+            s_au32Synced[i] = u32Got;
+            s_au32Written[i] = u32Got;
+        }
+
+        /* Write until the power goes */
+        sSim.u32CutAfter = sSim.u32Programs + sSim.u32Erases + 1U + (u32Rand % 4000U);
+        FTL_SimPort(&s_sPort, &sSim);
+        while (!sSim.u32Cut)
+        {
+            u32Rand = u32Rand * 1103515245U + 12345U;
+            u32Sector = (u32Rand >> 8) % u32Sectors;
+            u32Gen++;
+            SimFill(s_au8Buf, u32Sector, u32Gen);
+            s_au32Written[u32Sector] = u32Gen;
+            if (FTL_Write(&s_sFtl, u32Sector, 1U, s_au8Buf) != FTL_OK)
+                break;
+            if ((u32Rand & 0x1F00U) == 0U)
+            {
+                if (FTL_Sync(&s_sFtl) != FTL_OK)
+                    break;
+                memcpy(s_au32Synced, s_au32Written, sizeof(s_au32Synced));
+            }
+        }
+
+        /* Power up again */
+        sSim.u32Cut = 0U;
+        sSim.u32CutAfter = 0U;
+    }
+
+    i32Ret = SimMount(&sSim, &sCfg);
+    if (i32Ret == FTL_OK)
+    {
+        sysprintf("%d power cuts passed: %d sector writes, %d pages programmed, %d blocks erased\n", SIM_ROUNDS,
+                  u32Gen, sSim.u32Programs, sSim.u32Erases);
+        FTL_Unmount(&s_sFtl);
+    }
+    return i32Ret;
+}
+#endif
+
+static int32_t FileTest(void)
+{
+    FRESULT res;
+    UINT uCnt;
+    uint64_t u64Start;
+    uint32_t i, j, u32Us;
+
+    res = f_open(&s_sFile, TEST_FILE, FA_CREATE_ALWAYS | FA_WRITE);
+    if (res != FR_OK)
+        return -1;
+
+    u64Start = EL0_GetCurrentPhysicalValue();
+    for (i = 0; i < TEST_FILE_SIZE; i += TEST_CHUNK)
+    {
+        for (j = 0; j < TEST_CHUNK; j += 4)
+            *(uint32_t *)&s_au8Buf[j] = i + j;
+        res = f_write(&s_sFile, s_au8Buf, TEST_CHUNK, &uCnt);
+        if ((res != FR_OK) || (uCnt != TEST_CHUNK))
+            break;
+    }
+    if (res == FR_OK)
+        res = f_close(&s_sFile);
+    if (res != FR_OK)
+        return -1;
+    u32Us = Elapsed_us(u64Start);
+    sysprintf("Write %d KB in %d ms, %d KB/s\n", TEST_FILE_SIZE / 1024, u32Us / 1000,
+              (uint32_t)((uint64_t)TEST_FILE_SIZE * 1000000ULL / 1024 / (u32Us ? u32Us : 1)));
+
+    res = f_open(&s_sFile, TEST_FILE, FA_OPEN_EXISTING | FA_READ);
+    if (res != FR_OK)
+        return -1;
+
+    u64Start = EL0_GetCurrentPhysicalValue();
+    for (i = 0; i < TEST_FILE_SIZE; i += TEST_CHUNK)
+    {
+        res = f_read(&s_sFile, s_au8Buf, TEST_CHUNK, &uCnt);
+        if ((res != FR_OK) || (uCnt != TEST_CHUNK))
+            break;
+        for (j = 0; j < TEST_CHUNK; j += 4)
+        {
+            if (*(uint32_t *)&s_au8Buf[j] != i + j)
+            {
+                sysprintf("Compare error at offset 0x%x\n", i + j);
+                f_close(&s_sFile);
+                return -1;
+            }
+        }
+    }
+    u32Us = Elapsed_us(u64Start);
+    f_close(&s_sFile);
+    if ((res != FR_OK) || (uCnt != TEST_CHUNK))
+        return -1;
+    sysprintf("Read %d KB in %d ms, %d KB/s\n", TEST_FILE_SIZE / 1024, u32Us / 1000,
+              (uint32_t)((uint64_t)TEST_FILE_SIZE * 1000000ULL / 1024 / (u32Us ? u32Us : 1)));
+
+    /* With FF_USE_TRIM the freed clusters are trimmed in the FTL */
+    return (f_unlink(TEST_FILE) == FR_OK) ? 0 : -1;
+}
+
+int32_t main(void)
+{
+    SFLASH_SVC_CFG_T sSvcCfg;
+    SFLASH_SVC_INFO_T sInfo;
+    FTL_CFG_T sCfg;
+    FRESULT res;
+    int32_t i32Ret;
+
+    /* Init System, IP clock and multi-function I/O */
+    SYS_Init();
+    UART0_Init();
+    global_timer_init();
+
+    sysprintf("\n+---------------------------------------+\n");
+    sysprintf("|  FAT file system on SPI-NAND with FTL |\n");
+    sysprintf("+---------------------------------------+\n");
+
+#if POWER_CUT_TEST
+    sysprintf("\nPower cut test on the RAM NAND simulator\n");
+    if (PowerCutTest() != FTL_OK)
+    {
+        sysprintf("Power cut test failed\n");
+        while (1);
+    }
+#endif
+
+    IRQ_SetHandler((IRQn_ID_t)PDMA0_IRQn, PDMA0_IRQHandler);
+    IRQ_Enable((IRQn_ID_t)PDMA0_IRQn);
+
+    memset(&sSvcCfg, 0, sizeof(sSvcCfg));
+    sSvcCfg.qspi = QSPI0;
+    sSvcCfg.u32BusClock = 50000000;
+    sSvcCfg.pdma = PDMA0;
+    sSvcCfg.eIrq = (IRQn_ID_t)PDMA0_IRQn;
+    sSvcCfg.u32TxCh = 0;
+    sSvcCfg.u32RxCh = 1;
+    sSvcCfg.u32TxReq = PDMA_QSPI0_TX;
+    sSvcCfg.u32RxReq = PDMA_QSPI0_RX;
+
+    i32Ret = SFLASHSVC_Open(&s_sSvc, &sSvcCfg);
+    if (i32Ret != SFLASH_SVC_OK)
+    {
+        sysprintf("No serial flash found (%d)\n", i32Ret);
+        while (1);
+    }
+    SFLASHSVC_GetInfo(&s_sSvc, &sInfo);
+    sysprintf("\nFlash 0x%06x: %d blocks of %d x %d bytes\n", sInfo.u32JedecId, sInfo.u32Blocks,
+              sInfo.u32PagesPerBlock, sInfo.u32PageSize);
+
+    if (FTL_SflashPort(&s_sPort, &s_sSvc) != FTL_OK)
+    {
+        sysprintf("Not a SPI-NAND flash\n");
+        while (1);
+    }
+
+    memset(&sCfg, 0, sizeof(sCfg));
+    sCfg.psPort = &s_sPort;
+    sCfg.u32FirstBlock = FTL_FIRST_BLOCK;
+    sCfg.u32Blocks = FTL_BLOCKS;
+    sCfg.pvWork = s_au64Work;
+    sCfg.u32WorkSize = sizeof(s_au64Work);
+    sysprintf("FTL work area %d bytes\n", FTL_GetWorkSize(&s_sPort, FTL_BLOCKS));
+
+    i32Ret = FTL_Mount(&s_sFtl, &sCfg);
+    if (i32Ret == FTL_ERR_FORMAT)
+    {
+        sysprintf("No FTL found, formatting...\n");
+        i32Ret = FTL_Format(&s_sFtl, &sCfg);
+        if (i32Ret == FTL_OK)
+            i32Ret = FTL_Mount(&s_sFtl, &sCfg);
+    }
+    if (i32Ret != FTL_OK)
+    {
+        sysprintf("FTL mount failed (%d)\n", i32Ret);
+        while (1);
+    }
+    sysprintf("FTL mounted, %d sectors\n", FTL_GetSectorCount(&s_sFtl));
+    disk_ftl_attach(&s_sFtl);
+
+    res = f_mount(&s_sFatFs, "0:", 1);
+    if (res == FR_NO_FILESYSTEM)
+    {
+        sysprintf("No FAT volume found, creating one...\n");
+        res = f_mkfs("0:", FM_ANY, 0, s_au8MkfsWork, sizeof(s_au8MkfsWork));
+        if (res == FR_OK)
+            res = f_mount(&s_sFatFs, "0:", 1);
+    }
+    if (res != FR_OK)
+    {
+        sysprintf("FAT mount failed (%d)\n", res);
+        while (1);
+    }
+
+    if (FileTest() != 0)
+        sysprintf("File test failed\n");
+
+    f_mount(NULL, "0:", 0);
+    sysprintf("\nFTL statistics:\n");
+    PrintStat(&s_sFtl);
+    FTL_Unmount(&s_sFtl);
+    sysprintf("Done\n");
+
+    while (1);
+}
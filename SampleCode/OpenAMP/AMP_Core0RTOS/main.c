@@ -8,7 +8,8 @@
  * Core0 (this core)     Core1
  *   A (Tx & Rx)  <----->  B (High freq. short packet)
  *   C (Tx & Rx)  <----->  D (Low freq. long packet)
- *   E (Tx & Rx)  <----->  F (CRC test)
+ *   E (Tx & Rx)  <----->  F (CRC test, round-trip latency by 'l')
+ *   G (Tx)       ------>  H (Bulk stream without copy by 'm')
  * 
  * @note     TIMER8/TIMER9 has been assigned to OpenAMP for IPI.
  *
@@ -21,6 +22,7 @@
 #include "queue.h"
 #include "platform_info.h"
 #include "rsc_table.h"
+#include "nu_crc.h"
 
 #define CORE1_EXECUTE 0x88000000
 
@@ -29,6 +31,7 @@ extern void RunCore1(uint32_t addr);
 #define TASKA_TX_SIZE 0x400
 #define TASKC_TX_SIZE 0x2800
 #define TASKE_TX_SIZE 0x400
+#define TASKG_TX_SIZE 0x10 /* bulk descriptor */
 
 int ReadTaskA_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
                  uint32_t src, void *priv);
@@ -36,21 +39,19 @@ int ReadTaskC_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
                  uint32_t src, void *priv);
 int ReadTaskE_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
                  uint32_t src, void *priv);
-void vPollTaskA(void *pvParameters);
 void vSendTaskA(void *pvParameters);
-void vPollTaskC(void *pvParameters);
 void vSendTaskC(void *pvParameters);
-void vPollTaskE(void *pvParameters);
 void vSendTaskE(void *pvParameters);
 
 /* User defined endpoints */
 struct amp_endpoint eptinst[] = {
     {{"eptA->B", EPT_TYPE_TX, TASKA_TX_SIZE}, NULL, vSendTaskA}, /* Task A */
-    {{"eptB->A", EPT_TYPE_RX}, ReadTaskA_cb, vPollTaskA},        /* Task A */
+    {{"eptB->A", EPT_TYPE_RX}, ReadTaskA_cb, NULL},              /* Task A */
     {{"eptC->D", EPT_TYPE_TX, TASKC_TX_SIZE}, NULL, vSendTaskC}, /* Task C */
-    {{"eptD->C", EPT_TYPE_RX}, ReadTaskC_cb, vPollTaskC},        /* Task C */
+    {{"eptD->C", EPT_TYPE_RX}, ReadTaskC_cb, NULL},              /* Task C */
     {{"eptE->F", EPT_TYPE_TX, TASKE_TX_SIZE}, NULL, vSendTaskE}, /* Task E */
-    {{"eptF->E", EPT_TYPE_RX}, ReadTaskE_cb, vPollTaskE},        /* Task E */
+    {{"eptF->E", EPT_TYPE_RX}, ReadTaskE_cb, NULL},              /* Task E */
+    {{"eptG->H", EPT_TYPE_TX, TASKG_TX_SIZE}, NULL, NULL},       /* Task G */
 };
 char tx_bufA[TASKA_TX_SIZE];
 char tx_bufC[TASKC_TX_SIZE];
@@ -104,6 +105,16 @@ void SYS_Init()
     SYS_LockReg();
 }
 
+/**
+ * @brief Called in the endpoint's rx task when the remote endpoint closed
+ *
+ * @param ept rpmsg endpoint
+ */
+static void amp_remote_closed(struct rpmsg_endpoint *ept)
+{
+    sysprintf("%s: Remote closed.\n", ept->name);
+}
+
 /**
  * @brief Create endpoint and its task
  *
@@ -121,17 +132,26 @@ int amp_create_ept(struct rpmsg_device *rpdev, struct amp_endpoint *amp_ept)
         ret = ma35_rpmsg_create_txept(&amp_ept->ept, rpdev, info->name,
                                       info->size);
     } else if (info->type == EPT_TYPE_RX) {
-        ret = ma35_rpmsg_create_rxept(&amp_ept->ept, rpdev, info->name,
-                                      amp_ept->cb);
+        /* 1. do nothing and wait for reconnecting 2. destroy the endpoint
+         * from another task */
+        amp_ept->ept.ns_unbind_cb = amp_remote_closed;
+        if (info->size & EPT_RX_NOCOPY)
+            ret = ma35_rpmsg_create_rxept_nocopy(&amp_ept->ept, rpdev,
+                                                 info->name, amp_ept->cb);
+        else
+            ret = ma35_rpmsg_create_rxept(&amp_ept->ept, rpdev, info->name,
+                                          amp_ept->cb);
     } else {
         sysprintf("Invalid endpoint type.\n");
         ret = -1;
     }
 
     if (ret >= 0) {
-        xTaskCreate(amp_ept->task_fn, amp_ept->eptinfo.name,
-                    configMINIMAL_STACK_SIZE, &amp_ept->ept,
-                    tskIDLE_PRIORITY + 2, &amp_ept->taskHandle);
+        /* Rx endpoints need no task, the driver runs their callback */
+        if (amp_ept->task_fn)
+            xTaskCreate(amp_ept->task_fn, amp_ept->eptinfo.name,
+                        configMINIMAL_STACK_SIZE, &amp_ept->ept,
+                        tskIDLE_PRIORITY + 2, &amp_ept->taskHandle);
         sysprintf("rpmsg%d: %s endpoint \"%s\" is created.\n", id++,
                   (info->type == EPT_TYPE_TX) ? "Tx" : "Rx", info->name);
     } else {
@@ -246,7 +266,8 @@ void vSendTaskA(void *pvParameters)
 
 /**
  * @brief User Rx callback, do not call this directly.
- *        The function is called when a POLLIN event is received.
+ *        The function is called in the endpoint's rx task right after
+ *        the IPI of a new message.
  *
  * @param ept rpmsg endpoint
  * @param data pointer to rx buffer provided by driver
@@ -270,30 +291,6 @@ int ReadTaskA_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
     return RPMSG_SUCCESS;
 }
 
-/**
- * @brief User poll task, call ma35_rpmsg_poll to get status
- *
- * @param pvParameters ept
- */
-void vPollTaskA(void *pvParameters)
-{
-    int ret;
-
-    for (;;) {
-        ret = ma35_rpmsg_poll(pvParameters);
-        if (ret == RPMSG_ERR_PERM) {
-            sysprintf("%s: Remote closed.\n", pcTaskGetName(NULL));
-            /* 1. do nothing and try reconnecting 2. call ma35_rpmsg_destroy_ept
-             * and exit */
-            // ma35_rpmsg_destroy_ept(pvParameters);
-            // vTaskDelete(NULL);
-        } else if (ret == RPMSG_ERR_NO_BUFF)
-            sysprintf("%s: Rx buffer is full.\n", pcTaskGetName(NULL));
-
-        vTaskDelay(2);
-    }
-}
-
 /**
  * @brief User Tx task, call ma35_rpmsg_send to send data
  *
@@ -335,7 +332,8 @@ void vSendTaskC(void *pvParameters)
 
 /**
  * @brief User Rx callback, do not call this directly.
- *        The function is called when a POLLIN event is received.
+ *        The function is called in the endpoint's rx task right after
+ *        the IPI of a new message.
  *
  * @param ept rpmsg endpoint
  * @param data pointer to rx buffer provided by driver
@@ -359,32 +357,11 @@ int ReadTaskC_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
     return RPMSG_SUCCESS;
 }
 
-/**
- * @brief User poll task, call ma35_rpmsg_poll to get status
- *
- * @param pvParameters ept
- */
-void vPollTaskC(void *pvParameters)
-{
-    int ret;
-
-    for (;;) {
-        ret = ma35_rpmsg_poll(pvParameters);
-        if (ret == RPMSG_ERR_PERM) {
-            sysprintf("%s: Remote closed.\n", pcTaskGetName(NULL));
-            /* 1. do nothing and try reconnecting 2. call ma35_rpmsg_destroy_ept
-             * and exit */
-            // ma35_rpmsg_destroy_ept(pvParameters);
-            // vTaskDelete(NULL);
-        } else if (ret == RPMSG_ERR_NO_BUFF)
-            sysprintf("%s: Rx buffer is full.\n", pcTaskGetName(NULL));
-
-        vTaskDelay(10);
-    }
-}
-
 uint32_t crc_cal, crc_cmp = 0, crc_err = 0;
-extern uint32_t crc32(uint32_t crc, void *data, size_t length);
+
+#define LATENCY_ROUNDS 1000
+static volatile int latency_run;       // holds off vSendTaskE
+static TaskHandle_t xLatencyWaiter;    // woken by each reply of F
 /**
  * @brief User Tx task, call ma35_rpmsg_send to send data
  *
@@ -395,6 +372,11 @@ void vSendTaskE(void *pvParameters)
     int i, ret, size = sizeof(uint32_t);
 
     for (;;) {
+        if (latency_run) {
+            vTaskDelay(1000);
+            continue;
+        }
+
         /* Start of user write function */
         size = rand();
         size = size % TASKE_TX_SIZE;
@@ -403,7 +385,7 @@ void vSendTaskE(void *pvParameters)
         for (i = 0; i < size; i++)
             tx_bufE[i] = size + i;
 
-        crc_cal = crc32(0UL, tx_bufE, size);
+        crc_cal = nu_crc32(0UL, tx_bufE, size);
         /* End of user write function */
 
         ret = ma35_rpmsg_send(pvParameters, &tx_bufE, size);
@@ -418,7 +400,8 @@ void vSendTaskE(void *pvParameters)
 
 /**
  * @brief User Rx callback, do not call this directly.
- *        The function is called when a POLLIN event is received.
+ *        The function is called in the endpoint's rx task right after
+ *        the IPI of a new message.
  *
  * @param ept rpmsg endpoint
  * @param data pointer to rx buffer provided by driver
@@ -441,33 +424,106 @@ int ReadTaskE_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
         crc_err++;
     // else
     //     sysprintf("recv: 0x%08x, calc: 0x%08x\n", rxbuf[0], crc_cal);
+    if (xLatencyWaiter)
+        xTaskNotifyGive(xLatencyWaiter);
     /* End of user read function */
 
     return RPMSG_SUCCESS;
 }
 
 /**
- * @brief User poll task, call ma35_rpmsg_poll to get status
+ * @brief Round-trip latency of E -> F -> E, measured with the generic timer
+ *        Each round sends 4 bytes and waits for the CRC that F sends back.
  *
- * @param pvParameters ept
+ * @param ept Tx endpoint of E
  */
-void vPollTaskE(void *pvParameters)
+static void amp_latency_test(struct rpmsg_endpoint *ept)
 {
-    int ret;
+    uint64_t t0, dt, dt_min = ~0ULL, dt_max = 0, dt_sum = 0;
+    uint32_t freq = (uint32_t)raw_read_cntfrq_el0();
+    uint32_t seq;
+    int i, ret = 0, lost = 0;
+
+    latency_run = 1;
+    vTaskDelay(100); // let a pending CRC test message come back
+    xLatencyWaiter = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    for (i = 0; i < LATENCY_ROUNDS; i++) {
+        seq = i;
+        crc_cal = nu_crc32(0UL, &seq, sizeof(seq));
+
+        t0 = EL0_GetCurrentPhysicalValue();
+        while ((ret = ma35_rpmsg_send(ept, &seq, sizeof(seq))) ==
+               RPMSG_ERR_NO_BUFF)
+            taskYIELD();
+        if (ret < 0)
+            break;
+
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100)) == 0) {
+            lost++;
+            continue;
+        }
+        dt = EL0_GetCurrentPhysicalValue() - t0;
 
-    for (;;) {
-        ret = ma35_rpmsg_poll(pvParameters);
-        if (ret == RPMSG_ERR_PERM) {
-            sysprintf("%s: Remote closed.\n", pcTaskGetName(NULL));
-            /* 1. do nothing and try reconnecting 2. call ma35_rpmsg_destroy_ept
-             * and exit */
-            // ma35_rpmsg_destroy_ept(pvParameters);
-            // vTaskDelete(NULL);
-        } else if (ret == RPMSG_ERR_NO_BUFF)
-            sysprintf("%s: Rx buffer is full.\n", pcTaskGetName(NULL));
+        dt_sum += dt;
+        if (dt < dt_min)
+            dt_min = dt;
+        if (dt > dt_max)
+            dt_max = dt;
+    }
 
-        vTaskDelay(100);
+    xLatencyWaiter = NULL;
+    latency_run = 0;
+
+    if (ret < 0)
+        sysprintf("Latency test failed, err: %d.\n", ret);
+    else if (i == lost)
+        sysprintf("Latency test: no reply.\n");
+    else
+        sysprintf("Round trip of %d msgs: min %d, avg %d, max %d us, lost %d\n",
+                  i - lost, (int)(dt_min * 1000000 / freq),
+                  (int)(dt_sum / (i - lost) * 1000000 / freq),
+                  (int)(dt_max * 1000000 / freq), lost);
+}
+
+#define BULK_TEST_SIZE (64 * 1024 * 1024)
+/**
+ * @brief Stream through the bulk channel G -> H, the payload is not copied
+ *        Blocks are filled in place; the first word is a sequence number
+ *        that H checks.
+ *
+ * @param ept Tx endpoint of G
+ */
+static void amp_bulk_test(struct rpmsg_endpoint *ept)
+{
+    uint64_t t0, dt;
+    uint32_t freq = (uint32_t)raw_read_cntfrq_el0();
+    uint32_t *buf, size, seq, sent = 0;
+    int ret = 0;
+
+    t0 = EL0_GetCurrentPhysicalValue();
+    for (seq = 0; sent < BULK_TEST_SIZE; seq++) {
+        while ((buf = ma35_bulk_alloc(&size)) == NULL)
+            taskYIELD(); // all blocks are with H
+        /* Start of user write function */
+        buf[0] = seq;
+        /* End of user write function */
+        while ((ret = ma35_bulk_send(ept, buf, size)) == RPMSG_ERR_NO_BUFF)
+            taskYIELD();
+        if (ret < 0) {
+            ma35_bulk_release(buf);
+            break;
+        }
+        sent += size;
     }
+    dt = EL0_GetCurrentPhysicalValue() - t0;
+
+    if (ret < 0)
+        sysprintf("Bulk test failed, err: %d.\n", ret);
+    else
+        sysprintf("Bulk: %d KB in %d ms, %d KB/s\n", (int)(sent / 1024),
+                  (int)(dt * 1000 / freq), (int)((u64)sent * freq / 1024 / dt));
 }
 
 void vEndpointCreateTask(void *pvParameters)
@@ -528,6 +584,12 @@ void vCmdTask(void *pvParameters)
             case 'h':
                 sysprintf("Heap available: %d bytes\n", xPortGetFreeHeapSize());
                 break;
+            case 'l':
+                amp_latency_test(&amp_ept[4].ept);
+                break;
+            case 'm':
+                amp_bulk_test(&amp_ept[6].ept);
+                break;
             case 'r':
                 sysprintf("Restart tasks.\n");
                 amp_close();
@@ -574,6 +636,7 @@ int main(void)
     fflush(stdout);
 
     /* Initialize platform */
+    ma35_bulk_init();
     ret = platform_init(0, NULL, &platform);
     if (ret) {
         sysprintf("Failed to initialize platform.\r\n");
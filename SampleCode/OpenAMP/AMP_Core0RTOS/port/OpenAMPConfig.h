@@ -16,6 +16,13 @@
 #define RING_RX_SIZE           ( 0x4000 )
 #define SHARED_MEM_SIZE        ( RING_TX_SIZE + RING_RX_SIZE )
 #define NO_NAME_SERVICE        ( 32 ) /* Number of char supported by ns (must be aligned with word) */
+#define RPMSG_DISPATCH_PRIORITY ( tskIDLE_PRIORITY + 3 ) /* Rx callback tasks, above the user tasks */
+
+/* Bulk channel: payloads stay in this pool, rpmsg carries descriptors */
+#define SHARED_BULK_POOL       ( 0x84100000UL )
+#define BULK_BLOCK_SIZE        ( 0x40000 )
+#define BULK_BLOCK_NUM         ( 16 ) /* Blocks per direction */
+#define BULK_TX_DIR            ( 0 ) /* Core0 -> Core1 */
 
 #define RXIPI_BASE             ( TIMER8 )
 #define RXIPI_IRQ_NUM          (IRQn_ID_t)TMR8_IRQn
@@ -44,7 +51,9 @@ int ma35_rpmsg_create_txept(struct rpmsg_endpoint *ept,
 
 /**
  * @brief Create rx endpoint
- *
+ *        cb runs in a task of the endpoint that the IPI wakes for each
+ *        message; ept->ns_unbind_cb, if set, runs there when the remote
+ *        endpoint closes
  * @param ept  rpmsg endpoint
  * @param rdev rpmsg device
  * @param name name of endpoint
@@ -56,24 +65,27 @@ int ma35_rpmsg_create_rxept(struct rpmsg_endpoint *ept,
                             rpmsg_ept_cb cb);
 
 /**
- * @brief Destroy rpmsg endpoint
- *
- * @param ept rpmsg endpoint
+ * @brief Create rx endpoint without copy
+ *        cb gets the buffer in shared memory if the remote buffers follow
+ *        each other, else a copy as with ma35_rpmsg_create_rxept. The
+ *        remote cannot send again until cb returns or the buffer it kept
+ *        is released, so one message is in flight at a time.
+ * @param ept  rpmsg endpoint
+ * @param rdev rpmsg device
+ * @param name name of endpoint
+ * @param cb   user rx callback function
+ * @return int 0 for success
  */
-int ma35_rpmsg_destroy_ept(struct rpmsg_endpoint *ept);
+int ma35_rpmsg_create_rxept_nocopy(struct rpmsg_endpoint *ept,
+                                   struct rpmsg_device *rdev, const char *name,
+                                   rpmsg_ept_cb cb);
 
 /**
- * @brief Receive data by rx endpoint
- *        poll for head or remote close
- *        this function calls user callback if data is ready
- * @param ept
- * @return "true" for success
- *         "RPMSG_ERR_PERM" if remote endpoint closed
- *         - 1. Do nothing and try reconnecting 2. Destroy and exit
- *         "RPMSG_ERR_NO_BUFF" if rx buffer is full
- *         - Warning: Increase receiver freq. or decrease sender freq.
+ * @brief Destroy rpmsg endpoint
+ *        not from its own rx callback, which runs in the task it deletes
+ * @param ept rpmsg endpoint
  */
-int ma35_rpmsg_poll(struct rpmsg_endpoint *ept);
+int ma35_rpmsg_destroy_ept(struct rpmsg_endpoint *ept);
 
 /**
  * @brief Send data by tx endpoint
@@ -89,6 +101,87 @@ int ma35_rpmsg_poll(struct rpmsg_endpoint *ept);
  */
 int ma35_rpmsg_send(struct rpmsg_endpoint *ept, const void *data, int len);
 
+/**
+ * @brief Get the shared tx buffer of a tx endpoint to fill in place
+ *
+ * @param ept rpmsg endpoint
+ * @param buf get the buffer
+ * @return "positive" buffer size
+ *         "RPMSG_ERR_NO_BUFF" if remote still reads the last message
+ *         "RPMSG_ERR_PERM" or "RPMSG_ERR_INIT" as ma35_rpmsg_send
+ *         "RPMSG_EOPNOTSUPP" if the buffer is not one flat area
+ */
+int ma35_rpmsg_get_tx_buffer(struct rpmsg_endpoint *ept, void **buf);
+
+/**
+ * @brief Send the buffer of ma35_rpmsg_get_tx_buffer without copy
+ *
+ * @param ept rpmsg endpoint
+ * @param buf buffer from ma35_rpmsg_get_tx_buffer
+ * @param len data length
+ * @return as ma35_rpmsg_send
+ */
+int ma35_rpmsg_send_nocopy(struct rpmsg_endpoint *ept, void *buf, int len);
+
+/**
+ * @brief Keep a buffer of a no-copy rx endpoint after its callback returns
+ *        call it from the callback
+ * @param ept  rpmsg endpoint
+ * @param data buffer passed to the callback
+ * @return int 0 for success, "RPMSG_EOPNOTSUPP" if data is a copy
+ */
+int ma35_rpmsg_hold_rx_buffer(struct rpmsg_endpoint *ept, void *data);
+
+/**
+ * @brief Give a kept rx buffer back to the remote
+ *
+ * @param ept  rpmsg endpoint
+ * @param data buffer passed to ma35_rpmsg_hold_rx_buffer
+ * @return int 0 for success
+ */
+int ma35_rpmsg_release_rx_buffer(struct rpmsg_endpoint *ept, void *data);
+
+/**
+ * @brief Take a free block of the bulk pool to fill
+ *
+ * @param size get the block size
+ * @return pointer to the block, NULL if all blocks are with the remote
+ */
+void *ma35_bulk_alloc(uint32_t *size);
+
+/**
+ * @brief Pass a block to the remote, it belongs to the remote afterwards
+ *
+ * @param ept tx endpoint carrying the descriptors
+ * @param buf block from ma35_bulk_alloc
+ * @param len data length
+ * @return "positive" data length sent, or the errors of ma35_rpmsg_send;
+ *         on error the block is still ours
+ */
+int ma35_bulk_send(struct rpmsg_endpoint *ept, void *buf, uint32_t len);
+
+/**
+ * @brief Get the block of a descriptor received by a bulk rx endpoint
+ *
+ * @param data message passed to the rx callback
+ * @param len  message length
+ * @param size get the data length
+ * @return pointer to the block, NULL if data is no bulk descriptor
+ */
+void *ma35_bulk_recv(const void *data, size_t len, uint32_t *size);
+
+/**
+ * @brief Give a block back: received ones to the remote, unsent ones to
+ *        the pool
+ * @param buf bulk block
+ */
+void ma35_bulk_release(void *buf);
+
+/**
+ * @brief Mark all blocks of this core free, before the first ma35_bulk_alloc
+ */
+void ma35_bulk_init(void);
+
 /**
  * @brief
  *
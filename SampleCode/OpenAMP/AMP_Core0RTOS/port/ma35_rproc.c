@@ -25,10 +25,12 @@ extern void *resource_table_shmem;
 extern struct remote_resource_table resources;
 
 void RxIPI_IRQHandler(void);
-static int ma35_rpmsg_receive(struct rpmsg_endpoint_priv *ept_priv);
+static int ma35_rpmsg_receive(struct rpmsg_endpoint_priv *ept_priv,
+                              BaseType_t *pxWoken);
 static int check_tx_bind_ready(struct rpmsg_endpoint_priv *ept_priv);
 static int check_rx_bind_ready(struct rpmsg_endpoint_priv *ept_priv);
-static int ma35_rpmsg_reconnect_ept(struct rpmsg_endpoint_priv *ept_priv);
+static int ma35_rpmsg_reconnect_ept(struct rpmsg_endpoint_priv *ept_priv,
+                                    BaseType_t *pxWoken);
 static int ma35_desc_init(struct remoteproc_priv *priv);
 static int ma35_rsc_table_parser(struct remoteproc_priv *priv);
 
@@ -73,6 +75,9 @@ static struct remoteproc *ma35_rproc_init(struct remoteproc *rproc,
     TXIPI_BASE->CMP = 0x2;
     TXIPI_BASE->CTL = 1 << 29;
     IRQ_SetHandler((IRQn_ID_t)RXIPI_IRQ_NUM, RxIPI_IRQHandler);
+    /* Highest priority that may still wake tasks from the handler */
+    IRQ_SetPriority(RXIPI_IRQ_NUM,
+                    configMAX_API_CALL_INTERRUPT_PRIORITY << portPRIORITY_SHIFT);
     IRQ_SetTarget(RXIPI_IRQ_NUM, IRQ_CPU_0);
     IRQ_Enable((IRQn_ID_t)RXIPI_IRQ_NUM);
 
@@ -150,6 +155,7 @@ void RxIPI_IRQHandler(void)
     struct remote_resource_table *rsc_table = resource_table_shmem;
     struct rpmsg_endpoint_priv *ept_priv;
     struct rsc_table_desc *desc;
+    BaseType_t xWoken = pdFALSE;
 
     if (TIMER_GetIntFlag(RXIPI_BASE) == 1)
         TIMER_ClearIntFlag(RXIPI_BASE);
@@ -170,14 +176,17 @@ void RxIPI_IRQHandler(void)
                 desc->CMD = 0;
                 desc->STS = VRING_DESC_STS_READING;
                 if (ept_priv->cmd & VRING_DESC_CMD_HEAD) {
-                    if (ma35_rpmsg_receive(ept_priv) != RPMSG_SUCCESS)
+                    if (ma35_rpmsg_receive(ept_priv, &xWoken) != RPMSG_SUCCESS)
                         continue;
                 } else if (ept_priv->cmd & VRING_DESC_CMD_CLOSE) {
-                    ma35_rpmsg_reconnect_ept(ept_priv);
+                    ma35_rpmsg_reconnect_ept(ept_priv, &xWoken);
                 }
             }
         }
     }
+
+    /* Switch straight to a dispatch task the messages woke */
+    portYIELD_FROM_ISR(xWoken);
 }
 
 // Use timer to generate INT to remote
@@ -300,41 +309,58 @@ static int ma35_rpmsg_receive_status(struct rpmsg_endpoint_priv *ept_priv,
     return 0;
 }
 
-int ma35_rpmsg_poll(struct rpmsg_endpoint *ept)
+/* Start of the buffers of a desc chain if they follow each other, else NULL */
+static void *ma35_desc_flat(struct rsc_table_desc *desc, u64 base, u32 bufsz)
 {
-    struct rpmsg_endpoint_priv *ept_priv;
-    struct rxbuf_queue_t rxqueue;
-    int ret, len;
-    void *buf;
+    struct rsc_table_desc *next;
+    u32 offset;
 
-    if (!ept)
-        return RPMSG_ERR_PARAM;
+    if (!desc)
+        return NULL;
 
-    ept_priv = ept->priv;
+    for (offset = desc->buf_offset; desc->nxt_offset; desc = next) {
+        next = (struct rsc_table_desc *)(rproc_priv.shmem_base +
+                                         desc->nxt_offset);
+        if (next->buf_offset != desc->buf_offset + bufsz)
+            return NULL;
+    }
 
-    if (!ept_priv->xQueue)
-        return RPMSG_ERR_INIT;
+    return (void *)(base + offset);
+}
+
+/* Runs the rx callback of one endpoint as soon as the IPI queued a message */
+static void vDispatchTask(void *pvParameters)
+{
+    struct rpmsg_endpoint *ept = pvParameters;
+    struct rpmsg_endpoint_priv *ept_priv = ept->priv;
+    struct rxbuf_queue_t rxqueue;
+
+    for (;;) {
+        if (xQueueReceive(ept_priv->xQueue, &rxqueue, portMAX_DELAY) != pdTRUE)
+            continue;
 
-    ret = xQueueReceive(ept_priv->xQueue, &rxqueue, QUEUE_WAIT_TICK);
-    if (ret == pdTRUE) {
         if (rxqueue.cmd & VRING_DESC_CMD_HEAD) {
             if (ept->cb)
                 ept->cb(ept, rxqueue.rxbuf, rxqueue.len, 0, NULL);
 
+            if (rxqueue.id == RXBUF_NOCOPY) {
+                // remote may reuse the buffer unless the callback kept it
+                if (ept_priv->held != rxqueue.rxbuf)
+                    ma35_rpmsg_receive_status(ept_priv, VRING_DESC_STS_ACK);
+                continue;
+            }
+
             if (ma35_rpmsg_retrieve_status(ept_priv) == VRING_DESC_STS_ERR)
-                ret = RPMSG_ERR_NO_BUFF;
+                sysprintf("%s: Rx buffer is full.\n", pcTaskGetName(NULL));
 
             if (uxQueueSpacesAvailable(ept_priv->xQueue))
                 ma35_rpmsg_receive_status(
                     ept_priv, VRING_DESC_STS_ACK); // Its fine if no binding
-
-            return ret;
         } else if (rxqueue.cmd & VRING_DESC_CMD_CLOSE) {
-            return RPMSG_ERR_PERM;
+            if (ept->ns_unbind_cb)
+                ept->ns_unbind_cb(ept);
         }
     }
-
-    return 0;
 }
 
 static int ma35_rpmsg_desc_reset(struct rpmsg_endpoint *ept)
@@ -366,6 +392,7 @@ static int ma35_rpmsg_send_offchannel_raw(struct rpmsg_endpoint *ept,
     int i, res;
     struct rpmsg_endpoint_priv *ept_priv;
     struct rsc_table_desc *desc;
+    void *buf;
 
     if (!ept || !ept->priv || !data || len < 0)
         return RPMSG_ERR_PARAM;
@@ -389,13 +416,15 @@ static int ma35_rpmsg_send_offchannel_raw(struct rpmsg_endpoint *ept,
 
     for (i = 0, res = len; i < len;
          i += rproc_priv.desc_txbuf, res -= rproc_priv.desc_txbuf) {
+        buf = (void *)(rproc_priv.shmem_tx_base + desc->buf_offset);
         if (res <= rproc_priv.desc_txbuf) {
-            memcpy((void *)(rproc_priv.shmem_tx_base + desc->buf_offset),
-                   (void *)((uint8_t *)data + i), res);
+            if (buf != (uint8_t *)data + i) // filled in place
+                memcpy(buf, (void *)((uint8_t *)data + i), res);
             desc->len = res;
         } else {
-            memcpy((void *)(rproc_priv.shmem_tx_base + desc->buf_offset),
-                   (void *)((uint8_t *)data + i), rproc_priv.desc_txbuf);
+            if (buf != (uint8_t *)data + i)
+                memcpy(buf, (void *)((uint8_t *)data + i),
+                       rproc_priv.desc_txbuf);
             desc->len = rproc_priv.desc_txbuf;
             desc = (struct rsc_table_desc *)(rproc_priv.shmem_base +
                                              desc->nxt_offset);
@@ -504,7 +533,7 @@ static int check_tx_bind_ready(struct rpmsg_endpoint_priv *ept_priv)
     if (desc->STS & (VRING_DESC_STS_READING | VRING_DESC_STS_ERR))
         return RPMSG_ERR_NO_BUFF;
     else if (desc->STS == VRING_DESC_STS_CLOSE) {
-        ma35_rpmsg_reconnect_ept(ept_priv);
+        ma35_rpmsg_reconnect_ept(ept_priv, NULL);
         return RPMSG_ERR_PERM;
     }
 
@@ -522,7 +551,8 @@ static int check_rx_bind_ready(struct rpmsg_endpoint_priv *ept_priv)
     return RPMSG_SUCCESS;
 }
 
-static int ma35_kill_ns_bind(struct rpmsg_endpoint_priv *ept_priv)
+static int ma35_kill_ns_bind(struct rpmsg_endpoint_priv *ept_priv,
+                             BaseType_t *pxWoken)
 {
     struct rsc_table_desc *rxdesc;
     struct rxbuf_queue_t rxqueue;
@@ -540,7 +570,7 @@ static int ma35_kill_ns_bind(struct rpmsg_endpoint_priv *ept_priv)
 
     rxqueue.cmd = ept_priv->cmd;
     // No matter success or not
-    xQueueSend(ept_priv->xQueue, &rxqueue, QUEUE_WAIT_TICK);
+    xQueueSendFromISR(ept_priv->xQueue, &rxqueue, pxWoken);
     rxdesc->STS = VRING_DESC_STS_CLOSE;
 
     return RPMSG_SUCCESS;
@@ -562,7 +592,85 @@ int ma35_rpmsg_send(struct rpmsg_endpoint *ept, const void *data, int len)
         return RPMSG_EOPNOTSUPP;
 }
 
-static int ma35_rpmsg_receive(struct rpmsg_endpoint_priv *ept_priv)
+int ma35_rpmsg_get_tx_buffer(struct rpmsg_endpoint *ept, void **buf)
+{
+    struct rpmsg_endpoint_priv *ept_priv;
+    int ret;
+
+    if (!ept || !ept->priv || !buf)
+        return RPMSG_ERR_PARAM;
+
+    ept_priv = ept->priv;
+    if (ept_priv->ept_type != EPT_TYPE_TX)
+        return RPMSG_EOPNOTSUPP;
+
+    ret = check_tx_bind_ready(ept_priv);
+    if (ret)
+        return ret;
+
+    *buf = ma35_desc_flat(ept_priv->pDesc, rproc_priv.shmem_tx_base,
+                          rproc_priv.desc_txbuf);
+    if (!*buf)
+        return RPMSG_EOPNOTSUPP;
+
+    return ept_priv->available_len;
+}
+
+int ma35_rpmsg_send_nocopy(struct rpmsg_endpoint *ept, void *buf, int len)
+{
+    struct rpmsg_endpoint_priv *ept_priv;
+
+    if (!ept || !ept->priv || !buf || len < 0)
+        return RPMSG_ERR_PARAM;
+
+    ept_priv = ept->priv;
+    if (ept_priv->ept_type != EPT_TYPE_TX)
+        return RPMSG_EOPNOTSUPP;
+
+    if (buf != ma35_desc_flat(ept_priv->pDesc, rproc_priv.shmem_tx_base,
+                              rproc_priv.desc_txbuf))
+        return RPMSG_ERR_PARAM;
+
+    return ma35_rpmsg_send_offchannel_raw(ept, 0, 0, buf, len, true);
+}
+
+int ma35_rpmsg_hold_rx_buffer(struct rpmsg_endpoint *ept, void *data)
+{
+    struct rpmsg_endpoint_priv *ept_priv;
+
+    if (!ept || !ept->priv || !data)
+        return RPMSG_ERR_PARAM;
+
+    ept_priv = ept->priv;
+    if (!ept_priv->nocopy ||
+        data != ma35_desc_flat(ept_priv->bind_desc, rproc_priv.shmem_rx_base,
+                               rproc_priv.desc_rxbuf))
+        return RPMSG_EOPNOTSUPP; // a copy, nothing to hold
+
+    ept_priv->held = data;
+
+    return RPMSG_SUCCESS;
+}
+
+int ma35_rpmsg_release_rx_buffer(struct rpmsg_endpoint *ept, void *data)
+{
+    struct rpmsg_endpoint_priv *ept_priv;
+
+    if (!ept || !ept->priv || !data)
+        return RPMSG_ERR_PARAM;
+
+    ept_priv = ept->priv;
+    if (ept_priv->held != data)
+        return RPMSG_ERR_PARAM;
+
+    ept_priv->held = NULL;
+    ma35_rpmsg_receive_status(ept_priv, VRING_DESC_STS_ACK);
+
+    return RPMSG_SUCCESS;
+}
+
+static int ma35_rpmsg_receive(struct rpmsg_endpoint_priv *ept_priv,
+                              BaseType_t *pxWoken)
 {
     struct rsc_table_desc *desc;
     struct rxbuf_queue_t rxqueue;
@@ -570,6 +678,32 @@ static int ma35_rpmsg_receive(struct rpmsg_endpoint_priv *ept_priv)
     unsigned char id;
     void *buf;
 
+    if (ept_priv->nocopy) {
+        buf = ma35_desc_flat(ept_priv->bind_desc, rproc_priv.shmem_rx_base,
+                             rproc_priv.desc_rxbuf);
+        if (buf) {
+            desc = ept_priv->bind_desc;
+            while (desc && desc->len) {
+                rxlen += desc->len;
+                desc = (desc->nxt_offset == 0)
+                           ? NULL
+                           : (struct rsc_table_desc *)(rproc_priv.shmem_base +
+                                                       desc->nxt_offset);
+            }
+            // left READING until the callback is done with it
+            rxqueue.rxbuf = buf;
+            rxqueue.len = rxlen;
+            rxqueue.cmd = ept_priv->cmd;
+            rxqueue.id = RXBUF_NOCOPY;
+            if (xQueueSendFromISR(ept_priv->xQueue, &rxqueue, pxWoken) !=
+                pdTRUE) {
+                ma35_rpmsg_receive_status(ept_priv, VRING_DESC_STS_ERR);
+                return RPMSG_ERR_NO_BUFF;
+            }
+            return RPMSG_SUCCESS;
+        }
+    }
+
     buf = ept_priv->rxpool[ept_priv->poolid];
     desc = (struct rsc_table_desc *)ept_priv->bind_desc;
     while (desc && desc->len) {
@@ -589,7 +723,7 @@ static int ma35_rpmsg_receive(struct rpmsg_endpoint_priv *ept_priv)
     rxqueue.cmd = ept_priv->cmd;
     rxqueue.id = ept_priv->poolid;
     // enqueue to rx queue
-    if (xQueueSend(ept_priv->xQueue, &rxqueue, QUEUE_WAIT_TICK) != pdTRUE) {
+    if (xQueueSendFromISR(ept_priv->xQueue, &rxqueue, pxWoken) != pdTRUE) {
         // queue is full, flow control on queue
         ma35_rpmsg_receive_status(ept_priv, VRING_DESC_STS_ERR);
         return RPMSG_ERR_NO_BUFF;
@@ -629,8 +763,17 @@ static int ma35_check_available_desc(struct rpmsg_endpoint_priv *ept_priv,
     ept_priv->no_desc = req;
     ept_priv->available_len = len;
 
-    id = -1;
-    for (i = 0; (i < rproc_priv.desc_num) && (req > 0); i++) {
+    // prefer buffers that follow each other, so they can be filled in place
+    for (id = 0; id + req <= rproc_priv.desc_num; id++) {
+        for (i = 0; (i < req) && !rproc_priv.buf_flag[id + i]; i++)
+            ;
+        if (i == req)
+            break;
+    }
+    if (id + req > rproc_priv.desc_num)
+        id = 0;
+
+    for (i = id, id = -1; (i < rproc_priv.desc_num) && (req > 0); i++) {
         if (!rproc_priv.buf_flag[i]) {
             rproc_priv.buf_flag[i] = 1;
             desc->nxt_offset =
@@ -758,7 +901,8 @@ static int ma35_rpmsg_request_shmem(struct rpmsg_endpoint *ept,
     return ret;
 }
 
-static int ma35_rpmsg_reconnect_ept(struct rpmsg_endpoint_priv *ept_priv)
+static int ma35_rpmsg_reconnect_ept(struct rpmsg_endpoint_priv *ept_priv,
+                                    BaseType_t *pxWoken)
 {
     struct rsc_table_desc *desc;
 
@@ -773,7 +917,7 @@ static int ma35_rpmsg_reconnect_ept(struct rpmsg_endpoint_priv *ept_priv)
         desc->CMD = VRING_DESC_CMD_CLAIM;
     } else // EPT_TYPE_RX
     {
-        ma35_kill_ns_bind(ept_priv);
+        ma35_kill_ns_bind(ept_priv, pxWoken);
     }
 
     // ept reset finished, add to list
@@ -864,6 +1008,11 @@ int ma35_rpmsg_destroy_ept(struct rpmsg_endpoint *ept)
         ept_priv->bind_desc = NULL;
         rproc_priv.kick_ept[ept_priv->bind_id] = NULL;
         ept_priv->bind_id = 0;
+        // stop the dispatch task before its queue goes
+        if (ept_priv->xDispatch) {
+            vTaskDelete(ept_priv->xDispatch);
+            ept_priv->xDispatch = NULL;
+        }
         // release rx queue
         metal_mutex_acquire(&ept_priv->lock);
         vQueueDelete(ept_priv->xQueue);
@@ -942,10 +1091,17 @@ int ma35_rpmsg_create_rxept(struct rpmsg_endpoint *ept,
         goto err2;
     strncpy(ept_priv->rxns, name, NO_NAME_SERVICE);
 
+    // messages are handed to the callback by this task, woken by the IPI
+    if (xTaskCreate(vDispatchTask, name, configMINIMAL_STACK_SIZE, ept,
+                    RPMSG_DISPATCH_PRIORITY, &ept_priv->xDispatch) != pdPASS)
+        goto err3;
+
     // ept init finished, add to list
     add_node(rproc_priv.head_ept, ept);
 
     return RPMSG_SUCCESS;
+err3:
+    metal_free_memory(ept_priv->rxns);
 err2:
     metal_free_memory(ept_priv->rxpool);
 err1:
@@ -955,6 +1111,22 @@ err:
     return RPMSG_ERR_NO_MEM;
 }
 
+int ma35_rpmsg_create_rxept_nocopy(struct rpmsg_endpoint *ept,
+                                   struct rpmsg_device *rdev, const char *name,
+                                   rpmsg_ept_cb cb)
+{
+    int ret;
+
+    ret = ma35_rpmsg_create_rxept(ept, rdev, name, cb);
+    if (ret)
+        return ret;
+
+    // not binded yet, so no message can be in flight
+    ((struct rpmsg_endpoint_priv *)ept->priv)->nocopy = 1;
+
+    return RPMSG_SUCCESS;
+}
+
 int ma35_rpmsg_remote_ready(void)
 {
     return rproc_priv.ready == 1;
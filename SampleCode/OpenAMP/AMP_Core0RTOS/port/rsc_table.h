@@ -25,6 +25,7 @@ extern "C" {
 
 #define EPT_TYPE_TX            0x01
 #define EPT_TYPE_RX            0x10
+#define EPT_RX_NOCOPY          0x01 // rpmsg_endpoint_info.size of an rx ept
 
 #define VRING_DESC_CMD_HEAD    0x1 // write
 #define VRING_DESC_CMD_RELOAD  0x2
@@ -46,6 +47,7 @@ extern "C" {
 
 #define RXBUF_QUEUE_SIZE       ( 7 ) /* If the heap size is insufficient, try reducing the queue size */
 #define RXBUF_POOL_SIZE        ( RXBUF_QUEUE_SIZE + 1 )
+#define RXBUF_NOCOPY           0xFF // queued buffer is in shared memory
 #define BINDING_SLEEP_MS       ( 500 )
 #define QUEUE_WAIT_TICK        ( 0 ) // waiting time if blocked
 #define VRING_SIZE             8 /* Number of desc supported by this vring (must be power of two) */
@@ -9,6 +9,7 @@
  *   A  <----->  B (Tx & Rx) (High freq. short packet)
  *   C  <----->  D (Tx & Rx) (Low freq. long packet)
  *   E  <----->  F (Tx & Rx) (CRC test)
+ *   G  ------>  H (Rx) (Bulk stream without copy)
  * 
  * @note     TIMER8/TIMER9 has been assigned to OpenAMP for IPI.
  *
@@ -21,6 +22,7 @@
 #include "queue.h"
 #include "platform_info.h"
 #include "rsc_table.h"
+#include "nu_crc.h"
 
 #define TASKB_TX_SIZE 0x400
 #define TASKD_TX_SIZE 0x2800
@@ -32,21 +34,21 @@ int ReadTaskD_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
                  uint32_t src, void *priv);
 int ReadTaskF_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
                  uint32_t src, void *priv);
-void vPollTaskB(void *pvParameters);
+int ReadTaskH_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
+                 uint32_t src, void *priv);
 void vSendTaskB(void *pvParameters);
-void vPollTaskD(void *pvParameters);
 void vSendTaskD(void *pvParameters);
-void vPollTaskF(void *pvParameters);
 void vSendTaskF(void *pvParameters);
 
 /* User defined endpoints */
 struct amp_endpoint eptinst[] = {
-    {{"eptA->B", EPT_TYPE_RX}, ReadTaskB_cb, vPollTaskB},        /* Task B */
+    {{"eptA->B", EPT_TYPE_RX}, ReadTaskB_cb, NULL},              /* Task B */
     {{"eptB->A", EPT_TYPE_TX, TASKB_TX_SIZE}, NULL, vSendTaskB}, /* Task B */
-    {{"eptC->D", EPT_TYPE_RX}, ReadTaskD_cb, vPollTaskD},        /* Task D */
+    {{"eptC->D", EPT_TYPE_RX}, ReadTaskD_cb, NULL},              /* Task D */
     {{"eptD->C", EPT_TYPE_TX, TASKD_TX_SIZE}, NULL, vSendTaskD}, /* Task D */
-    {{"eptE->F", EPT_TYPE_RX}, ReadTaskF_cb, vPollTaskF},        /* Task F */
+    {{"eptE->F", EPT_TYPE_RX}, ReadTaskF_cb, NULL},              /* Task F */
     {{"eptF->E", EPT_TYPE_TX, TASKF_TX_SIZE}, NULL, vSendTaskF}, /* Task F */
+    {{"eptG->H", EPT_TYPE_RX, EPT_RX_NOCOPY}, ReadTaskH_cb, NULL}, /* Task H */
 };
 char tx_bufB[TASKB_TX_SIZE];
 char tx_bufD[TASKD_TX_SIZE];
@@ -99,6 +101,16 @@ void SYS_Init()
     SYS_LockReg();
 }
 
+/**
+ * @brief Called in the endpoint's rx task when the remote endpoint closed
+ *
+ * @param ept rpmsg endpoint
+ */
+static void amp_remote_closed(struct rpmsg_endpoint *ept)
+{
+    sysprintf("%s: Remote closed.\n", ept->name);
+}
+
 /**
  * @brief Create endpoint and its task
  *
@@ -116,17 +128,26 @@ int amp_create_ept(struct rpmsg_device *rpdev, struct amp_endpoint *amp_ept)
         ret = ma35_rpmsg_create_txept(&amp_ept->ept, rpdev, info->name,
                                       info->size);
     } else if (info->type == EPT_TYPE_RX) {
-        ret = ma35_rpmsg_create_rxept(&amp_ept->ept, rpdev, info->name,
-                                      amp_ept->cb);
+        /* 1. do nothing and wait for reconnecting 2. destroy the endpoint
+         * from another task */
+        amp_ept->ept.ns_unbind_cb = amp_remote_closed;
+        if (info->size & EPT_RX_NOCOPY)
+            ret = ma35_rpmsg_create_rxept_nocopy(&amp_ept->ept, rpdev,
+                                                 info->name, amp_ept->cb);
+        else
+            ret = ma35_rpmsg_create_rxept(&amp_ept->ept, rpdev, info->name,
+                                          amp_ept->cb);
     } else {
         sysprintf("Invalid endpoint type.\n");
         ret = -1;
     }
 
     if (ret >= 0) {
-        xTaskCreate(amp_ept->task_fn, amp_ept->eptinfo.name,
-                    configMINIMAL_STACK_SIZE, &amp_ept->ept,
-                    tskIDLE_PRIORITY + 2, &amp_ept->taskHandle);
+        /* Rx endpoints need no task, the driver runs their callback */
+        if (amp_ept->task_fn)
+            xTaskCreate(amp_ept->task_fn, amp_ept->eptinfo.name,
+                        configMINIMAL_STACK_SIZE, &amp_ept->ept,
+                        tskIDLE_PRIORITY + 2, &amp_ept->taskHandle);
         sysprintf("rpmsg%d: %s endpoint \"%s\" is created.\n", id++,
                   (info->type == EPT_TYPE_TX) ? "Tx" : "Rx", info->name);
     } else {
@@ -202,7 +223,8 @@ int amp_close(void)
 
 /**
  * @brief User Rx callback, do not call this directly.
- *        The function is called when a POLLIN event is received.
+ *        The function is called in the endpoint's rx task right after
+ *        the IPI of a new message.
  *
  * @param ept rpmsg endpoint
  * @param data pointer to rx buffer provided by driver
@@ -226,30 +248,6 @@ int ReadTaskB_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
     return RPMSG_SUCCESS;
 }
 
-/**
- * @brief User poll task, call ma35_rpmsg_poll to get status
- *
- * @param pvParameters ept
- */
-void vPollTaskB(void *pvParameters)
-{
-    int ret;
-
-    for (;;) {
-        ret = ma35_rpmsg_poll(pvParameters);
-        if (ret == RPMSG_ERR_PERM) {
-            sysprintf("%s: Remote closed.\n", pcTaskGetName(NULL));
-            /* 1. do nothing and try reconnecting 2. call ma35_rpmsg_destroy_ept
-             * and exit */
-            // ma35_rpmsg_destroy_ept(pvParameters);
-            // vTaskDelete(NULL);
-        } else if (ret == RPMSG_ERR_NO_BUFF)
-            sysprintf("%s: Rx buffer is full.\n", pcTaskGetName(NULL));
-
-        vTaskDelay(2);
-    }
-}
-
 /**
  * @brief User Tx task, call ma35_rpmsg_send to send data
  *
@@ -291,7 +289,8 @@ void vSendTaskB(void *pvParameters)
 
 /**
  * @brief User Rx callback, do not call this directly.
- *        The function is called when a POLLIN event is received.
+ *        The function is called in the endpoint's rx task right after
+ *        the IPI of a new message.
  *
  * @param ept rpmsg endpoint
  * @param data pointer to rx buffer provided by driver
@@ -315,30 +314,6 @@ int ReadTaskD_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
     return RPMSG_SUCCESS;
 }
 
-/**
- * @brief User poll task, call ma35_rpmsg_poll to get status
- *
- * @param pvParameters ept
- */
-void vPollTaskD(void *pvParameters)
-{
-    int ret;
-
-    for (;;) {
-        ret = ma35_rpmsg_poll(pvParameters);
-        if (ret == RPMSG_ERR_PERM) {
-            sysprintf("%s: Remote closed.\n", pcTaskGetName(NULL));
-            /* 1. do nothing and try reconnecting 2. call ma35_rpmsg_destroy_ept
-             * and exit */
-            // ma35_rpmsg_destroy_ept(pvParameters);
-            // vTaskDelete(NULL);
-        } else if (ret == RPMSG_ERR_NO_BUFF)
-            sysprintf("%s: Rx buffer is full.\n", pcTaskGetName(NULL));
-
-        vTaskDelay(10);
-    }
-}
-
 /**
  * @brief User Tx task, call ma35_rpmsg_send to send data
  *
@@ -378,10 +353,10 @@ void vSendTaskD(void *pvParameters)
     }
 }
 
-extern uint32_t crc32(uint32_t crc, void *data, size_t length);
 /**
  * @brief User Rx callback, do not call this directly.
- *        The function is called when a POLLIN event is received.
+ *        The function is called in the endpoint's rx task right after
+ *        the IPI of a new message.
  *
  * @param ept rpmsg endpoint
  * @param data pointer to rx buffer provided by driver
@@ -401,7 +376,7 @@ int ReadTaskF_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
     (void)priv;
 
     /* Start of user read function */
-    uint32_t crc_cal = crc32(0UL, rxbuf, rxlen);
+    uint32_t crc_cal = nu_crc32(0UL, rxbuf, rxlen);
     // signal to vSendTaskF
     xTaskNotify(eptSend->taskHandle, crc_cal, eSetValueWithOverwrite);
     /* End of user read function */
@@ -409,30 +384,6 @@ int ReadTaskF_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
     return RPMSG_SUCCESS;
 }
 
-/**
- * @brief User poll task, call ma35_rpmsg_poll to get status
- *
- * @param pvParameters ept
- */
-void vPollTaskF(void *pvParameters)
-{
-    int ret;
-
-    for (;;) {
-        ret = ma35_rpmsg_poll(pvParameters);
-        if (ret == RPMSG_ERR_PERM) {
-            sysprintf("%s: Remote closed.\n", pcTaskGetName(NULL));
-            /* 1. do nothing and try reconnecting 2. call ma35_rpmsg_destroy_ept
-             * and exit */
-            // ma35_rpmsg_destroy_ept(pvParameters);
-            // vTaskDelete(NULL);
-        } else if (ret == RPMSG_ERR_NO_BUFF)
-            sysprintf("%s: Rx buffer is full.\n", pcTaskGetName(NULL));
-
-        vTaskDelay(100);
-    }
-}
-
 /**
  * @brief User Tx task, call ma35_rpmsg_send to send data
  *
@@ -457,6 +408,43 @@ void vSendTaskF(void *pvParameters)
     }
 }
 
+unsigned long bulk_bytes;
+uint32_t bulk_seq, bulk_err = 0;
+/**
+ * @brief User Rx callback of the bulk channel, do not call this directly.
+ *        The descriptor and the block are read in shared memory.
+ *
+ * @param ept rpmsg endpoint
+ * @param data bulk descriptor
+ * @param len length of the descriptor
+ * @param src unused
+ * @param priv unused
+ * @return int always return RPMSG_SUCCESS
+ */
+int ReadTaskH_cb(struct rpmsg_endpoint *ept, void *data, size_t len,
+                 uint32_t src, void *priv)
+{
+    uint32_t *rxbuf, rxlen;
+    (void)src;
+    (void)priv;
+
+    rxbuf = ma35_bulk_recv(data, len, &rxlen);
+    if (!rxbuf)
+        return RPMSG_SUCCESS;
+
+    /* Start of user read function */
+    if (rxbuf[0] && rxbuf[0] != bulk_seq)
+        bulk_err++;
+    bulk_seq = rxbuf[0] + 1;
+    bulk_bytes += rxlen;
+    /* End of user read function */
+
+    /* Hand the block back, or keep it and release it later */
+    ma35_bulk_release(rxbuf);
+
+    return RPMSG_SUCCESS;
+}
+
 void vEndpointCreateTask(void *pvParameters)
 {
     struct rpmsg_device *rpdev = pvParameters;
@@ -526,14 +514,17 @@ void vCmdTask(void *pvParameters)
             case 's':
                 if (stattick)
                     sysprintf(
-                        "Statistics: %lu, %lu, %lu, %lu\n",
+                        "Statistics: %lu, %lu, %lu, %lu; "
+                        "Bulk: %lu, seq error: %d\n",
                         throughput[0] / stattick, throughput[1] / stattick,
-                        throughput[2] / stattick, throughput[3] / stattick);
+                        throughput[2] / stattick, throughput[3] / stattick,
+                        bulk_bytes / stattick, bulk_err);
                 break;
             case 'z':
                 stattick = 0;
                 throughput[0] = throughput[1] = throughput[2] = throughput[3] =
                     0;
+                bulk_bytes = bulk_err = 0;
                 sysprintf("Reset statistics.\n");
                 break;
             default:
@@ -558,6 +549,7 @@ int main(void)
     fflush(stdout);
 
     /* Initialize platform */
+    ma35_bulk_init();
     ret = platform_init(0, NULL, &platform);
     if (ret) {
         sysprintf("Failed to initialize platform.\r\n");
@@ -0,0 +1,142 @@
+/*************************************************************************//**
+ * @file     ma35_bulk.c
+ * @version  V1.00
+ * @brief    Bulk channel between the A35 cores
+ *           Payloads stay in a shared DDR pool; only a descriptor naming
+ *           the block goes over a rpmsg endpoint. Both cores are in one
+ *           coherent cluster, so barriers are enough to hand a block over.
+ *           A block used by a DMA master needs cache maintenance as usual.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2024 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+
+#include "platform_info.h"
+#include "rsc_table.h"
+#include "NuMicro.h"
+
+#define BULK_MAGIC    0x4B4C5542 // "BULK"
+#define BULK_HDR_SIZE 0x1000     // block states, ahead of the blocks
+#define BULK_FREE     0
+#define BULK_BUSY     1          // set by the sender, cleared by the receiver
+
+struct bulk_desc {
+    uint32_t magic;
+    uint32_t block;
+    uint32_t len;
+    uint32_t reserved;
+};
+
+static volatile uint32_t *const bulk_state =
+    (volatile uint32_t *)SHARED_BULK_POOL;
+static uint32_t bulk_next;
+
+static uint8_t *bulk_block(uint32_t dir, uint32_t i)
+{
+    return (uint8_t *)(SHARED_BULK_POOL + BULK_HDR_SIZE +
+                       ((u64)dir * BULK_BLOCK_NUM + i) * BULK_BLOCK_SIZE);
+}
+
+/* index into bulk_state, -1 if buf is no block */
+static int bulk_index(const void *buf)
+{
+    u64 offset = (u64)buf - (u64)bulk_block(0, 0);
+
+    if ((u64)buf < (u64)bulk_block(0, 0) ||
+        offset >= 2 * BULK_BLOCK_NUM * (u64)BULK_BLOCK_SIZE ||
+        offset % BULK_BLOCK_SIZE)
+        return -1;
+
+    return offset / BULK_BLOCK_SIZE;
+}
+
+void ma35_bulk_init(void)
+{
+    int i;
+
+    for (i = 0; i < BULK_BLOCK_NUM; i++)
+        bulk_state[BULK_TX_DIR * BULK_BLOCK_NUM + i] = BULK_FREE;
+    bulk_next = 0;
+    __DMB();
+}
+
+void *ma35_bulk_alloc(uint32_t *size)
+{
+    uint32_t i, id;
+    void *buf = NULL;
+
+    taskENTER_CRITICAL();
+    for (i = 0; i < BULK_BLOCK_NUM; i++) {
+        id = (bulk_next + i) % BULK_BLOCK_NUM;
+        if (bulk_state[BULK_TX_DIR * BULK_BLOCK_NUM + id] == BULK_FREE) {
+            bulk_state[BULK_TX_DIR * BULK_BLOCK_NUM + id] = BULK_BUSY;
+            bulk_next = id + 1;
+            buf = bulk_block(BULK_TX_DIR, id);
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    // see the data of the remote's last reads go before ours
+    __DMB();
+    if (buf && size)
+        *size = BULK_BLOCK_SIZE;
+
+    return buf;
+}
+
+int ma35_bulk_send(struct rpmsg_endpoint *ept, void *buf, uint32_t len)
+{
+    struct bulk_desc *desc;
+    int id, ret;
+
+    id = bulk_index(buf);
+    if (id < BULK_TX_DIR * BULK_BLOCK_NUM ||
+        id >= (BULK_TX_DIR + 1) * BULK_BLOCK_NUM || len > BULK_BLOCK_SIZE)
+        return RPMSG_ERR_PARAM;
+
+    // the descriptor is written straight into the shared tx buffer
+    ret = ma35_rpmsg_get_tx_buffer(ept, (void **)&desc);
+    if (ret < 0)
+        return ret;
+    if (ret < (int)sizeof(*desc))
+        return RPMSG_ERR_NO_MEM;
+
+    desc->magic = BULK_MAGIC;
+    desc->block = id % BULK_BLOCK_NUM;
+    desc->len = len;
+    desc->reserved = 0;
+    // payload must be visible before the remote can see the descriptor
+    __DMB();
+
+    ret = ma35_rpmsg_send_nocopy(ept, desc, sizeof(*desc));
+
+    return (ret < 0) ? ret : (int)len;
+}
+
+void *ma35_bulk_recv(const void *data, size_t len, uint32_t *size)
+{
+    const struct bulk_desc *desc = data;
+
+    if (!desc || len < sizeof(*desc) || desc->magic != BULK_MAGIC ||
+        desc->block >= BULK_BLOCK_NUM || desc->len > BULK_BLOCK_SIZE)
+        return NULL;
+
+    if (size)
+        *size = desc->len;
+    __DMB();
+
+    return bulk_block(!BULK_TX_DIR, desc->block);
+}
+
+void ma35_bulk_release(void *buf)
+{
+    int id = bulk_index(buf);
+
+    if (id < 0)
+        return;
+
+    // done with the data before the owner may reuse the block
+    __DMB();
+    bulk_state[id] = BULK_FREE;
+}
@@ -15,6 +15,7 @@
 #include <openamp/rpmsg.h>
 
 #include "FreeRTOS.h"
+#include "task.h"
 #include "queue.h"
 
 #if defined __cplusplus
@@ -71,16 +72,19 @@ struct rpmsg_endpoint_priv {
     // atomic_int kicked; // abort
     // void *rxbuf; // buffer copied from shared memory
     QueueHandle_t xQueue;
+    TaskHandle_t xDispatch; // runs the rx callback
     uint8_t cmd; // save CMD
     void *rxns;
     void **rxpool; // pre-allocated buffer pool
     int poolid;
+    int nocopy; // hand shared memory to the callback
+    void *held; // rx buffer kept by the user
 };
 
 struct rpmsg_endpoint_info {
     char name[32]; // Tx: name of local ept; Rx: name of remote ept to bind with
     u32 type;      // EPT_TYPE_TX or EPT_TYPE_RX
-    u32 size;      // Tx: request data length in byte; Rx: reserved
+    u32 size;      // Tx: request data length in byte; Rx: 0 or EPT_RX_NOCOPY
 };
 
 struct amp_endpoint {
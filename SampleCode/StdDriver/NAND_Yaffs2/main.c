@@ -144,6 +144,7 @@ int main(void)
                 cmd_yaffs_write_file(ptr, 0x55, 0x1000000);
                 etime = msTicks0 - btime;
                 sysprintf("write %d KB/sec\n", (0x1000000/1024)*1000/etime);
+                cmd_yaffs_sync(mtpoint);
             }
             break;
 
@@ -169,12 +170,14 @@ int main(void)
                     ptr++;
                     sysprintf("Remove dir %s ...\n\n", ptr);
                     cmd_yaffs_rmdir(ptr);
+                    cmd_yaffs_sync(mtpoint);
                 }
                 else
                 {
                     while (*ptr == ' ') ptr++;
                     sysprintf("Remove file %s ...\n\n", ptr);
                     cmd_yaffs_rm(ptr);
+                    cmd_yaffs_sync(mtpoint);
                 }
             }
             break;
@@ -189,10 +192,21 @@ int main(void)
                         i = *ptr++;
                     ptr++;
                     cmd_yaffs_mkdir(ptr);
+                    cmd_yaffs_sync(mtpoint);
                 }
             }
             break;
 
+        case 'b' :  /* bench */
+            cmd_nand_read_bench(1000, 64);
+            cmd_yaffs_small_write_bench(mtpoint, 200, 128);
+            cmd_yaffs_sync(mtpoint);
+            break;
+
+        case 's' :  /* sync */
+            cmd_yaffs_sync(mtpoint);
+            break;
+
         case '?':       /* Show usage */
             sysprintf("ls    <path>     - Show a directory. ex: ls user/test ('user' is mount point).\n");
             sysprintf("rd    <file name> - Read a file. ex: rd user/test.bin ('user' is mount point).\n");
@@ -200,6 +214,8 @@ int main(void)
             sysprintf("rm    <file name> - Delete a file. ex: rm user/test.bin ('user' is mount point).\n");
             sysprintf("mkdir <dir name> - Create a directory. ex: mkdir user/test ('user' is mount point).\n");
             sysprintf("rmdir <dir name> - Create a directory. ex: mkdir user/test ('user' is mount point).\n");
+            sysprintf("bench            - Raw NAND read speed and small-file write speed.\n");
+            sysprintf("sync             - Flush and write a checkpoint for a fast next mount.\n");
             sysprintf("\n");
         }
     }
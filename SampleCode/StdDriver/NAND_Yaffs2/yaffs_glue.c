@@ -36,11 +36,19 @@
 #include "malloc.h"
 #endif
 
+#ifdef YAFFS_GLUE_FREERTOS
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+static SemaphoreHandle_t yaffs_mutex;
+#endif
+
 unsigned yaffs_trace_mask = 0x0; /* Disable logging */
 static int yaffs_errno;
 
 
 extern void sysprintf(char * pcStr,...);
+extern uint32_t volatile msTicks0;
 void yaffs_bug_fn(const char *fn, int n)
 {
 	sysprintf("yaffs bug at %s:%d\n", fn, n);
@@ -76,10 +84,16 @@ int yaffsfs_GetError(void)
 
 void yaffsfs_Lock(void)
 {
+#ifdef YAFFS_GLUE_FREERTOS
+	xSemaphoreTake(yaffs_mutex, portMAX_DELAY);
+#endif
 }
 
 void yaffsfs_Unlock(void)
 {
+#ifdef YAFFS_GLUE_FREERTOS
+	xSemaphoreGive(yaffs_mutex);
+#endif
 }
 
 __u32 yaffsfs_CurrentTime(void)
@@ -97,9 +111,13 @@ __u32 yaffsfs_CurrentTime(void)
 //	free(ptr);
 //}
 
-void yaffsfs_LocalInitialisation(void)
+void yaffsfs_OSInitialisation(void)
 {
-	/* No locking used */
+#ifdef YAFFS_GLUE_FREERTOS
+	/* Serialises all yaffs calls between tasks */
+	if (!yaffs_mutex)
+		yaffs_mutex = xSemaphoreCreateMutex();
+#endif
 }
 
 /*
@@ -190,6 +208,9 @@ int cmd_yaffs_devconfig(char *_mp, int flash_dev,
 	char *mp = NULL;
 	struct nand_chip *chip;
 
+	/* Before the first yaffs call that takes the lock */
+	yaffsfs_OSInitialisation();
+
 //	dev = calloc(1, sizeof(*dev));
 //	mp = strdup(_mp);
 	dev = yaffs_malloc(sizeof(*dev));
@@ -254,7 +275,13 @@ int cmd_yaffs_devconfig(char *_mp, int flash_dev,
 	dev->param.n_reserved_blocks = 5;
 	if (chip->ecc.layout->oobavail <= sizeof(struct yaffs_packed_tags2))
 		dev->param.inband_tags = 1;
-	dev->param.n_caches = 10;
+	dev->param.n_caches = YAFFS_GLUE_N_CACHES;
+	dev->param.cache_bypass_aligned = 1;
+	/* Mount reads the checkpoint left by sync or unmount, else scans
+	 * the summary chunk of each block instead of every chunk's tags */
+	dev->param.skip_checkpt_rd = !YAFFS_GLUE_CHECKPOINT;
+	dev->param.skip_checkpt_wr = !YAFFS_GLUE_CHECKPOINT;
+	dev->param.disable_summary = !YAFFS_GLUE_SUMMARY;
     dev->tagger.write_chunk_tags_fn = nandmtd2_write_chunk_tags;
     dev->tagger.read_chunk_tags_fn = nandmtd2_read_chunk_tags;
     dev->drv.drv_erase_fn = nandmtd_EraseBlockInNAND;
@@ -366,10 +393,30 @@ int read_a_file(char *fn)
 
 int cmd_yaffs_mount(char *mp)
 {
+	struct yaffs_dev *dev;
+	uint32_t btime = msTicks0;
 	int retval = yaffs_mount(mp);
-	if (retval < 0)
+
+	if (retval < 0) {
 		sysprintf("Error mounting %s, return value: %d, %s\n", mp,
 			yaffsfs_GetError(), yaffs_error_str());
+		return retval;
+	}
+
+	dev = yaffs_getdev(mp);
+	sysprintf("Mounted %s in %d ms from %s\n", mp, msTicks0 - btime,
+		(dev && dev->is_checkpointed) ? "checkpoint" : "scan");
+	return retval;
+}
+
+/* Flushes the caches and writes a checkpoint so the next mount skips the scan */
+int cmd_yaffs_sync(char *mp)
+{
+	int retval = yaffs_sync(mp);
+
+	if (retval < 0)
+		sysprintf("Error syncing %s, return value: %d, %s\n", mp,
+			yaffsfs_GetError(), yaffs_error_str());
 	return retval;
 }
 
@@ -565,3 +612,103 @@ int cmd_yaffs_mv(const char *oldPath, const char *newPath)
 
 	return 0;
 }
+
+/*
+ * Raw read speed of the NAND below yaffs: the same blocks read one page per
+ * mtd_read() call, as yaffs reads chunks, and one block per call, which the
+ * NFI driver runs as one cache read sequence.
+ */
+static u8 nand_bench_buf[512 * 1024] __attribute__((aligned(64)));
+
+static int nand_bench_pass(struct mtd_info *mtd, int start_block, int blocks, size_t len)
+{
+	loff_t offs;
+	size_t retlen;
+	uint32_t btime, bytes = 0;
+	int i, ret;
+
+	btime = msTicks0;
+	for (i = start_block; i < start_block + blocks; i++) {
+		offs = (loff_t)i * mtd->erasesize;
+		if (mtd_block_isbad(mtd, offs))
+			continue;
+		for (; offs < (loff_t)(i + 1) * mtd->erasesize; offs += len) {
+			ret = mtd_read(mtd, offs, len, &retlen, nand_bench_buf);
+			if (ret < 0 && ret != -EUCLEAN && ret != -EBADMSG) {
+				sysprintf("mtd_read at 0x%x returned %d\n", (unsigned int)offs, ret);
+				return -1;
+			}
+			bytes += len;
+		}
+	}
+	return (int)((bytes / 1024) * 1000 / (msTicks0 - btime + 1));
+}
+
+int cmd_nand_read_bench(int start_block, int blocks)
+{
+	struct mtd_info *mtd = get_nand_dev_by_index(0);
+	int page, block;
+
+	if (!mtd) {
+		sysprintf("Flash device invalid\n");
+		return -1;
+	}
+	if (mtd->erasesize > sizeof(nand_bench_buf)) {
+		sysprintf("Block of %d bytes does not fit the buffer\n", mtd->erasesize);
+		return -1;
+	}
+
+	page = nand_bench_pass(mtd, start_block, blocks, mtd->writesize);
+	block = nand_bench_pass(mtd, start_block, blocks, mtd->erasesize);
+	if (page < 0 || block < 0)
+		return -1;
+
+	sysprintf("blocks %d..%d: page reads %d KB/sec, block reads %d KB/sec\n",
+		start_block, start_block + blocks - 1, page, block);
+	return 0;
+}
+
+/*
+ * Small-write speed: count files of size bytes created, written and closed
+ * in dir, then the sync that writes them out of the short-op cache.
+ */
+int cmd_yaffs_small_write_bench(const char *dir, int count, int size)
+{
+	char fn[64];
+	u8 buf[256];
+	uint32_t btime, wtime, stime;
+	int i, h, retval = 0;
+
+	if (size > (int)sizeof(buf))
+		size = sizeof(buf);
+	memset(buf, 0x5a, size);
+
+	btime = msTicks0;
+	for (i = 0; i < count; i++) {
+		sprintf(fn, "%s/sw%04d", dir, i);
+		h = yaffs_open(fn, O_CREAT | O_RDWR | O_TRUNC, S_IREAD | S_IWRITE);
+		if (h < 0) {
+			sysprintf("Error opening file: %d. %s\n", h, yaffs_error_str());
+			count = i;
+			retval = -1;
+			break;
+		}
+		if (yaffs_write(h, buf, size) != size)
+			retval = -1;
+		yaffs_close(h);
+	}
+	wtime = msTicks0 - btime;
+
+	btime = msTicks0;
+	yaffs_sync(dir);
+	stime = msTicks0 - btime;
+
+	for (i = 0; i < count; i++) {
+		sprintf(fn, "%s/sw%04d", dir, i);
+		yaffs_unlink(fn);
+	}
+
+	sysprintf("%d files of %d bytes: %d files/sec, sync %d ms\n",
+		count, size, count * 1000 / (wtime + 1), stime);
+	return retval;
+}
@@ -2,6 +2,21 @@
 #ifndef __YAFFS_UBOOT_GLUE_H__
 #define __YAFFS_UBOOT_GLUE_H__
 
+/* Short-op cache entries, one chunk each from the yaffs memory pool in DDR */
+#ifndef YAFFS_GLUE_N_CACHES
+#define YAFFS_GLUE_N_CACHES	YAFFS_MAX_SHORT_OP_CACHES
+#endif
+
+/* Checkpoint and block summaries for fast mount */
+#ifndef YAFFS_GLUE_CHECKPOINT
+#define YAFFS_GLUE_CHECKPOINT	1
+#endif
+#ifndef YAFFS_GLUE_SUMMARY
+#define YAFFS_GLUE_SUMMARY	1
+#endif
+
+/* Define YAFFS_GLUE_FREERTOS to lock yaffs with a FreeRTOS mutex */
+
 
 int cmd_yaffs_dev_ls(void);
 int cmd_yaffs_tracemask(unsigned set, unsigned mask);
@@ -9,6 +24,7 @@ int cmd_yaffs_devconfig(char *mp, int flash_dev,
 				int start_block, int end_block);
 int cmd_yaffs_mount(char *mp);
 int cmd_yaffs_umount(char *mp);
+int cmd_yaffs_sync(char *mp);
 int cmd_yaffs_read_file(char *fn);
 int cmd_yaffs_write_file(char *fn, char bval, int sizeOfFile);
 int cmd_yaffs_ls(const char *mountpt, int longlist);
@@ -21,4 +37,6 @@ int cmd_yaffs_rm(const char *path);
 int cmd_yaffs_mv(const char *oldPath, const char *newPath);
 
 int yaffs_dump_dev(const char *path);
+int cmd_nand_read_bench(int start_block, int blocks);
+int cmd_yaffs_small_write_bench(const char *dir, int count, int size);
 #endif
@@ -0,0 +1,289 @@
+/**************************************************************************//**
+ * @file     jpeg_svc.c
+ * @brief    JPEG slideshow service. Reads the next JPEG file ahead into
+ *           the input buffer while the current image is on screen, decodes
+ *           it into the off-screen frame buffer and flips the display on
+ *           vsync.
+ *
+ *           File reads and VC8000 decodes both block, so the input buffer
+ *           is free again as soon as a decode returns and one buffer is
+ *           all the read-ahead needs. The display side is double-buffered.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "ff.h"
+#include "displib.h"
+#include "vc8000_lib.h"
+#include "jpeg_svc.h"
+
+typedef struct
+{
+    uint8_t          *buff;     /* non-cacheable view of the input buffer */
+    uint32_t         len;       /* valid bytes; 0 means free              */
+    JPEG_SVC_STAT_T  stat;
+} JPEG_INBUF_T;
+
+static uint8_t  _InBuff[JPEG_SVC_INBUF_SIZE] __attribute__((aligned(32)));
+
+static JPEG_INBUF_T      _in;
+static struct pp_params  *_pp;
+static uint32_t          _fb[2];
+static uint32_t          _fb_back;               /* index of the off-screen frame buffer */
+
+static uint32_t jsvc_us(uint64_t t0)
+{
+    return (uint32_t)((EL0_GetCurrentPhysicalValue() - t0) * 1000000 / raw_read_cntfrq_el0());
+}
+
+/*
+ *  Walk the JPEG marker segments up to SOS and pick the frame size
+ *  from the SOFn segment. Returns 0 on success and -1 on a malformed
+ *  stream. Returns 1 if the first len bytes end before the SOFn fields;
+ *  *need is then the file size the walk needs to go on.
+ */
+static int jsvc_parse_header(uint8_t *p, uint32_t len, uint16_t *w, uint16_t *h, uint32_t *need)
+{
+    uint32_t  i, seg_len;
+    uint8_t   marker;
+
+    *need = 4;
+    if (len < 4)
+        return 1;
+    if ((p[0] != 0xFF) || (p[1] != 0xD8))
+        return -1;
+
+    i = 2;
+    while (1)
+    {
+        if (i + 4 > len)
+        {
+            *need = i + 4;
+            return 1;
+        }
+        if (p[i] != 0xFF)
+            return -1;
+        marker = p[i + 1];
+        if (marker == 0xFF)              /* fill byte */
+        {
+            i++;
+            continue;
+        }
+        seg_len = ((uint32_t)p[i + 2] << 8) | p[i + 3];
+        if (seg_len < 2)
+            return -1;
+
+        /* SOF0..SOF15, excluding DHT (C4), JPG (C8) and DAC (CC) */
+        if ((marker >= 0xC0) && (marker <= 0xCF) &&
+            (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC))
+        {
+            if (i + 9 > len)
+            {
+                *need = i + 9;
+                return 1;
+            }
+            *h = ((uint16_t)p[i + 5] << 8) | p[i + 6];
+            *w = ((uint16_t)p[i + 7] << 8) | p[i + 8];
+            return ((*w == 0) || (*h == 0)) ? -1 : 0;
+        }
+        if (marker == 0xDA)              /* SOS reached without SOFn */
+            return -1;
+        i += 2 + seg_len;
+    }
+}
+
+/**
+ *  @brief  Initialize the JPEG service.
+ *  @param[in]  pp    PP parameters. pp_out_dst is forced to user buffer.
+ *  @param[in]  fb0   Physical address of frame buffer 0 (on screen first)
+ *  @param[in]  fb1   Physical address of frame buffer 1
+ *  @return  JPEG_SVC_OK
+ */
+int JpegSvc_Init(struct pp_params *pp, uint32_t fb0, uint32_t fb1)
+{
+    _in.buff = nc_ptr(_InBuff);
+    _in.len = 0;
+
+    _pp = pp;
+    _pp->pp_out_dst = VC8000_PP_OUT_DST_USER;
+    _fb[0] = fb0;
+    _fb[1] = fb1;
+    _fb_back = 1;
+    DISPLIB_SetFBAddr(_fb[0]);
+    return JPEG_SVC_OK;
+}
+
+/**
+ *  @brief  Read a JPEG file into the input buffer, which must be free.
+ *          The header is read first so that non-JPEG or oversized
+ *          files are rejected before the whole file is transferred.
+ *  @param[in]  fname   File path
+ *  @param[in]  fsize   File size reported by f_readdir()
+ *  @return  JPEG_SVC_OK or a negative JPEG_SVC_ERR_* code
+ */
+int JpegSvc_Prefetch(char *fname, uint32_t fsize)
+{
+    FIL          hfile, *pFile;
+    JPEG_INBUF_T *in = &_in;
+    uint32_t     avail, need, count;
+    uint64_t     t0;
+    int          ret;
+
+    if (in->len != 0)
+        return JPEG_SVC_ERR_BUSY;
+    if (fsize > JPEG_SVC_INBUF_SIZE)
+        return JPEG_SVC_ERR_TOO_LARGE;
+
+    t0 = EL0_GetCurrentPhysicalValue();
+
+    pFile = nc_ptr(&hfile);   /* make FIL->buff be non-cache */
+    ret = f_open(pFile, fname, FA_OPEN_EXISTING | FA_READ);
+    if (ret != 0)
+    {
+        sysprintf("Failed to open JPEG file <%s>! (%d)\n", fname, ret);
+        return JPEG_SVC_ERR_FILE;
+    }
+
+    /*
+     *  Read forward a peek window at a time until the walk reaches SOFn.
+     *  Segments before it, such as an EXIF APP1 with a thumbnail, can be
+     *  far larger than one window. Everything read stays in the buffer.
+     */
+    avail = 0;
+    need = JPEG_SVC_HDR_PEEK_SIZE;
+    while (1)
+    {
+        if (need < avail + JPEG_SVC_HDR_PEEK_SIZE)
+            need = avail + JPEG_SVC_HDR_PEEK_SIZE;
+        if (need > fsize)
+            need = fsize;
+
+        ret = f_read(pFile, in->buff + avail, need - avail, (UINT *)&count);
+        if ((ret != 0) || (count != need - avail))
+        {
+            sysprintf("Failed to read JPEG header <%s>! (%d)\n", fname, ret);
+            f_close(pFile);
+            return JPEG_SVC_ERR_FILE;
+        }
+        avail = need;
+
+        ret = jsvc_parse_header(in->buff, avail, &in->stat.width, &in->stat.height, &need);
+        if (ret == 0)
+            break;
+        if ((ret < 0) || (avail == fsize))
+        {
+            sysprintf("<%s> has no valid JPEG frame header!\n", fname);
+            f_close(pFile);
+            return JPEG_SVC_ERR_HEADER;
+        }
+    }
+
+    if (fsize > avail)
+    {
+        ret = f_read(pFile, in->buff + avail, fsize - avail, (UINT *)&count);
+        if ((ret != 0) || (count != fsize - avail))
+        {
+            sysprintf("Failed to read the whole JPEG file! (%d / %d)\n", count + avail, fsize);
+            f_close(pFile);
+            return JPEG_SVC_ERR_FILE;
+        }
+    }
+    f_close(pFile);
+
+    in->stat.file_size = fsize;
+    in->stat.read_us = jsvc_us(t0);
+    in->stat.decode_us = 0;
+    in->stat.present_us = 0;
+    in->len = fsize;
+    return JPEG_SVC_OK;
+}
+
+/**
+ *  @brief  Decode the prefetched image into the off-screen frame buffer,
+ *          then make it visible on the next vsync. The input buffer is
+ *          free for the next JpegSvc_Prefetch() on return.
+ *  @param[out]  stat   Per-image statistics. Can be NULL.
+ *  @return  JPEG_SVC_OK or a negative JPEG_SVC_ERR_* code
+ */
+int JpegSvc_DecodeAndPresent(JPEG_SVC_STAT_T *stat)
+{
+    JPEG_INBUF_T *in = &_in;
+    uint32_t     frame_cnt;
+    uint64_t     t0;
+    int          handle, ret;
+
+    if (in->len == 0)
+        return JPEG_SVC_ERR_EMPTY;
+
+    t0 = EL0_GetCurrentPhysicalValue();
+
+    handle = VC8000_JPEG_Open_Instance();
+    if (handle < 0)
+    {
+        sysprintf("VC8000_JPEG_Open_Instance failed! (%d)\n", handle);
+        ret = JPEG_SVC_ERR_DECODE;
+        goto out;
+    }
+
+    _pp->pp_out_paddr = _fb[_fb_back];
+    ret = VC8000_JPEG_Enable_PP(handle, _pp);
+    if (ret < 0)
+    {
+        sysprintf("VC8000_JPEG_Enable_PP failed! (%d)\n", ret);
+        VC8000_JPEG_Close_Instance(handle);
+        ret = JPEG_SVC_ERR_DECODE;
+        goto out;
+    }
+
+    ret = VC8000_JPEG_Decode_Run(handle, in->buff, in->len, NULL);
+    VC8000_JPEG_Close_Instance(handle);
+    if (ret != 0)
+    {
+        sysprintf("VC8000_JPEG_Decode_Run error: %d\n", ret);
+        ret = JPEG_SVC_ERR_DECODE;
+        goto out;
+    }
+    in->stat.decode_us = jsvc_us(t0);
+
+    /*
+     *  The frame buffer address register is latched by DCU on vsync.
+     *  Wait for the frame counter to advance so that the old front
+     *  buffer is known to be released before it is decoded into again.
+     */
+    t0 = EL0_GetCurrentPhysicalValue();
+    DISPLIB_SetFBAddr(_fb[_fb_back]);
+    frame_cnt = DISPLIB_GetFrameCounter();
+    while (DISPLIB_GetFrameCounter() == frame_cnt)
+    {
+        if (jsvc_us(t0) > 100000)    /* no vsync within 100 ms, do not hang */
+            break;
+    }
+    in->stat.present_us = jsvc_us(t0);
+    _fb_back ^= 1;
+    ret = JPEG_SVC_OK;
+
+out:
+    if (stat != NULL)
+        *stat = in->stat;
+    in->len = 0;
+    return ret;
+}
+
+/**
+ *  @brief  Number of prefetched images waiting for decode, 0 or 1.
+ */
+int JpegSvc_PendingCount(void)
+{
+    return (_in.len != 0) ? 1 : 0;
+}
+
+/**
+ *  @brief  Drop all prefetched images, e.g. on media removal.
+ */
+void JpegSvc_Flush(void)
+{
+    _in.len = 0;
+}
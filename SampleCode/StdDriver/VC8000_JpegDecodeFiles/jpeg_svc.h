@@ -0,0 +1,47 @@
+/**************************************************************************//**
+ * @file     jpeg_svc.h
+ * @brief    JPEG slideshow service. Reads the next JPEG file ahead into
+ *           the input buffer while the current image is on screen, decodes
+ *           it into the off-screen frame buffer and flips the display on
+ *           vsync.
+ *
+ *           File reads and VC8000 decodes both block, so the input buffer
+ *           is free again as soon as a decode returns and one buffer is
+ *           all the read-ahead needs. The display side is double-buffered.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __JPEG_SVC_H__
+#define __JPEG_SVC_H__
+
+#include <stdint.h>
+#include "vc8000_lib.h"
+
+#define JPEG_SVC_INBUF_SIZE       0x800000    /* 8 MB input buffer, the file size limit */
+#define JPEG_SVC_HDR_PEEK_SIZE    0x1000      /* bytes read per step to parse the header  */
+
+#define JPEG_SVC_OK               0
+#define JPEG_SVC_ERR_BUSY         -1          /* input buffer not decoded yet         */
+#define JPEG_SVC_ERR_FILE         -2          /* FatFs open/read failed               */
+#define JPEG_SVC_ERR_HEADER       -3          /* not a baseline/progressive JFIF file */
+#define JPEG_SVC_ERR_TOO_LARGE    -4          /* file does not fit in the input buffer */
+#define JPEG_SVC_ERR_EMPTY        -5          /* no prefetched image to decode        */
+#define JPEG_SVC_ERR_DECODE       -6          /* VC8000 returned an error             */
+
+typedef struct
+{
+    uint32_t  file_size;        /* JPEG file size in bytes                        */
+    uint16_t  width;            /* image width parsed from SOFn                    */
+    uint16_t  height;           /* image height parsed from SOFn                   */
+    uint32_t  read_us;          /* time spent in f_open/f_read                     */
+    uint32_t  decode_us;        /* time spent in VC8000_JPEG_Decode_Run            */
+    uint32_t  present_us;       /* time from decode done until the flip took place */
+} JPEG_SVC_STAT_T;
+
+int  JpegSvc_Init(struct pp_params *pp, uint32_t fb0, uint32_t fb1);
+int  JpegSvc_Prefetch(char *fname, uint32_t fsize);
+int  JpegSvc_DecodeAndPresent(JPEG_SVC_STAT_T *stat);
+int  JpegSvc_PendingCount(void);
+void JpegSvc_Flush(void);
+
+#endif /* __JPEG_SVC_H__ */
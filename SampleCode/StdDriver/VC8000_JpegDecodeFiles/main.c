@@ -15,15 +15,15 @@
 #include "diskio.h"
 #include "displib.h"
 #include "vc8000_lib.h"
+#include "jpeg_svc.h"
 
-#define MAX_FILE_SIZE   0x800000
+#define SLIDE_DWELL_MS  1000     /* time each image stays on screen */
 
 #define LCD_WIDTH       1024
 #define LCD_HEIGHT      600
 
 uint8_t  _DisplayBuff[LCD_WIDTH * LCD_HEIGHT * 4 * 4] __attribute__((aligned(32)));  /* 1024 x 600 RGB888 */
 uint8_t  _VC8000Buff[0x2000000] __attribute__((aligned(32)));  /* 32 MB */
-uint8_t  _FileBuff[0x2000000] __attribute__((aligned(32)));  /* 32 MB */
 
 static  struct pp_params _pp;
 
@@ -64,27 +64,35 @@ void start_timer(void)
 	_start_time = EL0_GetCurrentPhysicalValue();
 }
 
+/* Generic timer ticks per millisecond, from CNTFRQ set up by the boot code */
+static uint64_t ticks_per_ms(void)
+{
+	return raw_read_cntfrq_el0() / 1000;
+}
+
 uint32_t get_ticks(void)
 {
 	uint64_t   t_off;
 	t_off = EL0_GetCurrentPhysicalValue() - _start_time;
-	t_off = t_off / 12000;
+	t_off = t_off / ticks_per_ms();
 	return (uint32_t)t_off;
 }
 
 /* This function is necessary for USB Host library. */
 void delay_us(int usec)
 {
-	uint64_t   t0;
+	uint64_t   t0, ticks;
 	t0  = EL0_GetCurrentPhysicalValue();
-	while ((EL0_GetCurrentPhysicalValue() - t0) < (usec * 12));
+	ticks = (uint64_t)usec * ticks_per_ms() / 1000;
+	while ((EL0_GetCurrentPhysicalValue() - t0) < ticks);
 }
 
 void delay_ms(int msec)
 {
-	uint64_t   t0;
+	uint64_t   t0, ticks;
 	t0  = EL0_GetCurrentPhysicalValue();
-	while ((EL0_GetCurrentPhysicalValue() - t0) < (msec * 12000));
+	ticks = (uint64_t)msec * ticks_per_ms();
+	while ((EL0_GetCurrentPhysicalValue() - t0) < ticks);
 }
 
 void DISP_Open(void)
@@ -207,107 +215,89 @@ static int is_jpeg_file(char *fname)
 	return 0;
 }
 
-int do_jpeg_decode(char *fname, uint32_t fsize)
+/*
+ *  Scan the directory for the next JPEG file and prefetch it into the
+ *  JPEG service input buffer. Returns 0 if an image was queued, -1 when
+ *  the end of directory is reached.
+ */
+static int prefetch_next_jpeg(DIR *dir, char *path)
 {
-	FIL   hfile, *pFile;
-	int   handle, count, ret;
-
-	pFile = nc_ptr(&hfile);   /* make FIL->buff be non-cache */
-	/*
-	 *  Read JPEG file to _FileBuff
-	 */
-	ret = f_open(pFile, fname, FA_OPEN_EXISTING | FA_READ);
-	if (ret != 0)
-	{
-		sysprintf("Failed to open JPEG file <%s>! (%d)\n", fname, ret);
-		return -1;
-	}
-	ret = f_read(pFile, nc_ptr(_FileBuff), fsize, &count);
-	if (ret != 0)
-	{
-		sysprintf("Failed to read JPEG file <%s>! (%d)\n", fname, ret);
-		return -1;
-	}
-	if (count != fsize)
-	{
-		sysprintf("Failed to read the whole JPEG file! (%d / %d)\n", count, fsize);
-		return -1;
-	}
-	f_close(pFile);
+	FILINFO   Finfo;
+	FRESULT   res;
+	char      fname[256];
 
-	handle = VC8000_JPEG_Open_Instance();
-	if (handle < 0)
+	while (1)
 	{
-		sysprintf("VC8000_JPEG_Open_Instance failed! (%d)\n", handle);
-		return -1;
-	}
+		res = f_readdir(dir, &Finfo);
+		if ((res != FR_OK) || !Finfo.fname[0])
+			return -1;
 
-	ret = VC8000_JPEG_Enable_PP(handle, &_pp);
-	if (ret < 0)
-	{
-		sysprintf("VC8000_JPEG_Enable_PP failed! (%d)\n", ret);
-		goto err_out;
-	}
+		sysprintf("%c%c%c%c%c %d/%02d/%02d %02d:%02d    %9d  %s",
+			   (Finfo.fattrib & AM_DIR) ? 'D' : '-',
+			   (Finfo.fattrib & AM_RDO) ? 'R' : '-',
+			   (Finfo.fattrib & AM_HID) ? 'H' : '-',
+			   (Finfo.fattrib & AM_SYS) ? 'S' : '-',
+			   (Finfo.fattrib & AM_ARC) ? 'A' : '-',
+			   (Finfo.fdate >> 9) + 1980, (Finfo.fdate >> 5) & 15, Finfo.fdate & 31,
+			   (Finfo.ftime >> 11), (Finfo.ftime >> 5) & 63, Finfo.fsize, Finfo.fname);
+		sysprintf("\n");
 
-	ret = VC8000_JPEG_Decode_Run(handle, nc_ptr(_FileBuff), fsize, NULL);
-	if (ret != 0)
-	{
-		sysprintf("VC8000_H264_Decode_Run error: %d\n", ret);
-		goto err_out;
-	}
-	VC8000_JPEG_Close_Instance(handle);
-	return 0;
+		if (!is_jpeg_file(Finfo.fname) || !(Finfo.fattrib & AM_ARC))
+			continue;
+
+		if (Finfo.fsize > JPEG_SVC_INBUF_SIZE)
+		{
+			sysprintf("Skip <%s>, larger than input buffer (%d bytes).\n", Finfo.fname, JPEG_SVC_INBUF_SIZE);
+			continue;
+		}
 
-err_out:
-	VC8000_JPEG_Close_Instance(handle);
-	return -1;
+		strcpy(fname, path);
+		strcat(fname, "/");
+		strcat(fname, Finfo.fname);
+		if (JpegSvc_Prefetch(fname, Finfo.fsize) == JPEG_SVC_OK)
+			return 0;
+	}
 }
 
+/*
+ *  Slideshow pipeline: image N is decoded, which frees the input buffer,
+ *  and flipped on screen. While it stays there, image N+1 is read into the
+ *  input buffer, so the file read is hidden in the dwell time. Image N+1
+ *  is decoded into the off-screen frame buffer as soon as the dwell time
+ *  of image N expires.
+ */
 int jpeg_decode_files(char *path)
 {
-	FILINFO   Finfo;
 	DIR       dir;
-	FRESULT   res;
+	JPEG_SVC_STAT_T  stat;
+	uint64_t  t0, dwell;
 	int       jpeg_found = 0;
-	char      fname[256];
 
 	sysprintf("\n\nJPEG_playback on directory %s ==> \n", path);
 
-	res = f_opendir(&dir, path);
-	if (res)
+	if (f_opendir(&dir, path))
 	{
 		sysprintf("f_opendir failed!\n");
 		return -1;
 	}
 
-	while (1)
-	{
-		res = f_readdir(&dir, &Finfo);
-		if ((res != FR_OK) || !Finfo.fname[0])
-			break;
-
-		sysprintf("%c%c%c%c%c %d/%02d/%02d %02d:%02d    %9d  %s",
-			   (Finfo.fattrib & AM_DIR) ? 'D' : '-',
-			   (Finfo.fattrib & AM_RDO) ? 'R' : '-',
-			   (Finfo.fattrib & AM_HID) ? 'H' : '-',
-			   (Finfo.fattrib & AM_SYS) ? 'S' : '-',
-			   (Finfo.fattrib & AM_ARC) ? 'A' : '-',
-			   (Finfo.fdate >> 9) + 1980, (Finfo.fdate >> 5) & 15, Finfo.fdate & 31,
-			   (Finfo.ftime >> 11), (Finfo.ftime >> 5) & 63, Finfo.fsize, Finfo.fname);
-		sysprintf("\n");
+	dwell = (uint64_t)SLIDE_DWELL_MS * ticks_per_ms();
+	JpegSvc_Flush();
+	prefetch_next_jpeg(&dir, path);
 
-		if (is_jpeg_file(Finfo.fname) && (Finfo.fattrib & AM_ARC))
+	while (JpegSvc_PendingCount() > 0)
+	{
+		if (JpegSvc_DecodeAndPresent(&stat) == JPEG_SVC_OK)
 		{
-			if (Finfo.fsize <= MAX_FILE_SIZE)
-			{
-				jpeg_found = 1;
-				strcpy(fname, path);
-				strcat(fname, "/");
-				strcat(fname, Finfo.fname);
-				do_jpeg_decode(fname, Finfo.fsize);
-				delay_us(1000000);
-			}
+			jpeg_found = 1;
+			sysprintf("  %dx%d, %d bytes: read %d us, decode %d us, present %d us\n",
+					  stat.width, stat.height, stat.file_size,
+					  stat.read_us, stat.decode_us, stat.present_us);
 		}
+
+		t0 = EL0_GetCurrentPhysicalValue();
+		prefetch_next_jpeg(&dir, path);
+		while ((EL0_GetCurrentPhysicalValue() - t0) < dwell);
 	}
 	f_closedir(&dir);
 	if (!jpeg_found)
@@ -387,13 +377,17 @@ int32_t main(void)
 	_pp.img_out_h = LCD_HEIGHT;
 	_pp.img_out_fmt = VC8000_PP_F_RGB888;
 	_pp.rotation = VC8000_PP_ROTATION_NONE;
-	_pp.pp_out_dst = VC8000_PP_OUT_DST_DISPLAY;
+	_pp.pp_out_dst = VC8000_PP_OUT_DST_USER;
     _pp.contrast = 8;
     _pp.brightness = 0;
     _pp.saturation = 32;
     _pp.alpha = 255;
     _pp.transparency = 0;
 
+	/* Use the first two frames of _DisplayBuff as front/back buffers */
+	JpegSvc_Init(&_pp, ptr_to_u32(_DisplayBuff),
+				 ptr_to_u32(_DisplayBuff) + LCD_WIDTH * LCD_HEIGHT * 4);
+
 	while (1)
 		jpeg_decode_files(usb_path);
 }
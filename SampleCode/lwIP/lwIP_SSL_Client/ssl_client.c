@@ -61,6 +61,20 @@
 #include "mbedtls/ssl_cache.h"
 #endif
 
+#if NU_TLS_ACCEL
+#include "tsi_cmd.h"
+#endif
+
+#if defined(MBEDTLS_ENTROPY_HARDWARE_ALT)
+#include "semphr.h"
+#include "entropy_alt.h"
+
+/* The TRNG pool fill task runs below the SSL task */
+#define TRNG_THREAD_PRIO         ( tskIDLE_PRIORITY + 1UL )
+#define TRNG_THREAD_STACKSIZE    512
+#define TRNG_FILL_PERIOD_MS      50
+#endif
+
 #define SERVER_PORT "443"
 #define SERVER_NAME "192.168.1.2"
 #define HOST_NAME "localhost"
@@ -71,6 +85,25 @@
 #define SSLCLIENT_THREAD_PRIO    ( tskIDLE_PRIORITY + 2UL )
 #define SSLCLIENT_THREAD_STACKSIZE  2048
 
+/*
+ * After the GET request, measure against the same server:
+ *  - BENCH_HANDSHAKES connections with a full handshake
+ *  - BENCH_HANDSHAKES connections resuming the session of the last one
+ *  - one resumed connection reading BENCH_BULK_BYTES
+ * Every connection sends "GET /<bytes>", which lwIP_SSL_Server answers with
+ * that many bytes after its page. Build both boards with NU_TLS_ACCEL 1 and
+ * then 0 (mbedtls_config.h) to compare the profiles, and the server with
+ * SSL_SERVER_TRACE 0.
+ */
+#define SSL_CLIENT_BENCH        1
+#define BENCH_HANDSHAKES        20
+#define BENCH_BULK_BYTES        ( 4 * 1024 * 1024 )
+#define BENCH_CHUNK             16384
+
+#if defined(MBEDTLS_ENTROPY_HARDWARE_ALT)
+int mbedtls_hardware_poll( void *data, unsigned char *output, size_t len, size_t *olen );
+#endif
+
 #if defined(MBEDTLS_CHECK_PARAMS)
 #include "mbedtls/platform_util.h"
 void mbedtls_param_failed( const char *failure_condition,
@@ -83,6 +116,60 @@ void mbedtls_param_failed( const char *failure_condition,
 }
 #endif
 
+#if defined(MBEDTLS_ENTROPY_HARDWARE_ALT)
+/*
+ * The entropy pool is filled by a task of its own, so two tasks now issue
+ * TSI commands. The TSI driver takes this mutex around each command.
+ */
+static SemaphoreHandle_t tsi_mutex;
+
+static void tsi_lock( void )
+{
+    xSemaphoreTake( tsi_mutex, portMAX_DELAY );
+}
+
+static void tsi_unlock( void )
+{
+    xSemaphoreGive( tsi_mutex );
+}
+
+/* Tops the pool up while the SSL task waits on the network, so seeding and
+ * reseeding during a handshake only copies from it */
+static void trng_fill_task( void *arg )
+{
+    NU_TRNG_POOL_STAT_T stat;
+    ( void ) arg;
+
+    for( ;; )
+    {
+        if( nu_trng_pool_fill( 0 ) < 0 )
+        {
+            nu_trng_pool_stat( &stat, 0 );
+            mbedtls_printf( "  ! TRNG pool fill failed: %u errors, last 0x%x\n",
+                            (unsigned) stat.error_count, (unsigned) stat.last_error );
+            vTaskDelay( pdMS_TO_TICKS( 1000 ) );
+        }
+        vTaskDelay( pdMS_TO_TICKS( TRNG_FILL_PERIOD_MS ) );
+    }
+}
+
+/* Call after the DRBG is seeded, which has initialised the TRNG */
+static int trng_fill_start( void )
+{
+    tsi_mutex = xSemaphoreCreateMutex();
+    if( tsi_mutex == NULL )
+        return( -1 );
+
+    TSI_Set_Lock( tsi_lock, tsi_unlock );
+
+    if( xTaskCreate( trng_fill_task, "TrngFill", TRNG_THREAD_STACKSIZE, NULL,
+                     TRNG_THREAD_PRIO, NULL ) != pdPASS )
+        return( -1 );
+
+    return( 0 );
+}
+#endif /* MBEDTLS_ENTROPY_HARDWARE_ALT */
+
 static void my_debug( void *ctx, int level,
                       const char *file, int line,
                       const char *str )
@@ -114,6 +201,18 @@ static void *mbedtls_calloc_wrapper( size_t n, size_t size )
 
 static int custom_entropy_poll( void *data, unsigned char *output, size_t len )
 {
+#if defined(MBEDTLS_ENTROPY_HARDWARE_ALT)
+    size_t olen;
+
+    /* TSI TRNG */
+    while( len > 0 )
+    {
+        if( mbedtls_hardware_poll( data, output, len, &olen ) != 0 || olen == 0 )
+            return( MBEDTLS_ERR_ENTROPY_SOURCE_FAILED );
+        output += olen;
+        len -= olen;
+    }
+#else
     size_t i;
     uint32_t seed;
     (void) data;
@@ -124,10 +223,150 @@ static int custom_entropy_poll( void *data, unsigned char *output, size_t len )
         seed ^= (uint32_t)( (uintptr_t) &seed >> 16 );
         output[i] = (unsigned char)( seed >> ( ( i % 8 ) * 4 ) ) & 0xFF;
     }
+#endif
 
     return( 0 );
 }
 
+#if NU_TLS_ACCEL
+/* Curves the TSI runs, in order of preference */
+static const uint16_t ssl_groups[] =
+{
+    MBEDTLS_SSL_IANA_TLS_GROUP_SECP256R1,
+    MBEDTLS_SSL_IANA_TLS_GROUP_SECP384R1,
+    0
+};
+#endif
+
+#if SSL_CLIENT_BENCH
+static unsigned char bench_buf[BENCH_CHUNK];
+
+static uint32_t bench_ms( void )
+{
+    return( (uint32_t) xTaskGetTickCount() * portTICK_PERIOD_MS );
+}
+
+/*
+ * One connection: handshake, resuming 'session' if not NULL, then ask for
+ * 'bulk' bytes and read until the server closes. *bytes receives the bytes
+ * read.
+ */
+static int bench_conn( mbedtls_ssl_session *session, uint32_t bulk, uint32_t *bytes )
+{
+    int ret, len;
+    mbedtls_net_context fd;
+
+    mbedtls_net_init( &fd );
+    *bytes = 0;
+
+    if( ( ret = mbedtls_ssl_session_reset( &ssl ) ) != 0 )
+        goto exit;
+
+    if( ( ret = mbedtls_net_connect( &fd, SERVER_NAME, SERVER_PORT,
+                                     MBEDTLS_NET_PROTO_TCP ) ) != 0 )
+        goto exit;
+
+    if( session != NULL && ( ret = mbedtls_ssl_set_session( &ssl, session ) ) != 0 )
+        goto exit;
+
+    mbedtls_ssl_set_bio( &ssl, &fd, mbedtls_net_send, mbedtls_net_recv, NULL );
+
+    while( ( ret = mbedtls_ssl_handshake( &ssl ) ) != 0 )
+    {
+        if( ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE )
+            goto exit;
+    }
+
+    len = sprintf( (char *) bench_buf, "GET /%u HTTP/1.0\r\n\r\n", (unsigned int) bulk );
+
+    while( ( ret = mbedtls_ssl_write( &ssl, bench_buf, len ) ) <= 0 )
+    {
+        if( ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE )
+            goto exit;
+    }
+
+    do
+    {
+        ret = mbedtls_ssl_read( &ssl, bench_buf, sizeof( bench_buf ) );
+        if( ret > 0 )
+            *bytes += ret;
+    }
+    while( ret > 0 || ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE );
+
+    if( ret != 0 && ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY )
+        goto exit;
+
+    mbedtls_ssl_close_notify( &ssl );
+    ret = 0;
+
+exit:
+    mbedtls_net_free( &fd );
+
+    return( ret );
+}
+
+static void bench_print_rate( const char *what, uint32_t count, uint32_t ms )
+{
+    if( ms == 0 )
+        ms = 1;
+
+    mbedtls_printf( "    %-20s %6u in %6u ms, %u.%u/s\n", what,
+                    (unsigned int) count, (unsigned int) ms,
+                    (unsigned int) ( count * 1000 / ms ),
+                    (unsigned int) ( count * 10000 / ms % 10 ) );
+}
+
+static int ssl_bench( void )
+{
+    int ret, i;
+    uint32_t t0, ms, bytes;
+    mbedtls_ssl_session session;
+
+    mbedtls_ssl_session_init( &session );
+
+    mbedtls_printf( "\n  . Benchmark against tcp/%s/%s, NU_TLS_ACCEL %d\n",
+                    SERVER_NAME, SERVER_PORT, NU_TLS_ACCEL );
+
+    t0 = bench_ms();
+    for( i = 0; i < BENCH_HANDSHAKES; i++ )
+    {
+        if( ( ret = bench_conn( NULL, 0, &bytes ) ) != 0 )
+            goto exit;
+    }
+    bench_print_rate( "full handshakes", BENCH_HANDSHAKES, bench_ms() - t0 );
+
+    /* Ticket or session ID of the last connection */
+    if( ( ret = mbedtls_ssl_get_session( &ssl, &session ) ) != 0 )
+        goto exit;
+
+    t0 = bench_ms();
+    for( i = 0; i < BENCH_HANDSHAKES; i++ )
+    {
+        if( ( ret = bench_conn( &session, 0, &bytes ) ) != 0 )
+            goto exit;
+    }
+    bench_print_rate( "resumed handshakes", BENCH_HANDSHAKES, bench_ms() - t0 );
+
+    t0 = bench_ms();
+    if( ( ret = bench_conn( &session, BENCH_BULK_BYTES, &bytes ) ) != 0 )
+        goto exit;
+    ms = bench_ms() - t0;
+    if( ms == 0 )
+        ms = 1;
+    mbedtls_printf( "    %-20s %6u KB in %6u ms, %u KB/s\n", "bulk read",
+                    (unsigned int) ( bytes / 1024 ), (unsigned int) ms,
+                    (unsigned int) ( (uint64_t) bytes * 1000 / 1024 / ms ) );
+
+exit:
+    if( ret != 0 )
+        mbedtls_printf( "    failed, -0x%x\n", (unsigned int) -ret );
+
+    mbedtls_ssl_session_free( &session );
+
+    return( ret );
+}
+#endif /* SSL_CLIENT_BENCH */
+
 static void ssl_main(void *arg)
 {
     int ret = 1, len;
@@ -153,6 +392,15 @@ static void ssl_main(void *arg)
     mbedtls_x509_crt_init( &cacert );
     mbedtls_ctr_drbg_init( &ctr_drbg );
 
+#if NU_TLS_ACCEL
+    /* TSI for the crypto ALTs, and the CPU/TSI thresholds */
+    if( ( ret = TSI_Init() ) != 0 || ( ret = mbedtls_platform_setup( NULL ) ) != 0 )
+    {
+        mbedtls_printf( " failed\n  ! TSI setup returned %d\n\n", ret );
+        goto exit;
+    }
+#endif
+
     ret = mbedtls_ctr_drbg_seed( &ctr_drbg, custom_entropy_poll, NULL,
                                (const unsigned char *) pers, strlen( pers ) );
     if( ret != 0 )
@@ -161,6 +409,14 @@ static void ssl_main(void *arg)
         goto exit;
     }
 
+#if defined(MBEDTLS_ENTROPY_HARDWARE_ALT)
+    if( ( ret = trng_fill_start() ) != 0 )
+    {
+        mbedtls_printf( " failed\n  ! TRNG pool fill task not started\n\n" );
+        goto exit;
+    }
+#endif
+
     mbedtls_printf( " ok\n" );
 
     /*
@@ -217,6 +473,9 @@ static void ssl_main(void *arg)
     mbedtls_ssl_conf_ca_chain( &conf, &cacert, NULL );
     mbedtls_ssl_conf_rng( &conf, mbedtls_ctr_drbg_random, &ctr_drbg );
     mbedtls_ssl_conf_dbg( &conf, my_debug, stdout );
+#if NU_TLS_ACCEL
+    mbedtls_ssl_conf_groups( &conf, ssl_groups );
+#endif
 
     if( ( ret = mbedtls_ssl_setup( &ssl, &conf ) ) != 0 )
     {
@@ -329,6 +588,13 @@ static void ssl_main(void *arg)
 
     mbedtls_ssl_close_notify( &ssl );
 
+#if SSL_CLIENT_BENCH
+    mbedtls_net_free( &server_fd );
+
+    if( ( ret = ssl_bench() ) != 0 )
+        goto exit;
+#endif
+
     exit_code = MBEDTLS_EXIT_SUCCESS;
 
 exit:
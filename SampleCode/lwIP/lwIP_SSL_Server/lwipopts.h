@@ -58,6 +58,7 @@
 #define LWIP_RAND                       xTaskGetTickCount
 #define LWIP_DNS                        1
 #define SO_REUSE                        1
+#define LWIP_SO_RCVTIMEO                1
 
 #ifdef GLOBAL_NOASSERT
     #define LWIP_NOASSERT
@@ -68,11 +69,11 @@
 #define SSIZE_MAX                       65535
 
 #define MEMP_NUM_NETCONN                8
-#define MEM_SIZE                        10240
+#define MEM_SIZE                        32768
 #define MEMP_NUM_PBUF                   32
 #define PBUF_POOL_SIZE                  64
 #define TCP_WND                         16384 //Max: 65535
-#define TCP_SND_BUF                     8192
+#define TCP_SND_BUF                     16384
 #define TCP_SND_QUEUELEN                (4 * TCP_SND_BUF/TCP_MSS)
 #define MEMP_NUM_TCP_SEG                64
 
@@ -80,7 +81,8 @@
 #define TCPIP_THREAD_STACKSIZE          1024 * 8
 #define TCPIP_THREAD_PRIO               2
 #define TCPIP_MBOX_SIZE                 10
-#define DEFAULT_TCP_RECVMBOX_SIZE       5
+/* Room for a full TCP_WND of segments, one TLS record is up to 16 KB */
+#define DEFAULT_TCP_RECVMBOX_SIZE       16
 #define DEFAULT_ACCEPTMBOX_SIZE         5
 #define DEFAULT_UDP_RECVMBOX_SIZE       5
 #define DEFAULT_RAW_RECVMBOX_SIZE       5
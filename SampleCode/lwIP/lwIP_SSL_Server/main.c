@@ -198,6 +198,9 @@ void SYS_Init()
     SYS->IPRST0 = SYS_IPRST0_HWSEMRST_Msk;
     SYS->IPRST0 = 0;
 
+    /* Enable Wormhole 1 clock for the TSI */
+    CLK_EnableModuleClock(WH1_MODULE);
+
     /* Lock protected registers */
     SYS_LockReg();
 }
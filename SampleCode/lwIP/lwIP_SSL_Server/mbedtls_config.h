@@ -3265,7 +3265,7 @@
  *
  * The value below is only an example, not the default.
  */
-#define MBEDTLS_SSL_CIPHERSUITES MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256
+#define MBEDTLS_SSL_CIPHERSUITES MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384
 
 /* X509 options */
 //#define MBEDTLS_X509_MAX_INTERMEDIATE_CA   8   /**< Maximum number of intermediate CAs in a verification chain. */
@@ -3322,14 +3322,48 @@
 /* \} name SECTION: Customisation configuration options */
 
 /**
-* Configuration check for M460
-*
-*/
-
-#if (defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT) || defined(MBEDTLS_ECDH_COMPUTE_SHARED_ALT) || defined(MBEDTLS_ECDSA_VERIFY_ALT) || defined(MBEDTLS_ECDSA_SIGN_ALT)) && defined(MBEDTLS_SHA256_ALT)
-#error "SHA256_ALT cannot work with ECDH or ECDSA ALT"
+ * \def NU_TLS_ACCEL
+ *
+ * TLS profile of this sample.
+ *
+ * 1: production profile. Crypto runs on Library/CryptoAccelerator: AES-GCM
+ *    and SHA-2 on the TSI or the ARMv8 Crypto Extension, ECDHE and ECDSA
+ *    on the TSI, entropy from the TSI TRNG. Records move straight between
+ *    netconn pbufs and mbed TLS (see port/apps/net_sockets.c, shared by
+ *    both SSL samples). The server keeps a session cache and issues
+ *    session tickets, the client resumes.
+ *
+ * 0: the previous software-only profile on BSD sockets. Keep it to compare
+ *    against with the benchmark of lwIP_SSL_Client.
+ *
+ * Both profiles offer the ECDHE-ECDSA-AES-GCM suites of
+ * MBEDTLS_SSL_CIPHERSUITES, AES-128 first: fewer rounds, and its PRF is
+ * SHA-256, which the CPU runs with the Crypto Extension. None uses RSA, so
+ * the RSA ALT is not listed. The sample builds mbed TLS and the ALTs from
+ * source, so a rebuild picks up the profile.
+ */
+#ifndef NU_TLS_ACCEL
+#define NU_TLS_ACCEL    1
 #endif
 
-#if (defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT) || defined(MBEDTLS_ECDH_COMPUTE_SHARED_ALT) || defined(MBEDTLS_ECDSA_VERIFY_ALT) || defined(MBEDTLS_ECDSA_SIGN_ALT)) && defined(MBEDTLS_ECP_DP_CURVE25519_ENABLED)
-#error "MBEDTLS_ECP_DP_CURVE25519_ENABLED cannot work with ECDH or ECDSA ALT"
-#endif
+#if NU_TLS_ACCEL
+#define MBEDTLS_PLATFORM_SETUP_TEARDOWN_ALT
+
+#define MBEDTLS_AES_ALT
+#define MBEDTLS_GCM_ALT
+#define MBEDTLS_SHA1_ALT
+#define MBEDTLS_SHA256_ALT
+#define MBEDTLS_SHA512_ALT
+#define MBEDTLS_ECDH_GEN_PUBLIC_ALT
+#define MBEDTLS_ECDH_COMPUTE_SHARED_ALT
+#define MBEDTLS_ECDSA_VERIFY_ALT
+#define MBEDTLS_ECDSA_SIGN_ALT
+#define MBEDTLS_ECDSA_GENKEY_ALT
+#define MBEDTLS_ENTROPY_HARDWARE_ALT
+
+#define MBEDTLS_SSL_SESSION_TICKETS
+#define MBEDTLS_SSL_CACHE_C
+#define MBEDTLS_SSL_TICKET_C
+#define MBEDTLS_SSL_CACHE_DEFAULT_TIMEOUT       86400
+#define MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES   8
+#endif /* NU_TLS_ACCEL */
@@ -61,6 +61,24 @@
 #include "mbedtls/ssl_cache.h"
 #endif
 
+#if defined(MBEDTLS_SSL_TICKET_C)
+#include "mbedtls/ssl_ticket.h"
+#endif
+
+#if NU_TLS_ACCEL
+#include "tsi_cmd.h"
+#endif
+
+#if defined(MBEDTLS_ENTROPY_HARDWARE_ALT)
+#include "semphr.h"
+#include "entropy_alt.h"
+
+/* The TRNG pool fill task runs below the SSL task */
+#define TRNG_THREAD_PRIO         ( tskIDLE_PRIORITY + 1UL )
+#define TRNG_THREAD_STACKSIZE    512
+#define TRNG_FILL_PERIOD_MS      50
+#endif
+
 #define HTTP_RESPONSE \
     "HTTP/1.0 200 OK\r\nContent-Type: text/html\r\n\r\n" \
     "<h2>mbed TLS Test Server</h2>\r\n" \
@@ -71,6 +89,26 @@
 #define SSLSERVER_THREAD_PRIO    ( tskIDLE_PRIORITY + 2UL )
 #define SSLSERVER_THREAD_STACKSIZE  2048
 
+/*
+ * Per-connection progress on the console. Set to 0 when serving the
+ * lwIP_SSL_Client benchmark, the UART takes longer than a resumed handshake.
+ */
+#define SSL_SERVER_TRACE        1
+
+#if SSL_SERVER_TRACE
+#define trace_printf            mbedtls_printf
+#else
+#define trace_printf( ... )
+#endif
+
+/* A request "GET /<bytes>" gets <bytes> more after the page, up to this */
+#define BULK_MAX_BYTES          ( 64 * 1024 * 1024 )
+#define BULK_CHUNK              16384
+
+#if defined(MBEDTLS_ENTROPY_HARDWARE_ALT)
+int mbedtls_hardware_poll( void *data, unsigned char *output, size_t len, size_t *olen );
+#endif
+
 #if defined(MBEDTLS_CHECK_PARAMS)
 #include "mbedtls/platform_util.h"
 void mbedtls_param_failed( const char *failure_condition,
@@ -83,6 +121,60 @@ void mbedtls_param_failed( const char *failure_condition,
 }
 #endif
 
+#if defined(MBEDTLS_ENTROPY_HARDWARE_ALT)
+/*
+ * The entropy pool is filled by a task of its own, so two tasks now issue
+ * TSI commands. The TSI driver takes this mutex around each command.
+ */
+static SemaphoreHandle_t tsi_mutex;
+
+static void tsi_lock( void )
+{
+    xSemaphoreTake( tsi_mutex, portMAX_DELAY );
+}
+
+static void tsi_unlock( void )
+{
+    xSemaphoreGive( tsi_mutex );
+}
+
+/* Tops the pool up while the SSL task waits on the network, so seeding and
+ * reseeding during a handshake only copies from it */
+static void trng_fill_task( void *arg )
+{
+    NU_TRNG_POOL_STAT_T stat;
+    ( void ) arg;
+
+    for( ;; )
+    {
+        if( nu_trng_pool_fill( 0 ) < 0 )
+        {
+            nu_trng_pool_stat( &stat, 0 );
+            mbedtls_printf( "  ! TRNG pool fill failed: %u errors, last 0x%x\n",
+                            (unsigned) stat.error_count, (unsigned) stat.last_error );
+            vTaskDelay( pdMS_TO_TICKS( 1000 ) );
+        }
+        vTaskDelay( pdMS_TO_TICKS( TRNG_FILL_PERIOD_MS ) );
+    }
+}
+
+/* Call after the DRBG is seeded, which has initialised the TRNG */
+static int trng_fill_start( void )
+{
+    tsi_mutex = xSemaphoreCreateMutex();
+    if( tsi_mutex == NULL )
+        return( -1 );
+
+    TSI_Set_Lock( tsi_lock, tsi_unlock );
+
+    if( xTaskCreate( trng_fill_task, "TrngFill", TRNG_THREAD_STACKSIZE, NULL,
+                     TRNG_THREAD_PRIO, NULL ) != pdPASS )
+        return( -1 );
+
+    return( 0 );
+}
+#endif /* MBEDTLS_ENTROPY_HARDWARE_ALT */
+
 static void my_debug( void *ctx, int level,
                       const char *file, int line,
                       const char *str )
@@ -102,6 +194,20 @@ mbedtls_pk_context pkey;
 #if defined(MBEDTLS_SSL_CACHE_C)
 mbedtls_ssl_cache_context cache;
 #endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+mbedtls_ssl_ticket_context ticket_ctx;
+#endif
+static unsigned char bulk_buf[BULK_CHUNK];
+
+#if NU_TLS_ACCEL
+/* Curves the TSI runs, in order of preference */
+static const uint16_t ssl_groups[] =
+{
+    MBEDTLS_SSL_IANA_TLS_GROUP_SECP256R1,
+    MBEDTLS_SSL_IANA_TLS_GROUP_SECP384R1,
+    0
+};
+#endif
 
 static void *mbedtls_calloc_wrapper( size_t n, size_t size )
 {
@@ -115,6 +221,18 @@ static void *mbedtls_calloc_wrapper( size_t n, size_t size )
 
 static int custom_entropy_poll( void *data, unsigned char *output, size_t len )
 {
+#if defined(MBEDTLS_ENTROPY_HARDWARE_ALT)
+    size_t olen;
+
+    /* TSI TRNG */
+    while( len > 0 )
+    {
+        if( mbedtls_hardware_poll( data, output, len, &olen ) != 0 || olen == 0 )
+            return( MBEDTLS_ERR_ENTROPY_SOURCE_FAILED );
+        output += olen;
+        len -= olen;
+    }
+#else
     size_t i;
     uint32_t seed;
     (void) data;
@@ -125,6 +243,7 @@ static int custom_entropy_poll( void *data, unsigned char *output, size_t len )
         seed ^= (uint32_t)( (uintptr_t) &seed >> 16 );
         output[i] = (unsigned char)( seed >> ( ( i % 8 ) * 4 ) ) & 0xFF;
     }
+#endif
 
     return( 0 );
 }
@@ -132,6 +251,7 @@ static int custom_entropy_poll( void *data, unsigned char *output, size_t len )
 static void ssl_main(void *arg)
 {
     int ret, len;
+    unsigned long bulk;
     mbedtls_net_context listen_fd, client_fd;
     const char *pers = "ssl_server";
 
@@ -143,11 +263,23 @@ static void ssl_main(void *arg)
     mbedtls_ssl_config_init( &conf );
 #if defined(MBEDTLS_SSL_CACHE_C)
     mbedtls_ssl_cache_init( &cache );
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+    mbedtls_ssl_ticket_init( &ticket_ctx );
 #endif
     mbedtls_x509_crt_init( &srvcert );
     mbedtls_pk_init( &pkey );
     mbedtls_ctr_drbg_init( &ctr_drbg );
 
+#if NU_TLS_ACCEL
+    /* TSI for the crypto ALTs, and the CPU/TSI thresholds */
+    if( ( ret = TSI_Init() ) != 0 || ( ret = mbedtls_platform_setup( NULL ) ) != 0 )
+    {
+        mbedtls_printf( " failed\n  ! TSI setup returned %d\n\n", ret );
+        goto exit;
+    }
+#endif
+
     ret = mbedtls_ctr_drbg_seed( &ctr_drbg, custom_entropy_poll, NULL,
                                (const unsigned char *) pers, strlen( pers ) );
     if( ret != 0 )
@@ -156,6 +288,14 @@ static void ssl_main(void *arg)
         goto exit;
     }
 
+#if defined(MBEDTLS_ENTROPY_HARDWARE_ALT)
+    if( ( ret = trng_fill_start() ) != 0 )
+    {
+        mbedtls_printf( " failed\n  ! TRNG pool fill task not started\n\n" );
+        goto exit;
+    }
+#endif
+
 #if defined(MBEDTLS_DEBUG_C)
     mbedtls_debug_set_threshold( DEBUG_LEVEL );
 #endif
@@ -236,6 +376,26 @@ static void ssl_main(void *arg)
                                     mbedtls_ssl_cache_set );
 #endif
 
+#if defined(MBEDTLS_SSL_TICKET_C)
+    if( ( ret = mbedtls_ssl_ticket_setup( &ticket_ctx,
+                                          mbedtls_ctr_drbg_random, &ctr_drbg,
+                                          MBEDTLS_CIPHER_AES_128_GCM,
+                                          MBEDTLS_SSL_CACHE_DEFAULT_TIMEOUT ) ) != 0 )
+    {
+        mbedtls_printf( " failed\n  ! mbedtls_ssl_ticket_setup returned %d\n\n", ret );
+        goto exit;
+    }
+
+    mbedtls_ssl_conf_session_tickets_cb( &conf,
+                                         mbedtls_ssl_ticket_write,
+                                         mbedtls_ssl_ticket_parse,
+                                         &ticket_ctx );
+#endif
+
+#if NU_TLS_ACCEL
+    mbedtls_ssl_conf_groups( &conf, ssl_groups );
+#endif
+
     mbedtls_ssl_conf_ca_chain( &conf, srvcert.next, NULL );
     if( ( ret = mbedtls_ssl_conf_own_cert( &conf, &srvcert, &pkey ) ) != 0 )
     {
@@ -268,7 +428,7 @@ reset:
     /*
      * 4. Wait until a client connects
      */
-    mbedtls_printf( "  . Waiting for a remote connection ..." );
+    trace_printf( "  . Waiting for a remote connection ..." );
     fflush( stdout );
 
     if( ( ret = mbedtls_net_accept( &listen_fd, &client_fd,
@@ -280,12 +440,12 @@ reset:
 
     mbedtls_ssl_set_bio( &ssl, &client_fd, mbedtls_net_send, mbedtls_net_recv, NULL );
 
-    mbedtls_printf( " ok\n" );
+    trace_printf( " ok\n" );
 
     /*
      * 5. Handshake
      */
-    mbedtls_printf( "  . Performing the SSL/TLS handshake..." );
+    trace_printf( "  . Performing the SSL/TLS handshake..." );
     fflush( stdout );
 
     while( ( ret = mbedtls_ssl_handshake( &ssl ) ) != 0 )
@@ -297,14 +457,15 @@ reset:
         }
     }
 
-    mbedtls_printf( " ok\n" );
+    trace_printf( " ok\n" );
 
     /*
      * 6. Read the HTTP Request
      */
-    mbedtls_printf( "  < Read from client:" );
+    trace_printf( "  < Read from client:" );
     fflush( stdout );
 
+    bulk = 0;
     do
     {
         len = sizeof( buf ) - 1;
@@ -335,7 +496,12 @@ reset:
         }
 
         len = ret;
-        mbedtls_printf( " %d bytes read\n\n%s", len, (char *) buf );
+        trace_printf( " %d bytes read\n\n%s", len, (char *) buf );
+
+        if( strncmp( (char *) buf, "GET /", 5 ) == 0 )
+            bulk = strtoul( (char *) buf + 5, NULL, 10 );
+        if( bulk > BULK_MAX_BYTES )
+            bulk = BULK_MAX_BYTES;
 
         if( ret > 0 )
             break;
@@ -345,7 +511,7 @@ reset:
     /*
      * 7. Write the 200 Response
      */
-    mbedtls_printf( "  > Write to client:" );
+    trace_printf( "  > Write to client:" );
     fflush( stdout );
 
     len = sprintf( (char *) buf, HTTP_RESPONSE,
@@ -367,9 +533,27 @@ reset:
     }
 
     len = ret;
-    mbedtls_printf( " %d bytes written\n\n%s\n", len, (char *) buf );
+    trace_printf( " %d bytes written\n\n%s\n", len, (char *) buf );
+
+    /* Benchmark data for lwIP_SSL_Client */
+    while( bulk > 0 )
+    {
+        len = bulk < sizeof( bulk_buf ) ? (int) bulk : (int) sizeof( bulk_buf );
+        ret = mbedtls_ssl_write( &ssl, bulk_buf, len );
 
-    mbedtls_printf( "  . Closing the connection..." );
+        if( ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE )
+            continue;
+
+        if( ret < 0 )
+        {
+            mbedtls_printf( " failed\n  ! mbedtls_ssl_write returned %d\n\n", ret );
+            goto reset;
+        }
+
+        bulk -= ret;
+    }
+
+    trace_printf( "  . Closing the connection..." );
 
     while( ( ret = mbedtls_ssl_close_notify( &ssl ) ) < 0 )
     {
@@ -381,7 +565,7 @@ reset:
         }
     }
 
-    mbedtls_printf( " ok\n" );
+    trace_printf( " ok\n" );
 
     ret = 0;
     goto reset;
@@ -406,6 +590,9 @@ exit:
     mbedtls_ssl_config_free( &conf );
 #if defined(MBEDTLS_SSL_CACHE_C)
     mbedtls_ssl_cache_free( &cache );
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+    mbedtls_ssl_ticket_free( &ticket_ctx );
 #endif
     mbedtls_ctr_drbg_free( &ctr_drbg );
 
@@ -62,21 +62,36 @@
 #define SSIZE_MAX                       65535
 
 #define MEMP_NUM_NETCONN                8
-#define MEM_SIZE                        1600
+#define MEM_SIZE                        (16 * 1024)
 #define MEMP_NUM_PBUF                   32
-#define PBUF_POOL_SIZE                  64
+/* One pbuf per GMAC receive descriptor */
+#define PBUF_POOL_SIZE                  RECEIVE_DESC_SIZE
 #define TCP_WND                         16384 //Max: 65535
 #define TCP_SND_BUF                     8192
 #define TCP_SND_QUEUELEN                (4 * TCP_SND_BUF/TCP_MSS)
 #define MEMP_NUM_TCP_SEG                64
 
+/* ---------- TFTP windows ---------- */
+/* A window of up to 16 datagrams is queued on the transfer's netconn; a
+   block over 1468 bytes arrives in IP fragments */
+#define MEMP_NUM_NETBUF                 32
+#define MEMP_NUM_UDP_PCB                6
+#define IP_REASS_MAX_PBUFS              24
+/* Fragments point into the GMAC receive ring, drop those of a lost
+   datagram before the ring comes round */
+#define IP_REASS_MAXAGE                 3
+
 /* Application */
 #define TCPIP_THREAD_STACKSIZE          400
 #define TCPIP_THREAD_PRIO               2
-#define TCPIP_MBOX_SIZE                 10
+/* Received frames go through the stack under the core lock instead of one
+   tcpip_thread message each, a window of fragments would overrun the mbox */
+#define LWIP_TCPIP_CORE_LOCKING         1
+#define LWIP_TCPIP_CORE_LOCKING_INPUT   1
+#define TCPIP_MBOX_SIZE                 32
 #define DEFAULT_TCP_RECVMBOX_SIZE       5
 #define DEFAULT_ACCEPTMBOX_SIZE         5
-#define DEFAULT_UDP_RECVMBOX_SIZE       5
+#define DEFAULT_UDP_RECVMBOX_SIZE       32
 #define DEFAULT_RAW_RECVMBOX_SIZE       5
 #define LWIP_SO_RCVTIMEO                1
 
@@ -3,6 +3,11 @@
  *
  * @brief    A TFTP client
  *
+ *           Gets test.txt from, or puts it to, the server at 192.168.1.2,
+ *           asking for TFTP_BLKSIZE byte blocks and a window of
+ *           TFTP_WINDOWSIZE blocks (tftp.h). The file is kept in a RAM
+ *           image; a put before any get sends a 1 MB test pattern.
+ *
  * @note     TIMER11 has been assigned to FreeRTOS kernel.
  *
  * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
@@ -1,147 +1,106 @@
 /*************************************************************************//**
  * @file     tftp.c
  * @version  V1.00
- * @brief    A simple TFTP client source file.
+ * @brief    A TFTP client with blksize, windowsize and tsize options.
+ *
+ *           Files are got into the RAM image through the double-buffered
+ *           writer, and put from it. Servers that do not answer the options
+ *           with an OACK get plain 512-byte, one block at a time transfers.
  *
  * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
 *****************************************************************************/
 #include "lwip/opt.h"
 #include "lwip/arch.h"
 #include "lwip/api.h"
+#include "lwip/sys.h"
 #include "string.h"
 #include "tftp.h"
+#include "tftp_xfer.h"
 
 
 #define TFTP_THREAD_PRIO       ( tskIDLE_PRIORITY + 2UL )
-#define TFTP_THREAD_STACKSIZE  ( 200 )
+#define TFTP_THREAD_STACKSIZE  ( 1024 )
 
-#ifndef MIN
-#define MIN(a, b)   (a) < (b) ? (a) : (b)
-#endif
+/* Size of the test pattern put before anything was got */
+#define FILE_LEN        (1024 * 1024)
 
-static struct netconn *conn;
-static unsigned short server_port = TFTP_PORT;
 static ip_addr_t server_addr;
 
-#define FILE_LEN        2048
-static uint32_t flen = FILE_LEN;
-static uint8_t file[FILE_LEN];
-
 char *file_name = "test.txt";   // File name to put or get
-char *tftp_mode = "octet";      // Could be "octet", "netascii", or "mail"
-
-void send_ack(uint16_t blk)
-{
-    struct netbuf *nbuf;
-    char *data;
-    /* Prepare data */
-    if((nbuf = netbuf_new()) == NULL)
-        return;
-    if((data = netbuf_alloc(nbuf, 4)) == NULL)      // op 2, ack blk 2
-    {
-        netbuf_delete(nbuf);
-        return;
-    }
-    *(uint16_t *)data = lwip_htons(TFTP_OPCODE_ACK);
-    *(uint16_t *)(data + 2) = lwip_htons(blk);
 
-    /* Send the packet */
-    netconn_sendto(conn, nbuf, &server_addr, server_port);
+/* Blocks in flight of a put, sent from here by reference */
+static uint8_t s_win[TFTP_XFER_BUF_SIZE(TFTP_BLKSIZE_MAX, TFTP_WINDOW_MAX)] __attribute__((aligned(64)));
 
-    /* Free the buffer */
-    netbuf_delete(nbuf);
+static void tftp_report(const char *what, tftp_xfer_t *x, uint32_t ms)
+{
+    if (ms == 0)
+        ms = 1;
+    sysprintf("%s %s: %d bytes in %d ms, %d KB/s (blksize %d, windowsize %d, %d resent)\n",
+              what, file_name, x->bytes, ms, x->bytes / ms * 1000 / 1024,
+              x->opts.blksize, x->opts.windowsize, x->resent);
 }
 
-void send_data(uint16_t blk, uint8_t *buf, uint16_t len)
+/**
+  * @brief  Get file_name from the server into the RAM image
+  * @param  x: transfer with a bound netconn
+  * @param  asked: options to ask for
+  * @retval None
+  */
+static void tftp_get(tftp_xfer_t *x, tftp_opts_t *asked)
 {
-    struct netbuf *nbuf;
-    char *data;
-    /* Prepare data */
-    if((nbuf = netbuf_new()) == NULL)
-        return;
-    if((data = netbuf_alloc(nbuf, len + 4)) == NULL)    // op 2, blk 2
-    {
-        netbuf_delete(nbuf);
-        return;
-    }
-    *(uint16_t *)data = lwip_htons(TFTP_OPCODE_DATA);
-    *(uint16_t *)(data + 2) = lwip_htons(blk);
-    memcpy(data + 4, (void *)buf, len);
-    /* Send the packet */
-    netconn_sendto(conn, nbuf, &server_addr, server_port);
+    struct netbuf *first;
+    uint32_t t0 = sys_now();
+    int ret;
 
-    /* Free the buffer */
-    netbuf_delete(nbuf);
-}
+    /* As receiver, ask for no more than the GMAC receive ring holds */
+    tftp_opts_clamp(asked, 1);
 
-void send_err(uint16_t err)
-{
-    struct netbuf *nbuf;
-    char *data;
-    /* Prepare data */
-    if((nbuf = netbuf_new()) == NULL)
+    if (tftp_xfer_request(x, TFTP_OPCODE_RRQ, file_name, asked, &first) != 0)
         return;
-    if((data = netbuf_alloc(nbuf, 8)) == NULL)      // op 2, err code 2, msg 4
+
+    if (tftp_store_begin(&tftp_sink_ram, NULL, file_name, x->opts.tsize) != 0)
     {
-        netbuf_delete(nbuf);
+        tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_DISK_FULL, "File too large");
+        if (first != NULL)
+            netbuf_delete(first);
         return;
     }
-    *(uint16_t *)data = lwip_htons(TFTP_OPCODE_ERROR);
-    *(uint16_t *)(data + 2) = lwip_htons(err);
-    data[4] = 'E';
-    data[5] = 'R';
-    data[6] = 'R';
-    data[7] = 0x00;
-    /* Send the packet */
-    netconn_sendto(conn, nbuf, &server_addr, server_port);
-
-    /* Free the buffer */
-    netbuf_delete(nbuf);
-}
 
-void send_rrq(void)
-{
-    struct netbuf *nbuf;
-    char *data;
-    /* Prepare data */
-    if((nbuf = netbuf_new()) == NULL)
-        return;
-    if((data = netbuf_alloc(nbuf, 2 + strlen(file_name) + strlen(tftp_mode) + 2 )) == NULL)      // op 2, two string and two terminators
+    ret = tftp_xfer_recv(x, first);
+    if (tftp_store_end(ret == 0) != 0)
     {
-        netbuf_delete(nbuf);
+        if (ret == 0)
+            tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_DISK_FULL, "Write error");
+        sysprintf("Get failed\n");
         return;
     }
-    *(uint16_t *)data = lwip_htons(TFTP_OPCODE_RRQ);
-    strcpy(data + 2, file_name);
-    strcpy(data + 2 + strlen(file_name) + 1, tftp_mode);
-    /* Send the packet */
-    netconn_sendto(conn, nbuf, &server_addr, server_port);
-
-    /* Free the buffer */
-    netbuf_delete(nbuf);
+    tftp_xfer_done(x);
+    tftp_report("Got", x, sys_now() - t0);
 }
 
-void send_wrq(void)
+/**
+  * @brief  Put the RAM image to the server as file_name
+  * @param  x: transfer with a bound netconn
+  * @param  asked: options to ask for
+  * @retval None
+  */
+static void tftp_put(tftp_xfer_t *x, tftp_opts_t *asked)
 {
-    struct netbuf *nbuf;
-    char *data;
-    /* Prepare data */
-    if((nbuf = netbuf_new()) == NULL)
+    struct netbuf *first;
+    uint32_t t0 = sys_now();
+
+    tftp_opts_clamp(asked, 0);
+    asked->tsize = tftp_ram_len;
+
+    if (tftp_xfer_request(x, TFTP_OPCODE_WRQ, file_name, asked, &first) != 0)
         return;
-    if((data = netbuf_alloc(nbuf, 2 + strlen(file_name) + strlen(tftp_mode) + 2 )) == NULL)      // op 2, two string and two terminators
+
+    if (tftp_xfer_send(x, tftp_read_ram, NULL, tftp_ram_len, s_win) != 0)
     {
-        netbuf_delete(nbuf);
+        sysprintf("Put failed\n");
         return;
     }
-    *(uint16_t *)data = lwip_htons(TFTP_OPCODE_WRQ);
-    strcpy(data + 2, file_name);
-    strcpy(data + 2 + strlen(file_name) + 1, tftp_mode);
-
-    /* Send the packet */
-    netconn_sendto(conn, nbuf, &server_addr, server_port);
-
-    /* Free the buffer */
-    netbuf_delete(nbuf);
+    tftp_report("Put", x, sys_now() - t0);
 }
 
 /**
@@ -151,36 +110,14 @@ void send_wrq(void)
   */
 static void tftp_thread(void *arg)
 {
-    err_t err;
-    struct netbuf *nbuf;
-    uint8_t *data, *payload;
-    ip_addr_t *get_addr;
-    unsigned short get_port;
-    uint16_t payload_len;
-
-    uint16_t state = TFTP_STATE_IDLE;
-    uint16_t op, blk = 0;
-    int retry, remain;
+    tftp_xfer_t x;
+    tftp_opts_t asked;
     char c = 0;
-    int done = 0;
-    int first = 1;  // set 1 for resend first wrq/rrq request on timeout, otherwise resend ack/data
-
 
     /* Configure tftp server IP address */
     IP4_ADDR(&server_addr, 192, 168, 1, 2);
 
-    /* Create a new UDP connection handle */
-    conn = netconn_new(NETCONN_UDP);
-    if (conn == NULL)
-    {
-        sysprintf("netconn_new() failed\n");
-        while(1);
-    }
-
     do {
-        blk = 0;
-        done = 0;
-        first = 1;
         sysprintf("Select your option 1)get, 2)put\n");
         while(1)
         {
@@ -188,232 +125,41 @@ static void tftp_thread(void *arg)
             if(c == '1' || c == '2')
                 break;
         }
+
+        /* A new UDP connection handle, i.e. a new TID, per transfer */
+        memset(&x, 0, sizeof(x));
+        x.conn = netconn_new(NETCONN_UDP);
+        if (x.conn == NULL)
+        {
+            sysprintf("netconn_new() failed\n");
+            while(1);
+        }
+        netconn_bind(x.conn, NULL, 0);
+        ip_addr_copy(x.addr, server_addr);
+        x.port = TFTP_PORT;
+
+        tftp_opts_default(&asked);
+        asked.blksize = TFTP_BLKSIZE;
+        asked.windowsize = TFTP_WINDOWSIZE;
+        asked.mask = TFTP_OPT_BLKSIZE | TFTP_OPT_WINDOWSIZE | TFTP_OPT_TSIZE;
+
         if(c == '1')
         {
             sysprintf("You select get file from server\n");
-            state = TFTP_STATE_RRQ;
-            send_rrq();
+            tftp_get(&x, &asked);
         }
         else
         {
             sysprintf("You select put file to server\n");
-            state = TFTP_STATE_WRQ;
-            send_wrq();
+            tftp_put(&x, &asked);
         }
 
-        while(!done)
-        {
-            err = netconn_recv(conn, &nbuf);
-            if(err == ERR_TIMEOUT)
-            {
-                if(state == TFTP_STATE_IDLE)
-                    continue;
-
-                if(++retry > TFTP_MAX_RETRIES)
-                {
-                    sysprintf("Exceed retry count, reset to idle state\n");
-                    retry = 0;
-                    state = TFTP_STATE_IDLE;
-                    done = 1;
-                    continue;
-                }
-                /* Packet was likely lost */
-                if(state == TFTP_STATE_RRQ)
-                {
-                    if(first)
-                    {
-                        sysprintf("Timeout, resend RRQ %d\n", retry);
-                        send_rrq();
-                    }
-                    else
-                    {
-                        sysprintf("Timeout, resend data %d\n", retry);
-                        send_data(blk, (void *)data, MIN(remain, TFTP_BLOCK_LENGTH));
-                    }
-                    continue;
-                }
-                else if (state == TFTP_STATE_WRQ)
-                {
-                    if(first)
-                    {
-                        sysprintf("Timeout, resend WRQ %d\n", retry);
-                        send_wrq();
-                    }
-                    else
-                    {
-                        sysprintf("Timeout, resend ack %d\n", retry);
-                        send_ack(blk);
-                    }
-                    continue;
-                }
-            }
-            else if(err != ERR_OK)
-            {
-                continue;
-            }
-
-            retry = 0;
-
-            /* Get destination IP address and port*/
-            get_addr = netbuf_fromaddr(nbuf);
-            get_port = netbuf_fromport(nbuf);
-            /* Get the payload and length */
-            netbuf_data(nbuf, (void**)&payload, &payload_len);
-
-            op = lwip_ntohs(*(uint16_t *)payload);
-            if(memcmp(get_addr, &server_addr, sizeof(ip_addr_t)))
-            {
-                // Ignore everything not coming from server.
-                // Server may select other port to complete the service, so check address only
-                netbuf_delete(nbuf);
-                continue;
-            }
-
-            switch(op)
-            {
-                case TFTP_OPCODE_DATA:
-                    if(state != TFTP_STATE_RRQ)
-                    {
-                        send_err(TFTP_ERROR_ILLEGAL_OPERATION);
-                        state = TFTP_STATE_IDLE;
-                        done = 1;
-                    }
-                    else
-                    {
-                        uint16_t new_blk = lwip_ntohs(*(uint16_t *)(payload + 2));
-
-                        if(new_blk == blk)
-                        {
-                            /* Last ACK lost */
-                            send_ack(blk);
-                        }
-                        else if(new_blk == blk + 1)
-                        {
-                            int i;
-                            uint8_t *c = payload + 4;
-
-                            if(first)
-                            {
-                                // Server may select other port to complete the service
-                                server_port = get_port;
-                                first = 0;
-                            }
-                            // Dump received data */
-                            for(i = 0; i < payload_len - 4; i++)
-                            {
-                                if((i & 0xF) == 0)
-                                    sysprintf("\n");
-                                sysprintf("%02x ", *c++);
-                            }
-
-                            blk = new_blk;
-                            send_ack(blk);
-                            if(payload_len < TFTP_BLOCK_LENGTH + 4)
-                            {
-                                /* This is the last data packet, all done */
-                                sysprintf("Done\n");
-                                done = 1;
-                                state = TFTP_STATE_IDLE;
-                            }
-                        }
-                        else
-                        {
-                            /* Wrong ack # */
-                            sysprintf("Unknown ID number\n");
-                            send_err(TFTP_ERROR_UNKNOWN_ID);
-                            state = TFTP_STATE_IDLE;
-                            done = 1;
-                        }
-                    }
-                    break;
-
-                case TFTP_OPCODE_ACK:
-                    if(state != TFTP_STATE_WRQ)
-                    {
-                        send_err(TFTP_ERROR_ILLEGAL_OPERATION);
-                        state = TFTP_STATE_IDLE;
-                        done = 1;
-                    }
-                    else
-                    {
-                        uint16_t new_blk = lwip_ntohs(*(uint16_t *)(payload + 2));
-
-                        if(first)
-                        {
-                            if(new_blk != 0)
-                            {
-                                /* Ack block # for WRQ must be 0 */
-                                sysprintf("Unknown ID number\n");
-                                send_err(TFTP_ERROR_UNKNOWN_ID);
-                                state = TFTP_STATE_IDLE;
-                                done = 1;
-                            }
-                            else
-                            {
-                                // Server may select other port to complete the service
-                                server_port = get_port;
-                                remain = flen;
-                                data = file;
-                                blk++;
-                                first = 0;
-                                send_data(blk, data, MIN(remain, TFTP_BLOCK_LENGTH));
-                            }
-                        }
-                        else if(new_blk == (blk - 1))
-                        {
-                            /* Last packet was lost */
-                            send_data(blk, data, MIN(remain, TFTP_BLOCK_LENGTH));
-                        }
-                        else if(new_blk == blk)
-                        {
-                            remain -= TFTP_BLOCK_LENGTH;
-                            if(remain < 0)  /* Still need to send a 0 data packet if remain is 0 */
-                            {
-                                /* All done */
-                                sysprintf("\nDone\n");
-                                done = 1;
-                                state = TFTP_STATE_IDLE;
-                            }
-                            else
-                            {
-                                blk++;
-                                data += TFTP_BLOCK_LENGTH;
-                                sysprintf(".");
-                                send_data(blk, data, MIN(remain, TFTP_BLOCK_LENGTH));
-                            }
-                        }
-                        else
-                        {
-                            /* Wrong ack # */
-                            sysprintf("Unknown ID number\n");
-                            send_err(TFTP_ERROR_UNKNOWN_ID);
-                            state = TFTP_STATE_IDLE;
-                            done = 1;
-                        }
-                    }
-                    break;
-                case TFTP_OPCODE_ERROR:
-                    /* Reset to idle state on error */
-                    state = TFTP_STATE_IDLE;
-                    done = 1;
-                    sysprintf("Received ERR: %d\n", lwip_ntohs(*(uint16_t *)(payload + 2)));
-                    break;
-                default:
-                    /* Reset to idle state if recevied unknown op code */
-                    sysprintf("Received unknown op code\n");
-                    send_err(TFTP_ERROR_ILLEGAL_OPERATION);
-                    state = TFTP_STATE_IDLE;
-                    done = 1;
-                    break;
-            }
-
-            netbuf_delete(nbuf);
-        }
+        netconn_delete(x.conn);
     } while(1);
 }
 
 /**
-  * @brief  Initialize the TFTP server (start its thread)
+  * @brief  Initialize the TFTP client (start its thread)
   * @param  none
   * @retval None
   */
@@ -422,6 +168,9 @@ void tftp_client_init(void)
     int i;
 
     for(i = 0; i < FILE_LEN; i++)
-        file[i] = i & 0xFF;
+        tftp_ram_image[i] = i & 0xFF;
+    tftp_ram_len = FILE_LEN;
+
+    tftp_store_init();
     sys_thread_new("TFTP", tftp_thread, NULL, TFTP_THREAD_STACKSIZE, TFTP_THREAD_PRIO);
 }
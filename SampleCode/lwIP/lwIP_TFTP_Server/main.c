@@ -3,6 +3,18 @@
  *
  * @brief    A TFTP server
  *
+ *           The server answers at 192.168.1.2 and negotiates the blksize
+ *           (up to 8 KB), windowsize and tsize options, e.g.
+ *             curl -T image.bin --tftp-blksize 8192 tftp://192.168.1.2/image.bin
+ *           windowsize needs an RFC 7440 client, such as lwIP_TFTP_Client.
+ *           Written files stream into the FAT volume on the SD card of SDH
+ *           (sdh.h), 8.3 names only, while the next blocks are received.
+ *           Without a card, and for the name "ram", they go to a RAM image
+ *           instead, which RRQ "ram" reads back. WRQ "null" discards.
+ *
+ *           Set TFTP_BENCH to 1 in lwipopts.h to measure the throughput
+ *           over the loop interface across block and window sizes.
+ *
  * @note     TIMER11 has been assigned to FreeRTOS kernel.
  *
  * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
@@ -192,6 +204,55 @@ void SYS_Init()
     SYS->IPRST0 = SYS_IPRST0_HWSEMRST_Msk;
     SYS->IPRST0 = 0;
 
+    /* Enable SD host clocks, received files are stored on the card */
+    CLK_EnableModuleClock(SD0_MODULE);
+    CLK_EnableModuleClock(SD1_MODULE);
+    CLK_EnableModuleClock(GPJ_MODULE);
+
+    /* Set SD0 MFP */
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC0MFP_Msk)) | SYS_GPC_MFPL_PC0MFP_SD0_CMD;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC1MFP_Msk)) | SYS_GPC_MFPL_PC1MFP_SD0_CLK;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC2MFP_Msk)) | SYS_GPC_MFPL_PC2MFP_SD0_DAT0;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC3MFP_Msk)) | SYS_GPC_MFPL_PC3MFP_SD0_DAT1;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC4MFP_Msk)) | SYS_GPC_MFPL_PC4MFP_SD0_DAT2;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC5MFP_Msk)) | SYS_GPC_MFPL_PC5MFP_SD0_DAT3;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC6MFP_Msk)) | SYS_GPC_MFPL_PC6MFP_SD0_nCD;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC7MFP_Msk)) | SYS_GPC_MFPL_PC7MFP_SD0_WP;
+
+    /* Set SD1 MFP */
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ0MFP_Msk)) | SYS_GPJ_MFPL_PJ0MFP_eMMC1_DAT4;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ1MFP_Msk)) | SYS_GPJ_MFPL_PJ1MFP_eMMC1_DAT5;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ2MFP_Msk)) | SYS_GPJ_MFPL_PJ2MFP_eMMC1_DAT6;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ3MFP_Msk)) | SYS_GPJ_MFPL_PJ3MFP_eMMC1_DAT7;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ4MFP_Msk)) | SYS_GPJ_MFPL_PJ4MFP_SD1_WP;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ5MFP_Msk)) | SYS_GPJ_MFPL_PJ5MFP_SD1_nCD;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ6MFP_Msk)) | SYS_GPJ_MFPL_PJ6MFP_eMMC1_CMD;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ7MFP_Msk)) | SYS_GPJ_MFPL_PJ7MFP_eMMC1_CLK;
+    SYS->GPJ_MFPH = (SYS->GPJ_MFPH & (~SYS_GPJ_MFPH_PJ8MFP_Msk)) | SYS_GPJ_MFPH_PJ8MFP_eMMC1_DAT0;
+    SYS->GPJ_MFPH = (SYS->GPJ_MFPH & (~SYS_GPJ_MFPH_PJ9MFP_Msk)) | SYS_GPJ_MFPH_PJ9MFP_eMMC1_DAT1;
+    SYS->GPJ_MFPH = (SYS->GPJ_MFPH & (~SYS_GPJ_MFPH_PJ10MFP_Msk)) | SYS_GPJ_MFPH_PJ10MFP_eMMC1_DAT2;
+    SYS->GPJ_MFPH = (SYS->GPJ_MFPH & (~SYS_GPJ_MFPH_PJ11MFP_Msk)) | SYS_GPJ_MFPH_PJ11MFP_eMMC1_DAT3;
+
+    /* PJ Driver Strength */
+    GPIO_SetDriveStrength(PJ,  0, 1);
+    GPIO_SetDriveStrength(PJ,  1, 1);
+    GPIO_SetDriveStrength(PJ,  2, 1);
+    GPIO_SetDriveStrength(PJ,  3, 1);
+    GPIO_SetDriveStrength(PJ,  6, 4);
+    GPIO_SetDriveStrength(PJ,  7, 7);
+    GPIO_SetDriveStrength(PJ,  8, 1);
+    GPIO_SetDriveStrength(PJ,  9, 1);
+    GPIO_SetDriveStrength(PJ, 10, 1);
+    GPIO_SetDriveStrength(PJ, 11, 1);
+
+    /* PC Driver Strength */
+    GPIO_SetDriveStrength(PC,  0, 2);
+    GPIO_SetDriveStrength(PC,  1, 2);
+    GPIO_SetDriveStrength(PC,  2, 2);
+    GPIO_SetDriveStrength(PC,  3, 2);
+    GPIO_SetDriveStrength(PC,  4, 2);
+    GPIO_SetDriveStrength(PC,  5, 2);
+
     /* Lock protected registers */
     SYS_LockReg();
 }
@@ -235,7 +296,16 @@ static void vNetTask( void *pvParameters )
     sysprintf("Subnet mask:     %s\n", ip4addr_ntoa(&netif.netmask));
     sysprintf("Default gateway: %s\n", ip4addr_ntoa(&netif.gw));
 
-    tftp_server_init();
+    /* Open the SD card before the server starts */
+    SDH_Reset(SDH);
+    SDH_Open(SDH);
+    if (SDH_Probe(SDH) != 0)
+        sysprintf("SD initial fail!!\n");
+
+    tftp_server_init(SDH);
+#if TFTP_BENCH
+    tftp_bench_init();
+#endif
 
     vTaskSuspend( NULL );
 }
@@ -1,101 +1,225 @@
 /*************************************************************************//**
  * @file     tftp.c
  * @version  V1.00
- * @brief    A simple TFTP source file.
+ * @brief    A TFTP server with blksize, windowsize and tsize options.
+ *
+ *           Each request is served from a new port (its TID), one at a
+ *           time. Written files stream through the double-buffered writer
+ *           into a FAT file on the SD card, or into the RAM staging image.
  *
  * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
 *****************************************************************************/
+#include "NuMicro.h"
 #include "lwip/opt.h"
 #include "lwip/arch.h"
 #include "lwip/api.h"
+#include "lwip/sys.h"
 #include "string.h"
 #include "tftp.h"
+#include "tftp_xfer.h"
+#if TFTP_STORE_FATFS
+#include "ff.h"
+#endif
 
 
 #define TFTP_THREAD_PRIO       ( tskIDLE_PRIORITY + 2UL )
-#define TFTP_THREAD_STACKSIZE  ( 200UL )
+#define TFTP_THREAD_STACKSIZE  ( 1024UL )
 
-#ifndef MIN
-#define MIN(a, b)   (a) < (b) ? (a) : (b)
-#endif
+/* Longest request accepted, file name and options included */
+#define TFTP_REQ_SIZE          256
 
 static struct netconn *conn;
-static unsigned short client_port;
-static ip_addr_t client_addr;
+static char s_req[TFTP_REQ_SIZE + 1];
 
-#define FILE_LEN        2048
-static uint32_t flen = FILE_LEN;
-static uint8_t file[FILE_LEN];
+/* Blocks in flight of a read request, sent from here by reference */
+static uint8_t s_win[TFTP_XFER_BUF_SIZE(TFTP_BLKSIZE_MAX, TFTP_WINDOW_MAX)] __attribute__((aligned(64)));
 
+#if TFTP_STORE_FATFS
+static FATFS s_fatfs;
+static FIL s_fil;
+static char s_drive[3];
+static int s_mounted;
+static char s_path[TFTP_REQ_SIZE + 4];
 
-void send_ack(uint16_t blk)
+/* File name of a request on the mounted card */
+static const char *tftp_path(const char *name)
 {
-    struct netbuf *nbuf;
-    uint16_t op = TFTP_OPCODE_ACK;
-    char *data;
-    /* Prepare data */
-    if((nbuf = netbuf_new()) == NULL)
-        return;
-    if((data = netbuf_alloc(nbuf, 4)) == NULL)      // op 2, ack blk 2
+    strcpy(s_path, s_drive);
+    if (name[0] != '/')
+        strcat(s_path, "/");
+    strcat(s_path, name);
+    return s_path;
+}
+#endif
+
+static void tftp_report(const char *what, const char *name, tftp_xfer_t *x, uint32_t ms)
+{
+    if (ms == 0)
+        ms = 1;
+    sysprintf("%s %s: %d bytes in %d ms, %d KB/s (blksize %d, windowsize %d, %d resent)\n",
+              what, name, x->bytes, ms, x->bytes / ms * 1000 / 1024,
+              x->opts.blksize, x->opts.windowsize, x->resent);
+}
+
+/**
+  * @brief  Serve a read request: send the file
+  * @param  x: transfer, options agreed
+  * @param  name: requested file, "ram" for the RAM staging image
+  * @retval None
+  */
+static void tftp_server_rrq(tftp_xfer_t *x, const char *name)
+{
+    tftp_read_fn read;
+    void *ctx = NULL;
+    uint32_t size, t0;
+    int ret;
+
+    if (strcmp(name, "ram") == 0)
     {
-        netbuf_delete(nbuf);
+        read = tftp_read_ram;
+        size = tftp_ram_len;
+    }
+#if TFTP_STORE_FATFS
+    else if (s_mounted && (f_open(&s_fil, tftp_path(name), FA_READ) == FR_OK))
+    {
+        read = tftp_read_fatfs;
+        ctx = &s_fil;
+        size = f_size(&s_fil);
+    }
+#endif
+    else
+    {
+        tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_FILE_NOT_FOUND, "File not found");
         return;
     }
-    *(uint16_t *)data = lwip_htons(op);
-    *(uint16_t *)(data + 2) = lwip_htons(blk);
 
-    /* Send the packet */
-    netconn_sendto(conn, nbuf, &client_addr, client_port);
+    /* Options go out in an OACK, the data after its ACK 0 */
+    if (x->opts.mask)
+    {
+        x->opts.tsize = size;
+        x->oack_sent = 1;
+        tftp_send_oack(x);
+    }
+
+    t0 = sys_now();
+    ret = tftp_xfer_send(x, read, ctx, size, s_win);
+    if (ret == 0)
+        tftp_report("Sent", name, x, sys_now() - t0);
 
-    /* Free the buffer */
-    netbuf_delete(nbuf);
+#if TFTP_STORE_FATFS
+    if (ctx != NULL)
+        f_close(&s_fil);
+#endif
 }
 
-void send_data(uint16_t blk, uint8_t *buf, uint16_t len)
+/**
+  * @brief  Serve a write request: receive the file into storage
+  * @param  x: transfer, options agreed
+  * @param  name: file to write. "null" discards the data, "ram" (or any
+  *         name without a card) goes to the RAM staging image.
+  * @retval None
+  */
+static void tftp_server_wrq(tftp_xfer_t *x, const char *name)
 {
-    struct netbuf *nbuf;
-    char *data;
-    /* Prepare data */
-    if((nbuf = netbuf_new()) == NULL)
+    const tftp_sink_t *sink = &tftp_sink_ram;
+    void *ctx = NULL;
+    const char *path = name;
+    uint32_t t0;
+    int ret;
+
+    if (strcmp(name, "null") == 0)
+    {
+        sink = &tftp_sink_null;
+    }
+#if TFTP_STORE_FATFS
+    else if (s_mounted && (strcmp(name, "ram") != 0))
+    {
+        sink = &tftp_sink_fatfs;
+        ctx = &s_fil;
+        path = tftp_path(name);
+    }
+#endif
+
+    if (tftp_store_begin(sink, ctx, path, x->opts.tsize) != 0)
+    {
+        tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_DISK_FULL, "Cannot store file");
         return;
-    if((data = netbuf_alloc(nbuf, len + 4)) == NULL)    // op 2, blk 2
+    }
+
+    /* Options go out in an OACK, otherwise ACK 0 asks for the data */
+    if (x->opts.mask)
     {
-        netbuf_delete(nbuf);
+        x->oack_sent = 1;
+        tftp_send_oack(x);
+    }
+    else
+    {
+        tftp_send_ack(x, 0);
+    }
+
+    t0 = sys_now();
+    ret = tftp_xfer_recv(x, NULL);
+
+    /* The last block is acknowledged once the file is on storage */
+    if (tftp_store_end(ret == 0) != 0)
+    {
+        if (ret == 0)
+            tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_DISK_FULL, "Write error");
         return;
     }
-    *(uint16_t *)data = lwip_htons(TFTP_OPCODE_DATA);
-    *(uint16_t *)(data + 2) = lwip_htons(blk);
-    memcpy(data + 4, (void *)buf, len);
-    /* Send the packet */
-    netconn_sendto(conn, nbuf, &client_addr, client_port);
-
-    /* Free the buffer */
-    netbuf_delete(nbuf);
+    tftp_xfer_done(x);
+    tftp_report("Received", name, x, sys_now() - t0);
 }
 
-void send_err(ip_addr_t *addr, unsigned short port, uint16_t err)
+/**
+  * @brief  Serve one RRQ or WRQ from a new port
+  * @param  op: TFTP_OPCODE_RRQ or TFTP_OPCODE_WRQ
+  * @param  req: request after the opcode
+  * @param  len: bytes at req
+  * @retval None
+  */
+static void tftp_server_request(uint16_t op, char *req, int len, const ip_addr_t *addr, u16_t port)
 {
-    struct netbuf *nbuf;
-    char *data;
-    /* Prepare data */
-    if((nbuf = netbuf_new()) == NULL)
+    tftp_xfer_t x;
+    tftp_opts_t opts;
+    char *name;
+
+    if (tftp_parse_request(req, len, &name, &opts) != 0)
+    {
+        tftp_send_error(conn, addr, port, TFTP_ERROR_ILLEGAL_OPERATION, "Octet mode only");
         return;
-    if((data = netbuf_alloc(nbuf, 8)) == NULL)      // op 2, err code 2, msg 4
+    }
+    if ((name[0] == 0) || (strstr(name, "..") != NULL) || (strchr(name, ':') != NULL))
     {
-        netbuf_delete(nbuf);
+        tftp_send_error(conn, addr, port, TFTP_ERROR_ACCESS_VIOLATION, "Bad file name");
+        return;
+    }
+
+    memset(&x, 0, sizeof(x));
+    x.opts = opts;
+    x.conn = netconn_new(NETCONN_UDP);
+    if (x.conn == NULL)
+        return;
+    /* A port of its own: the TID of the transfer */
+    if (netconn_bind(x.conn, NULL, 0) != ERR_OK)
+    {
+        netconn_delete(x.conn);
         return;
     }
-    *(uint16_t *)data = lwip_htons(TFTP_OPCODE_ERROR);
-    *(uint16_t *)(data + 2) = lwip_htons(err);
-    data[4] = 'E';
-    data[5] = 'R';
-    data[6] = 'R';
-    data[7] = 0x00;
-    /* Send the packet */
-    netconn_sendto(conn, nbuf, addr, port);
-
-    /* Free the buffer */
-    netbuf_delete(nbuf);
+    ip_addr_copy(x.addr, *addr);
+    x.port = port;
+
+    /* Take the options down to what this end and, when receiving, its
+       GMAC receive ring can hold */
+    tftp_opts_clamp(&x.opts, op == TFTP_OPCODE_WRQ);
+
+    sysprintf("Received %s %s\n", (op == TFTP_OPCODE_RRQ) ? "RRQ" : "WRQ", name);
+    if (op == TFTP_OPCODE_RRQ)
+        tftp_server_rrq(&x, name);
+    else
+        tftp_server_wrq(&x, name);
+
+    netconn_delete(x.conn);
 }
 
 /**
@@ -105,18 +229,11 @@ void send_err(ip_addr_t *addr, unsigned short port, uint16_t err)
   */
 static void tftp_thread(void *arg)
 {
-
     err_t err;
     struct netbuf *nbuf;
-    uint8_t *data, *payload;
-    ip_addr_t *get_addr;
-    unsigned short get_port;
-    uint16_t payload_len;
-
-    uint16_t state = TFTP_STATE_IDLE;
-    uint16_t op, blk;
-    int retry, remain;
-
+    ip_addr_t addr;
+    u16_t port, len;
+    uint16_t op;
 
     /* Create a new UDP connection handle */
     conn = netconn_new(NETCONN_UDP);
@@ -126,9 +243,6 @@ static void tftp_thread(void *arg)
         while(1);
     }
 
-    /* Set Rx timeout */
-    netconn_set_recvtimeout(conn, TFTP_TIMEOUT);
-
     /* Bind to port 69 with default IP address */
     err = netconn_bind(conn, NULL, TFTP_PORT);
 
@@ -140,201 +254,64 @@ static void tftp_thread(void *arg)
 
     while(1)
     {
-        err = netconn_recv(conn, &nbuf);
-        if(err == ERR_TIMEOUT)
-        {
-            if(state == TFTP_STATE_IDLE)
-                continue;
-
-            if(++retry > TFTP_MAX_RETRIES)
-            {
-                sysprintf("Exceed retry count, reset to idle state\n");
-                retry = 0;
-                state = TFTP_STATE_IDLE;
-                continue;
-            }
-            /* Packet was likely lost */
-            if(state == TFTP_STATE_RRQ)
-            {
-                sysprintf("Timeout, resend data %d\n", retry);
-                send_data(blk, (void *)data, MIN(remain, TFTP_BLOCK_LENGTH));
-                continue;
-            }
-            else
-            {
-                sysprintf("Timeout, resend ack %d\n", retry);
-                send_ack(blk);
-                continue;
-            }
-        }
-        else if(err != ERR_OK)
-        {
+        if (netconn_recv(conn, &nbuf) != ERR_OK)
             continue;
-        }
-
-        retry = 0;
 
-        /* Get destination IP address and port*/
-        get_addr = netbuf_fromaddr(nbuf);
-        get_port = netbuf_fromport(nbuf);
-        /* Get the payload and length */
-        netbuf_data(nbuf, (void**)&payload, &payload_len);
+        /* Get source IP address, port and the request */
+        ip_addr_copy(addr, *netbuf_fromaddr(nbuf));
+        port = netbuf_fromport(nbuf);
+        len = netbuf_copy(nbuf, s_req, TFTP_REQ_SIZE);
+        netbuf_delete(nbuf);
 
-        op = lwip_ntohs(*(uint16_t *)payload);
+        if (len < 4)
+            continue;
+        s_req[len] = 0;
+        op = ((uint8_t)s_req[0] << 8) | (uint8_t)s_req[1];
 
         switch(op)
         {
             case TFTP_OPCODE_RRQ:
             case TFTP_OPCODE_WRQ:
-                if(state == TFTP_STATE_IDLE)
-                {
-                    /* New request comes in, save client's address and port number */
-                    memcpy((void *)&client_addr, get_addr, sizeof(ip_addr_t));
-                    client_port = get_port;
-                    /* This sample does not check file name and mode */
-                    if(op == TFTP_OPCODE_RRQ)
-                    {
-                        sysprintf("Received RRQ\n");
-                        blk = 1;
-                        data = file;
-                        remain = flen;
-                        state = TFTP_STATE_RRQ;
-                        send_data(blk, data, MIN(remain, TFTP_BLOCK_LENGTH));
-                    }
-                    else
-                    {
-                        sysprintf("Received WRQ\n");
-                        /* ACK for WRQ must be 0 */
-                        blk = 0;
-                        state = TFTP_STATE_WRQ;
-                        send_ack(blk);
-                    }
-                }
-                else
-                {
-                    /* Be patient, one client at a time.  */
-                    send_err(get_addr, get_port, TFTP_ERROR_ACCESS_VIOLATION);
-                }
-                break;
-
-            case TFTP_OPCODE_DATA:
-                if((get_port != client_port) || memcmp(get_addr, &client_addr, sizeof(ip_addr_t)) || (state != TFTP_STATE_WRQ))
-                {
-                    send_err(get_addr, get_port, TFTP_ERROR_ILLEGAL_OPERATION);
-                }
-                else
-                {
-                    uint16_t new_blk = lwip_ntohs(*(uint16_t *)(payload + 2));
-
-                    if(new_blk == blk)
-                    {
-                        /* Last ACK lost */
-                        send_ack(blk);
-                    }
-                    if(new_blk == blk + 1)
-                    {
-                        int i;
-                        uint8_t *c = payload + 4;
-                        // Dump received data */
-                        for(i = 0; i < payload_len - 4; i++)
-                        {
-                            if((i & 0xF) == 0)
-                                sysprintf("\n");
-                            sysprintf("%02x ", *c++);
-                        }
-
-                        blk = new_blk;
-                        send_ack(blk);
-                        if(payload_len < TFTP_BLOCK_LENGTH + 4)
-                        {
-                            /* This is the last data packet, all done */
-                            sysprintf("Done\n");
-                            state = TFTP_STATE_IDLE;
-                        }
-                    }
-                    else
-                    {
-                        /* Wrong ack # */
-                        sysprintf("Unknown ID number\n");
-                        send_err(get_addr, get_port, TFTP_ERROR_UNKNOWN_ID);
-                        state = TFTP_STATE_IDLE;
-                    }
-                }
-                break;
-
-            case TFTP_OPCODE_ACK:
-                if((get_port != client_port) || memcmp(get_addr, &client_addr, sizeof(ip_addr_t)) || (state != TFTP_STATE_RRQ))
-                {
-                    send_err(get_addr, get_port, TFTP_ERROR_ILLEGAL_OPERATION);
-                }
-                else
-                {
-                    uint16_t new_blk = lwip_ntohs(*(uint16_t *)(payload + 2));
-
-                    if(new_blk == (blk - 1))
-                    {
-                        /* Last packet was lost */
-                        send_data(blk, data, MIN(remain, TFTP_BLOCK_LENGTH));
-                    }
-                    else if(new_blk == blk)
-                    {
-                        remain -= TFTP_BLOCK_LENGTH;
-                        if(remain < 0)  /* Still need to send a 0 data packet if remain is 0 */
-                        {
-                            /* All done */
-                            sysprintf("\nDone\n");
-                            state = TFTP_STATE_IDLE;
-                        }
-                        else
-                        {
-                            blk++;
-                            data += TFTP_BLOCK_LENGTH;
-                            sysprintf(".");
-                            send_data(blk, data, MIN(remain, TFTP_BLOCK_LENGTH));
-                        }
-                    }
-                    else
-                    {
-                        /* Wrong ack # */
-                        sysprintf("Unknown ID number\n");
-                        send_err(get_addr, get_port, TFTP_ERROR_UNKNOWN_ID);
-                        state = TFTP_STATE_IDLE;
-                    }
-                }
+                /* Requests that arrive meanwhile wait in the mailbox */
+                tftp_server_request(op, s_req + 2, len - 2, &addr, port);
                 break;
             case TFTP_OPCODE_ERROR:
-                /* Reset to idle state iff this packet is from our client */
-                if((get_port == client_port) || !memcmp(get_addr, &client_addr, sizeof(ip_addr_t)))
-                {
-                    state = TFTP_STATE_IDLE;
-                    sysprintf("Received ERR: %d\n", lwip_ntohs(*(uint16_t *)(payload + 2)));
-                }
                 break;
             default:
-                /* Reset to idle state iff this packet is from our client */
-                if((get_port == client_port) || !memcmp(get_addr, &client_addr, sizeof(ip_addr_t)))
-                {
-                    sysprintf("Received unknown op code\n");
-                    send_err(get_addr, get_port, TFTP_ERROR_ILLEGAL_OPERATION);
-                    state = TFTP_STATE_IDLE;
-                }
+                /* Anything else on port 69 belongs to no transfer */
+                tftp_send_error(conn, &addr, port, TFTP_ERROR_UNKNOWN_ID, "Unknown transfer ID");
                 break;
         }
-
-        netbuf_delete(nbuf);
     }
 }
 
 /**
   * @brief  Initialize the TFTP server (start its thread)
-  * @param  none
+  * @param  sdh: SD host with the card files are stored on, probed and
+  *         opened by the caller, or NULL to keep files in RAM only
   * @retval None
   */
-void tftp_server_init(void)
+void tftp_server_init(SDH_T *sdh)
 {
-    int i;
+    uint32_t i;
+
+    /* The RAM image starts out as a test pattern, served as "ram" */
+    for(i = 0; i < TFTP_RAM_SIZE; i++)
+        tftp_ram_image[i] = i & 0xFF;
+    tftp_ram_len = TFTP_RAM_SIZE;
+
+#if TFTP_STORE_FATFS
+    if ((sdh != NULL) && (SDH_GET_CARD_CAPACITY(sdh) != 0))
+    {
+        s_drive[0] = (sdh == SDH0) ? '0' : '1';
+        s_drive[1] = ':';
+        s_drive[2] = 0;
+        s_mounted = (f_mount(&s_fatfs, s_drive, 1) == FR_OK);
+    }
+    if (!s_mounted)
+        sysprintf("No FAT volume on the SD card, files are kept in RAM\n");
+#endif
 
-    for(i = 0; i < FILE_LEN; i++)
-        file[i] = i & 0xFF;
+    tftp_store_init();
     sys_thread_new("TFTP", tftp_thread, NULL, TFTP_THREAD_STACKSIZE, TFTP_THREAD_PRIO);
 }
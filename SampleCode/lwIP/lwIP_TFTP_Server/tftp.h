@@ -8,17 +8,50 @@
 #ifndef __TFTP_H__
 #define __TFTP_H__
 
+#include "NuMicro.h"
+#include "lwip/opt.h"
 
 #define TFTP_OPCODE_RRQ         1
 #define TFTP_OPCODE_WRQ         2
 #define TFTP_OPCODE_DATA        3
 #define TFTP_OPCODE_ACK         4
 #define TFTP_OPCODE_ERROR       5
+#define TFTP_OPCODE_OACK        6       // RFC 2347 option acknowledgment
 
 #define TFTP_PORT               69
 #define TFTP_TIMEOUT            500    //msec
 #define TFTP_MAX_RETRIES        5
-#define TFTP_BLOCK_LENGTH       512
+#define TFTP_BLOCK_LENGTH       512     // without the blksize option
+
+/* Options negotiated by RRQ/WRQ and OACK: blksize (RFC 2348), windowsize
+   (RFC 7440) and tsize (RFC 2349). A request without options, or a peer
+   that answers it without an OACK, gets 512-byte blocks, one at a time. */
+#define TFTP_BLKSIZE_MIN        8
+#define TFTP_BLKSIZE_MAX        8192
+#define TFTP_WINDOW_MAX         16
+
+/* Options asked for by this end */
+#ifndef TFTP_BLKSIZE
+#define TFTP_BLKSIZE            TFTP_BLKSIZE_MAX
+#endif
+#ifndef TFTP_WINDOWSIZE
+#define TFTP_WINDOWSIZE         8
+#endif
+
+/* Frames of one block on the wire: blocks over 1468 bytes are IP fragments */
+#define TFTP_BLOCK_FRAMES(blksize)  (((blksize) + 4 + 8 + 1480 - 1) / 1480)
+
+/* Received frames point into the GMAC receive ring (ethernetif.c) until the
+   block is copied out; a window must stay well inside the ring */
+#define TFTP_RX_FRAMES          (RECEIVE_DESC_SIZE / 2)
+
+/* Bytes the double-buffered writer hands to storage at a time */
+#ifndef TFTP_STORE_BUF_SIZE
+#define TFTP_STORE_BUF_SIZE     (64 * 1024)
+#endif
+
+/* Written files go to the FAT volume on the SD card */
+#define TFTP_STORE_FATFS        1
 
 enum tftp_error
 {
@@ -29,7 +62,8 @@ enum tftp_error
     TFTP_ERROR_ILLEGAL_OPERATION,   // 4
     TFTP_ERROR_UNKNOWN_ID,          // 5
     TFTP_ERROR_FILE_EXISTS,         // 6
-    TFTP_ERROR_NO_SUCH_USER         // 7
+    TFTP_ERROR_NO_SUCH_USER,        // 7
+    TFTP_ERROR_OPTION               // 8, RFC 2347
 };
 
 enum tftp_state
@@ -39,6 +73,9 @@ enum tftp_state
     TFTP_STATE_RRQ,                 // 2
 };
 
-void tftp_server_init(void);
+void tftp_server_init(SDH_T *sdh);
+#if TFTP_BENCH
+void tftp_bench_init(void);
+#endif
 
 #endif // __TFTP_H__
@@ -0,0 +1,174 @@
+/*************************************************************************//**
+ * @file     tftp_bench.c
+ * @version  V1.00
+ * @brief    Loopback throughput bench of the TFTP server.
+ *
+ *           Once the server is up, a client task puts TFTP_BENCH_SIZE bytes
+ *           of the RAM image to the server's "null" file and gets the "ram"
+ *           file back, over 127.0.0.1, for each block size and window size
+ *           in the tables below. Both ends run on this CPU, so the numbers
+ *           show what the stack and the transfer engine cost, not the wire.
+ *
+ *           Build with TFTP_BENCH set to 1 (lwipopts.h).
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include "FreeRTOS.h"
+#include "task.h"
+#include "lwip/opt.h"
+#include "lwip/arch.h"
+#include "lwip/api.h"
+#include "lwip/sys.h"
+#include "string.h"
+#include "tftp.h"
+#include "tftp_xfer.h"
+
+#if TFTP_BENCH
+
+#define TFTP_BENCH_PRIO        ( tskIDLE_PRIORITY + 1UL )
+#define TFTP_BENCH_STACKSIZE   ( 1024UL )
+
+/* Bytes per transfer */
+#ifndef TFTP_BENCH_SIZE
+#define TFTP_BENCH_SIZE        (TFTP_RAM_SIZE)
+#endif
+
+static const uint16_t s_blksize[] = { 512, 1428, 4096, 8192 };
+static const uint16_t s_window[] = { 1, 2, 4, 8, 16 };
+
+static uint8_t s_win[TFTP_XFER_BUF_SIZE(TFTP_BLKSIZE_MAX, TFTP_WINDOW_MAX)] __attribute__((aligned(64)));
+
+/* KB/s of a transfer, 0 if it failed */
+static uint32_t tftp_bench_rate(tftp_xfer_t *x, int ret, uint32_t t0)
+{
+    uint32_t ms = sys_now() - t0;
+
+    if ((ret != 0) || (x->bytes != TFTP_BENCH_SIZE))
+        return 0;
+    if (ms == 0)
+        ms = 1;
+    return x->bytes / ms * 1000 / 1024;
+}
+
+/* A new TID for every transfer, as a client should */
+static int tftp_bench_open(tftp_xfer_t *x)
+{
+    x->port = TFTP_PORT;
+    x->conn = netconn_new(NETCONN_UDP);
+    if (x->conn == NULL)
+        return -1;
+    if (netconn_bind(x->conn, NULL, 0) != ERR_OK)
+    {
+        netconn_delete(x->conn);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+  * @brief  Put TFTP_BENCH_SIZE bytes to the "null" file
+  * @retval KB/s, 0 on failure
+  */
+static uint32_t tftp_bench_put(tftp_xfer_t *x, const tftp_opts_t *asked)
+{
+    struct netbuf *first;
+    uint32_t t0 = sys_now(), rate;
+    int ret;
+
+    if (tftp_bench_open(x) != 0)
+        return 0;
+    ret = tftp_xfer_request(x, TFTP_OPCODE_WRQ, "null", asked, &first);
+    if (ret == 0)
+        ret = tftp_xfer_send(x, tftp_read_ram, NULL, TFTP_BENCH_SIZE, s_win);
+    rate = tftp_bench_rate(x, ret, t0);
+    netconn_delete(x->conn);
+
+    /* The server dallies after the last ACK before it takes the next request */
+    sys_msleep(TFTP_TIMEOUT + 100);
+    return rate;
+}
+
+/**
+  * @brief  Get the "ram" file, through the writer into the null sink
+  * @retval KB/s, 0 on failure
+  */
+static uint32_t tftp_bench_get(tftp_xfer_t *x, const tftp_opts_t *asked)
+{
+    struct netbuf *first;
+    uint32_t t0 = sys_now(), rate;
+    int ret;
+
+    if (tftp_bench_open(x) != 0)
+        return 0;
+    ret = tftp_xfer_request(x, TFTP_OPCODE_RRQ, "ram", asked, &first);
+    if (ret == 0)
+    {
+        tftp_store_begin(&tftp_sink_null, NULL, "ram", x->opts.tsize);
+        ret = tftp_xfer_recv(x, first);
+        if (tftp_store_end(ret == 0) != 0)
+            ret = -1;
+    }
+    rate = tftp_bench_rate(x, ret, t0);
+    if (ret == 0)
+        tftp_xfer_done(x);
+    netconn_delete(x->conn);
+    return rate;
+}
+
+/**
+  * @brief  Bench task: runs the tables once
+  * @param  arg: not used
+  * @retval None
+  */
+static void tftp_bench_thread(void *arg)
+{
+    tftp_xfer_t x;
+    tftp_opts_t asked;
+    uint32_t put, get;
+    uint16_t window;
+    unsigned int i, j;
+
+    memset(&x, 0, sizeof(x));
+    IP4_ADDR(&x.addr, 127, 0, 0, 1);
+
+    /* Let the server thread reach netconn_recv() */
+    sys_msleep(100);
+
+    sysprintf("\nTFTP loopback, %d bytes per transfer\n", TFTP_BENCH_SIZE);
+    sysprintf("blksize windowsize   put KB/s   get KB/s  resent\n");
+
+    for (i = 0; i < sizeof(s_blksize) / sizeof(s_blksize[0]); i++)
+    {
+        for (j = 0; j < sizeof(s_window) / sizeof(s_window[0]); j++)
+        {
+            tftp_opts_default(&asked);
+            asked.blksize = s_blksize[i];
+            asked.windowsize = s_window[j];
+            asked.mask = TFTP_OPT_BLKSIZE | TFTP_OPT_WINDOWSIZE | TFTP_OPT_TSIZE;
+
+            x.resent = 0;
+            asked.tsize = TFTP_BENCH_SIZE;
+            put = tftp_bench_put(&x, &asked);
+            /* The server bounds the window it receives, see tftp_opts_clamp() */
+            window = x.opts.windowsize;
+            asked.tsize = 0;
+            get = tftp_bench_get(&x, &asked);
+
+            sysprintf("%7d %10d %10d %10d %7d\n", asked.blksize, window, put, get, x.resent);
+        }
+    }
+
+    vTaskSuspend(NULL);
+}
+
+/**
+  * @brief  Start the bench task. Call after tftp_server_init().
+  * @param  none
+  * @retval None
+  */
+void tftp_bench_init(void)
+{
+    sys_thread_new("TFTPB", tftp_bench_thread, NULL, TFTP_BENCH_STACKSIZE, TFTP_BENCH_PRIO);
+}
+
+#endif /* TFTP_BENCH */
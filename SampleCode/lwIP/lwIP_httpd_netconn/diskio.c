@@ -0,0 +1,160 @@
+/*-----------------------------------------------------------------------*/
+/* Low level disk I/O module skeleton for FatFs     (C)ChaN, 2013        */
+/*-----------------------------------------------------------------------*/
+/* If a working storage control module is available, it should be        */
+/* attached to the FatFs via a glue function rather than modifying it.   */
+/* This is an example of glue functions to attach various exsisting      */
+/* storage control module to the FatFs module with a defined API.        */
+/*-----------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "diskio.h"     /* FatFs lower layer API */
+#include "ff.h"
+
+/* Bounce buffer for the sectors of a transfer to or from a buffer SDH DMA
+   cannot use. The HTTP server reads into aligned chunks and never needs it. */
+static uint32_t Tmp_Buffer[128] __attribute__((aligned(64)));
+
+#define SDH0_DRIVE      0        /* for SD0          */
+#define SDH1_DRIVE      1        /* for SD1          */
+
+static SDH_T *disk_sdh(BYTE pdrv)
+{
+    if (pdrv == SDH0_DRIVE)
+        return SDH0;
+    if (pdrv == SDH1_DRIVE)
+        return SDH1;
+    return NULL;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Initialize a Drive                                                    */
+/*-----------------------------------------------------------------------*/
+
+DSTATUS disk_initialize (BYTE pdrv)       /* Physical drive number (0..) */
+{
+    return disk_status(pdrv);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Get Disk Status                                                       */
+/*-----------------------------------------------------------------------*/
+
+DSTATUS disk_status (BYTE pdrv)       /* Physical drive number (0..) */
+{
+    SDH_T *sdh = disk_sdh(pdrv);
+
+    if ((sdh == NULL) || (SDH_GET_CARD_CAPACITY(sdh) == 0))
+        return STA_NOINIT;
+
+    return RES_OK;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Read Sector(s)                                                        */
+/*-----------------------------------------------------------------------*/
+
+DRESULT disk_read (
+    BYTE pdrv,      /* Physical drive number (0..) */
+    BYTE *buff,     /* Data buffer to store read data */
+    DWORD sector,   /* Sector address (LBA) */
+    UINT count      /* Number of sectors to read (1..128) */
+)
+{
+    SDH_T *sdh = disk_sdh(pdrv);
+    UINT   i;
+
+    if (sdh == NULL)
+        return RES_PARERR;
+
+    /* Sector-sized reads straight into the caller's buffer */
+    if ((ptr_to_u32(buff) % 4) == 0)
+        return SDH_Read(sdh, buff, sector, count) ? RES_ERROR : RES_OK;
+
+    for (i = 0; i < count; i++)
+    {
+        if (SDH_Read(sdh, (uint8_t *)Tmp_Buffer, sector + i, 1))
+            return RES_ERROR;
+        memcpy(buff + i * 512, Tmp_Buffer, 512);
+    }
+    return RES_OK;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Write Sector(s)                                                       */
+/*-----------------------------------------------------------------------*/
+
+DRESULT disk_write (
+    BYTE pdrv,          /* Physical drive number (0..) */
+    const BYTE *buff,   /* Data to be written */
+    DWORD sector,       /* Sector address (LBA) */
+    UINT count          /* Number of sectors to write (1..128) */
+)
+{
+    SDH_T *sdh = disk_sdh(pdrv);
+    UINT   i;
+
+    if (sdh == NULL)
+        return RES_PARERR;
+
+    if ((ptr_to_u32(buff) % 4) == 0)
+        return SDH_Write(sdh, (uint8_t *)buff, sector, count) ? RES_ERROR : RES_OK;
+
+    for (i = 0; i < count; i++)
+    {
+        memcpy(Tmp_Buffer, buff + i * 512, 512);
+        if (SDH_Write(sdh, (uint8_t *)Tmp_Buffer, sector + i, 1))
+            return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Miscellaneous Functions                                               */
+/*-----------------------------------------------------------------------*/
+
+DRESULT disk_ioctl (
+    BYTE pdrv,      /* Physical drive number (0..) */
+    BYTE cmd,       /* Control code */
+    void *buff      /* Buffer to send/receive control data */
+)
+{
+    SDH_INFO_T *pSD = (pdrv == SDH0_DRIVE) ? &SD0 : &SD1;
+    DRESULT res = RES_OK;
+
+    switch(cmd)
+    {
+    case CTRL_SYNC:
+        break;
+    case GET_SECTOR_COUNT:
+        *(DWORD*)buff = pSD->totalSectorN;
+        break;
+    case GET_SECTOR_SIZE:
+        *(WORD*)buff = pSD->sectorSize;
+        break;
+    default:
+        res = RES_PARERR;
+        break;
+    }
+    return res;
+}
+
+/*---------------------------------------------------------*/
+/* User Provided RTC Function for FatFs module             */
+/*---------------------------------------------------------*/
+/* The server only reads, any valid time will do.          */
+
+unsigned long get_fattime (void)
+{
+    return 0x00000;
+}
@@ -0,0 +1,548 @@
+/**************************************************************************//**
+ * @file     httpd_file.c
+ * @brief    File engine of the netconn HTTP server, see httpd_file.h
+ *
+ *           A request is answered from, in this order:
+ *             - the RAM cache
+ *             - the SD card. Files up to NU_HTTPD_CACHE_FILE_MAX are read
+ *               into a cache slot in one go and sent from there, larger
+ *               ones are streamed through the chunk ring of the task.
+ *             - fsdata.c
+ *
+ *           TCP keeps NETCONN_NOCOPY data by reference until the peer has
+ *           acknowledged it. The send buffer never holds more than
+ *           TCP_SND_BUF bytes, so everything written TCP_SND_BUF bytes
+ *           before the current end of the stream is acknowledged. A chunk
+ *           or cache slot is only reused once its data is that far behind,
+ *           or once the exact count from the send buffer says it is acked.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "NuMicro.h"
+#include "lwip/opt.h"
+#include "lwip/api.h"
+#include "lwip/tcp.h"
+#include "lwip/tcpip.h"
+#include "lwip/sys.h"
+#include "fs.h"
+#include "httpd_file.h"
+
+#if !LWIP_TCPIP_CORE_LOCKING
+#error "httpd_file.c reads the send buffer of its connections under LOCK_TCPIP_CORE"
+#endif
+
+#if (NU_HTTPD_CHUNK_SIZE % 512) != 0
+#error "NU_HTTPD_CHUNK_SIZE must be a multiple of the sector size"
+#endif
+
+/* Where a response body comes from */
+#define BODY_NONE       0
+#define BODY_ROM        1       /* fsdata.c */
+#define BODY_CACHE      2
+#define BODY_SD         3       /* streamed from s->fil */
+
+typedef struct
+{
+    int          src;           /* BODY_xxx */
+    const u8_t  *data;          /* BODY_ROM and BODY_CACHE */
+    u32_t        len;
+    int          slot;          /* BODY_CACHE */
+} httpd_body_t;
+
+typedef struct
+{
+    char    path[NU_HTTPD_PATH_MAX];
+    u32_t   len;
+    u32_t   last_use;
+    int     busy;               /* Connections with bytes of it in flight */
+    int     valid;
+} cache_slot_t;
+
+/* Chunks and cache slots start on a cache line, SDH_Read() invalidates the
+   lines it DMAs into */
+static __ALIGNED(64) u8_t s_chunk_pool[NU_HTTPD_WORKERS][NU_HTTPD_CHUNKS][NU_HTTPD_CHUNK_SIZE];
+#if NU_HTTPD_CACHE_SLOTS
+static __ALIGNED(64) u8_t s_cache_data[NU_HTTPD_CACHE_SLOTS][NU_HTTPD_CACHE_FILE_MAX];
+static cache_slot_t s_cache[NU_HTTPD_CACHE_SLOTS];
+static u32_t        s_cache_clock;
+#endif
+
+static FATFS        s_fatfs;
+static char         s_drive[3];
+static int          s_mounted;
+
+/* FatFs is built without FF_FS_REENTRANT, and fs.c and the cache are shared
+   by the server tasks */
+static sys_mutex_t  s_fs_lock;
+
+static const struct
+{
+    const char *ext;
+    const char *type;
+} s_mime[] =
+{
+    { "htm",  "text/html" },
+    { "html", "text/html" },
+    { "css",  "text/css" },
+    { "js",   "application/javascript" },
+    { "txt",  "text/plain" },
+    { "log",  "text/plain" },
+    { "jpg",  "image/jpeg" },
+    { "png",  "image/png" },
+    { "gif",  "image/gif" },
+    { "ico",  "image/x-icon" },
+    { "mp4",  "video/mp4" },
+    { "mp3",  "audio/mpeg" },
+    { "wav",  "audio/wav" },
+};
+
+static const char *mime_type(const char *path)
+{
+    const char *ext = strrchr(path, '.');
+    int i;
+
+    if (ext != NULL)
+    {
+        for (i = 0; i < sizeof(s_mime) / sizeof(s_mime[0]); i++)
+        {
+            if (lwip_stricmp(ext + 1, s_mime[i].ext) == 0)
+                return s_mime[i].type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+static const char *status_text(int status)
+{
+    switch (status)
+    {
+    case 200:
+        return "OK";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 431:
+        return "Request Header Fields Too Large";
+    case 501:
+        return "Not Implemented";
+    default:
+        return "Internal Server Error";
+    }
+}
+
+/*
+ * Stream offset up to which the peer has acknowledged everything
+ */
+static u32_t stream_acked(httpd_stream_t *s, struct netconn *conn)
+{
+    u32_t  queued = 0;
+
+    LOCK_TCPIP_CORE();
+    /* A connection lwIP has dropped holds no segments any more */
+    if (conn->pcb.tcp != NULL)
+        queued = TCP_SND_BUF - tcp_sndbuf(conn->pcb.tcp);
+    UNLOCK_TCPIP_CORE();
+
+    return s->written - queued;
+}
+
+/*
+ * Wait until the bytes before stream offset end are acknowledged. The first
+ * test settles it without locking whenever a send buffer's worth of data
+ * has been written since.
+ */
+static void stream_wait(httpd_stream_t *s, struct netconn *conn, u32_t end)
+{
+    if ((s32_t)(s->written - TCP_SND_BUF - end) >= 0)
+        return;
+
+    while ((s32_t)(stream_acked(s, conn) - end) < 0)
+        sys_msleep(1);
+}
+
+static err_t stream_write(httpd_stream_t *s, struct netconn *conn, const void *data,
+                          u32_t len, u8_t flags)
+{
+    err_t err;
+
+    err = netconn_write(conn, data, len, flags);
+    if (err == ERR_OK)
+        s->written += len;
+    return err;
+}
+
+/*
+ * Drop the cache references whose data is acknowledged up to offset acked
+ */
+static void stream_release(httpd_stream_t *s, u32_t acked)
+{
+#if NU_HTTPD_CACHE_SLOTS
+    int i;
+
+    sys_mutex_lock(&s_fs_lock);
+    for (i = 0; i < NU_HTTPD_CACHE_REFS; i++)
+    {
+        if ((s->ref[i].slot >= 0) && ((s32_t)(acked - s->ref[i].end) >= 0))
+        {
+            s_cache[s->ref[i].slot].busy--;
+            s->ref[i].slot = -1;
+        }
+    }
+    sys_mutex_unlock(&s_fs_lock);
+#endif
+}
+
+#if NU_HTTPD_CACHE_SLOTS
+/*
+ * Find a free reference, waiting for the oldest one to be acknowledged if
+ * all are in use
+ */
+static int stream_ref(httpd_stream_t *s, struct netconn *conn)
+{
+    int i, oldest = 0;
+
+    for (i = 0; i < NU_HTTPD_CACHE_REFS; i++)
+    {
+        if (s->ref[i].slot < 0)
+            return i;
+        if ((s32_t)(s->ref[i].end - s->ref[oldest].end) < 0)
+            oldest = i;
+    }
+    stream_wait(s, conn, s->ref[oldest].end);
+    stream_release(s, stream_acked(s, conn));
+    return oldest;
+}
+
+/*
+ * Look up path in the cache and pin the slot. Called with s_fs_lock held.
+ */
+static int cache_find(const char *path)
+{
+    int i;
+
+    for (i = 0; i < NU_HTTPD_CACHE_SLOTS; i++)
+    {
+        if (s_cache[i].valid && (strcmp(s_cache[i].path, path) == 0))
+        {
+            s_cache[i].busy++;
+            s_cache[i].last_use = ++s_cache_clock;
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Read the open file s->fil of len bytes into the least recently used idle
+ * slot and pin it. Called with s_fs_lock held. Returns -1 if every slot is
+ * in flight or the read fails.
+ */
+static int cache_fill(httpd_stream_t *s, const char *path, u32_t len)
+{
+    int   i, victim = -1;
+    UINT  br;
+
+    for (i = 0; i < NU_HTTPD_CACHE_SLOTS; i++)
+    {
+        if (s_cache[i].busy)
+            continue;
+        if (!s_cache[i].valid)
+        {
+            victim = i;
+            break;
+        }
+        if ((victim < 0) || ((s32_t)(s_cache[i].last_use - s_cache[victim].last_use) < 0))
+            victim = i;
+    }
+    if (victim < 0)
+        return -1;
+
+    s_cache[victim].valid = 0;
+    if ((f_read(&s->fil, s_cache_data[victim], len, &br) != FR_OK) || (br != len))
+        return -1;
+
+    strcpy(s_cache[victim].path, path);
+    s_cache[victim].len = len;
+    s_cache[victim].busy = 1;
+    s_cache[victim].last_use = ++s_cache_clock;
+    s_cache[victim].valid = 1;
+    return victim;
+}
+#endif
+
+/*
+ * Body of a file in fsdata.c without the HTTP header some of them carry
+ */
+static int rom_open(const char *path, httpd_body_t *b)
+{
+    struct fs_file  *file;
+    const char      *data, *end;
+    int              len;
+
+    file = fs_open(path);
+    if (file == NULL)
+        return -1;
+
+    data = file->data;
+    len = file->len;
+    if (file->http_header_included)
+    {
+        end = lwip_strnstr(data, "\r\n\r\n", len);
+        if (end != NULL)
+        {
+            len -= end + 4 - data;
+            data = end + 4;
+        }
+    }
+    fs_close(file);
+
+    b->src = BODY_ROM;
+    b->data = (const u8_t *)data;
+    b->len = len;
+    return 0;
+}
+
+static void body_open(httpd_stream_t *s, const char *path, httpd_body_t *b)
+{
+    char   sd_path[NU_HTTPD_PATH_MAX + 2];
+    u32_t  len;
+
+    b->src = BODY_NONE;
+    b->slot = -1;
+
+    sys_mutex_lock(&s_fs_lock);
+#if NU_HTTPD_CACHE_SLOTS
+    b->slot = cache_find(path);
+    if (b->slot >= 0)
+    {
+        b->src = BODY_CACHE;
+        b->data = s_cache_data[b->slot];
+        b->len = s_cache[b->slot].len;
+        sys_mutex_unlock(&s_fs_lock);
+        return;
+    }
+#endif
+
+    if (s_mounted)
+    {
+        strcpy(sd_path, s_drive);
+        strcat(sd_path, path);
+        if (f_open(&s->fil, sd_path, FA_READ) == FR_OK)
+        {
+            len = (u32_t)f_size(&s->fil);
+#if NU_HTTPD_CACHE_SLOTS
+            if (len <= NU_HTTPD_CACHE_FILE_MAX)
+                b->slot = cache_fill(s, path, len);
+            if (b->slot >= 0)
+            {
+                f_close(&s->fil);
+                b->src = BODY_CACHE;
+                b->data = s_cache_data[b->slot];
+                b->len = len;
+                sys_mutex_unlock(&s_fs_lock);
+                return;
+            }
+            f_lseek(&s->fil, 0);
+#endif
+            b->src = BODY_SD;
+            b->len = len;
+            sys_mutex_unlock(&s_fs_lock);
+            return;
+        }
+    }
+
+    rom_open(path, b);
+    sys_mutex_unlock(&s_fs_lock);
+}
+
+/*
+ * Stream the open file s->fil through the chunk ring
+ */
+static err_t body_send_sd(httpd_stream_t *s, struct netconn *conn, u32_t len)
+{
+    u8_t   *buf;
+    u32_t   n;
+    UINT    br;
+    FRESULT res;
+    err_t   err = ERR_OK;
+    int     c;
+
+    while (len)
+    {
+        c = s->next;
+        buf = s->chunk[c];
+        n = (len < NU_HTTPD_CHUNK_SIZE) ? len : NU_HTTPD_CHUNK_SIZE;
+
+        /* TCP may still reference what was read into this chunk last time */
+        stream_wait(s, conn, s->chunk_end[c]);
+
+        sys_mutex_lock(&s_fs_lock);
+        res = f_read(&s->fil, buf, n, &br);
+        sys_mutex_unlock(&s_fs_lock);
+
+        /* The header promised len bytes, the connection cannot go on */
+        if ((res != FR_OK) || (br != n))
+        {
+            err = ERR_ABRT;
+            break;
+        }
+
+        err = stream_write(s, conn, buf, n, NETCONN_NOCOPY | ((len > n) ? NETCONN_MORE : 0));
+        if (err != ERR_OK)
+            break;
+
+        s->chunk_end[c] = s->written;
+        s->next = (c + 1) % NU_HTTPD_CHUNKS;
+        len -= n;
+    }
+
+    sys_mutex_lock(&s_fs_lock);
+    f_close(&s->fil);
+    sys_mutex_unlock(&s_fs_lock);
+    return err;
+}
+
+static err_t send_header(httpd_stream_t *s, struct netconn *conn, int status,
+                         const char *type, u32_t len, int keep_alive, int more)
+{
+    int n;
+
+    n = snprintf(s->hdr, sizeof(s->hdr),
+                 "HTTP/1.1 %d %s\r\n"
+                 "Server: lwIP\r\n"
+                 "Content-Type: %s\r\n"
+                 "Content-Length: %lu\r\n"
+                 "Connection: %s\r\n\r\n",
+                 status, status_text(status), type, (unsigned long)len,
+                 keep_alive ? "keep-alive" : "close");
+
+    return stream_write(s, conn, s->hdr, n, NETCONN_COPY | (more ? NETCONN_MORE : 0));
+}
+
+err_t httpd_file_serve(httpd_stream_t *s, struct netconn *conn, const char *path,
+                       int head, int keep_alive)
+{
+    char          name[NU_HTTPD_PATH_MAX];
+    httpd_body_t  b;
+    int           status = 200;
+    int           i;
+    err_t         err;
+
+    b.src = BODY_NONE;
+    if (strlen(path) < sizeof(name) - sizeof("index.html"))
+    {
+        strcpy(name, path);
+        if (name[strlen(name) - 1] == '/')
+            strcat(name, "index.html");
+        body_open(s, name, &b);
+    }
+
+    if (b.src == BODY_NONE)
+    {
+        status = 404;
+        strcpy(name, "/404.html");
+        sys_mutex_lock(&s_fs_lock);
+        rom_open(name, &b);
+        sys_mutex_unlock(&s_fs_lock);
+        if (b.src == BODY_NONE)
+            return httpd_file_status(s, conn, 404);
+    }
+
+    err = send_header(s, conn, status, mime_type(name), b.len, keep_alive, !head && b.len);
+    if ((err != ERR_OK) || head)
+    {
+        if (b.src == BODY_SD)
+        {
+            sys_mutex_lock(&s_fs_lock);
+            f_close(&s->fil);
+            sys_mutex_unlock(&s_fs_lock);
+        }
+#if NU_HTTPD_CACHE_SLOTS
+        else if (b.src == BODY_CACHE)
+        {
+            /* Nothing of the slot went out */
+            sys_mutex_lock(&s_fs_lock);
+            s_cache[b.slot].busy--;
+            sys_mutex_unlock(&s_fs_lock);
+        }
+#endif
+        return err;
+    }
+
+    switch (b.src)
+    {
+    case BODY_SD:
+        err = body_send_sd(s, conn, b.len);
+        break;
+
+#if NU_HTTPD_CACHE_SLOTS
+    case BODY_CACHE:
+        i = stream_ref(s, conn);
+        err = stream_write(s, conn, b.data, b.len, NETCONN_NOCOPY);
+        /* Pinned until acknowledged, or until the connection is closed */
+        s->ref[i].slot = b.slot;
+        s->ref[i].end = s->written;
+        break;
+
+#endif
+    default:
+        /* fsdata.c is constant, nothing to keep track of */
+        err = stream_write(s, conn, b.data, b.len, NETCONN_NOCOPY);
+        break;
+    }
+
+    stream_release(s, s->written - TCP_SND_BUF);
+    return err;
+}
+
+err_t httpd_file_status(httpd_stream_t *s, struct netconn *conn, int status)
+{
+    return send_header(s, conn, status, "text/plain", 0, 0, 0);
+}
+
+void httpd_stream_closed(httpd_stream_t *s)
+{
+    int i;
+
+    /* netconn_close() lingered until the peer acknowledged everything, or
+       aborted the connection and freed its segments */
+    stream_release(s, s->written);
+
+    s->written = 0;
+    s->next = 0;
+    for (i = 0; i < NU_HTTPD_CHUNKS; i++)
+        s->chunk_end[i] = 0;
+}
+
+void httpd_stream_init(httpd_stream_t *s, int id)
+{
+    int i;
+
+    memset(s, 0, sizeof(*s));
+    for (i = 0; i < NU_HTTPD_CHUNKS; i++)
+        s->chunk[i] = s_chunk_pool[id][i];
+    for (i = 0; i < NU_HTTPD_CACHE_REFS; i++)
+        s->ref[i].slot = -1;
+}
+
+int httpd_file_init(SDH_T *sdh)
+{
+    if (sys_mutex_new(&s_fs_lock) != ERR_OK)
+        return -1;
+
+    s_drive[0] = (sdh == SDH0) ? '0' : '1';
+    s_drive[1] = ':';
+    s_drive[2] = 0;
+
+    if (SDH_GET_CARD_CAPACITY(sdh) == 0)
+        return -1;
+
+    if (f_mount(&s_fatfs, s_drive, 1) != FR_OK)
+        return -1;
+
+    s_mounted = 1;
+    return 0;
+}
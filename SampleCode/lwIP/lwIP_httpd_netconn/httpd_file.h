@@ -0,0 +1,112 @@
+/**************************************************************************//**
+ * @file     httpd_file.h
+ * @brief    File engine of the netconn HTTP server. Serves files from the
+ *           FAT volume on the SD card, from a RAM cache of small hot files
+ *           and from the files compiled into fsdata.c, without copying
+ *           the file data into lwIP.
+ *
+ *           Every byte of a response body goes out with NETCONN_NOCOPY:
+ *           the TCP segments point straight at the buffer FatFs read the
+ *           file into, at the cache slot, or at fsdata.c. Such a buffer is
+ *           only reused once TCP has the bytes acknowledged, which the
+ *           engine tracks per connection by counting the bytes written and
+ *           the free space of the send buffer.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __HTTPD_FILE_H__
+#define __HTTPD_FILE_H__
+
+#include "NuMicro.h"
+#include "lwip/api.h"
+#include "ff.h"
+
+/* Server tasks, each serving one connection at a time */
+#ifndef NU_HTTPD_WORKERS
+#define NU_HTTPD_WORKERS            4
+#endif
+
+/* Bytes read from the SD card and handed to TCP at a time. Multiple of the
+   512-byte sector so FatFs reads straight into the chunk. */
+#ifndef NU_HTTPD_CHUNK_SIZE
+#define NU_HTTPD_CHUNK_SIZE         (32 * 1024)
+#endif
+
+/* Chunks per connection: a full send buffer in flight, one being read and
+   one spare */
+#define NU_HTTPD_CHUNKS             ((TCP_SND_BUF + NU_HTTPD_CHUNK_SIZE - 1) / NU_HTTPD_CHUNK_SIZE + 2)
+
+/* RAM cache: number of files and largest file kept. 0 slots disable it. */
+#ifndef NU_HTTPD_CACHE_SLOTS
+#define NU_HTTPD_CACHE_SLOTS        8
+#endif
+#ifndef NU_HTTPD_CACHE_FILE_MAX
+#define NU_HTTPD_CACHE_FILE_MAX     (64 * 1024)
+#endif
+
+/* Cached files a connection may have in flight before it waits for ACKs */
+#define NU_HTTPD_CACHE_REFS         8
+
+/* Longest path of a request, without the drive prefix */
+#define NU_HTTPD_PATH_MAX           64
+
+/**
+ * @brief Per connection state of the engine. One per server task, it is
+ *        reused for every connection the task serves.
+ */
+typedef struct
+{
+    uint8_t    *chunk[NU_HTTPD_CHUNKS];     /*!< Ring of SD read buffers */
+    uint32_t    chunk_end[NU_HTTPD_CHUNKS]; /*!< Stream offset past the data of each chunk */
+    int         next;                       /*!< Chunk the next SD read goes to */
+    uint32_t    written;                    /*!< Bytes handed to TCP on this connection */
+    struct
+    {
+        int       slot;                     /*!< Cache slot, -1 if unused */
+        uint32_t  end;                      /*!< Stream offset past its data */
+    } ref[NU_HTTPD_CACHE_REFS];
+    FIL         fil;
+    char        hdr[256];
+} httpd_stream_t;
+
+/**
+ * @brief   Mount the SD card and set up the cache. Call once before the
+ *          server tasks start.
+ * @param   sdh  SDH0 or SDH1, probed and opened by the caller
+ * @return  0 if the card is mounted. The built-in files are served either way.
+ */
+int httpd_file_init(SDH_T *sdh);
+
+/**
+ * @brief   Give a server task its chunk ring. Call once per task.
+ * @param   s   Engine state of the task
+ * @param   id  Task number, 0 .. NU_HTTPD_WORKERS - 1
+ */
+void httpd_stream_init(httpd_stream_t *s, int id);
+
+/**
+ * @brief   Send the response to one request: status line, headers and,
+ *          unless head is set, the body of the file behind path.
+ * @param   s           Engine state of the task
+ * @param   conn        Connection to answer on
+ * @param   path        Absolute path of the request, "/" for the index
+ * @param   head        Nonzero for a HEAD request
+ * @param   keep_alive  Nonzero to announce that the connection stays open
+ * @return  ERR_OK, or the netconn error that makes the connection unusable
+ */
+err_t httpd_file_serve(httpd_stream_t *s, struct netconn *conn, const char *path,
+                       int head, int keep_alive);
+
+/**
+ * @brief   Send a response without a file, e.g. 400 or 501.
+ */
+err_t httpd_file_status(httpd_stream_t *s, struct netconn *conn, int status);
+
+/**
+ * @brief   Release what the connection still holds. Call after netconn_close()
+ *          has returned, which with SO_LINGER waits for every byte to be
+ *          acknowledged or aborts the connection.
+ */
+void httpd_stream_closed(httpd_stream_t *s);
+
+#endif /* __HTTPD_FILE_H__ */
@@ -1,11 +1,12 @@
-
-
 /* Includes ------------------------------------------------------------------*/
 #include "lwip/opt.h"
 #include "lwip/arch.h"
 #include "lwip/api.h"
-#include "fs.h"
+#include "lwip/tcp.h"
+#include "lwip/tcpip.h"
+#include "lwip/sys.h"
 #include "string.h"
+#include "httpd_file.h"
 #include "httpserver-netconn.h"
 
 
@@ -13,73 +14,219 @@
 /* Private define ------------------------------------------------------------*/
 #define WEBSERVER_THREAD_PRIO    ( tskIDLE_PRIORITY + 2UL )
 #define WEBSERVER_THREAD_STACKSIZE  400
+#define WEBSERVER_WORKER_STACKSIZE  1024
+
+/* Idle time after which a keep-alive connection is closed */
+#define WEBSERVER_KEEPALIVE_MS      5000
+/* Seconds netconn_close() waits for the peer to acknowledge the last response */
+#define WEBSERVER_LINGER_S          10
+/* Room for the request headers, and for requests pipelined behind them */
+#define WEBSERVER_REQ_SIZE          2048
+
+#if !LWIP_SO_RCVTIMEO || !LWIP_SO_LINGER
+#error "The HTTP server needs LWIP_SO_RCVTIMEO and LWIP_SO_LINGER"
+#endif
+
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 u32_t nPageHits = 0;
 
+typedef struct
+{
+    httpd_stream_t  stream;
+    char            req[WEBSERVER_REQ_SIZE + 1];
+    int             req_len;
+} http_worker_t;
+
+static http_worker_t  s_worker[NU_HTTPD_WORKERS];
+static sys_mbox_t     s_conn_mbox;
+
 
 /* Private function prototypes -----------------------------------------------*/
 /* Private functions ---------------------------------------------------------*/
 
+/**
+  * @brief  Find a header line in a request
+  * @param  req: request, up to and including the empty line
+  * @param  name: header name with the colon, e.g. "Connection:"
+  * @retval Start of the header value, or NULL
+  */
+static const char *http_header(const char *req, const char *name)
+{
+    const char *p = strstr(req, "\r\n");
+    size_t n = strlen(name);
+
+    while (p != NULL && p[2] != '\r')
+    {
+        p += 2;
+        if (lwip_strnicmp(p, name, n) == 0)
+        {
+            p += n;
+            while (*p == ' ')
+                p++;
+            return p;
+        }
+        p = strstr(p, "\r\n");
+    }
+    return NULL;
+}
+
+/**
+  * @brief  Answer one request
+  * @param  w: worker state
+  * @param  conn: connection the request came in on
+  * @param  req: request, NUL terminated after the empty line
+  * @param  keep_alive: set to nonzero if the connection stays open
+  * @retval ERR_OK if the connection can take the next request
+  */
+static err_t http_server_request(http_worker_t *w, struct netconn *conn, char *req, int *keep_alive)
+{
+    char *path, *end, *version;
+    const char *value;
+    int head;
+
+    nPageHits++;
+    *keep_alive = 0;
+
+    if (strncmp(req, "GET ", 4) == 0)
+    {
+        head = 0;
+        path = req + 4;
+    }
+    else if (strncmp(req, "HEAD ", 5) == 0)
+    {
+        head = 1;
+        path = req + 5;
+    }
+    else
+    {
+        httpd_file_status(&w->stream, conn, 501);
+        return ERR_ARG;
+    }
+
+    end = strchr(path, ' ');
+    if ((*path != '/') || (end == NULL))
+    {
+        httpd_file_status(&w->stream, conn, 400);
+        return ERR_ARG;
+    }
+    version = end + 1;
+    *end = 0;
+
+    /* No query strings, no way out of the document root */
+    end = strchr(path, '?');
+    if (end != NULL)
+        *end = 0;
+    if (strstr(path, "..") != NULL)
+    {
+        httpd_file_status(&w->stream, conn, 400);
+        return ERR_ARG;
+    }
+
+    /* HTTP/1.1 keeps the connection unless told otherwise, HTTP/1.0 only
+       when asked to */
+    value = http_header(version, "Connection:");
+    if (strncmp(version, "HTTP/1.1", 8) == 0)
+        *keep_alive = (value == NULL) || (lwip_strnicmp(value, "close", 5) != 0);
+    else
+        *keep_alive = (value != NULL) && (lwip_strnicmp(value, "keep-alive", 10) == 0);
+
+    return httpd_file_serve(&w->stream, conn, path, head, *keep_alive);
+}
+
 /**
   * @brief serve tcp connection
+  * @param w: worker state
   * @param conn: pointer on connection structure
   * @retval None
   */
-void http_server_serve(struct netconn *conn)
+static void http_server_serve(http_worker_t *w, struct netconn *conn)
 {
     struct netbuf *inbuf;
-    char* buf;
-    u16_t buflen;
-    struct fs_file * file;
+    char *req, *end;
+    int keep_alive = 1;
+    int used;
+    u16_t len;
+
+    netconn_set_recvtimeout(conn, WEBSERVER_KEEPALIVE_MS);
+    /* Keep the NOCOPY data referenced by TCP valid until it is acknowledged */
+    conn->linger = WEBSERVER_LINGER_S;
 
-    /* Read the data from the port, blocking if nothing yet there.
-     We assume the request (the part we care about) is in one netbuf */
-    netconn_recv(conn,&inbuf);
+    /* Responses go out as soon as they are written, pipelined or not */
+    LOCK_TCPIP_CORE();
+    if (conn->pcb.tcp != NULL)
+        tcp_nagle_disable(conn->pcb.tcp);
+    UNLOCK_TCPIP_CORE();
 
-    if (inbuf != NULL)
+    w->req_len = 0;
+    while (keep_alive)
     {
-        if (netconn_err(conn) == ERR_OK)
+        /* Answer every complete request in the buffer, in order */
+        req = w->req;
+        w->req[w->req_len] = 0;
+        while (keep_alive && ((end = strstr(req, "\r\n\r\n")) != NULL))
         {
-            netbuf_data(inbuf, (void**)&buf, &buflen);
+            end[2] = 0;
+            if (http_server_request(w, conn, req, &keep_alive) != ERR_OK)
+                keep_alive = 0;
+            req = end + 4;
+        }
+        if (!keep_alive)
+            break;
 
-            /* Is this an HTTP GET command? (only check the first 5 chars, since
-            there are other formats for GET, and we're keeping it very simple )*/
-            if ((buflen >=5) && (strncmp(buf, "GET /", 5) == 0))
-            {
-                /* Check if request to get m4.jpg */
-                if (strncmp((char const *)buf,"GET /img/m4.jpg", 15) == 0)
-                {
-                    /* Check if request to get M4 banner */
-                    file = fs_open("/img/m4.jpg");
-                    netconn_write(conn, (const unsigned char*)(file->data), (size_t)file->len, NETCONN_NOCOPY);
-                    fs_close(file);
-                }
-                else if((strncmp(buf, "GET /index.html", 15) == 0)||(strncmp(buf, "GET / ", 6) == 0))
-                {
-                    /* Load index page */
-                    file = fs_open("/index.html");
-                    netconn_write(conn, (const unsigned char*)(file->data), (size_t)file->len, NETCONN_NOCOPY);
-                    fs_close(file);
-                }
-                else
-                {
-                    /* Load Error page */
-                    file = fs_open("/404.html");
-                    netconn_write(conn, (const unsigned char*)(file->data), (size_t)file->len, NETCONN_NOCOPY);
-                    fs_close(file);
-                }
-            }
+        /* Keep the start of the next request */
+        used = req - w->req;
+        w->req_len -= used;
+        memmove(w->req, req, w->req_len);
+        if (w->req_len == WEBSERVER_REQ_SIZE)
+        {
+            httpd_file_status(&w->stream, conn, 431);
+            break;
         }
+
+        /* Read the data from the port, blocking until the keep-alive timeout */
+        if (netconn_recv(conn, &inbuf) != ERR_OK)
+            break;
+
+        len = netbuf_len(inbuf);
+        if (len > WEBSERVER_REQ_SIZE - w->req_len)
+            len = WEBSERVER_REQ_SIZE - w->req_len;
+        netbuf_copy(inbuf, w->req + w->req_len, len);
+        w->req_len += len;
+
+        /* Delete the buffer (netconn_recv gives us ownership,
+         so we have to make sure to deallocate the buffer) */
+        netbuf_delete(inbuf);
     }
-    /* Close the connection (server closes in HTTP) */
-    netconn_close(conn);
 
-    /* Delete the buffer (netconn_recv gives us ownership,
-     so we have to make sure to deallocate the buffer) */
-    netbuf_delete(inbuf);
+    /* Close the connection, after the peer has acknowledged the responses */
+    netconn_close(conn);
+    httpd_stream_closed(&w->stream);
 }
 
+/**
+  * @brief  http server worker, serves the connections the listener accepts
+  * @param arg: worker number
+  * @retval None
+  */
+static void http_server_worker_thread(void *arg)
+{
+    http_worker_t *w = &s_worker[(int)(intptr_t)arg];
+    struct netconn *conn;
+
+    httpd_stream_init(&w->stream, (int)(intptr_t)arg);
+
+    while(1)
+    {
+        sys_arch_mbox_fetch(&s_conn_mbox, (void **)&conn, 0);
+
+        /* serve connection */
+        http_server_serve(w, conn);
+
+        /* delete connection */
+        netconn_delete(conn);
+    }
+}
 
 /**
   * @brief  http server thread
@@ -107,14 +254,14 @@ static void http_server_netconn_thread(void *arg)
             while(1)
             {
                 /* accept any incoming connection */
-                netconn_accept(conn, &newconn);
+                if (netconn_accept(conn, &newconn) != ERR_OK)
+                    continue;
 
-                if(newconn)
+                /* hand it to an idle worker, or drop it if all are busy
+                   and the queue is full */
+                if (sys_mbox_trypost(&s_conn_mbox, newconn) != ERR_OK)
                 {
-                    /* serve connection */
-                    http_server_serve(newconn);
-
-                    /* delete connection */
+                    netconn_close(newconn);
                     netconn_delete(newconn);
                 }
             }
@@ -131,11 +278,23 @@ static void http_server_netconn_thread(void *arg)
 }
 
 /**
-  * @brief  Initialize the HTTP server (start its thread)
+  * @brief  Initialize the HTTP server (start its threads)
   * @param  none
   * @retval None
   */
 void http_server_netconn_init()
 {
+    int i;
+
+    if (sys_mbox_new(&s_conn_mbox, 2 * NU_HTTPD_WORKERS) != ERR_OK)
+    {
+        sysprintf("can not create mbox");
+        return;
+    }
+
+    for (i = 0; i < NU_HTTPD_WORKERS; i++)
+        sys_thread_new("HTTPW", http_server_worker_thread, (void *)(intptr_t)i,
+                       WEBSERVER_WORKER_STACKSIZE, WEBSERVER_THREAD_PRIO);
+
     sys_thread_new("HTTP", http_server_netconn_thread, NULL, WEBSERVER_THREAD_STACKSIZE, WEBSERVER_THREAD_PRIO);
 }
@@ -47,7 +47,6 @@
 
 #define NO_SYS                          0
 #define MEM_ALIGNMENT                   4
-#define LWIP_STATS                      0
 #define LWIP_SOCKET_SET_ERRNO           0
 #define LWIP_NETCONN                    1
 #define LWIP_SOCKET                     0
@@ -58,29 +57,19 @@
     #define LWIP_NOASSERT
 #endif
 
-/* TCP Maximum segment size. */
-#define TCP_MSS                         1460
 #define SSIZE_MAX                       65535
 
-#define MEMP_NUM_NETCONN                8
-#define MEM_SIZE                        10240
-#define MEMP_NUM_PBUF                   32
-#define PBUF_POOL_SIZE                  64
-#define TCP_WND                         16384 //Max: 65535
-#define TCP_SND_BUF                     TCP_WND
-#define TCP_SND_QUEUELEN                (4 * TCP_SND_BUF/TCP_MSS)
-#define MEMP_NUM_TCP_SEG                64
+/* Window scaling, core locking, pools for both GMACs, LWIP_STATS */
+#include "lwipopts_perf.h"
 
 /* Application */
 #define TCPIP_THREAD_STACKSIZE          400
 #define TCPIP_THREAD_PRIO               2
-#define TCPIP_MBOX_SIZE                 10
-#define DEFAULT_TCP_RECVMBOX_SIZE       5
-#define DEFAULT_ACCEPTMBOX_SIZE         5
-#define DEFAULT_UDP_RECVMBOX_SIZE       5
-#define DEFAULT_RAW_RECVMBOX_SIZE       5
+/* Keep-alive timeout and lingering close of the HTTP server */
+#define LWIP_SO_RCVTIMEO                1
+#define LWIP_SO_LINGER                  1
 
-#define LWIP_USING_HW_CHECKSUM          0
+#define LWIP_USING_HW_CHECKSUM          1
 /* ---------- Checksum options ---------- */
 #if (LWIP_USING_HW_CHECKSUM == 1)
 #define CHECKSUM_GEN_IP                 0
@@ -5,6 +5,20 @@
  *           The server's IP address could configure statically to
  *           192.168.1.2, or assign by DHCP server.
  *
+ *           Files are served from the FAT volume on the SD card of SDH
+ *           (sdh.h), then from the pages built into fsdata.c. FatFs is
+ *           built without long file names, so name them 8.3 on the card,
+ *           e.g. /logs/boot.log or /media/demo.mp4.
+ *
+ *           NU_HTTPD_WORKERS tasks serve connections in parallel, each
+ *           keeping its connection open across requests (keep-alive) and
+ *           answering requests pipelined behind each other in order. File
+ *           data goes to TCP without a copy, see httpd_file.h.
+ *
+ *           Measure with a few parallel downloads of a large file, e.g.
+ *             curl -s -o /dev/null -w "%{speed_download}\n" http://192.168.0.2/media/demo.mp4 &
+ *           started four times.
+ *
  * @note     TIMER11 has been assigned to FreeRTOS kernel.
  *
  * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
@@ -24,6 +38,7 @@
 #include "lwip/tcpip.h"
 #include "netif/ethernetif.h"
 #include "httpserver-netconn.h"
+#include "httpd_file.h"
 #if (LWIP_DHCP == 1)
 #include "lwip/dhcp.h"
 #endif
@@ -194,6 +209,55 @@ void SYS_Init()
     SYS->IPRST0 = SYS_IPRST0_HWSEMRST_Msk;
     SYS->IPRST0 = 0;
 
+    /* Enable SD host clocks, the document root is on the card */
+    CLK_EnableModuleClock(SD0_MODULE);
+    CLK_EnableModuleClock(SD1_MODULE);
+    CLK_EnableModuleClock(GPJ_MODULE);
+
+    /* Set SD0 MFP */
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC0MFP_Msk)) | SYS_GPC_MFPL_PC0MFP_SD0_CMD;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC1MFP_Msk)) | SYS_GPC_MFPL_PC1MFP_SD0_CLK;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC2MFP_Msk)) | SYS_GPC_MFPL_PC2MFP_SD0_DAT0;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC3MFP_Msk)) | SYS_GPC_MFPL_PC3MFP_SD0_DAT1;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC4MFP_Msk)) | SYS_GPC_MFPL_PC4MFP_SD0_DAT2;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC5MFP_Msk)) | SYS_GPC_MFPL_PC5MFP_SD0_DAT3;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC6MFP_Msk)) | SYS_GPC_MFPL_PC6MFP_SD0_nCD;
+    SYS->GPC_MFPL = (SYS->GPC_MFPL & (~SYS_GPC_MFPL_PC7MFP_Msk)) | SYS_GPC_MFPL_PC7MFP_SD0_WP;
+
+    /* Set SD1 MFP */
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ0MFP_Msk)) | SYS_GPJ_MFPL_PJ0MFP_eMMC1_DAT4;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ1MFP_Msk)) | SYS_GPJ_MFPL_PJ1MFP_eMMC1_DAT5;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ2MFP_Msk)) | SYS_GPJ_MFPL_PJ2MFP_eMMC1_DAT6;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ3MFP_Msk)) | SYS_GPJ_MFPL_PJ3MFP_eMMC1_DAT7;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ4MFP_Msk)) | SYS_GPJ_MFPL_PJ4MFP_SD1_WP;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ5MFP_Msk)) | SYS_GPJ_MFPL_PJ5MFP_SD1_nCD;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ6MFP_Msk)) | SYS_GPJ_MFPL_PJ6MFP_eMMC1_CMD;
+    SYS->GPJ_MFPL = (SYS->GPJ_MFPL & (~SYS_GPJ_MFPL_PJ7MFP_Msk)) | SYS_GPJ_MFPL_PJ7MFP_eMMC1_CLK;
+    SYS->GPJ_MFPH = (SYS->GPJ_MFPH & (~SYS_GPJ_MFPH_PJ8MFP_Msk)) | SYS_GPJ_MFPH_PJ8MFP_eMMC1_DAT0;
+    SYS->GPJ_MFPH = (SYS->GPJ_MFPH & (~SYS_GPJ_MFPH_PJ9MFP_Msk)) | SYS_GPJ_MFPH_PJ9MFP_eMMC1_DAT1;
+    SYS->GPJ_MFPH = (SYS->GPJ_MFPH & (~SYS_GPJ_MFPH_PJ10MFP_Msk)) | SYS_GPJ_MFPH_PJ10MFP_eMMC1_DAT2;
+    SYS->GPJ_MFPH = (SYS->GPJ_MFPH & (~SYS_GPJ_MFPH_PJ11MFP_Msk)) | SYS_GPJ_MFPH_PJ11MFP_eMMC1_DAT3;
+
+    /* PJ Driver Strength */
+    GPIO_SetDriveStrength(PJ,  0, 1);
+    GPIO_SetDriveStrength(PJ,  1, 1);
+    GPIO_SetDriveStrength(PJ,  2, 1);
+    GPIO_SetDriveStrength(PJ,  3, 1);
+    GPIO_SetDriveStrength(PJ,  6, 4);
+    GPIO_SetDriveStrength(PJ,  7, 7);
+    GPIO_SetDriveStrength(PJ,  8, 1);
+    GPIO_SetDriveStrength(PJ,  9, 1);
+    GPIO_SetDriveStrength(PJ, 10, 1);
+    GPIO_SetDriveStrength(PJ, 11, 1);
+
+    /* PC Driver Strength */
+    GPIO_SetDriveStrength(PC,  0, 2);
+    GPIO_SetDriveStrength(PC,  1, 2);
+    GPIO_SetDriveStrength(PC,  2, 2);
+    GPIO_SetDriveStrength(PC,  3, 2);
+    GPIO_SetDriveStrength(PC,  4, 2);
+    GPIO_SetDriveStrength(PC,  5, 2);
+
     /* Lock protected registers */
     SYS_LockReg();
 }
@@ -262,6 +326,14 @@ static void vWebTask( void *pvParameters )
     sysprintf("Subnet mask:     %s\n", ip4addr_ntoa(&netif.netmask));
     sysprintf("Default gateway: %s\n", ip4addr_ntoa(&netif.gw));
 
+    /* Open the SD card before the server tasks start */
+    SDH_Reset(SDH);
+    SDH_Open(SDH);
+    if (SDH_Probe(SDH) != 0)
+        sysprintf("SD initial fail!!\n");
+    if (httpd_file_init(SDH) != 0)
+        sysprintf("No FAT volume on the SD card, serving the built-in pages only\n");
+
     http_server_netconn_init();
 
     vTaskSuspend( NULL );
@@ -5,6 +5,13 @@
  *           Starting as a server, the sample code listens to iperf port 5001
  *           with IP address 192.168.0.2.
  *
+ *           lwipopts.h uses the high-throughput profile of
+ *           port/include/lwipopts_perf.h. At the end of every test the
+ *           sample prints the Mbit/s lwiperf measured, followed by the
+ *           link, TCP, heap and pool counters of LWIP_STATS. Run
+ *           "iperf -c 192.168.0.2 -t 10" on an iperf 2 host; pool "err"
+ *           counters above 0 mean the profile is too small for the load.
+ *
  * @note     TIMER11 has been assigned to FreeRTOS kernel.
  *
  * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
@@ -24,6 +31,7 @@
 #include "lwip/tcpip.h"
 #include "netif/ethernetif.h"
 #include "lwip/apps/lwiperf.h"
+#include "lwip/stats.h"
 #if (LWIP_DHCP == 1)
 #include "lwip/dhcp.h"
 #endif
@@ -215,6 +223,34 @@ static netif_init_fn ethernetif_init(int intf)
     return ethernetif_init;
 }
 
+/*
+ * Called by lwiperf when a test ends, with the lwIP core locked
+ */
+static void iperf_report(void *arg, enum lwiperf_report_type report_type,
+                         const ip_addr_t *local_addr, u16_t local_port,
+                         const ip_addr_t *remote_addr, u16_t remote_port,
+                         u32_t bytes_transferred, u32_t ms_duration,
+                         u32_t bandwidth_kbitpsec)
+{
+    ( void ) arg;
+    ( void ) local_addr;
+    ( void ) local_port;
+    ( void ) remote_port;
+
+    sysprintf("\n[ iperf ] %s %s: %u KB in %u ms, %u.%02u Mbit/s\n",
+              ipaddr_ntoa(remote_addr),
+              (report_type <= LWIPERF_TCP_DONE_CLIENT) ? "done" : "aborted",
+              bytes_transferred / 1024, ms_duration,
+              bandwidth_kbitpsec / 1000, (bandwidth_kbitpsec % 1000) / 10);
+
+    LINK_STATS_DISPLAY();
+    TCP_STATS_DISPLAY();
+    MEM_STATS_DISPLAY();
+    MEMP_STATS_DISPLAY(MEMP_PBUF_POOL);
+    MEMP_STATS_DISPLAY(MEMP_PBUF);
+    MEMP_STATS_DISPLAY(MEMP_TCP_SEG);
+}
+
 static void vTcpTask( void *pvParameters )
 {
     ip_addr_t ipaddr;
@@ -235,9 +271,9 @@ static void vTcpTask( void *pvParameters )
     netif_set_default(&netif);
     netif_set_up(&netif);
 #ifdef IWIPERF_CLIENT_MODE
-    lwiperf_start_tcp_client_default(&server_ip, NULL, NULL);
+    lwiperf_start_tcp_client_default(&server_ip, iperf_report, NULL);
 #else
-    lwiperf_start_tcp_server_default(NULL, NULL);
+    lwiperf_start_tcp_server_default(iperf_report, NULL);
 #endif
 
     vTaskSuspend( NULL );
@@ -42,6 +42,7 @@
 
 #include "mbedtls/net_sockets.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #if defined ( __GNUC__ ) && !(__CC_ARM) && !(__ICCARM__)
@@ -61,7 +62,8 @@
 #include "lwip/opt.h"
 #include "lwip/arch.h"
 #include "lwip/api.h"
-//#include "lwip/tcpip.h"
+#include "lwip/tcp.h"
+#include "lwip/tcpip.h"
 //#include "lwip/ip_addr.h"
 #include "lwip/netdb.h"
 #include "lwip/sockets.h"
@@ -84,6 +86,7 @@ void mbedtls_net_init( mbedtls_net_context *ctx )
     ctx->fd = -1;
 }
 
+#if !NU_TLS_ACCEL
 /*
  * Initiate a TCP connection with host:port and the given protocol
  */
@@ -420,6 +423,8 @@ int mbedtls_net_poll( mbedtls_net_context *ctx, uint32_t rw, uint32_t timeout )
     return( ret );
 }
 
+#endif /* !NU_TLS_ACCEL */
+
 /*
  * Portable usleep helper
  */
@@ -438,6 +443,7 @@ void mbedtls_net_usleep( unsigned long usec )
 
 }
 
+#if !NU_TLS_ACCEL
 /*
  * Read at most 'len' characters
  */
@@ -552,4 +558,487 @@ void mbedtls_net_free( mbedtls_net_context *ctx )
     ctx->fd = -1;
 }
 
+#endif /* !NU_TLS_ACCEL */
+
+#if NU_TLS_ACCEL
+/*
+ * Record I/O straight on lwIP netconns
+ *
+ * mbed TLS reads every record in two calls, the 5-byte header and then the
+ * body. Through the socket layer each call is a socket lookup, a lock and a
+ * copy out of the socket's last pbuf, and recv_timeout() adds a select().
+ * Here each context keeps the pbuf chain it received from the netconn and
+ * mbedtls_net_recv() copies straight from it into the record buffer; that
+ * copy is the only one, mbed TLS needs the record contiguous.
+ *
+ * Sending still copies into TCP pbufs: NETCONN_NOCOPY would require the
+ * buffer to stay untouched until the peer ACKs it, and mbed TLS reuses its
+ * output buffer as soon as mbedtls_net_send() returns.
+ *
+ * Only TCP is supported. mbedtls_net_context.fd indexes s_net_conn[].
+ */
+#define NET_CONN_MAX    MEMP_NUM_NETCONN
+
+/* Dual stack netconn for IPv6 and the IP_ANY_TYPE wildcard */
+#if LWIP_IPV6
+#define NET_CONN_TYPE( addr )   ( IP_IS_V4( addr ) ? NETCONN_TCP : NETCONN_TCP_IPV6 )
+#else
+#define NET_CONN_TYPE( addr )   NETCONN_TCP
+#endif
+
+/* net_conn_fill() wait argument: wait as the netconn is configured */
+#define NET_WAIT_CONN   ( (uint32_t) -1 )
+
+typedef struct
+{
+    struct netconn *conn;
+    struct pbuf *p;             /* Received data not read yet, or NULL */
+    u16_t off;                  /* Bytes of p already read */
+    u8_t eof;                   /* Peer closed its side */
+}
+net_conn_t;
+
+static net_conn_t s_net_conn[NET_CONN_MAX];
+
+static int net_conn_alloc( struct netconn *conn )
+{
+    int i;
+    SYS_ARCH_DECL_PROTECT( lev );
+
+    SYS_ARCH_PROTECT( lev );
+    for( i = 0; i < NET_CONN_MAX; i++ )
+    {
+        if( s_net_conn[i].conn == NULL )
+        {
+            s_net_conn[i].conn = conn;
+            s_net_conn[i].p = NULL;
+            s_net_conn[i].off = 0;
+            s_net_conn[i].eof = 0;
+            break;
+        }
+    }
+    SYS_ARCH_UNPROTECT( lev );
+
+    return( i < NET_CONN_MAX ? i : -1 );
+}
+
+static net_conn_t *net_conn_get( const mbedtls_net_context *ctx )
+{
+    if( ctx->fd < 0 || ctx->fd >= NET_CONN_MAX ||
+        s_net_conn[ctx->fd].conn == NULL )
+        return( NULL );
+
+    return( &s_net_conn[ctx->fd] );
+}
+
+/*
+ * Send the TLS flights without waiting for the peer's delayed ACK
+ */
+static void net_conn_nodelay( struct netconn *conn )
+{
+#if LWIP_TCPIP_CORE_LOCKING
+    LOCK_TCPIP_CORE();
+    if( conn->pcb.tcp != NULL )
+        tcp_nagle_disable( conn->pcb.tcp );
+    UNLOCK_TCPIP_CORE();
+#else
+    (void) conn;
+#endif
+}
+
+static int net_resolve( const char *host, const char *port,
+                        ip_addr_t *addr, u16_t *portnum )
+{
+    int n = atoi( port );
+
+    if( n <= 0 || n > 0xFFFF )
+        return( MBEDTLS_ERR_NET_UNKNOWN_HOST );
+    *portnum = (u16_t) n;
+
+    if( host == NULL )
+    {
+        ip_addr_copy( *addr, *IP_ANY_TYPE );
+        return( 0 );
+    }
+
+    if( ipaddr_aton( host, addr ) )
+        return( 0 );
+
+#if LWIP_DNS
+    if( netconn_gethostbyname( host, addr ) == ERR_OK )
+        return( 0 );
+#endif
+
+    return( MBEDTLS_ERR_NET_UNKNOWN_HOST );
+}
+
+/*
+ * Initiate a TCP connection with host:port
+ */
+int mbedtls_net_connect( mbedtls_net_context *ctx, const char *host,
+                         const char *port, int proto )
+{
+    int ret;
+    ip_addr_t addr;
+    u16_t portnum;
+    struct netconn *conn;
+
+    if( proto != MBEDTLS_NET_PROTO_TCP )
+        return( MBEDTLS_ERR_NET_BAD_INPUT_DATA );
+
+    if( ( ret = net_resolve( host, port, &addr, &portnum ) ) != 0 )
+        return( ret );
+
+    conn = netconn_new( NET_CONN_TYPE( &addr ) );
+    if( conn == NULL )
+        return( MBEDTLS_ERR_NET_SOCKET_FAILED );
+
+    if( netconn_connect( conn, &addr, portnum ) != ERR_OK )
+    {
+        netconn_delete( conn );
+        return( MBEDTLS_ERR_NET_CONNECT_FAILED );
+    }
+
+    if( ( ctx->fd = net_conn_alloc( conn ) ) < 0 )
+    {
+        netconn_delete( conn );
+        return( MBEDTLS_ERR_NET_SOCKET_FAILED );
+    }
+
+    net_conn_nodelay( conn );
+
+    return( 0 );
+}
+
+/*
+ * Create a listening netconn on bind_ip:port
+ */
+int mbedtls_net_bind( mbedtls_net_context *ctx, const char *bind_ip, const char *port, int proto )
+{
+    int ret;
+    ip_addr_t addr;
+    u16_t portnum;
+    struct netconn *conn;
+
+    if( proto != MBEDTLS_NET_PROTO_TCP )
+        return( MBEDTLS_ERR_NET_BAD_INPUT_DATA );
+
+    if( ( ret = net_resolve( bind_ip, port, &addr, &portnum ) ) != 0 )
+        return( ret );
+
+    conn = netconn_new( NET_CONN_TYPE( &addr ) );
+    if( conn == NULL )
+        return( MBEDTLS_ERR_NET_SOCKET_FAILED );
+
+    if( netconn_bind( conn, &addr, portnum ) != ERR_OK )
+    {
+        netconn_delete( conn );
+        return( MBEDTLS_ERR_NET_BIND_FAILED );
+    }
+
+    if( netconn_listen_with_backlog( conn, MBEDTLS_NET_LISTEN_BACKLOG ) != ERR_OK )
+    {
+        netconn_delete( conn );
+        return( MBEDTLS_ERR_NET_LISTEN_FAILED );
+    }
+
+    if( ( ctx->fd = net_conn_alloc( conn ) ) < 0 )
+    {
+        netconn_delete( conn );
+        return( MBEDTLS_ERR_NET_SOCKET_FAILED );
+    }
+
+    return( 0 );
+}
+
+/*
+ * Accept a connection from a remote client
+ */
+int mbedtls_net_accept( mbedtls_net_context *bind_ctx,
+                        mbedtls_net_context *client_ctx,
+                        void *client_ip, size_t buf_size, size_t *ip_len )
+{
+    err_t err;
+    ip_addr_t addr;
+    u16_t portnum;
+    struct netconn *conn;
+    net_conn_t *nc = net_conn_get( bind_ctx );
+
+    if( nc == NULL )
+        return( MBEDTLS_ERR_NET_INVALID_CONTEXT );
+
+    err = netconn_accept( nc->conn, &conn );
+    if( err == ERR_WOULDBLOCK )
+        return( MBEDTLS_ERR_SSL_WANT_READ );
+    if( err != ERR_OK )
+        return( MBEDTLS_ERR_NET_ACCEPT_FAILED );
+
+    if( client_ip != NULL )
+    {
+        if( netconn_peer( conn, &addr, &portnum ) != ERR_OK )
+        {
+            netconn_delete( conn );
+            return( MBEDTLS_ERR_NET_ACCEPT_FAILED );
+        }
+
+#if LWIP_IPV6
+        if( IP_IS_V6( &addr ) )
+            *ip_len = sizeof( ip_2_ip6( &addr )->addr );
+        else
+#endif
+            *ip_len = sizeof( ip_2_ip4( &addr )->addr );
+
+        if( buf_size < *ip_len )
+        {
+            netconn_delete( conn );
+            return( MBEDTLS_ERR_NET_BUFFER_TOO_SMALL );
+        }
+
+#if LWIP_IPV6
+        if( IP_IS_V6( &addr ) )
+            memcpy( client_ip, ip_2_ip6( &addr )->addr, *ip_len );
+        else
+#endif
+            memcpy( client_ip, &ip_2_ip4( &addr )->addr, *ip_len );
+    }
+
+    if( ( client_ctx->fd = net_conn_alloc( conn ) ) < 0 )
+    {
+        netconn_delete( conn );
+        return( MBEDTLS_ERR_NET_ACCEPT_FAILED );
+    }
+
+    net_conn_nodelay( conn );
+
+    return( 0 );
+}
+
+/*
+ * Set the netconn blocking or non-blocking
+ */
+int mbedtls_net_set_block( mbedtls_net_context *ctx )
+{
+    net_conn_t *nc = net_conn_get( ctx );
+
+    if( nc == NULL )
+        return( MBEDTLS_ERR_NET_INVALID_CONTEXT );
+
+    netconn_set_nonblocking( nc->conn, 0 );
+    return( 0 );
+}
+
+int mbedtls_net_set_nonblock( mbedtls_net_context *ctx )
+{
+    net_conn_t *nc = net_conn_get( ctx );
+
+    if( nc == NULL )
+        return( MBEDTLS_ERR_NET_INVALID_CONTEXT );
+
+    netconn_set_nonblocking( nc->conn, 1 );
+    return( 0 );
+}
+
+/*
+ * Make nc->p hold received data, or set nc->eof. wait is 0 to not block,
+ * a time in ms, or NET_WAIT_CONN.
+ */
+static int net_conn_fill( net_conn_t *nc, uint32_t wait )
+{
+    err_t err;
+    int nonblock;
+
+    if( nc->p != NULL || nc->eof )
+        return( 0 );
+
+    nonblock = netconn_is_nonblocking( nc->conn );
+    if( wait == 0 )
+        netconn_set_nonblocking( nc->conn, 1 );
+#if LWIP_SO_RCVTIMEO
+    else if( wait != NET_WAIT_CONN )
+        netconn_set_recvtimeout( nc->conn, (u32_t) wait );
+#endif
+
+    err = netconn_recv_tcp_pbuf( nc->conn, &nc->p );
+
+    if( wait == 0 )
+        netconn_set_nonblocking( nc->conn, nonblock );
+#if LWIP_SO_RCVTIMEO
+    else if( wait != NET_WAIT_CONN )
+        netconn_set_recvtimeout( nc->conn, 0 );
+#endif
+
+    switch( err )
+    {
+        case ERR_OK:
+            nc->off = 0;
+            return( 0 );
+
+        case ERR_CLSD:
+            nc->p = NULL;
+            nc->eof = 1;
+            return( 0 );
+
+        case ERR_WOULDBLOCK:
+            return( MBEDTLS_ERR_SSL_WANT_READ );
+
+        case ERR_TIMEOUT:
+            return( MBEDTLS_ERR_SSL_TIMEOUT );
+
+        case ERR_RST:
+        case ERR_ABRT:
+        case ERR_CONN:
+            return( MBEDTLS_ERR_NET_CONN_RESET );
+
+        default:
+            return( MBEDTLS_ERR_NET_RECV_FAILED );
+    }
+}
+
+/*
+ * Copy up to len bytes out of nc->p, 0 at end of stream
+ */
+static int net_conn_read( net_conn_t *nc, unsigned char *buf, size_t len )
+{
+    u16_t n;
+
+    if( nc->p == NULL )
+        return( 0 );
+
+    n = nc->p->tot_len - nc->off;
+    if( len < n )
+        n = (u16_t) len;
+
+    n = pbuf_copy_partial( nc->p, buf, n, nc->off );
+    nc->off += n;
+
+    if( nc->off == nc->p->tot_len )
+    {
+        pbuf_free( nc->p );
+        nc->p = NULL;
+    }
+
+    return( n );
+}
+
+/*
+ * Check if data is available on the netconn. Waiting for READ receives
+ * the next pbuf, which the next mbedtls_net_recv() reads.
+ */
+int mbedtls_net_poll( mbedtls_net_context *ctx, uint32_t rw, uint32_t timeout )
+{
+    int ret;
+    net_conn_t *nc = net_conn_get( ctx );
+
+    if( nc == NULL )
+        return( MBEDTLS_ERR_NET_INVALID_CONTEXT );
+
+    if( ( rw & ~( MBEDTLS_NET_POLL_READ | MBEDTLS_NET_POLL_WRITE ) ) != 0 )
+        return( MBEDTLS_ERR_NET_BAD_INPUT_DATA );
+
+    /* A TCP netconn always accepts data, netconn_write() blocks for room */
+    ret = rw & MBEDTLS_NET_POLL_WRITE;
+
+    if( rw & MBEDTLS_NET_POLL_READ )
+    {
+        /* Writable already: do not wait for data as well */
+        int err = net_conn_fill( nc, ret != 0 ? 0 :
+                                 timeout == (uint32_t) -1 ? NET_WAIT_CONN : timeout );
+
+        if( err == 0 )
+            ret |= MBEDTLS_NET_POLL_READ;
+        else if( err != MBEDTLS_ERR_SSL_WANT_READ && err != MBEDTLS_ERR_SSL_TIMEOUT )
+            return( MBEDTLS_ERR_NET_POLL_FAILED );
+    }
+
+    return( ret );
+}
+
+/*
+ * Read at most 'len' characters
+ */
+int mbedtls_net_recv( void *ctx, unsigned char *buf, size_t len )
+{
+    int ret;
+    net_conn_t *nc = net_conn_get( (mbedtls_net_context *) ctx );
+
+    if( nc == NULL )
+        return( MBEDTLS_ERR_NET_INVALID_CONTEXT );
+
+    if( ( ret = net_conn_fill( nc, NET_WAIT_CONN ) ) != 0 )
+        return( ret );
+
+    return( net_conn_read( nc, buf, len ) );
+}
+
+/*
+ * Read at most 'len' characters, blocking for at most 'timeout' ms
+ */
+int mbedtls_net_recv_timeout( void *ctx, unsigned char *buf,
+                              size_t len, uint32_t timeout )
+{
+    int ret;
+    net_conn_t *nc = net_conn_get( (mbedtls_net_context *) ctx );
+
+    if( nc == NULL )
+        return( MBEDTLS_ERR_NET_INVALID_CONTEXT );
+
+    if( ( ret = net_conn_fill( nc, timeout == 0 ? NET_WAIT_CONN : timeout ) ) != 0 )
+        return( ret );
+
+    return( net_conn_read( nc, buf, len ) );
+}
+
+/*
+ * Write at most 'len' characters
+ */
+int mbedtls_net_send( void *ctx, const unsigned char *buf, size_t len )
+{
+    err_t err;
+    size_t written = 0;
+    net_conn_t *nc = net_conn_get( (mbedtls_net_context *) ctx );
+
+    if( nc == NULL )
+        return( MBEDTLS_ERR_NET_INVALID_CONTEXT );
+
+    err = netconn_write_partly( nc->conn, buf, len, NETCONN_COPY, &written );
+
+    if( written > 0 )
+        return( (int) written );
+
+    switch( err )
+    {
+        case ERR_WOULDBLOCK:
+            return( MBEDTLS_ERR_SSL_WANT_WRITE );
+
+        case ERR_RST:
+        case ERR_ABRT:
+        case ERR_CLSD:
+        case ERR_CONN:
+            return( MBEDTLS_ERR_NET_CONN_RESET );
+
+        default:
+            return( MBEDTLS_ERR_NET_SEND_FAILED );
+    }
+}
+
+/*
+ * Gracefully close the connection
+ */
+void mbedtls_net_free( mbedtls_net_context *ctx )
+{
+    net_conn_t *nc = net_conn_get( ctx );
+
+    if( nc == NULL )
+        return;
+
+    if( nc->p != NULL )
+        pbuf_free( nc->p );
+
+    netconn_delete( nc->conn );
+    nc->conn = NULL;
+
+    ctx->fd = -1;
+}
+#endif /* NU_TLS_ACCEL */
+
 #endif /* MBEDTLS_NET_C */
@@ -0,0 +1,254 @@
+/*************************************************************************//**
+ * @file     tftp_store.c
+ * @version  V1.00
+ * @brief    Double-buffered writer between a TFTP receiver and storage.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include "NuMicro.h"
+#include "lwip/opt.h"
+#include "lwip/arch.h"
+#include "lwip/api.h"
+#include "lwip/sys.h"
+#include "string.h"
+#include "tftp_store.h"
+#if TFTP_STORE_FATFS
+#include "ff.h"
+#endif
+
+#define TFTP_WRITER_PRIO        ( tskIDLE_PRIORITY + 2UL )
+#define TFTP_WRITER_STACKSIZE   ( 512 )
+
+/* A buffer on its way to the writer task */
+typedef struct
+{
+    uint8_t    *buf;
+    uint32_t    len;
+    sys_sem_t   idle;           /* Given while the receiver may fill buf */
+} tftp_store_job_t;
+
+/* Cache-line aligned so SDH DMA reads and writes them in place */
+static uint8_t s_buf[2][TFTP_STORE_BUF_SIZE] __attribute__((aligned(64)));
+static tftp_store_job_t s_job[2];
+static sys_mbox_t s_write_mbox;
+
+static const tftp_sink_t *s_sink;
+static void *s_ctx;
+static int s_cur;               /* Buffer the receiver fills */
+static uint32_t s_fill;
+static volatile int s_err;
+
+uint8_t  tftp_ram_image[TFTP_RAM_SIZE] __attribute__((aligned(64)));
+uint32_t tftp_ram_len;
+
+
+/**
+  * @brief  Writer task: writes each buffer the receiver hands over
+  * @param  arg: not used
+  * @retval None
+  */
+static void tftp_writer_thread(void *arg)
+{
+    tftp_store_job_t *job;
+
+    while (1)
+    {
+        sys_arch_mbox_fetch(&s_write_mbox, (void **)&job, 0);
+
+        /* After a failed write the rest of the file is only drained */
+        if (!s_err && (s_sink->write(s_ctx, job->buf, job->len) != 0))
+            s_err = 1;
+
+        sys_sem_signal(&job->idle);
+    }
+}
+
+void tftp_store_init(void)
+{
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        s_job[i].buf = s_buf[i];
+        sys_sem_new(&s_job[i].idle, 1);
+    }
+    sys_mbox_new(&s_write_mbox, 2);
+    sys_thread_new("TFTPW", tftp_writer_thread, NULL, TFTP_WRITER_STACKSIZE, TFTP_WRITER_PRIO);
+}
+
+int tftp_store_begin(const tftp_sink_t *sink, void *ctx, const char *name, uint32_t size)
+{
+    if (sink->open(ctx, name, size) != 0)
+        return -1;
+
+    s_sink = sink;
+    s_ctx = ctx;
+    s_err = 0;
+    s_cur = 0;
+    s_fill = 0;
+    sys_arch_sem_wait(&s_job[0].idle, 0);
+    return 0;
+}
+
+/* Hand the current buffer to the writer and wait until the other one is free */
+static void tftp_store_submit(void)
+{
+    s_job[s_cur].len = s_fill;
+    sys_mbox_post(&s_write_mbox, &s_job[s_cur]);
+
+    s_cur ^= 1;
+    s_fill = 0;
+    sys_arch_sem_wait(&s_job[s_cur].idle, 0);
+}
+
+int tftp_store_put(struct netbuf *nbuf, u16_t offset, u16_t len)
+{
+    uint32_t n;
+
+    if (s_err)
+        return -1;
+
+    while (len)
+    {
+        n = TFTP_STORE_BUF_SIZE - s_fill;
+        if (n > len)
+            n = len;
+        netbuf_copy_partial(nbuf, s_buf[s_cur] + s_fill, n, offset);
+        s_fill += n;
+        offset += n;
+        len -= n;
+
+        if (s_fill == TFTP_STORE_BUF_SIZE)
+            tftp_store_submit();
+    }
+    return 0;
+}
+
+int tftp_store_end(int ok)
+{
+    int i;
+
+    if (s_fill && ok)
+    {
+        s_job[s_cur].len = s_fill;
+        sys_mbox_post(&s_write_mbox, &s_job[s_cur]);
+    }
+    else
+    {
+        sys_sem_signal(&s_job[s_cur].idle);
+    }
+
+    /* Both buffers idle: the writer is done with the file */
+    for (i = 0; i < 2; i++)
+        sys_arch_sem_wait(&s_job[i].idle, 0);
+    for (i = 0; i < 2; i++)
+        sys_sem_signal(&s_job[i].idle);
+
+    ok = ok && !s_err;
+    if (s_sink->close(s_ctx, ok) != 0)
+        ok = 0;
+    return ok ? 0 : -1;
+}
+
+/* RAM staging image. Keeps the last file received. */
+
+static int ram_open(void *ctx, const char *name, uint32_t size)
+{
+    if (size > TFTP_RAM_SIZE)
+        return -1;
+    tftp_ram_len = 0;
+    return 0;
+}
+
+static int ram_write(void *ctx, const uint8_t *buf, uint32_t len)
+{
+    if (len > TFTP_RAM_SIZE - tftp_ram_len)
+        return -1;
+    memcpy(tftp_ram_image + tftp_ram_len, buf, len);
+    tftp_ram_len += len;
+    return 0;
+}
+
+static int ram_close(void *ctx, int ok)
+{
+    return 0;
+}
+
+const tftp_sink_t tftp_sink_ram = { ram_open, ram_write, ram_close };
+
+int tftp_read_ram(void *ctx, uint32_t offset, uint8_t *buf, uint32_t len)
+{
+    memcpy(buf, tftp_ram_image + offset, len);
+    return 0;
+}
+
+/* Null sink: measures the network side alone */
+
+static int null_open(void *ctx, const char *name, uint32_t size)
+{
+    return 0;
+}
+
+static int null_write(void *ctx, const uint8_t *buf, uint32_t len)
+{
+    return 0;
+}
+
+static int null_close(void *ctx, int ok)
+{
+    return 0;
+}
+
+const tftp_sink_t tftp_sink_null = { null_open, null_write, null_close };
+
+#if TFTP_STORE_FATFS
+/* FAT file, ctx is its FIL. Whole buffers are sector multiples, so FatFs
+   writes them to the card without going through its sector window. */
+
+static char s_fatfs_name[FF_MAX_LFN + 4];
+
+static int fatfs_open(void *ctx, const char *name, uint32_t size)
+{
+    if (strlen(name) >= sizeof(s_fatfs_name))
+        return -1;
+    strcpy(s_fatfs_name, name);
+    return (f_open((FIL *)ctx, name, FA_WRITE | FA_CREATE_ALWAYS) == FR_OK) ? 0 : -1;
+}
+
+static int fatfs_write(void *ctx, const uint8_t *buf, uint32_t len)
+{
+    UINT n;
+
+    if ((f_write((FIL *)ctx, buf, len, &n) != FR_OK) || (n != len))
+        return -1;
+    return 0;
+}
+
+static int fatfs_close(void *ctx, int ok)
+{
+    FIL *fil = (FIL *)ctx;
+
+    if (f_close(fil) != FR_OK)
+        return -1;
+
+    /* No half-written file is left behind */
+    if (!ok)
+        f_unlink(s_fatfs_name);
+    return 0;
+}
+
+const tftp_sink_t tftp_sink_fatfs = { fatfs_open, fatfs_write, fatfs_close };
+
+int tftp_read_fatfs(void *ctx, uint32_t offset, uint8_t *buf, uint32_t len)
+{
+    FIL *fil = (FIL *)ctx;
+    UINT n;
+
+    /* The sender reads each block once, in order */
+    if ((f_tell(fil) != offset) && (f_lseek(fil, offset) != FR_OK))
+        return -1;
+    if ((f_read(fil, buf, len, &n) != FR_OK) || (n != len))
+        return -1;
+    return 0;
+}
+#endif
@@ -0,0 +1,87 @@
+/*************************************************************************//**
+ * @file     tftp_store.h
+ * @version  V1.00
+ * @brief    Double-buffered writer between a TFTP receiver and storage.
+ *
+ *           The receiver copies each block out of its frames into one of
+ *           two TFTP_STORE_BUF_SIZE buffers. A full buffer is handed to the
+ *           writer task, which writes it to the sink while the receiver
+ *           fills the other one, so the network and the storage overlap.
+ *           The receiver only waits if storage falls a whole buffer behind.
+ *
+ *           Sinks: a FAT file (TFTP_STORE_FATFS), the RAM staging image and
+ *           a null sink for benchmarks. Other storage, e.g. a raw flash
+ *           partition, plugs in as a tftp_sink_t.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __TFTP_STORE_H__
+#define __TFTP_STORE_H__
+
+#include "lwip/api.h"
+#include "tftp.h"
+
+#ifndef TFTP_STORE_FATFS
+#define TFTP_STORE_FATFS        0
+#endif
+
+/* RAM staging image: the last file received into RAM, served back on RRQ */
+#ifndef TFTP_RAM_SIZE
+#define TFTP_RAM_SIZE           (4 * 1024 * 1024)
+#endif
+
+/**
+ * @brief Storage a received file goes to. write() runs in the writer task
+ *        and gets TFTP_STORE_BUF_SIZE bytes, cache-line aligned, except
+ *        for the last call. Each returns 0 on success.
+ */
+typedef struct
+{
+    int (*open)(void *ctx, const char *name, uint32_t size);
+    int (*write)(void *ctx, const uint8_t *buf, uint32_t len);
+    int (*close)(void *ctx, int ok);
+} tftp_sink_t;
+
+extern const tftp_sink_t tftp_sink_ram;
+extern const tftp_sink_t tftp_sink_null;
+#if TFTP_STORE_FATFS
+extern const tftp_sink_t tftp_sink_fatfs;
+#endif
+
+extern uint8_t  tftp_ram_image[TFTP_RAM_SIZE];
+extern uint32_t tftp_ram_len;
+
+/**
+ * @brief   Create the writer task. Call once before the first transfer.
+ */
+void tftp_store_init(void);
+
+/**
+ * @brief   Start storing a file. One file is stored at a time.
+ * @param   size  Size announced by tsize, 0 if unknown
+ * @return  0, or -1 if the sink cannot open the file
+ */
+int tftp_store_begin(const tftp_sink_t *sink, void *ctx, const char *name, uint32_t size);
+
+/**
+ * @brief   Copy len bytes at offset of a received packet into the store
+ * @return  0, or -1 if an earlier write to the sink failed
+ */
+int tftp_store_put(struct netbuf *nbuf, u16_t offset, u16_t len);
+
+/**
+ * @brief   Write what is left, wait for the writer and close the sink
+ * @param   ok  Zero if the transfer failed, the sink may discard the file
+ * @return  0 if every byte was written, -1 otherwise
+ */
+int tftp_store_end(int ok);
+
+/**
+ * @brief   Data sources of a sender, see tftp_read_fn
+ */
+int tftp_read_ram(void *ctx, uint32_t offset, uint8_t *buf, uint32_t len);
+#if TFTP_STORE_FATFS
+int tftp_read_fatfs(void *ctx, uint32_t offset, uint8_t *buf, uint32_t len);
+#endif
+
+#endif // __TFTP_STORE_H__
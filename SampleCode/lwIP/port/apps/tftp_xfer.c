@@ -0,0 +1,616 @@
+/*************************************************************************//**
+ * @file     tftp_xfer.c
+ * @version  V1.00
+ * @brief    Windowed TFTP transfer engine, shared by the TFTP client and
+ *           server samples.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include "lwip/opt.h"
+#include "lwip/arch.h"
+#include "lwip/api.h"
+#include "string.h"
+#include "tftp_xfer.h"
+
+/* Largest blksize RFC 2348 allows */
+#define TFTP_BLKSIZE_RFC_MAX    65464
+
+/* Room for a request or an OACK with every option */
+#define TFTP_PKT_SIZE           192
+
+void tftp_opts_default(tftp_opts_t *o)
+{
+    o->blksize = TFTP_BLOCK_LENGTH;
+    o->windowsize = 1;
+    o->tsize = 0;
+    o->mask = 0;
+}
+
+void tftp_opts_clamp(tftp_opts_t *o, int receiver)
+{
+    if (o->blksize > TFTP_BLKSIZE_MAX)
+        o->blksize = TFTP_BLKSIZE_MAX;
+    if (o->windowsize > TFTP_WINDOW_MAX)
+        o->windowsize = TFTP_WINDOW_MAX;
+
+    /* A window of fragmented blocks must not wrap the GMAC receive ring */
+    if (receiver)
+    {
+        while ((o->windowsize > 1) &&
+                (o->windowsize * TFTP_BLOCK_FRAMES(o->blksize) > TFTP_RX_FRAMES))
+            o->windowsize--;
+    }
+}
+
+/* Start of the string after the one at p, NULL if p is not terminated */
+static char *tftp_next(char *p, char *end)
+{
+    while (p < end)
+    {
+        if (*p++ == 0)
+            return p;
+    }
+    return NULL;
+}
+
+static int tftp_atou(const char *s, uint32_t *v)
+{
+    uint32_t n = 0;
+
+    if (*s == 0)
+        return -1;
+    for (; *s; s++)
+    {
+        if ((*s < '0') || (*s > '9') || (n > 429496728))
+            return -1;
+        n = n * 10 + (*s - '0');
+    }
+    *v = n;
+    return 0;
+}
+
+/* Read the option/value pairs from p into o. A request may carry options
+   this end does not know, which are skipped; an OACK must not (strict). */
+static int tftp_parse_opts(char *p, char *end, tftp_opts_t *o, int strict)
+{
+    char *val, *next;
+    uint32_t v;
+
+    while (p < end)
+    {
+        if (((val = tftp_next(p, end)) == NULL) || ((next = tftp_next(val, end)) == NULL))
+            return strict ? -1 : 0;
+
+        if (tftp_atou(val, &v) != 0)
+        {
+            if (strict)
+                return -1;
+        }
+        else if (lwip_stricmp(p, "blksize") == 0)
+        {
+            if ((v >= TFTP_BLKSIZE_MIN) && (v <= TFTP_BLKSIZE_RFC_MAX))
+            {
+                o->blksize = v;
+                o->mask |= TFTP_OPT_BLKSIZE;
+            }
+            else if (strict)
+                return -1;
+        }
+        else if (lwip_stricmp(p, "windowsize") == 0)
+        {
+            if ((v >= 1) && (v <= 0xFFFF))
+            {
+                o->windowsize = v;
+                o->mask |= TFTP_OPT_WINDOWSIZE;
+            }
+            else if (strict)
+                return -1;
+        }
+        else if (lwip_stricmp(p, "tsize") == 0)
+        {
+            o->tsize = v;
+            o->mask |= TFTP_OPT_TSIZE;
+        }
+        else if (strict)
+        {
+            /* An OACK may only carry options that were asked for */
+            return -1;
+        }
+        p = next;
+    }
+    return 0;
+}
+
+int tftp_parse_request(char *p, int len, char **name, tftp_opts_t *o)
+{
+    char *end = p + len;
+    char *mode, *opts;
+
+    tftp_opts_default(o);
+
+    if (((mode = tftp_next(p, end)) == NULL) || ((opts = tftp_next(mode, end)) == NULL))
+        return -1;
+    if (lwip_stricmp(mode, "octet") != 0)
+        return -1;
+    *name = p;
+
+    /* Unknown or malformed options are left out of the OACK */
+    return tftp_parse_opts(opts, end, o, 0);
+}
+
+int tftp_parse_oack(char *p, int len, const tftp_opts_t *asked, tftp_opts_t *o)
+{
+    tftp_opts_default(o);
+
+    if (tftp_parse_opts(p, p + len, o, 1) != 0)
+        return -1;
+    if (o->mask & ~asked->mask)
+        return -1;
+
+    /* The server may lower what was asked for, never raise it */
+    if ((o->blksize > asked->blksize) || (o->windowsize > asked->windowsize))
+        return -1;
+    return 0;
+}
+
+static void tftp_send(struct netconn *conn, const ip_addr_t *addr, u16_t port,
+                      const void *pkt, u16_t len)
+{
+    struct netbuf *nbuf;
+    void *data;
+
+    if ((nbuf = netbuf_new()) == NULL)
+        return;
+    if ((data = netbuf_alloc(nbuf, len)) != NULL)
+    {
+        memcpy(data, pkt, len);
+        netconn_sendto(conn, nbuf, addr, port);
+    }
+    netbuf_delete(nbuf);
+}
+
+static int tftp_put_opts(char *p, const tftp_opts_t *o)
+{
+    int n = 0;
+
+    if (o->mask & TFTP_OPT_BLKSIZE)
+        n += sprintf(p + n, "blksize%c%u", 0, o->blksize) + 1;
+    if (o->mask & TFTP_OPT_WINDOWSIZE)
+        n += sprintf(p + n, "windowsize%c%u", 0, o->windowsize) + 1;
+    if (o->mask & TFTP_OPT_TSIZE)
+        n += sprintf(p + n, "tsize%c%lu", 0, (unsigned long)o->tsize) + 1;
+    return n;
+}
+
+void tftp_send_request(tftp_xfer_t *x, uint16_t op, const char *name, const tftp_opts_t *o)
+{
+    char pkt[TFTP_PKT_SIZE];
+    int n;
+
+    if (strlen(name) > TFTP_PKT_SIZE - 80)
+        return;
+
+    pkt[0] = 0;
+    pkt[1] = op;
+    n = 2 + sprintf(pkt + 2, "%s%coctet", name, 0) + 1;
+    n += tftp_put_opts(pkt + n, o);
+
+    tftp_send(x->conn, &x->addr, x->port, pkt, n);
+}
+
+void tftp_send_oack(tftp_xfer_t *x)
+{
+    char pkt[TFTP_PKT_SIZE];
+    int n;
+
+    pkt[0] = 0;
+    pkt[1] = TFTP_OPCODE_OACK;
+    n = 2 + tftp_put_opts(pkt + 2, &x->opts);
+
+    tftp_send(x->conn, &x->addr, x->port, pkt, n);
+}
+
+void tftp_send_ack(tftp_xfer_t *x, uint16_t blk)
+{
+    uint8_t pkt[4];
+
+    pkt[0] = 0;
+    pkt[1] = TFTP_OPCODE_ACK;
+    pkt[2] = blk >> 8;
+    pkt[3] = blk & 0xFF;
+
+    tftp_send(x->conn, &x->addr, x->port, pkt, sizeof(pkt));
+}
+
+void tftp_send_error(struct netconn *conn, const ip_addr_t *addr, u16_t port,
+                     uint16_t code, const char *msg)
+{
+    char pkt[64];
+    int n;
+
+    pkt[0] = 0;
+    pkt[1] = TFTP_OPCODE_ERROR;
+    pkt[2] = 0;
+    pkt[3] = code;
+    n = strlen(msg);
+    if (n > (int)sizeof(pkt) - 5)
+        n = sizeof(pkt) - 5;
+    memcpy(pkt + 4, msg, n);
+    pkt[4 + n] = 0;
+
+    tftp_send(conn, addr, port, pkt, n + 5);
+}
+
+/**
+  * @brief  Check where a packet of the transfer comes from and read its header
+  * @param  op: opcode
+  * @param  blk: block number, or error code of an ERROR
+  * @retval 0, or -1 if the packet was dropped (and freed)
+  */
+static int tftp_xfer_header(tftp_xfer_t *x, struct netbuf *nbuf, u16_t *op, u16_t *blk)
+{
+    uint8_t hdr[4];
+
+    if (!ip_addr_cmp(netbuf_fromaddr(nbuf), &x->addr) || (netbuf_fromport(nbuf) != x->port))
+    {
+        /* RFC 1350: another TID gets an error, the transfer goes on */
+        tftp_send_error(x->conn, netbuf_fromaddr(nbuf), netbuf_fromport(nbuf),
+                        TFTP_ERROR_UNKNOWN_ID, "Unknown transfer ID");
+        netbuf_delete(nbuf);
+        return -1;
+    }
+    if (netbuf_copy(nbuf, hdr, 4) != 4)
+    {
+        netbuf_delete(nbuf);
+        return -1;
+    }
+    *op = (hdr[0] << 8) | hdr[1];
+    *blk = (hdr[2] << 8) | hdr[3];
+    return 0;
+}
+
+int tftp_xfer_request(tftp_xfer_t *x, uint16_t op, const char *name,
+                      const tftp_opts_t *asked, struct netbuf **first)
+{
+    struct netbuf *nbuf;
+    char pkt[TFTP_PKT_SIZE];
+    u16_t rop, blk, len;
+    int retry = 0;
+    err_t err;
+
+    *first = NULL;
+    tftp_opts_default(&x->opts);
+    x->oack_sent = 0;
+    netconn_set_recvtimeout(x->conn, TFTP_TIMEOUT);
+    tftp_send_request(x, op, name, asked);
+
+    while (1)
+    {
+        err = netconn_recv(x->conn, &nbuf);
+        if (err == ERR_TIMEOUT)
+        {
+            if (++retry > TFTP_MAX_RETRIES)
+            {
+                sysprintf("No answer from the server\n");
+                return -1;
+            }
+            tftp_send_request(x, op, name, asked);
+            continue;
+        }
+        else if (err != ERR_OK)
+        {
+            continue;
+        }
+
+        /* The server answers from the TID of the transfer, not port 69 */
+        len = netbuf_len(nbuf);
+        if (!ip_addr_cmp(netbuf_fromaddr(nbuf), &x->addr) || (len < 4))
+        {
+            netbuf_delete(nbuf);
+            continue;
+        }
+        if (len > sizeof(pkt))
+            len = sizeof(pkt);
+        netbuf_copy(nbuf, pkt, len);
+        rop = ((uint8_t)pkt[0] << 8) | (uint8_t)pkt[1];
+        blk = ((uint8_t)pkt[2] << 8) | (uint8_t)pkt[3];
+        x->port = netbuf_fromport(nbuf);
+
+        if ((rop == TFTP_OPCODE_DATA) && (op == TFTP_OPCODE_RRQ) && (blk == 1))
+        {
+            /* No OACK: the server ignored the options */
+            *first = nbuf;
+            return 0;
+        }
+        netbuf_delete(nbuf);
+
+        if ((rop == TFTP_OPCODE_ACK) && (op == TFTP_OPCODE_WRQ) && (blk == 0))
+            return 0;
+
+        if ((rop == TFTP_OPCODE_OACK) && asked->mask)
+        {
+            if (tftp_parse_oack(pkt + 2, len - 2, asked, &x->opts) != 0)
+            {
+                tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_OPTION, "Bad option");
+                return -1;
+            }
+            /* A reader accepts the OACK with ACK 0, a writer with DATA 1 */
+            if (op == TFTP_OPCODE_RRQ)
+                tftp_send_ack(x, 0);
+            return 0;
+        }
+
+        if (rop == TFTP_OPCODE_ERROR)
+            sysprintf("Received ERR: %d\n", blk);
+        else
+            tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_ILLEGAL_OPERATION, "Illegal operation");
+        return -1;
+    }
+}
+
+int tftp_xfer_send(tftp_xfer_t *x, tftp_read_fn read, void *ctx, uint32_t len, uint8_t *buf)
+{
+    const uint32_t bs = x->opts.blksize;
+    const uint32_t win = x->opts.windowsize;
+    /* A file of whole blocks ends with an empty one */
+    const uint32_t last = len / bs + 1;
+    uint32_t acked = 0, loaded = 0, b, n;
+    struct netbuf *nbuf, *out;
+    uint8_t *blk;
+    u16_t op, ack, d;
+    int retry = 0, send = !x->oack_sent, ret = -1;
+    err_t err;
+
+    if ((out = netbuf_new()) == NULL)
+        return -1;
+
+    netconn_set_recvtimeout(x->conn, TFTP_TIMEOUT);
+    x->blocks = 0;
+    x->bytes = 0;
+
+    while (1)
+    {
+        /* (Re)send the window after the last acknowledged block. Each block
+           is read once into its slot, behind room for the header, and sent
+           from there by reference. */
+        if (send)
+        {
+            for (b = acked + 1; (b <= acked + win) && (b <= last); b++)
+            {
+                blk = buf + ((b - 1) % win) * (bs + 4);
+                n = (b < last) ? bs : len - (last - 1) * bs;
+                if (b > loaded)
+                {
+                    if ((n != 0) && (read(ctx, (b - 1) * bs, blk + 4, n) != 0))
+                    {
+                        tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_NOT_DEFINED, "Read error");
+                        goto out;
+                    }
+                    blk[0] = 0;
+                    blk[1] = TFTP_OPCODE_DATA;
+                    loaded = b;
+                }
+                blk[2] = (b >> 8) & 0xFF;
+                blk[3] = b & 0xFF;
+
+                /* UDP is done with the reference once netconn_sendto()
+                   returns: the driver, ARP queue and loopback all copy */
+                netbuf_ref(out, blk, n + 4);
+                netconn_sendto(x->conn, out, &x->addr, x->port);
+            }
+            send = 0;
+        }
+
+        err = netconn_recv(x->conn, &nbuf);
+        if (err == ERR_TIMEOUT)
+        {
+            if (++retry > TFTP_MAX_RETRIES)
+            {
+                sysprintf("Exceed retry count, abort transfer\n");
+                tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_NOT_DEFINED, "Timeout");
+                goto out;
+            }
+            if (x->oack_sent)
+            {
+                tftp_send_oack(x);
+            }
+            else
+            {
+                send = 1;
+                x->resent++;
+            }
+            continue;
+        }
+        else if (err != ERR_OK)
+        {
+            continue;
+        }
+
+        if (tftp_xfer_header(x, nbuf, &op, &ack) != 0)
+            continue;
+        netbuf_delete(nbuf);
+
+        if (op == TFTP_OPCODE_ACK)
+        {
+            if (x->oack_sent)
+            {
+                /* ACK 0 accepts the OACK */
+                if (ack == 0)
+                {
+                    x->oack_sent = 0;
+                    send = 1;
+                    retry = 0;
+                }
+                continue;
+            }
+
+            d = (u16_t)(ack - (u16_t)acked);
+            if (d == 0)
+            {
+                /* The receiver saw a gap after the block it acknowledged
+                   before: go back to it */
+                send = 1;
+                x->resent++;
+            }
+            else if ((d <= win) && (acked + d <= last))
+            {
+                acked += d;
+                retry = 0;
+                x->blocks = acked;
+                x->bytes = (acked == last) ? len : acked * bs;
+                if (acked == last)
+                {
+                    ret = 0;
+                    goto out;
+                }
+                send = 1;
+            }
+            /* Anything else is an old duplicate */
+        }
+        else if (op == TFTP_OPCODE_ERROR)
+        {
+            sysprintf("Received ERR: %d\n", ack);
+            goto out;
+        }
+        else
+        {
+            tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_ILLEGAL_OPERATION, "Illegal operation");
+            goto out;
+        }
+    }
+
+out:
+    netbuf_delete(out);
+    return ret;
+}
+
+int tftp_xfer_recv(tftp_xfer_t *x, struct netbuf *first)
+{
+    const u16_t bs = x->opts.blksize;
+    const u16_t win = x->opts.windowsize;
+    struct netbuf *nbuf = first;
+    /* Next block expected. Blocks are numbered mod 65536 on the wire. */
+    uint32_t next = 1;
+    int count = 0, retry = 0, nacked = 0, last = 0;
+    u16_t op, blk, n;
+    err_t err;
+
+    netconn_set_recvtimeout(x->conn, TFTP_TIMEOUT);
+    x->blocks = 0;
+    x->bytes = 0;
+
+    while (!last)
+    {
+        if (nbuf == NULL)
+        {
+            err = netconn_recv(x->conn, &nbuf);
+            if (err == ERR_TIMEOUT)
+            {
+                if (++retry > TFTP_MAX_RETRIES)
+                {
+                    sysprintf("Exceed retry count, abort transfer\n");
+                    tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_NOT_DEFINED, "Timeout");
+                    return -1;
+                }
+                /* The ACK or the rest of the window got lost */
+                if (x->oack_sent)
+                    tftp_send_oack(x);
+                else
+                    tftp_send_ack(x, next - 1);
+                x->resent++;
+                count = 0;
+                continue;
+            }
+            else if (err != ERR_OK)
+            {
+                nbuf = NULL;
+                continue;
+            }
+        }
+
+        if (tftp_xfer_header(x, nbuf, &op, &blk) != 0)
+        {
+            nbuf = NULL;
+            continue;
+        }
+
+        if (op == TFTP_OPCODE_DATA)
+        {
+            n = netbuf_len(nbuf) - 4;
+            if (blk == (u16_t)next)
+            {
+                if (n > bs)
+                {
+                    tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_ILLEGAL_OPERATION, "Block too large");
+                    netbuf_delete(nbuf);
+                    return -1;
+                }
+                if (tftp_store_put(nbuf, 4, n) != 0)
+                {
+                    tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_DISK_FULL, "Write error");
+                    netbuf_delete(nbuf);
+                    return -1;
+                }
+                x->oack_sent = 0;
+                x->blocks = next++;
+                x->bytes += n;
+                retry = 0;
+                nacked = 0;
+
+                /* The last block is acknowledged by tftp_xfer_done(),
+                   once the file is stored */
+                last = (n < bs);
+                if (!last && (++count == win))
+                {
+                    tftp_send_ack(x, next - 1);
+                    count = 0;
+                }
+            }
+            else if (!nacked)
+            {
+                /* A gap, or a window sent again: tell the sender, once,
+                   where to resume */
+                tftp_send_ack(x, next - 1);
+                nacked = 1;
+                count = 0;
+            }
+        }
+        else if (op == TFTP_OPCODE_ERROR)
+        {
+            sysprintf("Received ERR: %d\n", blk);
+            netbuf_delete(nbuf);
+            return -1;
+        }
+        else
+        {
+            tftp_send_error(x->conn, &x->addr, x->port, TFTP_ERROR_ILLEGAL_OPERATION, "Illegal operation");
+            netbuf_delete(nbuf);
+            return -1;
+        }
+
+        netbuf_delete(nbuf);
+        nbuf = NULL;
+    }
+
+    return 0;
+}
+
+void tftp_xfer_done(tftp_xfer_t *x)
+{
+    struct netbuf *nbuf;
+    u16_t op, blk;
+
+    tftp_send_ack(x, x->blocks);
+
+    /* Dally: answer the last block again if the sender lost the ACK */
+    netconn_set_recvtimeout(x->conn, TFTP_TIMEOUT);
+    while (netconn_recv(x->conn, &nbuf) == ERR_OK)
+    {
+        if (tftp_xfer_header(x, nbuf, &op, &blk) != 0)
+            continue;
+        if ((op == TFTP_OPCODE_DATA) && (blk == (u16_t)x->blocks))
+            tftp_send_ack(x, blk);
+        netbuf_delete(nbuf);
+    }
+}
@@ -0,0 +1,140 @@
+/*************************************************************************//**
+ * @file     tftp_xfer.h
+ * @version  V1.00
+ * @brief    Windowed TFTP transfer engine, shared by the TFTP client and
+ *           server samples.
+ *
+ *           Packet helpers, option negotiation and the two halves of a
+ *           transfer: the sender keeps up to windowsize blocks in flight
+ *           and the receiver acknowledges once per window (RFC 7440), with
+ *           blocks of up to TFTP_BLKSIZE_MAX bytes (RFC 2348). With the
+ *           options at 512 and 1 both fall back to plain RFC 1350.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __TFTP_XFER_H__
+#define __TFTP_XFER_H__
+
+#include "lwip/api.h"
+#include "tftp.h"
+#include "tftp_store.h"
+
+/* Options present in a request or an OACK */
+#define TFTP_OPT_BLKSIZE        0x01
+#define TFTP_OPT_WINDOWSIZE     0x02
+#define TFTP_OPT_TSIZE          0x04
+
+/* Transfer options, as asked for in a request or agreed in an OACK */
+typedef struct
+{
+    uint16_t    blksize;        /* Data bytes per block */
+    uint16_t    windowsize;     /* Blocks sent before waiting for an ACK */
+    uint32_t    tsize;          /* File size, 0 if unknown */
+    uint8_t     mask;           /* TFTP_OPT_* present; none means no OACK */
+} tftp_opts_t;
+
+/* One transfer with one peer */
+typedef struct
+{
+    struct netconn *conn;       /* Bound to the local TID of the transfer */
+    ip_addr_t       addr;       /* Peer address */
+    u16_t           port;       /* Peer TID */
+    tftp_opts_t     opts;
+    uint8_t         oack_sent;  /* OACK sent, not yet answered */
+    uint32_t        blocks;     /* Blocks acknowledged, or received in order */
+    uint32_t        bytes;      /* Data bytes sent or received */
+    uint32_t        resent;     /* Windows sent again, or ACKs repeated */
+} tftp_xfer_t;
+
+/* Bytes of window buffer tftp_xfer_send() needs for the given options */
+#define TFTP_XFER_BUF_SIZE(blksize, windowsize)     (((blksize) + 4) * (windowsize))
+
+/**
+ * @brief   Plain RFC 1350 options: 512-byte blocks, one at a time
+ */
+void tftp_opts_default(tftp_opts_t *o);
+
+/**
+ * @brief   Lower the options to what this end supports. A receiver also
+ *          bounds the window so that its frames fit in TFTP_RX_FRAMES.
+ */
+void tftp_opts_clamp(tftp_opts_t *o, int receiver);
+
+/**
+ * @brief   Split a RRQ or WRQ into file name, mode and options
+ * @param   p     Request after the opcode
+ * @param   len   Bytes at p
+ * @param   name  Receives a pointer to the file name within p
+ * @param   o     Receives the options, defaults for those not present
+ * @return  0, or -1 if the request is malformed or not in octet mode
+ */
+int tftp_parse_request(char *p, int len, char **name, tftp_opts_t *o);
+
+/**
+ * @brief   Read the options of an OACK into o. Options the OACK does not
+ *          carry fall back to their RFC 1350 values.
+ * @return  0, or -1 if an option is out of range or was not asked for
+ */
+int tftp_parse_oack(char *p, int len, const tftp_opts_t *asked, tftp_opts_t *o);
+
+/* Packets to the peer of x */
+void tftp_send_request(tftp_xfer_t *x, uint16_t op, const char *name, const tftp_opts_t *o);
+void tftp_send_oack(tftp_xfer_t *x);
+void tftp_send_ack(tftp_xfer_t *x, uint16_t blk);
+
+/**
+ * @brief   Send an ERROR packet to any peer
+ */
+void tftp_send_error(struct netconn *conn, const ip_addr_t *addr, u16_t port,
+                     uint16_t code, const char *msg);
+
+/**
+ * @brief   Client side: send a RRQ or WRQ to x->addr:x->port and wait for
+ *          the answer, repeating the request on timeout. Takes the server's
+ *          TID into x->port and the agreed options into x->opts; an OACK to
+ *          a RRQ is accepted with ACK 0.
+ * @param   asked  Options to ask for, none for a plain RFC 1350 request
+ * @param   first  Receives DATA 1 if the server answered a RRQ without an
+ *                 OACK, to be passed on to tftp_xfer_recv()
+ * @return  0, or -1 on ERROR or timeout
+ */
+int tftp_xfer_request(tftp_xfer_t *x, uint16_t op, const char *name,
+                      const tftp_opts_t *asked, struct netbuf **first);
+
+/**
+ * @brief   Data source of a sender
+ * @return  0, or -1 if the data cannot be read
+ */
+typedef int (*tftp_read_fn)(void *ctx, uint32_t offset, uint8_t *buf, uint32_t len);
+
+/**
+ * @brief   Send len bytes to the peer of x, windowsize blocks at a time.
+ *          Blocks are read into buf once and sent from there without a
+ *          copy; a lost block makes the whole window from it go out again.
+ * @param   x     Transfer; with x->oack_sent ACK 0 is awaited first and
+ *                the OACK repeated, otherwise block 0 counts as acked
+ * @param   buf   TFTP_XFER_BUF_SIZE(blksize, windowsize) bytes
+ * @return  0 once the last block is acknowledged, -1 on error or timeout
+ */
+int tftp_xfer_send(tftp_xfer_t *x, tftp_read_fn read, void *ctx, uint32_t len, uint8_t *buf);
+
+/**
+ * @brief   Receive a file from the peer of x into the store, which the
+ *          caller has begun. Acknowledges every windowsize blocks and, once
+ *          per gap, the last block received in order. The last block is
+ *          acknowledged by tftp_xfer_done(), after tftp_store_end().
+ * @param   x      Transfer; with x->oack_sent the OACK is repeated until
+ *                 block 1 arrives, otherwise ACK 0
+ * @param   first  DATA packet already received, or NULL. Freed here.
+ * @return  0 once the last block is in the store, -1 otherwise
+ */
+int tftp_xfer_recv(tftp_xfer_t *x, struct netbuf *first);
+
+/**
+ * @brief   After tftp_xfer_recv() and tftp_store_end() succeeded: acknowledge
+ *          the last block, and for one timeout answer it again should the
+ *          sender have lost that ACK
+ */
+void tftp_xfer_done(tftp_xfer_t *x);
+
+#endif // __TFTP_XFER_H__
@@ -0,0 +1,88 @@
+/*************************************************************************//**
+ * @file     lwipopts_perf.h
+ * @brief    High-throughput lwIP memory and TCP profile for the MA35D1 GMACs
+ *
+ *           Include it from a sample's lwipopts.h in place of the memory,
+ *           TCP and mailbox settings:
+ *             - TCP window and send buffer of 64 segments, window scaling
+ *               so the peer may use all of it
+ *             - core locking for the netconn/socket API and for the GMAC
+ *               receive tasks, instead of a tcpip_thread mailbox round trip
+ *               per call and per received frame
+ *             - pools sized for NU_LWIP_GMAC_NUM interfaces
+ *             - LWIP_STATS with display functions, see stats_display()
+ *
+ *           All lwIP memory is static and links into DDR with the rest of
+ *           .bss; the 16 KB SRAM is too small to hold any of it. The pools
+ *           start on a cache line.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright(C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __LWIPOPTS_PERF_H__
+#define __LWIPOPTS_PERF_H__
+
+#include "NuMicro.h"
+
+/* GMAC interfaces the pools are sized for */
+#ifndef NU_LWIP_GMAC_NUM
+#define NU_LWIP_GMAC_NUM                2
+#endif
+
+/* Segments in the TCP window and in the send buffer */
+#ifndef NU_LWIP_TCP_SEGS
+#define NU_LWIP_TCP_SEGS                64
+#endif
+
+#define LWIP_DECLARE_MEMORY_ALIGNED(variable_name, size) \
+    __ALIGNED(64) u8_t variable_name[LWIP_MEM_ALIGN_BUFFER(size)]
+
+/* ---------- TCP ---------- */
+#define TCP_MSS                         1460
+
+/*
+ * Received pbufs point into the GMAC receive buffers (ethernetif.c), which
+ * the DMA reuses once its ring of RECEIVE_DESC_SIZE descriptors wraps. The
+ * window has to stay well below that many segments.
+ */
+#define LWIP_WND_SCALE                  1
+#define TCP_RCV_SCALE                   1
+#define TCP_WND                         (NU_LWIP_TCP_SEGS * TCP_MSS)
+#define TCP_SND_BUF                     (NU_LWIP_TCP_SEGS * TCP_MSS)
+#define TCP_SND_QUEUELEN                (2 * TCP_SND_BUF / TCP_MSS)
+#define TCP_SND_LOWAT                   (TCP_SND_BUF / 2)
+#define LWIP_TCP_SACK_OUT               1
+
+#if (TCP_WND / TCP_MSS) > (RECEIVE_DESC_SIZE / 2)
+#error "TCP_WND would let received segments outlive their GMAC receive buffer"
+#endif
+
+/* ---------- Memory ---------- */
+/* Heap for TX data copies and headers: two full send buffers per interface */
+#define MEM_SIZE                        (NU_LWIP_GMAC_NUM * 2 * TCP_SND_BUF)
+#define MEMP_NUM_PBUF                   (NU_LWIP_GMAC_NUM * TCP_SND_QUEUELEN)
+#define MEMP_NUM_TCP_SEG                (NU_LWIP_GMAC_NUM * 2 * TCP_SND_QUEUELEN)
+#define MEMP_NUM_TCP_PCB                (NU_LWIP_GMAC_NUM * 4)
+#define MEMP_NUM_NETCONN                (NU_LWIP_GMAC_NUM * 8)
+#define MEMP_NUM_NETBUF                 (NU_LWIP_GMAC_NUM * 8)
+/* One pbuf per receive descriptor of every interface */
+#define PBUF_POOL_SIZE                  (NU_LWIP_GMAC_NUM * RECEIVE_DESC_SIZE)
+
+/* ---------- Threads and mailboxes ---------- */
+#define LWIP_TCPIP_CORE_LOCKING         1
+#define LWIP_TCPIP_CORE_LOCKING_INPUT   1
+#define TCPIP_MBOX_SIZE                 64
+#define DEFAULT_TCP_RECVMBOX_SIZE       NU_LWIP_TCP_SEGS
+#define DEFAULT_ACCEPTMBOX_SIZE         8
+#define DEFAULT_UDP_RECVMBOX_SIZE       32
+#define DEFAULT_RAW_RECVMBOX_SIZE       8
+
+/* ---------- Statistics ---------- */
+#define LWIP_STATS                      1
+#define LWIP_STATS_DISPLAY              1
+#define LINK_STATS                      1
+#define TCP_STATS                       1
+#define MEM_STATS                       1
+#define MEMP_STATS                      1
+
+#endif /* __LWIPOPTS_PERF_H__ */
@@ -42,6 +42,35 @@ int nand_register(int devnum, struct mtd_info *mtd);
 extern int board_nand_init(struct nand_chip *nand);
 #endif
 
+/*
+ * Batched page access of the MA35D1 NFI driver. A request reads or
+ * programs count pages from page on; requests are queued and run from
+ * the NAND interrupt, using the cache read and cache program commands
+ * when the chip has them. complete() is called from the interrupt.
+ */
+#define NUVOTON_NAND_OP_READ	0
+#define NUVOTON_NAND_OP_PROGRAM	1
+
+struct nuvoton_nand_req {
+	int op;			/* NUVOTON_NAND_OP_xxx */
+	int page;		/* First page */
+	int count;		/* Pages */
+	uint8_t *buf;		/* count * writesize bytes */
+	uint8_t *oob;		/* count * oobsize bytes, or NULL */
+	void (*complete)(struct nuvoton_nand_req *req);
+	void *priv;
+	/* Set by the driver */
+	volatile int status;	/* -EINPROGRESS, 0, -EBADMSG, -EIO or -ETIMEDOUT */
+	int done;		/* Pages finished; on -EIO the failing page */
+	unsigned int max_bitflips;
+	struct nuvoton_nand_req *next;
+};
+
+int nuvoton_nand_submit(struct nuvoton_nand_req *req);
+int nuvoton_nand_wait(struct nuvoton_nand_req *req);
+int nuvoton_nand_read_pages(int page, int count, uint8_t *buf, uint8_t *oob);
+int nuvoton_nand_write_pages(int page, int count, const uint8_t *buf, const uint8_t *oob);
+
 typedef struct mtd_info nand_info_t;
 
 extern int nand_curr_device;
@@ -45,12 +45,43 @@
 #define BCH_T12   0x00200000
 #define BCH_T24   0x00040000
 
+/*-----------------------------------------------------------------------------
+ * Cache read/program commands and the ONFI bits that announce them
+ *---------------------------------------------------------------------------*/
+#define NAND_CMD_READCACHESEQ   0x31
+#define NAND_CMD_READCACHEEND   0x3F
+#define ONFI_OPT_CMD_PROG_CACHE (1 << 0)
+#define ONFI_OPT_CMD_READ_CACHE (1 << 1)
+
+#define NAND_INT_ALL    (NFI_NANDINTEN_DMAIE_Msk | NFI_NANDINTEN_ECCFLDIE_Msk | NFI_NANDINTEN_RB0IE_Msk)
+#define NAND_TIMEOUT    3000    /* ms per page */
+
+/* Page engine states; the interrupt moves a request through them page by page */
+enum {
+    NAND_ST_IDLE = 0,
+    NAND_ST_READ_ARRAY,         /* 00h-30h started a cache read sequence */
+    NAND_ST_READ_RB,            /* Page on its way to the cache register */
+    NAND_ST_READ_DMA,           /* Page data moving to memory, BCH checking */
+    NAND_ST_PROG_DMA,           /* Page data moving to the chip */
+    NAND_ST_PROG_RB,            /* 10h or 15h issued */
+};
+
 struct nuvoton_nand_info {
     struct nand_hw_control  controller;
     struct mtd_info         mtd;
     struct nand_chip        chip;
     int                     eBCHAlgo;
     int                     m_i32SMRASize;
+    struct mtd_info         *nand_mtd;      /* The registered MTD device */
+    struct nuvoton_nand_req *head;          /* Request in progress */
+    struct nuvoton_nand_req *tail;
+    int                     state;
+    int                     cur;            /* Page of head in progress */
+    int                     status;         /* Result so far of head */
+    unsigned int            progress;       /* Pages finished, for the timeout */
+    int                     ppb;            /* Pages per block */
+    int                     cache_read;     /* Chip has 31h/3Fh */
+    int                     cache_prog;     /* Chip has 15h */
 };
 struct nuvoton_nand_info g_nuvoton_nand;
 struct nuvoton_nand_info *nuvoton_nand;
@@ -460,69 +491,494 @@ int nuvoton_CorrectData(struct mtd_info *mtd, unsigned long uDAddr)
 }
 
 
-static inline int nuvoton_nand_dma_transfer(struct mtd_info *mtd, const u_char *addr, unsigned int len, int is_write)
+/*-----------------------------------------------------------------------------
+ * Page engine
+ *
+ * Reads and programs run from the NAND interrupt one page at a time. A read
+ * takes the page into the chip's cache register once, fetches the OOB with
+ * a column change to load SMRA, then moves the data by DMA from column 0.
+ * With the cache read commands the chip is already reading the next page
+ * from the array while the DMA and the BCH correction of the current page
+ * run. Programs end all but the last page of a block with 15h when the
+ * chip has cache program, so the next page is loaded while one programs.
+ *---------------------------------------------------------------------------*/
+static void nuvoton_nand_row(struct nand_chip *chip, int page)
 {
-    struct nuvoton_nand_info *nand = nuvoton_nand;
-    int cnt = 0;
+	NFI->NANDADDR = page & 0xff;
+	if (chip->options & NAND_ROW_ADDR_3) {
+		NFI->NANDADDR = (page >> 8) & 0xff;
+		NFI->NANDADDR = ((page >> 16) & 0xff) | ENDADDR;
+	} else
+		NFI->NANDADDR = ((page >> 8) & 0xff) | ENDADDR;
+}
 
-    // For save, wait DMAC to ready
-    while (NFI->DMACTL & 0x200);
+static void nuvoton_nand_change_column(int column)
+{
+	NFI->NANDCMD = NAND_CMD_RNDOUT;
+	NFI->NANDADDR = column & 0xff;
+	NFI->NANDADDR = ((column >> 8) & 0xff) | ENDADDR;
+	NFI->NANDCMD = NAND_CMD_RNDOUTSTART;
+}
 
-    // DMAC enable
-    NFI->DMACTL |= 0x3;
-    while (NFI->DMACTL & 0x2);
+/* Last page of a cache sequence; sequences do not cross blocks */
+static int nuvoton_nand_seq_last(struct nuvoton_nand_info *nand, struct nuvoton_nand_req *req)
+{
+	return (nand->cur + 1 == req->count) || (((req->page + nand->cur + 1) % nand->ppb) == 0);
+}
 
-    // Fill dma_addr
-    dcache_clean_invalidate_by_mva(addr, len);
-    NFI->DMASA = (unsigned long)addr;
+static void nuvoton_nand_dma_start(struct nuvoton_nand_info *nand, const u_char *addr, int is_write)
+{
+	// DMAC enable and reset
+	NFI->DMACTL |= 0x3;
+	while (NFI->DMACTL & 0x2);
 
-    NFI->NANDRACTL = nand->m_i32SMRASize;
+	dcache_clean_invalidate_by_mva(addr, nand->nand_mtd->writesize);
+	NFI->DMASA = (unsigned long)addr;
+	NFI->NANDRACTL = nand->m_i32SMRASize;
 
-    // Enable SM_CS0
-    NFI->NANDCTL = (NFI->NANDCTL & (~0x06000000)) | 0x04000000;
-    /* setup and start DMA using dma_addr */
-
-    if (is_write) {
-        register char *ptr = (char *)(NAND_BASE+0xA00);
-        // To mark this page as dirty.
-        if ((*(ptr+3) & 0xff) == 0xff)
-        	*(ptr+3) = 0;
-        if ((*(ptr+2) & 0xff) == 0xff)
-        	*(ptr+2) = 0;
-
-        NFI->NANDCTL |= 0x4;
-        while (!(NFI->NANDINTSTS & 0x1));
-
-    } else {
-        // Blocking for reading
-        // Enable DMA Read
-    	NFI->NANDCTL |= 0x2;
-
-        if (NFI->NANDCTL & 0x80) {
-            do {
-                int stat=0;
-
-                cnt = nuvoton_CorrectData(mtd, (unsigned long)addr);
-                if (cnt < 0) {
-                    NFI->NANDINTSTS = 0x4;
-                    NFI->DMACTL = 0x3;          // reset DMAC
-                    NFI->NANDCTL |= 0x1;
-                    break;
-                }
-                else {
-                	NFI->NANDINTSTS = 0x4;
-                }
+	if (is_write)
+		NFI->NANDCTL |= 0x4;
+	else
+		NFI->NANDCTL |= 0x2;
+}
 
-            } while (!(NFI->NANDINTSTS & 0x1) || (NFI->NANDINTSTS & 0x4));
-        } else
-            while (!(NFI->NANDINTSTS & 0x1));
-    }
-    dcache_clean_invalidate_by_mva(addr, len);
+/* Brings page cur of a read towards the cache register */
+static void nuvoton_nand_read_issue(struct nuvoton_nand_info *nand, struct nuvoton_nand_req *req)
+{
+	struct nand_chip *chip = mtd_to_nand(nand->nand_mtd);
+	int page = req->page + nand->cur;
+
+	NFI->NANDINTSTS = NFI_NANDINTSTS_RB0IF_Msk;
+	if (nand->cache_read && (nand->cur != 0) && (page % nand->ppb)) {
+		/* Inside a sequence: hand over this page, start reading the next */
+		NFI->NANDCMD = nuvoton_nand_seq_last(nand, req) ? NAND_CMD_READCACHEEND : NAND_CMD_READCACHESEQ;
+		nand->state = NAND_ST_READ_RB;
+		return;
+	}
+
+	NFI->NANDCMD = NAND_CMD_READ0;
+	NFI->NANDADDR = 0;
+	NFI->NANDADDR = 0;
+	nuvoton_nand_row(chip, page);
+	NFI->NANDCMD = NAND_CMD_READSTART;
+	nand->state = (nand->cache_read && !nuvoton_nand_seq_last(nand, req)) ? NAND_ST_READ_ARRAY : NAND_ST_READ_RB;
+}
+
+/* Loads SMRA for page cur of a program and starts moving its data */
+static void nuvoton_nand_prog_issue(struct nuvoton_nand_info *nand, struct nuvoton_nand_req *req)
+{
+	struct mtd_info *mtd = nand->nand_mtd;
+	struct nand_chip *chip = mtd_to_nand(mtd);
+	volatile u8 *smra = (volatile u8 *)(NAND_BASE+0xA00);
+	int i, len = mtd->oobsize - chip->ecc.total;
+
+	for (i = 0; i < mtd->oobsize; i++)
+		smra[i] = (req->oob && (i < len)) ? req->oob[nand->cur * mtd->oobsize + i] : 0xff;
+	// To mark this page as dirty.
+	if (smra[3] == 0xff)
+		smra[3] = 0;
+	if (smra[2] == 0xff)
+		smra[2] = 0;
+
+	NFI->NANDCMD = NAND_CMD_SEQIN;
+	NFI->NANDADDR = 0;
+	NFI->NANDADDR = 0;
+	nuvoton_nand_row(chip, req->page + nand->cur);
+
+	nand->state = NAND_ST_PROG_DMA;
+	nuvoton_nand_dma_start(nand, req->buf + nand->cur * mtd->writesize, 1);
+}
+
+static void nuvoton_nand_start(struct nuvoton_nand_info *nand)
+{
+	struct nuvoton_nand_req *req = nand->head;
+
+	nand->cur = 0;
+	nand->status = 0;
+
+	// Enable SM_CS0
+	NFI->NANDCTL = (NFI->NANDCTL & (~0x06000000)) | 0x04000000;
+	NFI->NANDINTSTS = NAND_INT_ALL;
+	NFI->NANDINTEN = NAND_INT_ALL;
+
+	if (req->op == NUVOTON_NAND_OP_READ)
+		nuvoton_nand_read_issue(nand, req);
+	else
+		nuvoton_nand_prog_issue(nand, req);
+}
+
+/* Completes the head request and starts the next one */
+static void nuvoton_nand_finish(struct nuvoton_nand_info *nand, int status)
+{
+	struct nuvoton_nand_req *req = nand->head;
+
+	nand->head = req->next;
+	if (nand->head == NULL)
+		nand->tail = NULL;
+
+	req->done = (status == -EIO) ? req->done : req->count;
+	req->status = status;
+	if (req->complete)
+		req->complete(req);
+
+	if (nand->head) {
+		nuvoton_nand_start(nand);
+	} else {
+		NFI->NANDINTEN = 0;
+		nand->state = NAND_ST_IDLE;
+	}
+}
+
+static void nuvoton_nand_next_page(struct nuvoton_nand_info *nand)
+{
+	struct nuvoton_nand_req *req = nand->head;
+
+	nand->cur++;
+	nand->progress++;
+	if (nand->cur == req->count)
+		nuvoton_nand_finish(nand, nand->status);
+	else if (req->op == NUVOTON_NAND_OP_READ)
+		nuvoton_nand_read_issue(nand, req);
+	else
+		nuvoton_nand_prog_issue(nand, req);
+}
+
+/* The page is in the cache register: load SMRA from its OOB and move the data */
+static void nuvoton_nand_read_data(struct nuvoton_nand_info *nand, struct nuvoton_nand_req *req)
+{
+	struct mtd_info *mtd = nand->nand_mtd;
+	volatile u8 *smra = (volatile u8 *)(NAND_BASE+0xA00);
+	u_char *buf = req->buf + nand->cur * mtd->writesize;
+	int i;
+
+	nuvoton_nand_change_column(mtd->writesize);
+	for (i = 0; i < mtd->oobsize; i++)
+		smra[i] = (u8)NFI->NANDDATA;
+
+	if ((smra[2] != 0) && (smra[3] != 0)) {
+		/* Never programmed by this driver: no parity to check */
+		memset(buf, 0xff, mtd->writesize);
+		if (req->oob)
+			for (i = 0; i < mtd->oobsize; i++)
+				req->oob[nand->cur * mtd->oobsize + i] = smra[i];
+		nuvoton_nand_next_page(nand);
+		return;
+	}
+
+	nuvoton_nand_change_column(0);
+	nand->state = NAND_ST_READ_DMA;
+	nuvoton_nand_dma_start(nand, buf, 0);
+}
+
+static void nuvoton_nand_service(struct nuvoton_nand_info *nand)
+{
+	struct mtd_info *mtd = nand->nand_mtd;
+	struct nuvoton_nand_req *req = nand->head;
+	volatile u8 *smra = (volatile u8 *)(NAND_BASE+0xA00);
+	uint32_t sts = NFI->NANDINTSTS & NAND_INT_ALL;
+	int i, ret, status;
+
+	if (req == NULL) {
+		NFI->NANDINTEN = 0;
+		return;
+	}
+
+	switch (nand->state) {
+	case NAND_ST_READ_ARRAY:
+		if (!(sts & NFI_NANDINTSTS_RB0IF_Msk))
+			break;
+		/* First page read from the array: keep the array busy with the next */
+		NFI->NANDINTSTS = NFI_NANDINTSTS_RB0IF_Msk;
+		NFI->NANDCMD = NAND_CMD_READCACHESEQ;
+		nand->state = NAND_ST_READ_RB;
+		break;
+
+	case NAND_ST_READ_RB:
+		if (!(sts & NFI_NANDINTSTS_RB0IF_Msk))
+			break;
+		NFI->NANDINTSTS = NFI_NANDINTSTS_RB0IF_Msk;
+		nuvoton_nand_read_data(nand, req);
+		break;
+
+	case NAND_ST_READ_DMA:
+		if (sts & NFI_NANDINTSTS_ECCFLDIF_Msk) {
+			ret = nuvoton_CorrectData(mtd, (unsigned long)(req->buf + nand->cur * mtd->writesize));
+			NFI->NANDINTSTS = NFI_NANDINTSTS_ECCFLDIF_Msk;
+			if (ret < 0) {
+				/* Give up on this page; the rest of the request goes on */
+				NFI->DMACTL = 0x3;          // reset DMAC
+				NFI->NANDCTL |= 0x1;
+				while (NFI->NANDCTL & 0x1);
+				NFI->NANDINTSTS = NFI_NANDINTSTS_DMAIF_Msk;
+				nand->status = -EBADMSG;
+				nuvoton_nand_next_page(nand);
+				break;
+			}
+			if ((unsigned int)ret > req->max_bitflips)
+				req->max_bitflips = ret;
+		}
+		/* Done once the last field has been checked too */
+		sts = NFI->NANDINTSTS;
+		if ((sts & NFI_NANDINTSTS_DMAIF_Msk) && !(sts & NFI_NANDINTSTS_ECCFLDIF_Msk)) {
+			NFI->NANDINTSTS = NFI_NANDINTSTS_DMAIF_Msk;
+			dcache_clean_invalidate_by_mva(req->buf + nand->cur * mtd->writesize, mtd->writesize);
+			// Restore OOB data from SMRA
+			if (req->oob)
+				for (i = 0; i < mtd->oobsize; i++)
+					req->oob[nand->cur * mtd->oobsize + i] = smra[i];
+			nuvoton_nand_next_page(nand);
+		}
+		break;
+
+	case NAND_ST_PROG_DMA:
+		if (!(sts & NFI_NANDINTSTS_DMAIF_Msk))
+			break;
+		NFI->NANDINTSTS = NFI_NANDINTSTS_DMAIF_Msk | NFI_NANDINTSTS_RB0IF_Msk;
+		// Copy parity code in SMRA to oob
+		if (req->oob)
+			for (i = mtd->oobsize - mtd_to_nand(mtd)->ecc.total; i < mtd->oobsize; i++)
+				req->oob[nand->cur * mtd->oobsize + i] = smra[i];
+		NFI->NANDCMD = (nand->cache_prog && !nuvoton_nand_seq_last(nand, req)) ?
+			       NAND_CMD_CACHEDPROG : NAND_CMD_PAGEPROG;
+		nand->state = NAND_ST_PROG_RB;
+		break;
+
+	case NAND_ST_PROG_RB:
+		if (!(sts & NFI_NANDINTSTS_RB0IF_Msk))
+			break;
+		NFI->NANDINTSTS = NFI_NANDINTSTS_RB0IF_Msk;
+		NFI->NANDCMD = NAND_CMD_STATUS;
+		status = NFI->NANDDATA & 0xff;
+		/* With cache program, FAIL_N1 reports the page before this one */
+		if ((status & NAND_STATUS_FAIL_N1) && nand->cache_prog && (nand->cur != 0) &&
+		    ((req->page + nand->cur) % nand->ppb)) {
+			req->done = nand->cur - 1;
+			nuvoton_nand_finish(nand, -EIO);
+		} else if ((status & NAND_STATUS_FAIL) && nuvoton_nand_seq_last(nand, req)) {
+			req->done = nand->cur;
+			nuvoton_nand_finish(nand, -EIO);
+		} else {
+			nuvoton_nand_next_page(nand);
+		}
+		break;
+
+	default:
+		NFI->NANDINTEN = 0;
+		break;
+	}
+}
+
+static void nuvoton_nand_irq_handler(void)
+{
+	nuvoton_nand_service(nuvoton_nand);
+}
+
+/* Runs the engine without the interrupt, e.g. with interrupts masked */
+static void nuvoton_nand_poll(struct nuvoton_nand_info *nand)
+{
+	if (NFI->NANDINTSTS & NFI->NANDINTEN) {
+		IRQ_Disable((IRQn_ID_t)NAND_IRQn);
+		nuvoton_nand_service(nand);
+		IRQ_Enable((IRQn_ID_t)NAND_IRQn);
+	}
+}
+
+/* Fails every queued request after the chip stopped answering */
+static void nuvoton_nand_abort(struct nuvoton_nand_info *nand)
+{
+	struct nuvoton_nand_req *req, *next;
+
+	IRQ_Disable((IRQn_ID_t)NAND_IRQn);
+	NFI->NANDINTEN = 0;
+	NFI->DMACTL = 0x3;          // reset DMAC
+	NFI->NANDCTL |= 0x1;
+	while (NFI->NANDCTL & 0x1);
+
+	req = nand->head;
+	nand->head = nand->tail = NULL;
+	nand->state = NAND_ST_IDLE;
+	while (req) {
+		next = req->next;
+		req->status = -ETIMEDOUT;
+		if (req->complete)
+			req->complete(req);
+		req = next;
+	}
+	IRQ_Enable((IRQn_ID_t)NAND_IRQn);
+}
+
+/**
+ * nuvoton_nand_submit - queue a page request
+ * @req:	request; op, page, count, buf, oob and complete filled in
+ *
+ * Returns 0 once queued, -EINVAL for a bad request. The caller keeps req
+ * and its buffers until req->status leaves -EINPROGRESS.
+ */
+int nuvoton_nand_submit(struct nuvoton_nand_req *req)
+{
+	struct nuvoton_nand_info *nand = nuvoton_nand;
+	struct nand_chip *chip;
+
+	if ((nand == NULL) || (nand->nand_mtd == NULL) || (req == NULL) || (req->buf == NULL))
+		return -EINVAL;
+	chip = mtd_to_nand(nand->nand_mtd);
+	if ((req->op != NUVOTON_NAND_OP_READ) && (req->op != NUVOTON_NAND_OP_PROGRAM))
+		return -EINVAL;
+	if ((req->page < 0) || (req->count <= 0) || (req->page + req->count > chip->pagemask + 1))
+		return -EINVAL;
+
+	req->status = -EINPROGRESS;
+	req->done = 0;
+	req->max_bitflips = 0;
+	req->next = NULL;
+
+	IRQ_Disable((IRQn_ID_t)NAND_IRQn);
+	if (nand->tail)
+		nand->tail->next = req;
+	else
+		nand->head = req;
+	nand->tail = req;
+	if (nand->state == NAND_ST_IDLE)
+		nuvoton_nand_start(nand);
+	IRQ_Enable((IRQn_ID_t)NAND_IRQn);
+
+	return 0;
+}
+
+/**
+ * nuvoton_nand_wait - wait for a submitted request
+ * @req:	request
+ *
+ * Returns req->status. Fails all queued requests with -ETIMEDOUT when no
+ * page finishes within NAND_TIMEOUT ms.
+ */
+int nuvoton_nand_wait(struct nuvoton_nand_req *req)
+{
+	struct nuvoton_nand_info *nand = nuvoton_nand;
+	unsigned long time = msTicks0;
+	unsigned int progress = nand->progress;
+
+	while (req->status == -EINPROGRESS) {
+		nuvoton_nand_poll(nand);
+		if (progress != nand->progress) {
+			progress = nand->progress;
+			time = msTicks0;
+		} else if ((msTicks0 - time) > NAND_TIMEOUT) {
+			nuvoton_nand_abort(nand);
+		}
+	}
+	return req->status;
+}
+
+/**
+ * nuvoton_nand_read_pages - read pages with ECC
+ * @page:	first page
+ * @count:	pages
+ * @buf:	count * writesize bytes
+ * @oob:	count * oobsize bytes, or NULL
+ *
+ * Returns the most bitflips corrected in an ECC step, -EBADMSG if a page
+ * had uncorrectable errors (the other pages are read), or another error.
+ */
+int nuvoton_nand_read_pages(int page, int count, uint8_t *buf, uint8_t *oob)
+{
+	struct nuvoton_nand_req req;
+	int ret;
+
+	memset(&req, 0, sizeof(req));
+	req.op = NUVOTON_NAND_OP_READ;
+	req.page = page;
+	req.count = count;
+	req.buf = buf;
+	req.oob = oob;
+	ret = nuvoton_nand_submit(&req);
+	if (ret == 0)
+		ret = nuvoton_nand_wait(&req);
+	return (ret == 0) ? (int)req.max_bitflips : ret;
+}
+
+/**
+ * nuvoton_nand_write_pages - program pages with ECC
+ * @page:	first page, erased
+ * @count:	pages
+ * @buf:	count * writesize bytes
+ * @oob:	count * oobsize bytes of which the free bytes are written, or NULL
+ *
+ * Returns 0, or -EIO when the chip reported a program failure.
+ */
+int nuvoton_nand_write_pages(int page, int count, const uint8_t *buf, const uint8_t *oob)
+{
+	struct nuvoton_nand_req req;
+	int ret;
+
+	memset(&req, 0, sizeof(req));
+	req.op = NUVOTON_NAND_OP_PROGRAM;
+	req.page = page;
+	req.count = count;
+	req.buf = (uint8_t *)buf;
+	req.oob = (uint8_t *)oob;
+	ret = nuvoton_nand_submit(&req);
+	if (ret == 0)
+		ret = nuvoton_nand_wait(&req);
+	return ret;
+}
 
-    // Clear DMA finished flag
-    NFI->NANDINTSTS |= 0x1;
+/*
+ * mtd->_read and mtd->_write: whole pages go to the engine as one request,
+ * anything else takes the page-by-page path of nand_base.
+ */
+static int nuvoton_nand_mtd_read(struct mtd_info *mtd, loff_t from, size_t len, size_t *retlen, u_char *buf)
+{
+	struct nand_chip *chip = mtd_to_nand(mtd);
+	struct mtd_oob_ops ops;
+	int ret;
+
+	if ((((uint64_t)from | len) & (mtd->writesize - 1)) || ((uint64_t)from + len > chip->chipsize)) {
+		memset(&ops, 0, sizeof(ops));
+		ops.len = len;
+		ops.datbuf = buf;
+		ret = mtd->_read_oob(mtd, from, &ops);
+		*retlen = ops.retlen;
+		return ret;
+	}
 
-    return cnt;
+	chip->select_chip(mtd, 0);
+	ret = nuvoton_nand_read_pages(from >> chip->page_shift, len >> chip->page_shift, buf, NULL);
+	if ((ret >= 0) || (ret == -EBADMSG))
+		*retlen = len;
+	return ret;
+}
+
+static int nuvoton_nand_mtd_write(struct mtd_info *mtd, loff_t to, size_t len, size_t *retlen, const u_char *buf)
+{
+	struct nand_chip *chip = mtd_to_nand(mtd);
+	struct nuvoton_nand_req req;
+	struct mtd_oob_ops ops;
+	int ret;
+
+	if ((((uint64_t)to | len) & (mtd->writesize - 1)) || ((uint64_t)to + len > chip->chipsize)) {
+		memset(&ops, 0, sizeof(ops));
+		ops.len = len;
+		ops.datbuf = (u_char *)buf;
+		ret = mtd->_write_oob(mtd, to, &ops);
+		*retlen = ops.retlen;
+		return ret;
+	}
+
+	/* Drop nand_base's copy of the last page read */
+	chip->pagebuf = -1;
+	chip->select_chip(mtd, 0);
+
+	memset(&req, 0, sizeof(req));
+	req.op = NUVOTON_NAND_OP_PROGRAM;
+	req.page = to >> chip->page_shift;
+	req.count = len >> chip->page_shift;
+	req.buf = (u_char *)buf;
+	ret = nuvoton_nand_submit(&req);
+	if (ret == 0)
+		ret = nuvoton_nand_wait(&req);
+	*retlen = (size_t)req.done * mtd->writesize;
+	return ret;
 }
 
 /**
@@ -551,27 +1007,8 @@ static int nuvoton_nand_write_page_raw(struct mtd_info *mtd, struct nand_chip *c
  */
 static int nuvoton_nand_write_page_hwecc(struct mtd_info *mtd, struct nand_chip *chip, const uint8_t *buf, int oob_required, int page)
 {
-    uint8_t *ecc_calc = chip->buffers->ecccalc;
-    register char * ptr = (char *)(NAND_BASE+0xA00);
-    int volatile i;
-
-    memset((void*)ptr, 0xFF, mtd->oobsize);
-    memcpy((void*)ptr, (void *)chip->oob_poi,  mtd->oobsize - chip->ecc.total);
-
-	nuvoton_nand_command(mtd, NAND_CMD_SEQIN, 0, page);
-	nuvoton_nand_dma_transfer(mtd, buf, mtd->writesize, 0x1);
-	nuvoton_nand_command(mtd, NAND_CMD_PAGEPROG, -1, -1);
-	nuvoton_waitfunc(mtd, chip);
-
-	// Copy parity code in SMRA to calc
-	//memcpy((void *)ecc_calc, (void *)((long)ptr + (mtd->oobsize - chip->ecc.total)), chip->ecc.total);
-	for (i=0; i<chip->ecc.total; i++)
-		*(ecc_calc+i) = *(uint8_t *)((long)ptr + (mtd->oobsize - chip->ecc.total));
-
-	// Copy parity code in calc to oob_poi
-	memcpy((void *)(chip->oob_poi + (mtd->oobsize-chip->ecc.total)), (void *)ecc_calc, chip->ecc.total);
-
-    return 0;
+    /* Free bytes of oob_poi go out with the page, the parity comes back into it */
+    return nuvoton_nand_write_pages(page, 1, buf, chip->oob_poi);
 }
 
 /**
@@ -603,29 +1040,8 @@ static int nuvoton_nand_read_page_raw(struct mtd_info *mtd, struct nand_chip *ch
  */
 static int nuvoton_nand_read_page_hwecc_oob_first(struct mtd_info *mtd, struct nand_chip *chip, uint8_t *buf, int oob_required, int page)
 {
-    uint8_t *p = buf;
-    char * ptr= (char *)(NAND_BASE+0xA00);
-    int bitflips = 0;
-
-    /* At first, read the OOB area  */
-    nuvoton_nand_command(mtd, NAND_CMD_READOOB, 0, page);
-    nuvoton_nand_read_buf(mtd, chip->oob_poi, mtd->oobsize);
-
-    // Second, copy OOB data to SMRA for page read
-    memcpy((void*)ptr, (void*)chip->oob_poi, mtd->oobsize);
-
-	if ((*(ptr+2) != 0) && (*(ptr+3) != 0))
-		memset((void *)p, 0xff, mtd->writesize);
-	else {
-		// Third, read data from nand
-		nuvoton_nand_command(mtd, NAND_CMD_READ0, 0, page);
-		bitflips = nuvoton_nand_dma_transfer(mtd, p, mtd->writesize, 0x0);
-
-		// Fourth, restore OOB data from SMRA
-		memcpy((void *)chip->oob_poi, (void *)ptr, mtd->oobsize);
-	}
-
-    return bitflips;
+    /* One tR: the OOB is fetched by a column change after the page is in the cache register */
+    return nuvoton_nand_read_pages(page, 1, buf, chip->oob_poi);
 }
 
 /**
@@ -768,6 +1184,15 @@ int board_nand_init(struct nand_chip *nand)
 	nand->ecc.bytes = nuvoton_nand_oob.eccbytes / nand->ecc.steps;
 	nand->ecc.total = nuvoton_nand_oob.eccbytes;
 
+    nuvoton_nand->nand_mtd = mtd;
+    nuvoton_nand->ppb = mtd->erasesize / mtd->writesize;
+    if (nand->onfi_version) {
+        /* Little-endian on the chip as on the core */
+        nuvoton_nand->cache_read = !!(nand->onfi_params.opt_cmd & ONFI_OPT_CMD_READ_CACHE);
+        nuvoton_nand->cache_prog = !!(nand->onfi_params.opt_cmd & ONFI_OPT_CMD_PROG_CACHE);
+    } else
+        nuvoton_nand->cache_prog = !!NAND_HAS_CACHEPROG(nand);
+
     nand->options = 0;
 	nand->options |= NAND_NO_SUBPAGE_WRITE;
     nand->bbt_options = (NAND_BBT_USE_FLASH | NAND_BBT_NO_OOB);
@@ -787,6 +1212,14 @@ int board_nand_init(struct nand_chip *nand)
     // Enable H/W ECC, ECC parity check enable bit during read page
     NFI->NANDCTL |= 0x00800080;
 
+    /* Whole-page transfers go to the page engine as one request */
+    mtd->_read = nuvoton_nand_mtd_read;
+    mtd->_write = nuvoton_nand_mtd_write;
+
+    NFI->NANDINTEN = 0;
+    IRQ_SetHandler((IRQn_ID_t)NAND_IRQn, nuvoton_nand_irq_handler);
+    IRQ_Enable((IRQn_ID_t)NAND_IRQn);
+
     return 0;
 }
 
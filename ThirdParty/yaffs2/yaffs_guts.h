@@ -103,7 +103,9 @@
 #define YAFFS_OBJECTID_CHECKPOINT_DATA	0x20
 #define YAFFS_SEQUENCE_CHECKPOINT_DATA	0x21
 
+#ifndef YAFFS_MAX_SHORT_OP_CACHES
 #define YAFFS_MAX_SHORT_OP_CACHES	20
+#endif
 
 #define YAFFS_N_TEMP_BUFFERS		6
 